@@ -0,0 +1,1317 @@
+// Generated by libparsing 0.9.2 with `Grammar_writeC`, do not edit.
+#include "parsing.h"
+
+#define expr_ELEMENT(id)   ((ParsingElement*)context->grammar->elements[id])
+#define expr_REFERENCE(id) ((Reference*)context->grammar->elements[id])
+#define expr_DIRECT        (context->memo == NULL && !context->grammar->isTimed && context->budget == 0 && context->profiler == NULL)
+#define expr_SUCCESS(m)     expr_isSuccess(m)
+#define expr_REMAINING      ((size_t)(context->iterator->available - (context->iterator->current - context->iterator->buffer)))
+#define expr_REJECTS(id)    (context->grammar->first != NULL && expr_REMAINING > 0 && !context->grammar->first[id].nullable && !(context->grammar->first[id].bytes[(unsigned char)*(context->iterator->current) >> 3] & (1 << ((unsigned char)*(context->iterator->current) & 7))))
+#ifndef MATCH_STATS
+#define MATCH_STATS(m)     ParsingContext_registerMatch(context, (Element*)this, m)
+#endif
+
+static inline bool expr_isSuccess(Match* m) {
+	return m != NULL && m != FAILURE && m->status == STATUS_MATCHED;
+}
+
+static const struct {char type; const char* name;} expr_ELEMENTS[46] = {
+	{'R', "Statements"},
+	{'#', NULL},
+	{'R', "Statement"},
+	{'#', NULL},
+	{'G', NULL},
+	{'#', NULL},
+	{'R', "Binding"},
+	{'#', NULL},
+	{'W', "LET"},
+	{'#', NULL},
+	{'!', NULL},
+	{'#', NULL},
+	{'T', "NAME"},
+	{'#', NULL},
+	{'W', "EQUALS"},
+	{'#', NULL},
+	{'R', "Expression"},
+	{'#', NULL},
+	{'c', "NotKeyword"},
+	{'#', NULL},
+	{'G', "Value"},
+	{'#', NULL},
+	{'T', "NUMBER"},
+	{'#', NULL},
+	{0, NULL},
+	{'#', NULL},
+	{'T', "STRING"},
+	{'#', NULL},
+	{'W', "QUOTED"},
+	{'#', NULL},
+	{'R', "Suffix"},
+	{'#', NULL},
+	{'G', "Operator"},
+	{'#', NULL},
+	{'W', "PLUS"},
+	{'#', NULL},
+	{'W', "MINUS"},
+	{'#', NULL},
+	{'W', "TIMES"},
+	{'#', NULL},
+	{0, NULL},
+	{'#', NULL},
+	{0, NULL},
+	{'#', NULL},
+	{'W', "SEMICOLON"},
+	{'T', "WS"},
+};
+
+static Match* expr_e0(ParsingElement* this, ParsingContext* context);
+static Match* expr_r1(ParsingContext* context);
+static Match* expr_e2(ParsingElement* this, ParsingContext* context);
+static Match* expr_r3(ParsingContext* context);
+static Match* expr_e4(ParsingElement* this, ParsingContext* context);
+static Match* expr_r5(ParsingContext* context);
+static Match* expr_e6(ParsingElement* this, ParsingContext* context);
+static Match* expr_r7(ParsingContext* context);
+static Match* expr_e8(ParsingElement* this, ParsingContext* context);
+static Match* expr_r9(ParsingContext* context);
+static Match* expr_r11(ParsingContext* context);
+static Match* expr_r13(ParsingContext* context);
+static Match* expr_e14(ParsingElement* this, ParsingContext* context);
+static Match* expr_r15(ParsingContext* context);
+static Match* expr_e16(ParsingElement* this, ParsingContext* context);
+static Match* expr_r17(ParsingContext* context);
+static Match* expr_r19(ParsingContext* context);
+static Match* expr_e20(ParsingElement* this, ParsingContext* context);
+static Match* expr_r21(ParsingContext* context);
+static Match* expr_r23(ParsingContext* context);
+static Match* expr_r25(ParsingContext* context);
+static Match* expr_r27(ParsingContext* context);
+static Match* expr_e28(ParsingElement* this, ParsingContext* context);
+static Match* expr_r29(ParsingContext* context);
+static Match* expr_e30(ParsingElement* this, ParsingContext* context);
+static Match* expr_r31(ParsingContext* context);
+static Match* expr_e32(ParsingElement* this, ParsingContext* context);
+static Match* expr_r33(ParsingContext* context);
+static Match* expr_e34(ParsingElement* this, ParsingContext* context);
+static Match* expr_r35(ParsingContext* context);
+static Match* expr_e36(ParsingElement* this, ParsingContext* context);
+static Match* expr_r37(ParsingContext* context);
+static Match* expr_e38(ParsingElement* this, ParsingContext* context);
+static Match* expr_r39(ParsingContext* context);
+static Match* expr_r41(ParsingContext* context);
+static Match* expr_r43(ParsingContext* context);
+static Match* expr_e44(ParsingElement* this, ParsingContext* context);
+
+// Statements #0 R
+static Match* expr_e0(ParsingElement* this, ParsingContext* context) {
+	Match*    result = FAILURE;
+	Match*    last   = NULL;
+	Match*    match  = NULL;
+	size_t    offset = context->iterator->offset;
+	size_t    cuts   = context->cuts;
+	ArenaMark mark   = Arena_mark(context->arena);
+	if (expr_REJECTS(0)) {return MATCH_STATS(FAILURE);}
+	bool scoped = HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);
+	if (scoped) {ParsingContext_push(context);}
+	cuts  = context->cuts;
+	if (expr_REFERENCE(1) == context->commit) {ParsingContext__enclose(context, this, result, offset);}
+	match = expr_r1(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r1(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	if (last == NULL) {goto failure;}
+	if (scoped) {ParsingContext_pop(context);}
+	result->length = last->offset - result->offset + last->length;
+	return MATCH_STATS(result);
+failure:
+	if (scoped) {ParsingContext_pop(context);}
+	Arena_rewind(context->arena, mark);
+	if (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #1, cardinality `*`
+static Match* expr_r1(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(1);
+	if (this == context->commit) {return Reference_recognize(this, context);}
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	while (Iterator_hasMore(context->iterator)) {
+		size_t start = context->iterator->offset;
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e2(expr_ELEMENT(2), context) : ParsingElement_recognize(expr_ELEMENT(2), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			if (context->iterator->offset == start) {break;}
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Statement #2 R
+static Match* expr_e2(ParsingElement* this, ParsingContext* context) {
+	Match*    result = FAILURE;
+	Match*    last   = NULL;
+	Match*    match  = NULL;
+	size_t    offset = context->iterator->offset;
+	size_t    cuts   = context->cuts;
+	ArenaMark mark   = Arena_mark(context->arena);
+	if (expr_REJECTS(2)) {return MATCH_STATS(FAILURE);}
+	bool scoped = HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);
+	if (scoped) {ParsingContext_push(context);}
+	cuts  = context->cuts;
+	match = expr_r3(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r3(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	cuts  = context->cuts;
+	match = expr_r43(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r43(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	if (last == NULL) {goto failure;}
+	if (scoped) {ParsingContext_pop(context);}
+	result->length = last->offset - result->offset + last->length;
+	return MATCH_STATS(result);
+failure:
+	if (scoped) {ParsingContext_pop(context);}
+	Arena_rewind(context->arena, mark);
+	if (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #3, cardinality `?`
+static Match* expr_r3(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(3);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e4(expr_ELEMENT(4), context) : ParsingElement_recognize(expr_ELEMENT(4), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// - #4 G
+static Match* expr_e4(ParsingElement* this, ParsingContext* context) {
+	size_t    offset = context->iterator->offset;
+	size_t    cuts   = context->cuts;
+	ArenaMark mark   = Arena_mark(context->arena);
+	Match*    match  = NULL;
+	if (!expr_REJECTS(5) && expr_SUCCESS(match = expr_r5(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+	if (!expr_REJECTS(41) && expr_SUCCESS(match = expr_r41(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+failure:
+	if (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}
+	return MATCH_STATS(FAILURE);
+success:;
+	Match* result   = Match_Success(match->length, this, context);
+	result->offset   = offset;
+	result->children = match;
+	match->parent   = result;
+	return MATCH_STATS(result);
+}
+
+// Reference #5, cardinality `1`
+static Match* expr_r5(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(5);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e6(expr_ELEMENT(6), context) : ParsingElement_recognize(expr_ELEMENT(6), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Binding #6 R
+static Match* expr_e6(ParsingElement* this, ParsingContext* context) {
+	Match*    result = FAILURE;
+	Match*    last   = NULL;
+	Match*    match  = NULL;
+	size_t    offset = context->iterator->offset;
+	size_t    cuts   = context->cuts;
+	ArenaMark mark   = Arena_mark(context->arena);
+	if (expr_REJECTS(6)) {return MATCH_STATS(FAILURE);}
+	bool scoped = HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);
+	if (scoped) {ParsingContext_push(context);}
+	cuts  = context->cuts;
+	match = expr_r7(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r7(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	cuts  = context->cuts;
+	match = expr_r9(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r9(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	cuts  = context->cuts;
+	match = expr_r11(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r11(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	cuts  = context->cuts;
+	match = expr_r13(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r13(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	cuts  = context->cuts;
+	match = expr_r15(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r15(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	if (last == NULL) {goto failure;}
+	if (scoped) {ParsingContext_pop(context);}
+	result->length = last->offset - result->offset + last->length;
+	return MATCH_STATS(result);
+failure:
+	if (scoped) {ParsingContext_pop(context);}
+	Arena_rewind(context->arena, mark);
+	if (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #7, cardinality `1`
+static Match* expr_r7(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(7);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e8(expr_ELEMENT(8), context) : ParsingElement_recognize(expr_ELEMENT(8), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// LET #8 W
+static Match* expr_e8(ParsingElement* this, ParsingContext* context) {
+	if (expr_REMAINING >= 3 && memcmp(context->iterator->current, "let", 3) == 0) {
+		Match* match = MATCH_STATS(Match_Success(3, this, context));
+		context->iterator->move(context->iterator, 3);
+		return match;
+	}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #9, cardinality `1`
+static Match* expr_r9(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(9);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (TRUE) {
+		size_t cuts  = context->cuts;
+		Match* match = ParsingElement_recognize(expr_REFERENCE(9)->element, context);
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Reference #11, cardinality `1`
+static Match* expr_r11(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(11);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = ParsingElement_recognize(expr_REFERENCE(11)->element, context);
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Reference #13, cardinality `1`
+static Match* expr_r13(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(13);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e14(expr_ELEMENT(14), context) : ParsingElement_recognize(expr_ELEMENT(14), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// EQUALS #14 W
+static Match* expr_e14(ParsingElement* this, ParsingContext* context) {
+	if (expr_REMAINING >= 1 && memcmp(context->iterator->current, "=", 1) == 0) {
+		Match* match = MATCH_STATS(Match_Success(1, this, context));
+		context->iterator->move(context->iterator, 1);
+		return match;
+	}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #15, cardinality `1`
+static Match* expr_r15(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(15);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e16(expr_ELEMENT(16), context) : ParsingElement_recognize(expr_ELEMENT(16), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Expression #16 R
+static Match* expr_e16(ParsingElement* this, ParsingContext* context) {
+	Match*    result = FAILURE;
+	Match*    last   = NULL;
+	Match*    match  = NULL;
+	size_t    offset = context->iterator->offset;
+	size_t    cuts   = context->cuts;
+	ArenaMark mark   = Arena_mark(context->arena);
+	if (expr_REJECTS(16)) {return MATCH_STATS(FAILURE);}
+	bool scoped = HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);
+	if (scoped) {ParsingContext_push(context);}
+	cuts  = context->cuts;
+	match = expr_r17(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r17(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	cuts  = context->cuts;
+	match = expr_r19(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r19(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	cuts  = context->cuts;
+	if (expr_REFERENCE(29) == context->commit) {ParsingContext__enclose(context, this, result, offset);}
+	match = expr_r29(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r29(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	if (last == NULL) {goto failure;}
+	if (scoped) {ParsingContext_pop(context);}
+	result->length = last->offset - result->offset + last->length;
+	return MATCH_STATS(result);
+failure:
+	if (scoped) {ParsingContext_pop(context);}
+	Arena_rewind(context->arena, mark);
+	if (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #17, cardinality `1`
+static Match* expr_r17(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(17);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (TRUE) {
+		size_t cuts  = context->cuts;
+		Match* match = ParsingElement_recognize(expr_REFERENCE(17)->element, context);
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Reference #19, cardinality `1`
+static Match* expr_r19(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(19);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e20(expr_ELEMENT(20), context) : ParsingElement_recognize(expr_ELEMENT(20), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Value #20 G
+static Match* expr_e20(ParsingElement* this, ParsingContext* context) {
+	size_t    offset = context->iterator->offset;
+	size_t    cuts   = context->cuts;
+	ArenaMark mark   = Arena_mark(context->arena);
+	Match*    match  = NULL;
+	if (!expr_REJECTS(21) && expr_SUCCESS(match = expr_r21(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+	if (!expr_REJECTS(23) && expr_SUCCESS(match = expr_r23(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+	if (!expr_REJECTS(25) && expr_SUCCESS(match = expr_r25(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+	if (!expr_REJECTS(27) && expr_SUCCESS(match = expr_r27(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+failure:
+	if (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}
+	return MATCH_STATS(FAILURE);
+success:;
+	Match* result   = Match_Success(match->length, this, context);
+	result->offset   = offset;
+	result->children = match;
+	match->parent   = result;
+	return MATCH_STATS(result);
+}
+
+// Reference #21, cardinality `1`
+static Match* expr_r21(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(21);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = ParsingElement_recognize(expr_REFERENCE(21)->element, context);
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Reference #23, cardinality `1`
+static Match* expr_r23(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(23);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = ParsingElement_recognize(expr_REFERENCE(23)->element, context);
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Reference #25, cardinality `1`
+static Match* expr_r25(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(25);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = ParsingElement_recognize(expr_REFERENCE(25)->element, context);
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Reference #27, cardinality `1`
+static Match* expr_r27(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(27);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e28(expr_ELEMENT(28), context) : ParsingElement_recognize(expr_ELEMENT(28), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// QUOTED #28 W
+static Match* expr_e28(ParsingElement* this, ParsingContext* context) {
+	if (expr_REMAINING >= 4 && memcmp(context->iterator->current, "\134\042\077\012", 4) == 0) {
+		Match* match = MATCH_STATS(Match_Success(4, this, context));
+		context->iterator->move(context->iterator, 4);
+		return match;
+	}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #29, cardinality `*`
+static Match* expr_r29(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(29);
+	if (this == context->commit) {return Reference_recognize(this, context);}
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	while (Iterator_hasMore(context->iterator)) {
+		size_t start = context->iterator->offset;
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e30(expr_ELEMENT(30), context) : ParsingElement_recognize(expr_ELEMENT(30), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			if (context->iterator->offset == start) {break;}
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Suffix #30 R
+static Match* expr_e30(ParsingElement* this, ParsingContext* context) {
+	Match*    result = FAILURE;
+	Match*    last   = NULL;
+	Match*    match  = NULL;
+	size_t    offset = context->iterator->offset;
+	size_t    cuts   = context->cuts;
+	ArenaMark mark   = Arena_mark(context->arena);
+	if (expr_REJECTS(30)) {return MATCH_STATS(FAILURE);}
+	bool scoped = HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);
+	if (scoped) {ParsingContext_push(context);}
+	cuts  = context->cuts;
+	match = expr_r31(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r31(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	cuts  = context->cuts;
+	match = expr_r39(context);
+	if (!expr_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !expr_SUCCESS(match = expr_r39(context)))) {goto failure;}
+	if (last == NULL) {
+		result           = Match_Success(match->length, this, context);
+		result->offset   = offset;
+		result->children = last = match;
+	} else {
+		last = last->next = match;
+	}
+	match->parent = result;
+	if (last == NULL) {goto failure;}
+	if (scoped) {ParsingContext_pop(context);}
+	result->length = last->offset - result->offset + last->length;
+	return MATCH_STATS(result);
+failure:
+	if (scoped) {ParsingContext_pop(context);}
+	Arena_rewind(context->arena, mark);
+	if (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #31, cardinality `1`
+static Match* expr_r31(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(31);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e32(expr_ELEMENT(32), context) : ParsingElement_recognize(expr_ELEMENT(32), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Operator #32 G
+static Match* expr_e32(ParsingElement* this, ParsingContext* context) {
+	size_t    offset = context->iterator->offset;
+	size_t    cuts   = context->cuts;
+	ArenaMark mark   = Arena_mark(context->arena);
+	Match*    match  = NULL;
+	if (!expr_REJECTS(33) && expr_SUCCESS(match = expr_r33(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+	if (!expr_REJECTS(35) && expr_SUCCESS(match = expr_r35(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+	if (!expr_REJECTS(37) && expr_SUCCESS(match = expr_r37(context))) {goto success;}
+	Arena_rewind(context->arena, mark);
+	if (context->cuts != cuts) {goto failure;}
+failure:
+	if (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}
+	return MATCH_STATS(FAILURE);
+success:;
+	Match* result   = Match_Success(match->length, this, context);
+	result->offset   = offset;
+	result->children = match;
+	match->parent   = result;
+	return MATCH_STATS(result);
+}
+
+// Reference #33, cardinality `1`
+static Match* expr_r33(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(33);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e34(expr_ELEMENT(34), context) : ParsingElement_recognize(expr_ELEMENT(34), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// PLUS #34 W
+static Match* expr_e34(ParsingElement* this, ParsingContext* context) {
+	if (expr_REMAINING >= 1 && memcmp(context->iterator->current, "+", 1) == 0) {
+		Match* match = MATCH_STATS(Match_Success(1, this, context));
+		context->iterator->move(context->iterator, 1);
+		return match;
+	}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #35, cardinality `1`
+static Match* expr_r35(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(35);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e36(expr_ELEMENT(36), context) : ParsingElement_recognize(expr_ELEMENT(36), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// MINUS #36 W
+static Match* expr_e36(ParsingElement* this, ParsingContext* context) {
+	if (expr_REMAINING >= 1 && memcmp(context->iterator->current, "-", 1) == 0) {
+		Match* match = MATCH_STATS(Match_Success(1, this, context));
+		context->iterator->move(context->iterator, 1);
+		return match;
+	}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #37, cardinality `1`
+static Match* expr_r37(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(37);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e38(expr_ELEMENT(38), context) : ParsingElement_recognize(expr_ELEMENT(38), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// TIMES #38 W
+static Match* expr_e38(ParsingElement* this, ParsingContext* context) {
+	if (expr_REMAINING >= 1 && memcmp(context->iterator->current, "*", 1) == 0) {
+		Match* match = MATCH_STATS(Match_Success(1, this, context));
+		context->iterator->move(context->iterator, 1);
+		return match;
+	}
+	return MATCH_STATS(FAILURE);
+}
+
+// Reference #39, cardinality `1`
+static Match* expr_r39(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(39);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e20(expr_ELEMENT(20), context) : ParsingElement_recognize(expr_ELEMENT(20), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Reference #41, cardinality `1`
+static Match* expr_r41(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(41);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e16(expr_ELEMENT(16), context) : ParsingElement_recognize(expr_ELEMENT(16), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// Reference #43, cardinality `1`
+static Match* expr_r43(ParsingContext* context) {
+	Reference* this = expr_REFERENCE(43);
+	Match*     result = FAILURE;
+	Match*     tail   = NULL;
+	size_t     offset = context->iterator->offset;
+	size_t     end    = offset;
+	ArenaMark  mark   = Arena_mark(context->arena);
+	while (Iterator_hasMore(context->iterator)) {
+		size_t cuts  = context->cuts;
+		Match* match = (expr_DIRECT ? expr_e44(expr_ELEMENT(44), context) : ParsingElement_recognize(expr_ELEMENT(44), context));
+		if (expr_SUCCESS(match)) {
+			end = Match_getEndOffset(match);
+			if (tail == NULL) {result = match;} else {tail->next = match;}
+			tail = match;
+			break;
+		} else if (context->cuts != cuts) {
+			ParsingContext_backtrack(context, offset);
+			return MATCH_STATS(FAILURE);
+		} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {
+			break;
+		}
+		if (context->iterator->offset == offset) {break;}
+	}
+	if (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}
+	if (!expr_SUCCESS(result)) {
+		Arena_rewind(context->arena, mark);
+		return MATCH_STATS(FAILURE);
+	}
+	Match* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);
+	m->children = result == FAILURE ? NULL : result;
+	m->offset   = offset;
+	for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+	return MATCH_STATS(m);
+}
+
+// SEMICOLON #44 W
+static Match* expr_e44(ParsingElement* this, ParsingContext* context) {
+	if (expr_REMAINING >= 1 && memcmp(context->iterator->current, ";", 1) == 0) {
+		Match* match = MATCH_STATS(Match_Success(1, this, context));
+		context->iterator->move(context->iterator, 1);
+		return match;
+	}
+	return MATCH_STATS(FAILURE);
+}
+
+bool expr_install(Grammar* g) {
+	if (g->elements == NULL) {Grammar_prepare(g);}
+	if (g->elements == NULL || g->axiomCount + g->skipCount + 1 != 46) {return FALSE;}
+	for (int i=0 ; i<46 ; i++) {
+		Element* e = g->elements[i];
+		if (e == NULL) {if (expr_ELEMENTS[i].type != 0) {return FALSE;} continue;}
+		if (e->id != i || e->type != expr_ELEMENTS[i].type) {return FALSE;}
+		if ((e->name == NULL) != (expr_ELEMENTS[i].name == NULL)) {return FALSE;}
+		if (e->name != NULL && strcmp(e->name, expr_ELEMENTS[i].name) != 0) {return FALSE;}
+	}
+	((ParsingElement*)g->elements[0])->recognize = expr_e0;
+	((ParsingElement*)g->elements[2])->recognize = expr_e2;
+	((ParsingElement*)g->elements[4])->recognize = expr_e4;
+	((ParsingElement*)g->elements[6])->recognize = expr_e6;
+	((ParsingElement*)g->elements[8])->recognize = expr_e8;
+	((ParsingElement*)g->elements[14])->recognize = expr_e14;
+	((ParsingElement*)g->elements[16])->recognize = expr_e16;
+	((ParsingElement*)g->elements[20])->recognize = expr_e20;
+	((ParsingElement*)g->elements[28])->recognize = expr_e28;
+	((ParsingElement*)g->elements[30])->recognize = expr_e30;
+	((ParsingElement*)g->elements[32])->recognize = expr_e32;
+	((ParsingElement*)g->elements[34])->recognize = expr_e34;
+	((ParsingElement*)g->elements[36])->recognize = expr_e36;
+	((ParsingElement*)g->elements[38])->recognize = expr_e38;
+	((ParsingElement*)g->elements[44])->recognize = expr_e44;
+	return TRUE;
+}
+
+// EOF
@@ -0,0 +1,39 @@
+#include "bench.h"
+
+// The grammar of the `c-parser-expr` test
+Grammar* createGrammar() {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,             TOKEN("\\s+"));
+	SYMBOL (NUMBER,         TOKEN("\\d+(\\.\\d+)?"));
+	SYMBOL (VARIABLE,       TOKEN("\\w+"));
+	SYMBOL (OPERATOR,       TOKEN("[\\+\\-\\*/]"));
+	SYMBOL (Value,         GROUP( _S(NUMBER), _S(VARIABLE)));
+	SYMBOL (Suffix,        RULE (_AS(_S(OPERATOR), "operator"), _AS(_S(Value), "value")));
+	SYMBOL (Expression,    RULE (_S(Value), MANY_OPTIONAL(_S(Suffix))));
+	AXIOM(Expression);
+	SKIP(WS);
+	return g;
+}
+
+const char* OPERATORS = "+-*/";
+
+// A single expression of numbers and variables, spread over lines
+void createCorpus(Bench* this) {
+	Bench_append(this, "%zu", Bench_random(this, 1000));
+	while (Bench_hasMore(this)) {
+		char op = OPERATORS[Bench_random(this, 4)];
+		switch (Bench_random(this, 3)) {
+			case 0:  Bench_append(this, " %c %zu", op, Bench_random(this, 100000)); break;
+			case 1:  Bench_append(this, " %c %zu.%zu", op, Bench_random(this, 1000), Bench_random(this, 100)); break;
+			default: Bench_append(this, " %c var%zu", op, Bench_random(this, 100)); break;
+		}
+		if (Bench_random(this, 16) == 0) {Bench_append(this, "\n");}
+	}
+}
+
+int main (int argc, char** argv) {
+	Grammar* g = createGrammar();
+	int      r = Bench_run("expr", g, createCorpus, argc, argv);
+	Grammar_free(g);
+	return r;
+}
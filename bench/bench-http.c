@@ -0,0 +1,50 @@
+#include "bench.h"
+
+// A grammar for HTTP requests, after the one used by nom_benchmarks
+// (see NOTES.md).
+Grammar* createGrammar() {
+	Grammar* g = Grammar_new();
+	SYMBOL (SP,        WORD(" "));
+	SYMBOL (CRLF,      WORD("\r\n"));
+	SYMBOL (COLON,     TOKEN(":[ \\t]*"));
+	SYMBOL (METHOD,    TOKEN("[A-Z]+"));
+	SYMBOL (URI,       TOKEN("[^ \\r\\n]+"));
+	SYMBOL (VERSION,   TOKEN("HTTP/(\\d\\.\\d)"));
+	SYMBOL (NAME,      TOKEN("[A-Za-z0-9\\-]+"));
+	SYMBOL (VALUE,     TOKEN("[^\\r\\n]*"));
+	SYMBOL (Line,      RULE(_S(METHOD), _S(SP), _S(URI), _S(SP), _S(VERSION), _S(CRLF)));
+	SYMBOL (Header,    RULE(_S(NAME), _S(COLON), _S(VALUE), _S(CRLF)));
+	SYMBOL (Request,   RULE(_S(Line), MANY_OPTIONAL(_S(Header)), _S(CRLF)));
+	SYMBOL (Requests,  RULE(MANY(_S(Request))));
+	AXIOM(Requests);
+	return g;
+}
+
+const char* METHODS[] = {"GET", "POST", "HEAD", "PUT"};
+const char* HEADERS[] = {
+	"Host: www.reddit.com",
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:15.0) Gecko/20100101 Firefox/15.0.1",
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8",
+	"Accept-Language: en-us,en;q=0.5",
+	"Accept-Encoding: gzip, deflate",
+	"Connection: keep-alive",
+	"Cookie: reddit_first=%7B%22firsttime%22%3A%20%22first%22%7D"
+};
+
+void createCorpus(Bench* this) {
+	while (Bench_hasMore(this)) {
+		Bench_append(this, "%s /r/%zu/comments/%zu HTTP/1.1\r\n", METHODS[Bench_random(this, 4)], Bench_random(this, 1000), Bench_random(this, 100000));
+		size_t headers = 1 + Bench_random(this, 7);
+		for (size_t i=0 ; i<headers ; i++) {
+			Bench_append(this, "%s\r\n", HEADERS[i]);
+		}
+		Bench_append(this, "\r\n");
+	}
+}
+
+int main (int argc, char** argv) {
+	Grammar* g = createGrammar();
+	int      r = Bench_run("http", g, createCorpus, argc, argv);
+	Grammar_free(g);
+	return r;
+}
@@ -0,0 +1,43 @@
+#include "bench.h"
+
+// We benchmark the grammar of the `c-parser-pcss` test
+#define main test_main
+#include "../test/c-parser-pcss.c"
+#undef main
+
+const char* PROPERTIES[] = {"float: left", "width: %zu%%", "padding: %zupx", "margin: 0 %zuem", "color: #%03zu"};
+
+// Nested blocks of selectors and properties, similar to `c-parser-pcss.pcss`
+void createProperties(Bench* this, const char* indent) {
+	size_t count = 1 + Bench_random(this, 4);
+	for (size_t i=0 ; i<count ; i++) {
+		Bench_append(this, "%s", indent);
+		Bench_append(this, PROPERTIES[Bench_random(this, 5)], Bench_random(this, 100));
+		Bench_append(this, "\n");
+	}
+}
+
+// NOTE: As the indentation procedures of the grammar are no-ops, a block
+// would contain all the blocks that follow it. We separate blocks with a
+// declaration so that the depth of the parse doesn't grow with the corpus.
+void createCorpus(Bench* this) {
+	while (Bench_hasMore(this)) {
+		Bench_append(this, "// Block %zu\n", this->length);
+		Bench_append(this, "size_%zu = %zupx\n", this->length, Bench_random(this, 100));
+		Bench_append(this, "div.block-%zu:\n", Bench_random(this, 1000));
+		createProperties(this, "\t");
+		size_t children = Bench_random(this, 4);
+		for (size_t i=0 ; i<children ; i++) {
+			Bench_append(this, "\t.by-%zu > * :\n", Bench_random(this, 10));
+			createProperties(this, "\t\t");
+		}
+		Bench_append(this, "\n");
+	}
+}
+
+int main (int argc, char** argv) {
+	Grammar* g = createGrammar();
+	int      r = Bench_run("pcss", g, createCorpus, argc, argv);
+	Grammar_free(g);
+	return r;
+}
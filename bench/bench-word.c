@@ -0,0 +1,35 @@
+#include "bench.h"
+
+// Keywords are words, and other names tokens, so that the benchmark
+// exercises the same elements as the `c-parser-word` test.
+Grammar* createGrammar() {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,      TOKEN("\\s+"));
+	SYMBOL (IF,      WORD("if"));
+	SYMBOL (ELSE,    WORD("else"));
+	SYMBOL (WHILE,   WORD("while"));
+	SYMBOL (RETURN,  WORD("return"));
+	SYMBOL (NAME,    TOKEN("[a-z]+"));
+	SYMBOL (Keyword, GROUP(_S(IF), _S(ELSE), _S(WHILE), _S(RETURN)));
+	SYMBOL (Word,    GROUP(_S(Keyword), _S(NAME)));
+	SYMBOL (Words,   RULE(MANY(_S(Word))));
+	AXIOM(Words);
+	SKIP(WS);
+	return g;
+}
+
+const char* WORDS[] = {"if", "else", "while", "return", "value", "a", "xyz"};
+
+void createCorpus(Bench* this) {
+	Bench_append(this, "%s", WORDS[0]);
+	while (Bench_hasMore(this)) {
+		Bench_append(this, "%c%s", Bench_random(this, 12) == 0 ? '\n' : ' ', WORDS[Bench_random(this, 7)]);
+	}
+}
+
+int main (int argc, char** argv) {
+	Grammar* g = createGrammar();
+	int      r = Bench_run("word", g, createCorpus, argc, argv);
+	Grammar_free(g);
+	return r;
+}
@@ -0,0 +1,152 @@
+#ifndef __BENCH__
+#define __BENCH__
+#include "parsing.h"
+#include <stdint.h>
+#include <sys/resource.h>
+
+/**
+ * The benchmark harness, shared by the `bench/bench-*.c` programs. Each
+ * program generates a corpus of the given size, parses it a few times and
+ * writes a single JSON line with the throughput of the fastest run, the
+ * number of matches, the peak RSS and the number of allocations:
+ *
+ * ```
+ * dist/bench-expr 1048576
+ * {"bench":"expr","version":"0.9.2","size":1048576,"status":"S",...}
+ * ```
+ *
+ * Corpora are generated from a fixed seed, so that successive releases are
+ * measured against the same input. The harness is a header so that the
+ * allocation counters below replace the allocator of the whole process.
+*/
+
+#define BENCH_SIZE     (1024 * 1024)
+#define BENCH_REPEAT   3
+#define BENCH_SEED     20161115
+
+typedef struct Bench {
+	const char* name;
+	char*       text;
+	size_t      length;
+	size_t      capacity;
+	size_t      size;          // The requested size of the corpus
+	uint32_t    seed;          // The state of the corpus generator
+} Bench;
+
+typedef void (*BenchCorpus)(Bench* bench);
+
+// ----------------------------------------------------------------------------
+//
+// ALLOCATIONS
+//
+// ----------------------------------------------------------------------------
+
+// We count the allocations of the whole process (including PCRE) by
+// replacing the allocator, which glibc supports. Other C libraries
+// report no allocations.
+size_t Bench_allocations = 0;
+
+#ifdef __GLIBC__
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void  __libc_free(void* ptr);
+
+void* malloc(size_t size)               {Bench_allocations++; return __libc_malloc(size);}
+void* calloc(size_t count, size_t size) {Bench_allocations++; return __libc_calloc(count, size);}
+void* realloc(void* ptr, size_t size)   {Bench_allocations++; return __libc_realloc(ptr, size);}
+void  free(void* ptr)                   {__libc_free(ptr);}
+#endif
+
+// ----------------------------------------------------------------------------
+//
+// CORPUS
+//
+// ----------------------------------------------------------------------------
+
+// Returns a pseudo-random number in `[0, n)`, using a linear congruential
+// generator so that corpora are the same on every platform.
+size_t Bench_random(Bench* this, size_t n) {
+	this->seed = this->seed * 1103515245 + 12345;
+	return n == 0 ? 0 : ((this->seed >> 16) & 0x7FFF) % n;
+}
+
+void Bench_append(Bench* this, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+	if (n < 0) {return;}
+	while (this->length + n + 1 > this->capacity) {
+		this->capacity = this->capacity * 2;
+		this->text     = realloc(this->text, this->capacity);
+	}
+	va_start(args, format);
+	vsnprintf(this->text + this->length, n + 1, format, args);
+	va_end(args);
+	this->length += n;
+}
+
+// Returns true while the corpus is smaller than the requested size
+bool Bench_hasMore(Bench* this) {
+	return this->length < this->size;
+}
+
+// ----------------------------------------------------------------------------
+//
+// RUN
+//
+// ----------------------------------------------------------------------------
+
+size_t Bench_peakRSS(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	// NOTE: `ru_maxrss` is in kilobytes on Linux
+	return (size_t)usage.ru_maxrss;
+}
+
+// Parses the generated corpus with the given grammar and prints the results
+// as a JSON line. Returns 0 if the corpus was entirely parsed.
+int Bench_run(const char* name, Grammar* grammar, BenchCorpus corpus, int argc, char** argv) {
+	Bench bench = {
+		.name     = name,
+		.text     = malloc(4096),
+		.length   = 0,
+		.capacity = 4096,
+		.size     = argc > 1 ? (size_t)atol(argv[1]) : BENCH_SIZE,
+		.seed     = BENCH_SEED
+	};
+	bench.text[0] = '\0';
+	corpus(&bench);
+
+	double best        = -1;
+	char   status      = STATUS_INIT;
+	size_t parsed      = 0;
+	size_t matches     = 0;
+	size_t allocations = 0;
+	for (int i=0 ; i<BENCH_REPEAT ; i++) {
+		Bench_allocations = 0;
+		double         start   = ParsingStats_now();
+		ParsingResult* result  = Grammar_parseString(grammar, bench.text);
+		double         elapsed = ParsingStats_now() - start;
+		allocations = Bench_allocations;
+		status      = result->status;
+		parsed      = result->context->iterator->offset;
+		matches     = Match_isSuccess(result->match) ? Match_countAll(result->match) : 0;
+		if (best < 0 || elapsed < best) {best = elapsed;}
+		ParsingResult_free(result);
+	}
+
+	double mb = (double)bench.length / (1024.0 * 1024.0);
+	printf(
+		"{\"bench\":\"%s\",\"version\":\"%s\",\"size\":%zu,\"status\":\"%c\",\"parsed\":%zu,"
+		"\"seconds\":%.6f,\"mbps\":%.3f,\"matches\":%zu,\"matchesps\":%.0f,\"rss\":%zu,\"allocations\":%zu}\n",
+		name, __PARSING_VERSION__, bench.length, status, parsed,
+		best, best > 0 ? mb / best : 0, matches, best > 0 ? matches / best : 0, Bench_peakRSS(), allocations
+	);
+	free(bench.text);
+	return status == STATUS_SUCCESS && parsed == bench.length ? 0 : 1;
+}
+
+#endif
+// EOF
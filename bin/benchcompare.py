@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+import json, sys
+
+__doc__ = """
+`benchcompare` compares two outputs of `make bench` and reports, for each
+benchmark and corpus size, the ratio of the new measures to the old ones.
+It exits with a non-zero status if the throughput decreased (or the peak RSS
+or allocations increased) by more than the given tolerance (10% by default).
+
+```bash
+make bench ; cp dist/bench.json bench-0.9.2.json
+# ... some changes later
+make bench ; ./bin/benchcompare.py bench-0.9.2.json dist/bench.json
+```
+"""
+
+# The measures that we compare, and whether higher is better
+MEASURES = (
+	("mbps",        True),
+	("matchesps",   True),
+	("rss",         False),
+	("allocations", False),
+)
+
+def load( path ):
+	res = {}
+	with open(path) as f:
+		for line in f:
+			line = line.strip()
+			if line:
+				row = json.loads(line)
+				res[(row["bench"], row["size"])] = row
+	return res
+
+def compare( previous, current, tolerance=0.10 ):
+	regressions = 0
+	for key in sorted(current):
+		if key not in previous:
+			continue
+		a, b  = previous[key], current[key]
+		cells = []
+		for name, higher in MEASURES:
+			ratio = (float(b[name]) / a[name]) if a[name] else 1.0
+			worse = (ratio < 1.0 - tolerance) if higher else (ratio > 1.0 + tolerance)
+			regressions += 1 if worse else 0
+			cells.append("{0}={1:.2f}{2}".format(name, ratio, "!" if worse else ""))
+		print("{0:8s} {1:>10d}  {2}".format(key[0], key[1], "  ".join(cells)))
+	return regressions
+
+if __name__ == "__main__":
+	if len(sys.argv) < 3:
+		sys.stderr.write(__doc__)
+		sys.exit(2)
+	tolerance = float(sys.argv[3]) if len(sys.argv) > 3 else 0.10
+	sys.exit(1 if compare(load(sys.argv[1]), load(sys.argv[2]), tolerance) else 0)
+
+# EOF
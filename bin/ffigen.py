@@ -17,14 +17,23 @@ cdef = (
 	"typedef struct ParsingStats   ParsingStats;\n"
 	"typedef struct ParsingContext ParsingContext;\n"
 	"typedef struct Match Match;\n"
+	"typedef struct MatchTree MatchTree;\n"
 	"typedef struct Grammar Grammar;\n"
 	"typedef struct TokenMatchGroup TokenMatchGroup;\n"
+	"typedef struct Arena Arena;\n"
+	"typedef struct Iterator Iterator;\n"
+	"typedef struct MappedInput MappedInput;\n"
 ) + clib.getCode(
 	("ConditionCallback",      None),
 	("ProcedureCallback",      None),
 	("ContextCallback",        None),
 	("ElementWalkingCallback", None),
 	("MatchWalkingCallback",   None),
+	("MatchTreeWalkingCallback", None),
+	("ParsingSplitCallback",   None),
+	("OutputSink",             None),
+	("Arena*",                 O),
+	("Output*",                O),
 	("Element*",               O),
 	("Reference*",             O),
 	("Match*",                 O),
@@ -14,6 +14,8 @@
 
 #define MATCH_STATS(m) ParsingContext_registerMatch(context, (Element*)this, m)
 #define ANONYMOUS      "unnamed"
+#define FIRST_ADD(s,c) (s)->bytes[((unsigned char)(c)) >> 3] |= (1 << (((unsigned char)(c)) & 7))
+#define FIRST_HAS(s,c) ((s)->bytes[((unsigned char)(c)) >> 3] & (1 << (((unsigned char)(c)) & 7)))
 
 // SEE: https://en.wikipedia.org/wiki/C_data_types
 // SEE: http://stackoverflow.com/questions/18329532/pcre-is-not-matching-utf8-characters
@@ -44,63 +46,6 @@ const char* INDENT       = "
 #define     OUT_STEP(msg,...)          OUT_IF(context->grammar->isVerbose && !HAS_FLAG(context->flags, FLAG_SKIPPING), msg, __VA_ARGS__)
 #define     OUT_STEP_IF(cond,msg,...)  OUT_IF(context->grammar->isVerbose && !HAS_FLAG(context->flags, FLAG_SKIPPING) && cond, msg, __VA_ARGS__)
 
-// ----------------------------------------------------------------------------
-//
-// TOOLS
-//
-// ----------------------------------------------------------------------------
-
-char* String_escape(const char* string) {
-	const char* p = string;
-	int   n = 0;
-	int   l = 0;
-	while (*p != '\0') {
-		switch(*p) {
-			case '\n':
-			case '\t':
-			case '\r':
-			case '"':
-				n++;
-			default:
-				l++;
-		}
-		p++;
-	}
-	char* res = malloc(l + n + 1);
-	p = string;
-	n = 0;
-	l = 0;
-	while (*p != '\0') {
-		char c = *p;
-		switch(c) {
-			case '\n':
-				res[l   + n++] = '\\';
-				res[l++ + n]   = 'n';
-				break;
-			case '\t':
-				res[l   + n++] = '\\';
-				res[l++ + n]   = 't';
-				break;
-			case '\r':
-				res[l   + n++] = '\\';
-				res[l++ + n]   = 'r';
-				break;
-			case '"':
-				res[l   + n++] = '\\';
-				res[l++ + n]   = '"';
-				break;
-			default:
-				res[l + n] = c;
-				l++;
-		}
-		p++;
-	}
-	res[l + n] = '\0';
-	return res;
-}
-
-
-
 // ----------------------------------------------------------------------------
 //
 // ITERATOR
@@ -130,6 +75,62 @@ Iterator* Iterator_FromString(const char* text) {
 	return this;
 }
 
+Iterator* Iterator_Stream(const char* path, size_t window) {
+	Iterator* result = Iterator_Open(path);
+	if (result != NULL) {
+		// The buffer is grown up to the window on the first reads, and then
+		// slides over the input.
+		result->window = window;
+	}
+	return result;
+}
+
+Iterator* Iterator_Map(const char* path) {
+	NEW(MappedInput, input, path);
+	if (input == NULL) {return NULL;}
+	NEW(Iterator, this);
+	// The mapped data works like a string, as it is contiguous and followed
+	// by a `\0`.
+	this->input      = (void*)input;
+	this->freeInput  = MappedInput_free;
+	this->buffer     = (char*)input->data;
+	this->current    = (char*)input->data;
+	this->capacity   = input->length;
+	this->available  = input->length;
+	this->move       = String_move;
+	return this;
+}
+
+Iterator* Iterator_FromSlice(const char* text, size_t start, size_t end) {
+	NEW(Iterator, this);
+	if (this!=NULL) {
+		// The slice works like a string that ends at `end`, which we then
+		// move to `start`.
+		this->buffer     = (char*)text;
+		this->current    = (char*)text;
+		this->capacity   = end;
+		this->available  = end;
+		this->move       = String_move;
+		this->move(this, start);
+	}
+	return this;
+}
+
+Iterator* Iterator_Push(void) {
+	NEW(PushInput, input, 1);
+	NEW(Iterator, this);
+	// The fed data works like a string, as it is contiguous and followed
+	// by a `\0`, the buffer growing as data is fed.
+	__ARRAY_NEW(buffer, char, input->size);
+	this->input      = (void*)input;
+	this->freeInput  = PushInput_free;
+	this->buffer     = buffer;
+	this->current    = buffer;
+	this->freeBuffer = TRUE;
+	this->move       = String_move;
+	return this;
+}
+
 Iterator* Iterator_new( void ) {
 	__NEW(Iterator, this);
 	this->status        = STATUS_INIT;
@@ -137,13 +138,16 @@ Iterator* Iterator_new( void ) {
 	this->buffer        = NULL;
 	this->current       = NULL;
 	this->offset        = 0;
-	this->lines         = 0;
+	this->lineIndex     = NULL;
 	this->available     = 0;
 	this->capacity      = 0;
 	this->input         = NULL;
 	this->freeInput     = NULL;
 	this->move          = NULL;
 	this->freeBuffer    = FALSE;
+	this->window        = 0;
+	this->committed     = 0;
+	this->truncated     = FALSE;
 	return this;
 }
 
@@ -163,6 +167,10 @@ void Iterator_free( Iterator* this ) {
 	if (this->freeBuffer) {
 		__FREE(this->buffer);
 	}
+	if (this->lineIndex != NULL) {
+		__FREE(this->lineIndex->offsets);
+		__FREE(this->lineIndex);
+	}
 	__FREE(this);
 }
 
@@ -219,17 +227,99 @@ bool Iterator_moveTo ( Iterator* this, size_t offset ) {
 	return this->move(this, offset - this->offset );
 }
 
-bool Iterator_backtrack ( Iterator* this, size_t offset, size_t lines ) {
+bool Iterator_backtrack ( Iterator* this, size_t offset ) {
 	assert(offset <= this->offset);
-	assert(lines  <= this->lines);
-	this->lines = lines;
 	return this->move(this, offset - this->offset );
 }
 
+void Iterator__indexLines ( Iterator* this, size_t offset ) {
+	if (this->lineIndex == NULL) {
+		__NEW(LineIndex, index);
+		__ARRAY_NEW(offsets, size_t, LINE_INDEX_CAPACITY);
+		index->offsets   = offsets;
+		index->base      = 0;
+		index->count     = 0;
+		index->capacity  = LINE_INDEX_CAPACITY;
+		index->scanned   = 0;
+		index->cursor    = 0;
+		this->lineIndex  = index;
+	}
+	LineIndex* index = this->lineIndex;
+	if (offset <= index->scanned) {return;}
+	// We scan all the available data at once, as `memchr` is much faster
+	// than stepping through the characters.
+	size_t      start = Iterator_bufferOffset(this);
+	assert(index->scanned >= start);
+	const char* p     = this->buffer + (index->scanned - start);
+	const char* end   = this->buffer + this->available;
+	while (p < end && (p = (const char*)memchr(p, this->separator, end - p)) != NULL) {
+		if (index->count == index->capacity) {
+			index->capacity *= 2;
+			__RESIZE(index->offsets, sizeof(size_t) * index->capacity);
+		}
+		index->offsets[index->count++] = start + (p - this->buffer);
+		p++;
+	}
+	index->scanned = start + this->available;
+}
+
+// Returns the index of the first separator at or after the offset
+size_t LineIndex__find ( LineIndex* this, size_t offset ) {
+	size_t lo = 0;
+	size_t hi = this->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (this->offsets[mid] < offset) {lo = mid + 1;} else {hi = mid;}
+	}
+	return lo;
+}
+
+// Drops the offsets of the separators before the given offset, as the
+// input before it is discarded, counting them in the index's base.
+void Iterator__trimLines ( Iterator* this, size_t offset ) {
+	Iterator__indexLines(this, offset);
+	LineIndex* index = this->lineIndex;
+	size_t     n     = LineIndex__find(index, offset);
+	if (n == 0) {return;}
+	memmove(index->offsets, index->offsets + n, sizeof(size_t) * (index->count - n));
+	index->base  += n;
+	index->count -= n;
+	index->cursor = index->cursor > n ? index->cursor - n : 0;
+}
+
+size_t Iterator_lineAt ( Iterator* this, size_t offset ) {
+	Iterator__indexLines(this, offset);
+	LineIndex* index = this->lineIndex;
+	size_t*    o     = index->offsets;
+	size_t     c     = index->cursor;
+	// The line is the number of separators before the offset, we first
+	// check if it is the same as the last lookup, and otherwise look for
+	// the first separator at or after the offset.
+	if (!((c == 0 || o[c - 1] < offset) && (c == index->count || o[c] >= offset))) {
+		c             = LineIndex__find(index, offset);
+		index->cursor = c;
+	}
+	return index->base + c;
+}
+
+size_t Iterator_getLine ( Iterator* this ) {
+	return Iterator_lineAt(this, this->offset);
+}
+
 char Iterator_charAt ( Iterator* this, size_t offset ) {
-	assert(this->offset == (this->current - this->buffer));
-	assert(offset <= this->available);
-	return (char)(this->buffer[offset]);
+	size_t start = Iterator_bufferOffset(this);
+	assert(offset >= start);
+	assert(offset - start <= this->available);
+	return (char)(this->buffer[offset - start]);
+}
+
+size_t Iterator_bufferOffset ( Iterator* this ) {
+	return this->offset - (this->current - this->buffer);
+}
+
+void Iterator_commit ( Iterator* this, size_t offset ) {
+	offset = MIN(offset, this->offset);
+	if (offset > this->committed) {this->committed = offset;}
 }
 
 
@@ -255,13 +345,10 @@ bool String_move ( Iterator* this, int n ) {
 		// `c` is the number of elements we're actually agoing to move, which
 		// is either `n` or the number of elements left.
 		size_t c    = n <= left ? n : left;
-		// This iterates throught the characters and counts line separators.
-		while (c > 0) {
-			this->current++;
-			this->offset++;
-			if (*(this->current) == this->separator) {this->lines++;}
-			c--;
-		}
+		// Lines are looked up from the offset, so there's no need to
+		// step through the characters.
+		this->current += c;
+		this->offset  += c;
 		// We then store the amount of available
 		left = this->available - this->offset;
 		// DEBUG("String_move: moved forward by c=%zu, n=%d offset=%zu capacity=%zu, available=%zu, current-buffer=%ld", c_copy, n, this->offset, this->capacity, this->available, this->current - this->buffer);
@@ -327,34 +414,55 @@ size_t FileInput_preload( Iterator* this ) {
 	size_t       left          = this->available - read;
 	size_t       until_eob     = this->capacity  - read;
 	DEBUG("FileInput_preload: %zu read, %zu available/%zu buffer capacity [%c]", read, this->available, this->capacity, this->status);
-	assert (left < this->capacity);
+	assert (left <= this->capacity);
 	// Do the number of bytes up until the end of the buffer is less than
 	// ITERATOR_BUFFER_AHEAD, then we need to expand the the buffer and make
 	// sure we have ITERATOR_BUFFER_AHEAD data, unless we reach the end of the
 	// input stream.
 	if ( (this->available == 0 || until_eob < ITERATOR_BUFFER_AHEAD) && this->status != STATUS_INPUT_ENDED) {
-		// We move buffer[current:] to the begining of the buffer
-		// FIXME: We should make sure we don't call preload each time
-		// memmove((void*)this->buffer, (void*)this->current, left);
-		size_t delta    = this->current - this->buffer;
-		// We want to grow the buffer size by ITERATOR_BUFFER_AHEAD
-		this->capacity += ITERATOR_BUFFER_AHEAD;
-		// This assertion is a bit weird, but it does not hurt
-		assert(this->capacity + 1 > 0);
-		DEBUG("<<< FileInput: growing buffer to %zu", this->capacity + 1)
-		// FIXME: Not sure that realloc is a good idea, as any previous pointer
-		// to the buffer would change...
-		__RESIZE(this->buffer, this->capacity + 1);
-		assert(this->buffer != NULL);
-		// We need to update the current pointer as the buffer has changed
-		this->current = this->buffer + delta;
-		// We make sure we add a trailing \0 to the buffer
-		this->buffer[this->capacity] = '\0';
+		// When the iterator has a window, we first discard the input that
+		// was committed or that is further behind than the window, by moving
+		// what remains to the beginning of the buffer.
+		if (this->window > 0) {
+			size_t start     = this->offset - read;
+			size_t keep      = this->offset > this->window ? this->offset - this->window : 0;
+			size_t committed = MIN(this->committed, this->offset);
+			if (committed > keep) {keep = committed;}
+			if (keep > start) {
+				size_t discard = keep - start;
+				// The lines of the discarded input need to be counted first
+				Iterator__trimLines(this, keep);
+				DEBUG("<<< FileInput: discarding %zu bytes before %zu", discard, keep)
+				memmove((void*)this->buffer, (void*)(this->buffer + discard), this->available - discard);
+				this->available -= discard;
+				this->current   -= discard;
+				read            -= discard;
+				until_eob        = this->capacity - read;
+			}
+		}
+		if (until_eob < ITERATOR_BUFFER_AHEAD) {
+			size_t delta    = this->current - this->buffer;
+			// We want to grow the buffer size by ITERATOR_BUFFER_AHEAD
+			this->capacity += ITERATOR_BUFFER_AHEAD;
+			// This assertion is a bit weird, but it does not hurt
+			assert(this->capacity + 1 > 0);
+			DEBUG("<<< FileInput: growing buffer to %zu", this->capacity + 1)
+			// NOTE: Pointers to the buffer change, which is why matches only
+			// store offsets.
+			__RESIZE(this->buffer, this->capacity + 1);
+			assert(this->buffer != NULL);
+			// We need to update the current pointer as the buffer has changed
+			this->current = this->buffer + delta;
+			// We make sure we add a trailing \0 to the buffer
+			this->buffer[this->capacity] = '\0';
+		}
 		// We want to read as much as possible so that we fill the buffer
-		size_t to_read         = this->capacity - left;
+		size_t to_read         = this->capacity - this->available;
 		size_t read            = fread((char*)this->buffer + this->available, sizeof(char), to_read, input->file);
 		this->available        += read;
 		left                   += read;
+		// We terminate the data, as what follows might be discarded input
+		this->buffer[this->available] = '\0';
 		DEBUG("<<< FileInput: read %zu bytes from input, available %zu, remaining %zu", read, this->available, Iterator_remaining(this));
 		assert(Iterator_remaining(this) == left);
 		assert(Iterator_remaining(this) >= read);
@@ -377,13 +485,8 @@ bool FileInput_move   ( Iterator* this, int n ) {
 		if (left > 0) {
 			int c = n > left ? left : n;
 			// We have enough space left in the buffer to read at least one character.
-			// We increase the head, copy
-			while (c > 0) {
-				this->current++;
-				this->offset++;
-				if (*(this->current) == this->separator) {this->lines++;}
-				c--;
-			}
+			this->current += c;
+			this->offset  += c;
 			DEBUG("[>] %d+%d == %zu (%zu bytes left)", ((int)this->offset) - n, n, this->offset, left);
 			if (n>left) {
 				this->status = STATUS_INPUT_ENDED;
@@ -398,11 +501,16 @@ bool FileInput_move   ( Iterator* this, int n ) {
 			return FALSE;
 		}
 	} else {
-		// The assert below is temporary, once we figure out when to free the input data
-		// that we don't need anymore this would work.
-		ASSERT(this->capacity > this->offset, "FileInput_move: offset is greater than capacity (%zu > %zu)", this->offset, this->capacity)
-		// We make sure that `n` is not bigger than the length of the available buffer
-		n = ((int)this->capacity )+ n < 0 ? 0 - (int)this->capacity : n;
+		// We cannot move before the start of the buffer, which happens
+		// when backtracking further than the iterator's window.
+		size_t behind = this->current - this->buffer;
+		if ((size_t)(0 - n) > behind) {
+			if (!this->truncated) {
+				ERROR("FileInput_move: cannot backtrack to %zu, input before %zu was discarded", this->offset + n, this->offset - behind);
+			}
+			this->truncated = TRUE;
+			n = 0 - (int)behind;
+		}
 		this->current = (((char*)this->current) + n);
 		this->offset += n;
 		if (n!=0) {this->status  = STATUS_PROCESSING;}
@@ -412,6 +520,108 @@ bool FileInput_move   ( Iterator* this, int n ) {
 	}
 }
 
+// ----------------------------------------------------------------------------
+//
+// MAPPED INPUT
+//
+// ----------------------------------------------------------------------------
+
+MappedInput* MappedInput_new(const char* path ) {
+	__NEW(MappedInput, this);
+	assert(this != NULL);
+	this->path   = path;
+	this->data   = NULL;
+	this->length = 0;
+	this->size   = 0;
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0) {
+		ERROR("Cannot open file: %s", path);
+		if (fd >= 0) {close(fd);}
+		__FREE(this);
+		return NULL;
+	}
+	// We reserve at least one more byte than the file, so that the data
+	// is always followed by a `\0`: the anonymous mapping is zeroed, and
+	// so is the end of the last page of the file mapping.
+	size_t page  = (size_t)sysconf(_SC_PAGESIZE);
+	this->length = (size_t)info.st_size;
+	this->size   = (this->length / page + 1) * page;
+	void*  data  = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data != MAP_FAILED && this->length > 0) {
+		if (mmap(data, this->length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			munmap(data, this->size);
+			data = MAP_FAILED;
+		} else {
+			madvise(data, this->length, MADV_SEQUENTIAL);
+		}
+	}
+	close(fd);
+	if (data == MAP_FAILED) {
+		ERROR("Cannot map file: %s", path);
+		__FREE(this);
+		return NULL;
+	}
+	this->data = data;
+	return this;
+}
+
+void MappedInput_free(void* this) {
+	TRACE("MappedInput_free: %p", this)
+	MappedInput* self = (MappedInput*) this;
+	if (self != NULL && self->data != NULL) { munmap(self->data, self->size); }
+	__FREE(this);
+}
+
+// ----------------------------------------------------------------------------
+//
+// PUSH INPUT
+//
+// ----------------------------------------------------------------------------
+
+PushInput* PushInput_new(size_t size) {
+	__NEW(PushInput, this);
+	assert(this != NULL);
+	this->size   = size;
+	this->parsed = 0;
+	this->ended  = FALSE;
+	return this;
+}
+
+void PushInput_free(void* this) {
+	TRACE("PushInput_free: %p", this)
+	__FREE(this);
+}
+
+// Returns the push input of the given iterator, or NULL when it is not
+// a push iterator.
+PushInput* Iterator__pushInput( Iterator* this ) {
+	return this != NULL && this->freeInput == PushInput_free ? (PushInput*)this->input : NULL;
+}
+
+bool Iterator_feed ( Iterator* this, const char* data, size_t length ) {
+	PushInput* input = Iterator__pushInput(this);
+	if (input == NULL || input->ended) {return FALSE;}
+	if (this->available + length + 1 > input->size) {
+		size_t delta = this->current - this->buffer;
+		input->size  = MAX(input->size * 2, this->available + length + 1);
+		__RESIZE(this->buffer, input->size);
+		this->current = this->buffer + delta;
+	}
+	memcpy(this->buffer + this->available, data, length);
+	this->available += length;
+	this->buffer[this->available] = '\0';
+	// The input is a string whose length changes (see `String_move`)
+	this->capacity   = this->available;
+	if (length > 0 && this->status == STATUS_ENDED) {this->status = STATUS_PROCESSING;}
+	return TRUE;
+}
+
+void Iterator_end ( Iterator* this ) {
+	PushInput* input = Iterator__pushInput(this);
+	if (input != NULL) {input->ended = TRUE;}
+}
+
 // ----------------------------------------------------------------------------
 //
 // GRAMMAR
@@ -426,6 +636,18 @@ Grammar* Grammar_new(void) {
 	this->skipCount  = 0;
 	this->elements   = NULL;
 	this->isVerbose  = FALSE;
+	this->isTimed    = FALSE;
+	this->memoLimit  = 0;
+	this->budget     = 0;
+	this->first      = NULL;
+	this->wordSets      = NULL;
+	this->wordSetsCount = 0;
+	this->pool          = NULL;
+	this->optimize      = 0;
+	this->optimizations = NULL;
+	this->derivedCount  = 0;
+	this->engine        = ENGINE_RECURSIVE;
+	this->maxDepth      = 0;
 	return this;
 }
 
@@ -437,14 +659,67 @@ void Grammar_setSilent ( Grammar* this ) {
 	this->isVerbose = FALSE;
 }
 
+void Grammar_setTimed ( Grammar* this, bool timed ) {
+	this->isTimed = timed;
+}
+
+void Grammar_setMemoize ( Grammar* this, size_t limit ) {
+	this->memoLimit = limit;
+}
+
+void Grammar_setBudget ( Grammar* this, size_t budget ) {
+	this->budget = budget;
+}
+
+void Grammar_setEngine ( Grammar* this, char engine, size_t depth ) {
+	this->engine   = engine;
+	this->maxDepth = depth;
+}
+
+void Grammar_setOptimize ( Grammar* this, int passes ) {
+	this->optimize = passes;
+}
+
 int Grammar_symbolsCount(Grammar* this) {
 	return this->axiomCount + this->skipCount;
 }
 
+void Grammar__freeWordSets(Grammar* this) {
+	if (this->wordSets == NULL) {return;}
+	for (int i=0 ; i<this->wordSetsCount ; i++) {
+		WordSet_free(this->wordSets[i]);
+	}
+	__FREE(this->wordSets);
+	this->wordSets      = NULL;
+	this->wordSetsCount = 0;
+}
+
+// Gives their children back to the elements the optimizer changed, and
+// frees the elements it created.
+void Grammar__restore(Grammar* this) {
+	while (this->optimizations != NULL) {
+		Optimization* o      = this->optimizations;
+		o->element->children = o->children;
+		this->optimizations  = o->next;
+		__FREE(o);
+	}
+	int count = this->axiomCount + this->skipCount + 1;
+	for (int i=count - this->derivedCount ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (Reference_Is(e)) {Reference_free((Reference*)e);} else {ParsingElement_free((ParsingElement*)e);}
+		this->elements[i] = NULL;
+	}
+	this->axiomCount  -= this->derivedCount;
+	this->derivedCount = 0;
+}
+
 void Grammar_freeElements(Grammar* this) {
 	if (this->elements == NULL) {
 		Grammar_prepare(this);
 	}
+	if (this->elements != NULL) {
+		Grammar__restore(this);
+	}
 	int count = (this->axiomCount + this->skipCount);
 	if (this->elements != NULL) {
 		// NOTE: We iterate count so that we have count + 1
@@ -469,13 +744,247 @@ void Grammar_freeElements(Grammar* this) {
 	this->axiom      = NULL;
 	__FREE(this->elements);
 	this->elements = NULL;
+	__FREE(this->first);
+	this->first    = NULL;
+	Grammar__freeWordSets(this);
 }
 
 void Grammar_free(Grammar* this) {
+	Grammar_setPool(this, 0);
 	Grammar_freeElements(this);
 	__FREE(this);
 }
 
+// ----------------------------------------------------------------------------
+//
+// ARENA
+//
+// ----------------------------------------------------------------------------
+
+// NOTE: Allocations are aligned on pointers, which is enough for matches
+// and their data.
+#define ARENA_ALIGN(size) (((size) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
+ArenaBlock* ArenaBlock_new(size_t size) {
+	__NEW(ArenaBlock, this);
+	__ARRAY_NEW(data, char, size);
+	this->data = data;
+	this->size = size;
+	this->next = NULL;
+	return this;
+}
+
+Arena* Arena_new(void) {
+	__NEW(Arena, this);
+	this->first     = ArenaBlock_new(ARENA_BLOCK_SIZE);
+	this->current   = this->first;
+	this->offset    = 0;
+	this->allocated = this->first->size;
+	return this;
+}
+
+void Arena_free(Arena* this) {
+	if (this == NULL) {return;}
+	ArenaBlock* block = this->first;
+	while (block != NULL) {
+		ArenaBlock* next = block->next;
+		__FREE(block->data);
+		__FREE(block);
+		block = next;
+	}
+	__FREE(this);
+}
+
+void* Arena_alloc(Arena* this, size_t size) {
+	size = ARENA_ALIGN(size);
+	if (this->offset + size > this->current->size) {
+		// We reuse the next block if it's large enough (it would have been
+		// left there by a rewind), or insert a new one.
+		ArenaBlock* next = this->current->next;
+		if (next == NULL || next->size < size) {
+			ArenaBlock* block = ArenaBlock_new(size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+			block->next         = next;
+			this->current->next = block;
+			this->allocated    += block->size;
+			next                = block;
+		}
+		this->current = next;
+		this->offset  = 0;
+	}
+	void* ptr     = this->current->data + this->offset;
+	this->offset += size;
+	return ptr;
+}
+
+ArenaMark Arena_mark(Arena* this) {
+	ArenaMark mark = {this->current, this->offset};
+	return mark;
+}
+
+void Arena_rewind(Arena* this, ArenaMark mark) {
+	this->current = mark.block;
+	this->offset  = mark.offset;
+}
+
+void Arena_reset(Arena* this) {
+	if (this == NULL) {return;}
+	this->current = this->first;
+	this->offset  = 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+// OUTPUT
+//
+// ----------------------------------------------------------------------------
+
+Output* Output_new(void) {
+	__NEW(Output, this);
+	// We keep room for the NUL terminator of `Output_text`
+	__ARRAY_NEW(buffer, char, OUTPUT_BLOCK_SIZE + 1);
+	this->buffer   = buffer;
+	this->length   = 0;
+	this->capacity = OUTPUT_BLOCK_SIZE;
+	this->written  = 0;
+	this->fd       = -1;
+	this->sink     = NULL;
+	this->context  = NULL;
+	this->failed   = FALSE;
+	return this;
+}
+
+Output* Output_ToFile(int fd) {
+	Output* this = Output_new();
+	this->fd     = fd;
+	return this;
+}
+
+Output* Output_ToSink(OutputSink sink, void* context) {
+	Output* this  = Output_new();
+	this->sink    = sink;
+	this->context = context;
+	return this;
+}
+
+void Output_free(Output* this) {
+	if (this != NULL) {
+		Output_flush(this);
+		__FREE(this->buffer);
+	}
+	__FREE(this);
+}
+
+bool Output__isFlushed(Output* this) {
+	return this->fd >= 0 || this->sink != NULL;
+}
+
+// Sends the data to the file descriptor or sink, unless a previous
+// flush failed.
+void Output__send(Output* this, const char* data, size_t length) {
+	if (this->failed || length == 0) {return;}
+	if (this->sink != NULL) {
+		this->failed = !this->sink(data, length, this->context);
+	} else {
+		size_t offset = 0;
+		while (offset < length) {
+			ssize_t n = write(this->fd, data + offset, length - offset);
+			if (n < 0 && errno == EINTR) {continue;}
+			if (n <= 0) {this->failed = TRUE; break;}
+			offset += (size_t)n;
+		}
+	}
+	if (!this->failed) {this->written += length;}
+}
+
+// Makes room for `length` more bytes, flushing the buffer or growing it.
+void Output__reserve(Output* this, size_t length) {
+	if (this->length + length <= this->capacity) {return;}
+	if (Output__isFlushed(this)) {
+		Output_flush(this);
+		if (length <= this->capacity) {return;}
+	}
+	size_t capacity = this->capacity;
+	while (capacity < this->length + length) {capacity *= 2;}
+	size_t allocated = capacity + 1;
+	__ARRAY_RESIZE(this->buffer, char, allocated);
+	this->capacity = capacity;
+}
+
+void Output_write(Output* this, const char* data, size_t length) {
+	if (length > this->capacity && Output__isFlushed(this)) {
+		// Writes larger than a block are sent as they are
+		Output_flush(this);
+		Output__send(this, data, length);
+	} else {
+		Output__reserve(this, length);
+		memcpy(this->buffer + this->length, data, length);
+		this->length += length;
+	}
+}
+
+void Output_writeString(Output* this, const char* string) {
+	Output_write(this, string, strlen(string));
+}
+
+void Output_writef(Output* this, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(this->buffer + this->length, this->capacity + 1 - this->length, format, args);
+	va_end(args);
+	if (length < 0) {return;}
+	if (this->length + (size_t)length > this->capacity) {
+		// The text did not fit, so we make room and format it again
+		Output__reserve(this, (size_t)length);
+		va_start(args, format);
+		vsnprintf(this->buffer + this->length, this->capacity + 1 - this->length, format, args);
+		va_end(args);
+	}
+	this->length += (size_t)length;
+}
+
+void Output_writeEscaped(Output* this, const char* data, size_t length) {
+	// Each byte is escaped in at most two bytes, so we reserve room for the
+	// whole escaped data upfront when it fits in a block.
+	size_t i = 0;
+	while (i < length) {
+		size_t n = MIN(length - i, this->capacity / 2);
+		Output__reserve(this, n * 2);
+		char* p = this->buffer + this->length;
+		for (size_t j=i ; j < i + n ; j++) {
+			char c = data[j];
+			switch(c) {
+				case '\n': *p++ = '\\'; *p++ = 'n'; break;
+				case '\t': *p++ = '\\'; *p++ = 't'; break;
+				case '\r': *p++ = '\\'; *p++ = 'r'; break;
+				case '"':  *p++ = '\\'; *p++ = '"'; break;
+				case '\\': *p++ = '\\'; *p++ = '\\'; break;
+				default:   *p++ = c;
+			}
+		}
+		this->length = (size_t)(p - this->buffer);
+		i += n;
+	}
+}
+
+bool Output_flush(Output* this) {
+	if (Output__isFlushed(this)) {
+		Output__send(this, this->buffer, this->length);
+		this->length = 0;
+	}
+	return !this->failed;
+}
+
+const char* Output_text(Output* this) {
+	this->buffer[this->length] = '\0';
+	return this->buffer;
+}
+
+// The writers below go through an `Output` named `output`, as `WRITE` and
+// `WRITEF` go through a file descriptor named `fd`.
+#define OUTPUT_WRITEF(m,...)  Output_writef(output,m,__VA_ARGS__)
+#define OUTPUT_WRITE(m)       Output_writeString(output,m)
+#define OUTPUT_ESCAPED(s,l)   Output_writeEscaped(output,s,(size_t)(l))
+
 // ----------------------------------------------------------------------------
 //
 // MATCH
@@ -483,13 +992,14 @@ void Grammar_free(Grammar* this) {
 // ----------------------------------------------------------------------------
 
 Match* Match__Success(size_t length, Element* element, ParsingContext* context) {
-	NEW(Match,this);
+	Match* this = context->arena != NULL ? Match_FromArena(context->arena) : Match_new();
 	assert( element != NULL );
 	this->status   = STATUS_MATCHED;
 	this->offset   = context->iterator->offset;
 	this->length   = length;
-	// FIXME: This should be the original line offset
-	this->line     = context->iterator->lines;
+	// The line is looked up when requested, but for the input that the
+	// window might discard, along with its lines (see `Match_getLine`).
+	this->line     = context->iterator->window > 0 ? Iterator_getLine(context->iterator) : SIZE_MAX;
 	this->element  = (Element*)element;
 	this->data     = NULL;
 	this->next     = NULL;
@@ -510,9 +1020,26 @@ Match* Match_new(void) {
 	__NEW(Match,this);
 	// DEBUG("Allocating match: %p", this);
 	this->status    = STATUS_INIT;
+	this->flags     = 0;
+	this->offset    = 0;
+	this->length    = 0;
+	this->line      = SIZE_MAX;
+	this->element   = NULL;
+	this->data      = NULL;
+	this->next      = NULL;
+	this->children  = NULL;
+	this->parent    = NULL;
+	this->result    = NULL;
+	return this;
+}
+
+Match* Match_FromArena(Arena* arena) {
+	Match* this     = (Match*)Arena_alloc(arena, sizeof(Match));
+	this->status    = STATUS_INIT;
+	this->flags     = MATCH_ARENA;
 	this->offset    = 0;
 	this->length    = 0;
-	this->line      = 0;
+	this->line      = SIZE_MAX;
 	this->element   = NULL;
 	this->data      = NULL;
 	this->next      = NULL;
@@ -522,10 +1049,10 @@ Match* Match_new(void) {
 	return this;
 }
 
-// TODO: We might want to recycle the objects for better performance and
-// fewer allocs.
 void* Match_free(Match* this) {
-	if (this!=NULL && this!=FAILURE) {
+	// Arena matches (and whatever they reference) are released along with
+	// their arena, so there's nothing to do here.
+	if (this!=NULL && this!=FAILURE && !HAS_FLAG(this->flags, MATCH_ARENA)) {
 		TRACE("Match_free(%c:%d@%s,%lu-%lu):%p", ((ParsingElement*)this->element)->type, ((ParsingElement*)this->element)->id, ((ParsingElement*)this->element)->name, this->offset, this->offset + this->length, this)
 
 		// We free the children
@@ -568,6 +1095,57 @@ void* Match_fail( Match* this ) {
 	return FAILURE;
 }
 
+// Copies the match as `Match_copy` does, shifting the offsets and lines
+// of the copy by the given deltas. When `context` is set, the token matches
+// of the copy refer to it (see `Memo_reuse`).
+Match* Match__copy( Match* this, Arena* arena, size_t* bytes, ParsingContext* context, long shift, int lines ) {
+	if (this == NULL || this == FAILURE) {return this;}
+	Match* copy    = arena != NULL ? Match_FromArena(arena) : Match_new();
+	copy->status   = this->status;
+	copy->offset   = (size_t)((long)this->offset + shift);
+	copy->length   = this->length;
+	copy->line     = this->line == SIZE_MAX ? SIZE_MAX : (size_t)((long)this->line + lines);
+	copy->element  = this->element;
+	if (bytes != NULL) {*bytes += sizeof(Match);}
+	// Only tokens attach data to their matches, which we need to copy
+	// as it is freed along with the match.
+	if (this->data != NULL && Match_getElementType(this) == TYPE_TOKEN) {
+		TokenMatch* data = TokenMatch_copy(this, arena);
+		if (bytes != NULL) {*bytes += sizeof(TokenMatch) + sizeof(TokenMatchGroup) * data->count;}
+		for (int i=0 ; bytes != NULL && data->owned && i<data->count ; i++) {
+			*bytes += sizeof(const char*) + data->spans[i].length + 1;
+		}
+		for (int i=0 ; shift != 0 && i<data->count ; i++) {
+			data->spans[i].offset = (size_t)((long)data->spans[i].offset + shift);
+		}
+		// The group strings belong to the previous context, unless the
+		// copy owns them.
+		if (context != NULL && data->context != context) {
+			data->context = context;
+			if (!data->owned) {data->groups = NULL;}
+		}
+		copy->data = data;
+	} else {
+		copy->data = this->data;
+	}
+	// We copy the children, preserving their order
+	Match* child = this->children;
+	Match* last  = NULL;
+	while (child != NULL) {
+		Match* c = Match__copy(child, arena, bytes, context, shift, lines);
+		if (last == NULL) {copy->children = c;}
+		else              {last->next     = c;}
+		c->parent = copy;
+		last  = c;
+		child = child->next;
+	}
+	return copy;
+}
+
+Match* Match_copy( Match* this, Arena* arena, size_t* bytes ) {
+	return Match__copy(this, arena, bytes, NULL, 0, 0);
+}
+
 ParsingElement* Match_getParsingElement( Match* this ) {
 	return ParsingElement_Ensure(this->element);
 }
@@ -612,6 +1190,12 @@ int Match_getOffset(Match *this) {
 	return (int)this->offset;
 }
 
+size_t Match_getLine(Match* this, Iterator* iterator) {
+	if (this == NULL || this == FAILURE) {return SIZE_MAX;}
+	if (this->line == SIZE_MAX && iterator != NULL) {this->line = Iterator_lineAt(iterator, this->offset);}
+	return this->line;
+}
+
 int Match_getLength(Match *this) {
 	if (this == NULL) {return 0;}
 	return (int)this->length;
@@ -627,12 +1211,16 @@ bool Match_isSuccess(Match* this) {
 }
 
 int Match__walk(Match* this, MatchWalkingCallback callback, int step, void* context ){
-	step = callback(this, step, context);
-	if (this->children != NULL && step >= 0) {
-		step = Match__walk(this->children, callback, step + 1, context);
-	}
-	if (this->next != NULL && step >= 0) {
-		step = Match__walk(this->next, callback, step + 1, context);
+	// We only recurse on the children, so that the stack grows with the
+	// depth of the tree rather than with the number of siblings.
+	while (TRUE) {
+		step = callback(this, step, context);
+		if (this->children != NULL && step >= 0) {
+			step = Match__walk(this->children, callback, step + 1, context);
+		}
+		if (this->next == NULL || step < 0) {break;}
+		this  = this->next;
+		step += 1;
 	}
 	return step;
 }
@@ -677,15 +1265,16 @@ int Match_countChildren(Match* this) {
 // ============================================================================
 
 
-#define JSON_ELEMENT_START(e) if (e->name) {WRITE("{\"name\":\"");WRITE(e->name);WRITE("\"");} else {WRITE("{\"id\":");WRITEF("%d",e->id);}
-#define JSON_ELEMENT_END(e)   WRITE("}")
+#define JSON_ELEMENT_START(e) if (e->name) {OUTPUT_WRITE("{\"name\":\"");OUTPUT_WRITE(e->name);OUTPUT_WRITE("\"");} else {OUTPUT_WRITE("{\"id\":");OUTPUT_WRITEF("%d",e->id);}
+#define JSON_ELEMENT_END(e)   OUTPUT_WRITE("}")
+#define JSON_GROUP(m,i)       OUTPUT_ESCAPED(TokenMatch_groupStart(m,i), TokenMatch_groupLength(m,i))
 
-void Match__childrenWriteJSON(Match* match, int fd, int flags) {
+void Match__childrenWriteJSON(Match* match, Output* output, int flags) {
 	int count = 0 ;
 	Match* child = match->children;
 	while (child != NULL) {
 		ParsingElement* element = ParsingElement_Ensure(child->element);
-		if (element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION) {
+		if (element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION && element->type != TYPE_CUT) {
 			count += 1;
 		}
 		child = child->next;
@@ -694,10 +1283,10 @@ void Match__childrenWriteJSON(Match* match, int fd, int flags) {
 	int i = 0;
 	while (child != NULL) {
 		ParsingElement* element = ParsingElement_Ensure(child->element);
-		if (element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION) {
-			Match__writeJSON(child, fd, flags);
+		if (element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION && element->type != TYPE_CUT) {
+			Match__writeJSON(child, output, flags);
 			if ( (i+1) < count ) {
-				WRITE(",");
+				OUTPUT_WRITE(",");
 			}
 			i += 1;
 		}
@@ -705,9 +1294,9 @@ void Match__childrenWriteJSON(Match* match, int fd, int flags) {
 	}
 }
 
-void Match__writeJSON(Match* match, int fd, int flags) {
+void Match__writeJSON(Match* match, Output* output, int flags) {
 	if (match == NULL || match->element == NULL) {
-		WRITE("null");
+		OUTPUT_WRITE("null");
 		return;
 	}
 
@@ -716,25 +1305,22 @@ void Match__writeJSON(Match* match, int fd, int flags) {
 	if (element->type == TYPE_REFERENCE) {
 		Reference* ref = (Reference*)match->element;
 		if (ref->cardinality == CARDINALITY_ONE || ref->cardinality == CARDINALITY_NOT_EMPTY || ref->cardinality == CARDINALITY_OPTIONAL) {
-			Match__writeJSON(match->children, fd, flags);
+			Match__writeJSON(match->children, output, flags);
 		} else {
-			WRITE("[");
-			Match__childrenWriteJSON(match, fd, flags);
-			WRITE("]");
+			OUTPUT_WRITE("[");
+			Match__childrenWriteJSON(match, output, flags);
+			OUTPUT_WRITE("]");
 		}
 	}
 	else if (element->type != TYPE_REFERENCE) {
 		//printf("{\"type\":\"%c\",\"name\":%s,\"start\":%l ,\"length\":%l ,\"value\":", element->type, element->name, match->offset, match->length);
 		int i     = 0;
 		int count = 0;
-		char* word = NULL;
 		switch(element->type) {
 			case TYPE_WORD:
-				word = String_escape(Word_word(element));
 				JSON_ELEMENT_START(element);
-				WRITE(",\"value\":\"");WRITE(word);WRITE("\"");
+				OUTPUT_WRITE(",\"value\":\"");OUTPUT_ESCAPED(Word_word(element), strlen(Word_word(element)));OUTPUT_WRITE("\"");
 				JSON_ELEMENT_END(element);
-				free(word);
 				break;
 			case TYPE_TOKEN:
 				count = TokenMatch_count(match);
@@ -743,20 +1329,16 @@ void Match__writeJSON(Match* match, int fd, int flags) {
 					JSON_ELEMENT_END(element);
 				} else if (count == 1) {
 					JSON_ELEMENT_START(element);
-					word = String_escape(TokenMatch_group(match, 0));
-					WRITE(",\"value\":\"");WRITE(word);WRITE("\"");
-					free(word);
+					OUTPUT_WRITE(",\"value\":\"");JSON_GROUP(match, 0);OUTPUT_WRITE("\"");
 					JSON_ELEMENT_END(element);
 				} else {
 					JSON_ELEMENT_START(element);
-					WRITE(",\"content\":[");
+					OUTPUT_WRITE(",\"content\":[");
 					for (i=0 ; i < count ; i++) {
-						word = String_escape(TokenMatch_group(match, i));
-						WRITE("\"");WRITE(word);WRITE("\"");
-						if (i+1 < count) {WRITE(",");}
-						free(word);
+						OUTPUT_WRITE("\"");JSON_GROUP(match, i);OUTPUT_WRITE("\"");
+						if (i+1 < count) {OUTPUT_WRITE(",");}
 					}
-					WRITE("]");
+					OUTPUT_WRITE("]");
 					JSON_ELEMENT_END(element);
 				}
 				break;
@@ -767,9 +1349,9 @@ void Match__writeJSON(Match* match, int fd, int flags) {
 					JSON_ELEMENT_END(element);
 				} else {
 					JSON_ELEMENT_START(element);
-					WRITE(",\"content\":[");
-					Match__childrenWriteJSON(match, fd, flags);
-					WRITE("]");
+					OUTPUT_WRITE(",\"content\":[");
+					Match__childrenWriteJSON(match, output, flags);
+					OUTPUT_WRITE("]");
 					JSON_ELEMENT_END(element);
 				}
 				break;
@@ -777,16 +1359,24 @@ void Match__writeJSON(Match* match, int fd, int flags) {
 				break;
 			case TYPE_CONDITION:
 				break;
+			case TYPE_CUT:
+				break;
 			default:
-				WRITEF("\"ERROR:undefined element type=%c\"", element->type);
+				OUTPUT_WRITEF("\"ERROR:undefined element type=%c\"", element->type);
 		}
 	} else {
-		WRITEF("\"ERROR:unsupported element type=%c\"", element->type);
+		OUTPUT_WRITEF("\"ERROR:unsupported element type=%c\"", element->type);
 	}
 }
 
+void Match_outputJSON(Match* this, Output* output) {
+	Match__writeJSON(this, output, 0);
+}
+
 void Match_writeJSON(Match* this, int fd) {
-	Match__writeJSON(this, fd, 0);
+	Output* output = Output_ToFile(fd);
+	Match__writeJSON(this, output, 0);
+	Output_free(output);
 }
 
 
@@ -798,17 +1388,18 @@ void Match_printJSON(Match* this) {
 // XML FORMATTING
 // ============================================================================
 
-#define WRITE_ELEMENT_NAME(e)  if (e->name != NULL) { WRITE(e->name); } else {WRITEF("E%d", e->id);}
-#define WRITE_ELEMENT_START(e) if (e->name != NULL) {WRITE("<")  ; WRITE_ELEMENT_NAME(e) ; WRITE(">");}
-#define WRITE_ELEMENT_END(e)   if (e->name != NULL) {WRITE("</") ; WRITE_ELEMENT_NAME(e) ; WRITE(">");}
-#define WRITE_CDATA(s)         WRITE("<![CDATA[") ; WRITE(s) ; WRITE("]]>")
+#define WRITE_ELEMENT_NAME(e)  if (e->name != NULL) { OUTPUT_WRITE(e->name); } else {OUTPUT_WRITEF("E%d", e->id);}
+#define WRITE_ELEMENT_START(e) if (e->name != NULL) {OUTPUT_WRITE("<")  ; WRITE_ELEMENT_NAME(e) ; OUTPUT_WRITE(">");}
+#define WRITE_ELEMENT_END(e)   if (e->name != NULL) {OUTPUT_WRITE("</") ; WRITE_ELEMENT_NAME(e) ; OUTPUT_WRITE(">");}
+#define WRITE_CDATA(s)         OUTPUT_WRITE("<![CDATA[") ; OUTPUT_WRITE(s) ; OUTPUT_WRITE("]]>")
+#define WRITE_GROUP(m,i)       Output_write(output, TokenMatch_groupStart(m,i), TokenMatch_groupLength(m,i))
 
-void Match__childrenWriteXML(Match* match, int fd, int flags) {
+void Match__childrenWriteXML(Match* match, Output* output, int flags) {
 	int count = 0 ;
 	Match* child = match->children;
 	while (child != NULL) {
 		ParsingElement* element = ParsingElement_Ensure(child->element);
-		if (element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION) {
+		if (element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION && element->type != TYPE_CUT) {
 			count += 1;
 		}
 		child = child->next;
@@ -817,15 +1408,15 @@ void Match__childrenWriteXML(Match* match, int fd, int flags) {
 	int i = 0;
 	while (child != NULL) {
 		ParsingElement* element = ParsingElement_Ensure(child->element);
-		if (element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION) {
-			Match__writeXML(child, fd, flags);
+		if (element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION && element->type != TYPE_CUT) {
+			Match__writeXML(child, output, flags);
 			i += 1;
 		}
 		child = child->next;
 	}
 }
 
-void Match__writeXML(Match* match, int fd, int flags) {
+void Match__writeXML(Match* match, Output* output, int flags) {
 	if (match == NULL || match->element == NULL) {
 		return;
 	}
@@ -834,9 +1425,9 @@ void Match__writeXML(Match* match, int fd, int flags) {
 	if (element->type == TYPE_REFERENCE) {
 		Reference* ref = (Reference*)match->element;
 		if (ref->cardinality == CARDINALITY_ONE || ref->cardinality == CARDINALITY_NOT_EMPTY || ref->cardinality == CARDINALITY_OPTIONAL) {
-			Match__writeXML(match->children, fd, flags);
+			Match__writeXML(match->children, output, flags);
 		} else {
-			Match__childrenWriteXML(match, fd, flags);
+			Match__childrenWriteXML(match, output, flags);
 		}
 	}
 
@@ -846,39 +1437,39 @@ void Match__writeXML(Match* match, int fd, int flags) {
 		switch(element->type) {
 			case TYPE_WORD:
 				if (element->name != NULL) {
-					WRITE("<");
+					OUTPUT_WRITE("<");
 					WRITE_ELEMENT_NAME(element);
-					WRITE("/>");
+					OUTPUT_WRITE("/>");
 				} else {
 					/* pass */
-					// WRITE(Word_word(element));
+					// OUTPUT_WRITE(Word_word(element));
 				}
 				break;
 			case TYPE_TOKEN:
 				count = TokenMatch_count(match);
 				if (count == 0) {
 					if (element->name != NULL) {
-						WRITE("<");
+						OUTPUT_WRITE("<");
 						WRITE_ELEMENT_NAME(element);
-						WRITE("/>");
+						OUTPUT_WRITE("/>");
 					}
 				} else if (count == 1) {
 					if (element->name != NULL) {
-						WRITE("<");
+						OUTPUT_WRITE("<");
 						WRITE_ELEMENT_NAME(element);
-						WRITE(" t=\"");
-						WRITE(TokenMatch_group(match, i));
-						WRITE("\"/>");
+						OUTPUT_WRITE(" t=\"");
+						WRITE_GROUP(match, i);
+						OUTPUT_WRITE("\"/>");
 					} else {
-						WRITE(TokenMatch_group(match, i));
+						WRITE_GROUP(match, i);
 					}
 				} else {
 					if (element->name != NULL) {
 						WRITE_ELEMENT_START(element);
 						for (i=0 ; i < count ; i++) {
-							WRITE("<g t=\"");
-							WRITE(TokenMatch_group(match, i));
-							WRITE("\"/>");
+							OUTPUT_WRITE("<g t=\"");
+							WRITE_GROUP(match, i);
+							OUTPUT_WRITE("\"/>");
 						}
 						WRITE_ELEMENT_END(element);
 					} else {
@@ -892,10 +1483,10 @@ void Match__writeXML(Match* match, int fd, int flags) {
 				} else {
 					if (element->name != NULL) {
 						WRITE_ELEMENT_START(element);
-						Match__writeXML(match->children, fd, flags);
+						Match__writeXML(match->children, output, flags);
 						WRITE_ELEMENT_END(element);
 					} else {
-						Match__writeXML(match->children, fd, flags);
+						Match__writeXML(match->children, output, flags);
 					}
 				}
 				break;
@@ -904,10 +1495,10 @@ void Match__writeXML(Match* match, int fd, int flags) {
 				} else {
 					if (element->name != NULL) {
 						WRITE_ELEMENT_START(element);
-						Match__childrenWriteXML(match, fd, flags);
+						Match__childrenWriteXML(match, output, flags);
 						WRITE_ELEMENT_END(element);
 					} else {
-						Match__childrenWriteXML(match, fd, flags);
+						Match__childrenWriteXML(match, output, flags);
 					}
 				}
 				break;
@@ -915,11 +1506,13 @@ void Match__writeXML(Match* match, int fd, int flags) {
 				break;
 			case TYPE_CONDITION:
 				break;
+			case TYPE_CUT:
+				break;
 			default:
-				WRITEF("<error value=\"Undefined element type\" type=\"%c\" />", element->type);
+				OUTPUT_WRITEF("<error value=\"Undefined element type\" type=\"%c\" />", element->type);
 		}
 	} else {
-		WRITEF("<error t=\"Unsupported element type\" type=\"%c\" />", element->type);
+		OUTPUT_WRITEF("<error t=\"Unsupported element type\" type=\"%c\" />", element->type);
 	}
 }
 
@@ -927,9 +1520,15 @@ void Match_printXML(Match* this) {
 	Match_writeXML(this, 1);
 }
 
+void Match_outputXML(Match* this, Output* output) {
+	OUTPUT_WRITE("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n");
+	Match__writeXML(this, output, 0);
+}
+
 void Match_writeXML(Match* this, int fd ) {
-	WRITE("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n");
-	Match__writeXML(this, fd, 0);
+	Output* output = Output_ToFile(fd);
+	Match_outputXML(this, output);
+	Output_free(output);
 }
 
 // ----------------------------------------------------------------------------
@@ -949,6 +1548,7 @@ bool ParsingElement_Is(void *this) {
 		case TYPE_RULE:
 		case TYPE_CONDITION:
 		case TYPE_PROCEDURE:
+		case TYPE_CUT:
 			return TRUE;
 		default:
 			return FALSE;
@@ -972,6 +1572,7 @@ ParsingElement* ParsingElement_new(Reference* children[]) {
 	this->recognize = NULL;
 	this->process   = NULL;
 	this->freeMatch = NULL;
+	this->flags     = 0;
 	if (children != NULL && *children != NULL) {
 		Reference* r = Reference_Ensure(*children);
 		while ( r != NULL ) {
@@ -1044,27 +1645,192 @@ Match* ParsingElement_process( ParsingElement* this, Match* match ) {
 	return match;
 }
 
-size_t ParsingElement_skip( ParsingElement* this, ParsingContext* context) {
-	if (this == NULL || context == NULL || context->grammar->skip == NULL || context->flags & FLAG_SKIPPING) {return 0;}
-	SET_FLAG(context->flags, FLAG_SKIPPING);
-	ParsingElement* skip = context->grammar->skip;
-	size_t offset        = context->iterator->offset;
-	// We don't care about the result, just the offset change.
-	Match* match = skip->recognize(skip, context);
-	match = Match_free(match);
-	size_t skipped = context->iterator->offset - offset;
-	if (skipped > 0) {
-		OUT_IF(context->grammar->isVerbose, " %s   ►►►skipped %zu", context->indent, skipped)
-	}
-	UNSET_FLAG(context->flags, FLAG_SKIPPING)
-	return skipped;
+// Extends the reach of the context to the given offset
+void ParsingContext__reach(ParsingContext* this, size_t reach) {
+	if (this->reach < reach) {this->reach = reach;}
 }
 
-ParsingElement* ParsingElement_name( ParsingElement* this, const char* name ) {
-	if (this == NULL) {return this;}
-	__FREE(this->name);
-	__STRING_COPY(this->name, name);
-	return this;
+// Tells if the recognitions of the rule or group are memoized. Only rules
+// and groups are worth memoizing, as the other elements are either as
+// cheap to recognize as a lookup (words, tokens), or depend on the parsing
+// context (procedures, conditions). We also don't memoize while skipping,
+// nor when a context callback expects push/pop events.
+bool ParsingElement__isMemoized( ParsingElement* this, ParsingContext* context ) {
+	return context->memo != NULL && this->id >= 0 && !HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) && !HAS_FLAG(context->flags, FLAG_SKIPPING) && context->callback == NULL
+	&& !(HAS_FLAG(this->flags, ELEMENT_NOMEMO) && HAS_FLAG(this->flags, ELEMENT_NOFAILMEMO));
+}
+
+// Returns the memoized recognition of the element at the current offset,
+// moving the iterator past it, or NULL when there is none.
+Match* ParsingElement__recall( ParsingElement* this, ParsingContext* context ) {
+	size_t     offset = context->iterator->offset;
+	MemoEntry* entry  = Memo_get(context->memo, this->id, offset);
+	if (entry == NULL) {
+		context->stats->memoMisses += 1;
+		return NULL;
+	}
+	context->stats->memoHits += 1;
+	ParsingContext__reach(context, entry->reach);
+	if (entry->match == FAILURE) {
+		OUT_STEP(" !  %s└ Memo %s#%d failed at %zu", context->indent, this->name, this->id, offset);
+		return FAILURE;
+	} else {
+		OUT_STEP("[✓] %s└ Memo %s#%d matched %zu-%zu", context->indent, this->name, this->id, offset, entry->end);
+		Match* match = Match__copy(entry->match, context->arena, NULL, context, entry->shift, entry->lines);
+		context->iterator->move(context->iterator, entry->end - offset);
+		return match;
+	}
+}
+
+// Memoizes the recognition of the element that started at `offset` with
+// `cuts` cuts passed. Recognitions that pass a cut are not memoized, as a
+// memo hit wouldn't pass the cut again, and neither are the recognitions of
+// aborted parses.
+void ParsingElement__memoize( ParsingElement* this, ParsingContext* context, size_t offset, size_t cuts, Match* match ) {
+	if (context->cuts == cuts && !context->exceeded && !context->tooDeep && (Match_isSuccess(match) ? !HAS_FLAG(this->flags, ELEMENT_NOMEMO) : !HAS_FLAG(this->flags, ELEMENT_NOFAILMEMO))) {
+		Memo_set(context->memo, this->id, offset, context->iterator->offset, context->reach, Match_isSuccess(match) ? match : FAILURE);
+	}
+}
+
+Match* ParsingElement__recognize( ParsingElement* this, ParsingContext* context ) {
+	Memo* memo = context->memo;
+	if (memo == NULL) {return this->recognize(this, context);}
+	size_t offset = context->iterator->offset;
+	// When memoizing, we track how far the recognitions examine the input
+	// (see `Grammar_reparse`). Only the other elements read the input, at
+	// least up to the byte past their match: words up to their length, and
+	// tokens as far as their expression goes (see `Token__reach`).
+	if (this->type != TYPE_RULE && this->type != TYPE_GROUP) {
+		Match* match = this->recognize(this, context);
+		ParsingContext__reach(context, (Match_isSuccess(match) ? offset + match->length : offset) + 1);
+		if (this->type == TYPE_WORD) {ParsingContext__reach(context, offset + ((WordConfig*)this->config)->length);}
+		return match;
+	}
+	if (!ParsingElement__isMemoized(this, context)) {
+		return this->recognize(this, context);
+	}
+	Match* recalled = ParsingElement__recall(this, context);
+	if (recalled != NULL) {return recalled;}
+	// The reach of the recognition alone is memoized, groups and rules
+	// examining at least the byte at their offset (see `ParsingContext_rejects`).
+	size_t reach   = context->reach;
+	size_t cuts    = context->cuts;
+	context->reach = offset + 1;
+	Match* match   = this->recognize(this, context);
+	ParsingElement__memoize(this, context, offset, cuts, match);
+	ParsingContext__reach(context, reach);
+	return match;
+}
+
+// Tells if the parse exceeded its budget, in which case every recognition
+// fails so that the parse unwinds right away.
+bool ParsingContext__exceeds( ParsingContext* this ) {
+	if (this->budget != 0 && (this->exceeded || ParsingContext_account(this) > this->budget)) {
+		LOG_IF(this->grammar->isVerbose && !this->exceeded, "Aborted, %zu bytes exceed the budget of %zu bytes at %zu", ParsingContext_account(this), this->budget, this->iterator->offset)
+		this->exceeded = TRUE;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+Match* ParsingElement_recognize( ParsingElement* this, ParsingContext* context ) {
+	if (ParsingContext__exceeds(context)) {return FAILURE;}
+	Profiler* profiler = context->profiler;
+	if (profiler != NULL) {Profiler_enter(profiler, this);}
+#ifdef WITH_STATS
+	// The time includes the time spent in the children, and memoized
+	// recognitions.
+	double start = context->grammar->isTimed && !HAS_FLAG(context->flags, FLAG_SKIPPING) ? ParsingStats_now() : -1;
+#endif
+	Match* match = ParsingElement__recognize(this, context);
+#ifdef WITH_STATS
+	if (start >= 0 && this->id >= 0 && (size_t)this->id < context->stats->symbolsCount) {
+		context->stats->timeBySymbol[this->id] += ParsingStats_now() - start;
+	}
+#endif
+	if (profiler != NULL) {Profiler_exit(profiler);}
+	return match;
+}
+
+ParsingElement* ParsingElement_memoize( ParsingElement* this, bool successes, bool failures ) {
+	if (this == NULL) {return this;}
+	if (successes) {UNSET_FLAG(this->flags, ELEMENT_NOMEMO);}     else {SET_FLAG(this->flags, ELEMENT_NOMEMO);}
+	if (failures)  {UNSET_FLAG(this->flags, ELEMENT_NOFAILMEMO);} else {SET_FLAG(this->flags, ELEMENT_NOFAILMEMO);}
+	return this;
+}
+
+// Moves the iterator past the bytes of the given set, returning how many
+// were skipped.
+size_t Iterator__scan( Iterator* this, FirstSet* set ) {
+	size_t skipped = 0;
+	while (TRUE) {
+		size_t remaining = Iterator_remaining(this);
+		size_t n         = 0;
+		const unsigned char* c = (const unsigned char*)this->current;
+		while (n < remaining && FIRST_HAS(set, c[n])) {n++;}
+		if (n == 0) {break;}
+		// File inputs load what follows when moving, but before moving,
+		// so we keep the last buffered byte for another move.
+		bool more = n == remaining;
+		if (more && n > 1) {n -= 1;}
+		this->move(this, n);
+		skipped += n;
+		if (!more) {break;}
+	}
+	return skipped;
+}
+
+size_t ParsingElement_skip( ParsingElement* this, ParsingContext* context) {
+	if (this == NULL || context == NULL || context->grammar->skip == NULL || context->flags & FLAG_SKIPPING) {return 0;}
+	ParsingElement* skip = context->grammar->skip;
+	size_t offset        = context->iterator->offset;
+	// Rules and references try to skip again and again at the same offset,
+	// which the skip element would recognize the same way, unless it runs
+	// procedures or conditions.
+	bool cached          = !HAS_FLAG(skip->flags, ELEMENT_CONTEXTUAL);
+	if (cached && context->skipOffset == offset) {
+		size_t skipped = context->skipEnd - offset;
+		if (skipped > 0) {context->iterator->move(context->iterator, skipped);}
+		if (context->memo != NULL) {ParsingContext__reach(context, context->skipReach);}
+		return skipped;
+	}
+	size_t reach   = context->reach;
+	context->reach = offset + 1;
+	SET_FLAG(context->flags, FLAG_SKIPPING);
+	// The skipping shows in the profiles, but not the skips that were cached
+	if (context->profiler != NULL) {Profiler_enter(context->profiler, skip);}
+	if (skip->type == TYPE_TOKEN && ((TokenConfig*)skip->config)->repeats != NULL) {
+		// A repeated character class doesn't need the expression, nor
+		// allocating a match.
+		Iterator__scan(context->iterator, ((TokenConfig*)skip->config)->repeats);
+	} else {
+		ArenaMark mark = Arena_mark(context->arena);
+		// We don't care about the result, just the offset change.
+		Match* match = skip->recognize(skip, context);
+		match = Match_free(match);
+		Arena_rewind(context->arena, mark);
+	}
+	if (context->profiler != NULL) {Profiler_exit(context->profiler);}
+	size_t skipped = context->iterator->offset - offset;
+	ParsingContext__reach(context, offset + skipped + 1);
+	if (cached) {
+		context->skipOffset = offset;
+		context->skipEnd    = offset + skipped;
+		context->skipReach  = context->reach;
+	}
+	ParsingContext__reach(context, reach);
+	if (skipped > 0) {
+		OUT_IF(context->grammar->isVerbose, " %s   ►►►skipped %zu", context->indent, skipped)
+	}
+	UNSET_FLAG(context->flags, FLAG_SKIPPING)
+	return skipped;
+}
+
+ParsingElement* ParsingElement_name( ParsingElement* this, const char* name ) {
+	if (this == NULL) {return this;}
+	__FREE(this->name);
+	__STRING_COPY(this->name, name);
+	return this;
 }
 
 const char* ParsingElement_getName( ParsingElement* this ) {
@@ -1206,6 +1972,53 @@ int Reference__walk( Reference* this, ElementWalkingCallback callback, int step,
 	return step;
 }
 
+void ParsingContext__enclose(ParsingContext* this, ParsingElement* rule, Match* result, size_t offset) {
+	if (!Match_isSuccess(result)) {
+		result         = Match_Success(0, rule, this);
+		result->offset = offset;
+	}
+	this->enclosing = result;
+}
+
+// Processes the children of the axiom before the `commit` reference, which
+// the reference's first match makes final too, so that they are processed
+// in order. The listener is sent their events after the enter event of the
+// axiom, and before the one of the reference, the exit events being sent
+// once the parse is done (see `Listener_parseIterator`).
+void ParsingContext__open(ParsingContext* this, size_t offset) {
+	Match*    enclosing = this->enclosing;
+	Listener* listener  = this->listener;
+	this->opened = TRUE;
+	if (listener == NULL) {
+		for (Match* child = enclosing->children ; child != NULL ; child = child->next) {
+			Processor_process(this->processor, child, 0);
+		}
+		return;
+	}
+	if (listener->enter != NULL) {
+		listener->enter(listener, Match_getElementID(enclosing), enclosing->offset, offset - enclosing->offset);
+	}
+	for (Match* child = enclosing->children ; child != NULL ; child = child->next) {
+		Listener_send(listener, child);
+	}
+	if (listener->enter != NULL) {
+		listener->enter(listener, this->commit->id, offset, 0);
+	}
+}
+
+// Processes a match of the context's `commit` reference, which the parse
+// won't backtrack past, so that the input before its end can be discarded.
+// The match of the reference starts at the given offset.
+void ParsingContext__commit(ParsingContext* this, Match* match, size_t offset) {
+	if (!this->opened && this->enclosing != NULL) {ParsingContext__open(this, offset);}
+	if (this->listener != NULL) {
+		Listener_send(this->listener, match);
+	} else {
+		Processor_process(this->processor, match, 0);
+	}
+	Iterator_commit(this->iterator, Match_getEndOffset(match));
+}
+
 Match* Reference_recognize(Reference* this, ParsingContext* context) {
 
 	// References are pretty much always the root elements (at the exception of
@@ -1218,7 +2031,8 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 	int    count  = 0;
 	int    offset = context->iterator->offset;
 	int    match_end_offset = offset;
-	size_t match_end_lines  = context->iterator->lines;
+	// Anything allocated from there is released if the reference fails
+	ArenaMark mark = Arena_mark(context->arena);
 
 	// If the wrapped element is a procedure, then the cardinality can only be one or optional, as a procedure does
 	// not consume input.
@@ -1226,7 +2040,7 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 
 	// We loop while there is more data to parse, or if the element type is a procedure (or condition)
 	size_t current_offset = offset;
-	while ((Iterator_hasMore(context->iterator) || this->element->type == TYPE_PROCEDURE || this->element->type == TYPE_CONDITION)) {
+	while ((Iterator_hasMore(context->iterator) || this->element->type == TYPE_PROCEDURE || this->element->type == TYPE_CONDITION || this->element->type == TYPE_CUT)) {
 
 		// We log the current iteration, but only if we know there's going to be more than one
 		ASSERT(this->element->recognize, "Reference_recognize: Element '%s' has no recognize callback", this->element->name);
@@ -1238,15 +2052,22 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 
 		// We ask the element to recognize the current iterator's position
 		int iteration_offset = context->iterator->offset;
-		Match* match         = this->element->recognize(this->element, context);
+		size_t cuts          = context->cuts;
+		Match* match         = ParsingElement_recognize(this->element, context);
 		int parsed           = context->iterator->offset - iteration_offset;
 
 		// Is the match successful ?
 		if (Match_isSuccess(match)) {
 			match_end_offset = Match_getEndOffset(match);
+			if (this == context->commit) {
+				// The match is processed right away rather than kept, and
+				// the memory of its recognition is reclaimed.
+				ParsingContext__commit(context, match, (size_t)offset);
+				match = Match_free(match);
+				Arena_rewind(context->arena, mark);
+				if (parsed == 0) {count++; break;}
 			// NOTE: not 100% about this
-			match_end_lines  = context->iterator->lines;
-			if (count == 0) {
+			} else if (count == 0) {
 				// If it's the first match and we're in a ONE/OPTIONAL reference, we break
 				// the loop.
 				assert(result == FAILURE);
@@ -1274,6 +2095,13 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 		} else {
 			// We free the match (it's a FAILURE or NULL, anyway).
 			match = Match_free(match);
+			// A failure past a cut is final, whatever the cardinality
+			if (context->cuts != cuts) {
+				result = Match_fail(result);
+				Arena_rewind(context->arena, mark);
+				ParsingContext_backtrack(context, offset);
+				return MATCH_STATS(FAILURE);
+			}
 			// If the match is not a success, then we try to skip some input
 			// and see if we get a match.
 			size_t skipped = ParsingElement_skip((ParsingElement*)this, context);
@@ -1293,13 +2121,14 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 	// fail, while they would match if there had been no skipping.
 	if (context->iterator->offset != match_end_offset) {
 		// NOTE: It backtrack always right?
-		Iterator_backtrack(context->iterator, match_end_offset, match_end_lines);
+		ParsingContext_backtrack(context, match_end_offset);
 	}
 
 	DEBUG_IF(count > 0, "        Reference %s#%d@%s matched %d times out of %c",  this->element->name, this->element->id, this->name, count, this->cardinality);
 
-	// Depending on the cardinality, we might return FAILURE, or not
-	bool is_success = Match_isSuccess(result) ? TRUE : FALSE;
+	// Depending on the cardinality, we might return FAILURE, or not. The
+	// committed matches were processed, and are not part of the result.
+	bool is_success = Match_isSuccess(result) || (this == context->commit && count > 0) ? TRUE : FALSE;
 	switch (this->cardinality) {
 		case CARDINALITY_ONE:
 			break;
@@ -1318,6 +2147,7 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 		case CARDINALITY_NOT_EMPTY:
 			if (is_success && result->length == 0) {
 				result = Match_fail(result);
+				Arena_rewind(context->arena, mark);
 				return MATCH_STATS(result);
 			}
 			break;
@@ -1325,6 +2155,7 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 			// Unsuported cardinality
 			ERROR("Unsupported cardinality %c", this->cardinality);
 			result = Match_fail(result);
+			Arena_rewind(context->arena, mark);
 			return MATCH_STATS(result);
 	}
 
@@ -1340,12 +2171,14 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 		// We make sure that if we had a success, that we add
 		m->children     = result == FAILURE ? NULL : result;
 		m->offset       = offset;
+		for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
 		assert(m->children == NULL || m->children->element != NULL);
 		//OUT_IF(context->grammar->isVerbose, "[✓] %sReference %s#%d@%s matched %d/%c times over %d-%d", context->indent, this->element->name, this->element->id, this->name, count, this->cardinality, offset, offset+length)
 		return MATCH_STATS(m);
 	} else {
 		//OUT_IF(context->grammar->isVerbose, " !  %sReference %s#%d@%s failed %d/%c times at %d-%d", context->indent, this->element->name, this->element->id, this->name, count, this->cardinality, offset, (int)context->stats->matchOffset);
 		result = Match_fail(result);
+		Arena_rewind(context->arena, mark);
 		return MATCH_STATS(FAILURE);
 	}
 }
@@ -1394,16 +2227,17 @@ const char* Word_word(ParsingElement* this) {
 
 Match* Word_recognize(ParsingElement* this, ParsingContext* context) {
 	WordConfig* config = ((WordConfig*)this->config);
-	if (strncmp(config->word, context->iterator->current, config->length) == 0) {
+	// NOTE: The input might not end with a `\0` (see `Iterator_FromSlice`)
+	if (config->length <= Iterator_remaining(context->iterator) && strncmp(config->word, context->iterator->current, config->length) == 0) {
 		// NOTE: You can see here that the word actually consumes input
 		// and moves the iterator.
 		Match* success = MATCH_STATS(Match_Success(config->length, this, context));
 		ASSERT(config->length > 0, "Word: %s configuration length == 0", config->word)
 		context->iterator->move(context->iterator, config->length);
-		OUT_STEP("[✓] %s└ Word %s#%d:`" CYAN "%s" RESET "` matched %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, ((WordConfig*)this->config)->word, context->iterator->lines, context->iterator->offset - config->length, context->iterator->offset, context->depth);
+		OUT_STEP("[✓] %s└ Word %s#%d:`" CYAN "%s" RESET "` matched %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, ((WordConfig*)this->config)->word, Iterator_getLine(context->iterator), context->iterator->offset - config->length, context->iterator->offset, context->depth);
 		return success;
 	} else {
-		OUT_STEP(" !  %s└ Word %s#%d:" CYAN "`%s`" RESET " failed at %zu:%zu[→%d]", context->indent, this->name, this->id, ((WordConfig*)this->config)->word, context->iterator->lines, context->iterator->offset, context->depth);
+		OUT_STEP(" !  %s└ Word %s#%d:" CYAN "`%s`" RESET " failed at %zu:%zu[→%d]", context->indent, this->name, this->id, ((WordConfig*)this->config)->word, Iterator_getLine(context->iterator), context->iterator->offset, context->depth);
 		return MATCH_STATS(FAILURE);
 	}
 }
@@ -1423,6 +2257,162 @@ void Word_print(ParsingElement* this) {
 //
 // ----------------------------------------------------------------------------
 
+// Returns the literal prefix that every match of the given expression
+// starts with, setting its length, or NULL when there is none. This is
+// conservative: anything that is not plainly a literal ends the prefix.
+char* Token__prefix(const char* expr, size_t* length, bool* literal) {
+	*length  = 0;
+	*literal = FALSE;
+	// Alternatives at the top level don't have to share a prefix, so we
+	// look for them first, skipping the escaped characters and classes.
+	int  depth    = 0;
+	bool in_class = FALSE;
+	for (const char* c = expr ; *c != '\0' ; c++) {
+		if (*c == '\\') {
+			if (c[1] == 'Q' || c[1] == '\0') {return NULL;}
+			c++;
+		} else if (in_class) {
+			if (*c == ']') {in_class = FALSE;}
+		} else if (*c == '[') {
+			in_class = TRUE;
+			// A closing bracket right after the opening one is a literal
+			if (c[1] == '^') {c++;}
+			if (c[1] == ']') {c++;}
+		} else if (*c == '(') {
+			depth++;
+		} else if (*c == ')') {
+			depth--;
+		} else if (*c == '|' && depth == 0) {
+			return NULL;
+		}
+	}
+	char*       prefix = NULL;
+	size_t      n      = 0;
+	const char* c      = expr;
+	while (*c != '\0') {
+		const char* next = c;
+		if (*c == '\\') {
+			// Only escaped punctuation is a literal, as `\d` or `\x41` are not
+			if (c[1] == '\0' || (unsigned char)c[1] >= 128 || strchr("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~", c[1]) == NULL) {break;}
+			next = c + 2;
+		} else if (strchr(".[]()*+?{}|^$", *c) != NULL) {
+			break;
+		} else {
+			// We take UTF-8 sequences as a whole, as quantifiers apply
+			// to the whole character.
+			next = c + 1;
+			if ((unsigned char)*c >= 0xC0) {
+				while (((unsigned char)*next & 0xC0) == 0x80) {next++;}
+			}
+		}
+		// A quantifier might make the character optional, but a repeated
+		// character is still there at least once.
+		if (*next == '*' || *next == '?' || *next == '{') {break;}
+		if (prefix == NULL) {
+			__ARRAY_NEW(buffer, char, strlen(expr) + 1);
+			prefix = buffer;
+		}
+		if (*c == '\\') {
+			prefix[n++] = c[1];
+		} else {
+			while (c < next) {prefix[n++] = *c++;}
+		}
+		if (*next == '+') {break;}
+		c = next;
+	}
+	if (n == 0) {__FREE(prefix); return NULL;}
+	prefix[n] = '\0';
+	*length   = n;
+	*literal  = *c == '\0';
+	return prefix;
+}
+
+// Adds the byte denoted by the escape or literal at `c` to the set,
+// returning the next character, or NULL when it is not a single ASCII byte.
+const char* Token__classByte(const char* c, FirstSet* set, unsigned char* byte) {
+	if (*c == '\\') {
+		switch (c[1]) {
+			case 't': *byte = '\t'; break;
+			case 'n': *byte = '\n'; break;
+			case 'r': *byte = '\r'; break;
+			case 'f': *byte = '\f'; break;
+			case 'v': *byte = '\v'; break;
+			default:
+				if (c[1] == '\0' || (unsigned char)c[1] >= 128 || strchr("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~", c[1]) == NULL) {return NULL;}
+				*byte = (unsigned char)c[1];
+		}
+		FIRST_ADD(set, *byte);
+		return c + 2;
+	} else if (*c == '\0' || (unsigned char)*c >= 128) {
+		return NULL;
+	} else {
+		*byte = (unsigned char)*c;
+		FIRST_ADD(set, *byte);
+		return c + 1;
+	}
+}
+
+// Adds the bytes of the character class that starts the expression
+// (`[a-z_]`, `\s` or a single character) to the set, returning what
+// follows the class, or NULL when the expression doesn't start with one.
+const char* Token__class(const char* expr, FirstSet* set) {
+	const char*   c    = expr;
+	unsigned char byte = 0;
+	if (c[0] == '\\' && c[1] == 's') {
+		// NOTE: This is PCRE's `\s` without Unicode properties
+		const char* spaces = " \t\n\v\f\r";
+		for (int i=0 ; spaces[i] != '\0' ; i++) {FIRST_ADD(set, spaces[i]);}
+		c += 2;
+	} else if (c[0] == '[' && c[1] != '^' && c[1] != ']') {
+		c++;
+		while (c != NULL && *c != ']') {
+			if (*c == '[' || (c[0] == '\\' && c[1] == 's')) {
+				// POSIX classes and nested escapes are left to the expression
+				c = NULL;
+			} else if ((c = Token__classByte(c, set, &byte)) != NULL && c[0] == '-' && c[1] != ']') {
+				// This is a range, which needs to be in order
+				unsigned char start = byte;
+				if ((c = Token__classByte(c + 1, set, &byte)) != NULL && byte >= start) {
+					for (int i=start ; i<=byte ; i++) {FIRST_ADD(set, i);}
+				} else {
+					c = NULL;
+				}
+			}
+		}
+		if (c != NULL) {c++;}
+	} else if (c[0] != '\0' && strchr(".[]()*+?{}|^$", c[0]) == NULL) {
+		c = Token__classByte(c, set, &byte);
+	} else {
+		c = NULL;
+	}
+	return c;
+}
+
+// Returns the set of bytes of the character class that the expression
+// repeats, when the expression is only that (`[ \t\n]+`, `\s*`), possibly
+// captured (`([a-z]+)`), or NULL. The skip element can then be run as a
+// scan of these bytes (see `ParsingElement_skip`), and the token examines
+// no more than the byte past its match (see `Token__reach`).
+FirstSet* Token__repeats(const char* expr) {
+	__NEW(FirstSet, set);
+	memset(set, 0, sizeof(FirstSet));
+	bool        captured = expr[0] == '(' && expr[1] != '?';
+	const char* c        = Token__class(captured ? expr + 1 : expr, set);
+	// The class must be repeated, possessively or not, and end the
+	// expression (or its group).
+	if (c != NULL && (*c == '+' || *c == '*')) {
+		c += c[1] == '+' ? 2 : 1;
+		if (captured) {c = *c == ')' ? c + 1 : NULL;}
+	} else {
+		c = NULL;
+	}
+	if (c == NULL || *c != '\0') {
+		__FREE(set);
+		return NULL;
+	}
+	return set;
+}
+
 ParsingElement* Token_new(const char* expr) {
 	__NEW(TokenConfig, config);
 	ParsingElement* this = ParsingElement_new(NULL);
@@ -1433,25 +2423,115 @@ ParsingElement* Token_new(const char* expr) {
 	// causing problems with PyPy, hinting at potential allocation issues
 	// elsewhere.
 	__STRING_COPY(config->expr, expr);
-#ifdef WITH_PCRE
+	config->prefix  = Token__prefix(config->expr, &config->prefixLength, &config->literal);
+	config->repeats = Token__repeats(config->expr);
+	// We start from the conservative assumption that the token can start
+	// with any byte and match the empty string.
+	memset(config->first.bytes, 0xFF, sizeof(config->first.bytes));
+	config->first.nullable = TRUE;
+#if defined(WITH_PCRE2)
+	int        pcre_error        = 0;
+	PCRE2_SIZE pcre_error_offset = 0;
+	// The start of match optimizations, which give us the first set, are
+	// not computed for anchored expressions, so we get them from an
+	// unanchored compilation first.
+	pcre2_code* unanchored = pcre2_compile((PCRE2_SPTR)config->expr, PCRE2_ZERO_TERMINATED, PCRE2_UTF, &pcre_error, &pcre_error_offset, NULL);
+	if (unanchored == NULL) {
+		PCRE2_UCHAR message[256];
+		pcre2_get_error_message(pcre_error, message, sizeof(message));
+		ERROR("Token: cannot compile regular expression `%s` at %zu: %s", config->expr, (size_t)pcre_error_offset, (char*)message);
+		__FREE(config->prefix);
+		__FREE(config->repeats);
+		__FREE(config->expr);
+		__FREE(config);
+		__FREE(this);
+		return NULL;
+	}
+	const uint8_t* table     = NULL;
+	uint32_t       minlength = 0;
+	uint32_t       type      = 0;
+	uint32_t       first     = 0;
+	pcre2_pattern_info(unanchored, PCRE2_INFO_MINLENGTH, &minlength);
+	if (pcre2_pattern_info(unanchored, PCRE2_INFO_FIRSTBITMAP, &table) == 0 && table != NULL) {
+		memcpy(config->first.bytes, table, sizeof(config->first.bytes));
+		config->first.nullable = FALSE;
+	} else if (pcre2_pattern_info(unanchored, PCRE2_INFO_FIRSTCODETYPE, &type) == 0 && type == 1
+	&& pcre2_pattern_info(unanchored, PCRE2_INFO_FIRSTCODEUNIT, &first) == 0 && first < 128) {
+		// A fixed first character does not tell if the expression is
+		// caseless, so we add both cases.
+		memset(config->first.bytes, 0, sizeof(config->first.bytes));
+		FIRST_ADD(&config->first, first);
+		if (first >= 'a' && first <= 'z') {FIRST_ADD(&config->first, first - 'a' + 'A');}
+		if (first >= 'A' && first <= 'Z') {FIRST_ADD(&config->first, first - 'A' + 'a');}
+		config->first.nullable = FALSE;
+	}
+	if (minlength > 0) {config->first.nullable = FALSE;}
+	pcre2_code_free(unanchored);
+	// Tokens only match at the current location. Anchoring the expression
+	// when compiling it, rather than when matching, keeps the JIT usable.
+	config->regexp = pcre2_compile((PCRE2_SPTR)config->expr, PCRE2_ZERO_TERMINATED, PCRE2_UTF | PCRE2_ANCHORED, &pcre_error, &pcre_error_offset, NULL);
+	assert(config->regexp != NULL);
+	uint32_t captures = 0;
+	pcre2_pattern_info(config->regexp, PCRE2_INFO_CAPTURECOUNT, &captures);
+	config->groups = (int)captures + 1;
+	// The JIT might not be available on this platform, in which case the
+	// expression is interpreted. It is compiled for the partial matches of
+	// push inputs as well (see `Token_recognize`).
+	// SEE: https://www.pcre.org/current/doc/html/pcre2jit.html
+	config->jit    = pcre2_jit_compile(config->regexp, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_HARD) == 0;
+#elif defined(WITH_PCRE)
 	const char* pcre_error;
 	int         pcre_error_offset = -1;
 	config->regexp = pcre_compile(config->expr, PCRE_UTF8, &pcre_error, &pcre_error_offset, NULL);
 	if (pcre_error != NULL) {
 		ERROR("Token: cannot compile regular expression `%s` at %d: %s", config->expr, pcre_error_offset, pcre_error);
+		__FREE(config->prefix);
+		__FREE(config->repeats);
+		__FREE(config->expr);
 		__FREE(config);
 		__FREE(this);
 		return NULL;
 	}
 	// SEE: http://pcre.org/original/doc/html/pcrejit.html
-	config->extra = pcre_study(config->regexp, PCRE_STUDY_JIT_COMPILE, &pcre_error);
+	config->extra = pcre_study(config->regexp, PCRE_STUDY_JIT_COMPILE | PCRE_STUDY_JIT_PARTIAL_HARD_COMPILE, &pcre_error);
 	if (pcre_error != NULL) {
 		ERROR("Token: cannot optimize regular expression `%s` at %d: %s", config->expr, pcre_error_offset, pcre_error);
+		__FREE(config->prefix);
+		__FREE(config->repeats);
+		__FREE(config->expr);
 		__FREE(config);
 		__FREE(this);
 		return NULL;
 	}
+	const unsigned char* table = NULL;
+	int minlength = -1;
+	int flags     = 0;
+	int first     = -1;
+	pcre_fullinfo(config->regexp, config->extra, PCRE_INFO_MINLENGTH, &minlength);
+	if (pcre_fullinfo(config->regexp, config->extra, PCRE_INFO_FIRSTTABLE, &table) == 0 && table != NULL) {
+		// The first table is only available when every match starts
+		// with one of its bytes.
+		memcpy(config->first.bytes, table, sizeof(config->first.bytes));
+		config->first.nullable = FALSE;
+	} else if (pcre_fullinfo(config->regexp, config->extra, PCRE_INFO_FIRSTCHARACTERFLAGS, &flags) == 0 && flags == 1
+	&& pcre_fullinfo(config->regexp, config->extra, PCRE_INFO_FIRSTCHARACTER, &first) == 0 && first >= 0 && first < 128) {
+		// A fixed first character does not tell if the expression is
+		// caseless, so we add both cases.
+		memset(config->first.bytes, 0, sizeof(config->first.bytes));
+		FIRST_ADD(&config->first, first);
+		if (first >= 'a' && first <= 'z') {FIRST_ADD(&config->first, first - 'a' + 'A');}
+		if (first >= 'A' && first <= 'Z') {FIRST_ADD(&config->first, first - 'A' + 'a');}
+		config->first.nullable = FALSE;
+	}
+	if (minlength > 0) {config->first.nullable = FALSE;}
 #endif
+	// The prefix is exact, so it tells more than the expression's first
+	// bytes.
+	if (config->prefix != NULL) {
+		memset(config->first.bytes, 0, sizeof(config->first.bytes));
+		FIRST_ADD(&config->first, (unsigned char)config->prefix[0]);
+		config->first.nullable = FALSE;
+	}
 	this->config = config;
 	assert(strcmp(config->expr, expr) == 0);
 	assert(strcmp(Token_expr(this), expr) == 0);
@@ -1463,10 +2543,14 @@ void Token_free(ParsingElement* this) {
 	TokenConfig* config = (TokenConfig*)this->config;
 	if (config != NULL) {
 		// FIXME: Not sure how to free a regexp
-#ifdef WITH_PCRE
+#if defined(WITH_PCRE2)
+		if (config->regexp != NULL) {pcre2_code_free(config->regexp);}
+#elif defined(WITH_PCRE)
 		if (config->regexp != NULL) {pcre_free(config->regexp);}
 		if (config->extra  != NULL) {pcre_free_study(config->extra);}
 #endif
+		__FREE(config->prefix);
+		__FREE(config->repeats);
 		__FREE(config->expr);
 		__FREE(config);
 	}
@@ -1478,23 +2562,141 @@ const char* Token_expr(ParsingElement* this) {
 	return ((TokenConfig*)this->config)->expr;
 }
 
+// Copies the group strings of the match in the arena, or on the heap when
+// it is NULL, from the input or from the strings the match owns, so that
+// the match owns them. Strings in the arena are released along with the
+// match when the arena is rewound, as when backtracking or committing.
+void TokenMatch__own(Match* match, Arena* arena) {
+	TokenMatch*  m      = (TokenMatch*)match->data;
+	const char** groups = NULL;
+	if (arena != NULL) {
+		groups = (const char**)Arena_alloc(arena, sizeof(const char*) * m->count);
+	} else {
+		__ARRAY_NEW(heap_groups, const char*, m->count);
+		groups = heap_groups;
+	}
+	for (int j=0 ; j<m->count ; j++) {
+		size_t length = m->spans[j].length;
+		char*  group  = NULL;
+		if (arena != NULL) {
+			group = (char*)Arena_alloc(arena, length + 1);
+		} else {
+			__ARRAY_NEW(heap_group, char, length + 1);
+			group = heap_group;
+		}
+		memcpy(group, m->owned ? m->groups[j] : TokenMatch_groupStart(match, j), length);
+		group[length] = '\0';
+		groups[j]     = group;
+	}
+	m->groups = groups;
+	m->owned  = TRUE;
+}
+
+// Tracks how far the token examined the input when memoizing, past the
+// byte after its match (see `ParsingElement__recognize`). Literal tokens
+// examine their prefix, and repeated classes stop at the byte after their
+// match, but the other expressions might have examined everything up to
+// the end of the input, as with backtracking or lookahead assertions. When
+// the expression was matched with `hard` partial matching, it reached the
+// end of the input only when the match is `partial`.
+void Token__reach(TokenConfig* config, ParsingContext* context, size_t offset, bool hard, bool partial) {
+	if (context->memo == NULL) {return;}
+	size_t end = Iterator_bufferOffset(context->iterator) + context->iterator->available;
+	if (partial) {
+		ParsingContext__reach(context, end + 1);
+	} else if (config->literal) {
+		ParsingContext__reach(context, offset + config->prefixLength);
+	} else if (config->repeats == NULL) {
+		ParsingContext__reach(context, hard ? end : end + 1);
+	}
+}
+
+// Tells if the tokens are matched with hard partial matching, which is when
+// the input is pushed and could still be completed. A match that needs the
+// data that comes next is then partial, and the parse incomplete (see
+// `ParsingResult_new`).
+bool Token__needsPartial(ParsingContext* context) {
+	PushInput* push = Iterator__pushInput(context->iterator);
+	return push != NULL && !push->ended;
+}
+
 Match* Token_recognize(ParsingElement* this, ParsingContext* context) {
 	assert(this->config);
 	if(this->config == NULL) {return FAILURE;}
-	Match* result = NULL;
-#ifdef WITH_PCRE
+	// The FIRST set test is much cheaper than executing the regexp
+	if (ParsingContext_rejects(context, this->id)) {return MATCH_STATS(FAILURE);}
 	TokenConfig* config = (TokenConfig*)this->config;
+	size_t       offset = context->iterator->offset;
+	// And so is comparing the literal prefix
+	if (config->prefixLength > 0 && (Iterator_remaining(context->iterator) < config->prefixLength || memcmp(context->iterator->current, config->prefix, config->prefixLength) != 0)) {
+		if (context->memo != NULL) {ParsingContext__reach(context, offset + config->prefixLength);}
+		return MATCH_STATS(FAILURE);
+	}
+	Match* result = NULL;
+#if defined(WITH_PCRE2)
+	// The match data is reused by all the tokens recognized in the context,
+	// growing to the number of groups of the token.
+	pcre2_match_data* data = (pcre2_match_data*)context->matchData;
+	if (data == NULL || (int)pcre2_get_ovector_count(data) < config->groups) {
+		if (data != NULL) {pcre2_match_data_free(data);}
+		data = pcre2_match_data_create((uint32_t)MAX(config->groups, 16), NULL);
+		context->matchData = data;
+	}
+	PCRE2_SPTR line    = (PCRE2_SPTR)context->iterator->current;
+	size_t     length  = Iterator_remaining(context->iterator);
+	bool       hard    = Token__needsPartial(context);
+	uint32_t   options = hard ? PCRE2_PARTIAL_HARD : 0;
+	// The JIT entry point skips the sanity checks, and neither checks the
+	// UTF-8 validity of the whole subject, which would be done at each
+	// match otherwise.
+	int r = config->jit
+		? pcre2_jit_match(config->regexp, line, length, 0, options, data, NULL)
+		: pcre2_match(config->regexp, line, length, 0, options | PCRE2_NO_UTF_CHECK, data, NULL);
+	if (r <= 0) {
+		if (r != PCRE2_ERROR_NOMATCH && r != PCRE2_ERROR_PARTIAL) {
+			PCRE2_UCHAR message[256];
+			pcre2_get_error_message(r, message, sizeof(message));
+			ERROR("Token:%s %s", config->expr, (char*)message);
+		}
+		result = FAILURE;
+		OUT_STEP("    %s└✘Token " BOLDRED "%s" RESET "#%d:`" CYAN "%s" RESET "` failed at %zu:%zu", context->indent, this->name, this->id, config->expr, Iterator_getLine(context->iterator), context->iterator->offset);
+	} else {
+		PCRE2_SIZE* vector = pcre2_get_ovector_pointer(data);
+		result = Match_Success(vector[1], this, context);
+		OUT_STEP("[✓] %s└ Token " BOLDGREEN "%s" RESET "#%d:" CYAN "`%s`" RESET " matched " BOLDGREEN "%zu:%zu-%zu" RESET, context->indent, this->name, this->id, config->expr, Iterator_getLine(context->iterator), context->iterator->offset, context->iterator->offset + result->length);
+		// Groups are stored as spans of the input, their strings being
+		// created on demand (see the legacy version below).
+		TokenMatch* match = (TokenMatch*)Arena_alloc(context->arena, sizeof(TokenMatch));
+		match->count      = r;
+		match->spans      = (TokenMatchGroup*)Arena_alloc(context->arena, sizeof(TokenMatchGroup) * r);
+		match->groups     = NULL;
+		match->context    = context;
+		match->owned      = FALSE;
+		for (int j=0 ; j<r ; j++) {
+			bool matched           = vector[j * 2] != PCRE2_UNSET;
+			match->spans[j].offset = context->iterator->offset + (matched ? vector[j * 2] : 0);
+			match->spans[j].length = matched ? vector[j * 2 + 1] - vector[j * 2] : 0;
+		}
+		result->data = match;
+		if (context->iterator->window > 0) {TokenMatch__own(result, context->arena);}
+		context->iterator->move(context->iterator,result->length);
+		assert(Match_isSuccess(result));
+	}
+	Token__reach(config, context, offset, hard, r == PCRE2_ERROR_PARTIAL);
+#elif defined(WITH_PCRE)
 	// NOTE: This has to be a multiple of 3, according to `man pcre_exec`
 	int vector_length = 30;
 	int vector[vector_length];
 	const char* line = (const char*)context->iterator->current;
+	bool        hard = Token__needsPartial(context);
 	// SEE: http://www.mitchr.me/SS/exampleCode/AUPG/pcre_example.c.html
 	int r = pcre_exec(
 		config->regexp, config->extra,     // Regex
 		line,                              // Line
-		context->iterator->available,      // Available data
+		Iterator_remaining(context->iterator), // Available data
 		0,                                 // Offset
 		  PCRE_ANCHORED                    // OPTIONS -- we do not skip position
+		| (hard ? PCRE_PARTIAL_HARD : 0)   // Push inputs might be completed
 		| PCRE_NO_UTF8_CHECK               // These following one are necessary
 		| PCRE_NO_UTF16_CHECK              // for good performance, or the whole
 		| PCRE_NO_UTF32_CHECK,             // string will be checked at each exec.
@@ -1504,6 +2706,7 @@ Match* Token_recognize(ParsingElement* this, ParsingContext* context) {
 		// DEBUG("Token: %s FAILED on %s", config->expr, context->iterator->buffer);
 		switch(r) {
 			case PCRE_ERROR_NOMATCH      : result = FAILURE;                                                        break;
+			case PCRE_ERROR_PARTIAL      : result = FAILURE;                                                        break;
 			case PCRE_ERROR_NULL         : ERROR("Token:%s Something was null", config->expr);                      break;
 			case PCRE_ERROR_BADOPTION    : ERROR("Token:%s A bad option was passed", config->expr);                 break;
 			case PCRE_ERROR_BADMAGIC     : ERROR("Token:%s Magic number bad (compiled re corrupt?)", config->expr); break;
@@ -1511,7 +2714,7 @@ Match* Token_recognize(ParsingElement* this, ParsingContext* context) {
 			case PCRE_ERROR_NOMEMORY     : ERROR("Token:%s Ran out of memory", config->expr);                       break;
 			default                      : ERROR("Token:%s Unknown error", config->expr);                           break;
 		};
-		OUT_STEP("    %s└✘Token " BOLDRED "%s" RESET "#%d:`" CYAN "%s" RESET "` failed at %zu:%zu", context->indent, this->name, this->id, config->expr, context->iterator->lines, context->iterator->offset);
+		OUT_STEP("    %s└✘Token " BOLDRED "%s" RESET "#%d:`" CYAN "%s" RESET "` failed at %zu:%zu", context->indent, this->name, this->id, config->expr, Iterator_getLine(context->iterator), context->iterator->offset);
 	} else {
 		if(r == 0) {
 			ERROR("Token: %s many substrings matched\n", config->expr);
@@ -1524,32 +2727,64 @@ Match* Token_recognize(ParsingElement* this, ParsingContext* context) {
 		}
 		// FIXME: Make sure it is the length and not the end offset
 		result = Match_Success(vector[1], this, context);
-		OUT_STEP("[✓] %s└ Token " BOLDGREEN "%s" RESET "#%d:" CYAN "`%s`" RESET " matched " BOLDGREEN "%zu:%zu-%zu" RESET, context->indent, this->name, this->id, config->expr, context->iterator->lines, context->iterator->offset, context->iterator->offset + result->length);
-
-		// We create the token match
-		__NEW(TokenMatch, data);
-		data->count    = r;
-		__ARRAY_NEW(groups, const char*, r);
-		data->groups   = groups;
-		// NOTE: We do this here, but it's probably better to do it later
-		// once the token is recognized, although this poses the problem
-		// of preserving the input.
+		OUT_STEP("[✓] %s└ Token " BOLDGREEN "%s" RESET "#%d:" CYAN "`%s`" RESET " matched " BOLDGREEN "%zu:%zu-%zu" RESET, context->indent, this->name, this->id, config->expr, Iterator_getLine(context->iterator), context->iterator->offset, context->iterator->offset + result->length);
+
+		// We create the token match, where groups are stored as spans of the
+		// input. Group strings are only created when requested, as most
+		// token matches are discarded or only need the spans.
+		TokenMatch* data = (TokenMatch*)Arena_alloc(context->arena, sizeof(TokenMatch));
+		data->count      = r;
+		data->spans      = (TokenMatchGroup*)Arena_alloc(context->arena, sizeof(TokenMatchGroup) * r);
+		data->groups     = NULL;
+		data->context    = context;
+		data->owned      = FALSE;
 		for (int j=0 ; j<r ; j++) {
-			const char* substring;
-			// This function copies the data into a freshly allocated
-			// substring.
-			pcre_get_substring(line, vector, r, j, &(substring));
-			data->groups[j] = substring;
+			// Groups that were not matched have a -1 offset
+			bool matched         = vector[j * 2] >= 0;
+			data->spans[j].offset = context->iterator->offset + (matched ? vector[j * 2] : 0);
+			data->spans[j].length = matched ? vector[j * 2 + 1] - vector[j * 2] : 0;
 		}
 		result->data = data;
+		// When the iterator has a window, the input might be discarded
+		// before the match is processed, so we copy the groups right away,
+		// along with the match.
+		if (context->iterator->window > 0) {TokenMatch__own(result, context->arena);}
 		context->iterator->move(context->iterator,result->length);
 		assert (result->data != NULL);
 		assert(Match_isSuccess(result));
 	}
+	Token__reach(config, context, offset, hard, r == PCRE_ERROR_PARTIAL);
 #endif
 	return MATCH_STATS(result);
 }
 
+const char* TokenMatch_groupStart(Match* match, int index) {
+	assert (match                != NULL);
+	assert (match->data          != NULL);
+	assert (Match_getElementType(match) == TYPE_TOKEN);
+	TokenMatch* m = (TokenMatch*)match->data;
+	assert (index >= 0);
+	assert (index < m->count);
+	// The groups that were copied because the input could be discarded
+	// (see `Token_recognize`) outlive the iterator's buffer.
+	if (m->owned) {return m->groups[index];}
+	// The iterator's buffer might not start at the beginning of the input,
+	// so we need to translate the offset.
+	Iterator* iterator = m->context->iterator;
+	size_t    base     = Iterator_bufferOffset(iterator);
+	assert (m->spans[index].offset >= base);
+	return iterator->buffer + (m->spans[index].offset - base);
+}
+
+int TokenMatch_groupLength(Match* match, int index) {
+	assert (match                != NULL);
+	assert (match->data          != NULL);
+	TokenMatch* m = (TokenMatch*)match->data;
+	assert (index >= 0);
+	assert (index < m->count);
+	return (int)m->spans[index].length;
+}
+
 const char* TokenMatch_group(Match* match, int index) {
 	assert (match                != NULL);
 	assert (match->data          != NULL);
@@ -1558,6 +2793,21 @@ const char* TokenMatch_group(Match* match, int index) {
 	if (m) {
 		assert (index >= 0);
 		assert (index < m->count);
+		// Strings are allocated in the context's string arena, which is
+		// never rewound, so they live as long as the context.
+		ParsingContext* context = m->context;
+		if (context->strings == NULL) {context->strings = Arena_new();}
+		if (m->groups == NULL) {
+			m->groups = (const char**)Arena_alloc(context->strings, sizeof(const char*) * m->count);
+			for (int j=0 ; j<m->count ; j++) {m->groups[j] = NULL;}
+		}
+		if (m->groups[index] == NULL) {
+			size_t length = m->spans[index].length;
+			char*  group  = (char*)Arena_alloc(context->strings, length + 1);
+			memcpy(group, TokenMatch_groupStart(match, index), length);
+			group[length]    = '\0';
+			m->groups[index] = group;
+		}
 		return m->groups[index];
 	} else {
 		return NULL;
@@ -1577,6 +2827,42 @@ int TokenMatch_count(Match* match) {
 	}
 }
 
+TokenMatch* TokenMatch_copy(Match* match, Arena* arena) {
+	assert (match                != NULL);
+	assert (match->data          != NULL);
+	TokenMatch*      m     = (TokenMatch*)match->data;
+	TokenMatch*      data  = NULL;
+	TokenMatchGroup* spans = NULL;
+	if (arena != NULL) {
+		data  = (TokenMatch*)Arena_alloc(arena, sizeof(TokenMatch));
+		spans = (TokenMatchGroup*)Arena_alloc(arena, sizeof(TokenMatchGroup) * m->count);
+	} else {
+		__NEW(TokenMatch, heap_data);
+		__ARRAY_NEW(heap_spans, TokenMatchGroup, m->count);
+		data  = heap_data;
+		spans = heap_spans;
+	}
+	memcpy(spans, m->spans, sizeof(TokenMatchGroup) * m->count);
+	data->count   = m->count;
+	data->spans   = spans;
+	// Group strings are shared with the original match, as they live as
+	// long as the context, but for the ones the match owns.
+	data->groups  = m->groups;
+	data->context = m->context;
+	data->owned   = m->owned;
+	if (m->owned) {
+		Match copy = *match;
+		copy.data  = data;
+		TokenMatch__own(&copy, arena);
+	}
+	return data;
+}
+
+void Token__first(ParsingElement* this, FirstSet* set) {
+	// The first set is computed when the token is created
+	*set = ((TokenConfig*)this->config)->first;
+}
+
 void Token_print(ParsingElement* this) {
 	TokenConfig* config = (TokenConfig*)this->config;
 	OUTPUT("Token:%c:%s#%d<%s>\n", this->type, this->name != NULL ? this->name : ANONYMOUS, this->id, config->expr);
@@ -1586,18 +2872,15 @@ void Token_print(ParsingElement* this) {
 void TokenMatch_free(Match* match) {
 	assert (match                != NULL);
 	assert (Match_getElementType(match) == TYPE_TOKEN);
-#ifdef WITH_PCRE
+	// NOTE: This is only called for heap matches (see `Match_copy`), the
+	// group strings belonging to the context, unless the match owns them.
 	TRACE("TokenMatch_free: %p, match->data=%p", match, match->data);
 	if (match->data != NULL) {
 		TokenMatch* m = (TokenMatch*)match->data;
-		if (m != NULL ) {
-			for (int j=0 ; j<m->count ; j++) {
-				pcre_free_substring(m->groups[j]);
-			}
-		}
-		__FREE(m->groups);
+		for (int j=0 ; m->owned && j<m->count ; j++) {__FREE((char*)m->groups[j]);}
+		if (m->owned) {__FREE(m->groups);}
+		__FREE(m->spans);
 	}
-#endif
 	__FREE(match->data);
 
 }
@@ -1608,6 +2891,15 @@ void TokenMatch_free(Match* match) {
 //
 // ----------------------------------------------------------------------------
 
+WordSet* Group__wordSets(ParsingElement* this, ParsingContext* context) {
+	Grammar* g = context->grammar;
+	if (g == NULL || g->wordSets == NULL || this->id < 0 || this->id >= g->wordSetsCount) {return NULL;}
+	// The words might only match after skipping input, in which case we
+	// need to try them in order.
+	if (g->skip != NULL && !HAS_FLAG(context->flags, FLAG_SKIPPING) && !ParsingContext_rejects(context, g->skip->id)) {return NULL;}
+	return g->wordSets[this->id];
+}
+
 ParsingElement* Group_new(Reference* children[]) {
 	ParsingElement* this = ParsingElement_new(children);
 	this->type           = TYPE_GROUP;
@@ -1618,20 +2910,40 @@ ParsingElement* Group_new(Reference* children[]) {
 Match* Group_recognize(ParsingElement* this, ParsingContext* context){
 
 	// The goal is to find ONE (and only one) matching element.
-	OUT_STEP("??? %s┌── Group " BOLDYELLOW "%s" RESET ":#%d at %zu:%zu[→%d]", context->indent, this->name, this->id, context->iterator->lines, context->iterator->offset, context->depth);
+	OUT_STEP("??? %s┌── Group " BOLDYELLOW "%s" RESET ":#%d at %zu:%zu[→%d]", context->indent, this->name, this->id, Iterator_getLine(context->iterator), context->iterator->offset, context->depth);
 	Match*     result           = NULL;
 	size_t     offset           = context->iterator->offset;
-	size_t     lines            = context->iterator->lines;
+	ArenaMark  mark             = Arena_mark(context->arena);
 	int        step             = 0;
 
 	// Note: we don't skip in groups, that,s the business of references
 	size_t     iteration_offset = context->iterator->offset;
 	Reference* child            = this->children;
 	Match*     match            = NULL;
+	WordSet*   words            = Group__wordSets(this, context);
+	size_t     cuts             = context->cuts;
 	step                        = 0;
 
 	while (child != NULL ) {
 		assert (match == NULL);
+		// A run of words is resolved in one pass, and we then only try
+		// the word that matched (if any).
+		if (words != NULL && words->start == step) {
+			int i   = WordSet_match(words, context->iterator->current, Iterator_remaining(context->iterator));
+			if (context->memo != NULL) {ParsingContext__reach(context, offset + words->longest);}
+			child   = i >= 0 ? words->words[i] : words->words[words->count - 1]->next;
+			step   += i >= 0 ? i : words->count;
+			words   = words->next;
+			if (child == NULL) {break;}
+			if (i < 0) {continue;}
+		}
+		// We don't even try the children that can't start with the
+		// next byte.
+		if (ParsingContext_rejects(context, child->id)) {
+			child  = child->next;
+			step  += 1;
+			continue;
+		}
 		match = Reference_recognize(child, context);
 
 		if (Match_isSuccess(match)) {
@@ -1640,33 +2952,126 @@ Match* Group_recognize(ParsingElement* this, ParsingContext* context){
 			result           = Match_Success(match->length, this, context);
 			result->offset   = iteration_offset;
 			result->children = match;
+			match->parent    = result;
 			child            = NULL;
 		} else {
-			// Otherwise we try the next child
+			// Otherwise we try the next child, releasing whatever the
+			// failed child allocated, unless the child failed past a cut.
 			match = Match_free(match);
-			child  = child->next;
+			Arena_rewind(context->arena, mark);
+			child  = context->cuts == cuts ? child->next : NULL;
 			step  += 1;
 		}
 	}
 
 	// We've either found one element, or nothing
 	if (Match_isSuccess(result)) {
-		OUT_STEP( "[✓] %s╘═⇒ Group " BOLDGREEN "%s" RESET "#%d[%d] matched" BOLDGREEN "%zu:%zu-%zu" RESET "[%zu][→%d]", context->indent, this->name, this->id, step,  context->iterator->lines, result->offset, context->iterator->offset, result->length, context->depth)
+		OUT_STEP( "[✓] %s╘═⇒ Group " BOLDGREEN "%s" RESET "#%d[%d] matched" BOLDGREEN "%zu:%zu-%zu" RESET "[%zu][→%d]", context->indent, this->name, this->id, step,  Iterator_getLine(context->iterator), result->offset, context->iterator->offset, result->length, context->depth)
 		return MATCH_STATS(result);
 	} else {
 		// If no child has succeeded, the whole group fails
-		OUT_STEP(" !  %s╘═⇒ Group " BOLDRED "%s" RESET "#%d[%d] failed at %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, step, context->iterator->lines, context->iterator->offset, offset, context->depth)
+		OUT_STEP(" !  %s╘═⇒ Group " BOLDRED "%s" RESET "#%d[%d] failed at %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, step, Iterator_getLine(context->iterator), context->iterator->offset, offset, context->depth)
 		result = Match_fail(result);
-		if (context->iterator->offset != offset ) {
-			Iterator_backtrack(context->iterator, offset, lines);
-			assert( context->iterator->offset == offset );
-		}
+		Arena_rewind(context->arena, mark);
+		ParsingContext_backtrack(context, offset);
+		assert( context->iterator->offset == MAX(offset, context->cut) || context->iterator->truncated );
 		return MATCH_STATS(FAILURE);
 	}
 
 }
 
 
+// ----------------------------------------------------------------------------
+//
+// WORD SET
+//
+// ----------------------------------------------------------------------------
+
+WordSet* WordSet_new(int start) {
+	__NEW(WordSet, this);
+	this->start         = start;
+	this->count         = 0;
+	this->words         = NULL;
+	this->nodes         = NULL;
+	this->nodesCount    = 0;
+	this->nodesCapacity = 0;
+	this->longest       = 0;
+	this->next          = NULL;
+	for (int i=0 ; i<256 ; i++) {this->root[i] = -1;}
+	return this;
+}
+
+void WordSet_free(WordSet* this) {
+	while (this != NULL) {
+		WordSet* next = this->next;
+		__FREE(this->words);
+		__FREE(this->nodes);
+		__FREE(this);
+		this = next;
+	}
+}
+
+int WordSet__node(WordSet* this, unsigned char byte) {
+	if (this->nodesCount == this->nodesCapacity) {
+		this->nodesCapacity = this->nodesCapacity == 0 ? 16 : this->nodesCapacity * 2;
+		__ARRAY_RESIZE(this->nodes, WordSetNode, this->nodesCapacity);
+	}
+	WordSetNode* node = &this->nodes[this->nodesCount];
+	node->byte    = byte;
+	node->word    = -1;
+	node->child   = -1;
+	node->sibling = -1;
+	return this->nodesCount++;
+}
+
+void WordSet_add(WordSet* this, Reference* word) {
+	const unsigned char* text = (const unsigned char*)((WordConfig*)word->element->config)->word;
+	// NOTE: `__ARRAY_RESIZE` doesn't parenthesize its count
+	int count = this->count + 1;
+	__ARRAY_RESIZE(this->words, Reference*, count);
+	this->words[this->count] = word;
+	if (this->root[text[0]] < 0) {this->root[text[0]] = WordSet__node(this, text[0]);}
+	int node = this->root[text[0]];
+	for (const unsigned char* c = text + 1 ; *c != '\0' ; c++) {
+		int child = this->nodes[node].child;
+		int last  = -1;
+		while (child >= 0 && this->nodes[child].byte != *c) {
+			last  = child;
+			child = this->nodes[child].sibling;
+		}
+		if (child < 0) {
+			// NOTE: `WordSet__node` might move the nodes
+			child = WordSet__node(this, *c);
+			if (last < 0) {this->nodes[node].child = child;} else {this->nodes[last].sibling = child;}
+		}
+		node = child;
+	}
+	// Words are added in order, so the first one that ends here wins
+	if (this->nodes[node].word < 0) {this->nodes[node].word = this->count;}
+	this->longest = MAX(this->longest, ((WordConfig*)word->element->config)->length);
+	this->count  += 1;
+}
+
+int WordSet_match(WordSet* this, const char* text, size_t length) {
+	const unsigned char* c      = (const unsigned char*)text;
+	const unsigned char* end    = c + length;
+	int                  node   = length > 0 ? this->root[*c] : -1;
+	int                  result = -1;
+	// We walk the input down the trie, keeping the first word (in the
+	// order of the group) that ends on the way.
+	while (node >= 0) {
+		WordSetNode* n = &this->nodes[node];
+		if (n->word >= 0 && (result < 0 || n->word < result)) {
+			result = n->word;
+			if (result == 0) {break;}
+		}
+		c   += 1;
+		node = c < end ? n->child : -1;
+		while (node >= 0 && this->nodes[node].byte != *c) {node = this->nodes[node].sibling;}
+	}
+	return result;
+}
+
 // ----------------------------------------------------------------------------
 //
 // RULE
@@ -1690,13 +3095,21 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
 	int         step      = 0;
 	const char* step_name = NULL;
 	size_t      offset    = context->iterator->offset;
-	size_t      lines     = context->iterator->lines;
+	ArenaMark   mark      = Arena_mark(context->arena);
 	Reference* child      = this->children;
 
-	OUT_STEP("??? %s┌── Rule:" BOLDYELLOW "%s" RESET " at %zu:%zu[→%d]", context->indent, this->name, context->iterator->lines, context->iterator->offset, context->depth);
+	OUT_STEP("??? %s┌── Rule:" BOLDYELLOW "%s" RESET " at %zu:%zu[→%d]", context->indent, this->name, Iterator_getLine(context->iterator), context->iterator->offset, context->depth);
+
+	// If the rule can't start with the next byte, we fail right away
+	if (ParsingContext_rejects(context, this->id)) {
+		OUT_STEP(" !  %s╘ Rule " BOLDRED "%s" RESET "#%d rejected at %zu:%zu[→%d]", context->indent, this->name, this->id, Iterator_getLine(context->iterator), offset, context->depth)
+		return MATCH_STATS(FAILURE);
+	}
 
-	// We create a new parsing variable context
-	ParsingContext_push(context);
+	// We create a new parsing variable context, which is only needed when
+	// the rule reaches a procedure or condition that could use it.
+	bool scoped = HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);
+	if (scoped) {ParsingContext_push(context);}
 
 	// We don't need to care wether the parsing context has more
 	// data, the Reference_recognize will take care of it.
@@ -1710,15 +3123,17 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
 
 		// We iterate over the children of the rule. We expect each child to
 		// match, and we might skip inbetween the children to find a match.
+		size_t cuts  = context->cuts;
+		if (child == context->commit) {ParsingContext__enclose(context, this, result, offset);}
 		Match* match = Reference_recognize(child, context);
 
 		// If the match is not a success, we will try to skip some input
-		// and try the match again.
+		// and try the match again, unless the child failed past a cut.
 		if (!Match_isSuccess(match)) {
 
 			// For safety, we free the failure
 			match = Match_free(match);
-			size_t skipped = ParsingElement_skip(this, context);
+			size_t skipped = context->cuts == cuts ? ParsingElement_skip(this, context) : 0;
 
 			// If we've skipped at least one input element, then we can
 			// try the match again.
@@ -1764,6 +3179,7 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
 			assert(last->next == NULL);
 			last = last->next = match;
 		}
+		match->parent = result;
 
 		// We log the step name, for debugging purposes
 		step_name = child->name;
@@ -1774,24 +3190,24 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
 	}
 
 	// We pop the parsing context
-	ParsingContext_pop(context);
+	if (scoped) {ParsingContext_pop(context);}
 
 	// We process the result
 	if (Match_isSuccess(result)) {
 		OUT_STEP("[✓] %s╘═⇒ Rule " BOLDGREEN "%s" RESET "#%d[%d] matched " BOLDGREEN "%zu:%zu-%zu" RESET "[%zub][→%d]",
-				context->indent, this->name, this->id, step, context->iterator->lines,  offset, context->iterator->offset, result->length, context->depth)
+				context->indent, this->name, this->id, step, Iterator_getLine(context->iterator),  offset, context->iterator->offset, result->length, context->depth)
 		// In case of a success, we update the length based on the last
 		// match.
 		result->length = last->offset - result->offset + last->length;
 	} else {
 		OUT_STEP(" !  %s╘ Rule " BOLDRED "%s" RESET "#%d failed on step %d=%s at %zu:%zu-%zu[→%d]",
-				context->indent, this->name, this->id, step, step_name == NULL ? "-" : step_name, context->iterator->lines, offset, context->iterator->offset, context->depth)
+				context->indent, this->name, this->id, step, step_name == NULL ? "-" : step_name, Iterator_getLine(context->iterator), offset, context->iterator->offset, context->depth)
 		result = Match_fail(result);
+		// We release the partial matches
+		Arena_rewind(context->arena, mark);
 		// If we had a failure, then we backtrack the iterator
-		if (offset != context->iterator->offset) {
-			Iterator_backtrack(context->iterator, offset, lines);
-			assert( context->iterator->offset == offset );
-		}
+		ParsingContext_backtrack(context, offset);
+		assert( context->iterator->offset == MAX(offset, context->cut) || context->iterator->truncated );
 	}
 
 	return MATCH_STATS(result);
@@ -1838,8 +3254,8 @@ Match*  Condition_recognize(ParsingElement* this, ParsingContext* context) {
 	if (this->config != NULL) {
 		bool value    = ((ConditionCallback)this->config)(this, context);
 		Match* result = value == TRUE ? Match_Success(0, this, context) : FAILURE;
-		OUT_STEP_IF(Match_isSuccess(result), "[✓] %s└ Condition " BOLDGREEN "%s" RESET "#%d matched %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, context->iterator->lines, context->iterator->offset - result->length, context->iterator->offset, context->depth)
-		OUT_STEP_IF(!Match_isSuccess(result), " !  %s└ Condition " BOLDRED "%s" RESET "#%d failed at %zu:%zu[→%d]",  context->indent, this->name, this->id, context->iterator->lines, context->iterator->offset, context->depth)
+		OUT_STEP_IF(Match_isSuccess(result), "[✓] %s└ Condition " BOLDGREEN "%s" RESET "#%d matched %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, Iterator_getLine(context->iterator), context->iterator->offset - result->length, context->iterator->offset, context->depth)
+		OUT_STEP_IF(!Match_isSuccess(result), " !  %s└ Condition " BOLDRED "%s" RESET "#%d failed at %zu:%zu[→%d]",  context->indent, this->name, this->id, Iterator_getLine(context->iterator), context->iterator->offset, context->depth)
 		return  MATCH_STATS(result);
 	} else {
 		OUT_STEP("[✓] %s└ Condition %s#%d matched by default at %zu", context->indent, this->name, this->id, context->iterator->offset);
@@ -1851,158 +3267,419 @@ Match*  Condition_recognize(ParsingElement* this, ParsingContext* context) {
 
 // ----------------------------------------------------------------------------
 //
-// PARSING VARIABLE
+// CUT
 //
 // ----------------------------------------------------------------------------
 
-ParsingVariable* ParsingVariable_new(int depth, const char* key, void* value) {
-	__NEW(ParsingVariable, this);
-	this->depth    = depth;
-	__STRING_COPY(this->key, key);
-	this->value    = value;
-	this->previous = NULL;
+ParsingElement* Cut_new(void) {
+	ParsingElement* this = ParsingElement_new(NULL);
+	this->type      = TYPE_CUT;
+	this->recognize = Cut_recognize;
 	return this;
 }
 
-void ParsingVariable_free(ParsingVariable* this) {
-	if (this!=NULL) {
-		__FREE(this->key);
-		__FREE(this);
+Match*  Cut_recognize(ParsingElement* this, ParsingContext* context) {
+	// The skip element is recognized apart from the rest of the parse, so
+	// it doesn't commit it.
+	if (!HAS_FLAG(context->flags, FLAG_SKIPPING)) {
+		size_t offset  = context->iterator->offset;
+		// The recognitions that are going on count the cuts, to tell if
+		// they failed past one (see `Rule_recognize`).
+		context->cuts += 1;
+		context->cut   = offset;
+		if (context->memo != NULL) {context->memo->floor = offset;}
+		Iterator_commit(context->iterator, offset);
+		OUT_STEP("[✓] %s└ Cut " BOLDGREEN "%s" RESET "#%d committed at %zu:%zu", context->indent, this->name, this->id, Iterator_getLine(context->iterator), offset)
 	}
+	return MATCH_STATS(Match_Success(0, this, context));
 }
 
-void ParsingVariable_freeAll(ParsingVariable* this) {
-	ParsingVariable* current = this;
-	while (current!=NULL) {
-		ParsingVariable* to_free = current;
-		current = current->previous;
-		ParsingVariable_free(to_free);
-	}
+// ----------------------------------------------------------------------------
+//
+// PARSING VARIABLE
+//
+// ----------------------------------------------------------------------------
+
+ParsingVariables* ParsingVariables_new(void) {
+	__NEW(ParsingVariables, this);
+	__ARRAY_NEW(items, ParsingVariable, PARSING_VARIABLES_CAPACITY);
+	__ARRAY_NEW(keys,  char*,           PARSING_VARIABLES_CAPACITY);
+	this->items        = items;
+	this->count        = 0;
+	this->capacity     = PARSING_VARIABLES_CAPACITY;
+	this->keys         = keys;
+	this->keysCount    = 0;
+	this->keysCapacity = PARSING_VARIABLES_CAPACITY;
+	this->depth        = 0;
+	// The `depth` key is always 0
+	ParsingVariables_key(this, "depth");
+	return this;
 }
 
-int ParsingVariable_getDepth(ParsingVariable* this) {
-	return this == NULL ? -1 : this->depth;
+void ParsingVariables_free(ParsingVariables* this) {
+	if (this != NULL) {
+		for (int i=0 ; i<this->keysCount ; i++) {__FREE(this->keys[i]);}
+		__FREE(this->keys);
+		__FREE(this->items);
+		__FREE(this);
+	}
 }
 
-const char* ParsingVariable_getName(ParsingVariable* this) {
-	return (const char*)this->key;
+int ParsingVariables_key(ParsingVariables* this, const char* name) {
+	assert(name != NULL);
+	// There are only a few distinct names, so a linear search is fine
+	for (int i=0 ; i<this->keysCount ; i++) {
+		if (strcmp(this->keys[i], name) == 0) {return i;}
+	}
+	if (this->keysCount == this->keysCapacity) {
+		this->keysCapacity *= 2;
+		__RESIZE(this->keys, sizeof(char*) * this->keysCapacity);
+	}
+	__STRING_COPY(this->keys[this->keysCount], name);
+	return this->keysCount++;
 }
 
-void* ParsingVariable_get(ParsingVariable* this, const char* name) {
-	ParsingVariable* found = ParsingVariable_find(this, name, FALSE);
-	return found != NULL ? found->value : NULL;
+const char* ParsingVariables_getName(ParsingVariables* this, int key) {
+	return (key >= 0 && key < this->keysCount) ? this->keys[key] : NULL;
 }
 
-bool ParsingVariable_is(ParsingVariable* this, const char* key) {
-	if (this == NULL || key == NULL) {return FALSE;}
-	return (key == this->key || strcmp(this->key, key)) == 0 ? TRUE : FALSE;
+void ParsingVariables_push(ParsingVariables* this) {
+	this->depth += 1;
 }
 
-ParsingVariable* ParsingVariable_find(ParsingVariable* this, const char* key, bool local) {
-	ParsingVariable* current=this;
-	while (current!=NULL) {
-		if (ParsingVariable_is(current, key)) {
-			return current;
-		}
-		if (current->previous!=NULL) {
-			// When local is TRUE, we stop the search when the depth changes
-			current = (local && current->previous->depth != current->depth) ? NULL : current->previous;
-		} else {
-			current = NULL;
-		}
+void ParsingVariables_pop(ParsingVariables* this) {
+	if (this->depth <= 0) {return;}
+	// Variables are ordered by depth, so the current scope's are last
+	while (this->count > 0 && this->items[this->count - 1].depth >= this->depth) {
+		this->count--;
 	}
-	return current;
+	this->depth -= 1;
 }
 
-ParsingVariable* ParsingVariable_set(ParsingVariable* this, const char* key, void* value) {
-	ParsingVariable* found = ParsingVariable_find(this, key, TRUE);
-	if (found == NULL) {
-		found = ParsingVariable_new( this->depth, key, value );
-		found->previous = this;
-		return found;
-	} else {
-		found->value = value;
-		return found;
+void* ParsingVariables_get(ParsingVariables* this, int key) {
+	for (int i=this->count - 1 ; i>=0 ; i--) {
+		if (this->items[i].key == key) {return this->items[i].value;}
 	}
+	// The depth is implicit, unless it was explicitly set
+	return key == 0 ? (void*)(long)this->depth : NULL;
 }
 
-ParsingVariable* ParsingVariable_push(ParsingVariable* this) {
-	int depth            = this == NULL ? 0 : ParsingVariable_getDepth(this) + 1;
-	ParsingVariable* res = ParsingVariable_new(depth, "depth", (void*)(long)depth);
-	res->previous        = this;
-	return res;
+void ParsingVariables_set(ParsingVariables* this, int key, void* value) {
+	// We look for the variable in the current scope only
+	for (int i=this->count - 1 ; i>=0 && this->items[i].depth == this->depth ; i--) {
+		if (this->items[i].key == key) {this->items[i].value = value; return;}
+	}
+	if (this->count == this->capacity) {
+		this->capacity *= 2;
+		__RESIZE(this->items, sizeof(ParsingVariable) * this->capacity);
+	}
+	ParsingVariable* v = &(this->items[this->count++]);
+	v->depth = this->depth;
+	v->key   = key;
+	v->value = value;
 }
 
-ParsingVariable* ParsingVariable_pop(ParsingVariable* this) {
-	if (this == NULL) {return NULL;}
-	ParsingVariable* current  = this;
-	int depth = this->depth;
-	while (current != NULL && current->depth >= depth) {
-		ParsingVariable* to_free  = current;
-		current = current->previous;
-		ParsingVariable_free(to_free);
-	}
-	return current;
+void ParsingVariables_clear(ParsingVariables* this) {
+	this->count = 0;
+	this->depth = 0;
 }
 
-int  ParsingVariable_count(ParsingVariable* this) {
-	ParsingVariable* current = this;
-	int count = 0;
-	while (current!=NULL) {
-		current = current->previous;
-		count++;
-	}
-	return count;
+int  ParsingVariables_count(ParsingVariables* this) {
+	return this->count;
 }
 
 // ----------------------------------------------------------------------------
 //
-// PARSING CONTEXT
+// MEMO
 //
 // ----------------------------------------------------------------------------
 
-ParsingContext* ParsingContext_new( Grammar* g, Iterator* iterator ) {
-	__NEW(ParsingContext, this);
-	this->grammar      = g;
-	this->iterator     = iterator;
-	this->stats        = ParsingStats_new();
-	this->freeIterator = FALSE;
-	if (g != NULL) {
-		ParsingStats_setSymbolsCount(this->stats, g->axiomCount + g->skipCount);
+#define MEMO_INITIAL_CAPACITY 1024
+
+size_t Memo__slot(Memo* this, int id, size_t offset) {
+	// NOTE: Offsets are the most discriminating part of the key, so we
+	// spread them with a multiplicative hash and mix in the id.
+	size_t h = (offset * 2654435761U) ^ ((size_t)id * 40503U);
+	return h & (this->capacity - 1);
+}
+
+void Memo__allocate(Memo* this, size_t capacity) {
+	__ARRAY_NEW(entries, MemoEntry, capacity);
+	for (size_t i=0 ; i<capacity ; i++) {
+		entries[i].id    = ID_UNBOUND;
+		entries[i].match = NULL;
 	}
-	this->depth     = 0;
-	this->variables = ParsingVariable_new(0, "depth", 0);
-	this->callback  = NULL;
-	this->indent    = INDENT + (INDENT_MAX * INDENT_WIDTH);
-	this->flags     = 0;
-	this->lastMatchOffset = 0;
-	this->lastMatchLength = 0;
-	this->lastMatchElementID = -1;
+	this->entries  = entries;
+	this->capacity = capacity;
+	this->count    = 0;
+}
+
+Memo* Memo_new(size_t limit) {
+	__NEW(Memo, this);
+	this->limit   = limit;
+	this->floor   = 0;
+	this->evicted = 0;
+	Memo__allocate(this, MEMO_INITIAL_CAPACITY);
+	this->bytes = sizeof(MemoEntry) * this->capacity;
 	return this;
 }
 
-void ParsingContext_free( ParsingContext* this ) {
-	// NOTE: We don't need to free the last match, the grammar;
-	if (this!=NULL) {
-		if (this->freeIterator) {Iterator_free(this->iterator);}
-		ParsingVariable_freeAll(this->variables);
-		ParsingStats_free(this->stats);
-		__FREE(this);
+void Memo_clear(Memo* this) {
+	if (this == NULL) {return;}
+	for (size_t i=0 ; i<this->capacity ; i++) {
+		MemoEntry* entry = &(this->entries[i]);
+		if (entry->id != ID_UNBOUND) {
+			if (entry->match != FAILURE) {Match_free(entry->match);}
+			entry->id    = ID_UNBOUND;
+			entry->match = NULL;
+		}
 	}
+	this->count   = 0;
+	this->bytes   = sizeof(MemoEntry) * this->capacity;
+	this->floor   = 0;
+	this->evicted = 0;
 }
 
-char* ParsingContext_text( ParsingContext* this ) {
-	return this->iterator->buffer;
+void Memo_free(Memo* this) {
+	if (this != NULL) {
+		Memo_clear(this);
+		__FREE(this->entries);
+	}
+	__FREE(this);
 }
 
-char ParsingContext_charAt ( ParsingContext* this, size_t offset ) {
-	return Iterator_charAt(this->iterator, offset);
+MemoEntry* Memo_get(Memo* this, int id, size_t offset) {
+	// We use open addressing with linear probing, the table always
+	// having empty slots.
+	size_t mask = this->capacity - 1;
+	size_t i    = Memo__slot(this, id, offset);
+	while (this->entries[i].id != ID_UNBOUND) {
+		MemoEntry* entry = &(this->entries[i]);
+		if (entry->id == id && entry->offset == offset) {return entry;}
+		i = (i + 1) & mask;
+	}
+	return NULL;
 }
 
+void Memo__insert(Memo* this, MemoEntry* entry) {
+	size_t mask = this->capacity - 1;
+	size_t i    = Memo__slot(this, entry->id, entry->offset);
+	while (this->entries[i].id != ID_UNBOUND) {i = (i + 1) & mask;}
+	this->entries[i] = *entry;
+	this->count     += 1;
+}
 
-void ParsingContext_push     ( ParsingContext* this ) {
-	this->variables = ParsingVariable_push(this->variables);
-	if (this->callback != NULL) {this->callback(this, '+');}
+void Memo__grow(Memo* this) {
+	MemoEntry* entries  = this->entries;
+	size_t     capacity = this->capacity;
+	Memo__allocate(this, capacity * 2);
+	for (size_t i=0 ; i<capacity ; i++) {
+		if (entries[i].id != ID_UNBOUND) {Memo__insert(this, &(entries[i]));}
+	}
+	this->bytes += sizeof(MemoEntry) * capacity;
+	__FREE(entries);
+}
+
+void Memo_evict(Memo* this, size_t offset) {
+	// Entries can't be removed from the slots they probe, so we insert
+	// the ones we keep in new slots.
+	MemoEntry* entries = this->entries;
+	size_t     bytes   = this->bytes;
+	Memo__allocate(this, this->capacity);
+	for (size_t i=0 ; i<this->capacity ; i++) {
+		if (entries[i].id == ID_UNBOUND) {continue;}
+		if (entries[i].offset >= offset) {
+			Memo__insert(this, &(entries[i]));
+		} else {
+			if (entries[i].match != FAILURE) {Match_free(entries[i].match);}
+			bytes -= entries[i].bytes;
+		}
+	}
+	this->bytes   = bytes;
+	this->evicted = offset;
+	__FREE(entries);
+}
+
+void Memo_set(Memo* this, int id, size_t offset, size_t end, size_t reach, Match* match) {
+	assert(Memo_get(this, id, offset) == NULL);
+	MemoEntry entry;
+	entry.id     = id;
+	entry.offset = offset;
+	entry.end    = end;
+	entry.reach  = reach;
+	entry.shift  = 0;
+	entry.lines  = 0;
+	entry.bytes  = 0;
+	entry.match  = Match_copy(match, NULL, &(entry.bytes));
+	// When the table is full, we first evict the entries that are before
+	// the last cut, if there are new ones.
+	bool full    = (this->count + 1) * 4 > this->capacity * 3 || this->bytes + entry.bytes > this->limit;
+	if (full && this->floor > this->evicted) {Memo_evict(this, this->floor);}
+	// We grow the table when it is 3/4 full, unless that would exceed
+	// the limit, in which case we start over with an empty table.
+	if ((this->count + 1) * 4 > this->capacity * 3) {
+		if (this->bytes + entry.bytes + sizeof(MemoEntry) * this->capacity > this->limit) {
+			Memo_clear(this);
+		} else {
+			Memo__grow(this);
+		}
+	}
+	if (this->bytes + entry.bytes > this->limit) {
+		Memo_clear(this);
+		// If the entry alone does not fit, we don't memoize it
+		if (this->bytes + entry.bytes > this->limit) {
+			if (entry.match != FAILURE) {Match_free(entry.match);}
+			return;
+		}
+	}
+	Memo__insert(this, &entry);
+	this->bytes += entry.bytes;
+}
+
+void Memo_reuse(Memo* this, Memo* from, size_t offset, size_t removed, size_t inserted, int lines) {
+	size_t end = offset + removed;
+	for (size_t i=0 ; i<from->capacity ; i++) {
+		MemoEntry entry = from->entries[i];
+		if (entry.id == ID_UNBOUND) {continue;}
+		from->entries[i].id    = ID_UNBOUND;
+		from->entries[i].match = NULL;
+		// The entries that examined the edited bytes are dropped, as well
+		// as the ones that don't fit in the table.
+		bool reused = entry.reach <= offset || entry.offset >= end;
+		if (reused && (this->count + 1) * 4 > this->capacity * 3) {
+			if (this->bytes + entry.bytes + sizeof(MemoEntry) * this->capacity > this->limit) {
+				reused = FALSE;
+			} else {
+				Memo__grow(this);
+			}
+		}
+		if (!reused || this->bytes + entry.bytes > this->limit) {
+			if (entry.match != FAILURE) {Match_free(entry.match);}
+			continue;
+		}
+		// The matches are shifted when they are copied (see `Match__copy`)
+		if (entry.offset >= end) {
+			entry.offset = entry.offset - removed + inserted;
+			entry.end    = entry.end    - removed + inserted;
+			entry.reach  = entry.reach  - removed + inserted;
+			entry.shift += (long)inserted - (long)removed;
+			entry.lines += lines;
+		}
+		Memo__insert(this, &entry);
+		this->bytes += entry.bytes;
+	}
+	from->count = 0;
+	from->bytes = sizeof(MemoEntry) * from->capacity;
+}
+
+// ----------------------------------------------------------------------------
+//
+// PARSING CONTEXT
+//
+// ----------------------------------------------------------------------------
+
+ParsingContext* ParsingContext_new( Grammar* g, Iterator* iterator ) {
+	__NEW(ParsingContext, this);
+	this->grammar      = g;
+	this->iterator     = NULL;
+	this->stats        = ParsingStats_new();
+	this->freeIterator = FALSE;
+	this->variables    = ParsingVariables_new();
+	this->memo         = NULL;
+	this->arena        = Arena_new();
+	this->strings      = NULL;
+	this->next         = NULL;
+	this->matchData    = NULL;
+	this->engine       = NULL;
+	ParsingContext_reset(this, iterator);
+	return this;
+}
+
+void ParsingContext_reset( ParsingContext* this, Iterator* iterator ) {
+	Grammar* g = this->grammar;
+	if (this->freeIterator && this->iterator != iterator) {Iterator_free(this->iterator);}
+	this->iterator     = iterator;
+	this->freeIterator = FALSE;
+	// The grammar might have been prepared again, or its memoization
+	// changed, since the context was used.
+	size_t symbols = g != NULL ? (size_t)(g->axiomCount + g->skipCount + 1) : 0;
+	if (g != NULL && this->stats->symbolsCount != symbols) {
+		ParsingStats_setSymbolsCount(this->stats, symbols);
+	} else {
+		ParsingStats_reset(this->stats);
+	}
+	if (g == NULL || g->memoLimit == 0) {
+		Memo_free(this->memo);
+		this->memo = NULL;
+	} else if (this->memo == NULL) {
+		this->memo = Memo_new(g->memoLimit);
+	} else {
+		if (this->memo->count > 0) {Memo_clear(this->memo);}
+		this->memo->limit = g->memoLimit;
+	}
+	ParsingVariables_clear(this->variables);
+	Arena_reset(this->arena);
+	Arena_reset(this->strings);
+	this->depth     = 0;
+	this->callback  = NULL;
+	this->indent    = INDENT + (INDENT_MAX * INDENT_WIDTH);
+	this->flags     = 0;
+	this->lastMatchOffset = 0;
+	this->lastMatchLength = 0;
+	this->lastMatchElementID = -1;
+	this->reach     = 0;
+	this->processor = NULL;
+	this->listener  = NULL;
+	this->commit    = NULL;
+	this->enclosing = NULL;
+	this->opened    = FALSE;
+	this->skipOffset = SIZE_MAX;
+	this->skipEnd    = 0;
+	this->skipReach  = 0;
+	this->cuts       = 0;
+	this->cut        = 0;
+	this->budget     = g != NULL ? g->budget : 0;
+	this->exceeded   = FALSE;
+	this->profiler   = NULL;
+	this->tooDeep    = FALSE;
+	// Every rule needs to push a scope when procedures or conditions can
+	// run outside of the rules that reference them, and when the depth
+	// is displayed.
+	if (g != NULL && (g->isVerbose || (g->skip != NULL && HAS_FLAG(g->skip->flags, ELEMENT_CONTEXTUAL)))) {
+		SET_FLAG(this->flags, FLAG_SCOPED);
+	}
+}
+
+void ParsingContext_free( ParsingContext* this ) {
+	// NOTE: We don't need to free the last match, the grammar;
+	if (this!=NULL) {
+		if (this->freeIterator) {Iterator_free(this->iterator);}
+		ParsingVariables_free(this->variables);
+		ParsingStats_free(this->stats);
+		Memo_free(this->memo);
+		Arena_free(this->arena);
+		Arena_free(this->strings);
+		Engine_free(this->engine);
+#ifdef WITH_PCRE2
+		if (this->matchData != NULL) {pcre2_match_data_free((pcre2_match_data*)this->matchData);}
+#endif
+		ParsingContext_free(this->next);
+		__FREE(this);
+	}
+}
+
+char* ParsingContext_text( ParsingContext* this ) {
+	return this->iterator->buffer;
+}
+
+char ParsingContext_charAt ( ParsingContext* this, size_t offset ) {
+	return Iterator_charAt(this->iterator, offset);
+}
+
+
+void ParsingContext_push     ( ParsingContext* this ) {
+	ParsingVariables_push(this->variables);
+	if (this->callback != NULL) {this->callback(this, '+');}
 	this->depth += 1;
 	if (this->depth >= 0) {
 		int d = this->depth % INDENT_MAX;
@@ -2012,7 +3689,7 @@ void ParsingContext_push     ( ParsingContext* this ) {
 
 void ParsingContext_pop      ( ParsingContext* this ) {
 	if (this->callback != NULL) {this->callback(this, '-');}
-	this->variables = ParsingVariable_pop(this->variables);
+	ParsingVariables_pop(this->variables);
 	this->depth -= 1;
 	if (this->depth <= 0) {
 		this->indent = INDENT + INDENT_MAX * INDENT_WIDTH;
@@ -2023,37 +3700,83 @@ void ParsingContext_pop      ( ParsingContext* this ) {
 }
 
 void* ParsingContext_get(ParsingContext* this, const char* name) {
-	return ParsingVariable_get(this->variables, name);
+	return ParsingVariables_get(this->variables, ParsingVariables_key(this->variables, name));
 }
 
 int ParsingContext_getInt(ParsingContext* this, const char* name) {
-	return (int)(long)(ParsingVariable_get(this->variables, name));
+	return (int)(long)(ParsingContext_get(this, name));
 }
 
 void ParsingContext_set(ParsingContext*  this, const char* name, void* value) {
-	this->variables = ParsingVariable_set(this->variables, name, value);
+	ParsingVariables_set(this->variables, ParsingVariables_key(this->variables, name), value);
 }
 
 void ParsingContext_setInt(ParsingContext*  this, const char* name, int value) {
-	this->variables = ParsingVariable_set(this->variables, name, (void*)(long)value);
+	ParsingContext_set(this, name, (void*)(long)value);
+}
+
+int ParsingContext_key(ParsingContext* this, const char* name) {
+	return ParsingVariables_key(this->variables, name);
+}
+
+void* ParsingContext_getVariable(ParsingContext* this, int key) {
+	return ParsingVariables_get(this->variables, key);
+}
+
+void ParsingContext_setVariable(ParsingContext* this, int key, void* value) {
+	ParsingVariables_set(this->variables, key, value);
 }
 
 void ParsingContext_on(ParsingContext* this, ContextCallback callback) {
 	this->callback = callback;
+	// The callback is notified of every scope
+	if (callback != NULL) {SET_FLAG(this->flags, FLAG_SCOPED);}
 }
 
 int  ParsingContext_getVariableCount(ParsingContext* this) {
-	return ParsingVariable_count(this->variables);
+	return ParsingVariables_count(this->variables);
+}
+
+void ParsingContext_backtrack(ParsingContext* this, size_t offset) {
+	if (offset < this->cut) {offset = this->cut;}
+	if (this->iterator->offset != offset) {Iterator_backtrack(this->iterator, offset);}
 }
 
 size_t ParsingContext_getOffset(ParsingContext* this) {
 	return this->iterator->offset;
 }
 
+size_t ParsingContext_account( ParsingContext* this ) {
+	ParsingStats*     stats     = this->stats;
+	Iterator*         iterator  = this->iterator;
+	ParsingVariables* variables = this->variables;
+	// Push iterators allocate more than their capacity, as they grow
+	PushInput*        push      = iterator != NULL ? Iterator__pushInput(iterator) : NULL;
+	stats->bytesMatches   = this->arena->allocated + (this->strings != NULL ? this->strings->allocated : 0);
+	stats->bytesInput     = iterator == NULL || !iterator->freeBuffer ? 0 : push != NULL ? push->size : iterator->capacity;
+	stats->bytesVariables = sizeof(ParsingVariable) * variables->capacity + sizeof(char*) * variables->keysCapacity;
+	stats->bytesMemo      = this->memo != NULL ? this->memo->bytes : 0;
+	return stats->bytesMatches + stats->bytesInput + stats->bytesVariables + stats->bytesMemo;
+}
+
+bool ParsingContext_rejects(ParsingContext* this, int id) {
+	Grammar* g = this->grammar;
+	// NOTE: We need at least one byte of input, as the byte past the
+	// available data might not be loaded yet.
+	if (g == NULL || g->first == NULL || id < 0 || id > g->axiomCount + g->skipCount || Iterator_remaining(this->iterator) == 0) {
+		return FALSE;
+	}
+	FirstSet*     set = &(g->first[id]);
+	unsigned char c   = (unsigned char)*(this->iterator->current);
+	return !set->nullable && !FIRST_HAS(set, c);
+}
+
 Match* ParsingContext_registerMatch(ParsingContext* this, Element* e, Match* m) {
 	// We don't register skipping matches, as they'll be discarded right away
 	if (HAS_FLAG(this->flags, FLAG_SKIPPING)) {return m;}
+#ifdef WITH_STATS
 	ParsingStats_registerMatch(this->stats, e, m);
+#endif
 	// NOTE: We make sure to only register the deepest match, as the grammar
 	// is likely to backtack and yield a partial match, erasing where the error
 	// actually lies. We skip empty matches.
@@ -2067,6 +3790,124 @@ Match* ParsingContext_registerMatch(ParsingContext* this, Element* e, Match* m)
 	return m;
 }
 
+// ----------------------------------------------------------------------------
+//
+// CONTEXT POOL
+//
+// ----------------------------------------------------------------------------
+
+#ifdef WITH_THREADS
+// Guards the lazy preparation of grammars shared by several threads
+pthread_mutex_t Grammar__lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void Grammar__ensurePrepared(Grammar* this) {
+#ifdef WITH_THREADS
+	pthread_mutex_lock(&Grammar__lock);
+#endif
+	if (this->elements == NULL) {Grammar_prepare(this);}
+#ifdef WITH_THREADS
+	pthread_mutex_unlock(&Grammar__lock);
+#endif
+}
+
+void Grammar_setPool ( Grammar* this, int size ) {
+	ContextPool* pool = this->pool;
+	if (pool == NULL && size > 0) {
+		__NEW(ContextPool, p);
+		p->contexts = NULL;
+		p->count    = 0;
+		p->lock     = NULL;
+#ifdef WITH_THREADS
+		__NEW(pthread_mutex_t, lock);
+		pthread_mutex_init(lock, NULL);
+		p->lock     = lock;
+#endif
+		this->pool  = pool = p;
+	}
+	if (pool == NULL) {return;}
+	pool->size = MAX(size, 0);
+	// We free the contexts that don't fit anymore
+	while (pool->count > pool->size) {
+		ParsingContext* context = pool->contexts;
+		pool->contexts = context->next;
+		pool->count   -= 1;
+		context->next  = NULL;
+		ParsingContext_free(context);
+	}
+	if (size <= 0) {
+#ifdef WITH_THREADS
+		pthread_mutex_destroy((pthread_mutex_t*)pool->lock);
+		__FREE(pool->lock);
+#endif
+		__FREE(pool);
+		this->pool = NULL;
+	}
+}
+
+// Returns a context for the given iterator, reused from the pool if
+// possible.
+ParsingContext* Grammar__acquireContext(Grammar* this, Iterator* iterator) {
+	ContextPool*    pool    = this->pool;
+	ParsingContext* context = NULL;
+	if (pool != NULL) {
+#ifdef WITH_THREADS
+		pthread_mutex_lock((pthread_mutex_t*)pool->lock);
+#endif
+		context = pool->contexts;
+		if (context != NULL) {
+			pool->contexts = context->next;
+			pool->count   -= 1;
+			context->next  = NULL;
+		}
+#ifdef WITH_THREADS
+		pthread_mutex_unlock((pthread_mutex_t*)pool->lock);
+#endif
+	}
+	if (context == NULL) {
+		return ParsingContext_new(this, iterator);
+	} else {
+		ParsingContext_reset(context, iterator);
+		return context;
+	}
+}
+
+// Tells if the context is small enough to be kept in a pool. Contexts
+// that own other contexts are not kept either.
+bool ParsingContext__isPoolable(ParsingContext* this) {
+	return this->next == NULL
+		&& this->arena->allocated <= CONTEXT_POOL_ARENA_LIMIT
+		&& (this->strings == NULL || this->strings->allocated <= CONTEXT_POOL_ARENA_LIMIT)
+		&& (this->memo    == NULL || this->memo->capacity * sizeof(MemoEntry) <= CONTEXT_POOL_ARENA_LIMIT)
+		&& (this->engine  == NULL || this->engine->capacity * sizeof(EngineFrame) <= CONTEXT_POOL_ARENA_LIMIT);
+}
+
+// Gives the context back to the pool, or frees it when it is not worth
+// keeping.
+void Grammar__releaseContext(Grammar* this, ParsingContext* context) {
+	ContextPool* pool = this->pool;
+	if (pool == NULL || !ParsingContext__isPoolable(context)) {
+		ParsingContext_free(context);
+		return;
+	}
+	// The iterator (and the input it holds, such as files) is released
+	// right away.
+	ParsingContext_reset(context, NULL);
+#ifdef WITH_THREADS
+	pthread_mutex_lock((pthread_mutex_t*)pool->lock);
+#endif
+	bool pooled = pool->count < pool->size;
+	if (pooled) {
+		context->next  = pool->contexts;
+		pool->contexts = context;
+		pool->count   += 1;
+	}
+#ifdef WITH_THREADS
+	pthread_mutex_unlock((pthread_mutex_t*)pool->lock);
+#endif
+	if (!pooled) {ParsingContext_free(context);}
+}
+
 // ----------------------------------------------------------------------------
 //
 // PARSING STATS
@@ -2077,12 +3918,21 @@ ParsingStats* ParsingStats_new(void) {
 	__NEW(ParsingStats,this);
 	this->bytesRead = 0;
 	this->parseTime = 0;
+	this->symbolsCount    = 0;
 	this->successBySymbol = NULL;
 	this->failureBySymbol = NULL;
+	this->bytesBySymbol   = NULL;
+	this->timeBySymbol    = NULL;
 	this->failureOffset   = 0;
 	this->matchOffset     = 0;
 	this->matchLength     = 0;
 	this->failureElement  = NULL;
+	this->memoHits        = 0;
+	this->memoMisses      = 0;
+	this->bytesMatches    = 0;
+	this->bytesInput      = 0;
+	this->bytesVariables  = 0;
+	this->bytesMemo       = 0;
 	return this;
 }
 
@@ -2090,6 +3940,8 @@ void ParsingStats_free(ParsingStats* this) {
 	if (this != NULL) {
 		__FREE(this->successBySymbol);
 		__FREE(this->failureBySymbol);
+		__FREE(this->bytesBySymbol);
+		__FREE(this->timeBySymbol);
 	}
 	__FREE(this);
 }
@@ -2097,31 +3949,64 @@ void ParsingStats_free(ParsingStats* this) {
 void ParsingStats_setSymbolsCount(ParsingStats* this, size_t t) {
 	__ARRAY_RESIZE(this->successBySymbol, size_t, t);
 	__ARRAY_RESIZE(this->failureBySymbol, size_t, t);
+	__ARRAY_RESIZE(this->bytesBySymbol,   size_t, t);
+	__ARRAY_RESIZE(this->timeBySymbol,    double, t);
+	for (size_t i=0 ; i<t ; i++) {
+		this->successBySymbol[i] = 0;
+		this->failureBySymbol[i] = 0;
+		this->bytesBySymbol[i]   = 0;
+		this->timeBySymbol[i]    = 0;
+	}
 	this->symbolsCount    = t;
 }
 
+void ParsingStats_reset(ParsingStats* this) {
+	for (size_t i=0 ; i<this->symbolsCount ; i++) {
+		this->successBySymbol[i] = 0;
+		this->failureBySymbol[i] = 0;
+		this->bytesBySymbol[i]   = 0;
+		this->timeBySymbol[i]    = 0;
+	}
+	this->bytesRead       = 0;
+	this->parseTime       = 0;
+	this->failureOffset   = 0;
+	this->matchOffset     = 0;
+	this->matchLength     = 0;
+	this->failureElement  = NULL;
+	this->memoHits        = 0;
+	this->memoMisses      = 0;
+	this->bytesMatches    = 0;
+	this->bytesInput      = 0;
+	this->bytesVariables  = 0;
+	this->bytesMemo       = 0;
+}
+
 Match* ParsingStats_registerMatch(ParsingStats* this, Element* e, Match* m) {
-	// FIXME: This is broken!
 	// We can convert ParsingElements to Reference and vice-versa as they
-	// have the same start sequence (char type, int id).
-	// Reference* r = (Reference*)e;
-	// if (m!=NULL && Match_isSuccess(m)) {
-	// 	this->successBySymbol[r->id] += 1;
-	// 	if (m->offset >= this->matchOffset) {
-	// 		this->matchOffset = m->offset;
-	// 		this->matchLength = m->length;
-	// 	}
-	// } else {
-	// 	this->failureBySymbol[r->id] += 1;
-	// 	// We register the deepest failure
-	// 	if(m != NULL && m->offset >= this->failureOffset) {
-	// 		this->failureOffset  = m->offset;
-	// 		this->failureElement = m->element;
-	// 	}
-	// }
+	// have the same start sequence (char type, int id). Elements that are
+	// not bound to the grammar have a negative id.
+	int id = e->id;
+	if (id < 0 || (size_t)id >= this->symbolsCount) {return m;}
+	if (m != NULL && Match_isSuccess(m)) {
+		this->successBySymbol[id] += 1;
+		this->bytesBySymbol[id]   += m->length;
+	} else {
+		this->failureBySymbol[id] += 1;
+	}
 	return m;
 }
 
+size_t ParsingStats_attempts(ParsingStats* this, int id) {
+	if (id < 0 || (size_t)id >= this->symbolsCount) {return 0;}
+	return this->successBySymbol[id] + this->failureBySymbol[id];
+}
+
+double ParsingStats_now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec / 1000000000.0;
+}
+
 // ----------------------------------------------------------------------------
 //
 // PARSING RESULT
@@ -2135,7 +4020,23 @@ ParsingResult* ParsingResult_new(Match* match, ParsingContext* context) {
 	assert(context->iterator != NULL);
 	this->match   = match;
 	this->context = context;
-	if (match != FAILURE && context->iterator->offset > 0) {
+	if (context->exceeded) {
+		LOG_IF(context->grammar->isVerbose, "Exceeded the budget of %zu bytes at %zu", context->budget, context->iterator->offset)
+		this->status = STATUS_EXCEEDED;
+	} else if (context->tooDeep) {
+		LOG_IF(context->grammar->isVerbose, "Nested deeper than %zu frames at %zu", context->grammar->maxDepth, context->iterator->offset)
+		this->status = STATUS_TOO_DEEP;
+	} else if (context->iterator->truncated) {
+		// The parser backtracked before the iterator's window, so the match
+		// cannot be trusted.
+		LOG_IF(context->grammar->isVerbose, "Failed, backtracked before the iterator's window at %zu", context->iterator->offset)
+		this->status = STATUS_FAILED;
+	} else if (Iterator__pushInput(context->iterator) != NULL && !Iterator__pushInput(context->iterator)->ended && context->reach > Iterator_bufferOffset(context->iterator) + context->iterator->available) {
+		// The parse examined the end of the fed data, so more data could
+		// change its outcome.
+		LOG_IF(context->grammar->isVerbose, "Incomplete, examined the input up to %zu, %zu bytes fed", context->reach, context->iterator->available)
+		this->status = STATUS_INCOMPLETE;
+	} else if (match != FAILURE && context->iterator->offset > 0) {
 		if (Iterator_hasMore(context->iterator) && Iterator_remaining(context->iterator) > 0) {
 			LOG_IF(context->grammar->isVerbose, "Partial success, parsed %zu bytes, %zu remaining", context->iterator->offset, Iterator_remaining(context->iterator));
 			this->status = STATUS_PARTIAL;
@@ -2163,6 +4064,18 @@ bool ParsingResult_isSuccess(ParsingResult* this) {
 	return this->status == STATUS_SUCCESS;
 }
 
+bool ParsingResult_isIncomplete(ParsingResult* this) {
+	return this->status == STATUS_INCOMPLETE;
+}
+
+bool ParsingResult_isExceeded(ParsingResult* this) {
+	return this->status == STATUS_EXCEEDED;
+}
+
+bool ParsingResult_isTooDeep(ParsingResult* this) {
+	return this->status == STATUS_TOO_DEEP;
+}
+
 char* ParsingResult_text(ParsingResult* this) {
 	return this->context->iterator->buffer;
 }
@@ -2172,142 +4085,1141 @@ size_t ParsingResult_remaining(ParsingResult* this) {
 }
 
 int ParsingResult_textOffset(ParsingResult* this) {
-	int buffer_offset = this->context->iterator->current - this->context->iterator->buffer;
-	return this->context->iterator->offset - buffer_offset;
+	return (int)Iterator_bufferOffset(this->context->iterator);
 }
 
 void ParsingResult_free(ParsingResult* this) {
 	if (this != NULL) {
+		// NOTE: Matches are allocated in the context's arena, so this does
+		// not traverse the match tree, which is released along with the
+		// context's arena.
 		this->match = Match_free(this->match);
-		ParsingContext_free(this->context);
+		if (this->context != NULL && this->context->grammar != NULL && this->context->grammar->pool != NULL) {
+			Grammar__releaseContext(this->context->grammar, this->context);
+		} else {
+			ParsingContext_free(this->context);
+		}
 	}
 	__FREE(this);
 }
 
 // ----------------------------------------------------------------------------
 //
-// GRAMMAR
+// MATCH TREE
 //
 // ----------------------------------------------------------------------------
 
-int Grammar__resetElementIDs(Element* e, int step, void* nothing) {
-	if (Reference_Is(e)) {
-		Reference* r = (Reference*)e;
-		if (r->id != ID_BINDING) {
-			TRACE("Grammar__resetElementIDs: reset reference %d %s [%d]", r->id, r->name, step)
-			r->id = ID_BINDING;
-			return step;
-		} else {
-			return -1;
-		}
-	} else {
-		ParsingElement * r = (ParsingElement*)e;
-		if (r->id != ID_BINDING) {
-			TRACE("Grammar__resetElementIDs: reset parsing element %d %s [%d]", r->id, r->name, step)
-			r->id = ID_BINDING;
-			return step;
-		} else {
-			return -1;
-		}
+int MatchTree__count(Match* match, int step, void* tree) {
+	MatchTree* this = (MatchTree*)tree;
+	this->count += 1;
+	if (match->data != NULL && Match_getElementType(match) == TYPE_TOKEN) {
+		this->groupsCount += ((TokenMatch*)match->data)->count;
 	}
+	return step;
 }
 
-int Grammar__assignElementIDs(Element* e, int step, void* nothing) {
-	if (Reference_Is(e)) {
-		Reference* r = (Reference*)e;
-		if (r->id == ID_BINDING) {
-			r->id = step;
-			DEBUG_IF(r->name != NULL, "[%03d] [%c] %s", r->id, r->type, r->name);
-			return step;
-		} else {
-			return -1;
-		}
-	} else {
-		ParsingElement * r = (ParsingElement*)e;
-		if (r->id == ID_BINDING) {
-			r->id = step;
-			DEBUG_IF(r->name != NULL, "[%03d] [%c] %s", r->id, r->type, r->name);
-			return step;
-		} else {
-			return -1;
+// Adds the match and its next siblings to the tree, returning the index
+// of the match's node.
+int MatchTree__add(MatchTree* this, Match* match, int parent) {
+	int first    = this->count;
+	int previous = -1;
+	for ( ; match != NULL ; match = match->next) {
+		int        i    = this->count++;
+		// The nodes are allocated upfront, so they don't move
+		MatchNode* node = &this->nodes[i];
+		node->element     = match->element->id;
+		node->parent      = parent;
+		node->children    = -1;
+		node->next        = -1;
+		node->groups      = this->groupsCount;
+		node->groupsCount = 0;
+		node->offset      = match->offset;
+		node->length      = match->length;
+		if (match->data != NULL && Match_getElementType(match) == TYPE_TOKEN) {
+			TokenMatch* data = (TokenMatch*)match->data;
+			memcpy(this->groups + this->groupsCount, data->spans, sizeof(TokenMatchGroup) * data->count);
+			node->groupsCount  = data->count;
+			this->groupsCount += data->count;
 		}
+		if (previous >= 0)          {this->nodes[previous].next = i;}
+		if (match->children != NULL) {node->children = MatchTree__add(this, match->children, i);}
+		previous = i;
+	}
+	return first;
+}
+
+MatchTree* MatchTree_new(ParsingResult* result) {
+	assert(result != NULL);
+	__NEW(MatchTree, this);
+	ParsingContext* context = result->context;
+	this->status       = result->status;
+	this->nodes        = NULL;
+	this->count        = 0;
+	this->groups       = NULL;
+	this->groupsCount  = 0;
+	this->grammar      = context->grammar;
+	this->text         = context->iterator->buffer;
+	this->textOffset   = Iterator_bufferOffset(context->iterator);
+	this->textLength   = context->iterator->available;
+	this->iterator     = context->iterator;
+	this->freeIterator = FALSE;
+	this->mapped       = NULL;
+	if (Match_isSuccess(result->match)) {
+		Match__walk(result->match, MatchTree__count, 0, this);
+		__ARRAY_NEW(nodes,  MatchNode,       (size_t)this->count);
+		__ARRAY_NEW(groups, TokenMatchGroup, (size_t)MAX(this->groupsCount, 1));
+		this->nodes       = nodes;
+		this->groups      = groups;
+		this->count       = 0;
+		this->groupsCount = 0;
+		MatchTree__add(this, result->match, -1);
 	}
+	return this;
 }
 
-int Grammar__registerElement(Element* e, int step, void* grammar) {
-	Reference* r  = (Reference*)e;
-	Grammar*   g  = (Grammar*)grammar;
-	r->id         = r->id;
-	Element*   ge = g->elements[r->id];
-	if (ge == NULL) {
-		TRACE("Grammar__registerElement:  %3d %c %s", r->id, r->type, r->name);
-		g->elements[r->id] = e;
-		return step;
-	} else {
-		return -1;
+MatchTree* MatchTree_FromResult(ParsingResult* result) {
+	MatchTree* this = MatchTree_new(result);
+	// The tree takes over the iterator (and the input), which would
+	// otherwise be freed along with the context.
+	this->freeIterator = result->context->freeIterator;
+	result->context->freeIterator = FALSE;
+	ParsingResult_free(result);
+	return this;
+}
+
+void MatchTree_free(MatchTree* this) {
+	if (this != NULL) {
+		if (this->freeIterator) {Iterator_free(this->iterator);}
+		if (this->mapped != NULL) {MappedInput_free(this->mapped);}
+		__FREE(this->nodes);
+		__FREE(this->groups);
 	}
+	__FREE(this);
 }
 
-void Grammar_prepare ( Grammar* this ) {
-	if (this->skip!=NULL)  {
-		this->skip->id = 0;
+Element* MatchTree_element(MatchTree* this, int node) {
+	assert(node >= 0 && node < this->count);
+	return this->grammar->elements[this->nodes[node].element];
+}
+
+const char* MatchTree_groupStart(MatchTree* this, int node, int index) {
+	assert(node >= 0 && node < this->count);
+	assert(index >= 0 && index < this->nodes[node].groupsCount);
+	TokenMatchGroup* group = &this->groups[this->nodes[node].groups + index];
+	if (this->text == NULL || group->offset < this->textOffset || group->offset + group->length > this->textOffset + this->textLength) {
+		return NULL;
 	}
-	if (this->axiom!=NULL) {
-		// We would need to free elements if they were already allocated
-		if (this->elements) { __FREE(this->elements) ; this->elements = NULL; }
-		assert(this->elements == NULL);
+	return this->text + (group->offset - this->textOffset);
+}
 
-		TRACE("Grammar_prepare: resetting element IDs %c", ' ')
-		ParsingElement_walk(this->axiom, Grammar__resetElementIDs, NULL);
-		if (this->skip != NULL) {
-			ParsingElement_walk(this->skip, Grammar__resetElementIDs, NULL);
-		}
+int MatchTree_groupLength(MatchTree* this, int node, int index) {
+	assert(node >= 0 && node < this->count);
+	assert(index >= 0 && index < this->nodes[node].groupsCount);
+	return (int)this->groups[this->nodes[node].groups + index].length;
+}
 
-		TRACE("Grammar_prepare: assigning new element IDs %c", ' ')
-		int count = ParsingElement_walk(this->axiom, Grammar__assignElementIDs, NULL);
-		this->axiomCount = count;
-		if (this->skip != NULL) {
-			this->skipCount = ParsingElement__walk(this->skip, Grammar__assignElementIDs, count + 1, NULL) - count;
+int MatchTree_walk(MatchTree* this, MatchTreeWalkingCallback callback, int step, void* context) {
+	// The nodes are in preorder, so that the walk doesn't need to follow
+	// the indexes.
+	for (int i=0 ; i<this->count ; i++) {
+		if (i > 0) {step += 1;}
+		step = callback(this, i, step, context);
+		if (step < 0) {break;}
+	}
+	return step;
+}
+
+void MatchTree_export(MatchTree* this, int* elements, int* parents, size_t* offsets, size_t* lengths, int* groups, size_t* spans) {
+	for (int i=0 ; i<this->count ; i++) {
+		MatchNode* node = &this->nodes[i];
+		if (elements != NULL) {elements[i] = node->element;}
+		if (parents  != NULL) {parents[i]  = node->parent;}
+		if (offsets  != NULL) {offsets[i]  = node->offset;}
+		if (lengths  != NULL) {lengths[i]  = node->length;}
+		if (groups   != NULL) {groups[i]   = node->groups;}
+	}
+	// The groups are stored in preorder, so that the groups of a node end
+	// where the ones of the next node start.
+	if (groups != NULL) {groups[this->count] = this->groupsCount;}
+	if (spans  != NULL) {
+		for (int i=0 ; i<this->groupsCount ; i++) {
+			spans[i * 2]     = this->groups[i].offset;
+			spans[i * 2 + 1] = this->groups[i].length;
 		}
+	}
+}
 
-		// Now we register the elements
-		__ARRAY_NEW(elements, Element*, this->skipCount + this->axiomCount + 1);
-		this->elements = elements;
+// Writes the given group, escaped when `escaped` is set. Groups whose
+// input was discarded are written as empty.
+void MatchTree__writeGroup(MatchTree* this, int node, int index, Output* output, bool escaped) {
+	const char* start = MatchTree_groupStart(this, node, index);
+	if (start == NULL) {return;}
+	if (escaped) {OUTPUT_ESCAPED(start, MatchTree_groupLength(this, node, index));}
+	else         {Output_write(output, start, (size_t)MatchTree_groupLength(this, node, index));}
+}
 
-		count = ParsingElement_walk(this->axiom, Grammar__registerElement, this);
-		if (this->skip != NULL) {
-			ParsingElement__walk(this->skip, Grammar__registerElement, count, this);
-		}
+bool MatchTree__isWritten(MatchTree* this, int node) {
+	ParsingElement* element = ParsingElement_Ensure(MatchTree_element(this, node));
+	return element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION && element->type != TYPE_CUT;
+}
 
-		#ifdef WITH_TRACE
-		int j = this->skipCount + this->axiomCount + 1;
-		TRACE("Grammar_prepare:  skip=%d + axiom=%d = total=%d symbols", this->skipCount, this->axiomCount, j);
-		for (int i=0 ; i < j ; i++) {
-			Element* element = this->elements[i];
-			if (element == NULL) {
-			} else if (element->type == TYPE_REFERENCE) {
-				TRACE("Grammar_prepare:  Reference    %4d %c %-20s [%4d/%4d]", element->id, element->type, element->name, i, j - 1);
-			} else {
-				TRACE("Grammar_prepare:  Element      %4d %c %-20s [%4d/%4d]", element->id, element->type, element->name, i, j - 1);
+void MatchTree__childrenWriteJSON(MatchTree* this, int node, Output* output) {
+	int count = 0;
+	for (int child = this->nodes[node].children ; child >= 0 ; child = this->nodes[child].next) {
+		if (MatchTree__isWritten(this, child)) {count += 1;}
+	}
+	int i = 0;
+	for (int child = this->nodes[node].children ; child >= 0 ; child = this->nodes[child].next) {
+		if (MatchTree__isWritten(this, child)) {
+			MatchTree__writeJSON(this, child, output);
+			if ( (i+1) < count ) {
+				OUTPUT_WRITE(",");
 			}
+			i += 1;
 		}
-		#endif
 	}
 }
 
-ParsingResult* Grammar_parseIterator( Grammar* this, Iterator* iterator ) {
-	// We make sure the grammar is prepared before we start parsing
-	if (this->elements == NULL) {Grammar_prepare(this);}
+void MatchTree__writeJSON(MatchTree* this, int node, Output* output) {
+	if (node < 0) {
+		OUTPUT_WRITE("null");
+		return;
+	}
+	MatchNode*      match   = &this->nodes[node];
+	ParsingElement* element = (ParsingElement*)MatchTree_element(this, node);
+	if (element->type == TYPE_REFERENCE) {
+		Reference* ref = (Reference*)element;
+		if (ref->cardinality == CARDINALITY_ONE || ref->cardinality == CARDINALITY_NOT_EMPTY || ref->cardinality == CARDINALITY_OPTIONAL) {
+			MatchTree__writeJSON(this, match->children, output);
+		} else {
+			OUTPUT_WRITE("[");
+			MatchTree__childrenWriteJSON(this, node, output);
+			OUTPUT_WRITE("]");
+		}
+		return;
+	}
+	switch(element->type) {
+		case TYPE_WORD:
+			JSON_ELEMENT_START(element);
+			OUTPUT_WRITE(",\"value\":\"");OUTPUT_ESCAPED(Word_word(element), strlen(Word_word(element)));OUTPUT_WRITE("\"");
+			JSON_ELEMENT_END(element);
+			break;
+		case TYPE_TOKEN:
+			JSON_ELEMENT_START(element);
+			if (match->groupsCount == 1) {
+				OUTPUT_WRITE(",\"value\":\"");MatchTree__writeGroup(this, node, 0, output, TRUE);OUTPUT_WRITE("\"");
+			} else if (match->groupsCount > 1) {
+				OUTPUT_WRITE(",\"content\":[");
+				for (int i=0 ; i < match->groupsCount ; i++) {
+					OUTPUT_WRITE("\"");MatchTree__writeGroup(this, node, i, output, TRUE);OUTPUT_WRITE("\"");
+					if (i+1 < match->groupsCount) {OUTPUT_WRITE(",");}
+				}
+				OUTPUT_WRITE("]");
+			}
+			JSON_ELEMENT_END(element);
+			break;
+		case TYPE_GROUP:
+		case TYPE_RULE:
+			JSON_ELEMENT_START(element);
+			if (match->children >= 0) {
+				OUTPUT_WRITE(",\"content\":[");
+				MatchTree__childrenWriteJSON(this, node, output);
+				OUTPUT_WRITE("]");
+			}
+			JSON_ELEMENT_END(element);
+			break;
+		case TYPE_PROCEDURE:
+		case TYPE_CONDITION:
+		case TYPE_CUT:
+			break;
+		default:
+			OUTPUT_WRITEF("\"ERROR:undefined element type=%c\"", element->type);
+	}
+}
+
+void MatchTree_outputJSON(MatchTree* this, Output* output) {
+	MatchTree__writeJSON(this, this->count > 0 ? 0 : -1, output);
+}
+
+void MatchTree_writeJSON(MatchTree* this, int fd) {
+	Output* output = Output_ToFile(fd);
+	MatchTree_outputJSON(this, output);
+	Output_free(output);
+}
+
+void MatchTree__childrenWriteXML(MatchTree* this, int node, Output* output) {
+	for (int child = this->nodes[node].children ; child >= 0 ; child = this->nodes[child].next) {
+		if (MatchTree__isWritten(this, child)) {
+			MatchTree__writeXML(this, child, output);
+		}
+	}
+}
+
+void MatchTree__writeXML(MatchTree* this, int node, Output* output) {
+	if (node < 0) {
+		return;
+	}
+	MatchNode*      match   = &this->nodes[node];
+	ParsingElement* element = (ParsingElement*)MatchTree_element(this, node);
+	if (element->type == TYPE_REFERENCE) {
+		Reference* ref = (Reference*)element;
+		if (ref->cardinality == CARDINALITY_ONE || ref->cardinality == CARDINALITY_NOT_EMPTY || ref->cardinality == CARDINALITY_OPTIONAL) {
+			MatchTree__writeXML(this, match->children, output);
+		} else {
+			MatchTree__childrenWriteXML(this, node, output);
+		}
+		return;
+	}
+	switch(element->type) {
+		case TYPE_WORD:
+			if (element->name != NULL) {
+				OUTPUT_WRITE("<");
+				WRITE_ELEMENT_NAME(element);
+				OUTPUT_WRITE("/>");
+			}
+			break;
+		case TYPE_TOKEN:
+			if (match->groupsCount == 0) {
+				if (element->name != NULL) {
+					OUTPUT_WRITE("<");
+					WRITE_ELEMENT_NAME(element);
+					OUTPUT_WRITE("/>");
+				}
+			} else if (match->groupsCount == 1) {
+				if (element->name != NULL) {
+					OUTPUT_WRITE("<");
+					WRITE_ELEMENT_NAME(element);
+					OUTPUT_WRITE(" t=\"");
+					MatchTree__writeGroup(this, node, 0, output, FALSE);
+					OUTPUT_WRITE("\"/>");
+				} else {
+					MatchTree__writeGroup(this, node, 0, output, FALSE);
+				}
+			} else if (element->name != NULL) {
+				WRITE_ELEMENT_START(element);
+				for (int i=0 ; i < match->groupsCount ; i++) {
+					OUTPUT_WRITE("<g t=\"");
+					MatchTree__writeGroup(this, node, i, output, FALSE);
+					OUTPUT_WRITE("\"/>");
+				}
+				WRITE_ELEMENT_END(element);
+			}
+			break;
+		case TYPE_GROUP:
+			// Groups only write their first child, as `Match__writeXML` does
+			if (match->children >= 0) {
+				WRITE_ELEMENT_START(element);
+				MatchTree__writeXML(this, match->children, output);
+				WRITE_ELEMENT_END(element);
+			}
+			break;
+		case TYPE_RULE:
+			if (match->children >= 0) {
+				WRITE_ELEMENT_START(element);
+				MatchTree__childrenWriteXML(this, node, output);
+				WRITE_ELEMENT_END(element);
+			}
+			break;
+		case TYPE_PROCEDURE:
+		case TYPE_CONDITION:
+		case TYPE_CUT:
+			break;
+		default:
+			OUTPUT_WRITEF("<error value=\"Undefined element type\" type=\"%c\" />", element->type);
+	}
+}
+
+void MatchTree_outputXML(MatchTree* this, Output* output) {
+	OUTPUT_WRITE("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n");
+	MatchTree__writeXML(this, this->count > 0 ? 0 : -1, output);
+}
+
+void MatchTree_writeXML(MatchTree* this, int fd) {
+	Output* output = Output_ToFile(fd);
+	MatchTree_outputXML(this, output);
+	Output_free(output);
+}
+
+// ----------------------------------------------------------------------------
+//
+// BINARY MATCH TREE
+//
+// ----------------------------------------------------------------------------
+
+// The size of the header, up to the varints
+#define MATCH_TREE_HEADER 15
+
+void MatchTree__writeVarint(Output* output, uint64_t value) {
+	char bytes[10];
+	int  n = 0;
+	do {
+		unsigned char byte = (unsigned char)(value & 0x7F);
+		value >>= 7;
+		bytes[n++] = (char)(value != 0 ? byte | 0x80 : byte);
+	} while (value != 0);
+	Output_write(output, bytes, (size_t)n);
+}
+
+void MatchTree__writeSigned(Output* output, int64_t value) {
+	MatchTree__writeVarint(output, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+// Reads the varint at the given offset, moving the offset past it. The
+// `valid` flag is cleared when the data ends before the varint does.
+uint64_t MatchTree__readVarint(const unsigned char* data, size_t length, size_t* offset, bool* valid) {
+	uint64_t value = 0;
+	for (int shift=0 ; shift < 64 ; shift += 7) {
+		if (*offset >= length) {break;}
+		unsigned char byte = data[(*offset)++];
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {return value;}
+	}
+	*valid = FALSE;
+	return 0;
+}
+
+int64_t MatchTree__readSigned(const unsigned char* data, size_t length, size_t* offset, bool* valid) {
+	uint64_t value = MatchTree__readVarint(data, length, offset, valid);
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+bool MatchTree_writeBinary(MatchTree* this, Output* output, int flags) {
+	bool withText = HAS_FLAG(flags, MATCH_TREE_TEXT);
+	if (withText && this->text == NULL) {return FALSE;}
+	char     header[MATCH_TREE_HEADER];
+	uint64_t fingerprint = Grammar_fingerprint(this->grammar);
+	memcpy(header, MATCH_TREE_MAGIC, 4);
+	header[4] = MATCH_TREE_FORMAT;
+	header[5] = (char)(flags & MATCH_TREE_TEXT);
+	for (int i=0 ; i<8 ; i++) {header[6 + i] = (char)((fingerprint >> (8 * i)) & 0xFF);}
+	header[14] = this->status;
+	Output_write(output, header, MATCH_TREE_HEADER);
+	MatchTree__writeVarint(output, (uint64_t)this->count);
+	MatchTree__writeVarint(output, (uint64_t)this->groupsCount);
+	MatchTree__writeVarint(output, withText ? this->textOffset : 0);
+	MatchTree__writeVarint(output, withText ? this->textLength : 0);
+	if (withText) {Output_write(output, this->text, this->textLength);}
+	for (int i=0 ; i<this->count ; i++) {
+		MatchNode* node   = &this->nodes[i];
+		size_t     base   = node->parent >= 0 ? this->nodes[node->parent].offset : 0;
+		MatchTree__writeVarint(output, (uint64_t)node->element);
+		MatchTree__writeVarint(output, (uint64_t)(node->parent >= 0 ? i - node->parent : 0));
+		MatchTree__writeSigned(output, (int64_t)node->offset - (int64_t)base);
+		MatchTree__writeVarint(output, node->length);
+		MatchTree__writeVarint(output, (uint64_t)node->groupsCount);
+		for (int j=0 ; j<node->groupsCount ; j++) {
+			TokenMatchGroup* group = &this->groups[node->groups + j];
+			MatchTree__writeSigned(output, (int64_t)group->offset - (int64_t)node->offset);
+			MatchTree__writeVarint(output, group->length);
+		}
+	}
+	return !output->failed;
+}
+
+MatchTree* MatchTree_FromBinary(Grammar* grammar, const char* data, size_t length) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	bool valid = data != NULL && length >= MATCH_TREE_HEADER && memcmp(data, MATCH_TREE_MAGIC, 4) == 0;
+	valid = valid && bytes[4] == MATCH_TREE_FORMAT && (bytes[5] & ~MATCH_TREE_TEXT) == 0;
+	if (valid) {
+		uint64_t fingerprint = 0;
+		for (int i=0 ; i<8 ; i++) {fingerprint |= (uint64_t)bytes[6 + i] << (8 * i);}
+		valid = fingerprint == Grammar_fingerprint(grammar);
+	}
+	if (!valid) {
+		errno = EINVAL;
+		return NULL;
+	}
+	size_t   offset      = MATCH_TREE_HEADER;
+	uint64_t count       = MatchTree__readVarint(bytes, length, &offset, &valid);
+	uint64_t spans       = MatchTree__readVarint(bytes, length, &offset, &valid);
+	uint64_t textOffset  = MatchTree__readVarint(bytes, length, &offset, &valid);
+	uint64_t textLength  = MatchTree__readVarint(bytes, length, &offset, &valid);
+	// Nodes take at least 5 bytes and groups 2, which bounds what we
+	// allocate for corrupted data.
+	valid = valid && count <= (length - offset) / 5 && spans <= (length - offset) / 2;
+	valid = valid && textLength <= length - offset;
+	if (!valid) {
+		errno = EINVAL;
+		return NULL;
+	}
+	__NEW(MatchTree, this);
+	__ARRAY_NEW(nodes,  MatchNode,       (size_t)MAX(count, 1));
+	__ARRAY_NEW(groups, TokenMatchGroup, (size_t)MAX(spans, 1));
+	this->status       = (char)bytes[14];
+	this->nodes        = nodes;
+	this->count        = (int)count;
+	this->groups       = groups;
+	this->groupsCount  = 0;
+	this->grammar      = grammar;
+	this->text         = HAS_FLAG(bytes[5], MATCH_TREE_TEXT) ? data + offset : NULL;
+	this->textOffset   = (size_t)textOffset;
+	this->textLength   = (size_t)textLength;
+	this->iterator     = NULL;
+	this->freeIterator = FALSE;
+	this->mapped       = NULL;
+	if (this->text != NULL) {offset += (size_t)textLength;}
+	int elements = grammar->axiomCount + grammar->skipCount + 1;
+	for (int i=0 ; valid && i<this->count ; i++) {
+		MatchNode* node     = &this->nodes[i];
+		uint64_t   element  = MatchTree__readVarint(bytes, length, &offset, &valid);
+		uint64_t   distance = MatchTree__readVarint(bytes, length, &offset, &valid);
+		valid = valid && element < (uint64_t)elements && grammar->elements[element] != NULL;
+		valid = valid && (i == 0 ? distance == 0 : distance >= 1 && distance <= (uint64_t)i);
+		if (!valid) {break;}
+		node->element  = (int)element;
+		node->parent   = i == 0 ? -1 : i - (int)distance;
+		node->children = -1;
+		node->next     = -1;
+		// The parent is the previous node or one of its ancestors, and the
+		// node is either its first child or the next sibling of its last one.
+		if (node->parent >= 0) {
+			int previous = -1;
+			int ancestor = i - 1;
+			while (ancestor >= 0 && ancestor != node->parent) {
+				previous = ancestor;
+				ancestor = this->nodes[ancestor].parent;
+			}
+			if (ancestor < 0) {valid = FALSE; break;}
+			if (previous < 0) {this->nodes[node->parent].children = i;}
+			else              {this->nodes[previous].next         = i;}
+		}
+		size_t base  = node->parent >= 0 ? this->nodes[node->parent].offset : 0;
+		node->offset = (size_t)((int64_t)base + MatchTree__readSigned(bytes, length, &offset, &valid));
+		node->length = (size_t)MatchTree__readVarint(bytes, length, &offset, &valid);
+		uint64_t groupsCount = MatchTree__readVarint(bytes, length, &offset, &valid);
+		valid = valid && groupsCount <= spans - (uint64_t)this->groupsCount;
+		node->groups      = this->groupsCount;
+		node->groupsCount = (int)groupsCount;
+		for (uint64_t j=0 ; valid && j<groupsCount ; j++) {
+			TokenMatchGroup* group = &this->groups[this->groupsCount++];
+			group->offset = (size_t)((int64_t)node->offset + MatchTree__readSigned(bytes, length, &offset, &valid));
+			group->length = (size_t)MatchTree__readVarint(bytes, length, &offset, &valid);
+		}
+	}
+	if (!valid || offset != length || (uint64_t)this->groupsCount != spans) {
+		MatchTree_free(this);
+		errno = EINVAL;
+		return NULL;
+	}
+	return this;
+}
+
+MatchTree* MatchTree_readBinary(Grammar* grammar, const char* path) {
+	MappedInput* input = MappedInput_new(path);
+	if (input == NULL) {
+		errno = ENOENT;
+		return NULL;
+	}
+	MatchTree* this = MatchTree_FromBinary(grammar, input->data, input->length);
+	if (this == NULL) {
+		MappedInput_free(input);
+		errno = EINVAL;
+	} else {
+		this->mapped = input;
+	}
+	return this;
+}
+
+// ----------------------------------------------------------------------------
+//
+// GRAMMAR
+//
+// ----------------------------------------------------------------------------
+
+int Grammar__resetElementIDs(Element* e, int step, void* nothing) {
+	if (Reference_Is(e)) {
+		Reference* r = (Reference*)e;
+		if (r->id != ID_BINDING) {
+			TRACE("Grammar__resetElementIDs: reset reference %d %s [%d]", r->id, r->name, step)
+			r->id = ID_BINDING;
+			return step;
+		} else {
+			return -1;
+		}
+	} else {
+		ParsingElement * r = (ParsingElement*)e;
+		if (r->id != ID_BINDING) {
+			TRACE("Grammar__resetElementIDs: reset parsing element %d %s [%d]", r->id, r->name, step)
+			r->id = ID_BINDING;
+			return step;
+		} else {
+			return -1;
+		}
+	}
+}
+
+int Grammar__assignElementIDs(Element* e, int step, void* nothing) {
+	if (Reference_Is(e)) {
+		Reference* r = (Reference*)e;
+		if (r->id == ID_BINDING) {
+			r->id = step;
+			DEBUG_IF(r->name != NULL, "[%03d] [%c] %s", r->id, r->type, r->name);
+			return step;
+		} else {
+			return -1;
+		}
+	} else {
+		ParsingElement * r = (ParsingElement*)e;
+		if (r->id == ID_BINDING) {
+			r->id = step;
+			DEBUG_IF(r->name != NULL, "[%03d] [%c] %s", r->id, r->type, r->name);
+			return step;
+		} else {
+			return -1;
+		}
+	}
+}
+
+int Grammar__registerElement(Element* e, int step, void* grammar) {
+	Reference* r  = (Reference*)e;
+	Grammar*   g  = (Grammar*)grammar;
+	r->id         = r->id;
+	Element*   ge = g->elements[r->id];
+	if (ge == NULL) {
+		TRACE("Grammar__registerElement:  %3d %c %s", r->id, r->type, r->name);
+		g->elements[r->id] = e;
+		return step;
+	} else {
+		return -1;
+	}
+}
+
+void Grammar__markContextual(Grammar* this) {
+	// Procedures and conditions are contextual, and so is any element
+	// that references a contextual element. We propagate the flag until
+	// we reach a fixed point, as grammars can be recursive.
+	int  count   = this->axiomCount + this->skipCount + 1;
+	bool changed = TRUE;
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e != NULL && ParsingElement_Is(e)) {
+			ParsingElement* pe = (ParsingElement*)e;
+			UNSET_FLAG(pe->flags, ELEMENT_CONTEXTUAL);
+			if (pe->type == TYPE_PROCEDURE || pe->type == TYPE_CONDITION) {
+				SET_FLAG(pe->flags, ELEMENT_CONTEXTUAL);
+			}
+		}
+	}
+	while (changed) {
+		changed = FALSE;
+		for (int i=0 ; i<count ; i++) {
+			Element* e = this->elements[i];
+			if (e == NULL || !ParsingElement_Is(e)) {continue;}
+			ParsingElement* pe = (ParsingElement*)e;
+			if (HAS_FLAG(pe->flags, ELEMENT_CONTEXTUAL)) {continue;}
+			Reference* child = pe->children;
+			while (child != NULL) {
+				if (HAS_FLAG(child->element->flags, ELEMENT_CONTEXTUAL)) {
+					SET_FLAG(pe->flags, ELEMENT_CONTEXTUAL);
+					changed = TRUE;
+					break;
+				}
+				child = child->next;
+			}
+		}
+	}
+}
+
+bool FirstSet__merge(FirstSet* this, FirstSet* other) {
+	bool changed = FALSE;
+	for (int i=0 ; i<32 ; i++) {
+		unsigned char b = this->bytes[i] | other->bytes[i];
+		if (b != this->bytes[i]) {this->bytes[i] = b; changed = TRUE;}
+	}
+	return changed;
+}
+
+bool Grammar__isWordReference(Reference* r) {
+	// We only consider references that succeed when (and only when) their
+	// first iteration does.
+	return r->element->type == TYPE_WORD && (r->cardinality == CARDINALITY_ONE || r->cardinality == CARDINALITY_MANY);
+}
+
+void Grammar__compileWordSets(Grammar* this) {
+	Grammar__freeWordSets(this);
+	int count = this->axiomCount + this->skipCount + 1;
+	__ARRAY_NEW(sets, WordSet*, count);
+	this->wordSets      = sets;
+	this->wordSetsCount = count;
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e == NULL || e->type != TYPE_GROUP) {continue;}
+		WordSet*   last  = NULL;
+		Reference* child = ((ParsingElement*)e)->children;
+		int        index = 0;
+		while (child != NULL) {
+			// We look for the end of the run of words starting at the child
+			Reference* end = child;
+			int        n   = 0;
+			while (end != NULL && Grammar__isWordReference(end)) {end = end->next; n++;}
+			if (n >= WORDSET_MINIMUM) {
+				WordSet* set = WordSet_new(index);
+				for (Reference* r = child ; r != end ; r = r->next) {WordSet_add(set, r);}
+				if (last == NULL) {sets[i] = set;} else {last->next = set;}
+				last = set;
+			}
+			index += n > 0 ? n : 1;
+			child  = n > 0 ? end : child->next;
+		}
+	}
+}
+
+void Grammar__computeFirst(Grammar* this) {
+	int count = this->axiomCount + this->skipCount + 1;
+	__FREE(this->first);
+	__ARRAY_NEW(first, FirstSet, count);
+	this->first = first;
+	// Terminals have a fixed FIRST set, procedures and conditions don't
+	// consume input.
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e == NULL || !ParsingElement_Is(e)) {continue;}
+		ParsingElement* pe = (ParsingElement*)e;
+		switch (pe->type) {
+			case TYPE_WORD:
+				FIRST_ADD(&first[i], ((WordConfig*)pe->config)->word[0]);
+				break;
+			case TYPE_TOKEN:
+				Token__first(pe, &first[i]);
+				break;
+			case TYPE_PROCEDURE:
+			case TYPE_CONDITION:
+			case TYPE_CUT:
+				first[i].nullable = TRUE;
+				break;
+		}
+	}
+	// References and rules skip input when a child fails, so their
+	// matches can start with any byte the skip element starts with.
+	FirstSet* skip = this->skip != NULL && this->skip->id >= 0 && this->skip->id < count ? &first[this->skip->id] : NULL;
+	// Sets only grow, so we iterate until we reach a fixed point, which
+	// takes care of recursive grammars.
+	bool changed = TRUE;
+	while (changed) {
+		changed = FALSE;
+		for (int i=0 ; i<count ; i++) {
+			Element* e = this->elements[i];
+			if (e == NULL) {continue;}
+			FirstSet* set      = &first[i];
+			bool      nullable = set->nullable;
+			if (Reference_Is(e)) {
+				Reference* r = (Reference*)e;
+				FirstSet*  f = &first[r->element->id];
+				changed  = FirstSet__merge(set, f) || changed;
+				if (skip != NULL) {changed = FirstSet__merge(set, skip) || changed;}
+				nullable = r->cardinality == CARDINALITY_OPTIONAL || r->cardinality == CARDINALITY_MANY_OPTIONAL || (f->nullable && r->cardinality != CARDINALITY_NOT_EMPTY);
+			} else if (e->type == TYPE_GROUP) {
+				nullable = FALSE;
+				Reference* child = ((ParsingElement*)e)->children;
+				while (child != NULL) {
+					changed  = FirstSet__merge(set, &first[child->id]) || changed;
+					nullable = nullable || first[child->id].nullable;
+					child    = child->next;
+				}
+			} else if (e->type == TYPE_RULE) {
+				nullable = TRUE;
+				Reference* child = ((ParsingElement*)e)->children;
+				while (child != NULL && nullable) {
+					changed  = FirstSet__merge(set, &first[child->id]) || changed;
+					nullable = first[child->id].nullable;
+					child    = child->next;
+				}
+				if (skip != NULL) {changed = FirstSet__merge(set, skip) || changed;}
+			}
+			if (nullable && !set->nullable) {
+				set->nullable = TRUE;
+				changed       = TRUE;
+			}
+		}
+	}
+	// Elements that depend on the context might execute procedures
+	// before failing, so we must not reject them early.
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e == NULL) {continue;}
+		ParsingElement* pe = Reference_Is(e) ? ((Reference*)e)->element : (ParsingElement*)e;
+		if (HAS_FLAG(pe->flags, ELEMENT_CONTEXTUAL)) {first[i].nullable = TRUE;}
+	}
+}
+
+// ----------------------------------------------------------------------------
+//
+// GRAMMAR OPTIMIZER
+//
+// ----------------------------------------------------------------------------
+
+// An element the optimizer puts in a list of children, standing for the
+// `origin` reference.
+typedef struct OptimizerItem {
+	Reference*       origin;
+	ParsingElement*  element;
+} OptimizerItem;
+
+typedef struct Optimizer {
+	Grammar*         grammar;
+	OptimizerItem*   items;
+	int              count;
+	int              capacity;
+} Optimizer;
+
+// The anonymous groups being flattened can contain themselves, which are
+// not followed beyond this depth.
+#define OPTIMIZER_DEPTH 16
+
+// Adds an element created by the optimizer at the end of the elements,
+// where it keeps the id of the element it stands for.
+void Grammar__derive(Grammar* this, Element* element, int id) {
+	int count = this->axiomCount + this->skipCount + 2;
+	__ARRAY_RESIZE(this->elements, Element*, count);
+	this->elements[count - 1] = element;
+	element->id               = id;
+	this->axiomCount         += 1;
+	this->derivedCount       += 1;
+}
+
+Reference* Grammar__deriveReference(Grammar* this, Reference* origin, ParsingElement* element) {
+	Reference* r   = Reference_new();
+	r->cardinality = origin->cardinality;
+	r->element     = element;
+	if (origin->name != NULL) {__STRING_COPY(r->name, origin->name);}
+	Grammar__derive(this, (Element*)r, origin->id);
+	return r;
+}
+
+void Optimizer__add(Optimizer* this, Reference* origin, ParsingElement* element) {
+	if (this->count == this->capacity) {
+		this->capacity = MAX(16, this->capacity * 2);
+		__ARRAY_RESIZE(this->items, OptimizerItem, this->capacity);
+	}
+	this->items[this->count].origin  = origin;
+	this->items[this->count].element = element;
+	this->count += 1;
+}
+
+// Tells if the element is an anonymous rule or group that only wraps its
+// single child. Rules that reach a procedure or a condition are kept, as
+// they scope the parsing variables.
+bool Optimizer__isTrivial(Optimizer* this, ParsingElement* e) {
+	Grammar* g = this->grammar;
+	if (e == g->axiom || e == g->skip || e->name != NULL || (e->type != TYPE_RULE && e->type != TYPE_GROUP)) {return FALSE;}
+	if (e->type == TYPE_RULE && HAS_FLAG(e->flags, ELEMENT_CONTEXTUAL)) {return FALSE;}
+	Reference* child = e->children;
+	return child != NULL && child->next == NULL && child->cardinality == CARDINALITY_ONE && child->name == NULL;
+}
+
+// Adds the items standing for the given child of `parent`, inlining and
+// flattening its element.
+void Optimizer__expand(Optimizer* this, ParsingElement* parent, Reference* child, int depth) {
+	Grammar*        g       = this->grammar;
+	ParsingElement* element = child->element;
+	if (HAS_FLAG(g->optimize, OPTIMIZE_INLINE)) {
+		// Elements that don't consume input can only be referenced once
+		// or optionally (see `Reference_recognize`).
+		bool once = child->cardinality == CARDINALITY_ONE || child->cardinality == CARDINALITY_OPTIONAL;
+		int  hops = 0;
+		while (Optimizer__isTrivial(this, element) && hops++ < g->axiomCount) {
+			ParsingElement* inlined = element->children->element;
+			if (!once && (inlined->type == TYPE_PROCEDURE || inlined->type == TYPE_CONDITION || inlined->type == TYPE_CUT)) {break;}
+			element = inlined;
+		}
+	}
+	if (HAS_FLAG(g->optimize, OPTIMIZE_FLATTEN) && parent->type == TYPE_GROUP && element->type == TYPE_GROUP
+	&& element != parent && element != g->axiom && element != g->skip && element->name == NULL
+	&& child->cardinality == CARDINALITY_ONE && child->name == NULL && depth < OPTIMIZER_DEPTH) {
+		for (Reference* r = element->children ; r != NULL ; r = r->next) {
+			Optimizer__expand(this, parent, r, depth + 1);
+		}
+	} else {
+		Optimizer__add(this, child, element);
+	}
+}
+
+// Removes the alternatives of the group that are never tried, or that
+// can't match.
+void Optimizer__removeDead(Optimizer* this) {
+	int count = 0;
+	for (int i=0 ; i<this->count ; i++) {
+		OptimizerItem* item = &this->items[i];
+		char           c    = item->origin->cardinality;
+		bool           dead = FALSE;
+		// Empty rules and groups always fail
+		if ((item->element->type == TYPE_RULE || item->element->type == TYPE_GROUP) && item->element->children == NULL) {
+			dead = c != CARDINALITY_OPTIONAL && c != CARDINALITY_MANY_OPTIONAL;
+		}
+		// An earlier alternative failed just the same, unless its outcome
+		// depends on the context.
+		for (int j=0 ; j<count && !dead ; j++) {
+			OptimizerItem* other = &this->items[j];
+			dead = other->element == item->element && other->origin->cardinality == c && !HAS_FLAG(item->element->flags, ELEMENT_CONTEXTUAL);
+		}
+		if (!dead) {this->items[count++] = *item;}
+		// The optional alternatives always succeed, unless they fail past
+		// a cut, which fails the group anyway.
+		if (!dead && (c == CARDINALITY_OPTIONAL || c == CARDINALITY_MANY_OPTIONAL)) {break;}
+	}
+	this->count = count;
+}
+
+// Merges the runs of anonymous words of the rule
+void Optimizer__mergeWords(Optimizer* this) {
+	int count = 0;
+	for (int i=0 ; i<this->count ; i++) {
+		OptimizerItem* item   = &this->items[i];
+		int            end    = i;
+		size_t         length = 0;
+		while (end < this->count && this->items[end].element->type == TYPE_WORD && this->items[end].element->name == NULL
+		&& this->items[end].origin->cardinality == CARDINALITY_ONE && this->items[end].origin->name == NULL) {
+			length += ((WordConfig*)this->items[end].element->config)->length;
+			end    += 1;
+		}
+		if (end - i > 1) {
+			__ARRAY_NEW(word, char, length + 1);
+			char* tail = word;
+			for (int j=i ; j<end ; j++) {
+				WordConfig* config = (WordConfig*)this->items[j].element->config;
+				memcpy(tail, config->word, config->length);
+				tail += config->length;
+			}
+			ParsingElement* merged = Word_new(word);
+			merged->flags          = item->element->flags;
+			__FREE(word);
+			Grammar__derive(this->grammar, (Element*)merged, item->element->id);
+			this->items[count].origin  = item->origin;
+			this->items[count].element = merged;
+			count += 1;
+			i      = end - 1;
+		} else {
+			this->items[count++] = *item;
+		}
+	}
+	this->count = count;
+}
+
+// Replaces the repetitions of tokens that match a single character with a
+// token that matches the whole run.
+void Optimizer__repeatTokens(Optimizer* this) {
+#if defined(WITH_PCRE) || defined(WITH_PCRE2)
+	Grammar* g     = this->grammar;
+	int      count = g->axiomCount + g->skipCount + 1;
+	for (int i=0 ; i<this->count ; i++) {
+		OptimizerItem*  item  = &this->items[i];
+		ParsingElement* token = item->element;
+		if (token->type != TYPE_TOKEN || (item->origin->cardinality != CARDINALITY_MANY && item->origin->cardinality != CARDINALITY_MANY_OPTIONAL)) {continue;}
+		const char* expr = ((TokenConfig*)token->config)->expr;
+		FirstSet    set;
+		memset(&set, 0, sizeof(FirstSet));
+		const char* end  = Token__class(expr, &set);
+		if (end == NULL || *end != '\0') {continue;}
+		// The token can be repeated more than once
+		ParsingElement* run = NULL;
+		for (int j=count - g->derivedCount ; j<count && run == NULL ; j++) {
+			Element* e = g->elements[j];
+			if (e->type == TYPE_TOKEN && e->id == token->id) {run = (ParsingElement*)e;}
+		}
+		if (run == NULL) {
+			__ARRAY_NEW(repeated, char, strlen(expr) + 2);
+			strcpy(repeated, expr);
+			strcat(repeated, "+");
+			run = Token_new(repeated);
+			__FREE(repeated);
+			if (run == NULL) {continue;}
+			if (token->name != NULL) {__STRING_COPY(run->name, token->name);}
+			run->flags = token->flags;
+			Grammar__derive(g, (Element*)run, token->id);
+			count += 1;
+		}
+		item->element = run;
+	}
+#endif
+}
+
+// Replaces the children of the element with the optimized ones, when
+// they differ.
+void Optimizer__rewrite(Optimizer* this, ParsingElement* element) {
+	Grammar* g  = this->grammar;
+	this->count = 0;
+	for (Reference* child = element->children ; child != NULL ; child = child->next) {
+		Optimizer__expand(this, element, child, 0);
+	}
+	if (element->type == TYPE_GROUP && HAS_FLAG(g->optimize, OPTIMIZE_DEAD)) {Optimizer__removeDead(this);}
+	// Words and repetitions can be separated by skipped input otherwise
+	if (g->skip == NULL) {
+		if (element->type == TYPE_RULE && HAS_FLAG(g->optimize, OPTIMIZE_WORDS)) {Optimizer__mergeWords(this);}
+		if (HAS_FLAG(g->optimize, OPTIMIZE_TOKENS)) {Optimizer__repeatTokens(this);}
+	}
+	bool       changed = FALSE;
+	Reference* child   = element->children;
+	for (int i=0 ; i<this->count ; i++) {
+		OptimizerItem* item = &this->items[i];
+		changed = changed || child != item->origin || child->element != item->element;
+		child   = child == NULL ? NULL : child->next;
+	}
+	if (!changed && child == NULL) {return;}
+	__NEW(Optimization, o);
+	o->element          = element;
+	o->children         = element->children;
+	o->next             = g->optimizations;
+	g->optimizations    = o;
+	Reference*     tail = NULL;
+	element->children   = NULL;
+	for (int i=0 ; i<this->count ; i++) {
+		Reference* r = Grammar__deriveReference(g, this->items[i].origin, this->items[i].element);
+		if (tail == NULL) {element->children = r;} else {tail->next = r;}
+		tail = r;
+	}
+}
+
+// Runs the grammar's optimizer passes over the elements it was built with
+void Grammar__optimize(Grammar* this) {
+	Optimizer optimizer = {.grammar=this, .items=NULL, .count=0, .capacity=0};
+	int       count     = this->axiomCount + this->skipCount + 1;
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e != NULL && (e->type == TYPE_RULE || e->type == TYPE_GROUP)) {
+			Optimizer__rewrite(&optimizer, (ParsingElement*)e);
+		}
+	}
+	__FREE(optimizer.items);
+}
+
+void Grammar_prepare ( Grammar* this ) {
+	if (this->skip!=NULL)  {
+		this->skip->id = 0;
+	}
+	if (this->axiom!=NULL) {
+		// We would need to free elements if they were already allocated, the
+		// optimized ones being restored first.
+		if (this->elements) { Grammar__restore(this) ; __FREE(this->elements) ; this->elements = NULL; }
+		assert(this->elements == NULL);
+
+		TRACE("Grammar_prepare: resetting element IDs %c", ' ')
+		ParsingElement_walk(this->axiom, Grammar__resetElementIDs, NULL);
+		if (this->skip != NULL) {
+			ParsingElement_walk(this->skip, Grammar__resetElementIDs, NULL);
+		}
+
+		TRACE("Grammar_prepare: assigning new element IDs %c", ' ')
+		int count = ParsingElement_walk(this->axiom, Grammar__assignElementIDs, NULL);
+		this->axiomCount = count;
+		if (this->skip != NULL) {
+			this->skipCount = ParsingElement__walk(this->skip, Grammar__assignElementIDs, count + 1, NULL) - count;
+		}
+
+		// Now we register the elements
+		__ARRAY_NEW(elements, Element*, this->skipCount + this->axiomCount + 1);
+		this->elements = elements;
+
+		count = ParsingElement_walk(this->axiom, Grammar__registerElement, this);
+		if (this->skip != NULL) {
+			ParsingElement__walk(this->skip, Grammar__registerElement, count, this);
+		}
+
+		Grammar__markContextual(this);
+		if (this->optimize != 0) {Grammar__optimize(this);}
+		Grammar__computeFirst(this);
+		Grammar__compileWordSets(this);
+
+		#ifdef WITH_TRACE
+		int j = this->skipCount + this->axiomCount + 1;
+		TRACE("Grammar_prepare:  skip=%d + axiom=%d = total=%d symbols", this->skipCount, this->axiomCount, j);
+		for (int i=0 ; i < j ; i++) {
+			Element* element = this->elements[i];
+			if (element == NULL) {
+			} else if (element->type == TYPE_REFERENCE) {
+				TRACE("Grammar_prepare:  Reference    %4d %c %-20s [%4d/%4d]", element->id, element->type, element->name, i, j - 1);
+			} else {
+				TRACE("Grammar_prepare:  Element      %4d %c %-20s [%4d/%4d]", element->id, element->type, element->name, i, j - 1);
+			}
+		}
+		#endif
+	}
+}
+
+// The fingerprint is a 64-bit FNV-1a hash, integers being hashed as
+// little-endian bytes so that it doesn't depend on the platform.
+uint64_t Grammar__hash(uint64_t hash, const char* data, size_t length) {
+	for (size_t i=0 ; i<length ; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+uint64_t Grammar__hashInt(uint64_t hash, int value) {
+	char bytes[4];
+	for (int i=0 ; i<4 ; i++) {bytes[i] = (char)(((unsigned int)value >> (8 * i)) & 0xFF);}
+	return Grammar__hash(hash, bytes, 4);
+}
+
+uint64_t Grammar__hashString(uint64_t hash, const char* string) {
+	// NULL strings are told apart from empty ones
+	if (string == NULL) {return Grammar__hashInt(hash, -1);}
+	hash = Grammar__hashInt(hash, (int)strlen(string));
+	return Grammar__hash(hash, string, strlen(string));
+}
+
+uint64_t Grammar_fingerprint ( Grammar* this ) {
+	Grammar__ensurePrepared(this);
+	uint64_t hash  = 0xcbf29ce484222325ULL;
+	int      count = this->elements == NULL ? 0 : this->axiomCount + this->skipCount + 1;
+	hash = Grammar__hashInt(hash, count);
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e == NULL) {
+			hash = Grammar__hashInt(hash, -1);
+			continue;
+		}
+		hash = Grammar__hashInt(hash, e->type);
+		hash = Grammar__hashString(hash, e->name);
+		if (e->type == TYPE_REFERENCE) {
+			Reference* r = (Reference*)e;
+			hash = Grammar__hashInt(hash, r->cardinality);
+			hash = Grammar__hashInt(hash, r->element->id);
+			continue;
+		}
+		ParsingElement* pe = (ParsingElement*)e;
+		if (pe->type == TYPE_WORD)  {hash = Grammar__hashString(hash, Word_word(pe));}
+		if (pe->type == TYPE_TOKEN) {hash = Grammar__hashString(hash, Token_expr(pe));}
+		for (Reference* child = pe->children ; child != NULL ; child = child->next) {
+			hash = Grammar__hashInt(hash, child->id);
+		}
+		hash = Grammar__hashInt(hash, -1);
+	}
+	return hash;
+}
+
+// Parses the input of the given context, which must be prepared
+ParsingResult* Grammar__parse( Grammar* this, ParsingContext* context ) {
 	assert(this->axiom != NULL);
-	ParsingContext* context = ParsingContext_new(this, iterator);
 	assert(this->axiom->recognize != NULL);
-	clock_t t1  = clock();
-	Match* match = this->axiom->recognize(this->axiom, context);
-	context->stats->parseTime = ((double)clock() - (double)t1) / CLOCKS_PER_SEC;
-	context->stats->bytesRead = iterator->offset;
+	// Push parses need to know how far they examined the input, which is
+	// only tracked when memoizing.
+	PushInput* push = Iterator__pushInput(context->iterator);
+	if (push != NULL) {
+		if (context->memo == NULL) {context->memo = Memo_new(MEMO_LIMIT_DEFAULT);}
+		push->parsed = context->iterator->available;
+	}
+	double  t1  = ParsingStats_now();
+	Match* match = NULL;
+	if (this->engine == ENGINE_ITERATIVE) {
+		if (context->engine == NULL) {context->engine = Engine_new();}
+		context->engine->maxDepth = this->maxDepth;
+		match = Engine_recognize(context->engine, this->axiom, context);
+	} else {
+		match = this->axiom->recognize(this->axiom, context);
+	}
+	context->stats->parseTime = ParsingStats_now() - t1;
+	context->stats->bytesRead = context->iterator->offset;
+	ParsingContext_account(context);
 	return ParsingResult_new(match, context);
 }
 
+ParsingResult* Grammar_parseIterator( Grammar* this, Iterator* iterator ) {
+	// We make sure the grammar is prepared before we start parsing
+	Grammar__ensurePrepared(this);
+	return Grammar__parse(this, Grammar__acquireContext(this, iterator));
+}
+
 ParsingResult* Grammar_parsePath( Grammar* this, const char* path ) {
 	Iterator* iterator = Iterator_Open(path);
 	if (iterator != NULL) {
@@ -2315,21 +5227,630 @@ ParsingResult* Grammar_parsePath( Grammar* this, const char* path ) {
 		result->context->freeIterator = TRUE;
 		return result;
 	} else {
-		errno = ENOENT;
-		return NULL;
+		errno = ENOENT;
+		return NULL;
+	}
+}
+
+ParsingResult* Grammar_parseStream( Grammar* this, const char* path, size_t window ) {
+	Iterator* iterator = Iterator_Stream(path, window);
+	if (iterator != NULL) {
+		ParsingResult* result = Grammar_parseIterator(this, iterator);
+		result->context->freeIterator = TRUE;
+		return result;
+	} else {
+		errno = ENOENT;
+		return NULL;
+	}
+}
+
+ParsingResult* Grammar_parseMapped( Grammar* this, const char* path ) {
+	Iterator* iterator = Iterator_Map(path);
+	if (iterator != NULL) {
+		ParsingResult* result = Grammar_parseIterator(this, iterator);
+		result->context->freeIterator = TRUE;
+		return result;
+	} else {
+		errno = ENOENT;
+		return NULL;
+	}
+}
+
+ParsingResult* Grammar_parseString( Grammar* this, const char* text ) {
+	Iterator* iterator = Iterator_FromString(text);
+	if (iterator != NULL) {
+		ParsingResult* result = Grammar_parseIterator(this, iterator);
+		result->context->freeIterator = TRUE;
+		return result;
+	} else {
+		errno = ENOENT;
+		return NULL;
+	}
+}
+
+ParsingResult* Grammar_reparse( Grammar* this, ParsingResult* previous, size_t offset, size_t removed, const char* inserted ) {
+	// The previous input must be entirely in the buffer
+	Iterator* source = previous != NULL && previous->context != NULL ? previous->context->iterator : NULL;
+	if (source == NULL || source->move != String_move || Iterator_bufferOffset(source) != 0 || offset > source->available || removed > source->available - offset) {
+		errno = EINVAL;
+		return NULL;
+	}
+	// We create the edited text, which is owned by the new iterator
+	size_t added  = inserted == NULL ? 0 : strlen(inserted);
+	size_t length = source->available - removed + added;
+	char*  text   = malloc(length + 1);
+	memcpy(text, source->buffer, offset);
+	if (added > 0) {memcpy(text + offset, inserted, added);}
+	memcpy(text + offset + added, source->buffer + offset + removed, source->available - offset - removed);
+	text[length] = '\0';
+	Iterator* iterator   = Iterator_FromString(text);
+	iterator->capacity   = length;
+	iterator->available  = length;
+	iterator->separator  = source->separator;
+	iterator->freeBuffer = TRUE;
+	// The lines after the edit are shifted by the difference in separators
+	int lines = 0;
+	for (size_t i=0 ; i<added   ; i++) {if (inserted[i] == source->separator) {lines++;}}
+	for (size_t i=0 ; i<removed ; i++) {if (source->buffer[offset + i] == source->separator) {lines--;}}
+	Grammar__ensurePrepared(this);
+	ParsingContext* context = Grammar__acquireContext(this, iterator);
+	context->freeIterator   = TRUE;
+	if (context->memo != NULL && previous->context->memo != NULL && previous->context->grammar == this) {
+		Memo_reuse(context->memo, previous->context->memo, offset, removed, added, lines);
+	}
+	return Grammar__parse(this, context);
+}
+
+ParsingResult* Grammar_resume( Grammar* this, ParsingResult* previous ) {
+	Iterator*  iterator = previous != NULL && previous->context != NULL ? previous->context->iterator : NULL;
+	PushInput* input    = Iterator__pushInput(iterator);
+	if (input == NULL || input->parsed > iterator->available) {
+		errno = EINVAL;
+		return NULL;
+	}
+	// The fed data is an insertion at the end of the parsed input, so
+	// the recognitions that examined its end are dropped, but for the ones
+	// starting there, which are shifted to the new end.
+	size_t added = iterator->available - input->parsed;
+	int    lines = 0;
+	for (size_t i=input->parsed ; i<iterator->available ; i++) {if (iterator->buffer[i] == iterator->separator) {lines++;}}
+	Iterator_moveTo(iterator, 0);
+	iterator->truncated = FALSE;
+	Grammar__ensurePrepared(this);
+	ParsingContext* context = Grammar__acquireContext(this, iterator);
+	context->freeIterator   = previous->context->freeIterator;
+	previous->context->freeIterator = FALSE;
+	if (context->memo == NULL) {context->memo = Memo_new(MEMO_LIMIT_DEFAULT);}
+	if (previous->context->memo != NULL && previous->context->grammar == this) {
+		Memo_reuse(context->memo, previous->context->memo, input->parsed, 0, added, lines);
+	}
+	return Grammar__parse(this, context);
+}
+
+// ----------------------------------------------------------------------------
+//
+// PARALLEL PARSING
+//
+// ----------------------------------------------------------------------------
+
+typedef struct ParallelParse {
+	Grammar*         grammar;
+	const char*      text;
+	size_t*          offsets;      // The `count + 1` bounds of the chunks
+	ParsingResult**  results;      // The result of each chunk, once parsed
+	int              count;
+	int              next;         // The next chunk to parse
+	int              failed;       // The first chunk that did not parse entirely
+#ifdef WITH_THREADS
+	pthread_mutex_t  lock;
+#endif
+} ParallelParse;
+
+typedef struct ParallelBoundary {
+	ParsingContext*  context;
+	ParsingElement*  element;
+} ParallelBoundary;
+
+typedef struct ParallelBatch {
+	Grammar*         grammar;
+	Iterator**       inputs;
+	ParsingResult**  results;
+	int              count;
+	int              next;         // The next input to parse
+#ifdef WITH_THREADS
+	pthread_mutex_t  lock;
+#endif
+} ParallelBatch;
+
+// Returns the next chunk to parse, or -1 when there is none left. Chunks
+// after a failed one are not parsed, as they won't be joined.
+int ParallelParse__next(ParallelParse* this) {
+#ifdef WITH_THREADS
+	pthread_mutex_lock(&this->lock);
+#endif
+	int result = this->next < this->count && this->next <= this->failed ? this->next++ : -1;
+#ifdef WITH_THREADS
+	pthread_mutex_unlock(&this->lock);
+#endif
+	return result;
+}
+
+void ParallelParse__fail(ParallelParse* this, int chunk) {
+#ifdef WITH_THREADS
+	pthread_mutex_lock(&this->lock);
+#endif
+	this->failed = MIN(this->failed, chunk);
+#ifdef WITH_THREADS
+	pthread_mutex_unlock(&this->lock);
+#endif
+}
+
+void* ParallelParse__run(void* data) {
+	ParallelParse* this = (ParallelParse*)data;
+	int chunk = 0;
+	while ((chunk = ParallelParse__next(this)) >= 0) {
+		Iterator* iterator = Iterator_FromSlice(this->text, this->offsets[chunk], this->offsets[chunk + 1]);
+		ParsingResult* result = Grammar_parseIterator(this->grammar, iterator);
+		result->context->freeIterator = TRUE;
+		this->results[chunk] = result;
+		if (!ParsingResult_isSuccess(result)) {ParallelParse__fail(this, chunk);}
+	}
+	return NULL;
+}
+
+// Returns the offset just after the first non-empty match of the boundary
+// at or after the given offset.
+size_t Grammar__splitAfter(const char* text, size_t length, size_t offset, void* data) {
+	ParallelBoundary* boundary = (ParallelBoundary*)data;
+	ParsingContext*   context  = boundary->context;
+	ParsingElement*   element  = boundary->element;
+	for (size_t o=offset ; o < length ; o++) {
+		Iterator_moveTo(context->iterator, o);
+		if (ParsingContext_rejects(context, element->id)) {continue;}
+		Match* match = element->recognize(element, context);
+		if (Match_isSuccess(match) && match->length > 0) {
+			return o + match->length;
+		}
+	}
+	return length;
+}
+
+// Joins the results of the chunks in a match of the axiom, owned by a new
+// context that also owns the contexts of the chunks.
+ParsingResult* ParallelParse__join(ParallelParse* this) {
+	Iterator* iterator = Iterator_FromString(this->text);
+	ParsingContext* context = ParsingContext_new(this->grammar, iterator);
+	context->freeIterator   = TRUE;
+	Match*  match = Match_Success(0, this->grammar->axiom, context);
+	Match*  last  = NULL;
+	size_t  end   = 0;
+	ParsingContext* owned = context;
+	for (int i=0 ; i < this->count ; i++) {
+		ParsingResult* result = this->results[i];
+		if (result == NULL) {continue;}
+		ParsingContext* c = result->context;
+		// The chunk contexts are owned by the joined context
+		owned->next = c;
+		owned       = c;
+		if (i <= this->failed) {
+			for (size_t j=0 ; j < context->stats->symbolsCount && j < c->stats->symbolsCount ; j++) {
+				context->stats->successBySymbol[j] += c->stats->successBySymbol[j];
+				context->stats->failureBySymbol[j] += c->stats->failureBySymbol[j];
+				context->stats->bytesBySymbol[j]   += c->stats->bytesBySymbol[j];
+				context->stats->timeBySymbol[j]    += c->stats->timeBySymbol[j];
+			}
+			context->stats->memoHits   += c->stats->memoHits;
+			context->stats->memoMisses += c->stats->memoMisses;
+			context->stats->bytesMatches   += c->stats->bytesMatches;
+			context->stats->bytesInput     += c->stats->bytesInput;
+			context->stats->bytesVariables += c->stats->bytesVariables;
+			context->stats->bytesMemo      += c->stats->bytesMemo;
+			// Each chunk has the budget and maximum depth, and one that
+			// exceeds them aborts the whole parse.
+			context->exceeded = context->exceeded || c->exceeded;
+			context->tooDeep  = context->tooDeep  || c->tooDeep;
+			if (c->lastMatchOffset + c->lastMatchLength >= context->lastMatchOffset + context->lastMatchLength) {
+				context->lastMatchOffset    = c->lastMatchOffset;
+				context->lastMatchLength    = c->lastMatchLength;
+				context->lastMatchElementID = c->lastMatchElementID;
+			}
+			// A partial chunk is joined, but ends the parse
+			if (Match_isSuccess(result->match)) {
+				if (last == NULL) {match->children = result->match;} else {last->next = result->match;}
+				last = result->match;
+				last->parent = match;
+				end  = c->iterator->offset;
+			}
+		}
+		// NOTE: The match and context are now owned by the joined context
+		result->match   = NULL;
+		result->context = NULL;
+		ParsingResult_free(result);
+	}
+	Iterator_moveTo(iterator, end);
+	if (last == NULL) {
+		match = FAILURE;
+	} else {
+		match->length = end;
+	}
+	context->stats->bytesRead = end;
+	return ParsingResult_new(match, context);
+}
+
+ParsingResult* Grammar_parseParallelWith( Grammar* this, const char* text, ParsingSplitCallback split, void* data, int jobs ) {
+	// The grammar has to be prepared before it is shared by the threads
+	Grammar__ensurePrepared(this);
+	assert(this->axiom != NULL);
+	if (jobs <= 0) {jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);}
+	if (jobs <= 0) {jobs = 1;}
+	double t1     = ParsingStats_now();
+	size_t length = strlen(text);
+	int    count  = (int)MIN((size_t)(jobs * PARALLEL_CHUNKS), length / PARALLEL_CHUNK_SIZE + 1);
+	ParallelParse parse = {
+		.grammar = this,
+		.text    = text,
+		.count   = 0,
+		.next    = 0,
+	};
+	// We place the bounds of the chunks as close as possible to even
+	// targets, without ever going back.
+	__ARRAY_NEW(offsets, size_t, count + 1);
+	parse.offsets = offsets;
+	offsets[0]    = 0;
+	for (int i=1 ; i < count ; i++) {
+		size_t target = MAX(length / count * i, offsets[parse.count]);
+		size_t offset = split(text, length, target, data);
+		if (offset > offsets[parse.count] && offset < length) {
+			offsets[++parse.count] = offset;
+		}
+	}
+	offsets[++parse.count] = length;
+	parse.failed = parse.count;
+	__ARRAY_NEW(results, ParsingResult*, parse.count);
+	parse.results = results;
+#ifdef WITH_THREADS
+	int threads = MIN(jobs, parse.count) - 1;
+	pthread_mutex_init(&parse.lock, NULL);
+	__ARRAY_NEW(workers, pthread_t, threads + 1);
+	for (int i=0 ; i < threads ; i++) {
+		if (pthread_create(&workers[i], NULL, ParallelParse__run, &parse) != 0) {threads = i; break;}
+	}
+	// The calling thread parses chunks as well
+	ParallelParse__run(&parse);
+	for (int i=0 ; i < threads ; i++) {pthread_join(workers[i], NULL);}
+	pthread_mutex_destroy(&parse.lock);
+	__FREE(workers);
+#else
+	ParallelParse__run(&parse);
+#endif
+	ParsingResult* result = ParallelParse__join(&parse);
+	result->context->stats->parseTime = ParsingStats_now() - t1;
+	__FREE(results);
+	__FREE(offsets);
+	return result;
+}
+
+ParsingResult* Grammar_parseParallel( Grammar* this, const char* text, ParsingElement* boundary, int jobs ) {
+	Grammar__ensurePrepared(this);
+	// The boundary is looked up in a context of its own, over the whole text
+	Iterator*        iterator = Iterator_FromString(text);
+	ParsingContext*  context  = ParsingContext_new(this, iterator);
+	context->freeIterator     = TRUE;
+	ParallelBoundary data     = {.context=context, .element=boundary};
+	ParsingResult*   result   = Grammar_parseParallelWith(this, text, Grammar__splitAfter, &data, jobs);
+	ParsingContext_free(context);
+	return result;
+}
+
+void* ParallelBatch__run(void* data) {
+	ParallelBatch* this = (ParallelBatch*)data;
+	while (TRUE) {
+#ifdef WITH_THREADS
+		pthread_mutex_lock(&this->lock);
+#endif
+		int input = this->next < this->count ? this->next++ : -1;
+#ifdef WITH_THREADS
+		pthread_mutex_unlock(&this->lock);
+#endif
+		if (input < 0) {break;}
+		this->results[input] = Grammar_parseIterator(this->grammar, this->inputs[input]);
+	}
+	return NULL;
+}
+
+void Grammar_parseMany( Grammar* this, Iterator** inputs, ParsingResult** results, int count, int jobs ) {
+	// The grammar has to be prepared before it is shared by the threads
+	Grammar__ensurePrepared(this);
+	if (jobs <= 0) {jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);}
+	if (jobs <= 0) {jobs = 1;}
+	ParallelBatch batch = {
+		.grammar = this,
+		.inputs  = inputs,
+		.results = results,
+		.count   = count,
+		.next    = 0,
+	};
+#ifdef WITH_THREADS
+	int threads = MIN(jobs, count) - 1;
+	pthread_mutex_init(&batch.lock, NULL);
+	__ARRAY_NEW(workers, pthread_t, MAX(threads, 0) + 1);
+	for (int i=0 ; i < threads ; i++) {
+		if (pthread_create(&workers[i], NULL, ParallelBatch__run, &batch) != 0) {threads = i; break;}
+	}
+	// The calling thread parses inputs as well
+	ParallelBatch__run(&batch);
+	for (int i=0 ; i < threads ; i++) {pthread_join(workers[i], NULL);}
+	pthread_mutex_destroy(&batch.lock);
+	__FREE(workers);
+#else
+	ParallelBatch__run(&batch);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+//
+// C GENERATOR
+//
+// ----------------------------------------------------------------------------
+
+// Writes the given bytes as a C string literal. Octal escapes are at most
+// 3 digits long, so they can't absorb the characters that follow.
+void Grammar__writeCString(int fd, const char* text, size_t length) {
+	if (text == NULL) {WRITE("NULL"); return;}
+	WRITE("\"");
+	for (size_t i=0 ; i<length ; i++) {
+		unsigned char c = (unsigned char)text[i];
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (c != '\0' && strchr(" _-+*/=<>!&|^~%.,:;()[]{}#@$", c) != NULL)) {
+			WRITEF("%c", c);
+		} else {
+			WRITEF("\\%03o", c);
+		}
+	}
+	WRITE("\"");
+}
+
+// Tells if the element at the given index has a generated recognizer
+bool Grammar__isGenerated(Grammar* this, int index) {
+	Element* e = this->elements[index];
+	return e != NULL && e->id == index && (e->type == TYPE_WORD || e->type == TYPE_RULE || e->type == TYPE_GROUP);
+}
+
+// Writes the expression that recognizes the element of the given
+// reference, which is a direct call when the element is generated and
+// neither memoized nor timed.
+void Grammar__writeCRecognize(Grammar* this, int fd, const char* prefix, Reference* reference) {
+	ParsingElement* e = reference->element;
+	if (e->id >= 0 && e->id <= this->axiomCount + this->skipCount && this->elements[e->id] == (Element*)e && Grammar__isGenerated(this, e->id)) {
+		WRITEF("(%s_DIRECT ? %s_e%d(%s_ELEMENT(%d), context) : ParsingElement_recognize(%s_ELEMENT(%d), context))", prefix, prefix, e->id, prefix, e->id, prefix, e->id);
+	} else {
+		WRITEF("ParsingElement_recognize(%s_REFERENCE(%d)->element, context)", prefix, reference->id);
 	}
 }
 
-ParsingResult* Grammar_parseString( Grammar* this, const char* text ) {
-	Iterator* iterator = Iterator_FromString(text);
-	if (iterator != NULL) {
-		ParsingResult* result = Grammar_parseIterator(this, iterator);
-		result->context->freeIterator = TRUE;
-		return result;
+void Grammar__writeCReference(Grammar* this, int fd, const char* prefix, Reference* r) {
+	char c = r->cardinality;
+	WRITEF("// Reference #%d%s%s, cardinality `%c`\n", r->id, r->name ? " " : "", r->name ? r->name : "", c);
+	WRITEF("static Match* %s_r%d(ParsingContext* context) {\n", prefix, r->id);
+	WRITEF("\tReference* this = %s_REFERENCE(%d);\n", prefix, r->id);
+	if (c != CARDINALITY_ONE && c != CARDINALITY_OPTIONAL && c != CARDINALITY_MANY && c != CARDINALITY_MANY_OPTIONAL && c != CARDINALITY_NOT_EMPTY) {
+		WRITE("\treturn Reference_recognize(this, context);\n}\n\n");
+		return;
+	}
+	bool once     = c == CARDINALITY_ONE || c == CARDINALITY_OPTIONAL;
+	bool optional = c == CARDINALITY_OPTIONAL || c == CARDINALITY_MANY_OPTIONAL;
+	if (!once) {
+		// The matches processed during the parse are left to the library
+		// (see `Processor_parseIterator`).
+		WRITE("\tif (this == context->commit) {return Reference_recognize(this, context);}\n");
+	}
+	WRITE("\tMatch*     result = FAILURE;\n");
+	WRITE("\tMatch*     tail   = NULL;\n");
+	WRITE("\tsize_t     offset = context->iterator->offset;\n");
+	WRITE("\tsize_t     end    = offset;\n");
+	if (!optional) {
+		WRITE("\tArenaMark  mark   = Arena_mark(context->arena);\n");
+	}
+	if (r->element->type == TYPE_PROCEDURE || r->element->type == TYPE_CONDITION || r->element->type == TYPE_CUT) {
+		WRITE("\twhile (TRUE) {\n");
 	} else {
-		errno = ENOENT;
-		return NULL;
+		WRITE("\twhile (Iterator_hasMore(context->iterator)) {\n");
+	}
+	if (!once) {
+		WRITE("\t\tsize_t start = context->iterator->offset;\n");
+	}
+	WRITE("\t\tsize_t cuts  = context->cuts;\n");
+	WRITE("\t\tMatch* match = ");
+	Grammar__writeCRecognize(this, fd, prefix, r);
+	WRITE(";\n");
+	WRITEF("\t\tif (%s_SUCCESS(match)) {\n", prefix);
+	WRITE("\t\t\tend = Match_getEndOffset(match);\n");
+	WRITE("\t\t\tif (tail == NULL) {result = match;} else {tail->next = match;}\n");
+	WRITE("\t\t\ttail = match;\n");
+	if (once) {
+		WRITE("\t\t\tbreak;\n");
+	} else {
+		WRITE("\t\t\tif (context->iterator->offset == start) {break;}\n");
+	}
+	// Failures past a cut fail the reference, and the failures of its
+	// parents release what it allocated.
+	WRITE("\t\t} else if (context->cuts != cuts) {\n");
+	WRITE("\t\t\tParsingContext_backtrack(context, offset);\n");
+	WRITE("\t\t\treturn MATCH_STATS(FAILURE);\n");
+	WRITE("\t\t} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {\n");
+	WRITE("\t\t\tbreak;\n");
+	WRITE("\t\t}\n");
+	WRITE("\t\tif (context->iterator->offset == offset) {break;}\n");
+	WRITE("\t}\n");
+	WRITE("\tif (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}\n");
+	if (c == CARDINALITY_ONE || c == CARDINALITY_MANY) {
+		WRITEF("\tif (!%s_SUCCESS(result)) {\n", prefix);
+		WRITE("\t\tArena_rewind(context->arena, mark);\n");
+		WRITE("\t\treturn MATCH_STATS(FAILURE);\n");
+		WRITE("\t}\n");
+	} else if (c == CARDINALITY_NOT_EMPTY) {
+		WRITEF("\tif (!%s_SUCCESS(result) || result->length == 0) {\n", prefix);
+		WRITE("\t\tArena_rewind(context->arena, mark);\n");
+		WRITE("\t\treturn MATCH_STATS(FAILURE);\n");
+		WRITE("\t}\n");
+	}
+	WRITE("\tMatch* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);\n");
+	WRITE("\tm->children = result == FAILURE ? NULL : result;\n");
+	WRITE("\tm->offset   = offset;\n");
+	WRITE("\tfor (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}\n");
+	WRITE("\treturn MATCH_STATS(m);\n");
+	WRITE("}\n\n");
+}
+
+void Grammar__writeCElement(Grammar* this, int fd, const char* prefix, ParsingElement* e) {
+	WRITEF("// %s #%d %c\n", e->name ? e->name : "-", e->id, e->type);
+	WRITEF("static Match* %s_e%d(ParsingElement* this, ParsingContext* context) {\n", prefix, e->id);
+	if (e->type == TYPE_WORD) {
+		WordConfig* config = (WordConfig*)e->config;
+		WRITEF("\tif (%s_REMAINING >= %zu && memcmp(context->iterator->current, ", prefix, config->length);
+		Grammar__writeCString(fd, config->word, config->length);
+		WRITEF(", %zu) == 0) {\n", config->length);
+		WRITEF("\t\tMatch* match = MATCH_STATS(Match_Success(%zu, this, context));\n", config->length);
+		WRITEF("\t\tcontext->iterator->move(context->iterator, %zu);\n", config->length);
+		WRITE("\t\treturn match;\n");
+		WRITE("\t}\n");
+		WRITE("\treturn MATCH_STATS(FAILURE);\n");
+	} else if (e->children == NULL) {
+		// Empty rules and groups always fail
+		WRITE("\treturn MATCH_STATS(FAILURE);\n");
+	} else if (e->type == TYPE_RULE) {
+		WRITE("\tMatch*    result = FAILURE;\n");
+		WRITE("\tMatch*    last   = NULL;\n");
+		WRITE("\tMatch*    match  = NULL;\n");
+		WRITE("\tsize_t    offset = context->iterator->offset;\n");
+		WRITE("\tsize_t    cuts   = context->cuts;\n");
+		WRITE("\tArenaMark mark   = Arena_mark(context->arena);\n");
+		WRITEF("\tif (%s_REJECTS(%d)) {return MATCH_STATS(FAILURE);}\n", prefix, e->id);
+		WRITE("\tbool scoped = HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);\n");
+		WRITE("\tif (scoped) {ParsingContext_push(context);}\n");
+		for (Reference* r = e->children ; r != NULL ; r = r->next) {
+			WRITE("\tcuts  = context->cuts;\n");
+			if (r->next == NULL && Reference_IsMany(r)) {
+				// The reference might be the one committed by the library
+				WRITEF("\tif (%s_REFERENCE(%d) == context->commit) {ParsingContext__enclose(context, this, result, offset);}\n", prefix, r->id);
+			}
+			WRITEF("\tmatch = %s_r%d(context);\n", prefix, r->id);
+			WRITEF("\tif (!%s_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !%s_SUCCESS(match = %s_r%d(context)))) {goto failure;}\n", prefix, prefix, prefix, r->id);
+			WRITE("\tif (last == NULL) {\n");
+			WRITE("\t\tresult           = Match_Success(match->length, this, context);\n");
+			WRITE("\t\tresult->offset   = offset;\n");
+			WRITE("\t\tresult->children = last = match;\n");
+			WRITE("\t} else {\n");
+			WRITE("\t\tlast = last->next = match;\n");
+			WRITE("\t}\n");
+			WRITE("\tmatch->parent = result;\n");
+		}
+		WRITE("\tif (last == NULL) {goto failure;}\n");
+		WRITE("\tif (scoped) {ParsingContext_pop(context);}\n");
+		WRITE("\tresult->length = last->offset - result->offset + last->length;\n");
+		WRITE("\treturn MATCH_STATS(result);\n");
+		WRITE("failure:\n");
+		WRITE("\tif (scoped) {ParsingContext_pop(context);}\n");
+		WRITE("\tArena_rewind(context->arena, mark);\n");
+		WRITE("\tif (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}\n");
+		WRITE("\treturn MATCH_STATS(FAILURE);\n");
+	} else if (e->type == TYPE_GROUP) {
+		WRITE("\tsize_t    offset = context->iterator->offset;\n");
+		WRITE("\tsize_t    cuts   = context->cuts;\n");
+		WRITE("\tArenaMark mark   = Arena_mark(context->arena);\n");
+		WRITE("\tMatch*    match  = NULL;\n");
+		for (Reference* r = e->children ; r != NULL ; r = r->next) {
+			WRITEF("\tif (!%s_REJECTS(%d) && %s_SUCCESS(match = %s_r%d(context))) {goto success;}\n", prefix, r->id, prefix, prefix, r->id);
+			WRITE("\tArena_rewind(context->arena, mark);\n");
+			WRITE("\tif (context->cuts != cuts) {goto failure;}\n");
+		}
+		WRITE("failure:\n");
+		WRITE("\tif (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}\n");
+		WRITE("\treturn MATCH_STATS(FAILURE);\n");
+		WRITE("success:;\n");
+		WRITE("\tMatch* result   = Match_Success(match->length, this, context);\n");
+		WRITE("\tresult->offset   = offset;\n");
+		WRITE("\tresult->children = match;\n");
+		WRITE("\tmatch->parent   = result;\n");
+		WRITE("\treturn MATCH_STATS(result);\n");
+	}
+	WRITE("}\n\n");
+}
+
+bool Grammar_writeC( Grammar* this, int fd, const char* prefix ) {
+	if (this->elements == NULL) {Grammar_prepare(this);}
+	// The generated code has the recognizers of the grammar as it was
+	// built, which optimized grammars have replaced.
+	if (this->elements == NULL || prefix == NULL || this->optimizations != NULL) {return FALSE;}
+	int count = this->axiomCount + this->skipCount + 1;
+	WRITEF("// Generated by libparsing %s with `Grammar_writeC`, do not edit.\n", __PARSING_VERSION__);
+	WRITE("#include \"parsing.h\"\n\n");
+	WRITEF("#define %s_ELEMENT(id)   ((ParsingElement*)context->grammar->elements[id])\n", prefix);
+	WRITEF("#define %s_REFERENCE(id) ((Reference*)context->grammar->elements[id])\n", prefix);
+	// The elements go through `ParsingElement_recognize` when it does
+	// more than calling their recognizer: memoizing, timing, checking the
+	// budget, or profiling.
+	WRITEF("#define %s_DIRECT        (context->memo == NULL && !context->grammar->isTimed && context->budget == 0 && context->profiler == NULL)\n", prefix);
+	// The most frequent checks are expanded, as the library's functions
+	// can't be inlined across the shared object.
+	WRITEF("#define %s_SUCCESS(m)     %s_isSuccess(m)\n", prefix, prefix);
+	WRITEF("#define %s_REMAINING      ((size_t)(context->iterator->available - (context->iterator->current - context->iterator->buffer)))\n", prefix);
+	WRITEF("#define %s_REJECTS(id)    (context->grammar->first != NULL && %s_REMAINING > 0 && !context->grammar->first[id].nullable && !(context->grammar->first[id].bytes[(unsigned char)*(context->iterator->current) >> 3] & (1 << ((unsigned char)*(context->iterator->current) & 7))))\n", prefix, prefix);
+	WRITE("#ifndef MATCH_STATS\n");
+	WRITE("#define MATCH_STATS(m)     ParsingContext_registerMatch(context, (Element*)this, m)\n");
+	WRITE("#endif\n\n");
+	WRITEF("static inline bool %s_isSuccess(Match* m) {\n", prefix);
+	WRITE("\treturn m != NULL && m != FAILURE && m->status == STATUS_MATCHED;\n");
+	WRITE("}\n\n");
+	// The table of elements lets `install` check that the grammar is the
+	// one the code was generated from.
+	WRITEF("static const struct {char type; const char* name;} %s_ELEMENTS[%d] = {\n", prefix, count);
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e == NULL) {
+			WRITE("\t{0, NULL},\n");
+		} else {
+			WRITEF("\t{'%c', ", e->type);
+			Grammar__writeCString(fd, e->name, e->name != NULL ? strlen(e->name) : 0);
+			WRITE("},\n");
+		}
+	}
+	WRITE("};\n\n");
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e != NULL && e->type == TYPE_REFERENCE && e->id == i) {
+			WRITEF("static Match* %s_r%d(ParsingContext* context);\n", prefix, i);
+		} else if (Grammar__isGenerated(this, i)) {
+			WRITEF("static Match* %s_e%d(ParsingElement* this, ParsingContext* context);\n", prefix, i);
+		}
 	}
+	WRITE("\n");
+	for (int i=0 ; i<count ; i++) {
+		Element* e = this->elements[i];
+		if (e != NULL && e->type == TYPE_REFERENCE && e->id == i) {
+			Grammar__writeCReference(this, fd, prefix, (Reference*)e);
+		} else if (Grammar__isGenerated(this, i)) {
+			Grammar__writeCElement(this, fd, prefix, (ParsingElement*)e);
+		}
+	}
+	WRITEF("bool %s_install(Grammar* g) {\n", prefix);
+	WRITE("\tif (g->elements == NULL) {Grammar_prepare(g);}\n");
+	WRITEF("\tif (g->elements == NULL || g->axiomCount + g->skipCount + 1 != %d) {return FALSE;}\n", count);
+	WRITEF("\tfor (int i=0 ; i<%d ; i++) {\n", count);
+	WRITE("\t\tElement* e = g->elements[i];\n");
+	WRITEF("\t\tif (e == NULL) {if (%s_ELEMENTS[i].type != 0) {return FALSE;} continue;}\n", prefix);
+	WRITEF("\t\tif (e->id != i || e->type != %s_ELEMENTS[i].type) {return FALSE;}\n", prefix);
+	WRITEF("\t\tif ((e->name == NULL) != (%s_ELEMENTS[i].name == NULL)) {return FALSE;}\n", prefix);
+	WRITEF("\t\tif (e->name != NULL && strcmp(e->name, %s_ELEMENTS[i].name) != 0) {return FALSE;}\n", prefix);
+	WRITE("\t}\n");
+	for (int i=0 ; i<count ; i++) {
+		if (Grammar__isGenerated(this, i)) {
+			WRITEF("\t((ParsingElement*)g->elements[%d])->recognize = %s_e%d;\n", i, prefix, i);
+		}
+	}
+	WRITE("\treturn TRUE;\n");
+	WRITE("}\n\n");
+	WRITE("// EOF\n");
+	return TRUE;
 }
 
 // ----------------------------------------------------------------------------
@@ -2340,21 +5861,36 @@ ParsingResult* Grammar_parseString( Grammar* this, const char* text ) {
 
 Processor* Processor_new() {
 	__NEW(Processor,this);
-	this->callbacksCount = 100;
-	__ARRAY_NEW(callbacks, ProcessorCallback, (size_t)this->callbacksCount);
-	this->callbacks      = callbacks;
+	// The callbacks are allocated on registration
+	this->callbacks      = NULL;
+	this->callbacksCount = 0;
 	this->fallback       = NULL;
+	this->nodeCallbacks      = NULL;
+	this->nodeCallbacksCount = 0;
+	this->nodeFallback       = NULL;
+	this->stack          = NULL;
+	this->stackCount     = 0;
+	this->stackCapacity  = 0;
+	this->context        = NULL;
 	return this;
 }
 
 void Processor_free(Processor* this) {
+	if (this != NULL) {
+		__FREE(this->callbacks);
+		__FREE(this->nodeCallbacks);
+		__FREE(this->stack);
+	}
 	__FREE(this);
 }
 
 void Processor_register (Processor* this, int symbolID, ProcessorCallback callback ) {
+	assert(symbolID >= 0);
 	if (this->callbacksCount < (symbolID + 1)) {
-		int cur_count        = this->callbacksCount;
-		int new_count        = symbolID + 100;
+		// The table at least doubles, so that registering the elements of a
+		// grammar one after the other doesn't resize it each time.
+		int cur_count = this->callbacksCount;
+		int new_count = MAX(symbolID + 1, cur_count * 2);
 		__ARRAY_RESIZE(this->callbacks, ProcessorCallback, new_count);
 		this->callbacksCount = new_count;
 		// We zero the new values, as `realloc` does not guarantee zero data.
@@ -2366,26 +5902,810 @@ void Processor_register (Processor* this, int symbolID, ProcessorCallback callba
 	this->callbacks[symbolID] = callback;
 }
 
+void Processor__push(Processor* this, Match* match) {
+	if (this->stackCount == this->stackCapacity) {
+		int capacity = MAX(64, this->stackCapacity * 2);
+		__ARRAY_RESIZE(this->stack, Match*, capacity);
+		this->stackCapacity = capacity;
+	}
+	this->stack[this->stackCount++] = match;
+}
+
 int Processor_process (Processor* this, Match* match, int step) {
-	ProcessorCallback handler = this->fallback;
-	if (ParsingElement_Is(match->element)) {
-		int element_id = ((ParsingElement*)match->element)->id;
-		if (element_id >= 0 && element_id < this->callbacksCount) {
-			handler = this->callbacks[element_id];
+	// The next siblings of the matches we descend into are pushed on the
+	// processor's stack. Callbacks can process matches in turn, as they
+	// only pop what they pushed above `base`.
+	int    base    = this->stackCount;
+	Match* current = match;
+	while (current != NULL) {
+		assert(current->element != NULL);
+		int               id      = current->element->id;
+		ProcessorCallback handler = id >= 0 && id < this->callbacksCount ? this->callbacks[id] : NULL;
+		if (handler == NULL) {handler = this->fallback;}
+		// The siblings of the given match are not processed
+		Match* next = current == match ? NULL : current->next;
+		if (handler != NULL) {
+			handler (this, current);
+		} else if (current->children != NULL) {
+			if (next != NULL) {Processor__push(this, next);}
+			next = current->children;
 		}
+		if (next == NULL && this->stackCount > base) {
+			next = this->stack[--this->stackCount];
+		}
+		current = next;
 	}
-	if (handler != NULL) {
-		handler (this, match);
-	} else {
-		Match* child = match->children;
-		while (child) {
-			step  = Processor_process(this, child, step);
-			child = child->next;
+	return step;
+}
+
+void Processor_registerNode (Processor* this, int symbolID, ProcessorNodeCallback callback ) {
+	assert(symbolID >= 0);
+	if (this->nodeCallbacksCount < (symbolID + 1)) {
+		int cur_count = this->nodeCallbacksCount;
+		int new_count = MAX(symbolID + 1, cur_count * 2);
+		__ARRAY_RESIZE(this->nodeCallbacks, ProcessorNodeCallback, new_count);
+		this->nodeCallbacksCount = new_count;
+		while (cur_count < new_count) {
+			this->nodeCallbacks[cur_count] = NULL;
+			cur_count++;
+		}
+	}
+	this->nodeCallbacks[symbolID] = callback;
+}
+
+int Processor_processTree (Processor* this, MatchTree* tree, int node, int step) {
+	// The nodes are linked to their parent, so that the traversal doesn't
+	// need a stack at all.
+	int current = node;
+	while (current >= 0) {
+		int                   id      = tree->nodes[current].element;
+		ProcessorNodeCallback handler = id >= 0 && id < this->nodeCallbacksCount ? this->nodeCallbacks[id] : NULL;
+		if (handler == NULL) {handler = this->nodeFallback;}
+		if (handler != NULL) {
+			handler (this, tree, current);
+		} else if (tree->nodes[current].children >= 0) {
+			current = tree->nodes[current].children;
+			continue;
+		}
+		// We go to the next sibling of the closest ancestor that has one,
+		// without leaving the given node.
+		while (current != node && tree->nodes[current].next < 0) {
+			current = tree->nodes[current].parent;
 		}
+		current = current == node ? -1 : tree->nodes[current].next;
 	}
 	return step;
 }
 
+// Tells if `target` can be reached from the given element, `visited`
+// flagging the ids of the elements already walked.
+bool Element__reaches(Element* this, Element* target, bool* visited, int count) {
+	if (this == target) {return TRUE;}
+	if (this == NULL || this->id < 0 || this->id >= count || visited[this->id]) {return FALSE;}
+	visited[this->id] = TRUE;
+	if (Reference_Is(this)) {
+		return Element__reaches((Element*)((Reference*)this)->element, target, visited, count);
+	}
+	for (Reference* child = ((ParsingElement*)this)->children ; child != NULL ; child = child->next) {
+		if (Element__reaches((Element*)child, target, visited, count)) {return TRUE;}
+	}
+	return FALSE;
+}
+
+// Returns the repeated reference that ends the axiom, when the axiom is
+// a rule, or NULL.
+Reference* Grammar__lastReference(Grammar* this) {
+	if (this->axiom == NULL || this->axiom->type != TYPE_RULE) {return NULL;}
+	Reference* last = this->axiom->children;
+	while (last != NULL && last->next != NULL) {last = last->next;}
+	return last != NULL && Reference_IsMany(last) ? last : NULL;
+}
+
+// Returns the last reference of the axiom when its matches can be committed
+// as they are recognized, which is when they can't contain the axiom, and
+// then the same reference, again.
+Reference* Grammar__commitReference(Grammar* this) {
+	Reference* last = Grammar__lastReference(this);
+	if (last != NULL) {
+		int count = this->axiomCount + this->skipCount + 1;
+		__ARRAY_NEW(visited, bool, (size_t)count);
+		if (Element__reaches((Element*)last->element, (Element*)this->axiom, visited, count)) {last = NULL;}
+		__FREE(visited);
+	}
+	return last;
+}
+
+// Tells if the processor has a callback for the matches of the element,
+// which then processes them as a whole, rather than their children.
+bool Processor__handles(Processor* this, Element* element) {
+	return this->fallback != NULL || (element->id >= 0 && element->id < this->callbacksCount && this->callbacks[element->id] != NULL);
+}
+
+ParsingResult* Processor_parseIterator (Processor* this, Grammar* grammar, Iterator* iterator) {
+	Grammar__ensurePrepared(grammar);
+	ParsingContext* context = Grammar__acquireContext(grammar, iterator);
+	Reference*      commit  = Grammar__commitReference(grammar);
+	// The matches are processed as `Processor_process` would process the
+	// axiom's, and so are only streamed when they would be processed one
+	// by one.
+	if (commit != NULL && !Processor__handles(this, (Element*)grammar->axiom) && !Processor__handles(this, (Element*)commit)) {
+		context->commit    = commit;
+		context->processor = this;
+	}
+	ParsingResult* result = Grammar__parse(grammar, context);
+	context->processor = NULL;
+	if (context->commit != NULL) {
+		// The other children of the axiom were processed along with the
+		// first committed match, and are only processed now if there was
+		// none.
+		for (Match* child = Match_isSuccess(result->match) && !context->opened ? result->match->children : NULL ; child != NULL ; child = child->next) {
+			if (child->element != (Element*)context->commit) {Processor_process(this, child, 0);}
+		}
+		context->commit = NULL;
+	} else if (Match_isSuccess(result->match)) {
+		Processor_process(this, result->match, 0);
+	}
+	return result;
+}
+
+ParsingResult* Processor_parseString (Processor* this, Grammar* grammar, const char* text) {
+	Iterator* iterator = Iterator_FromString(text);
+	if (iterator != NULL) {
+		ParsingResult* result = Processor_parseIterator(this, grammar, iterator);
+		result->context->freeIterator = TRUE;
+		return result;
+	} else {
+		errno = ENOENT;
+		return NULL;
+	}
+}
+
+// ----------------------------------------------------------------------------
+//
+// LISTENER
+//
+// ----------------------------------------------------------------------------
+
+Listener* Listener_new() {
+	__NEW(Listener,this);
+	this->enter    = NULL;
+	this->exit     = NULL;
+	this->commit   = NULL;
+	this->iterator = NULL;
+	this->context  = NULL;
+	return this;
+}
+
+void Listener_free(Listener* this) {
+	__FREE(this);
+}
+
+void Listener_send (Listener* this, Match* match) {
+	// We go down the first children, and then to the next sibling of the
+	// closest ancestor that has one, without leaving the given match.
+	Match* current = match;
+	while (current != NULL) {
+		if (this->enter != NULL) {this->enter(this, Match_getElementID(current), current->offset, current->length);}
+		if (current->children != NULL) {
+			current = current->children;
+			continue;
+		}
+		while (current != NULL) {
+			if (this->exit != NULL) {this->exit(this, Match_getElementID(current), current->offset, current->length);}
+			if (current == match) {
+				current = NULL;
+			} else if (current->next != NULL) {
+				current = current->next;
+				break;
+			} else {
+				current = current->parent;
+			}
+		}
+	}
+	if (this->commit != NULL) {this->commit(this, Match_getElementID(match), match->offset, match->length);}
+}
+
+ParsingResult* Listener_parseIterator (Listener* this, Grammar* grammar, Iterator* iterator) {
+	Grammar__ensurePrepared(grammar);
+	ParsingContext* context = Grammar__acquireContext(grammar, iterator);
+	context->commit         = Grammar__commitReference(grammar);
+	context->listener       = this;
+	this->iterator          = iterator;
+	ParsingResult* result   = Grammar__parse(grammar, context);
+	Reference*     commit   = context->commit;
+	context->listener       = NULL;
+	context->commit         = NULL;
+	// The matches that enclose the committed ones are only final now, and
+	// were entered along with the first one if there was any.
+	if (context->opened) {
+		Match* axiom = result->match;
+		Match* last  = Match_isSuccess(axiom) ? axiom->children : NULL;
+		while (last != NULL && last->next != NULL) {last = last->next;}
+		if (this->exit != NULL) {
+			// The parse aborted when there is no match, and the events are
+			// closed where it stopped.
+			size_t offset = context->iterator->offset;
+			this->exit(this, commit->id, last == NULL ? offset : last->offset, last == NULL ? 0 : last->length);
+			this->exit(this, grammar->axiom->id, last == NULL ? offset : axiom->offset, last == NULL ? 0 : axiom->length);
+		}
+		if (this->commit != NULL && last != NULL) {this->commit(this, grammar->axiom->id, axiom->offset, axiom->length);}
+	} else if (Match_isSuccess(result->match)) {
+		Listener_send(this, result->match);
+	}
+	this->iterator          = NULL;
+	return result;
+}
+
+ParsingResult* Listener_parseString (Listener* this, Grammar* grammar, const char* text) {
+	Iterator* iterator = Iterator_FromString(text);
+	if (iterator != NULL) {
+		ParsingResult* result = Listener_parseIterator(this, grammar, iterator);
+		result->context->freeIterator = TRUE;
+		return result;
+	} else {
+		errno = ENOENT;
+		return NULL;
+	}
+}
+
+// ----------------------------------------------------------------------------
+//
+// PROFILER
+//
+// ----------------------------------------------------------------------------
+
+// Returns the number of recognitions before the next sample, uniformly
+// distributed in `[1, 2 * period - 1]` so that the mean is the period.
+size_t Profiler__countdown(Profiler* this) {
+	// A xorshift generator is enough to break the repetitions
+	this->seed ^= this->seed << 13;
+	this->seed ^= this->seed >> 7;
+	this->seed ^= this->seed << 17;
+	return 1 + (size_t)(this->seed % (2 * this->period - 1));
+}
+
+// Returns the index of the child of the given node for the element,
+// adding it if it wasn't sampled yet.
+int Profiler__child(Profiler* this, int node, ParsingElement* element) {
+	int child = this->nodes[node].child;
+	while (child >= 0 && this->nodes[child].element != element) {child = this->nodes[child].sibling;}
+	if (child >= 0) {return child;}
+	if (this->count == this->nodesCapacity) {
+		this->nodesCapacity *= 2;
+		__RESIZE(this->nodes, sizeof(ProfileNode) * this->nodesCapacity);
+	}
+	child = this->count++;
+	ProfileNode* added = &(this->nodes[child]);
+	added->element = element;
+	added->parent  = node;
+	added->child   = -1;
+	added->sibling = this->nodes[node].child;
+	added->samples = 0;
+	this->nodes[node].child = child;
+	return child;
+}
+
+void Profiler__sample(Profiler* this) {
+	int node = 0;
+	for (int i=0 ; i<this->depth ; i++) {node = Profiler__child(this, node, this->stack[i]);}
+	this->nodes[node].samples += 1;
+	this->samples += 1;
+}
+
+Profiler* Profiler_new(size_t period) {
+	__NEW(Profiler, this);
+	__ARRAY_NEW(stack, ParsingElement*, 64);
+	__ARRAY_NEW(nodes, ProfileNode,     64);
+	this->period        = period == 0 ? PROFILER_PERIOD : period;
+	this->seed          = 0x9E3779B97F4A7C15ULL;
+	this->samples       = 0;
+	this->stack         = stack;
+	this->depth         = 0;
+	this->capacity      = 64;
+	this->nodes         = nodes;
+	this->count         = 1;
+	this->nodesCapacity = 64;
+	// The root stands for the empty stack
+	nodes[0].element    = NULL;
+	nodes[0].parent     = -1;
+	nodes[0].child      = -1;
+	nodes[0].sibling    = -1;
+	nodes[0].samples    = 0;
+	this->countdown     = Profiler__countdown(this);
+	return this;
+}
+
+void Profiler_free(Profiler* this) {
+	if (this != NULL) {
+		__FREE(this->stack);
+		__FREE(this->nodes);
+	}
+	__FREE(this);
+}
+
+void Profiler_enter(Profiler* this, ParsingElement* element) {
+	if (this->depth == this->capacity) {
+		this->capacity *= 2;
+		__RESIZE(this->stack, sizeof(ParsingElement*) * this->capacity);
+	}
+	this->stack[this->depth++] = element;
+	if (--this->countdown == 0) {
+		Profiler__sample(this);
+		this->countdown = Profiler__countdown(this);
+	}
+}
+
+void Profiler_exit(Profiler* this) {
+	assert(this->depth > 0);
+	this->depth -= 1;
+}
+
+ParsingResult* Profiler_parseIterator (Profiler* this, Grammar* grammar, Iterator* iterator) {
+	Grammar__ensurePrepared(grammar);
+	ParsingContext* context = Grammar__acquireContext(grammar, iterator);
+	context->profiler       = this;
+	// The axiom is recognized directly by the parse, so we push it here
+	// for the stacks to start with it.
+	Profiler_enter(this, grammar->axiom);
+	ParsingResult* result   = Grammar__parse(grammar, context);
+	Profiler_exit(this);
+	context->profiler       = NULL;
+	return result;
+}
+
+ParsingResult* Profiler_parseString (Profiler* this, Grammar* grammar, const char* text) {
+	Iterator* iterator = Iterator_FromString(text);
+	if (iterator != NULL) {
+		ParsingResult* result = Profiler_parseIterator(this, grammar, iterator);
+		result->context->freeIterator = TRUE;
+		return result;
+	} else {
+		errno = ENOENT;
+		return NULL;
+	}
+}
+
+// Writes the name of the element as a frame, replacing the characters
+// that separate frames and counts.
+void Profiler__writeFrame(Output* output, ParsingElement* element) {
+	if (element->name == NULL) {
+		Output_writef(output, "%c#%d", element->type, element->id);
+		return;
+	}
+	for (const char* c = element->name ; *c != '\0' ; c++) {
+		char frame = (*c == ';' || *c == ' ' || *c == '\n') ? '_' : *c;
+		Output_write(output, &frame, 1);
+	}
+}
+
+void Profiler_output(Profiler* this, Output* output) {
+	// The nodes are added after their parents, so that a stack is written
+	// from the path of its node up to the root, reversed.
+	__ARRAY_NEW(path, int, this->count);
+	for (int i=1 ; i<this->count ; i++) {
+		if (this->nodes[i].samples == 0) {continue;}
+		int length = 0;
+		for (int node = i ; node > 0 ; node = this->nodes[node].parent) {path[length++] = node;}
+		for (int j=length - 1 ; j>=0 ; j--) {
+			Profiler__writeFrame(output, this->nodes[path[j]].element);
+			Output_writeString(output, j > 0 ? ";" : " ");
+		}
+		Output_writef(output, "%zu\n", this->nodes[i].samples);
+	}
+	__FREE(path);
+}
+
+// ----------------------------------------------------------------------------
+//
+// ITERATIVE ENGINE
+//
+// ----------------------------------------------------------------------------
+
+// The states of the frames, which resume with the match that the frame
+// above them returned.
+#define ENGINE_STATE_ENTER 0   // The recognition starts
+#define ENGINE_STATE_NEXT  1   // The next child is to be recognized
+#define ENGINE_STATE_CHILD 2   // The child returned its match
+#define ENGINE_STATE_RETRY 3   // The child of a rule returned, after skipping
+
+Engine* Engine_new(void) {
+	__NEW(Engine, this);
+	__ARRAY_NEW(frames, EngineFrame, 64);
+	this->frames   = frames;
+	this->depth    = 0;
+	this->capacity = 64;
+	this->maxDepth = 0;
+	this->match    = FAILURE;
+	return this;
+}
+
+void Engine_free(Engine* this) {
+	if (this != NULL) {
+		__FREE(this->frames);
+	}
+	__FREE(this);
+}
+
+// Tells if the element is recognized on the engine's stack, rather than by
+// calling its `recognize`.
+bool Engine__isStacked(ParsingElement* element) {
+	return element->recognize == Rule_recognize || element->recognize == Group_recognize;
+}
+
+// Pushes a frame for the element, or aborts the parse and returns NULL when
+// the stack is at its maximum depth.
+EngineFrame* Engine__push(Engine* this, Element* element, bool wrapped, ParsingContext* context) {
+	if (this->maxDepth != 0 && this->depth >= this->maxDepth) {
+		LOG_IF(context->grammar->isVerbose && !context->tooDeep, "Aborted, nested deeper than %zu frames at %zu", this->maxDepth, context->iterator->offset)
+		context->tooDeep = TRUE;
+		return NULL;
+	}
+	if (this->depth == this->capacity) {
+		this->capacity *= 2;
+		__RESIZE(this->frames, sizeof(EngineFrame) * this->capacity);
+	}
+	EngineFrame* frame = &this->frames[this->depth++];
+	frame->element     = element;
+	frame->state       = ENGINE_STATE_ENTER;
+	frame->wrapped     = wrapped;
+	return frame;
+}
+
+// Recognizes the reference on a new frame. Returns FALSE when the parse
+// was aborted instead, the failure being in `this->match`.
+//
+// NOTE: Pushing a frame might move the frames, so the callers return right
+// away when it did.
+bool Engine__callReference(Engine* this, Reference* reference, ParsingContext* context) {
+	if (!context->tooDeep && Engine__push(this, (Element*)reference, FALSE, context) != NULL) {return TRUE;}
+	this->match = FAILURE;
+	return FALSE;
+}
+
+// Recognizes the element as `ParsingElement_recognize` does, on a new frame
+// for rules and groups. Returns FALSE when the other elements were
+// recognized right away instead, their match being in `this->match`.
+bool Engine__callElement(Engine* this, ParsingElement* element, ParsingContext* context) {
+	if (!context->tooDeep && Engine__isStacked(element) && Engine__push(this, (Element*)element, TRUE, context) != NULL) {return TRUE;}
+	this->match = context->tooDeep ? FAILURE : ParsingElement_recognize(element, context);
+	return FALSE;
+}
+
+// Pops the frame, returning the match to the frame below. Wrapped frames
+// end as `ParsingElement_recognize` does.
+void Engine__return(Engine* this, EngineFrame* frame, Match* match, ParsingContext* context) {
+	if (frame->wrapped) {
+		ParsingElement* element = (ParsingElement*)frame->element;
+		if (frame->memoized) {
+			ParsingElement__memoize(element, context, frame->offset, frame->memoCuts, match);
+			ParsingContext__reach(context, frame->reach);
+		}
+#ifdef WITH_STATS
+		if (frame->start >= 0 && element->id >= 0 && (size_t)element->id < context->stats->symbolsCount) {
+			context->stats->timeBySymbol[element->id] += ParsingStats_now() - frame->start;
+		}
+#endif
+		if (context->profiler != NULL) {Profiler_exit(context->profiler);}
+	}
+	this->match  = match;
+	this->depth -= 1;
+}
+
+// Starts the recognition of a rule or group. Wrapped frames start as
+// `ParsingElement_recognize` does, and return FALSE when their match is
+// known without recognizing them, from the budget or the memo.
+bool Engine__enter(Engine* this, EngineFrame* frame, ParsingContext* context) {
+	ParsingElement* element = (ParsingElement*)frame->element;
+	frame->offset   = context->iterator->offset;
+	frame->memoized = FALSE;
+	frame->start    = -1;
+	if (!frame->wrapped) {return TRUE;}
+	if (ParsingContext__exceeds(context)) {
+		this->match  = FAILURE;
+		this->depth -= 1;
+		return FALSE;
+	}
+	if (context->profiler != NULL) {Profiler_enter(context->profiler, element);}
+#ifdef WITH_STATS
+	frame->start = context->grammar->isTimed && !HAS_FLAG(context->flags, FLAG_SKIPPING) ? ParsingStats_now() : -1;
+#endif
+	if (ParsingElement__isMemoized(element, context)) {
+		Match* recalled = ParsingElement__recall(element, context);
+		if (recalled != NULL) {
+			Engine__return(this, frame, recalled, context);
+			return FALSE;
+		}
+		frame->memoized = TRUE;
+		frame->memoCuts = context->cuts;
+		frame->reach    = context->reach;
+		context->reach  = frame->offset + 1;
+	}
+	return TRUE;
+}
+
+// Ends the recognition of a rule, with the children matched so far
+void Engine__ruleEnd(Engine* this, EngineFrame* frame, ParsingContext* context) {
+	Match* result = frame->result;
+	if (frame->scoped) {ParsingContext_pop(context);}
+	if (Match_isSuccess(result)) {
+		result->length = frame->last->offset - result->offset + frame->last->length;
+	} else {
+		result = Match_fail(result);
+		Arena_rewind(context->arena, frame->mark);
+		ParsingContext_backtrack(context, frame->offset);
+	}
+	Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, result), context);
+}
+
+// Runs the frame of a rule, as `Rule_recognize` does
+void Engine__runRule(Engine* this, EngineFrame* frame, ParsingContext* context) {
+	ParsingElement* element = (ParsingElement*)frame->element;
+	while (TRUE) {
+		Match* match = this->match;
+		switch (frame->state) {
+			case ENGINE_STATE_ENTER:
+				if (!Engine__enter(this, frame, context)) {return;}
+				frame->result = FAILURE;
+				frame->last   = NULL;
+				frame->mark   = Arena_mark(context->arena);
+				frame->child  = element->children;
+				frame->scoped = FALSE;
+				if (ParsingContext_rejects(context, element->id)) {
+					Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, FAILURE), context);
+					return;
+				}
+				frame->scoped = HAS_FLAG(element->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);
+				if (frame->scoped) {ParsingContext_push(context);}
+				frame->state  = ENGINE_STATE_NEXT;
+				break;
+			case ENGINE_STATE_NEXT:
+				if (frame->child == NULL) {
+					Engine__ruleEnd(this, frame, context);
+					return;
+				}
+				frame->cuts  = context->cuts;
+				frame->state = ENGINE_STATE_CHILD;
+				if (frame->child == context->commit) {ParsingContext__enclose(context, element, frame->result, frame->offset);}
+				if (Engine__callReference(this, frame->child, context)) {return;}
+				break;
+			case ENGINE_STATE_CHILD:
+			case ENGINE_STATE_RETRY:
+				if (Match_isSuccess(match)) {
+					if (frame->last == NULL) {
+						frame->result           = Match_Success(match->length, element, context);
+						frame->result->offset   = frame->offset;
+						frame->result->children = frame->last = match;
+					} else {
+						frame->last = frame->last->next = match;
+					}
+					match->parent = frame->result;
+					frame->child  = frame->child->next;
+					frame->state  = ENGINE_STATE_NEXT;
+					break;
+				}
+				Match_free(match);
+				// The child is tried again once after skipping input, unless
+				// it failed past a cut.
+				if (frame->state == ENGINE_STATE_CHILD && context->cuts == frame->cuts && ParsingElement_skip(element, context) > 0) {
+					frame->state = ENGINE_STATE_RETRY;
+					if (Engine__callReference(this, frame->child, context)) {return;}
+					break;
+				}
+				frame->result = Match_fail(frame->result);
+				Engine__ruleEnd(this, frame, context);
+				return;
+		}
+	}
+}
+
+// Moves the frame of a group to the next child worth trying, as
+// `Group_recognize` does, returning FALSE when there is none.
+bool Engine__groupNext(EngineFrame* frame, ParsingContext* context) {
+	while (frame->child != NULL) {
+		WordSet* words = frame->words;
+		if (words != NULL && words->start == frame->step) {
+			int i = WordSet_match(words, context->iterator->current, Iterator_remaining(context->iterator));
+			if (context->memo != NULL) {ParsingContext__reach(context, frame->offset + words->longest);}
+			frame->child = i >= 0 ? words->words[i] : words->words[words->count - 1]->next;
+			frame->step += i >= 0 ? i : words->count;
+			frame->words = words->next;
+			if (frame->child == NULL) {break;}
+			if (i < 0) {continue;}
+		}
+		if (ParsingContext_rejects(context, frame->child->id)) {
+			frame->child = frame->child->next;
+			frame->step += 1;
+			continue;
+		}
+		return TRUE;
+	}
+	return FALSE;
+}
+
+// Ends the recognition of a group, with the match of its winning child
+// or a failure.
+void Engine__groupEnd(Engine* this, EngineFrame* frame, Match* result, ParsingContext* context) {
+	if (!Match_isSuccess(result)) {
+		Arena_rewind(context->arena, frame->mark);
+		ParsingContext_backtrack(context, frame->offset);
+	}
+	Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, result), context);
+}
+
+// Runs the frame of a group, as `Group_recognize` does
+void Engine__runGroup(Engine* this, EngineFrame* frame, ParsingContext* context) {
+	ParsingElement* element = (ParsingElement*)frame->element;
+	while (TRUE) {
+		Match* match = this->match;
+		switch (frame->state) {
+			case ENGINE_STATE_ENTER:
+				if (!Engine__enter(this, frame, context)) {return;}
+				frame->mark  = Arena_mark(context->arena);
+				frame->child = element->children;
+				frame->words = Group__wordSets(element, context);
+				frame->cuts  = context->cuts;
+				frame->step  = 0;
+				frame->state = ENGINE_STATE_NEXT;
+				break;
+			case ENGINE_STATE_NEXT:
+				if (!Engine__groupNext(frame, context)) {
+					Engine__groupEnd(this, frame, FAILURE, context);
+					return;
+				}
+				frame->state = ENGINE_STATE_CHILD;
+				if (Engine__callReference(this, frame->child, context)) {return;}
+				break;
+			case ENGINE_STATE_CHILD:
+				if (Match_isSuccess(match)) {
+					// The first succeeding child wins
+					Match* result    = Match_Success(match->length, element, context);
+					result->offset   = frame->offset;
+					result->children = match;
+					match->parent    = result;
+					Engine__groupEnd(this, frame, result, context);
+					return;
+				}
+				Match_free(match);
+				Arena_rewind(context->arena, frame->mark);
+				frame->child  = context->cuts == frame->cuts ? frame->child->next : NULL;
+				frame->step  += 1;
+				frame->state  = ENGINE_STATE_NEXT;
+				break;
+		}
+	}
+}
+
+// Ends the recognition of a reference, with the repetitions matched so far
+void Engine__referenceEnd(Engine* this, EngineFrame* frame, ParsingContext* context) {
+	Reference* reference = (Reference*)frame->element;
+	Match*     result    = frame->result;
+	// The skipped input after the last repetition is given back
+	if (context->iterator->offset != frame->end) {
+		ParsingContext_backtrack(context, frame->end);
+	}
+	bool is_success = Match_isSuccess(result) || (reference == context->commit && frame->step > 0) ? TRUE : FALSE;
+	switch (reference->cardinality) {
+		case CARDINALITY_ONE:
+		case CARDINALITY_MANY:
+			break;
+		case CARDINALITY_OPTIONAL:
+		case CARDINALITY_MANY_OPTIONAL:
+			is_success = TRUE;
+			break;
+		case CARDINALITY_NOT_EMPTY:
+			if (is_success && result->length == 0) {
+				Match_fail(result);
+				Arena_rewind(context->arena, frame->mark);
+				Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, FAILURE), context);
+				return;
+			}
+			break;
+		default:
+			ERROR("Unsupported cardinality %c", reference->cardinality);
+			is_success = FALSE;
+			break;
+	}
+	if (is_success) {
+		Match* m    = Match_SuccessFromReference(context->iterator->offset - frame->offset, reference, context);
+		m->children = result == FAILURE ? NULL : result;
+		m->offset   = frame->offset;
+		for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+		result      = m;
+	} else {
+		result = Match_fail(result);
+		Arena_rewind(context->arena, frame->mark);
+	}
+	Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, result), context);
+}
+
+// Runs the frame of a reference, as `Reference_recognize` does
+void Engine__runReference(Engine* this, EngineFrame* frame, ParsingContext* context) {
+	Reference*      reference = (Reference*)frame->element;
+	ParsingElement* element   = reference->element;
+	while (TRUE) {
+		switch (frame->state) {
+			case ENGINE_STATE_ENTER:
+				frame->result = FAILURE;
+				frame->last   = NULL;
+				frame->step   = 0;
+				frame->offset = context->iterator->offset;
+				frame->end    = frame->offset;
+				frame->mark   = Arena_mark(context->arena);
+				frame->state  = ENGINE_STATE_NEXT;
+				break;
+			case ENGINE_STATE_NEXT:
+				if (!Iterator_hasMore(context->iterator) && element->type != TYPE_PROCEDURE && element->type != TYPE_CONDITION && element->type != TYPE_CUT) {
+					Engine__referenceEnd(this, frame, context);
+					return;
+				}
+				frame->iteration = context->iterator->offset;
+				frame->cuts      = context->cuts;
+				frame->state     = ENGINE_STATE_CHILD;
+				if (Engine__callElement(this, element, context)) {return;}
+				break;
+			case ENGINE_STATE_CHILD: {
+				Match* match  = this->match;
+				bool   parsed = context->iterator->offset != frame->iteration;
+				bool   more   = TRUE;
+				if (Match_isSuccess(match)) {
+					frame->end = Match_getEndOffset(match);
+					if (reference == context->commit) {
+						// The match is processed right away rather than kept
+						ParsingContext__commit(context, match, frame->offset);
+						Match_free(match);
+						Arena_rewind(context->arena, frame->mark);
+						frame->step += 1;
+						more         = parsed;
+					} else if (frame->step == 0) {
+						frame->result = frame->last = match;
+						frame->step  += 1;
+						more          = parsed && reference->cardinality != CARDINALITY_ONE && reference->cardinality != CARDINALITY_OPTIONAL;
+					} else {
+						frame->last   = frame->last->next = match;
+						frame->step  += parsed ? 1 : 0;
+						more          = parsed;
+					}
+				} else {
+					Match_free(match);
+					// A failure past a cut is final, whatever the cardinality
+					if (context->cuts != frame->cuts) {
+						Match_fail(frame->result);
+						Arena_rewind(context->arena, frame->mark);
+						ParsingContext_backtrack(context, frame->offset);
+						Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, FAILURE), context);
+						return;
+					}
+					more = ParsingElement_skip((ParsingElement*)reference, context) > 0;
+				}
+				if (!more || frame->offset == context->iterator->offset) {
+					Engine__referenceEnd(this, frame, context);
+					return;
+				}
+				frame->state = ENGINE_STATE_NEXT;
+				break;
+			}
+		}
+	}
+}
+
+Match* Engine_recognize(Engine* this, ParsingElement* element, ParsingContext* context) {
+	if (!Engine__isStacked(element)) {return element->recognize(element, context);}
+	// The frames below the ones of this recognition are left as they are
+	size_t base = this->depth;
+	if (Engine__push(this, (Element*)element, FALSE, context) == NULL) {return FAILURE;}
+	while (this->depth > base) {
+		EngineFrame* frame = &this->frames[this->depth - 1];
+		if (Reference_Is(frame->element)) {
+			Engine__runReference(this, frame, context);
+		} else if (((ParsingElement*)frame->element)->recognize == Rule_recognize) {
+			Engine__runRule(this, frame, context);
+		} else {
+			Engine__runGroup(this, frame, context);
+		}
+	}
+	return this->match;
+}
+
 // ----------------------------------------------------------------------------
 //
 // MAIN
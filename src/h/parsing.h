@@ -27,11 +27,21 @@ extern "C" {
 #include <errno.h>
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #include <sys/types.h>
-#ifdef WITH_PCRE
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#if defined(WITH_PCRE2)
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#elif defined(WITH_PCRE)
 #include <pcre.h>
 #endif
+#ifdef WITH_THREADS
+#include <pthread.h>
+#endif
 #endif
 
 #include "oo.h"
@@ -194,6 +204,25 @@ extern "C" {
  *
 */
 
+// @type LineIndex
+// The line index stores the offsets of the line separators found in the
+// input, so that line numbers are looked up from offsets when needed
+// instead of being counted as the iterator moves. The offsets in the input
+// that the iterator's window discarded are dropped as well, and only
+// counted.
+typedef struct LineIndex {
+	size_t*        offsets;   // The offsets of the separators, in increasing order
+	size_t         base;      // The number of separators before the first offset, which were dropped
+	size_t         count;     // The number of offsets
+	size_t         capacity;  // The capacity of `offsets`
+	size_t         scanned;   // The offset up to which the input was scanned
+	size_t         cursor;    // The result of the last lookup, as lookups are mostly on the same line
+} LineIndex;
+
+// @define
+// The initial number of separators a line index can hold.
+#define LINE_INDEX_CAPACITY 1024
+
 // @type Iterator
 typedef struct Iterator {
 	char           status;    // The status of the iterator, one of STATUS_{INIT|PROCESSING|INPUT_ENDED|ENDED}
@@ -201,11 +230,13 @@ typedef struct Iterator {
 	char*    current;   // The pointer current offset within the buffer
 	char     separator; // The character for line separator, `\n` by default.
 	size_t         offset;    // Offset in input (in bytes), might be different from `current - buffer` if some input was freed.
-	size_t         lines;     // Counter for lines that have been encountered
+	struct LineIndex* lineIndex; // The offsets of the lines in the input, built on demand (see `Iterator_lineAt`)
 	size_t         capacity;  // Content capacity (in bytes), might be bigger than the data acquired from the input
 	size_t         available; // Available data in buffer (in bytes), always `<= capacity`
 	bool           freeBuffer;
-	// FIXME: The head should be freed when the offsets have been parsed, no need to keep in memory stuff we won't need.
+	size_t         window;    // When non-zero, the number of bytes kept behind the current offset, see `Iterator_Stream`
+	size_t         committed; // Offset before which the input won't be revisited and can be discarded, see `Iterator_commit`
+	bool           truncated; // Set when the iterator was moved before the start of its buffer
 	void*          input;     // Pointer to the input source (opaque structure)
 	void           (*freeInput) (void*);
 	bool          (*move) (struct Iterator*, int n); // Plug-in function to move to the previous/next positions
@@ -219,6 +250,25 @@ typedef struct FileInput {
 	const char*  path;
 } FileInput;
 
+// @type MappedInput
+// The mapped input wraps a file that is memory-mapped as a whole, the
+// iterator's buffer pointing directly to the mapped data.
+typedef struct MappedInput {
+	void*        data;    // The mapped data, followed by at least one `\0`
+	size_t       length;  // The length of the file (in bytes)
+	size_t       size;    // The size of the mapping, which is bigger than `length`
+	const char*  path;
+} MappedInput;
+
+// @type PushInput
+// The push input holds the data fed to a push iterator (see
+// `Iterator_Push`), which is stored in the iterator's buffer.
+typedef struct PushInput {
+	size_t       size;    // The allocated size of the buffer, bigger than the available data
+	size_t       parsed;  // The data that was available when the input was last parsed
+	bool         ended;   // Set by `Iterator_end`, once no more data will be fed
+} PushInput;
+
 // @shared
 // The EOL character used to count lines in an iterator context.
 extern char         EOL;
@@ -231,6 +281,36 @@ Iterator* Iterator_Open(const char* path);
 // Returns a new iterator instance with the text
 Iterator* Iterator_FromString(const char* text);
 
+// @operation
+// Returns a new iterator on the file at the given path that only keeps
+// a window of `window` bytes behind its current position (in addition to
+// the `ITERATOR_BUFFER_AHEAD` bytes ahead), so that large inputs can be
+// parsed in bounded memory. Input before the committed offset (see
+// `Iterator_commit`) is discarded first, and backtracking further than
+// the window fails. A `window` of `0` keeps the whole input.
+Iterator* Iterator_Stream(const char* path, size_t window);
+
+// @operation
+// Returns a new iterator on the file at the given path, mapped in memory
+// as a whole. The iterator then works like `Iterator_FromString`, without
+// copying or preloading the input.
+Iterator* Iterator_Map(const char* path);
+
+// @operation
+// Returns a new iterator on the `[start, end)` slice of the given text,
+// which is neither copied nor freed. Offsets and lines are those of the
+// whole text, and the input ends at `end`, so that slices of a shared
+// text can be parsed independently (see `Grammar_parseParallel`).
+Iterator* Iterator_FromSlice(const char* text, size_t start, size_t end);
+
+// @operation
+// Returns a new iterator that doesn't read its input, but is given it as
+// it arrives with `Iterator_feed`, for instance from a socket or a pipe.
+// Parses of the input tell when they need more of it (see
+// `ParsingResult_isIncomplete` and `Grammar_resume`). The fed data is
+// kept as a whole and owned by the iterator.
+Iterator* Iterator_Push(void);
+
 // @constructor
 Iterator* Iterator_new(void);
 
@@ -259,13 +339,48 @@ size_t Iterator_remaining( Iterator* this );
 bool Iterator_moveTo ( Iterator* this, size_t offset );
 
 // @method
-// Backtracks the iterator to the given offset, setting the line counter
-bool Iterator_backtrack ( Iterator* this, size_t offset, size_t lines );
+// Backtracks the iterator to the given offset, which must be before the
+// current offset.
+bool Iterator_backtrack ( Iterator* this, size_t offset );
 
 // @method
-// Gets the character at the given offset
+// Returns the line (starting at 0) of the character at the given offset,
+// which is the number of separators before it. The input is scanned for
+// separators the first time a line past the scanned input is requested.
+// The offset must not be before the input that the window discarded.
+size_t Iterator_lineAt ( Iterator* this, size_t offset );
+
+// @method
+// Returns the line of the iterator's current offset.
+size_t Iterator_getLine ( Iterator* this );
+
+// @method
+// Gets the character at the given offset, which must be within the
+// iterator's buffer.
 char Iterator_charAt ( Iterator* this, size_t offset );
 
+// @method
+// Returns the offset in the input of the first byte of the buffer, which is
+// not `0` when input has been discarded.
+size_t Iterator_bufferOffset ( Iterator* this );
+
+// @method
+// Tells the iterator that the input before the given offset won't be
+// revisited, so that it can be discarded the next time the buffer is
+// filled. Offsets after the current position are capped to it.
+void Iterator_commit ( Iterator* this, size_t offset );
+
+// @method
+// Appends the `length` bytes of `data` to the input of the given push
+// iterator. Returns FALSE when the iterator is not a push iterator, or
+// when its input was ended.
+bool Iterator_feed ( Iterator* this, const char* data, size_t length );
+
+// @method
+// Tells the push iterator that no more data will be fed, so that the
+// parses of its input succeed or fail instead of needing more.
+void Iterator_end ( Iterator* this );
+
 // @method
 bool String_move ( Iterator* this, int offset );
 
@@ -283,7 +398,9 @@ void       FileInput_free(void* this);
 
 // @method
 // Preloads data from the input source so that the buffer
-// has up to ITERATOR_BUFFER_AHEAD characters ahead.
+// has up to ITERATOR_BUFFER_AHEAD characters ahead. When the
+// iterator has a window, the consumed input is discarded instead
+// of growing the buffer.
 size_t FileInput_preload( Iterator* this );
 
 // @method
@@ -292,6 +409,20 @@ size_t FileInput_preload( Iterator* this );
 // ahead of the iterator's current position.
 bool FileInput_move   ( Iterator* this, int n );
 
+// @constructor
+// Maps the file at the given path in memory, hinting the kernel that it
+// will be read sequentially.
+MappedInput* MappedInput_new(const char* path );
+
+// @destructor
+void         MappedInput_free(void* this);
+
+// @constructor
+PushInput* PushInput_new(size_t size);
+
+// @destructor
+void       PushInput_free(void* this);
+
 /**
  * Grammar
  * -------
@@ -301,6 +432,12 @@ bool FileInput_move   ( Iterator* this, int n );
  * such as white space.
  *
  * The `axiom` and `skip` properties are both references to _parsing elements_.
+ *
+ * Once prepared (see `Grammar_prepare`), a grammar is only read while
+ * parsing, so it can be shared by several threads, as long as it is not
+ * changed anymore. The state of each parse lives in its `ParsingContext`,
+ * which the grammar can keep in a pool for the following parses (see
+ * `Grammar_setPool`).
 */
 
 typedef struct ParsingVariable ParsingVariable;
@@ -318,6 +455,17 @@ typedef struct Element {
 	char*          name;       // The name of the element
 } Element;
 
+// @type FirstSet
+// The FIRST set of an element, that is the set of bytes that can start
+// a non-empty match of the element. Elements that are `nullable` might
+// succeed without consuming input (or their outcome depends on the parsing
+// context, see `ELEMENT_CONTEXTUAL`), and are never rejected based on their
+// FIRST set.
+typedef struct FirstSet {
+	unsigned char    bytes[32];   // A 256-bit set, indexed by byte value
+	bool             nullable;
+} FirstSet;
+
 // @type Grammar
 typedef struct Grammar {
 	ParsingElement*  axiom;       // The axiom
@@ -326,6 +474,18 @@ typedef struct Grammar {
 	int              skipCount;   // The count of parsing elements in skip
 	Element**        elements;    // The set of all elements in the grammar
 	bool             isVerbose;
+	bool             isTimed;     // Measures the time spent in each element, when built `WITH_STATS`
+	size_t           memoLimit;   // The memory cap (in bytes) of the memoization table, 0 disables it
+	struct FirstSet* first;       // The FIRST set of each element, indexed by id (see `Grammar_prepare`)
+	struct WordSet** wordSets;    // The word sets of each group, indexed by id (see `Grammar_prepare`)
+	int              wordSetsCount;
+	struct ContextPool* pool;     // The contexts kept for reuse, NULL when disabled (see `Grammar_setPool`)
+	int              optimize;    // The OPTIMIZE_XXX passes run by `Grammar_prepare` (see `Grammar_setOptimize`)
+	struct Optimization* optimizations; // The children the passes replaced, so that they can be restored
+	int              derivedCount; // The count of elements the passes added, at the end of `elements`
+	size_t           budget;      // The memory cap (in bytes) of each parse, 0 for none (see `Grammar_setBudget`)
+	char             engine;      // The ENGINE_XXX that runs the parses (see `Grammar_setEngine`)
+	size_t           maxDepth;    // The maximum depth of the iterative engine, 0 for none
 } Grammar;
 
 // @constructor
@@ -335,14 +495,128 @@ Grammar* Grammar_new(void);
 void Grammar_free(Grammar* this);
 
 // @method
+// Assigns ids to the grammar's elements and references, runs the optimizer
+// passes (see `Grammar_setOptimize`), and computes their FIRST sets and
+// the word sets of groups. The grammar is prepared by the first parse
+// otherwise, which is safe to do from several threads.
 void Grammar_prepare ( Grammar* this );
 
+// @method
+// Returns a hash of the grammar's structure: the types, names, words and
+// token expressions of its elements, and how they reference each other.
+// Grammars built by the same code have the same fingerprint, which binary
+// match trees are checked against (see `MatchTree_writeBinary`).
+uint64_t Grammar_fingerprint ( Grammar* this );
+
 // @method
 void Grammar_setVerbose ( Grammar* this );
 
 // @method
 void Grammar_setSilent ( Grammar* this );
 
+// @method
+// Enables or disables the measurement of the time spent recognizing each
+// element. This only has an effect when the library is built `WITH_STATS`.
+void Grammar_setTimed ( Grammar* this, bool timed );
+
+// @method
+// Enables packrat memoization of rules and groups, using a table
+// that will not grow beyond `limit` bytes. A `limit` of 0 disables
+// memoization.
+void Grammar_setMemoize ( Grammar* this, size_t limit );
+
+// @method
+// Caps the memory that each parse holds to `budget` bytes, as accounted by
+// `ParsingContext_account`. Parses that exceed it are aborted, with the
+// `STATUS_EXCEEDED` status. A `budget` of 0 removes the cap.
+void Grammar_setBudget ( Grammar* this, size_t budget );
+
+// @method
+// Selects the engine that runs the parses of the grammar, either
+// `ENGINE_RECURSIVE` (the default) or `ENGINE_ITERATIVE`. The iterative
+// engine aborts the parses that nest deeper than `depth` frames, with the
+// `STATUS_TOO_DEEP` status. A `depth` of 0 removes the limit.
+void Grammar_setEngine ( Grammar* this, char engine, size_t depth );
+
+// @method
+// Keeps the contexts of up to `size` freed results, so that the following
+// parses reuse their arenas, memoization tables, stats and variables
+// instead of allocating them. Contexts whose arena grew beyond
+// `CONTEXT_POOL_ARENA_LIMIT` are freed anyway. A `size` of 0 disables the
+// pool. When enabled, results must be freed before the grammar, and the
+// pool must not be resized while parsing.
+void Grammar_setPool ( Grammar* this, int size );
+
+/**
+ * Optimization
+ * ------------
+ *
+ * Grammars built from small parts, by hand or through the Python bindings,
+ * have anonymous rules and groups that only wrap another element, groups of
+ * groups, and runs of words, which add recognitions and matches without
+ * changing what the grammar recognizes. `Grammar_setOptimize` enables
+ * passes that `Grammar_prepare` runs once the ids are assigned:
+ *
+ * - `OPTIMIZE_INLINE` makes the references to anonymous rules and groups
+ *   with a single child reference that child's element instead.
+ * - `OPTIMIZE_FLATTEN` replaces the anonymous groups that are alternatives
+ *   of groups with their own alternatives.
+ * - `OPTIMIZE_WORDS` merges the adjacent anonymous words of rules into
+ *   one word, when the grammar doesn't skip (skipping could happen between
+ *   them otherwise).
+ * - `OPTIMIZE_TOKENS` turns the repetitions of tokens that match a single
+ *   character into one token matching the run, when the grammar doesn't
+ *   skip either.
+ * - `OPTIMIZE_DEAD` removes the alternatives of groups that are never
+ *   tried, as they follow an optional alternative or repeat an earlier one,
+ *   and the ones that can't match, as they reference empty rules or groups.
+ *
+ * Named elements are never removed, so that their matches are there for
+ * processors. The passes replace the children of existing elements with
+ * new references, words and tokens, which `elements` holds after the
+ * elements of the grammar. These report the id and name of the element
+ * they stand for, so that `Match_getElementID`, `Match_getElementName` and
+ * the processors see the original symbols, and ids are the same with or
+ * without optimization. The grammar's elements are restored as they were
+ * built before it is prepared again.
+ *
+ * The matches are different though, as they lack the inlined and
+ * flattened elements, and have one match for merged words and runs.
+ * `Grammar_writeC` needs a grammar prepared without optimization.
+*/
+
+// @define
+// Inlines the anonymous rules and groups with a single child
+#define OPTIMIZE_INLINE   0x01
+// @define
+// Flattens the anonymous groups that are alternatives of groups
+#define OPTIMIZE_FLATTEN  0x02
+// @define
+// Merges the adjacent anonymous words of rules
+#define OPTIMIZE_WORDS    0x04
+// @define
+// Turns repetitions of single character tokens into one token
+#define OPTIMIZE_TOKENS   0x08
+// @define
+// Removes the alternatives of groups that are never tried or can't match
+#define OPTIMIZE_DEAD     0x10
+// @define
+#define OPTIMIZE_ALL      0x1F
+
+// @type Optimization
+// The children of an element before an optimizer pass replaced them
+typedef struct Optimization {
+	ParsingElement*      element;
+	Reference*           children;
+	struct Optimization* next;
+} Optimization;
+
+// @method
+// Sets the OPTIMIZE_XXX passes that `Grammar_prepare` runs, 0 (the
+// default) disabling optimization. This takes effect the next time the
+// grammar is prepared.
+void Grammar_setOptimize ( Grammar* this, int passes );
+
 // @method
 int Grammar_symbolsCount ( Grammar* this );
 
@@ -355,9 +629,327 @@ ParsingResult* Grammar_parsePath( Grammar* this, const char* path );
 // @method
 ParsingResult* Grammar_parseString( Grammar* this, const char* text );
 
+// @method
+// Parses the file at the given path with an `Iterator_Stream` keeping
+// `window` bytes behind the current position. Token groups are copied
+// as they are matched, as the input they refer to might be discarded.
+ParsingResult* Grammar_parseStream( Grammar* this, const char* path, size_t window );
+
+// @method
+// Parses the file at the given path with an `Iterator_Map`, which avoids
+// copying large files in the iterator's buffer.
+ParsingResult* Grammar_parseMapped( Grammar* this, const char* path );
+
+/**
+ * Incremental parsing
+ * -------------------
+ *
+ * Editors reparse a document after each edit, which mostly leaves the
+ * matches unchanged. `Grammar_reparse` takes the result of the previous
+ * parse and an edit, and parses the edited text reusing the outcome of
+ * the recognitions that the edit cannot change, so that only the rules that
+ * enclose the edit are recognized again.
+ *
+ * The reuse builds on the memoization table (see `Grammar_setMemoize`),
+ * whose entries record how far their recognition examined the input. The
+ * entries that examined nothing past the edit are kept as they are, the
+ * entries that start after the edit are shifted, and the others are dropped.
+ * Literal tokens examine their text, and tokens that repeat a character
+ * class (`[a-z]+`) the byte past their match, but the other regular
+ * expressions are assumed to examine the input up to its end, as they might
+ * backtrack or look ahead, so that the entries that end with them are dropped
+ * before an edit. Without memoization, the edited text is parsed as a whole.
+ *
+ * ```
+ * ParsingResult* r = Grammar_parseString(g, "a = 1;");
+ * ParsingResult* s = Grammar_reparse(g, r, 4, 1, "2 + 3");  // "a = 2 + 3;"
+ * ParsingResult_free(r);
+ * ```
+*/
+
+// @method
+// Parses the text of the `previous` result where the `removed` bytes at
+// `offset` are replaced with the `inserted` string (which might be NULL).
+// The previous result must come from a parse of the whole input (string or
+// mapped file) by this grammar, and is left unchanged but for its memoization
+// table, which is moved to the new result. The new result owns the edited
+// text (see `ParsingResult_text`). Returns NULL with `errno` set to `EINVAL`
+// when the edit is out of the previous input.
+ParsingResult* Grammar_reparse( Grammar* this, ParsingResult* previous, size_t offset, size_t removed, const char* inserted );
+
+/**
+ * Push parsing
+ * ------------
+ *
+ * Sockets and pipes give their input in chunks, and waiting for the whole
+ * input before parsing it delays the errors. A push iterator (see
+ * `Iterator_Push`) is fed the chunks as they arrive, and its parses are
+ * `STATUS_INCOMPLETE` as long as their outcome depends on the input that
+ * hasn't arrived yet, which is when they examined the end of the fed data.
+ * Until then, tokens are matched with PCRE's hard partial matching, so that
+ * a token truncated by the end of the fed data (`"abc` for `"[^"]*"`)
+ * makes the parse incomplete rather than failing. Errors in the fed data
+ * fail the parse right away, and once the input is
+ * ended (see `Iterator_end`), the parse succeeds or fails as any other.
+ *
+ * Parses can't be suspended, as the recognitions are nested calls, so
+ * `Grammar_resume` parses the input again from its start, but reuses the
+ * recognitions that did not examine the end of the previously fed data,
+ * in the same way as `Grammar_reparse` does. Push parses are always
+ * memoized, with the default limit unless `Grammar_setMemoize` was called.
+ *
+ * ```
+ * Iterator*      input = Iterator_Push();
+ * ParsingResult* r     = Grammar_parseIterator(g, input);
+ * while (ParsingResult_isIncomplete(r)) {
+ *     ssize_t n = read(fd, chunk, sizeof(chunk));
+ *     if (n > 0) {Iterator_feed(input, chunk, n);} else {Iterator_end(input);}
+ *     ParsingResult* s = Grammar_resume(g, r);
+ *     ParsingResult_free(r);
+ *     r = s;
+ * }
+ * ```
+*/
+
+// @method
+// Parses the input of the `previous` result's push iterator again, once
+// it was fed or ended. The memoization table and the ownership of the
+// iterator are moved to the new result, and the previous result should
+// then only be freed. Returns NULL with `errno` set to `EINVAL` when the
+// previous result doesn't come from a push iterator.
+ParsingResult* Grammar_resume( Grammar* this, ParsingResult* previous );
+
+/**
+ * Parallel parsing
+ * ----------------
+ *
+ * Inputs made of independent top-level parts (records, statements,
+ * declarations) can be split in chunks that are parsed concurrently, each
+ * chunk starting just after a match of a *boundary* (or where a split
+ * callback says). Each chunk is parsed from the axiom, with its own parsing
+ * context and an `Iterator_FromSlice` over the shared text, so that the
+ * matches have the offsets and lines of the whole text.
+ *
+ * The results are joined in one `ParsingResult`, whose match is a match of
+ * the axiom spanning the parsed chunks, and whose children are the matches
+ * of the axiom for each chunk, ordered by offset. The join stops at the first
+ * chunk that does not parse entirely (the result is then partial, or failed
+ * if it is the first chunk).
+ *
+ * Batches of separate inputs are parsed in the same way by
+ * `Grammar_parseMany`, which gives each input a result of its own.
+ *
+ * The grammar is prepared before the chunks are parsed, and is then only
+ * read, so it must not be changed during the parse. Procedures, conditions
+ * and context callbacks are called from several threads, and must be
+ * thread-safe themselves. Without the `threads` feature, the chunks are
+ * parsed one after the other.
+*/
+
+// @define
+// The number of chunks per job, and the minimum size of a chunk
+#define PARALLEL_CHUNKS     4
+#define PARALLEL_CHUNK_SIZE (64 * 1024)
+
+// @callback
+// Returns the offset of the first chunk start at or after `offset` in the
+// `length` bytes of `text`, or `length` if there is none.
+typedef size_t (*ParsingSplitCallback)(const char* text, size_t length, size_t offset, void* data);
+
+// @method
+// Parses the text in chunks that start just after a non-empty match of the
+// `boundary` element, using `jobs` threads (or one per processor when `jobs`
+// is `0`).
+ParsingResult* Grammar_parseParallel( Grammar* this, const char* text, ParsingElement* boundary, int jobs );
+
+// @method
+// Parses the text in chunks that start at the offsets returned by `split`,
+// using `jobs` threads (or one per processor when `jobs` is `0`).
+ParsingResult* Grammar_parseParallelWith( Grammar* this, const char* text, ParsingSplitCallback split, void* data, int jobs );
+
+// @method
+// Parses each of the `count` inputs from the axiom, using `jobs` threads
+// (or one per processor when `jobs` is `0`), and sets the result of each
+// input at the same index of `results`. The inputs are not owned by the
+// results, as with `Grammar_parseIterator`.
+void Grammar_parseMany( Grammar* this, Iterator** inputs, ParsingResult** results, int count, int jobs );
+
+/**
+ * C generator
+ * -----------
+ *
+ * Grammars that don't change at runtime can be compiled to C, which saves
+ * the indirect calls and the cardinality switch of each recognition step.
+ * `Grammar_writeC` writes a translation unit with a recognizer for each
+ * word, rule, group and reference of the prepared grammar, where words
+ * are constant compares and references are loops that call the
+ * recognizers of their elements directly. Tokens, procedures and
+ * conditions are still recognized by the library.
+ *
+ * The translation unit defines `bool <prefix>_install(Grammar* g)`, which
+ * checks that `g` has the elements the code was generated from (built by
+ * the same code) and then sets the generated recognizers on its elements.
+ * The grammar is then parsed as usual, gives the same matches, and works
+ * with memoization, budgets, processors and profilers. The generated recognizers don't log
+ * steps when the grammar is verbose, and the grammar must not be prepared
+ * again after install. The generated code must be compiled with the same
+ * `WITH_*` flags as the library.
+ *
+ * ```
+ * Grammar_writeC(g, fd, "expr");     // At build time
+ * expr_install(g);                   // At runtime, once
+ * ParsingResult* r = Grammar_parseString(g, "1 + 2");
+ * ```
+*/
+
+// @method
+// Writes the C code of the recognizers of the grammar's elements to the
+// given file descriptor, prefixing the generated names with `prefix`
+// (which must be a valid C identifier). Returns FALSE when the grammar
+// was optimized (see `Grammar_setOptimize`).
+bool Grammar_writeC( Grammar* this, int fd, const char* prefix );
+
 // @method
 void Grammar_freeElements(Grammar* this);
 
+/**
+ * Arena
+ * -----
+ *
+ * Matches (and the data they hold) are allocated in an arena owned by the
+ * parsing context. An arena is a list of blocks in which allocations are
+ * simply bumped. Marking the arena and rewinding it to a mark releases
+ * everything allocated since then, which is what failing branches do, and
+ * the whole match tree is released at once when the arena is freed.
+*/
+
+// @define
+// The default size of the arena's blocks
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+// @type
+typedef struct ArenaBlock {
+	char*               data;
+	size_t              size;
+	struct ArenaBlock*  next;
+} ArenaBlock;
+
+// @type
+typedef struct ArenaMark {
+	ArenaBlock*         block;
+	size_t              offset;
+} ArenaMark;
+
+// @type
+typedef struct Arena {
+	ArenaBlock*         first;
+	ArenaBlock*         current;   // The block in which allocations are made
+	size_t              offset;    // The offset of the next allocation in the current block
+	size_t              allocated; // The total size of the blocks
+} Arena;
+
+// @constructor
+Arena* Arena_new(void);
+
+// @destructor
+// Frees the arena, along with everything allocated in it.
+void Arena_free(Arena* this);
+
+// @method
+// Allocates `size` bytes in the arena. The memory is not initialized.
+void* Arena_alloc(Arena* this, size_t size);
+
+// @method
+// Returns a mark of the current allocation position.
+ArenaMark Arena_mark(Arena* this);
+
+// @method
+// Rewinds the arena to the given mark, releasing everything allocated
+// since. The blocks are kept for reuse.
+void Arena_rewind(Arena* this, ArenaMark mark);
+
+// @method
+// Releases everything allocated in the arena, keeping the blocks for reuse.
+void Arena_reset(Arena* this);
+
+/**
+ * Output
+ * ------
+ *
+ * The JSON and XML writers go through an output, which buffers what is
+ * written and flushes it to a file descriptor or to a sink in blocks of
+ * `OUTPUT_BLOCK_SIZE` bytes. Outputs without a file descriptor or sink
+ * keep the whole document in memory, see `Output_text`.
+ *
+ * ```c
+ * Output* output = Output_new();
+ * Match_outputJSON(r->match, output);
+ * printf("%s", Output_text(output));
+ * Output_free(output);
+ * ```
+*/
+
+// @define
+// The size of the blocks in which outputs are flushed
+#define OUTPUT_BLOCK_SIZE (64 * 1024)
+
+// @callback
+// Writes the given data somewhere, returning FALSE on failure.
+typedef bool (*OutputSink)(const char* data, size_t length, void* context);
+
+// @type
+typedef struct Output {
+	char*       buffer;
+	size_t      length;    // The length of the buffered data
+	size_t      capacity;
+	size_t      written;   // The count of bytes flushed so far
+	int         fd;        // The file descriptor to flush to, -1 for none
+	OutputSink  sink;      // The sink to flush to, when there is no file descriptor
+	void*       context;   // The argument given to the sink
+	bool        failed;    // Set when a flush failed, the following data being dropped
+} Output;
+
+// @constructor
+// Creates an output that keeps what is written in memory.
+Output* Output_new(void);
+
+// @constructor
+// Creates an output that flushes to the given file descriptor, which is
+// not closed by the output.
+Output* Output_ToFile(int fd);
+
+// @constructor
+// Creates an output that flushes to the given sink.
+Output* Output_ToSink(OutputSink sink, void* context);
+
+// @destructor
+// Flushes and frees the output.
+void Output_free(Output* this);
+
+// @method
+void Output_write(Output* this, const char* data, size_t length);
+
+// @method
+void Output_writeString(Output* this, const char* string);
+
+// @method
+void Output_writef(Output* this, const char* format, ...);
+
+// @method
+// Writes the data with newlines, tabs, carriage returns, double quotes
+// and backslashes escaped by a backslash, as found in JSON strings.
+void Output_writeEscaped(Output* this, const char* data, size_t length);
+
+// @method
+// Writes the buffered data to the file descriptor or sink, if any.
+// Returns FALSE when this or a previous flush failed.
+bool Output_flush(Output* this);
+
+// @method
+// Returns the NUL-terminated text of an output that is kept in memory,
+// which lives as long as the output.
+const char* Output_text(Output* this);
+
 /**
  * Elements
  * --------
@@ -394,14 +986,15 @@ int Element__walk( Element* this, ElementWalkingCallback callback, int step, voi
 typedef struct Match {
 	// TODO: We might need to put offset there
 	char            status;     // The status of the match (see STATUS_XXX)
+	char            flags;      // A combination of MATCH_XXX flags
 	size_t          offset;     // The offset of `char` matched
 	size_t          length;     // The number of `char` matched
-	size_t          line;       // The line number for the match
+	size_t          line;       // The line number for the match, SIZE_MAX until looked up (see `Match_getLine`)
 	Element*        element;
 	void*           data;      // The matched data (usually a subset of the input stream)
 	struct Match*   next;      // A pointer to the next  match (see `References`)
 	struct Match*   children;  // A pointer to the child match (see `References`)
-	struct Match*   parent;    // A pointer to the parent match
+	struct Match*   parent;    // A pointer to the parent match, NULL for the root
 	void*           result;    // A pointer to the result of the match
 } Match;
 
@@ -422,6 +1015,16 @@ typedef struct Match {
 #define STATUS_INPUT_ENDED '.'
 // @define
 #define STATUS_ENDED       'E'
+// @define
+// The status of parses of a push iterator that need more input
+#define STATUS_INCOMPLETE  'i'
+// @define
+// The status of parses aborted as they exceeded their memory budget
+#define STATUS_EXCEEDED    'x'
+// @define
+// The status of parses aborted as they nested deeper than the maximum
+// depth of the iterative engine
+#define STATUS_TOO_DEEP    'd'
 
 // @define
 #define TYPE_ELEMENT    'E'
@@ -438,9 +1041,14 @@ typedef struct Match {
 // @define
 #define TYPE_PROCEDURE  'p'
 // @define
+#define TYPE_CUT        '!'
+// @define
 #define TYPE_REFERENCE  '#'
 
 #define FLAG_SKIPPING    0x1
+// Every rule pushes a scope, and not only rules that reach procedures
+// or conditions (see `Rule_recognize`).
+#define FLAG_SCOPED      0x2
 
 #define FLAG_NOEMPTY     0x1
 
@@ -483,9 +1091,25 @@ Match* Match_new(void);
 // a failed match, as it's likely to be the `FAILURE` singleton.
 void* Match_free(Match* this);
 
+// @define
+// The match is allocated in an arena. Arena matches only reference
+// arena matches, and are released along with the arena.
+#define MATCH_ARENA 0x01
+
+// @constructor
+// Creates a new match in the given arena.
+Match* Match_FromArena(Arena* arena);
+
 // @method
 void* Match_fail(Match* this);
 
+// @method
+// Returns a deep copy of this match and its children (but not of its
+// `next` matches), allocated in the given arena, or on the heap when `arena`
+// is NULL. The `bytes` counter, when not NULL, is incremented
+// with the memory allocated for the copy.
+Match* Match_copy(Match* this, Arena* arena, size_t* bytes);
+
 // @method
 bool Match_isSuccess(Match* this);
 
@@ -504,6 +1128,14 @@ Match* Match_getChildren(Match* this);
 // @method
 int Match_getOffset(Match* this);
 
+// @method
+// Returns the line of the match, which is looked up in the iterator of
+// the input it was parsed from the first time it is requested, but for
+// the iterators whose window discards the input, for which it is set when
+// the match is created. Without an iterator, it is SIZE_MAX unless it was
+// set or looked up before.
+size_t Match_getLine(Match* this, Iterator* iterator);
+
 // @method
 int Match_getLength(Match* this);
 
@@ -545,7 +1177,11 @@ int Match_countChildren(Match* this);
 
 // @method
 // Protected method
-void Match__writeJSON(Match* match, int fd, int flags);
+void Match__writeJSON(Match* match, Output* output, int flags);
+
+// @method
+// Writes the match as JSON to the given output.
+void Match_outputJSON(Match* this, Output* output);
 
 // @method
 void Match_writeJSON(Match* this, int fd);
@@ -555,7 +1191,11 @@ void Match_printJSON(Match* this);
 //
 // @method
 // Protected method
-void Match__writeXML(Match* match, int fd, int flags);
+void Match__writeXML(Match* match, Output* output, int flags);
+
+// @method
+// Writes the match as XML to the given output.
+void Match_outputXML(Match* this, Output* output);
 
 // @method
 void Match_writeXML(Match* this, int fd);
@@ -573,8 +1213,21 @@ typedef struct ParsingElement {
 	struct Match*         (*recognize) (struct ParsingElement*, ParsingContext*);
 	struct Match*         (*process)   (struct ParsingElement*, ParsingContext*, Match*);
 	void                  (*freeMatch) (Match*);
+	int            flags;      // A combination of ELEMENT_XXX flags
 } ParsingElement;
 
+// @define
+// The element's successes are not memoized
+#define ELEMENT_NOMEMO      0x01
+// @define
+// The element's failures are not memoized
+#define ELEMENT_NOFAILMEMO  0x02
+// @define
+// Set by `Grammar_prepare` when the element can reach a procedure or
+// a condition. The outcome of such elements depends on the parsing
+// context, so they are never memoized.
+#define ELEMENT_CONTEXTUAL  0x04
+
 // @operation
 // Tells if the given pointer is a pointer to a ParsingElement.
 bool         ParsingElement_Is(void* this);
@@ -603,7 +1256,10 @@ ParsingElement* ParsingElement_clear(ParsingElement* this);
 
 // @method
 // Applies the grammar's skip property *once* , returning
-// the resulting change in the parsing offset.
+// the resulting change in the parsing offset. A skip element that is a
+// repeated character class (like `[ \t\n]+`) is run as a scan of its bytes,
+// without allocating a match, and the end of the last skip is kept so that
+// skipping again at the same offset costs nothing.
 size_t ParsingElement_skip(ParsingElement* this, ParsingContext* context);
 
 // @method
@@ -612,6 +1268,19 @@ size_t ParsingElement_skip(ParsingElement* this, ParsingContext* context);
 // to do things such as construct an AST.
 Match* ParsingElement_process( ParsingElement* this, Match* match );
 
+// @method
+// Recognizes this element at the context's current position, going
+// through the context's memoization table when there is one. This is
+// what references use to recognize their element, and where the memory
+// budget of the context is checked (see `Grammar_setBudget`).
+Match* ParsingElement_recognize( ParsingElement* this, ParsingContext* context );
+
+// @method
+// Tells if the successes and/or failures of this element should be memoized.
+// Memoization only applies to rules and groups, and only when enabled
+// in the grammar (see `Grammar_setMemoize`).
+ParsingElement* ParsingElement_memoize( ParsingElement* this, bool successes, bool failures );
+
 // FIXME: Maybe should inline
 // @method
 // Transparently sets the name of the element
@@ -665,6 +1334,16 @@ const char* WordMatch_group(Match* match);
  * any children and test if the regular expression matches exactly at the
  * iterator's current location.
  *
+ * The regular expressions are run by PCRE2 when built with the `pcre2`
+ * feature, and by the legacy PCRE otherwise. With PCRE2, expressions are
+ * JIT-compiled when possible, and the match data is reused by all the
+ * tokens recognized in a context.
+ *
+ * The literal prefix that every match of the expression starts with (`//`
+ * in `//[^\n]*`) is extracted when the token is created, so that tokens
+ * can be rejected without running the regular expression, as can the
+ * tokens whose first byte is not in their first set (see `FirstSet`).
+ *
 */
 
 // @type TokenConfig
@@ -672,16 +1351,39 @@ const char* WordMatch_group(Match* match);
 // `Token` methods.
 typedef struct TokenConfig {
 	char* expr;
-#ifdef WITH_PCRE
+	char*       prefix;       // The literal prefix of all the matches, NULL when there is none
+	size_t      prefixLength;
+	bool        literal;      // Tells if the expression is only its prefix
+	FirstSet    first;        // The bytes the matches can start with
+	FirstSet*   repeats;      // The bytes of the character class that the expression only repeats, NULL otherwise
+#if defined(WITH_PCRE2)
+	pcre2_code* regexp;       // The expression, compiled anchored
+	int         groups;       // The number of groups, including the whole match
+	bool        jit;          // Tells if the expression was JIT-compiled
+#elif defined(WITH_PCRE)
 	pcre*       regexp;
 	pcre_extra* extra;
 #endif
 } TokenConfig;
 
 // @type
+// A token match group, as a span of the input. Groups that did not
+// participate in the match are empty.
+typedef struct TokenMatchGroup {
+	size_t          offset;    // The offset of the group in the input
+	size_t          length;    // The length of the group
+} TokenMatchGroup;
+
+// @type
+// Token matches store their groups as spans of the input, the group
+// strings being only created when requested by `TokenMatch_group`, but
+// for the inputs that might be discarded (see `Token_recognize`).
 typedef struct TokenMatch {
-	int             count;
-	const char**    groups;
+	int              count;
+	TokenMatchGroup* spans;     // The spans of the `count` groups
+	const char**     groups;    // The group strings, created on demand
+	ParsingContext*  context;   // The context whose iterator holds the input
+	bool             owned;     // Tells if the groups were copied along with the match, and are freed with it
 } TokenMatch;
 
 
@@ -693,7 +1395,8 @@ ParsingElement* Token_new(const char* expr);
 void Token_free(ParsingElement*);
 
 // @method
-// The specialized match function for token parsing elements.
+// The specialized match function for token parsing elements. Tokens whose
+// literal prefix is not at the current location fail right away.
 Match* Token_recognize(ParsingElement* this, ParsingContext* context);
 
 // @method
@@ -704,11 +1407,28 @@ const char* Token_expr(ParsingElement* this);
 void TokenMatch_free(Match* match);
 
 // @method
+// Returns the given group as a NUL-terminated string. The string is created
+// on the first call and lives as long as the match's parsing context.
 const char* TokenMatch_group(Match* match, int index);
 
+// @method
+// Returns a pointer to the start of the given group in the input, without
+// copying it, or to its copy when the input might have been discarded. The
+// group is not NUL-terminated, see `TokenMatch_groupLength`.
+const char* TokenMatch_groupStart(Match* match, int index);
+
+// @method
+// Returns the length of the given group.
+int TokenMatch_groupLength(Match* match, int index);
+
 // @method
 int TokenMatch_count(Match* match);
 
+// @method
+// Returns a copy of the `TokenMatch` of the given match, allocated in the
+// given arena, or on the heap when `arena` is NULL.
+TokenMatch* TokenMatch_copy(Match* match, Arena* arena);
+
 /**
  * ### References
  *
@@ -808,6 +1528,57 @@ ParsingElement* Group_new(Reference* children[]);
 // @method
 Match*          Group_recognize(ParsingElement* this, ParsingContext* context);
 
+/**
+ * ### Word sets
+ *
+ * When a group has a run of (at least `WORDSET_MINIMUM`) consecutive
+ * children that reference words, `Grammar_prepare` compiles the run into
+ * a `WordSet`, a trie that finds the first word of the run that matches the
+ * input in a single pass. The group then only recognizes that word, so
+ * that matches still point to the original `Word` element, and the ordered
+ * choice of the group is preserved.
+*/
+
+#define WORDSET_MINIMUM 4
+
+// @type WordSetNode
+// A node of the trie, its children being a list of siblings.
+typedef struct WordSetNode {
+	unsigned char    byte;        // The byte that leads to this node
+	int              word;        // The index of the first word that ends here, or -1
+	int              child;       // The index of the first child node, or -1
+	int              sibling;     // The index of the next sibling node, or -1
+} WordSetNode;
+
+// @type WordSet
+typedef struct WordSet {
+	int                 start;      // The index of the first child of the run in the group
+	int                 count;      // The number of words in the run
+	Reference**         words;      // The references of the run, by index
+	int                 root[256];  // The node for each first byte, or -1
+	WordSetNode*        nodes;
+	int                 nodesCount;
+	int                 nodesCapacity;
+	size_t              longest;    // The length of the longest word of the run
+	struct WordSet*     next;       // The next run in the same group
+} WordSet;
+
+// @constructor
+WordSet* WordSet_new(int start);
+
+// @destructor
+// Frees this word set and the ones that follow it.
+void WordSet_free(WordSet* this);
+
+// @method
+// Adds the given word reference at the end of the run.
+void WordSet_add(WordSet* this, Reference* word);
+
+// @method
+// Returns the index of the first word of the run that is a prefix of the
+// first `length` bytes of the given text, or -1 if no word matches.
+int WordSet_match(WordSet* this, const char* text, size_t length);
+
 /**
  * ### Rules
  *
@@ -857,6 +1628,29 @@ ParsingElement* Condition_new(ConditionCallback c);
 // @method
 Match*          Condition_recognize(ParsingElement* this, ParsingContext* context);
 
+/*
+ * ### Cuts
+ *
+ * Cuts are parsing elements that do not consume any input and always
+ * succeed, committing the parse to what was recognized so far. They are
+ * placed in a rule after a prefix that is unambiguous, such as a keyword:
+ * once the cut is passed, a failure is final. The groups that are being
+ * recognized don't try their other alternatives, optional references fail,
+ * and the parse never backtracks before the cut. The memoized recognitions
+ * before the cut are evicted first (see `Memo_evict`), and the input before
+ * the cut is committed, so that streams can discard it (see
+ * `Iterator_Stream`).
+ *
+ * Cuts have no effect in the skip element, and the recognitions that pass
+ * a cut are not memoized.
+*/
+
+// @constructor
+ParsingElement* Cut_new(void);
+
+// @method
+Match*          Cut_recognize(ParsingElement* this, ParsingContext* context);
+
 /**
  * The parsing process
  * -------------------
@@ -867,19 +1661,39 @@ Match*          Condition_recognize(ParsingElement* this, ParsingContext* contex
  * The grammar's `axiom` will be matched against the `iterator`'s current
  * position, and if necessary, the grammar's `skip` parsing element
  * will be applied to advance the iterator.
+ *
+ * The memory that the parse holds is accounted in its stats (see
+ * `ParsingContext_account`), and can be capped with `Grammar_setBudget`.
+ * The budget is checked before each recognition, and once it is exceeded
+ * every recognition fails, nothing more is memoized, and the result has
+ * the `STATUS_EXCEEDED` status.
+ *
+ * The parses run on the recursive engine, unless the grammar selects the
+ * iterative one, which has a maximum depth (see `Grammar_setEngine`).
 */
 
 // @type
+// Parsing stats are always collected for the whole parse, but the counters
+// by symbol are only updated when the library is built `WITH_STATS` (see
+// the `stats` feature in the Makefile), so that they cost nothing otherwise.
 typedef struct ParsingStats {
 	size_t   bytesRead;
-	double   parseTime;
+	double   parseTime;       // The wall-clock time of the parse (in seconds)
 	size_t   symbolsCount;
 	size_t*  successBySymbol;
 	size_t*  failureBySymbol;
+	size_t*  bytesBySymbol;   // The bytes consumed by the successful matches of each symbol
+	double*  timeBySymbol;    // The time spent recognizing each symbol and its children (in seconds)
 	size_t   failureOffset;   // A reference to the deepest failure
 	size_t   matchOffset;
 	size_t   matchLength;
 	Element* failureElement;  // A reference to the failure element
+	size_t   memoHits;        // The number of recognitions served by the memoization table
+	size_t   memoMisses;      // The number of memoizable recognitions that had to be run
+	size_t   bytesMatches;    // The bytes of the arenas of the matches and their strings (see `ParsingContext_account`)
+	size_t   bytesInput;      // The bytes of the input buffer, when the iterator owns it
+	size_t   bytesVariables;  // The bytes of the arrays of the variables and their keys
+	size_t   bytesMemo;       // The bytes of the memoization table and the matches it holds
 } ParsingStats;
 
 // @constructor
@@ -891,65 +1705,195 @@ void ParsingStats_free(ParsingStats* this);
 // @method
 void ParsingStats_setSymbolsCount(ParsingStats* this, size_t t);
 
+// @method
+// Resets the counters, keeping the symbols count.
+void ParsingStats_reset(ParsingStats* this);
+
 // @method
 Match* ParsingStats_registerMatch(ParsingStats* this, Element* e, Match* m);
 
+// @method
+// Returns the number of times the symbol with the given id was recognized,
+// which is the sum of its successes and failures.
+size_t ParsingStats_attempts(ParsingStats* this, int id);
+
+// @operation
+// Returns the time (in seconds) of a monotonic clock, which is meant to
+// measure durations.
+double ParsingStats_now(void);
+
 /**
  * 1. Parsing variables
  * --------------------
  *
- * Parsing variables for a type of hierarchical list that can store
- * named values within a parsing element subtrees. It basically allows
- * for the storing of contextual values during parse time. The parsing
- * variables are not handled directly, but are instead accessed through
- * the `ParsingContext` object.
+ * Parsing variables are a stack of scopes that can store named values
+ * within a parsing element subtrees. It basically allows for the storing
+ * of contextual values during parse time. The parsing variables are not
+ * handled directly, but are instead accessed through the `ParsingContext`
+ * object. Rules only push a scope when they reach a procedure or a
+ * condition, as other rules cannot set or read variables.
 */
 
 // @type
 typedef struct ParsingVariable {
-	int depth;
-	char* key;
+	int   depth;   // The depth of the scope where the variable was set
+	int   key;     // The interned name of the variable (see `ParsingVariables_key`)
 	void* value;
-	struct ParsingVariable* previous;
 } ParsingVariable;
 
+// @type
+// The variables of all the scopes are stored in a single array, the
+// innermost scope last, so that pushing and popping a scope does not
+// allocate anything. Variable names are interned as integer keys, the
+// key `0` being `depth`, which is the depth of the current scope.
+typedef struct ParsingVariables {
+	ParsingVariable* items;
+	int              count;
+	int              capacity;
+	char**           keys;      // The interned names, indexed by key
+	int              keysCount;
+	int              keysCapacity;
+	int              depth;     // The depth of the current scope
+} ParsingVariables;
+
+// @define
+// The initial number of variables (and keys) a scope store can hold.
+#define PARSING_VARIABLES_CAPACITY 8
+
 // @constructor
-ParsingVariable* ParsingVariable_new(int depth, const char* key, void* value);
+ParsingVariables* ParsingVariables_new(void);
 
 // @destructor
-void ParsingVariable_free(ParsingVariable* this);
+void ParsingVariables_free(ParsingVariables* this);
 
-// @destructor
-void ParsingVariable_freeAll(ParsingVariable* this);
+// @method
+// Returns the key for the given variable name, interning it if needed.
+int ParsingVariables_key(ParsingVariables* this, const char* name);
 
 // @method
-bool ParsingVariable_is(ParsingVariable* this, const char* key);
+// Returns the name of the variable with the given key, if any.
+const char* ParsingVariables_getName(ParsingVariables* this, int key);
 
 // @method
-ParsingVariable* ParsingVariable_set(ParsingVariable* this, const char* name, void* value);
+// Pushes a new scope, which does not allocate anything.
+void ParsingVariables_push(ParsingVariables* this);
 
 // @method
-void* ParsingVariable_get(ParsingVariable* this, const char* name);
+// Pops the current scope, dropping its variables.
+void ParsingVariables_pop(ParsingVariables* this);
 
 // @method
-ParsingVariable* ParsingVariable_find(ParsingVariable* this, const char* key, bool local);
+// Returns the value of the variable in the innermost scope that sets it.
+void* ParsingVariables_get(ParsingVariables* this, int key);
 
 // @method
-int ParsingVariable_getDepth(ParsingVariable* this);
+// Sets the variable in the current scope.
+void ParsingVariables_set(ParsingVariables* this, int key, void* value);
 
 // @method
-const char* ParsingVariable_getName(ParsingVariable* this);
+// Drops all the variables and scopes, keeping the interned keys.
+void ParsingVariables_clear(ParsingVariables* this);
 
 // @method
-int  ParsingVariable_count(ParsingVariable* this);
+// Returns the number of variables set in all the scopes.
+int  ParsingVariables_count(ParsingVariables* this);
 
 /**
- * 2. Parsing context
+ * 2. Memoization
+ * --------------
+ *
+ * The memoization table stores the outcome of recognizing a given element
+ * at a given offset, so that backtracking does not recognize the same
+ * element at the same offset again (_packrat parsing_). Entries are keyed by
+ * `(element id, offset)`, and store a private copy of the successful match
+ * (or `FAILURE`) along with the iterator offset after the recognition.
+ *
+ * The table's memory usage (entries and copied matches) is capped by
+ * the grammar's `memoLimit`. When the cap is reached, the table is
+ * cleared and starts filling again from the current position.
+*/
+
+// @define
+// The default memory cap for the memoization table (64Mb)
+#define MEMO_LIMIT_DEFAULT (64 * 1024 * 1024)
+
+// @type
+typedef struct MemoEntry {
+	int             id;          // The memoized element's id, ID_UNBOUND for empty slots
+	size_t          offset;      // The offset at which the element was recognized
+	size_t          end;         // The iterator's offset after the recognition
+	size_t          reach;       // The offset past the last byte the recognition examined
+	long            shift;       // The offset delta of the match, when moved by `Memo_reuse`
+	int             lines;       // The line delta of the match, when moved by `Memo_reuse`
+	size_t          bytes;       // The number of bytes held by the copied match
+	Match*          match;       // A copy of the match, or `FAILURE`
+} MemoEntry;
+
+// @type
+typedef struct Memo {
+	MemoEntry*      entries;
+	size_t          capacity;    // The number of slots, always a power of 2
+	size_t          count;       // The number of used slots
+	size_t          bytes;       // The memory used by slots and copied matches
+	size_t          limit;       // The maximum value for `bytes`
+	size_t          floor;       // The entries before this offset won't be looked up again, see `Cut_recognize`
+	size_t          evicted;     // The floor when entries were last evicted
+} Memo;
+
+// @constructor
+Memo* Memo_new(size_t limit);
+
+// @destructor
+void Memo_free(Memo* this);
+
+// @method
+// Frees all the entries of the table, keeping its slots.
+void Memo_clear(Memo* this);
+
+// @method
+// Frees the entries recognized before the given offset. This is done when
+// the table is full and the floor has moved since the last eviction.
+void Memo_evict(Memo* this, size_t offset);
+
+// @method
+// Returns the entry for the given element id and offset, or NULL.
+MemoEntry* Memo_get(Memo* this, int id, size_t offset);
+
+// @method
+// Memoizes the given match (or `FAILURE`) for the given element id and offset,
+// `reach` being the offset past the last byte examined by the recognition. The
+// match is copied, so the memo does not take ownership of it.
+void Memo_set(Memo* this, int id, size_t offset, size_t end, size_t reach, Match* match);
+
+// @method
+// Moves the entries of `from` that are not affected by replacing `removed`
+// bytes at `offset` with `inserted` bytes to this table. Entries after the
+// edit are shifted, `lines` being the difference in the number of lines,
+// and the others are freed. See `Grammar_reparse`.
+void Memo_reuse(Memo* this, Memo* from, size_t offset, size_t removed, size_t inserted, int lines);
+
+/**
+ * 3. Parsing context
  * --------------------
  *
  *
 */
 
+// @define
+// The size beyond which the arena of a context is not kept in the pool of
+// its grammar (4Mb), so that a large parse doesn't hold on to its memory.
+#define CONTEXT_POOL_ARENA_LIMIT (4 * 1024 * 1024)
+
+// @type ContextPool
+// The contexts of freed results that a grammar keeps for reuse (see
+// `Grammar_setPool`).
+typedef struct ContextPool {
+	struct ParsingContext*  contexts;     // The free contexts, chained by `next`
+	int                     count;
+	int                     size;         // The maximum number of free contexts
+	void*                   lock;         // A `pthread_mutex_t`, when built `WITH_THREADS`
+} ContextPool;
+
 // @callback
 typedef void (*ContextCallback)(ParsingContext* context, char op );
 
@@ -958,7 +1902,7 @@ typedef struct ParsingContext {
 	struct Grammar*         grammar;      // The grammar used to parse
 	struct Iterator*        iterator;     // Iterator on the input data
 	struct ParsingStats*    stats;
-	struct ParsingVariable* variables;
+	struct ParsingVariables* variables;
 	size_t                  lastMatchOffset;    // The last deepest successful match, useful for displaying error
 	size_t                  lastMatchLength;    // The last deepest successful match, useful for displaying error
 	int                     lastMatchElementID; // The last deepest successful match, useful for displaying error
@@ -967,6 +1911,27 @@ typedef struct ParsingContext {
 	const char*             indent;
 	int                     flags;
 	bool                    freeIterator;
+	struct Memo*            memo;         // The memoization table, NULL when disabled
+	struct Arena*           arena;        // The arena where matches are allocated
+	struct Arena*           strings;      // The arena where group strings are created, never rewound
+	struct ParsingContext*  next;         // The contexts owned by this one (see `Grammar_parseParallel`)
+	size_t                  reach;        // The offset past the last byte examined, tracked when memoizing
+	struct Processor*       processor;    // The processor of the matches of `commit`, see `Processor_parseIterator`
+	struct Listener*        listener;     // The listener of the matches of `commit`, see `Listener_parseIterator`
+	struct Reference*       commit;       // The reference whose matches are processed as soon as they are recognized
+	struct Match*           enclosing;    // The match of the axiom before `commit`, see `ParsingContext__enclose`
+	bool                    opened;       // Tells if `enclosing` was processed, along with the first match of `commit`
+	void*                   matchData;    // The PCRE2 match data reused by the tokens, see `Token_recognize`
+	size_t                  skipOffset;   // The offset of the last skip, SIZE_MAX when there was none
+	size_t                  skipEnd;      // Where the last skip ended, see `ParsingElement_skip`
+	size_t                  skipReach;    // How far the last skip examined the input, when memoizing
+	size_t                  cuts;         // The number of cuts passed, see `Cut_recognize`
+	size_t                  cut;          // The offset of the last cut, before which the parse doesn't backtrack
+	size_t                  budget;       // The memory cap of the parse, 0 for none (see `Grammar_setBudget`)
+	bool                    exceeded;     // Set once the budget is exceeded, which aborts the parse
+	struct Profiler*        profiler;     // The profiler sampling the recognitions, see `Profiler_parseIterator`
+	struct Engine*          engine;       // The stack of the iterative engine, kept for the following parses
+	bool                    tooDeep;      // Set once the iterative engine exceeded its maximum depth
 } ParsingContext;
 
 
@@ -986,6 +1951,37 @@ char ParsingContext_charAt ( ParsingContext* this, size_t offset );
 // @method
 size_t ParsingContext_getOffset( ParsingContext* this );
 
+// @method
+// Moves the iterator back to the given offset, but not before the last
+// cut, which failures don't backtrack past (see `Cut_recognize`).
+void ParsingContext_backtrack( ParsingContext* this, size_t offset );
+
+// @method
+// Tells if the element or reference with the given id is sure to fail at
+// the current position, based on the next byte and the element's FIRST set.
+bool ParsingContext_rejects( ParsingContext* this, int id );
+
+// @method
+// Called by the axiom's rule as it starts recognizing the `commit`
+// reference, with its match so far (or FAILURE when the reference is its
+// first child) and its offset, so that the children before the reference
+// are processed along with the reference's first match, in order.
+void ParsingContext__enclose( ParsingContext* this, ParsingElement* rule, Match* result, size_t offset );
+
+// @method
+// Sets the `bytes*` counters of the context's stats to the memory that the
+// context holds: the blocks of its arenas, the input buffer that its
+// iterator owns, its variables and its memoization table. Returns their
+// total. The counters are set when the parse ends, and each time the
+// budget is checked.
+size_t ParsingContext_account( ParsingContext* this );
+
+// @method
+// Resets the context so that it parses the given iterator (which can be
+// NULL), as a new context would, but keeping its allocations. The
+// previous iterator is freed if the context owned it.
+void ParsingContext_reset( ParsingContext* this, Iterator* iterator );
+
 // @destructor
 void ParsingContext_free( ParsingContext* this );
 
@@ -1002,6 +1998,18 @@ void ParsingContext_pop ( ParsingContext* this );
 // Retrieves the value bound to the given `name` in the variables.
 void*  ParsingContext_get(ParsingContext*  this, const char* name);
 
+// @method
+// Returns the interned key for the given variable name, which can be used
+// with `ParsingContext_getVariable` and `ParsingContext_setVariable` to
+// avoid looking up the name each time.
+int  ParsingContext_key(ParsingContext* this, const char* name);
+
+// @method
+void* ParsingContext_getVariable(ParsingContext* this, int key);
+
+// @method
+void  ParsingContext_setVariable(ParsingContext* this, int key, void* value);
+
 // @method
 int  ParsingContext_getInt(ParsingContext*  this, const char* name);
 
@@ -1043,6 +2051,22 @@ bool ParsingResult_isFailure(ParsingResult* this);
 // @method
 bool ParsingResult_isPartial(ParsingResult* this);
 
+// @method
+// Tells if the result is the parse of a push iterator whose outcome depends
+// on the input that wasn't fed yet (see `Grammar_resume`).
+bool ParsingResult_isIncomplete(ParsingResult* this);
+
+// @method
+// Tells if the parse was aborted as it exceeded its memory budget (see
+// `Grammar_setBudget`), in which case the match is what was recognized
+// before, and can't be trusted.
+bool ParsingResult_isExceeded(ParsingResult* this);
+
+// @method
+// Tells if the parse was aborted as it nested deeper than the maximum depth
+// of the iterative engine (see `Grammar_setEngine`).
+bool ParsingResult_isTooDeep(ParsingResult* this);
+
 // @method
 char* ParsingResult_text(ParsingResult* this);
 
@@ -1052,9 +2076,200 @@ int ParsingResult_textOffset(ParsingResult* this);
 // @method
 size_t ParsingResult_remaining(ParsingResult* this);
 
+/**
+ * Match trees
+ * -----------
+ *
+ * Matches are linked through pointers, and are scattered across the
+ * context's arena along with the data of the failed recognitions. Once
+ * the parse is done, a result can be turned into a match tree, which
+ * stores the matches as an array of nodes in preorder. The first child of
+ * a node is always the next node, and the tree is walked by following
+ * the `children` and `next` indexes, or by iterating over the array.
+ *
+ * ```c
+ * MatchTree* tree = MatchTree_FromResult(Grammar_parseString(g, text));
+ * for (int i=0 ; i<tree->count ; i++) {
+ *     Element* element = MatchTree_element(tree, i);
+ *     ...
+ * }
+ * MatchTree_free(tree);
+ * ```
+ *
+ * The result (and its matches) is freed when the tree is created, but
+ * the tree keeps the iterator of the result, so that the groups of token
+ * matches can still be read from the input. Iterators given to
+ * `Grammar_parseIterator` are not owned by the result, and have to outlive
+ * the tree. Trees created with `MatchTree_new` leave the result as it is,
+ * for bindings that keep the result around.
+*/
+
+// @type MatchNode
+// A node of a match tree, indexed by its position in the tree.
+typedef struct MatchNode {
+	int              element;     // The id of the matched element or reference, see `MatchTree_element`
+	int              parent;      // The index of the parent node, -1 for the root
+	int              children;    // The index of the first child, -1 when there is none
+	int              next;        // The index of the next sibling, -1 for the last one
+	int              groups;      // The index of the first group of token matches in `MatchTree.groups`
+	int              groupsCount; // The count of groups, 0 for matches other than tokens
+	size_t           offset;
+	size_t           length;
+} MatchNode;
+
+// @type MatchTree
+typedef struct MatchTree {
+	char             status;      // The status of the result the tree was created from
+	MatchNode*       nodes;       // The nodes, in preorder (the root being the first one)
+	int              count;
+	TokenMatchGroup* groups;      // The groups of the token matches, as spans of the input
+	int              groupsCount;
+	Grammar*         grammar;     // The grammar whose elements the nodes refer to
+	const char*      text;        // The input the groups are read from, NULL when not available
+	size_t           textOffset;  // The offset of `text` in the input
+	size_t           textLength;
+	Iterator*        iterator;    // The iterator that holds the input, if any
+	bool             freeIterator;
+	MappedInput*     mapped;      // The mapped file that holds the text, see `MatchTree_readBinary`
+} MatchTree;
+
+// @callback
+typedef int (*MatchTreeWalkingCallback)(MatchTree* tree, int node, int step, void* context);
+
+// @constructor
+// Creates a match tree out of the result's matches, leaving the result as
+// it is. The tree reads the groups from the result's input, and must not
+// outlive the result.
+MatchTree* MatchTree_new(ParsingResult* result);
+
+// @constructor
+// Creates a match tree out of the result's matches, and frees the result.
+// The tree is empty when the result's parse failed.
+MatchTree* MatchTree_FromResult(ParsingResult* result);
+
+// @destructor
+void MatchTree_free(MatchTree* this);
+
+// @method
+// Returns the element or reference that the node matched.
+Element* MatchTree_element(MatchTree* this, int node);
+
+// @method
+// Returns a pointer to the start of the given group of a token match in
+// the input, without copying it, or NULL when the input was discarded
+// (see `Iterator_Stream`) or is not available.
+const char* MatchTree_groupStart(MatchTree* this, int node, int index);
+
+// @method
+int MatchTree_groupLength(MatchTree* this, int node, int index);
+
+// @method
+// Calls `callback` with `(tree, node, step, context)` for each node of
+// the tree in preorder, as `Match__walk` does for the matches, stopping
+// the traversal when the callback returns a negative step.
+int MatchTree_walk(MatchTree* this, MatchTreeWalkingCallback callback, int step, void* context);
+
+// @method
+// Copies the nodes into flat arrays of `count` items in one call, so that
+// bindings don't have to read the nodes one field at a time. The groups
+// of node `i` are the spans `groups[i]` to `groups[i+1]` (excluded), so
+// that `groups` has `count + 1` items, and `spans` holds the offset and
+// length of each of the `groupsCount` groups. Offsets are in the input,
+// and any of the arrays can be NULL.
+void MatchTree_export(MatchTree* this, int* elements, int* parents, size_t* offsets, size_t* lengths, int* groups, size_t* spans);
+
+// @method
+// Protected method
+void MatchTree__writeJSON(MatchTree* this, int node, Output* output);
+
+// @method
+// Writes the tree as JSON, as `Match_outputJSON` does for the matches.
+void MatchTree_outputJSON(MatchTree* this, Output* output);
+
+// @method
+void MatchTree_writeJSON(MatchTree* this, int fd);
+
+// @method
+// Protected method
+void MatchTree__writeXML(MatchTree* this, int node, Output* output);
+
+// @method
+// Writes the tree as XML, as `Match_outputXML` does for the matches.
+void MatchTree_outputXML(MatchTree* this, Output* output);
+
+// @method
+void MatchTree_writeXML(MatchTree* this, int fd);
+
+/**
+ * ### Binary match trees
+ *
+ * Match trees can be written in a binary form, to be cached or sent to
+ * another process, and read back without parsing the input again. The
+ * binary form starts with a header:
+ *
+ * - The `MATCH_TREE_MAGIC` bytes and the `MATCH_TREE_FORMAT` byte
+ * - A byte of `MATCH_TREE_*` flags
+ * - The fingerprint of the grammar, as 8 little-endian bytes
+ * - The status of the result, as a byte
+ * - The count of nodes and of groups, and the offset and length of the
+ *   text, as varints
+ *
+ * Varints are unsigned LEB128 integers, signed ones being zigzag encoded.
+ * The text follows when written with `MATCH_TREE_TEXT`, and then the
+ * nodes in preorder, each as:
+ *
+ * - The element id
+ * - The distance to the parent node, 0 for the root
+ * - The offset, relative to the parent's (signed)
+ * - The length
+ * - The count of groups, followed by their offset relative to the node's
+ *   (signed) and length
+ *
+ * Binary trees only load with a grammar of the same fingerprint. The text
+ * of the loaded tree is not copied, but points into the binary data.
+*/
+
+// @define
+#define MATCH_TREE_MAGIC   "LPMT"
+// @define
+// The version of the binary form
+#define MATCH_TREE_FORMAT  1
+// @define
+// The text of the tree is written along with the nodes
+#define MATCH_TREE_TEXT    0x01
+
+// @method
+// Writes the tree to the output in binary form, with the given
+// combination of `MATCH_TREE_*` flags. Returns FALSE when the output
+// failed, or when the text was requested but is not available.
+bool MatchTree_writeBinary(MatchTree* this, Output* output, int flags);
+
+// @constructor
+// Creates a match tree from its binary form. The text of the tree, if
+// any, points into the data, which has to outlive the tree. Returns NULL
+// with `errno` set to EINVAL when the data is not a binary tree of the
+// grammar.
+MatchTree* MatchTree_FromBinary(Grammar* grammar, const char* data, size_t length);
+
+// @constructor
+// Creates a match tree from the binary file at the given path, which is
+// mapped in memory and unmapped along with the tree. Returns NULL with
+// `errno` set when the file can't be mapped or is not a binary tree of
+// the grammar.
+MatchTree* MatchTree_readBinary(Grammar* grammar, const char* path);
+
 /**
  * Processor
  * ---------
+ *
+ * Processors call the callback registered for the element or reference of
+ * each match, in preorder. The children of a match that has a callback are
+ * left to the callback, which can process them in turn. Matches without a
+ * callback are given to the fallback, or have their children processed
+ * when there is none.
+ *
+ * The traversal keeps the matches left to process on the processor's stack
+ * rather than on the C stack, so that deep trees can be processed.
 */
 
 typedef struct Processor Processor;
@@ -1062,10 +2277,20 @@ typedef struct Processor Processor;
 // @callback
 typedef void (*ProcessorCallback)(Processor* processor, Match* match);
 
+// @callback
+typedef void (*ProcessorNodeCallback)(Processor* processor, MatchTree* tree, int node);
+
 typedef struct Processor {
 	ProcessorCallback   fallback;
-	ProcessorCallback*  callbacks;
+	ProcessorCallback*  callbacks;      // The callbacks, indexed by element or reference id
 	int                 callbacksCount;
+	ProcessorNodeCallback  nodeFallback;
+	ProcessorNodeCallback* nodeCallbacks;  // The callbacks for match trees, see `Processor_processTree`
+	int                    nodeCallbacksCount;
+	Match**             stack;          // The matches left to process, see `Processor_process`
+	int                 stackCount;
+	int                 stackCapacity;
+	void*               context;        // The state of the callbacks, not owned by the processor
 } Processor;
 
 
@@ -1076,11 +2301,276 @@ Processor* Processor_new(void);
 void Processor_free(Processor* this);
 
 // @method
+// Registers the callback for the matches of the element or reference with
+// the given id, so that references (named ones in particular) can have a
+// callback of their own.
 void Processor_register (Processor* this, int symbolID, ProcessorCallback callback) ;
 
 // @method
 int Processor_process (Processor* this, Match* match, int step);
 
+// @method
+void Processor_registerNode (Processor* this, int symbolID, ProcessorNodeCallback callback);
+
+// @method
+// Processes the given node of the tree as `Processor_process` does for
+// matches, using the callbacks registered with `Processor_registerNode`.
+int Processor_processTree (Processor* this, MatchTree* tree, int node, int step);
+
+// @method
+// Parses the input and processes the matches, as `Processor_process` would
+// process the match of the axiom. When the axiom is a rule that ends with
+// a repeated reference, each match of that reference is processed as soon
+// as it is recognized, as a PEG parser can't backtrack past it, and is then
+// released along with everything the parse allocated for it. The axiom's
+// children before that reference are processed before its first match, and
+// the result then holds them only, so that an `Iterator_Stream` can discard
+// the processed input. The whole
+// match is processed once the parse is done otherwise, which is when the
+// matches could contain the axiom again, or when the processor has a
+// callback for the axiom or that reference (or a fallback). Matches are
+// only valid within their callback.
+ParsingResult* Processor_parseIterator (Processor* this, Grammar* grammar, Iterator* iterator);
+
+// @method
+ParsingResult* Processor_parseString (Processor* this, Grammar* grammar, const char* text);
+
+/**
+ * Listener
+ * --------
+ *
+ * Validation and extraction only need a few values out of the matches, and
+ * don't need to keep them. A listener is sent an *enter* and an *exit* event
+ * for each match (in preorder, the exit event following the events of the
+ * match's children), with the id of its element or reference, and its offset
+ * and length. The events of a match are sent once the parse can't backtrack
+ * past it anymore, followed by a *commit* event for that match, and the match
+ * is then released.
+ *
+ * The matches become final in the same way as with `Processor_parseIterator`:
+ * when the axiom is a rule that ends with a repeated reference (that can't
+ * contain the axiom again), each match of that reference is sent as soon as
+ * it is recognized, so that the memory used by the parse stays flat however
+ * long the input is. The events still nest as they would for the whole
+ * tree: the enter events of the axiom and of that reference (with the length
+ * recognized before the reference), and the events of the axiom's children
+ * before it, are sent before the first match of the reference, and the exit
+ * events of the reference and the axiom once the parse is done, followed by
+ * the axiom's commit event. When no match of the reference was sent, the
+ * matches are sent once the parse is done (and only when it succeeded,
+ * partially or not), as they are for the other grammars.
+ *
+ * ```c
+ * Listener* listener = Listener_new();
+ * listener->enter    = Value_enter;
+ * ParsingResult* r   = Listener_parseIterator(listener, g, Iterator_Stream(path, 4096));
+ * ```
+*/
+
+typedef struct Listener Listener;
+
+// @callback
+typedef void (*ListenerCallback)(Listener* listener, int element, size_t offset, size_t length);
+
+typedef struct Listener {
+	ListenerCallback    enter;          // Called before the events of the match's children, might be NULL
+	ListenerCallback    exit;           // Called after the events of the match's children, might be NULL
+	ListenerCallback    commit;         // Called once the events of a final match were sent, might be NULL
+	Iterator*           iterator;       // The iterator of the running parse, so that callbacks can read the input
+	void*               context;        // The state of the callbacks, not owned by the listener
+} Listener;
+
+// @constructor
+Listener* Listener_new(void);
+
+// @destructor
+void Listener_free(Listener* this);
+
+// @method
+// Sends the events of the given match and its descendants (but not of its
+// `next` matches), followed by its commit event. The match tree is walked
+// through the `parent` links, so deep trees don't use the C stack.
+void Listener_send (Listener* this, Match* match);
+
+// @method
+// Parses the input, sending the events of the matches as they become final.
+// The result's match only holds the matches that were not sent during the
+// parse, which are the axiom and its children when some were. When the
+// parse is aborted after that (see `Grammar_setBudget`), the exit events
+// are sent at the offset where it stopped, with no commit event. Push iterators (see `Iterator_Push`) should be ended before, as
+// resumed parses would send the events again.
+ParsingResult* Listener_parseIterator (Listener* this, Grammar* grammar, Iterator* iterator);
+
+// @method
+ParsingResult* Listener_parseString (Listener* this, Grammar* grammar, const char* text);
+
+/**
+ * Profiler
+ * --------
+ *
+ * The time of a parse goes to the recognitions of the grammar's elements,
+ * which native profilers only see as `Rule_recognize` or `Group_recognize`
+ * frames. A profiler keeps the stack of the elements being recognized, and
+ * samples it every `period` recognitions on average (the period is jittered
+ * so that samples don't follow the repetitions of the grammar). The samples
+ * are counted in a tree of the sampled stacks, so that a sample costs a walk
+ * of the stack, and recognitions between samples only push and pop their
+ * element.
+ *
+ * The samples are written as collapsed stacks, one line per stack with the
+ * names of its elements from the axiom, separated by `;`, followed by the
+ * number of samples, which is what flame graph tools take as input. Anonymous
+ * elements are named after their type and id, like `G#12`. Elements that are
+ * recognized a lot without consuming much, like the alternatives that groups
+ * backtrack from, then stand out.
+ *
+ * ```c
+ * Profiler* profiler = Profiler_new(0);
+ * ParsingResult* r   = Profiler_parseString(profiler, g, text);
+ * Output* output     = Output_ToFile(fd);
+ * Profiler_output(profiler, output);
+ * ```
+ *
+ * The samples add up over the parses of the profiler, which must only be
+ * used by one parse at a time.
+*/
+
+// @define
+// The default mean number of recognitions between two samples
+#define PROFILER_PERIOD 64
+
+// @type
+// A stack of elements that was sampled, in the tree of the sampled stacks
+typedef struct ProfileNode {
+	ParsingElement*  element;  // The innermost element of the stack, NULL for the root
+	int              parent;   // The index of the node of the enclosing stack, -1 for the root
+	int              child;    // The index of the first child node, -1 when there is none
+	int              sibling;  // The index of the next child of the parent, -1 for the last one
+	size_t           samples;  // The samples of this exact stack
+} ProfileNode;
+
+typedef struct Profiler {
+	size_t           period;        // The mean number of recognitions between two samples
+	size_t           countdown;     // The recognitions left before the next sample
+	uint64_t         seed;          // The state of the generator that jitters the period
+	size_t           samples;       // The number of samples taken
+	ParsingElement** stack;         // The elements being recognized, the outermost first
+	int              depth;
+	int              capacity;
+	ProfileNode*     nodes;         // The sampled stacks, the root (the empty stack) first
+	int              count;
+	int              nodesCapacity;
+} Profiler;
+
+// @constructor
+// Creates a profiler that samples every `period` recognitions on average,
+// `PROFILER_PERIOD` when `period` is 0. A `period` of 1 samples every
+// recognition.
+Profiler* Profiler_new(size_t period);
+
+// @destructor
+void Profiler_free(Profiler* this);
+
+// @method
+// Pushes the element on the stack, sampling the stack when it is time.
+void Profiler_enter(Profiler* this, ParsingElement* element);
+
+// @method
+// Pops the innermost element of the stack.
+void Profiler_exit(Profiler* this);
+
+// @method
+// Parses the input, sampling the recognitions of the parse.
+ParsingResult* Profiler_parseIterator (Profiler* this, Grammar* grammar, Iterator* iterator);
+
+// @method
+ParsingResult* Profiler_parseString (Profiler* this, Grammar* grammar, const char* text);
+
+// @method
+// Writes the samples as collapsed stacks, one line per sampled stack.
+void Profiler_output(Profiler* this, Output* output);
+
+/**
+ * Iterative engine
+ * ----------------
+ *
+ * Rules, groups and references recognize their children by calling them,
+ * so the default engine uses a few native frames for each level of nesting
+ * of the input, and the depth of what can be parsed depends on the stack
+ * of the thread. The iterative engine runs the same prepared grammar as
+ * a loop over an explicit stack of frames, allocated on the heap, with one
+ * frame for each rule, group and reference being recognized. It gives the
+ * same matches, stats, memoization and profiles as the recursive engine.
+ *
+ * ```c
+ * Grammar_setEngine(g, ENGINE_ITERATIVE, 100000);
+ * ParsingResult* r = Grammar_parseString(g, text);
+ * ```
+ *
+ * A parse that needs more frames than the maximum depth is aborted: every
+ * recognition fails from there, nothing more is memoized, and the result
+ * has the `STATUS_TOO_DEEP` status. The frames are kept by the context,
+ * so that the following parses (see `Grammar_setPool`) don't allocate them.
+ *
+ * The other elements are still recognized by calling them, as are the
+ * rules and groups whose `recognize` was replaced (see `Grammar_writeC`),
+ * and the skip element, which then nest on the native stack. The engine
+ * doesn't log its steps when the grammar is verbose.
+*/
+
+// @define
+// The engine that recognizes the children of each element by calling them
+#define ENGINE_RECURSIVE 'r'
+// @define
+// The engine that recognizes rules, groups and references as a loop
+#define ENGINE_ITERATIVE 'i'
+
+// @type
+// The recognition of a rule, group or reference by the iterative engine,
+// which holds the locals of `Rule_recognize`, `Group_recognize` or
+// `Reference_recognize` between the recognitions of the children.
+typedef struct EngineFrame {
+	Element*         element;   // The rule, group or reference being recognized
+	Reference*       child;     // The child being recognized
+	struct WordSet*  words;     // The next word set of a group
+	Match*           result;
+	Match*           last;      // The last child match of a rule, or the last repetition of a reference
+	ArenaMark        mark;      // The arena mark that a failure rewinds to
+	size_t           offset;    // The offset where the recognition started
+	size_t           end;       // The end of the last repetition of a reference
+	size_t           iteration; // The offset where the current child started
+	size_t           cuts;      // The cuts passed before the current child
+	size_t           memoCuts;  // The cuts passed before the recognition, when memoized
+	size_t           reach;     // The reach before the recognition, when memoized
+	double           start;     // When the recognition started, when timed
+	int              step;      // The index of the child of a group or rule, the repetitions of a reference
+	char             state;     // Where the recognition resumes, one of ENGINE_STATE_XXX
+	bool             wrapped;   // Whether it was entered as `ParsingElement_recognize` does
+	bool             memoized;  // Whether the result is to be memoized
+	bool             scoped;    // Whether a rule pushed a variable scope
+} EngineFrame;
+
+// @type
+typedef struct Engine {
+	EngineFrame*     frames;
+	size_t           depth;     // The number of frames in use
+	size_t           capacity;
+	size_t           maxDepth;  // The maximum number of frames, 0 for none
+	Match*           match;     // The match that the last frame returned
+} Engine;
+
+// @constructor
+Engine* Engine_new(void);
+
+// @destructor
+void Engine_free(Engine* this);
+
+// @method
+// Recognizes the element at the current offset of the context, as its
+// `recognize` would, running its rules, groups and references on the
+// engine's stack.
+Match* Engine_recognize(Engine* this, ParsingElement* element, ParsingContext* context);
+
 /**
  * Utilities
  * ---------
@@ -1179,6 +2669,11 @@ bool Utilites_checkIndent( ParsingElement* this, ParsingContext* context );
 // Creates a `Condition` parsing element
 #define CONDITION(f)      Condition_new(f)
 
+// @macro
+// Creates a `Cut` parsing element, wrapped in a `CARDINALITY_ONE` reference
+// so that it can be a child of a rule.
+#define CUT()             ONE(Cut_new())
+
 // @macro
 // Sets the grammar's axiom to the given symbol
 #define AXIOM(n) g->axiom = s_ ## n;
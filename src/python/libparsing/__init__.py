@@ -11,7 +11,7 @@
 
 from __future__ import print_function
 
-import sys, os, re, glob, inspect, tempfile, collections
+import sys, os, re, glob, inspect, collections, threading
 from   cffi    import FFI
 from   os.path import dirname, join, abspath
 
@@ -98,6 +98,7 @@ TYPE_GROUP                = b'G'
 TYPE_RULE                 = b'R'
 TYPE_CONDITION            = b'c'
 TYPE_PROCEDURE            = b'p'
+TYPE_CUT                  = b'!'
 TYPE_REFERENCE            = b'#'
 STATUS_INIT               = b'-'
 STATUS_PROCESSING         = b'~'
@@ -105,8 +106,22 @@ STATUS_MATCHED            = b'Y'
 STATUS_FAILED             = b'X'
 STATUS_INPUT_ENDED        = b'.'
 STATUS_ENDED              = b'E'
+STATUS_EXCEEDED           = b'x'
+STATUS_TOO_DEEP           = b'd'
 ID_BINDING                = -1
 ID_UNBOUND                = -10
+ELEMENT_NOMEMO            = 0x01
+ELEMENT_NOFAILMEMO        = 0x02
+ELEMENT_CONTEXTUAL        = 0x04
+MEMO_LIMIT_DEFAULT        = 64 * 1024 * 1024
+OPTIMIZE_INLINE           = 0x01
+OPTIMIZE_FLATTEN          = 0x02
+OPTIMIZE_WORDS            = 0x04
+OPTIMIZE_TOKENS           = 0x08
+OPTIMIZE_DEAD             = 0x10
+OPTIMIZE_ALL              = 0x1F
+ENGINE_RECURSIVE          = b'r'
+ENGINE_ITERATIVE          = b'i'
 
 if sys.version_info.major >= 3:
 	def ensure_bytes(v):
@@ -292,9 +307,12 @@ class ParsingElement(CObject):
 		return Reference(self).oneOrMore()
 
 	def disableMemoize( self ):
+		lib.ParsingElement_memoize(self._cobject, 0, 0)
 		return self
 
 	def disableFailMemoize( self ):
+		memoize_successes = 0 if self._cobject.flags & ELEMENT_NOMEMO else 1
+		lib.ParsingElement_memoize(self._cobject, memoize_successes, 0)
 		return self
 
 	def skip( self, value=True ):
@@ -388,6 +406,48 @@ class Rule(ParsingElement):
 		self._cobject = lib.Rule_new(ffi.NULL)
 		self.add(*children)
 
+# -----------------------------------------------------------------------------
+#
+# CALLBACK ERRORS
+#
+# -----------------------------------------------------------------------------
+
+class CallbackErrors(object):
+	"""The native parses are run without holding the GIL, which the
+	callbacks of the procedures and conditions take back when they are
+	called, possibly from another thread than the one that started the
+	parse. CFFI can't propagate their exceptions through the native code,
+	so the first exception of each parsing context is kept here, and
+	raised by the parse methods once the parse returns."""
+
+	ERRORS = {}
+
+	@classmethod
+	def Record( cls, context ):
+		cls.ERRORS.setdefault(int(ffi.cast("uintptr_t", context)), sys.exc_info()[1])
+
+	@classmethod
+	def Discard( cls, context ):
+		"""Drops the exceptions of the given context and of the contexts it
+		joins, as they are reused by the next parses, returning the first
+		one."""
+		error = None
+		while context != ffi.NULL:
+			recorded = cls.ERRORS.pop(int(ffi.cast("uintptr_t", context)), None)
+			error    = error or recorded
+			context  = context.next
+		return error
+
+	@classmethod
+	def Raise( cls, result ):
+		"""Raises the first exception of the callbacks called while parsing
+		the given result (or the contexts it joins), returning the result
+		otherwise."""
+		if not cls.ERRORS or not result: return result
+		error = cls.Discard(result._cobject.context)
+		if error: raise error
+		return result
+
 # -----------------------------------------------------------------------------
 #
 # CONDITION
@@ -400,7 +460,13 @@ class Condition(ParsingElement):
 	def WrapCallback(cls, callback):
 		# SEE: http://stackoverflow.com/questions/34392109/use-extern-python-style-cffi-callbacks-with-embedded-pypy
 		def c(e,ctx):
-			return callback(ParsingElement.Wrap(e), ParsingContext.Wrap(ctx)) if callback else 1
+			try:
+				return callback(ParsingElement.Wrap(e), ParsingContext.Wrap(ctx)) if callback else 1
+			except BaseException:
+				# The condition fails, and the error is raised once the
+				# parse returns.
+				CallbackErrors.Record(ctx)
+				return 0
 		t = "bool(*)(ParsingElement *, ParsingContext *)"
 		c = ffi.callback(t, c)
 		return c
@@ -420,7 +486,10 @@ class Procedure(ParsingElement):
 	@classmethod
 	def WrapCallback(cls, callback):
 		def c(e,ctx):
-			callback(ParsingElement.Wrap(e), ParsingContext.Wrap(ctx))
+			try:
+				callback(ParsingElement.Wrap(e), ParsingContext.Wrap(ctx))
+			except BaseException:
+				CallbackErrors.Record(ctx)
 		t = "void(*)(ParsingElement *, ParsingContext *)"
 		c = ffi.callback(t, c)
 		return c
@@ -429,6 +498,19 @@ class Procedure(ParsingElement):
 		self._callback = (self.WrapCallback(callback), callback)
 		return lib.Procedure_new(self._callback[0])
 
+# -----------------------------------------------------------------------------
+#
+# CUT
+#
+# -----------------------------------------------------------------------------
+
+class Cut(ParsingElement):
+	"""Commits the parse to what was recognized so far, a failure past
+	the cut failing the whole parse."""
+
+	def _new( self ):
+		return lib.Cut_new()
+
 # -----------------------------------------------------------------------------
 #
 # REFERENCE
@@ -549,9 +631,12 @@ class Match(CObject):
 	_RECYCLABLE = False
 
 	@classmethod
-	def Wrap( cls, cobject ):
+	def Wrap( cls, cobject, iterator=ffi.NULL ):
 		assert cobject.element != ffi.NULL, "Match C object does not have an element: %s %d+%d" % (cobject.status, cobject.offset, cobject.length)
-		return cls.Reuse(cobject) or Match(cobject, wrap=cls._TYPE)
+		res = cls.Reuse(cobject) or Match(cobject, wrap=cls._TYPE)
+		# The iterator of the parsed input, in which the line is looked up
+		res._iterator = iterator
+		return res
 
 	def _new( self, o ):
 		return ffi.cast(self._TYPE, o)
@@ -570,7 +655,7 @@ class Match(CObject):
 
 	@property
 	def line( self ):
-		return self._cobject.line
+		return lib.Match_getLine(self._cobject, self._iterator)
 
 	@property
 	def type( self ):
@@ -616,19 +701,19 @@ class Match(CObject):
 		return count
 
 	def _toHelper( self, callback ):
-		(fd, fn) = tempfile.mkstemp()
-		callback(self._cobject, fd)
-		os.close(fd)
-		with open(fn) as f:
-			text = f.read()
-		os.unlink(fn)
-		return text
+		# The document is written in memory, and copied once
+		output = lib.Output_new()
+		try:
+			callback(self._cobject, output)
+			return ensure_str(ffi.buffer(output.buffer, output.length)[:])
+		finally:
+			lib.Output_free(output)
 
 	def toJSON( self ):
-		return self._toHelper(lib.Match_writeJSON)
+		return self._toHelper(lib.Match_outputJSON)
 
 	def toXML( self ):
-		return self._toHelper(lib.Match_writeXML)
+		return self._toHelper(lib.Match_outputXML)
 
 	# =========================================================================
 	# SUGAR
@@ -637,7 +722,7 @@ class Match(CObject):
 	def __iter__( self ):
 		child = self._cobject.children
 		while child:
-			yield Match.Wrap(child)
+			yield Match.Wrap(child, self._iterator)
 			child = child.next
 
 	def __getitem__( self, index ):
@@ -650,7 +735,7 @@ class Match(CObject):
 			child = self._cobject.children
 			while child:
 				if i == index:
-					return Match.Wrap(child)
+					return Match.Wrap(child, self._iterator)
 				else:
 					child = child.next
 					i += 1
@@ -734,6 +819,174 @@ class MatchResult(object):
 			self.value
 		)
 
+# -----------------------------------------------------------------------------
+#
+# MATCH TREE
+#
+# -----------------------------------------------------------------------------
+
+class MatchTree(object):
+	"""A flat copy of the matches of a parsing result, exported from C in
+	one call (see `MatchTree_export`). The nodes are indexed in preorder,
+	and their elements, parents, offsets and lengths are plain lists, so
+	that walking the tree does not cross the CFFI boundary for each node.
+	The groups of node `i` are the `(offset, length)` pairs of `spans`,
+	from `groups[i]` to `groups[i+1]`."""
+
+	@classmethod
+	def FromResult( cls, result ):
+		tree = lib.MatchTree_new(result._cobject)
+		try:
+			return cls(tree, result._grammar)
+		finally:
+			lib.MatchTree_free(tree)
+
+	def __init__( self, tree, grammar ):
+		n        = tree.count
+		m        = tree.groupsCount
+		elements = ffi.new("int[]",    max(n, 1))
+		parents  = ffi.new("int[]",    max(n, 1))
+		offsets  = ffi.new("size_t[]", max(n, 1))
+		lengths  = ffi.new("size_t[]", max(n, 1))
+		groups   = ffi.new("int[]",    n + 1)
+		spans    = ffi.new("size_t[]", max(m * 2, 1))
+		lib.MatchTree_export(tree, elements, parents, offsets, lengths, groups, spans)
+		self.grammar    = grammar
+		self.status     = tree.status
+		self.count      = n
+		self.elements   = ffi.unpack(elements, n)
+		self.parents    = ffi.unpack(parents,  n)
+		self.offsets    = ffi.unpack(offsets,  n)
+		self.lengths    = ffi.unpack(lengths,  n)
+		self.groups     = ffi.unpack(groups,   n + 1)
+		self.spans      = ffi.unpack(spans,    m * 2)
+		# NOTE: The text is copied once, and the groups are sliced from it.
+		self.textOffset = tree.textOffset
+		self.text       = ffi.buffer(tree.text, tree.textLength)[:] if tree.text != ffi.NULL else None
+		self._symbols   = {}
+
+	def symbol( self, id ):
+		"""Returns the `(type, name, isMany, word)` of the element or
+		reference with the given id, as they are the same for all the
+		nodes of that element."""
+		symbol = self._symbols.get(id)
+		if symbol is None:
+			e    = self.grammar._cobject.elements[id]
+			t    = e.type
+			name = ensure_str(ffi.string(e.name)) if e.name != ffi.NULL else None
+			many = t == TYPE_REFERENCE and lib.Reference_IsMany(e)
+			word = ensure_unicode(ffi.string(lib.Word_word(ffi.cast("ParsingElement*", e)))) if t == TYPE_WORD else None
+			symbol = self._symbols[id] = (t, name, many, word)
+		return symbol
+
+	def group( self, node, index=0 ):
+		"""Returns the given group of the token match at the given node,
+		or None when the text is not available."""
+		i = (self.groups[node] + index) * 2
+		assert self.groups[node] + index < self.groups[node + 1]
+		if self.text is None:
+			return None
+		o = self.spans[i] - self.textOffset
+		return ensure_unicode(self.text[o:o + self.spans[i + 1]])
+
+	def children( self, node ):
+		"""Iterates on the indexes of the node's children. The descendants
+		of a node follow it, up to the first node with a lower parent."""
+		parents = self.parents
+		for i in range(node + 1, self.count):
+			p = parents[i]
+			if p == node:
+				yield i
+			elif p < node:
+				break
+
+	def __len__( self ):
+		return self.count
+
+	def __getitem__( self, index ):
+		return MatchTreeNode(self, index)
+
+class MatchTreeNode(object):
+	"""A node of a `MatchTree`, that offers the same accessors as a `Match`.
+	Processors with the *flat* strategy give these nodes to their
+	handlers."""
+
+	__slots__ = ("tree", "index")
+
+	def __init__( self, tree, index ):
+		self.tree  = tree
+		self.index = index
+
+	@property
+	def element( self ):
+		return self.tree.grammar._cobject.elements[self.id]
+
+	@property
+	def offset( self ):
+		return self.tree.offsets[self.index]
+
+	@property
+	def type( self ):
+		return self.tree.symbol(self.id)[0]
+
+	@property
+	def name( self ):
+		return self.tree.symbol(self.id)[1]
+
+	@property
+	def id( self ):
+		return self.tree.elements[self.index]
+
+	@property
+	def length( self ):
+		return self.tree.lengths[self.index]
+
+	@property
+	def range( self ):
+		o = self.offset
+		return o, o + self.length
+
+	def slots( self ):
+		return list(_ for _ in self if _.name)
+
+	def indexForKey( self, name ):
+		for i,_ in enumerate(self):
+			if _.name == name:
+				return i
+		return -1
+
+	def hasChildren( self ):
+		i = self.index + 1
+		return i < self.tree.count and self.tree.parents[i] == self.index
+
+	def countChildren( self ):
+		return sum(1 for _ in self.tree.children(self.index))
+
+	def __iter__( self ):
+		for i in self.tree.children(self.index):
+			yield MatchTreeNode(self.tree, i)
+
+	def __getitem__( self, index ):
+		if type(index) == int:
+			children = list(self.tree.children(self.index))
+			return MatchTreeNode(self.tree, children[index])
+		else:
+			i = self.indexForKey(index)
+			if i >= 0:
+				return self[i]
+			else:
+				raise KeyError
+
+	def __repr__(self):
+		return "<{0} {1}:{2}@{3} {4}-{5}>".format(
+			self.__class__.__name__.rsplit(".", 1)[-1],
+			ensure_str(self.type),
+			self.id,
+			ensure_str(self.name) or "_",
+			self.offset,
+			self.offset + self.length,
+		)
+
 # -----------------------------------------------------------------------------
 #
 # SYMBOLS
@@ -765,7 +1018,7 @@ class ParsingContext(CObject):
 
 	@property
 	def line( self ):
-		return self._cobject.iterator.lines
+		return lib.Iterator_getLine(self._cobject.iterator)
 
 	def push( self ):
 		lib.ParsingContext_push(self._cobject)
@@ -783,6 +1036,13 @@ class ParsingContext(CObject):
 	def get( self, key ):
 		return lib.ParsingContext_getInt(self._cobject, ensure_cstring(key))
 
+	def commit( self, offset=None ):
+		"""Tells the iterator that the input before `offset` (the current
+		offset by default) won't be revisited, and can be discarded."""
+		offset = self.offset if offset is None else offset
+		lib.Iterator_commit(self._cobject.iterator, offset)
+		return self
+
 	def __getitem__( self, offset ):
 		return lib.ParsingContext_charAt(self._cobject, offset)
 
@@ -820,7 +1080,7 @@ class ParsingResult(CObject):
 
 	@property
 	def match( self ):
-		return Match.Wrap(self._cobject.match)
+		return Match.Wrap(self._cobject.match, self._cobject.context.iterator)
 
 	@property
 	def lastMatch( self ):
@@ -849,7 +1109,7 @@ class ParsingResult(CObject):
 
 	@property
 	def line( self ):
-		return self._cobject.context.iterator.lines
+		return lib.Iterator_getLine(self._cobject.context.iterator)
 
 	@property
 	def offset( self ):
@@ -880,6 +1140,19 @@ class ParsingResult(CObject):
 	def isPartial( self ):
 		return True if lib.ParsingResult_isPartial(self._cobject)!= 0 else False
 
+	def isIncomplete( self ):
+		return True if lib.ParsingResult_isIncomplete(self._cobject)!= 0 else False
+
+	def isExceeded( self ):
+		"""Tells if the parse was aborted as it exceeded its memory budget
+		(see `Grammar.setBudget`)."""
+		return True if lib.ParsingResult_isExceeded(self._cobject)!= 0 else False
+
+	def isTooDeep( self ):
+		"""Tells if the parse was aborted as it nested deeper than the
+		maximum depth of the iterative engine (see `Grammar.setEngine`)."""
+		return True if lib.ParsingResult_isTooDeep(self._cobject)!= 0 else False
+
 	# =========================================================================
 	# HELPERS
 	# =========================================================================
@@ -969,6 +1242,10 @@ class ParsingResult(CObject):
 	def toXML( self ):
 		return self.match.toXML()
 
+	def toTree( self ):
+		"""Returns a `MatchTree` with a flat copy of the matches."""
+		return MatchTree.FromResult(self)
+
 	def __repr__( self ):
 		return "<{0}(status={2}, line={3}, char={4}, offset={5}, remaining={6}) at {1:02x}>".format(
 			self.__class__.__name__,
@@ -979,7 +1256,9 @@ class ParsingResult(CObject):
 	def __del__( self ):
 		super(self.__class__, self).__del__()
 		# The parsing result is the only one we really need to free
-		# along with the grammar
+		# along with the grammar. Its contexts are reset or pooled, so
+		# their exceptions are dropped.
+		if CallbackErrors.ERRORS: CallbackErrors.Discard(self._cobject.context)
 		lib.ParsingResult_free(self._cobject)
 
 # -----------------------------------------------------------------------------
@@ -1005,9 +1284,27 @@ class ParsingStats(CObject):
 	def symbolsCount( self ):
 		return self._cobject.symbolsCount
 
+	def memoHits( self ):
+		return self._cobject.memoHits
+
+	def memoMisses( self ):
+		return self._cobject.memoMisses
+
+	def bytesAllocated( self ):
+		"""Returns `(matches, input, variables, memo)`, the bytes held by
+		the parse when it ended."""
+		o = self._cobject
+		return (o.bytesMatches, o.bytesInput, o.bytesVariables, o.bytesMemo)
+
+	def attempts( self, symbolID ):
+		return lib.ParsingStats_attempts(self._cobject, symbolID)
+
 	def symbols( self ):
+		"""Returns `(id, successes, failures, bytes, time)` for each symbol. These
+		are only counted when the library is built with the `stats` feature."""
+		o = self._cobject
 		return [
-			(i, self._cobject.successBySymbol[i], self._cobject.failureBySymbol[i]) for i in range(self.symbolsCount())
+			(i, o.successBySymbol[i], o.failureBySymbol[i], o.bytesBySymbol[i], o.timeBySymbol[i]) for i in range(self.symbolsCount())
 		]
 
 	def report( self, grammar=None, output=sys.stdout ):
@@ -1027,12 +1324,15 @@ class ParsingStats(CObject):
 		write("Throughput :  {0}op/s".format((ts + tf) / pt))
 		write("Op time    : ~{0}/op".format(pt / (ts + tf)))
 		write("Op/byte    :  {0}".format((ts + tf) / br))
+		write("Memo hits  :  {0}".format(self.memoHits()))
+		write("Memo misses:  {0}".format(self.memoMisses()))
+		write("Memory     :  {0}b matches, {1}b input, {2}b variables, {3}b memo".format(*self.bytesAllocated()))
 		write("-" * 80)
-		write("   SYMBOL   NAME                               SUCCESSES       FAILURES")
-		s  = sorted(self.symbols(), lambda a,b:cmp(b[1] + b[2], a[1] + a[2]))
+		write("   SYMBOL   NAME                               SUCCESSES       FAILURES          BYTES       TIME")
+		s  = sorted(self.symbols(), key=lambda _:_[1] + _[2], reverse=True)
 		c  = 0
 		ct = 0
-		for sid, s, f in s:
+		for sid, s, f, b, t in s:
 			ct += 1
 			if s == 0 and f == 0: continue
 			e = grammar.symbol(sid) if grammar else None
@@ -1044,7 +1344,7 @@ class ParsingStats(CObject):
 						n += ":" + e.name()
 				else:
 					n = e.name()
-			write("{0:9d} {1:31s} {2:14d} {3:14d}".format(sid, n, s, f))
+			write("{0:9d} {1:31s} {2:14d} {3:14d} {4:14d} {5:9.6f}s".format(sid, n, s, f, b, t))
 			c += 1
 		write("-" * 80)
 		write("Activated  :  {0}/{1} ~{2}%".format(c, ct, int(100.0 * c / ct)))
@@ -1068,21 +1368,147 @@ class Grammar(CObject):
 		g.isVerbose = 1 if isVerbose else 0
 		self._prepared  = False
 		self._anonymous = []
+		self._lock      = threading.Lock()
 		return g
 
+	def setTimed( self, timed=True ):
+		"""Measures the time spent in each symbol, when the library is built
+		with the `stats` feature."""
+		lib.Grammar_setTimed(self._cobject, 1 if timed else 0)
+		return self
+
+	def setMemoize( self, limit=MEMO_LIMIT_DEFAULT ):
+		"""Enables packrat memoization of rules and groups, with a table
+		capped to `limit` bytes. A `limit` of `0` disables memoization."""
+		lib.Grammar_setMemoize(self._cobject, limit)
+		return self
+
+	def setBudget( self, budget ):
+		"""Caps the memory that each parse holds to `budget` bytes, the
+		parses exceeding it being aborted (see `ParsingResult.isExceeded`).
+		A `budget` of `0` removes the cap."""
+		lib.Grammar_setBudget(self._cobject, budget)
+		return self
+
+	def setEngine( self, engine=ENGINE_ITERATIVE, depth=0 ):
+		"""Selects the `ENGINE_*` that runs the parses. The iterative engine
+		doesn't recurse on the native stack, and aborts the parses nesting
+		deeper than `depth` frames (see `ParsingResult.isTooDeep`). A
+		`depth` of `0` removes the limit."""
+		lib.Grammar_setEngine(self._cobject, engine, depth)
+		return self
+
+	def setOptimize( self, passes=OPTIMIZE_ALL ):
+		"""Sets the `OPTIMIZE_*` passes run when the grammar is prepared,
+		which remove the anonymous rules and groups that only wrap other
+		elements. The matches keep the ids and names of the symbols."""
+		self._prepared = False
+		lib.Grammar_setOptimize(self._cobject, passes)
+		return self
+
+	def setPool( self, size ):
+		"""Keeps the contexts of up to `size` freed results, so that the
+		following parses reuse their allocations. A `size` of `0` disables
+		the pool."""
+		lib.Grammar_setPool(self._cobject, size)
+		return self
+
 	# =========================================================================
 	# PARSING
 	# =========================================================================
+	# NOTE: CFFI releases the GIL for the duration of the native calls, so
+	# that other threads can parse (or run Python code) at the same time.
+	# The exceptions of the callbacks are raised once the parse returns
+	# (see `CallbackErrors`).
 
 	def parsePath( self, path ):
 		self._prepare()
 		_path = ensure_cstring(ensure_unicode(path))
-		return ParsingResult.Wrap(lib.Grammar_parsePath(self._cobject, _path), path=(path, _path), grammar=self)
+		return CallbackErrors.Raise(ParsingResult.Wrap(lib.Grammar_parsePath(self._cobject, _path), path=(path, _path), grammar=self))
+
+	def parseStream( self, path, window ):
+		"""Parses the file at the given path keeping only `window` bytes
+		of input behind the current position."""
+		self._prepare()
+		_path = ensure_cstring(ensure_unicode(path))
+		return CallbackErrors.Raise(ParsingResult.Wrap(lib.Grammar_parseStream(self._cobject, _path, window), path=(path, _path), grammar=self))
+
+	def parseMapped( self, path ):
+		"""Parses the file at the given path by mapping it in memory."""
+		self._prepare()
+		_path = ensure_cstring(ensure_unicode(path))
+		return CallbackErrors.Raise(ParsingResult.Wrap(lib.Grammar_parseMapped(self._cobject, _path), path=(path, _path), grammar=self))
 
 	def parseString( self, text ):
+		"""Parses the given text, where byte strings are given as they are
+		to the parser, and unicode strings are encoded in UTF-8."""
+		self._prepare()
+		_text = ensure_bytes(text)
+		return CallbackErrors.Raise(ParsingResult.Wrap(lib.Grammar_parseString(self._cobject,_text), text=(text, _text), grammar=self))
+
+	def parseMany( self, texts, jobs=0 ):
+		"""Parses each of the given texts in `jobs` native threads (one per
+		processor by default), and returns the list of their results, in
+		the same order. The texts are given as with `parseString`, and
+		procedures and conditions must then be thread-safe."""
+		self._prepare()
+		texts   = [ensure_bytes(_) for _ in texts]
+		buffers = [ffi.from_buffer(_) for _ in texts]
+		inputs  = ffi.new("Iterator*[]", [lib.Iterator_FromSlice(_, 0, len(_)) for _ in buffers])
+		results = ffi.new("ParsingResult*[]", len(texts))
+		lib.Grammar_parseMany(self._cobject, inputs, results, len(texts), jobs)
+		res = []
+		for i, r in enumerate(results):
+			r.context.freeIterator = True
+			res.append(ParsingResult.Wrap(r, text=(texts[i], buffers[i]), grammar=self))
+		for _ in res: CallbackErrors.Raise(_)
+		return res
+
+	def reparse( self, result, offset, removed, inserted ):
+		"""Parses the text of the previous `result` where the `removed`
+		bytes at `offset` are replaced with the `inserted` text, reusing
+		the memoized recognitions that the edit does not change (see
+		`setMemoize`)."""
+		self._prepare()
+		_inserted = ensure_bytes(inserted or "")
+		return CallbackErrors.Raise(ParsingResult.Wrap(lib.Grammar_reparse(self._cobject, result._cobject, offset, removed, _inserted), grammar=self))
+
+	def parsePush( self, data=None ):
+		"""Parses the given data as the start of an input that is given
+		in chunks, the result being incomplete as long as more data could
+		change it (see `resume`)."""
+		self._prepare()
+		iterator = lib.Iterator_Push()
+		if data:
+			_data = ensure_bytes(data)
+			lib.Iterator_feed(iterator, _data, len(_data))
+		result = lib.Grammar_parseIterator(self._cobject, iterator)
+		result.context.freeIterator = True
+		return CallbackErrors.Raise(ParsingResult.Wrap(result, grammar=self))
+
+	def resume( self, result, data=None ):
+		"""Feeds the `data` to the input of the given `parsePush` result, or
+		ends it when `data` is `None`, and returns the result of parsing it
+		again. The given result should not be used anymore."""
+		iterator = result._cobject.context.iterator
+		if data is None:
+			lib.Iterator_end(iterator)
+		else:
+			_data = ensure_bytes(data)
+			lib.Iterator_feed(iterator, _data, len(_data))
+		return CallbackErrors.Raise(ParsingResult.Wrap(lib.Grammar_resume(self._cobject, result._cobject), grammar=self))
+
+	def parseParallel( self, text, boundary, jobs=0 ):
+		"""Parses the text in chunks that start just after a match of the
+		`boundary` element, using `jobs` threads (one per processor by
+		default). Procedures and conditions must then be thread-safe."""
 		self._prepare()
-		_text = ensure_cstring(ensure_unicode(text))
-		return ParsingResult.Wrap(lib.Grammar_parseString(self._cobject,_text), text=(text, _text), grammar=self)
+		if isinstance(boundary, Reference):
+			boundary = boundary._cobject.element
+		else:
+			boundary = boundary._cobject
+		_text = ensure_bytes(text)
+		return CallbackErrors.Raise(ParsingResult.Wrap(lib.Grammar_parseParallel(self._cobject, _text, boundary, jobs), text=(text, _text), grammar=self))
 
 	# =========================================================================
 	# AXIOM AND SKIPPING
@@ -1161,6 +1587,17 @@ class Grammar(CObject):
 		self._prepared = False
 		return self._registerAnonymous(Condition(callback))
 
+	def cut( self, name):
+		self._prepared = False
+		r = Cut()
+		r.name = name
+		self.symbols[name] = r
+		return r
+
+	def acut( self ):
+		self._prepared = False
+		return self._registerAnonymous(Cut())
+
 	def group( self, name, *children):
 		self._prepared = False
 		r = Group(*children)
@@ -1223,9 +1660,12 @@ class Grammar(CObject):
 		return res
 
 	def _prepare( self ):
-		"""Ensures the grammar is prepared."""
+		"""Ensures the grammar is prepared, once, as threads may parse
+		with it at the same time."""
 		if not self._prepared:
-			self.prepare()
+			with self._lock:
+				if not self._prepared:
+					self.prepare()
 
 	def prepare( self ):
 		lib.Grammar_prepare(self._cobject)
@@ -1247,6 +1687,7 @@ class Processor:
 
 	LAZY  = 0
 	EAGER = 1
+	FLAT  = 2
 
 	def __init__( self, grammar=None, strict=True ):
 		self.depth    = 0
@@ -1261,6 +1702,7 @@ class Processor:
 			TYPE_RULE       : "processRule",
 			TYPE_CONDITION  : "processCondition",
 			TYPE_PROCEDURE  : "processProcedure",
+			TYPE_CUT        : "processCut",
 		}.items())
 
 	def asEager( self ):
@@ -1271,6 +1713,12 @@ class Processor:
 		self.strategy = self.LAZY
 		return self
 
+	def asFlat( self ):
+		"""Processes the results as a `MatchTree`, which is exported from C
+		at once, calling the handlers as the eager strategy does."""
+		self.strategy = self.FLAT
+		return self
+
 	def ensureGrammar( self, grammar ):
 		return grammar or self.createGrammar()
 
@@ -1331,8 +1779,13 @@ class Processor:
 
 	def process( self, match ):
 		self.depth += 1
+		if self.strategy == self.FLAT and isinstance(match, ParsingResult):
+			match  = match.toTree()
 		match  = match.match if isinstance(match, ParsingResult) else match
-		result = self._processMatch(match) if isinstance(match, Match) else match
+		if isinstance(match, MatchTree):
+			result = self._processTree(match)
+		else:
+			result = self._processMatch(match) if isinstance(match, Match) else match
 		self.depth -= 1
 		return result.value if isinstance(result, MatchResult) else result
 
@@ -1358,6 +1811,8 @@ class Processor:
 			r = self._processCondition(match)
 		elif t == TYPE_PROCEDURE:
 			r = self._processProcedure(match)
+		elif t == TYPE_CUT:
+			r = self._processCut(match)
 		elif t == TYPE_GROUP:
 			r = self._processGroup(match)
 		elif t == TYPE_RULE:
@@ -1370,6 +1825,50 @@ class Processor:
 		r = h(MatchResult(r,match)) if h else r
 		return r.value if isinstance(r, MatchResult) else r
 
+	def _processTree( self, tree ):
+		"""Processes the nodes of the tree from the last one to the first, so
+		that the values of the children are known before their parent's.
+		Only the nodes that have a handler are wrapped, in a `MatchTreeNode`."""
+		elements = tree.elements
+		parents  = tree.parents
+		handlers = self.handlerByID
+		# The values of the children of each node, in reverse order
+		values   = [None] * tree.count
+		value    = None
+		for i in range(tree.count - 1, -1, -1):
+			e = elements[i]
+			t, name, many, word = tree.symbol(e)
+			c = values[i]
+			values[i] = None
+			if c: c.reverse()
+			if t == TYPE_WORD:
+				r = word
+			elif t == TYPE_TOKEN:
+				n = tree.groups[i + 1] - tree.groups[i]
+				r = list(tree.group(i, j) for j in range(n)) if n else None
+			elif t == TYPE_CONDITION or t == TYPE_PROCEDURE or t == TYPE_CUT:
+				r = True
+			elif t == TYPE_GROUP:
+				r = [c[0] if c else None]
+			elif t == TYPE_RULE:
+				r = c or []
+			elif t == TYPE_REFERENCE:
+				r = (c or []) if many else (c[0] if c else None)
+			else:
+				raise Exception("Unsupported match type: {0} in {1}".format(t, tree[i]))
+			h = handlers.get(e)
+			if h:
+				r = h(MatchResult(r, MatchTreeNode(tree, i)))
+				r = r.value if isinstance(r, MatchResult) else r
+			p = parents[i]
+			if p < 0:
+				value = r
+			elif values[p] is None:
+				values[p] = [r]
+			else:
+				values[p].append(r)
+		return value
+
 	def _processLazy( self, match ):
 		"""Processes a match element."""
 		t = match.type
@@ -1384,7 +1883,7 @@ class Processor:
 			# If there is a handler defined
 			ph = self._handler
 			self._handler = h
-			if t == TYPE_WORD or t == TYPE_TOKEN or t == TYPE_CONDITION or t == TYPE_PROCEDURE:
+			if t == TYPE_WORD or t == TYPE_TOKEN or t == TYPE_CONDITION or t == TYPE_PROCEDURE or t == TYPE_CUT:
 				res = h(match)
 			else:
 				res = h(match)
@@ -1399,7 +1898,10 @@ class Processor:
 		if n == 0:
 			return None
 		else:
-			return list(ensure_unicode(ffi.string(lib.TokenMatch_group(match._cobject, i))) for i in range(n))
+			# NOTE: We read the groups straight from the input spans, which
+			# avoids creating NUL-terminated copies on the C side.
+			m = match._cobject
+			return list(ensure_unicode(ffi.buffer(lib.TokenMatch_groupStart(m, i), lib.TokenMatch_groupLength(m, i))[:]) for i in range(n))
 
 	def _processCondition( self, match ):
 		return True
@@ -1407,6 +1909,9 @@ class Processor:
 	def _processProcedure( self, match ):
 		return True
 
+	def _processCut( self, match ):
+		return True
+
 	def _processGroup( self, match ):
 		# NOTE: We need to wrap this in a list so that proces(match[0]) work
 		# for groups.
@@ -1,16 +1,34 @@
+typedef struct LineIndex {
+ size_t* offsets;
+ size_t base;
+ size_t count;
+ size_t capacity;
+ size_t scanned;
+ size_t cursor;
+} LineIndex;
+
+
+
+
+
+
 typedef struct Iterator {
  char status;
  char* buffer;
  char* current;
  char separator;
  size_t offset;
- size_t lines;
+ struct LineIndex* lineIndex;
  size_t capacity;
  size_t available;
  
 _Bool 
                freeBuffer;
-
+ size_t window;
+ size_t committed;
+ 
+_Bool 
+               truncated;
  void* input;
  void (*freeInput) (void*);
  
@@ -28,6 +46,27 @@ typedef struct FileInput {
 
 
 
+
+typedef struct MappedInput {
+ void* data;
+ size_t length;
+ size_t size;
+ const char* path;
+} MappedInput;
+
+
+
+
+typedef struct PushInput {
+ size_t size;
+ size_t parsed;
+ 
+_Bool 
+             ended;
+} PushInput;
+
+
+
 extern char EOL;
 
 
@@ -37,6 +76,28 @@ Iterator* Iterator_Open(const char* path);
 
 
 Iterator* Iterator_FromString(const char* text);
+Iterator* Iterator_Stream(const char* path, size_t window);
+
+
+
+
+
+Iterator* Iterator_Map(const char* path);
+
+
+
+
+
+
+Iterator* Iterator_FromSlice(const char* text, size_t start, size_t end);
+
+
+
+
+
+
+
+Iterator* Iterator_Push(void);
 
 
 Iterator* Iterator_new(void);
@@ -74,8 +135,21 @@ _Bool
 
 
 
+
 _Bool 
-    Iterator_backtrack ( Iterator* this, size_t offset, size_t lines );
+    Iterator_backtrack ( Iterator* this, size_t offset );
+
+
+
+
+
+
+size_t Iterator_lineAt ( Iterator* this, size_t offset );
+
+
+
+size_t Iterator_getLine ( Iterator* this );
+
 
 
 
@@ -83,6 +157,30 @@ char Iterator_charAt ( Iterator* this, size_t offset );
 
 
 
+
+size_t Iterator_bufferOffset ( Iterator* this );
+
+
+
+
+
+void Iterator_commit ( Iterator* this, size_t offset );
+
+
+
+
+
+
+_Bool 
+    Iterator_feed ( Iterator* this, const char* data, size_t length );
+
+
+
+
+void Iterator_end ( Iterator* this );
+
+
+
 _Bool 
     String_move ( Iterator* this, int offset );
 FileInput* FileInput_new(const char* path );
@@ -93,6 +191,8 @@ void FileInput_free(void* this);
 
 
 
+
+
 size_t FileInput_preload( Iterator* this );
 
 
@@ -102,6 +202,20 @@ size_t FileInput_preload( Iterator* this );
 
 _Bool 
     FileInput_move ( Iterator* this, int n );
+
+
+
+
+MappedInput* MappedInput_new(const char* path );
+
+
+void MappedInput_free(void* this);
+
+
+PushInput* PushInput_new(size_t size);
+
+
+void PushInput_free(void* this);
 typedef struct ParsingVariable ParsingVariable;
 typedef struct ParsingContext ParsingContext;
 typedef struct ParsingElement ParsingElement;
@@ -118,6 +232,19 @@ typedef struct Element {
 } Element;
 
 
+
+
+
+
+
+typedef struct FirstSet {
+ unsigned char bytes[32];
+ 
+_Bool 
+                 nullable;
+} FirstSet;
+
+
 typedef struct Grammar {
  ParsingElement* axiom;
  ParsingElement* skip;
@@ -127,6 +254,20 @@ typedef struct Grammar {
  
 _Bool 
                  isVerbose;
+ 
+_Bool 
+                 isTimed;
+ size_t memoLimit;
+ struct FirstSet* first;
+ struct WordSet** wordSets;
+ int wordSetsCount;
+ struct ContextPool* pool;
+ int optimize;
+ struct Optimization* optimizations;
+ int derivedCount;
+ size_t budget;
+ char engine;
+ size_t maxDepth;
 } Grammar;
 
 
@@ -136,15 +277,64 @@ Grammar* Grammar_new(void);
 void Grammar_free(Grammar* this);
 
 
+
+
+
+
 void Grammar_prepare ( Grammar* this );
 
 
+
+
+
+
+uint64_t Grammar_fingerprint ( Grammar* this );
+
+
 void Grammar_setVerbose ( Grammar* this );
 
 
 void Grammar_setSilent ( Grammar* this );
 
 
+
+
+void Grammar_setTimed ( Grammar* this, 
+                                      _Bool 
+                                           timed );
+
+
+
+
+
+void Grammar_setMemoize ( Grammar* this, size_t limit );
+
+
+
+
+
+void Grammar_setBudget ( Grammar* this, size_t budget );
+
+
+
+
+
+
+void Grammar_setEngine ( Grammar* this, char engine, size_t depth );
+void Grammar_setPool ( Grammar* this, int size );
+typedef struct Optimization {
+ ParsingElement* element;
+ Reference* children;
+ struct Optimization* next;
+} Optimization;
+
+
+
+
+
+void Grammar_setOptimize ( Grammar* this, int passes );
+
+
 int Grammar_symbolsCount ( Grammar* this );
 
 
@@ -157,7 +347,145 @@ ParsingResult* Grammar_parsePath( Grammar* this, const char* path );
 ParsingResult* Grammar_parseString( Grammar* this, const char* text );
 
 
+
+
+
+ParsingResult* Grammar_parseStream( Grammar* this, const char* path, size_t window );
+
+
+
+
+ParsingResult* Grammar_parseMapped( Grammar* this, const char* path );
+ParsingResult* Grammar_reparse( Grammar* this, ParsingResult* previous, size_t offset, size_t removed, const char* inserted );
+ParsingResult* Grammar_resume( Grammar* this, ParsingResult* previous );
+typedef size_t (*ParsingSplitCallback)(const char* text, size_t length, size_t offset, void* data);
+
+
+
+
+
+ParsingResult* Grammar_parseParallel( Grammar* this, const char* text, ParsingElement* boundary, int jobs );
+
+
+
+
+ParsingResult* Grammar_parseParallelWith( Grammar* this, const char* text, ParsingSplitCallback split, void* data, int jobs );
+
+
+
+
+
+
+void Grammar_parseMany( Grammar* this, Iterator** inputs, ParsingResult** results, int count, int jobs );
+
+_Bool 
+    Grammar_writeC( Grammar* this, int fd, const char* prefix );
+
+
 void Grammar_freeElements(Grammar* this);
+typedef struct ArenaBlock {
+ char* data;
+ size_t size;
+ struct ArenaBlock* next;
+} ArenaBlock;
+
+
+typedef struct ArenaMark {
+ ArenaBlock* block;
+ size_t offset;
+} ArenaMark;
+
+
+typedef struct Arena {
+ ArenaBlock* first;
+ ArenaBlock* current;
+ size_t offset;
+ size_t allocated;
+} Arena;
+
+
+Arena* Arena_new(void);
+
+
+
+void Arena_free(Arena* this);
+
+
+
+void* Arena_alloc(Arena* this, size_t size);
+
+
+
+ArenaMark Arena_mark(Arena* this);
+
+
+
+
+void Arena_rewind(Arena* this, ArenaMark mark);
+
+
+
+void Arena_reset(Arena* this);
+typedef 
+       _Bool 
+            (*OutputSink)(const char* data, size_t length, void* context);
+
+
+typedef struct Output {
+ char* buffer;
+ size_t length;
+ size_t capacity;
+ size_t written;
+ int fd;
+ OutputSink sink;
+ void* context;
+ 
+_Bool 
+            failed;
+} Output;
+
+
+
+Output* Output_new(void);
+
+
+
+
+Output* Output_ToFile(int fd);
+
+
+
+Output* Output_ToSink(OutputSink sink, void* context);
+
+
+
+void Output_free(Output* this);
+
+
+void Output_write(Output* this, const char* data, size_t length);
+
+
+void Output_writeString(Output* this, const char* string);
+
+
+void Output_writef(Output* this, const char* format, ...);
+
+
+
+
+void Output_writeEscaped(Output* this, const char* data, size_t length);
+
+
+
+
+
+_Bool 
+    Output_flush(Output* this);
+
+
+
+
+const char* Output_text(Output* this);
 
 
 
@@ -175,6 +503,7 @@ int Element__walk( Element* this, ElementWalkingCallback callback, int step, voi
 typedef struct Match {
 
  char status;
+ char flags;
  size_t offset;
  size_t length;
  size_t line;
@@ -208,12 +537,20 @@ Match* Match_new(void);
 
 
 void* Match_free(Match* this);
+Match* Match_FromArena(Arena* arena);
 
 
 void* Match_fail(Match* this);
 
 
 
+
+
+
+Match* Match_copy(Match* this, Arena* arena, size_t* bytes);
+
+
+
 _Bool 
     Match_isSuccess(Match* this);
 
@@ -237,6 +574,14 @@ Match* Match_getChildren(Match* this);
 int Match_getOffset(Match* this);
 
 
+
+
+
+
+
+size_t Match_getLine(Match* this, Iterator* iterator);
+
+
 int Match_getLength(Match* this);
 
 
@@ -277,7 +622,11 @@ int Match_countChildren(Match* this);
 
 
 
-void Match__writeJSON(Match* match, int fd, int flags);
+void Match__writeJSON(Match* match, Output* output, int flags);
+
+
+
+void Match_outputJSON(Match* this, Output* output);
 
 
 void Match_writeJSON(Match* this, int fd);
@@ -287,7 +636,11 @@ void Match_printJSON(Match* this);
 
 
 
-void Match__writeXML(Match* match, int fd, int flags);
+void Match__writeXML(Match* match, Output* output, int flags);
+
+
+
+void Match_outputXML(Match* this, Output* output);
 
 
 void Match_writeXML(Match* this, int fd);
@@ -305,11 +658,9 @@ typedef struct ParsingElement {
  struct Match* (*recognize) (struct ParsingElement*, ParsingContext*);
  struct Match* (*process) (struct ParsingElement*, ParsingContext*, Match*);
  void (*freeMatch) (Match*);
+ int flags;
 } ParsingElement;
 
-
-
-
 _Bool 
             ParsingElement_Is(void* this);
 
@@ -338,6 +689,9 @@ ParsingElement* ParsingElement_clear(ParsingElement* this);
 
 
 
+
+
+
 size_t ParsingElement_skip(ParsingElement* this, ParsingContext* context);
 
 
@@ -349,17 +703,34 @@ Match* ParsingElement_process( ParsingElement* this, Match* match );
 
 
 
-ParsingElement* ParsingElement_name( ParsingElement* this, const char* name );
 
 
-const char* ParsingElement_getName( ParsingElement* this );
+Match* ParsingElement_recognize( ParsingElement* this, ParsingContext* context );
 
 
-int ParsingElement_walk( ParsingElement* this, ElementWalkingCallback callback, void* context);
 
 
-int ParsingElement__walk( ParsingElement* this, ElementWalkingCallback callback, int step, void* context);
-typedef struct WordConfig {
+
+ParsingElement* ParsingElement_memoize( ParsingElement* this, 
+                                                             _Bool 
+                                                                  successes, 
+                                                                             _Bool 
+                                                                                  failures );
+
+
+
+
+ParsingElement* ParsingElement_name( ParsingElement* this, const char* name );
+
+
+const char* ParsingElement_getName( ParsingElement* this );
+
+
+int ParsingElement_walk( ParsingElement* this, ElementWalkingCallback callback, void* context);
+
+
+int ParsingElement__walk( ParsingElement* this, ElementWalkingCallback callback, int step, void* context);
+typedef struct WordConfig {
  char* word;
  size_t length;
 } WordConfig;
@@ -381,6 +752,17 @@ const char* Word_word(ParsingElement* this);
 const char* WordMatch_group(Match* match);
 typedef struct TokenConfig {
  char* expr;
+ char* prefix;
+ size_t prefixLength;
+ 
+_Bool 
+            literal;
+ FirstSet first;
+ FirstSet* repeats;
+
+
+
+
 
  pcre* regexp;
  pcre_extra* extra;
@@ -388,9 +770,25 @@ typedef struct TokenConfig {
 } TokenConfig;
 
 
+
+
+typedef struct TokenMatchGroup {
+ size_t offset;
+ size_t length;
+} TokenMatchGroup;
+
+
+
+
+
 typedef struct TokenMatch {
  int count;
+ TokenMatchGroup* spans;
  const char** groups;
+ ParsingContext* context;
+ 
+_Bool 
+                 owned;
 } TokenMatch;
 
 
@@ -403,6 +801,7 @@ void Token_free(ParsingElement*);
 
 
 
+
 Match* Token_recognize(ParsingElement* this, ParsingContext* context);
 
 
@@ -413,10 +812,27 @@ const char* Token_expr(ParsingElement* this);
 void TokenMatch_free(Match* match);
 
 
+
+
 const char* TokenMatch_group(Match* match, int index);
 
 
+
+
+
+const char* TokenMatch_groupStart(Match* match, int index);
+
+
+
+int TokenMatch_groupLength(Match* match, int index);
+
+
 int TokenMatch_count(Match* match);
+
+
+
+
+TokenMatch* TokenMatch_copy(Match* match, Arena* arena);
 typedef struct Reference {
  char type;
  int id;
@@ -486,6 +902,41 @@ ParsingElement* Group_new(Reference* children[]);
 
 
 Match* Group_recognize(ParsingElement* this, ParsingContext* context);
+typedef struct WordSetNode {
+ unsigned char byte;
+ int word;
+ int child;
+ int sibling;
+} WordSetNode;
+
+
+typedef struct WordSet {
+ int start;
+ int count;
+ Reference** words;
+ int root[256];
+ WordSetNode* nodes;
+ int nodesCount;
+ int nodesCapacity;
+ size_t longest;
+ struct WordSet* next;
+} WordSet;
+
+
+WordSet* WordSet_new(int start);
+
+
+
+void WordSet_free(WordSet* this);
+
+
+
+void WordSet_add(WordSet* this, Reference* word);
+
+
+
+
+int WordSet_match(WordSet* this, const char* text, size_t length);
 ParsingElement* Rule_new(Reference* children[]);
 
 
@@ -509,16 +960,28 @@ ParsingElement* Condition_new(ConditionCallback c);
 
 
 Match* Condition_recognize(ParsingElement* this, ParsingContext* context);
+ParsingElement* Cut_new(void);
+
+
+Match* Cut_recognize(ParsingElement* this, ParsingContext* context);
 typedef struct ParsingStats {
  size_t bytesRead;
  double parseTime;
  size_t symbolsCount;
  size_t* successBySymbol;
  size_t* failureBySymbol;
+ size_t* bytesBySymbol;
+ double* timeBySymbol;
  size_t failureOffset;
  size_t matchOffset;
  size_t matchLength;
  Element* failureElement;
+ size_t memoHits;
+ size_t memoMisses;
+ size_t bytesMatches;
+ size_t bytesInput;
+ size_t bytesVariables;
+ size_t bytesMemo;
 } ParsingStats;
 
 
@@ -531,47 +994,144 @@ void ParsingStats_free(ParsingStats* this);
 void ParsingStats_setSymbolsCount(ParsingStats* this, size_t t);
 
 
+
+void ParsingStats_reset(ParsingStats* this);
+
+
 Match* ParsingStats_registerMatch(ParsingStats* this, Element* e, Match* m);
+
+
+
+
+size_t ParsingStats_attempts(ParsingStats* this, int id);
+
+
+
+
+double ParsingStats_now(void);
 typedef struct ParsingVariable {
  int depth;
- char* key;
+ int key;
  void* value;
- struct ParsingVariable* previous;
 } ParsingVariable;
 
 
-ParsingVariable* ParsingVariable_new(int depth, const char* key, void* value);
 
 
-void ParsingVariable_free(ParsingVariable* this);
 
 
-void ParsingVariable_freeAll(ParsingVariable* this);
+typedef struct ParsingVariables {
+ ParsingVariable* items;
+ int count;
+ int capacity;
+ char** keys;
+ int keysCount;
+ int keysCapacity;
+ int depth;
+} ParsingVariables;
+
+
 
 
 
-_Bool 
-    ParsingVariable_is(ParsingVariable* this, const char* key);
 
+ParsingVariables* ParsingVariables_new(void);
 
-ParsingVariable* ParsingVariable_set(ParsingVariable* this, const char* name, void* value);
 
+void ParsingVariables_free(ParsingVariables* this);
+
+
+
+int ParsingVariables_key(ParsingVariables* this, const char* name);
+
+
+
+const char* ParsingVariables_getName(ParsingVariables* this, int key);
+
+
+
+void ParsingVariables_push(ParsingVariables* this);
+
+
+
+void ParsingVariables_pop(ParsingVariables* this);
+
+
+
+void* ParsingVariables_get(ParsingVariables* this, int key);
+
+
+
+void ParsingVariables_set(ParsingVariables* this, int key, void* value);
+
+
+
+void ParsingVariables_clear(ParsingVariables* this);
+
+
+
+int ParsingVariables_count(ParsingVariables* this);
+typedef struct MemoEntry {
+ int id;
+ size_t offset;
+ size_t end;
+ size_t reach;
+ long shift;
+ int lines;
+ size_t bytes;
+ Match* match;
+} MemoEntry;
+
+
+typedef struct Memo {
+ MemoEntry* entries;
+ size_t capacity;
+ size_t count;
+ size_t bytes;
+ size_t limit;
+ size_t floor;
+ size_t evicted;
+} Memo;
+
+
+Memo* Memo_new(size_t limit);
+
+
+void Memo_free(Memo* this);
+
+
+
+void Memo_clear(Memo* this);
+
+
+
+
+void Memo_evict(Memo* this, size_t offset);
+
+
+
+MemoEntry* Memo_get(Memo* this, int id, size_t offset);
 
-void* ParsingVariable_get(ParsingVariable* this, const char* name);
 
 
-ParsingVariable* ParsingVariable_find(ParsingVariable* this, const char* key, 
-                                                                             _Bool 
-                                                                                  local);
 
 
-int ParsingVariable_getDepth(ParsingVariable* this);
+void Memo_set(Memo* this, int id, size_t offset, size_t end, size_t reach, Match* match);
 
 
-const char* ParsingVariable_getName(ParsingVariable* this);
 
 
-int ParsingVariable_count(ParsingVariable* this);
+
+
+void Memo_reuse(Memo* this, Memo* from, size_t offset, size_t removed, size_t inserted, int lines);
+typedef struct ContextPool {
+ struct ParsingContext* contexts;
+ int count;
+ int size;
+ void* lock;
+} ContextPool;
+
+
 typedef void (*ContextCallback)(ParsingContext* context, char op );
 
 
@@ -579,7 +1139,7 @@ typedef struct ParsingContext {
  struct Grammar* grammar;
  struct Iterator* iterator;
  struct ParsingStats* stats;
- struct ParsingVariable* variables;
+ struct ParsingVariables* variables;
  size_t lastMatchOffset;
  size_t lastMatchLength;
  int lastMatchElementID;
@@ -590,6 +1150,33 @@ typedef struct ParsingContext {
  
 _Bool 
                         freeIterator;
+ struct Memo* memo;
+ struct Arena* arena;
+ struct Arena* strings;
+ struct ParsingContext* next;
+ size_t reach;
+ struct Processor* processor;
+ struct Listener* listener;
+ struct Reference* commit;
+ struct Match* enclosing;
+ 
+_Bool 
+                        opened;
+ void* matchData;
+ size_t skipOffset;
+ size_t skipEnd;
+ size_t skipReach;
+ size_t cuts;
+ size_t cut;
+ size_t budget;
+ 
+_Bool 
+                        exceeded;
+ struct Profiler* profiler;
+ struct Engine* engine;
+ 
+_Bool 
+                        tooDeep;
 } ParsingContext;
 
 
@@ -610,6 +1197,39 @@ char ParsingContext_charAt ( ParsingContext* this, size_t offset );
 size_t ParsingContext_getOffset( ParsingContext* this );
 
 
+
+
+void ParsingContext_backtrack( ParsingContext* this, size_t offset );
+
+
+
+
+
+_Bool 
+    ParsingContext_rejects( ParsingContext* this, int id );
+
+
+
+
+
+
+void ParsingContext__enclose( ParsingContext* this, ParsingElement* rule, Match* result, size_t offset );
+
+
+
+
+
+
+
+size_t ParsingContext_account( ParsingContext* this );
+
+
+
+
+
+void ParsingContext_reset( ParsingContext* this, Iterator* iterator );
+
+
 void ParsingContext_free( ParsingContext* this );
 
 
@@ -626,6 +1246,18 @@ void ParsingContext_pop ( ParsingContext* this );
 void* ParsingContext_get(ParsingContext* this, const char* name);
 
 
+
+
+
+int ParsingContext_key(ParsingContext* this, const char* name);
+
+
+void* ParsingContext_getVariable(ParsingContext* this, int key);
+
+
+void ParsingContext_setVariable(ParsingContext* this, int key, void* value);
+
+
 int ParsingContext_getInt(ParsingContext* this, const char* name);
 
 
@@ -673,6 +1305,28 @@ _Bool
     ParsingResult_isPartial(ParsingResult* this);
 
 
+
+
+
+_Bool 
+    ParsingResult_isIncomplete(ParsingResult* this);
+
+
+
+
+
+
+_Bool 
+    ParsingResult_isExceeded(ParsingResult* this);
+
+
+
+
+
+_Bool 
+    ParsingResult_isTooDeep(ParsingResult* this);
+
+
 char* ParsingResult_text(ParsingResult* this);
 
 
@@ -680,158 +1334,356 @@ int ParsingResult_textOffset(ParsingResult* this);
 
 
 size_t ParsingResult_remaining(ParsingResult* this);
+typedef struct MatchNode {
+ int element;
+ int parent;
+ int children;
+ int next;
+ int groups;
+ int groupsCount;
+ size_t offset;
+ size_t length;
+} MatchNode;
 
 
+typedef struct MatchTree {
+ char status;
+ MatchNode* nodes;
+ int count;
+ TokenMatchGroup* groups;
+ int groupsCount;
+ Grammar* grammar;
+ const char* text;
+ size_t textOffset;
+ size_t textLength;
+ Iterator* iterator;
+ 
+_Bool 
+                 freeIterator;
+ MappedInput* mapped;
+} MatchTree;
 
 
+typedef int (*MatchTreeWalkingCallback)(MatchTree* tree, int node, int step, void* context);
 
 
-typedef struct Processor Processor;
 
 
-typedef void (*ProcessorCallback)(Processor* processor, Match* match);
 
-typedef struct Processor {
- ProcessorCallback fallback;
- ProcessorCallback* callbacks;
- int callbacksCount;
-} Processor;
+MatchTree* MatchTree_new(ParsingResult* result);
 
 
 
-Processor* Processor_new(void);
 
+MatchTree* MatchTree_FromResult(ParsingResult* result);
 
-void Processor_free(Processor* this);
 
+void MatchTree_free(MatchTree* this);
 
-void Processor_register (Processor* this, int symbolID, ProcessorCallback callback) ;
 
 
-int Processor_process (Processor* this, Match* match, int step);
+Element* MatchTree_element(MatchTree* this, int node);
 
 
 
 
 
+const char* MatchTree_groupStart(MatchTree* this, int node, int index);
 
 
-void Utilities_indent( ParsingElement* this, ParsingContext* context );
+int MatchTree_groupLength(MatchTree* this, int node, int index);
 
 
-void Utilities_dedent( ParsingElement* this, ParsingContext* context );
 
 
 
-_Bool 
-    Utilites_checkIndent( ParsingElement* this, ParsingContext* context );
-typedef struct gc_Reference {
- char guard;
- size_t size;
- int count;
- void* previous;
- void* next;
-} gc_Reference;
-void* gc_Reference_data( gc_Reference* ref );
+int MatchTree_walk(MatchTree* this, MatchTreeWalkingCallback callback, int step, void* context);
+void MatchTree_export(MatchTree* this, int* elements, int* parents, size_t* offsets, size_t* lengths, int* groups, size_t* spans);
 
-void gc_Reference_acquire( gc_Reference* ref );
 
-gc_Reference* gc_Reference_release( gc_Reference* ref );
 
-void gc_Reference_free( gc_Reference* ref );
-gc_Reference* gc_ref( void* ptr );
+void MatchTree__writeJSON(MatchTree* this, int node, Output* output);
 
 
 
+void MatchTree_outputJSON(MatchTree* this, Output* output);
 
 
+void MatchTree_writeJSON(MatchTree* this, int fd);
 
-void* gc_new( size_t size );
 
 
+void MatchTree__writeXML(MatchTree* this, int node, Output* output);
 
 
 
-void gc_free( void* ptr );
+void MatchTree_outputXML(MatchTree* this, Output* output);
 
 
+void MatchTree_writeXML(MatchTree* this, int fd);
 
-void* gc_realloc( void* ptr, size_t size );
+_Bool 
+    MatchTree_writeBinary(MatchTree* this, Output* output, int flags);
 
-char* gc_strdup(const char* s);
 
-void* gc_calloc(size_t count, size_t size);
 
-void gc_acquire( void* ptr );
 
-void gc_release( void* ptr );
-char EOL = '\n';
 
-Match FAILURE_S = {
- .status = 'F',
- .length = 0,
- .data = NULL,
- .next = NULL
-};
 
-Match* FAILURE = &FAILURE_S;
+MatchTree* MatchTree_FromBinary(Grammar* grammar, const char* data, size_t length);
 
 
 
 
 
 
+MatchTree* MatchTree_readBinary(Grammar* grammar, const char* path);
+typedef struct Processor Processor;
 
-const char* EMPTY = "";
-const char* INDENT = "                                                                                ";
-char* String_escape(const char* string) {
- const char* p = string;
- int n = 0;
- int l = 0;
- while (*p != '\0') {
-  switch(*p) {
-   case '\n':
-   case '\t':
-   case '\r':
-   case '"':
-    n++;
-   default:
-    l++;
-  }
-  p++;
- }
- char* res = malloc(l + n + 1);
- p = string;
- n = 0;
- l = 0;
- while (*p != '\0') {
-  char c = *p;
-  switch(c) {
-   case '\n':
-    res[l + n++] = '\\';
-    res[l++ + n] = 'n';
-    break;
-   case '\t':
-    res[l + n++] = '\\';
-    res[l++ + n] = 't';
-    break;
-   case '\r':
-    res[l + n++] = '\\';
-    res[l++ + n] = 'r';
-    break;
-   case '"':
-    res[l + n++] = '\\';
-    res[l++ + n] = '"';
-    break;
-   default:
-    res[l + n] = c;
-    l++;
-  }
-  p++;
- }
- res[l + n] = '\0';
- return res;
-}
+
+typedef void (*ProcessorCallback)(Processor* processor, Match* match);
+
+
+typedef void (*ProcessorNodeCallback)(Processor* processor, MatchTree* tree, int node);
+
+typedef struct Processor {
+ ProcessorCallback fallback;
+ ProcessorCallback* callbacks;
+ int callbacksCount;
+ ProcessorNodeCallback nodeFallback;
+ ProcessorNodeCallback* nodeCallbacks;
+ int nodeCallbacksCount;
+ Match** stack;
+ int stackCount;
+ int stackCapacity;
+ void* context;
+} Processor;
+
+
+
+Processor* Processor_new(void);
+
+
+void Processor_free(Processor* this);
+
+
+
+
+
+void Processor_register (Processor* this, int symbolID, ProcessorCallback callback) ;
+
+
+int Processor_process (Processor* this, Match* match, int step);
+
+
+void Processor_registerNode (Processor* this, int symbolID, ProcessorNodeCallback callback);
+
+
+
+
+int Processor_processTree (Processor* this, MatchTree* tree, int node, int step);
+ParsingResult* Processor_parseIterator (Processor* this, Grammar* grammar, Iterator* iterator);
+
+
+ParsingResult* Processor_parseString (Processor* this, Grammar* grammar, const char* text);
+typedef struct Listener Listener;
+
+
+typedef void (*ListenerCallback)(Listener* listener, int element, size_t offset, size_t length);
+
+typedef struct Listener {
+ ListenerCallback enter;
+ ListenerCallback exit;
+ ListenerCallback commit;
+ Iterator* iterator;
+ void* context;
+} Listener;
+
+
+Listener* Listener_new(void);
+
+
+void Listener_free(Listener* this);
+
+
+
+
+
+void Listener_send (Listener* this, Match* match);
+ParsingResult* Listener_parseIterator (Listener* this, Grammar* grammar, Iterator* iterator);
+
+
+ParsingResult* Listener_parseString (Listener* this, Grammar* grammar, const char* text);
+typedef struct ProfileNode {
+ ParsingElement* element;
+ int parent;
+ int child;
+ int sibling;
+ size_t samples;
+} ProfileNode;
+
+typedef struct Profiler {
+ size_t period;
+ size_t countdown;
+ uint64_t seed;
+ size_t samples;
+ ParsingElement** stack;
+ int depth;
+ int capacity;
+ ProfileNode* nodes;
+ int count;
+ int nodesCapacity;
+} Profiler;
+
+
+
+
+
+Profiler* Profiler_new(size_t period);
+
+
+void Profiler_free(Profiler* this);
+
+
+
+void Profiler_enter(Profiler* this, ParsingElement* element);
+
+
+
+void Profiler_exit(Profiler* this);
+
+
+
+ParsingResult* Profiler_parseIterator (Profiler* this, Grammar* grammar, Iterator* iterator);
+
+
+ParsingResult* Profiler_parseString (Profiler* this, Grammar* grammar, const char* text);
+
+
+
+void Profiler_output(Profiler* this, Output* output);
+typedef struct EngineFrame {
+ Element* element;
+ Reference* child;
+ struct WordSet* words;
+ Match* result;
+ Match* last;
+ ArenaMark mark;
+ size_t offset;
+ size_t end;
+ size_t iteration;
+ size_t cuts;
+ size_t memoCuts;
+ size_t reach;
+ double start;
+ int step;
+ char state;
+ 
+_Bool 
+                 wrapped;
+ 
+_Bool 
+                 memoized;
+ 
+_Bool 
+                 scoped;
+} EngineFrame;
+
+
+typedef struct Engine {
+ EngineFrame* frames;
+ size_t depth;
+ size_t capacity;
+ size_t maxDepth;
+ Match* match;
+} Engine;
+
+
+Engine* Engine_new(void);
+
+
+void Engine_free(Engine* this);
+
+
+
+
+
+Match* Engine_recognize(Engine* this, ParsingElement* element, ParsingContext* context);
+
+
+
+
+
+
+
+void Utilities_indent( ParsingElement* this, ParsingContext* context );
+
+
+void Utilities_dedent( ParsingElement* this, ParsingContext* context );
+
+
+
+_Bool 
+    Utilites_checkIndent( ParsingElement* this, ParsingContext* context );
+typedef struct gc_Reference {
+ char guard;
+ size_t size;
+ int count;
+ void* previous;
+ void* next;
+} gc_Reference;
+void* gc_Reference_data( gc_Reference* ref );
+
+void gc_Reference_acquire( gc_Reference* ref );
+
+gc_Reference* gc_Reference_release( gc_Reference* ref );
+
+void gc_Reference_free( gc_Reference* ref );
+gc_Reference* gc_ref( void* ptr );
+
+
+
+
+
+
+void* gc_new( size_t size );
+
+
+
+
+
+void gc_free( void* ptr );
+
+
+
+void* gc_realloc( void* ptr, size_t size );
+
+char* gc_strdup(const char* s);
+
+void* gc_calloc(size_t count, size_t size);
+
+void gc_acquire( void* ptr );
+
+void gc_release( void* ptr );
+char EOL = '\n';
+
+Match FAILURE_S = {
+ .status = 'F',
+ .length = 0,
+ .data = NULL,
+ .next = NULL
+};
+
+Match* FAILURE = &FAILURE_S;
+
+
+
+
+
+
+
+const char* EMPTY = "";
+const char* INDENT = "                                                                                ";
 Iterator* Iterator_Open(const char* path) {
  Iterator* result = Iterator_new();
  result->freeBuffer = 1;
@@ -855,6 +1707,62 @@ Iterator* Iterator_FromString(const char* text) {
  return this;
 }
 
+Iterator* Iterator_Stream(const char* path, size_t window) {
+ Iterator* result = Iterator_Open(path);
+ if (result != NULL) {
+
+
+  result->window = window;
+ }
+ return result;
+}
+
+Iterator* Iterator_Map(const char* path) {
+ MappedInput* input = MappedInput_new(path);
+ if (input == NULL) {return NULL;}
+ Iterator* this = Iterator_new();
+
+
+ this->input = (void*)input;
+ this->freeInput = MappedInput_free;
+ this->buffer = (char*)input->data;
+ this->current = (char*)input->data;
+ this->capacity = input->length;
+ this->available = input->length;
+ this->move = String_move;
+ return this;
+}
+
+Iterator* Iterator_FromSlice(const char* text, size_t start, size_t end) {
+ Iterator* this = Iterator_new();
+ if (this!=NULL) {
+
+
+  this->buffer = (char*)text;
+  this->current = (char*)text;
+  this->capacity = end;
+  this->available = end;
+  this->move = String_move;
+  this->move(this, start);
+ }
+ return this;
+}
+
+Iterator* Iterator_Push(void) {
+ PushInput* input = PushInput_new(1);
+ Iterator* this = Iterator_new();
+
+
+ char* buffer = (char*) gc_calloc(input->size, sizeof(char)) ; assert (buffer!=NULL); ;
+ this->input = (void*)input;
+ this->freeInput = PushInput_free;
+ this->buffer = buffer;
+ this->current = buffer;
+ this->freeBuffer = 1;
+ this->move = String_move;
+ return this;
+}
+
 Iterator* Iterator_new( void ) {
  Iterator* this = (Iterator*) gc_new(sizeof(Iterator)); assert (this!=NULL); ;
  this->status = '-';
@@ -862,13 +1770,16 @@ Iterator* Iterator_new( void ) {
  this->buffer = NULL;
  this->current = NULL;
  this->offset = 0;
- this->lines = 0;
+ this->lineIndex = NULL;
  this->available = 0;
  this->capacity = 0;
  this->input = NULL;
  this->freeInput = NULL;
  this->move = NULL;
  this->freeBuffer = 0;
+ this->window = 0;
+ this->committed = 0;
+ this->truncated = 0;
  return this;
 }
 
@@ -888,6 +1799,10 @@ void Iterator_free( Iterator* this ) {
  if (this->freeBuffer) {
   if (this->buffer!=NULL) {; gc_free(this->buffer); } ;
  }
+ if (this->lineIndex != NULL) {
+  if (this->lineIndex->offsets!=NULL) {; gc_free(this->lineIndex->offsets); } ;
+  if (this->lineIndex!=NULL) {; gc_free(this->lineIndex); } ;
+ }
  if (this!=NULL) {; gc_free(this); } ;
 }
 
@@ -952,17 +1867,99 @@ _Bool
 
 
 _Bool 
-    Iterator_backtrack ( Iterator* this, size_t offset, size_t lines ) {
+    Iterator_backtrack ( Iterator* this, size_t offset ) {
  assert(offset <= this->offset);
- assert(lines <= this->lines);
- this->lines = lines;
  return this->move(this, offset - this->offset );
 }
 
+void Iterator__indexLines ( Iterator* this, size_t offset ) {
+ if (this->lineIndex == NULL) {
+  LineIndex* index = (LineIndex*) gc_new(sizeof(LineIndex)); assert (index!=NULL); ;
+  size_t* offsets = (size_t*) gc_calloc(1024, sizeof(size_t)) ; assert (offsets!=NULL); ;
+  index->offsets = offsets;
+  index->base = 0;
+  index->count = 0;
+  index->capacity = 1024;
+  index->scanned = 0;
+  index->cursor = 0;
+  this->lineIndex = index;
+ }
+ LineIndex* index = this->lineIndex;
+ if (offset <= index->scanned) {return;}
+
+
+ size_t start = Iterator_bufferOffset(this);
+ assert(index->scanned >= start);
+ const char* p = this->buffer + (index->scanned - start);
+ const char* end = this->buffer + this->available;
+ while (p < end && (p = (const char*)memchr(p, this->separator, end - p)) != NULL) {
+  if (index->count == index->capacity) {
+   index->capacity *= 2;
+   index->offsets=gc_realloc(index->offsets,sizeof(size_t) * index->capacity); ;
+  }
+  index->offsets[index->count++] = start + (p - this->buffer);
+  p++;
+ }
+ index->scanned = start + this->available;
+}
+
+
+size_t LineIndex__find ( LineIndex* this, size_t offset ) {
+ size_t lo = 0;
+ size_t hi = this->count;
+ while (lo < hi) {
+  size_t mid = lo + (hi - lo) / 2;
+  if (this->offsets[mid] < offset) {lo = mid + 1;} else {hi = mid;}
+ }
+ return lo;
+}
+
+
+
+void Iterator__trimLines ( Iterator* this, size_t offset ) {
+ Iterator__indexLines(this, offset);
+ LineIndex* index = this->lineIndex;
+ size_t n = LineIndex__find(index, offset);
+ if (n == 0) {return;}
+ memmove(index->offsets, index->offsets + n, sizeof(size_t) * (index->count - n));
+ index->base += n;
+ index->count -= n;
+ index->cursor = index->cursor > n ? index->cursor - n : 0;
+}
+
+size_t Iterator_lineAt ( Iterator* this, size_t offset ) {
+ Iterator__indexLines(this, offset);
+ LineIndex* index = this->lineIndex;
+ size_t* o = index->offsets;
+ size_t c = index->cursor;
+
+
+
+ if (!((c == 0 || o[c - 1] < offset) && (c == index->count || o[c] >= offset))) {
+  c = LineIndex__find(index, offset);
+  index->cursor = c;
+ }
+ return index->base + c;
+}
+
+size_t Iterator_getLine ( Iterator* this ) {
+ return Iterator_lineAt(this, this->offset);
+}
+
 char Iterator_charAt ( Iterator* this, size_t offset ) {
- assert(this->offset == (this->current - this->buffer));
- assert(offset <= this->available);
- return (char)(this->buffer[offset]);
+ size_t start = Iterator_bufferOffset(this);
+ assert(offset >= start);
+ assert(offset - start <= this->available);
+ return (char)(this->buffer[offset - start]);
+}
+
+size_t Iterator_bufferOffset ( Iterator* this ) {
+ return this->offset - (this->current - this->buffer);
+}
+
+void Iterator_commit ( Iterator* this, size_t offset ) {
+ offset = (offset < this->offset ? offset : this->offset);
+ if (offset > this->committed) {this->committed = offset;}
 }
 
 _Bool 
@@ -982,12 +1979,9 @@ _Bool
 
   size_t c = n <= left ? n : left;
 
-  while (c > 0) {
-   this->current++;
-   this->offset++;
-   if (*(this->current) == this->separator) {this->lines++;}
-   c--;
-  }
+
+  this->current += c;
+  this->offset += c;
 
   left = this->available - this->offset;
 
@@ -1053,7 +2047,7 @@ size_t FileInput_preload( Iterator* this ) {
  size_t left = this->available - read;
  size_t until_eob = this->capacity - read;
  ;;
- assert (left < this->capacity);
+ assert (left <= this->capacity);
 
 
 
@@ -1062,25 +2056,46 @@ size_t FileInput_preload( Iterator* this ) {
 
 
 
-  size_t delta = this->current - this->buffer;
+  if (this->window > 0) {
+   size_t start = this->offset - read;
+   size_t keep = this->offset > this->window ? this->offset - this->window : 0;
+   size_t committed = (this->committed < this->offset ? this->committed : this->offset);
+   if (committed > keep) {keep = committed;}
+   if (keep > start) {
+    size_t discard = keep - start;
+
+    Iterator__trimLines(this, keep);
+    ;
+    memmove((void*)this->buffer, (void*)(this->buffer + discard), this->available - discard);
+    this->available -= discard;
+    this->current -= discard;
+    read -= discard;
+    until_eob = this->capacity - read;
+   }
+  }
+  if (until_eob < 64000) {
+   size_t delta = this->current - this->buffer;
 
-  this->capacity += 64000;
+   this->capacity += 64000;
 
-  assert(this->capacity + 1 > 0);
-  ;
+   assert(this->capacity + 1 > 0);
+   ;
 
 
-  this->buffer=gc_realloc(this->buffer,this->capacity + 1); ;
-  assert(this->buffer != NULL);
+   this->buffer=gc_realloc(this->buffer,this->capacity + 1); ;
+   assert(this->buffer != NULL);
 
-  this->current = this->buffer + delta;
+   this->current = this->buffer + delta;
 
-  this->buffer[this->capacity] = '\0';
+   this->buffer[this->capacity] = '\0';
+  }
 
-  size_t to_read = this->capacity - left;
+  size_t to_read = this->capacity - this->available;
   size_t read = fread((char*)this->buffer + this->available, sizeof(char), to_read, input->file);
   this->available += read;
   left += read;
+
+  this->buffer[this->available] = '\0';
   ;;
   assert(Iterator_remaining(this) == left);
   assert(Iterator_remaining(this) >= read);
@@ -1105,13 +2120,8 @@ _Bool
   if (left > 0) {
    int c = n > left ? left : n;
 
-
-   while (c > 0) {
-    this->current++;
-    this->offset++;
-    if (*(this->current) == this->separator) {this->lines++;}
-    c--;
-   }
+   this->current += c;
+   this->offset += c;
    ;;
    if (n>left) {
     this->status = '.';
@@ -1128,9 +2138,14 @@ _Bool
  } else {
 
 
- 
-
-  n = ((int)this->capacity )+ n < 0 ? 0 - (int)this->capacity : n;
+  size_t behind = this->current - this->buffer;
+  if ((size_t)(0 - n) > behind) {
+   if (!this->truncated) {
+    fprintf(stderr, "ERR ");fprintf(stderr, "FileInput_move: cannot backtrack to %zu, input before %zu was discarded", this->offset + n, this->offset - behind);fprintf(stderr, "\n");;
+   }
+   this->truncated = 1;
+   n = 0 - (int)behind;
+  }
   this->current = (((char*)this->current) + n);
   this->offset += n;
   if (n!=0) {this->status = '~';}
@@ -1146,15 +2161,131 @@ _Bool
 
 
 
-Grammar* Grammar_new(void) {
- Grammar* this = (Grammar*) gc_new(sizeof(Grammar)); assert (this!=NULL); ;
- this->axiom = NULL;
- this->skip = NULL;
- this->axiomCount = 0;
- this->skipCount = 0;
- this->elements = NULL;
- this->isVerbose = 0;
- return this;
+MappedInput* MappedInput_new(const char* path ) {
+ MappedInput* this = (MappedInput*) gc_new(sizeof(MappedInput)); assert (this!=NULL); ;
+ assert(this != NULL);
+ this->path = path;
+ this->data = NULL;
+ this->length = 0;
+ this->size = 0;
+ int fd = open(path, O_RDONLY);
+ struct stat info;
+ if (fd < 0 || fstat(fd, &info) != 0) {
+  fprintf(stderr, "ERR ");fprintf(stderr, "Cannot open file: %s", path);fprintf(stderr, "\n");;
+  if (fd >= 0) {close(fd);}
+  if (this!=NULL) {; gc_free(this); } ;
+  return NULL;
+ }
+
+
+
+ size_t page = (size_t)sysconf(_SC_PAGESIZE);
+ this->length = (size_t)info.st_size;
+ this->size = (this->length / page + 1) * page;
+ void* data = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+ if (data != MAP_FAILED && this->length > 0) {
+  if (mmap(data, this->length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+   munmap(data, this->size);
+   data = MAP_FAILED;
+  } else {
+   madvise(data, this->length, MADV_SEQUENTIAL);
+  }
+ }
+ close(fd);
+ if (data == MAP_FAILED) {
+  fprintf(stderr, "ERR ");fprintf(stderr, "Cannot map file: %s", path);fprintf(stderr, "\n");;
+  if (this!=NULL) {; gc_free(this); } ;
+  return NULL;
+ }
+ this->data = data;
+ return this;
+}
+
+void MappedInput_free(void* this) {
+ ;
+ MappedInput* self = (MappedInput*) this;
+ if (self != NULL && self->data != NULL) { munmap(self->data, self->size); }
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+
+
+
+
+
+
+PushInput* PushInput_new(size_t size) {
+ PushInput* this = (PushInput*) gc_new(sizeof(PushInput)); assert (this!=NULL); ;
+ assert(this != NULL);
+ this->size = size;
+ this->parsed = 0;
+ this->ended = 0;
+ return this;
+}
+
+void PushInput_free(void* this) {
+ ;
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+
+
+PushInput* Iterator__pushInput( Iterator* this ) {
+ return this != NULL && this->freeInput == PushInput_free ? (PushInput*)this->input : NULL;
+}
+
+
+_Bool 
+    Iterator_feed ( Iterator* this, const char* data, size_t length ) {
+ PushInput* input = Iterator__pushInput(this);
+ if (input == NULL || input->ended) {return 0;}
+ if (this->available + length + 1 > input->size) {
+  size_t delta = this->current - this->buffer;
+  input->size = (input->size * 2 > this->available + length + 1 ? input->size * 2 : this->available + length + 1);
+  this->buffer=gc_realloc(this->buffer,input->size); ;
+  this->current = this->buffer + delta;
+ }
+ memcpy(this->buffer + this->available, data, length);
+ this->available += length;
+ this->buffer[this->available] = '\0';
+
+ this->capacity = this->available;
+ if (length > 0 && this->status == 'E') {this->status = '~';}
+ return 1;
+}
+
+void Iterator_end ( Iterator* this ) {
+ PushInput* input = Iterator__pushInput(this);
+ if (input != NULL) {input->ended = 1;}
+}
+
+
+
+
+
+
+
+Grammar* Grammar_new(void) {
+ Grammar* this = (Grammar*) gc_new(sizeof(Grammar)); assert (this!=NULL); ;
+ this->axiom = NULL;
+ this->skip = NULL;
+ this->axiomCount = 0;
+ this->skipCount = 0;
+ this->elements = NULL;
+ this->isVerbose = 0;
+ this->isTimed = 0;
+ this->memoLimit = 0;
+ this->budget = 0;
+ this->first = NULL;
+ this->wordSets = NULL;
+ this->wordSetsCount = 0;
+ this->pool = NULL;
+ this->optimize = 0;
+ this->optimizations = NULL;
+ this->derivedCount = 0;
+ this->engine = 'r';
+ this->maxDepth = 0;
+ return this;
 }
 
 void Grammar_setVerbose ( Grammar* this ) {
@@ -1165,14 +2296,69 @@ void Grammar_setSilent ( Grammar* this ) {
  this->isVerbose = 0;
 }
 
+void Grammar_setTimed ( Grammar* this, 
+                                      _Bool 
+                                           timed ) {
+ this->isTimed = timed;
+}
+
+void Grammar_setMemoize ( Grammar* this, size_t limit ) {
+ this->memoLimit = limit;
+}
+
+void Grammar_setBudget ( Grammar* this, size_t budget ) {
+ this->budget = budget;
+}
+
+void Grammar_setEngine ( Grammar* this, char engine, size_t depth ) {
+ this->engine = engine;
+ this->maxDepth = depth;
+}
+
+void Grammar_setOptimize ( Grammar* this, int passes ) {
+ this->optimize = passes;
+}
+
 int Grammar_symbolsCount(Grammar* this) {
  return this->axiomCount + this->skipCount;
 }
 
+void Grammar__freeWordSets(Grammar* this) {
+ if (this->wordSets == NULL) {return;}
+ for (int i=0 ; i<this->wordSetsCount ; i++) {
+  WordSet_free(this->wordSets[i]);
+ }
+ if (this->wordSets!=NULL) {; gc_free(this->wordSets); } ;
+ this->wordSets = NULL;
+ this->wordSetsCount = 0;
+}
+
+
+
+void Grammar__restore(Grammar* this) {
+ while (this->optimizations != NULL) {
+  Optimization* o = this->optimizations;
+  o->element->children = o->children;
+  this->optimizations = o->next;
+  if (o!=NULL) {; gc_free(o); } ;
+ }
+ int count = this->axiomCount + this->skipCount + 1;
+ for (int i=count - this->derivedCount ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (Reference_Is(e)) {Reference_free((Reference*)e);} else {ParsingElement_free((ParsingElement*)e);}
+  this->elements[i] = NULL;
+ }
+ this->axiomCount -= this->derivedCount;
+ this->derivedCount = 0;
+}
+
 void Grammar_freeElements(Grammar* this) {
  if (this->elements == NULL) {
   Grammar_prepare(this);
  }
+ if (this->elements != NULL) {
+  Grammar__restore(this);
+ }
  int count = (this->axiomCount + this->skipCount);
  if (this->elements != NULL) {
 
@@ -1197,27 +2383,242 @@ void Grammar_freeElements(Grammar* this) {
  this->axiom = NULL;
  if (this->elements!=NULL) {; gc_free(this->elements); } ;
  this->elements = NULL;
+ if (this->first!=NULL) {; gc_free(this->first); } ;
+ this->first = NULL;
+ Grammar__freeWordSets(this);
 }
 
 void Grammar_free(Grammar* this) {
+ Grammar_setPool(this, 0);
  Grammar_freeElements(this);
  if (this!=NULL) {; gc_free(this); } ;
 }
+ArenaBlock* ArenaBlock_new(size_t size) {
+ ArenaBlock* this = (ArenaBlock*) gc_new(sizeof(ArenaBlock)); assert (this!=NULL); ;
+ char* data = (char*) gc_calloc(size, sizeof(char)) ; assert (data!=NULL); ;
+ this->data = data;
+ this->size = size;
+ this->next = NULL;
+ return this;
+}
+
+Arena* Arena_new(void) {
+ Arena* this = (Arena*) gc_new(sizeof(Arena)); assert (this!=NULL); ;
+ this->first = ArenaBlock_new((64 * 1024));
+ this->current = this->first;
+ this->offset = 0;
+ this->allocated = this->first->size;
+ return this;
+}
+
+void Arena_free(Arena* this) {
+ if (this == NULL) {return;}
+ ArenaBlock* block = this->first;
+ while (block != NULL) {
+  ArenaBlock* next = block->next;
+  if (block->data!=NULL) {; gc_free(block->data); } ;
+  if (block!=NULL) {; gc_free(block); } ;
+  block = next;
+ }
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+void* Arena_alloc(Arena* this, size_t size) {
+ size = (((size) + sizeof(void*) - 1) & ~(sizeof(void*) - 1));
+ if (this->offset + size > this->current->size) {
+
+
+  ArenaBlock* next = this->current->next;
+  if (next == NULL || next->size < size) {
+   ArenaBlock* block = ArenaBlock_new(size > (64 * 1024) ? size : (64 * 1024));
+   block->next = next;
+   this->current->next = block;
+   this->allocated += block->size;
+   next = block;
+  }
+  this->current = next;
+  this->offset = 0;
+ }
+ void* ptr = this->current->data + this->offset;
+ this->offset += size;
+ return ptr;
+}
+
+ArenaMark Arena_mark(Arena* this) {
+ ArenaMark mark = {this->current, this->offset};
+ return mark;
+}
+
+void Arena_rewind(Arena* this, ArenaMark mark) {
+ this->current = mark.block;
+ this->offset = mark.offset;
+}
+
+void Arena_reset(Arena* this) {
+ if (this == NULL) {return;}
+ this->current = this->first;
+ this->offset = 0;
+}
+
+
+
+
+
+
+
+Output* Output_new(void) {
+ Output* this = (Output*) gc_new(sizeof(Output)); assert (this!=NULL); ;
+
+ char* buffer = (char*) gc_calloc((64 * 1024) + 1, sizeof(char)) ; assert (buffer!=NULL); ;
+ this->buffer = buffer;
+ this->length = 0;
+ this->capacity = (64 * 1024);
+ this->written = 0;
+ this->fd = -1;
+ this->sink = NULL;
+ this->context = NULL;
+ this->failed = 0;
+ return this;
+}
+
+Output* Output_ToFile(int fd) {
+ Output* this = Output_new();
+ this->fd = fd;
+ return this;
+}
+
+Output* Output_ToSink(OutputSink sink, void* context) {
+ Output* this = Output_new();
+ this->sink = sink;
+ this->context = context;
+ return this;
+}
+
+void Output_free(Output* this) {
+ if (this != NULL) {
+  Output_flush(this);
+  if (this->buffer!=NULL) {; gc_free(this->buffer); } ;
+ }
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+
+_Bool 
+    Output__isFlushed(Output* this) {
+ return this->fd >= 0 || this->sink != NULL;
+}
 
 
 
+void Output__send(Output* this, const char* data, size_t length) {
+ if (this->failed || length == 0) {return;}
+ if (this->sink != NULL) {
+  this->failed = !this->sink(data, length, this->context);
+ } else {
+  size_t offset = 0;
+  while (offset < length) {
+   ssize_t n = write(this->fd, data + offset, length - offset);
+   if (n < 0 && errno == EINTR) {continue;}
+   if (n <= 0) {this->failed = 1; break;}
+   offset += (size_t)n;
+  }
+ }
+ if (!this->failed) {this->written += length;}
+}
+
+
+void Output__reserve(Output* this, size_t length) {
+ if (this->length + length <= this->capacity) {return;}
+ if (Output__isFlushed(this)) {
+  Output_flush(this);
+  if (length <= this->capacity) {return;}
+ }
+ size_t capacity = this->capacity;
+ while (capacity < this->length + length) {capacity *= 2;}
+ size_t allocated = capacity + 1;
+ this->buffer=gc_realloc(this->buffer,allocated * sizeof(char)); ;
+ this->capacity = capacity;
+}
+
+void Output_write(Output* this, const char* data, size_t length) {
+ if (length > this->capacity && Output__isFlushed(this)) {
+
+  Output_flush(this);
+  Output__send(this, data, length);
+ } else {
+  Output__reserve(this, length);
+  memcpy(this->buffer + this->length, data, length);
+  this->length += length;
+ }
+}
+
+void Output_writeString(Output* this, const char* string) {
+ Output_write(this, string, strlen(string));
+}
+
+void Output_writef(Output* this, const char* format, ...) {
+ va_list args;
+ va_start(args, format);
+ int length = vsnprintf(this->buffer + this->length, this->capacity + 1 - this->length, format, args);
+ va_end(args);
+ if (length < 0) {return;}
+ if (this->length + (size_t)length > this->capacity) {
 
+  Output__reserve(this, (size_t)length);
+  va_start(args, format);
+  vsnprintf(this->buffer + this->length, this->capacity + 1 - this->length, format, args);
+  va_end(args);
+ }
+ this->length += (size_t)length;
+}
+
+void Output_writeEscaped(Output* this, const char* data, size_t length) {
+
+
+ size_t i = 0;
+ while (i < length) {
+  size_t n = (length - i < this->capacity / 2 ? length - i : this->capacity / 2);
+  Output__reserve(this, n * 2);
+  char* p = this->buffer + this->length;
+  for (size_t j=i ; j < i + n ; j++) {
+   char c = data[j];
+   switch(c) {
+    case '\n': *p++ = '\\'; *p++ = 'n'; break;
+    case '\t': *p++ = '\\'; *p++ = 't'; break;
+    case '\r': *p++ = '\\'; *p++ = 'r'; break;
+    case '"': *p++ = '\\'; *p++ = '"'; break;
+    case '\\': *p++ = '\\'; *p++ = '\\'; break;
+    default: *p++ = c;
+   }
+  }
+  this->length = (size_t)(p - this->buffer);
+  i += n;
+ }
+}
 
 
+_Bool 
+    Output_flush(Output* this) {
+ if (Output__isFlushed(this)) {
+  Output__send(this, this->buffer, this->length);
+  this->length = 0;
+ }
+ return !this->failed;
+}
 
+const char* Output_text(Output* this) {
+ this->buffer[this->length] = '\0';
+ return this->buffer;
+}
 Match* Match__Success(size_t length, Element* element, ParsingContext* context) {
- Match* this = Match_new();
+ Match* this = context->arena != NULL ? Match_FromArena(context->arena) : Match_new();
  assert( element != NULL );
  this->status = 'M';
  this->offset = context->iterator->offset;
  this->length = length;
 
- this->line = context->iterator->lines;
+
+ this->line = context->iterator->window > 0 ? Iterator_getLine(context->iterator) : SIZE_MAX;
  this->element = (Element*)element;
  this->data = NULL;
  this->next = NULL;
@@ -1238,9 +2639,10 @@ Match* Match_new(void) {
  Match* this = (Match*) gc_new(sizeof(Match)); assert (this!=NULL); ;
 
  this->status = '-';
+ this->flags = 0;
  this->offset = 0;
  this->length = 0;
- this->line = 0;
+ this->line = SIZE_MAX;
  this->element = NULL;
  this->data = NULL;
  this->next = NULL;
@@ -1250,10 +2652,26 @@ Match* Match_new(void) {
  return this;
 }
 
-
+Match* Match_FromArena(Arena* arena) {
+ Match* this = (Match*)Arena_alloc(arena, sizeof(Match));
+ this->status = '-';
+ this->flags = 0x01;
+ this->offset = 0;
+ this->length = 0;
+ this->line = SIZE_MAX;
+ this->element = NULL;
+ this->data = NULL;
+ this->next = NULL;
+ this->children = NULL;
+ this->parent = NULL;
+ this->result = NULL;
+ return this;
+}
 
 void* Match_free(Match* this) {
- if (this!=NULL && this!=FAILURE) {
+
+
+ if (this!=NULL && this!=FAILURE && !(this->flags & 0x01)) {
   ;
 
 
@@ -1296,6 +2714,57 @@ void* Match_fail( Match* this ) {
  return FAILURE;
 }
 
+
+
+
+Match* Match__copy( Match* this, Arena* arena, size_t* bytes, ParsingContext* context, long shift, int lines ) {
+ if (this == NULL || this == FAILURE) {return this;}
+ Match* copy = arena != NULL ? Match_FromArena(arena) : Match_new();
+ copy->status = this->status;
+ copy->offset = (size_t)((long)this->offset + shift);
+ copy->length = this->length;
+ copy->line = this->line == SIZE_MAX ? SIZE_MAX : (size_t)((long)this->line + lines);
+ copy->element = this->element;
+ if (bytes != NULL) {*bytes += sizeof(Match);}
+
+
+ if (this->data != NULL && Match_getElementType(this) == 'T') {
+  TokenMatch* data = TokenMatch_copy(this, arena);
+  if (bytes != NULL) {*bytes += sizeof(TokenMatch) + sizeof(TokenMatchGroup) * data->count;}
+  for (int i=0 ; bytes != NULL && data->owned && i<data->count ; i++) {
+   *bytes += sizeof(const char*) + data->spans[i].length + 1;
+  }
+  for (int i=0 ; shift != 0 && i<data->count ; i++) {
+   data->spans[i].offset = (size_t)((long)data->spans[i].offset + shift);
+  }
+
+
+  if (context != NULL && data->context != context) {
+   data->context = context;
+   if (!data->owned) {data->groups = NULL;}
+  }
+  copy->data = data;
+ } else {
+  copy->data = this->data;
+ }
+
+ Match* child = this->children;
+ Match* last = NULL;
+ while (child != NULL) {
+  Match* c = Match__copy(child, arena, bytes, context, shift, lines);
+  if (last == NULL) {copy->children = c;}
+  else {last->next = c;}
+  c->parent = copy;
+  last = c;
+  child = child->next;
+ }
+ return copy;
+}
+
+Match* Match_copy( Match* this, Arena* arena, size_t* bytes ) {
+ return Match__copy(this, arena, bytes, NULL, 0, 0);
+}
+
 ParsingElement* Match_getParsingElement( Match* this ) {
  return ParsingElement_Ensure(this->element);
 }
@@ -1340,6 +2809,12 @@ int Match_getOffset(Match *this) {
  return (int)this->offset;
 }
 
+size_t Match_getLine(Match* this, Iterator* iterator) {
+ if (this == NULL || this == FAILURE) {return SIZE_MAX;}
+ if (this->line == SIZE_MAX && iterator != NULL) {this->line = Iterator_lineAt(iterator, this->offset);}
+ return this->line;
+}
+
 int Match_getLength(Match *this) {
  if (this == NULL) {return 0;}
  return (int)this->length;
@@ -1357,12 +2832,16 @@ _Bool
 }
 
 int Match__walk(Match* this, MatchWalkingCallback callback, int step, void* context ){
- step = callback(this, step, context);
- if (this->children != NULL && step >= 0) {
-  step = Match__walk(this->children, callback, step + 1, context);
- }
- if (this->next != NULL && step >= 0) {
-  step = Match__walk(this->next, callback, step + 1, context);
+
+
+ while (1) {
+  step = callback(this, step, context);
+  if (this->children != NULL && step >= 0) {
+   step = Match__walk(this->children, callback, step + 1, context);
+  }
+  if (this->next == NULL || step < 0) {break;}
+  this = this->next;
+  step += 1;
  }
  return step;
 }
@@ -1405,12 +2884,12 @@ int Match_countChildren(Match* this) {
  }
  return count;
 }
-void Match__childrenWriteJSON(Match* match, int fd, int flags) {
+void Match__childrenWriteJSON(Match* match, Output* output, int flags) {
  int count = 0 ;
  Match* child = match->children;
  while (child != NULL) {
   ParsingElement* element = ParsingElement_Ensure(child->element);
-  if (element->type != 'p' && element->type != 'c') {
+  if (element->type != 'p' && element->type != 'c' && element->type != '!') {
    count += 1;
   }
   child = child->next;
@@ -1419,10 +2898,10 @@ void Match__childrenWriteJSON(Match* match, int fd, int flags) {
  int i = 0;
  while (child != NULL) {
   ParsingElement* element = ParsingElement_Ensure(child->element);
-  if (element->type != 'p' && element->type != 'c') {
-   Match__writeJSON(child, fd, flags);
+  if (element->type != 'p' && element->type != 'c' && element->type != '!') {
+   Match__writeJSON(child, output, flags);
    if ( (i+1) < count ) {
-    dprintf(fd,"%s",",");
+    Output_writeString(output,",");
    }
    i += 1;
   }
@@ -1430,9 +2909,9 @@ void Match__childrenWriteJSON(Match* match, int fd, int flags) {
  }
 }
 
-void Match__writeJSON(Match* match, int fd, int flags) {
+void Match__writeJSON(Match* match, Output* output, int flags) {
  if (match == NULL || match->element == NULL) {
-  dprintf(fd,"%s","null");
+  Output_writeString(output,"null");
   return;
  }
 
@@ -1441,89 +2920,90 @@ void Match__writeJSON(Match* match, int fd, int flags) {
  if (element->type == '#') {
   Reference* ref = (Reference*)match->element;
   if (ref->cardinality == '1' || ref->cardinality == '=' || ref->cardinality == '?') {
-   Match__writeJSON(match->children, fd, flags);
+   Match__writeJSON(match->children, output, flags);
   } else {
-   dprintf(fd,"%s","[");
-   Match__childrenWriteJSON(match, fd, flags);
-   dprintf(fd,"%s","]");
+   Output_writeString(output,"[");
+   Match__childrenWriteJSON(match, output, flags);
+   Output_writeString(output,"]");
   }
  }
  else if (element->type != '#') {
 
   int i = 0;
   int count = 0;
-  char* word = NULL;
   switch(element->type) {
    case 'W':
-    word = String_escape(Word_word(element));
-    if (element->name) {dprintf(fd,"%s","{\"name\":\"");dprintf(fd,"%s",element->name);dprintf(fd,"%s","\"");} else {dprintf(fd,"%s","{\"id\":");dprintf(fd,"%d",element->id);};
-    dprintf(fd,"%s",",\"value\":\"");dprintf(fd,"%s",word);dprintf(fd,"%s","\"");
-    dprintf(fd,"%s","}");
-    free(word);
+    if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+    Output_writeString(output,",\"value\":\"");Output_writeEscaped(output,Word_word(element),(size_t)(strlen(Word_word(element))));Output_writeString(output,"\"");
+    Output_writeString(output,"}");
     break;
    case 'T':
     count = TokenMatch_count(match);
     if (count == 0) {
-     if (element->name) {dprintf(fd,"%s","{\"name\":\"");dprintf(fd,"%s",element->name);dprintf(fd,"%s","\"");} else {dprintf(fd,"%s","{\"id\":");dprintf(fd,"%d",element->id);};
-     dprintf(fd,"%s","}");
+     if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+     Output_writeString(output,"}");
     } else if (count == 1) {
-     if (element->name) {dprintf(fd,"%s","{\"name\":\"");dprintf(fd,"%s",element->name);dprintf(fd,"%s","\"");} else {dprintf(fd,"%s","{\"id\":");dprintf(fd,"%d",element->id);};
-     word = String_escape(TokenMatch_group(match, 0));
-     dprintf(fd,"%s",",\"value\":\"");dprintf(fd,"%s",word);dprintf(fd,"%s","\"");
-     free(word);
-     dprintf(fd,"%s","}");
+     if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+     Output_writeString(output,",\"value\":\"");Output_writeEscaped(output,TokenMatch_groupStart(match,0),(size_t)(TokenMatch_groupLength(match,0)));Output_writeString(output,"\"");
+     Output_writeString(output,"}");
     } else {
-     if (element->name) {dprintf(fd,"%s","{\"name\":\"");dprintf(fd,"%s",element->name);dprintf(fd,"%s","\"");} else {dprintf(fd,"%s","{\"id\":");dprintf(fd,"%d",element->id);};
-     dprintf(fd,"%s",",\"content\":[");
+     if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+     Output_writeString(output,",\"content\":[");
      for (i=0 ; i < count ; i++) {
-      word = String_escape(TokenMatch_group(match, i));
-      dprintf(fd,"%s","\"");dprintf(fd,"%s",word);dprintf(fd,"%s","\"");
-      if (i+1 < count) {dprintf(fd,"%s",",");}
-      free(word);
+      Output_writeString(output,"\"");Output_writeEscaped(output,TokenMatch_groupStart(match,i),(size_t)(TokenMatch_groupLength(match,i)));Output_writeString(output,"\"");
+      if (i+1 < count) {Output_writeString(output,",");}
      }
-     dprintf(fd,"%s","]");
-     dprintf(fd,"%s","}");
+     Output_writeString(output,"]");
+     Output_writeString(output,"}");
     }
     break;
    case 'G':
    case 'R':
     if (match->children == NULL) {
-     if (element->name) {dprintf(fd,"%s","{\"name\":\"");dprintf(fd,"%s",element->name);dprintf(fd,"%s","\"");} else {dprintf(fd,"%s","{\"id\":");dprintf(fd,"%d",element->id);};
-     dprintf(fd,"%s","}");
+     if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+     Output_writeString(output,"}");
     } else {
-     if (element->name) {dprintf(fd,"%s","{\"name\":\"");dprintf(fd,"%s",element->name);dprintf(fd,"%s","\"");} else {dprintf(fd,"%s","{\"id\":");dprintf(fd,"%d",element->id);};
-     dprintf(fd,"%s",",\"content\":[");
-     Match__childrenWriteJSON(match, fd, flags);
-     dprintf(fd,"%s","]");
-     dprintf(fd,"%s","}");
+     if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+     Output_writeString(output,",\"content\":[");
+     Match__childrenWriteJSON(match, output, flags);
+     Output_writeString(output,"]");
+     Output_writeString(output,"}");
     }
     break;
    case 'p':
     break;
    case 'c':
     break;
+   case '!':
+    break;
    default:
-    dprintf(fd,"\"ERROR:undefined element type=%c\"",element->type);
+    Output_writef(output,"\"ERROR:undefined element type=%c\"",element->type);
   }
  } else {
-  dprintf(fd,"\"ERROR:unsupported element type=%c\"",element->type);
+  Output_writef(output,"\"ERROR:unsupported element type=%c\"",element->type);
  }
 }
 
+void Match_outputJSON(Match* this, Output* output) {
+ Match__writeJSON(this, output, 0);
+}
+
 void Match_writeJSON(Match* this, int fd) {
- Match__writeJSON(this, fd, 0);
+ Output* output = Output_ToFile(fd);
+ Match__writeJSON(this, output, 0);
+ Output_free(output);
 }
 
 
 void Match_printJSON(Match* this) {
  return Match_writeJSON(this, 1);
 }
-void Match__childrenWriteXML(Match* match, int fd, int flags) {
+void Match__childrenWriteXML(Match* match, Output* output, int flags) {
  int count = 0 ;
  Match* child = match->children;
  while (child != NULL) {
   ParsingElement* element = ParsingElement_Ensure(child->element);
-  if (element->type != 'p' && element->type != 'c') {
+  if (element->type != 'p' && element->type != 'c' && element->type != '!') {
    count += 1;
   }
   child = child->next;
@@ -1532,15 +3012,15 @@ void Match__childrenWriteXML(Match* match, int fd, int flags) {
  int i = 0;
  while (child != NULL) {
   ParsingElement* element = ParsingElement_Ensure(child->element);
-  if (element->type != 'p' && element->type != 'c') {
-   Match__writeXML(child, fd, flags);
+  if (element->type != 'p' && element->type != 'c' && element->type != '!') {
+   Match__writeXML(child, output, flags);
    i += 1;
   }
   child = child->next;
  }
 }
 
-void Match__writeXML(Match* match, int fd, int flags) {
+void Match__writeXML(Match* match, Output* output, int flags) {
  if (match == NULL || match->element == NULL) {
   return;
  }
@@ -1549,9 +3029,9 @@ void Match__writeXML(Match* match, int fd, int flags) {
  if (element->type == '#') {
   Reference* ref = (Reference*)match->element;
   if (ref->cardinality == '1' || ref->cardinality == '=' || ref->cardinality == '?') {
-   Match__writeXML(match->children, fd, flags);
+   Match__writeXML(match->children, output, flags);
   } else {
-   Match__childrenWriteXML(match, fd, flags);
+   Match__childrenWriteXML(match, output, flags);
   }
  }
 
@@ -1561,9 +3041,9 @@ void Match__writeXML(Match* match, int fd, int flags) {
   switch(element->type) {
    case 'W':
     if (element->name != NULL) {
-     dprintf(fd,"%s","<");
-     if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);};
-     dprintf(fd,"%s","/>");
+     Output_writeString(output,"<");
+     if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);};
+     Output_writeString(output,"/>");
     } else {
 
 
@@ -1573,29 +3053,29 @@ void Match__writeXML(Match* match, int fd, int flags) {
     count = TokenMatch_count(match);
     if (count == 0) {
      if (element->name != NULL) {
-      dprintf(fd,"%s","<");
-      if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);};
-      dprintf(fd,"%s","/>");
+      Output_writeString(output,"<");
+      if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);};
+      Output_writeString(output,"/>");
      }
     } else if (count == 1) {
      if (element->name != NULL) {
-      dprintf(fd,"%s","<");
-      if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);};
-      dprintf(fd,"%s"," t=\"");
-      dprintf(fd,"%s",TokenMatch_group(match, i));
-      dprintf(fd,"%s","\"/>");
+      Output_writeString(output,"<");
+      if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);};
+      Output_writeString(output," t=\"");
+      Output_write(output, TokenMatch_groupStart(match,i), TokenMatch_groupLength(match,i));
+      Output_writeString(output,"\"/>");
      } else {
-      dprintf(fd,"%s",TokenMatch_group(match, i));
+      Output_write(output, TokenMatch_groupStart(match,i), TokenMatch_groupLength(match,i));
      }
     } else {
      if (element->name != NULL) {
-      if (element->name != NULL) {dprintf(fd,"%s","<") ; if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);} ; dprintf(fd,"%s",">");};
+      if (element->name != NULL) {Output_writeString(output,"<") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
       for (i=0 ; i < count ; i++) {
-       dprintf(fd,"%s","<g t=\"");
-       dprintf(fd,"%s",TokenMatch_group(match, i));
-       dprintf(fd,"%s","\"/>");
+       Output_writeString(output,"<g t=\"");
+       Output_write(output, TokenMatch_groupStart(match,i), TokenMatch_groupLength(match,i));
+       Output_writeString(output,"\"/>");
       }
-      if (element->name != NULL) {dprintf(fd,"%s","</") ; if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);} ; dprintf(fd,"%s",">");};
+      if (element->name != NULL) {Output_writeString(output,"</") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
      } else {
 
      }
@@ -1606,11 +3086,11 @@ void Match__writeXML(Match* match, int fd, int flags) {
 
     } else {
      if (element->name != NULL) {
-      if (element->name != NULL) {dprintf(fd,"%s","<") ; if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);} ; dprintf(fd,"%s",">");};
-      Match__writeXML(match->children, fd, flags);
-      if (element->name != NULL) {dprintf(fd,"%s","</") ; if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);} ; dprintf(fd,"%s",">");};
+      if (element->name != NULL) {Output_writeString(output,"<") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
+      Match__writeXML(match->children, output, flags);
+      if (element->name != NULL) {Output_writeString(output,"</") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
      } else {
-      Match__writeXML(match->children, fd, flags);
+      Match__writeXML(match->children, output, flags);
      }
     }
     break;
@@ -1618,11 +3098,11 @@ void Match__writeXML(Match* match, int fd, int flags) {
     if (match->children == NULL) {
     } else {
      if (element->name != NULL) {
-      if (element->name != NULL) {dprintf(fd,"%s","<") ; if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);} ; dprintf(fd,"%s",">");};
-      Match__childrenWriteXML(match, fd, flags);
-      if (element->name != NULL) {dprintf(fd,"%s","</") ; if (element->name != NULL) { dprintf(fd,"%s",element->name); } else {dprintf(fd,"E%d",element->id);} ; dprintf(fd,"%s",">");};
+      if (element->name != NULL) {Output_writeString(output,"<") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
+      Match__childrenWriteXML(match, output, flags);
+      if (element->name != NULL) {Output_writeString(output,"</") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
      } else {
-      Match__childrenWriteXML(match, fd, flags);
+      Match__childrenWriteXML(match, output, flags);
      }
     }
     break;
@@ -1630,11 +3110,13 @@ void Match__writeXML(Match* match, int fd, int flags) {
     break;
    case 'c':
     break;
+   case '!':
+    break;
    default:
-    dprintf(fd,"<error value=\"Undefined element type\" type=\"%c\" />",element->type);
+    Output_writef(output,"<error value=\"Undefined element type\" type=\"%c\" />",element->type);
   }
  } else {
-  dprintf(fd,"<error t=\"Unsupported element type\" type=\"%c\" />",element->type);
+  Output_writef(output,"<error t=\"Unsupported element type\" type=\"%c\" />",element->type);
  }
 }
 
@@ -1642,9 +3124,15 @@ void Match_printXML(Match* this) {
  Match_writeXML(this, 1);
 }
 
+void Match_outputXML(Match* this, Output* output) {
+ Output_writeString(output,"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n");
+ Match__writeXML(this, output, 0);
+}
+
 void Match_writeXML(Match* this, int fd ) {
- dprintf(fd,"%s","<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n");
- Match__writeXML(this, fd, 0);
+ Output* output = Output_ToFile(fd);
+ Match_outputXML(this, output);
+ Output_free(output);
 }
 
 
@@ -1666,6 +3154,7 @@ _Bool
   case 'R':
   case 'c':
   case 'p':
+  case '!':
    return 1;
   default:
    return 0;
@@ -1689,6 +3178,7 @@ ParsingElement* ParsingElement_new(Reference* children[]) {
  this->recognize = NULL;
  this->process = NULL;
  this->freeMatch = NULL;
+ this->flags = 0;
  if (children != NULL && *children != NULL) {
   Reference* r = Reference_Ensure(*children);
   while ( r != NULL ) {
@@ -1761,53 +3251,230 @@ Match* ParsingElement_process( ParsingElement* this, Match* match ) {
  return match;
 }
 
-size_t ParsingElement_skip( ParsingElement* this, ParsingContext* context) {
- if (this == NULL || context == NULL || context->grammar->skip == NULL || context->flags & 0x1) {return 0;}
- context->flags=context->flags|0x1;;
- ParsingElement* skip = context->grammar->skip;
- size_t offset = context->iterator->offset;
 
- Match* match = skip->recognize(skip, context);
- match = Match_free(match);
- size_t skipped = context->iterator->offset - offset;
- if (skipped > 0) {
-  if(context->grammar->isVerbose){fprintf(stdout, " %s   ►►►skipped %zu", context->indent, skipped);fprintf(stdout, "\n");;}
- }
- context->flags = context->flags & ~0x1;
- return skipped;
+void ParsingContext__reach(ParsingContext* this, size_t reach) {
+ if (this->reach < reach) {this->reach = reach;}
 }
 
-ParsingElement* ParsingElement_name( ParsingElement* this, const char* name ) {
- if (this == NULL) {return this;}
- if (this->name!=NULL) {; gc_free(this->name); } ;
- this->name = gc_strdup(name) ; assert (this->name!=NULL); ;
- return this;
-}
 
-const char* ParsingElement_getName( ParsingElement* this ) {
- return this == NULL ? NULL : (const char*)this->name;
-}
 
-int ParsingElement_walk( ParsingElement* this, ElementWalkingCallback callback, void* context ) {
- return ParsingElement__walk(this, callback, 0, context);
-}
 
-int ParsingElement__walk( ParsingElement* this, ElementWalkingCallback callback, int step, void* context ) {
- ;;
- int i = step;
- step = callback((Element*)this, step, context);
- Reference* child = this->children;
- while ( child != NULL && step >= 0) {
 
 
-  assert(Reference_Is(child));
-  int j = Reference__walk(child, callback, ++i, context);
 
-  if (j > 0) { step = i = j; }
-  else {break;}
-  child = child->next;
- }
- return (step > 0) ? step : i;
+_Bool 
+    ParsingElement__isMemoized( ParsingElement* this, ParsingContext* context ) {
+ return context->memo != NULL && this->id >= 0 && !(this->flags & 0x04) && !(context->flags & 0x1) && context->callback == NULL
+ && !((this->flags & 0x01) && (this->flags & 0x02));
+}
+
+
+
+Match* ParsingElement__recall( ParsingElement* this, ParsingContext* context ) {
+ size_t offset = context->iterator->offset;
+ MemoEntry* entry = Memo_get(context->memo, this->id, offset);
+ if (entry == NULL) {
+  context->stats->memoMisses += 1;
+  return NULL;
+ }
+ context->stats->memoHits += 1;
+ ParsingContext__reach(context, entry->reach);
+ if (entry->match == FAILURE) {
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, " !  %s└ Memo %s#%d failed at %zu", context->indent, this->name, this->id, offset);fprintf(stdout, "\n");;};
+  return FAILURE;
+ } else {
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s└ Memo %s#%d matched %zu-%zu", context->indent, this->name, this->id, offset, entry->end);fprintf(stdout, "\n");;};
+  Match* match = Match__copy(entry->match, context->arena, NULL, context, entry->shift, entry->lines);
+  context->iterator->move(context->iterator, entry->end - offset);
+  return match;
+ }
+}
+
+
+
+
+
+void ParsingElement__memoize( ParsingElement* this, ParsingContext* context, size_t offset, size_t cuts, Match* match ) {
+ if (context->cuts == cuts && !context->exceeded && !context->tooDeep && (Match_isSuccess(match) ? !(this->flags & 0x01) : !(this->flags & 0x02))) {
+  Memo_set(context->memo, this->id, offset, context->iterator->offset, context->reach, Match_isSuccess(match) ? match : FAILURE);
+ }
+}
+
+Match* ParsingElement__recognize( ParsingElement* this, ParsingContext* context ) {
+ Memo* memo = context->memo;
+ if (memo == NULL) {return this->recognize(this, context);}
+ size_t offset = context->iterator->offset;
+
+
+
+
+ if (this->type != 'R' && this->type != 'G') {
+  Match* match = this->recognize(this, context);
+  ParsingContext__reach(context, (Match_isSuccess(match) ? offset + match->length : offset) + 1);
+  if (this->type == 'W') {ParsingContext__reach(context, offset + ((WordConfig*)this->config)->length);}
+  return match;
+ }
+ if (!ParsingElement__isMemoized(this, context)) {
+  return this->recognize(this, context);
+ }
+ Match* recalled = ParsingElement__recall(this, context);
+ if (recalled != NULL) {return recalled;}
+
+
+ size_t reach = context->reach;
+ size_t cuts = context->cuts;
+ context->reach = offset + 1;
+ Match* match = this->recognize(this, context);
+ ParsingElement__memoize(this, context, offset, cuts, match);
+ ParsingContext__reach(context, reach);
+ return match;
+}
+
+
+
+
+_Bool 
+    ParsingContext__exceeds( ParsingContext* this ) {
+ if (this->budget != 0 && (this->exceeded || ParsingContext_account(this) > this->budget)) {
+  if(this->grammar->isVerbose && !this->exceeded){fprintf(stderr, "--- ");fprintf(stderr, "Aborted, %zu bytes exceed the budget of %zu bytes at %zu", ParsingContext_account(this), this->budget, this->iterator->offset);fprintf(stderr, "\n");;}
+  this->exceeded = 1;
+  return 1;
+ }
+ return 0;
+}
+
+Match* ParsingElement_recognize( ParsingElement* this, ParsingContext* context ) {
+ if (ParsingContext__exceeds(context)) {return FAILURE;}
+ Profiler* profiler = context->profiler;
+ if (profiler != NULL) {Profiler_enter(profiler, this);}
+
+
+
+
+
+ Match* match = ParsingElement__recognize(this, context);
+
+
+
+
+
+ if (profiler != NULL) {Profiler_exit(profiler);}
+ return match;
+}
+
+ParsingElement* ParsingElement_memoize( ParsingElement* this, 
+                                                             _Bool 
+                                                                  successes, 
+                                                                             _Bool 
+                                                                                  failures ) {
+ if (this == NULL) {return this;}
+ if (successes) {this->flags = this->flags & ~0x01;;} else {this->flags=this->flags|0x01;;}
+ if (failures) {this->flags = this->flags & ~0x02;;} else {this->flags=this->flags|0x02;;}
+ return this;
+}
+
+
+
+size_t Iterator__scan( Iterator* this, FirstSet* set ) {
+ size_t skipped = 0;
+ while (1) {
+  size_t remaining = Iterator_remaining(this);
+  size_t n = 0;
+  const unsigned char* c = (const unsigned char*)this->current;
+  while (n < remaining && ((set)->bytes[((unsigned char)(c[n])) >> 3] & (1 << (((unsigned char)(c[n])) & 7)))) {n++;}
+  if (n == 0) {break;}
+
+
+  
+ _Bool 
+      more = n == remaining;
+  if (more && n > 1) {n -= 1;}
+  this->move(this, n);
+  skipped += n;
+  if (!more) {break;}
+ }
+ return skipped;
+}
+
+size_t ParsingElement_skip( ParsingElement* this, ParsingContext* context) {
+ if (this == NULL || context == NULL || context->grammar->skip == NULL || context->flags & 0x1) {return 0;}
+ ParsingElement* skip = context->grammar->skip;
+ size_t offset = context->iterator->offset;
+
+
+
+ 
+_Bool 
+     cached = !(skip->flags & 0x04);
+ if (cached && context->skipOffset == offset) {
+  size_t skipped = context->skipEnd - offset;
+  if (skipped > 0) {context->iterator->move(context->iterator, skipped);}
+  if (context->memo != NULL) {ParsingContext__reach(context, context->skipReach);}
+  return skipped;
+ }
+ size_t reach = context->reach;
+ context->reach = offset + 1;
+ context->flags=context->flags|0x1;;
+
+ if (context->profiler != NULL) {Profiler_enter(context->profiler, skip);}
+ if (skip->type == 'T' && ((TokenConfig*)skip->config)->repeats != NULL) {
+
+
+  Iterator__scan(context->iterator, ((TokenConfig*)skip->config)->repeats);
+ } else {
+  ArenaMark mark = Arena_mark(context->arena);
+
+  Match* match = skip->recognize(skip, context);
+  match = Match_free(match);
+  Arena_rewind(context->arena, mark);
+ }
+ if (context->profiler != NULL) {Profiler_exit(context->profiler);}
+ size_t skipped = context->iterator->offset - offset;
+ ParsingContext__reach(context, offset + skipped + 1);
+ if (cached) {
+  context->skipOffset = offset;
+  context->skipEnd = offset + skipped;
+  context->skipReach = context->reach;
+ }
+ ParsingContext__reach(context, reach);
+ if (skipped > 0) {
+  if(context->grammar->isVerbose){fprintf(stdout, " %s   ►►►skipped %zu", context->indent, skipped);fprintf(stdout, "\n");;}
+ }
+ context->flags = context->flags & ~0x1;
+ return skipped;
+}
+
+ParsingElement* ParsingElement_name( ParsingElement* this, const char* name ) {
+ if (this == NULL) {return this;}
+ if (this->name!=NULL) {; gc_free(this->name); } ;
+ this->name = gc_strdup(name) ; assert (this->name!=NULL); ;
+ return this;
+}
+
+const char* ParsingElement_getName( ParsingElement* this ) {
+ return this == NULL ? NULL : (const char*)this->name;
+}
+
+int ParsingElement_walk( ParsingElement* this, ElementWalkingCallback callback, void* context ) {
+ return ParsingElement__walk(this, callback, 0, context);
+}
+
+int ParsingElement__walk( ParsingElement* this, ElementWalkingCallback callback, int step, void* context ) {
+ ;;
+ int i = step;
+ step = callback((Element*)this, step, context);
+ Reference* child = this->children;
+ while ( child != NULL && step >= 0) {
+
+
+  assert(Reference_Is(child));
+  int j = Reference__walk(child, callback, ++i, context);
+
+  if (j > 0) { step = i = j; }
+  else {break;}
+  child = child->next;
+ }
+ return (step > 0) ? step : i;
 }
 
 
@@ -1933,6 +3600,53 @@ int Reference__walk( Reference* this, ElementWalkingCallback callback, int step,
  return step;
 }
 
+void ParsingContext__enclose(ParsingContext* this, ParsingElement* rule, Match* result, size_t offset) {
+ if (!Match_isSuccess(result)) {
+  result = Match_Success(0, rule, this);
+  result->offset = offset;
+ }
+ this->enclosing = result;
+}
+
+
+
+
+
+
+void ParsingContext__open(ParsingContext* this, size_t offset) {
+ Match* enclosing = this->enclosing;
+ Listener* listener = this->listener;
+ this->opened = 1;
+ if (listener == NULL) {
+  for (Match* child = enclosing->children ; child != NULL ; child = child->next) {
+   Processor_process(this->processor, child, 0);
+  }
+  return;
+ }
+ if (listener->enter != NULL) {
+  listener->enter(listener, Match_getElementID(enclosing), enclosing->offset, offset - enclosing->offset);
+ }
+ for (Match* child = enclosing->children ; child != NULL ; child = child->next) {
+  Listener_send(listener, child);
+ }
+ if (listener->enter != NULL) {
+  listener->enter(listener, this->commit->id, offset, 0);
+ }
+}
+
+
+
+
+void ParsingContext__commit(ParsingContext* this, Match* match, size_t offset) {
+ if (!this->opened && this->enclosing != NULL) {ParsingContext__open(this, offset);}
+ if (this->listener != NULL) {
+  Listener_send(this->listener, match);
+ } else {
+  Processor_process(this->processor, match, 0);
+ }
+ Iterator_commit(this->iterator, Match_getEndOffset(match));
+}
+
 Match* Reference_recognize(Reference* this, ParsingContext* context) {
 
 
@@ -1945,7 +3659,8 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
  int count = 0;
  int offset = context->iterator->offset;
  int match_end_offset = offset;
- size_t match_end_lines = context->iterator->lines;
+
+ ArenaMark mark = Arena_mark(context->arena);
 
 
 
@@ -1953,7 +3668,7 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 
 
  size_t current_offset = offset;
- while ((Iterator_hasMore(context->iterator) || this->element->type == 'p' || this->element->type == 'c')) {
+ while ((Iterator_hasMore(context->iterator) || this->element->type == 'p' || this->element->type == 'c' || this->element->type == '!')) {
 
 
   ;
@@ -1965,15 +3680,22 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 
 
   int iteration_offset = context->iterator->offset;
-  Match* match = this->element->recognize(this->element, context);
+  size_t cuts = context->cuts;
+  Match* match = ParsingElement_recognize(this->element, context);
   int parsed = context->iterator->offset - iteration_offset;
 
 
   if (Match_isSuccess(match)) {
    match_end_offset = Match_getEndOffset(match);
+   if (this == context->commit) {
 
-   match_end_lines = context->iterator->lines;
-   if (count == 0) {
+
+    ParsingContext__commit(context, match, (size_t)offset);
+    match = Match_free(match);
+    Arena_rewind(context->arena, mark);
+    if (parsed == 0) {count++; break;}
+
+   } else if (count == 0) {
 
 
     assert(result == FAILURE);
@@ -2002,6 +3724,13 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 
    match = Match_free(match);
 
+   if (context->cuts != cuts) {
+    result = Match_fail(result);
+    Arena_rewind(context->arena, mark);
+    ParsingContext_backtrack(context, offset);
+    return ParsingContext_registerMatch(context, (Element*)this, FAILURE);
+   }
+
 
    size_t skipped = ParsingElement_skip((ParsingElement*)this, context);
 
@@ -2020,15 +3749,16 @@ Match* Reference_recognize(Reference* this, ParsingContext* context) {
 
  if (context->iterator->offset != match_end_offset) {
 
-  Iterator_backtrack(context->iterator, match_end_offset, match_end_lines);
+  ParsingContext_backtrack(context, match_end_offset);
  }
 
  ;;
 
 
+
  
 _Bool 
-     is_success = Match_isSuccess(result) ? 1 : 0;
+     is_success = Match_isSuccess(result) || (this == context->commit && count > 0) ? 1 : 0;
  switch (this->cardinality) {
   case '1':
    break;
@@ -2047,6 +3777,7 @@ _Bool
   case '=':
    if (is_success && result->length == 0) {
     result = Match_fail(result);
+    Arena_rewind(context->arena, mark);
     return ParsingContext_registerMatch(context, (Element*)this, result);
    }
    break;
@@ -2054,6 +3785,7 @@ _Bool
 
    fprintf(stderr, "ERR ");fprintf(stderr, "Unsupported cardinality %c", this->cardinality);fprintf(stderr, "\n");;
    result = Match_fail(result);
+   Arena_rewind(context->arena, mark);
    return ParsingContext_registerMatch(context, (Element*)this, result);
  }
 
@@ -2069,12 +3801,14 @@ _Bool
 
   m->children = result == FAILURE ? NULL : result;
   m->offset = offset;
+  for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
   assert(m->children == NULL || m->children->element != NULL);
 
   return ParsingContext_registerMatch(context, (Element*)this, m);
  } else {
 
   result = Match_fail(result);
+  Arena_rewind(context->arena, mark);
   return ParsingContext_registerMatch(context, (Element*)this, FAILURE);
  }
 }
@@ -2123,16 +3857,17 @@ const char* Word_word(ParsingElement* this) {
 
 Match* Word_recognize(ParsingElement* this, ParsingContext* context) {
  WordConfig* config = ((WordConfig*)this->config);
- if (strncmp(config->word, context->iterator->current, config->length) == 0) {
+
+ if (config->length <= Iterator_remaining(context->iterator) && strncmp(config->word, context->iterator->current, config->length) == 0) {
 
 
   Match* success = ParsingContext_registerMatch(context, (Element*)this, Match_Success(config->length, this, context));
  
   context->iterator->move(context->iterator, config->length);
-  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s└ Word %s#%d:`" "\033[36m" "%s" "\033[0m" "` matched %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, ((WordConfig*)this->config)->word, context->iterator->lines, context->iterator->offset - config->length, context->iterator->offset, context->depth);fprintf(stdout, "\n");;};
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s└ Word %s#%d:`" "\033[36m" "%s" "\033[0m" "` matched %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, ((WordConfig*)this->config)->word, Iterator_getLine(context->iterator), context->iterator->offset - config->length, context->iterator->offset, context->depth);fprintf(stdout, "\n");;};
   return success;
  } else {
-  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, " !  %s└ Word %s#%d:" "\033[36m" "`%s`" "\033[0m" " failed at %zu:%zu[→%d]", context->indent, this->name, this->id, ((WordConfig*)this->config)->word, context->iterator->lines, context->iterator->offset, context->depth);fprintf(stdout, "\n");;};
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, " !  %s└ Word %s#%d:" "\033[36m" "`%s`" "\033[0m" " failed at %zu:%zu[→%d]", context->indent, this->name, this->id, ((WordConfig*)this->config)->word, Iterator_getLine(context->iterator), context->iterator->offset, context->depth);fprintf(stdout, "\n");;};
   return ParsingContext_registerMatch(context, (Element*)this, FAILURE);
  }
 }
@@ -2145,12 +3880,164 @@ void Word_print(ParsingElement* this) {
  WordConfig* config = (WordConfig*)this->config;
  printf("Word:%c:%s#%d<%s>\n", this->type, this->name != NULL ? this->name : "unnamed", this->id, config->word);
 }
+char* Token__prefix(const char* expr, size_t* length, 
+                                                     _Bool
+                                                         * literal) {
+ *length = 0;
+ *literal = 0;
+
+
+ int depth = 0;
+ 
+_Bool 
+     in_class = 0;
+ for (const char* c = expr ; *c != '\0' ; c++) {
+  if (*c == '\\') {
+   if (c[1] == 'Q' || c[1] == '\0') {return NULL;}
+   c++;
+  } else if (in_class) {
+   if (*c == ']') {in_class = 0;}
+  } else if (*c == '[') {
+   in_class = 1;
+
+   if (c[1] == '^') {c++;}
+   if (c[1] == ']') {c++;}
+  } else if (*c == '(') {
+   depth++;
+  } else if (*c == ')') {
+   depth--;
+  } else if (*c == '|' && depth == 0) {
+   return NULL;
+  }
+ }
+ char* prefix = NULL;
+ size_t n = 0;
+ const char* c = expr;
+ while (*c != '\0') {
+  const char* next = c;
+  if (*c == '\\') {
+
+   if (c[1] == '\0' || (unsigned char)c[1] >= 128 || strchr("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~", c[1]) == NULL) {break;}
+   next = c + 2;
+  } else if (strchr(".[]()*+?{}|^$", *c) != NULL) {
+   break;
+  } else {
+
+
+   next = c + 1;
+   if ((unsigned char)*c >= 0xC0) {
+    while (((unsigned char)*next & 0xC0) == 0x80) {next++;}
+   }
+  }
+
+
+  if (*next == '*' || *next == '?' || *next == '{') {break;}
+  if (prefix == NULL) {
+   char* buffer = (char*) gc_calloc(strlen(expr) + 1, sizeof(char)) ; assert (buffer!=NULL); ;
+   prefix = buffer;
+  }
+  if (*c == '\\') {
+   prefix[n++] = c[1];
+  } else {
+   while (c < next) {prefix[n++] = *c++;}
+  }
+  if (*next == '+') {break;}
+  c = next;
+ }
+ if (n == 0) {if (prefix!=NULL) {; gc_free(prefix); } ; return NULL;}
+ prefix[n] = '\0';
+ *length = n;
+ *literal = *c == '\0';
+ return prefix;
+}
+
+
+
+const char* Token__classByte(const char* c, FirstSet* set, unsigned char* byte) {
+ if (*c == '\\') {
+  switch (c[1]) {
+   case 't': *byte = '\t'; break;
+   case 'n': *byte = '\n'; break;
+   case 'r': *byte = '\r'; break;
+   case 'f': *byte = '\f'; break;
+   case 'v': *byte = '\v'; break;
+   default:
+    if (c[1] == '\0' || (unsigned char)c[1] >= 128 || strchr("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~", c[1]) == NULL) {return NULL;}
+    *byte = (unsigned char)c[1];
+  }
+  (set)->bytes[((unsigned char)(*byte)) >> 3] |= (1 << (((unsigned char)(*byte)) & 7));
+  return c + 2;
+ } else if (*c == '\0' || (unsigned char)*c >= 128) {
+  return NULL;
+ } else {
+  *byte = (unsigned char)*c;
+  (set)->bytes[((unsigned char)(*byte)) >> 3] |= (1 << (((unsigned char)(*byte)) & 7));
+  return c + 1;
+ }
+}
+
+
+
+
+const char* Token__class(const char* expr, FirstSet* set) {
+ const char* c = expr;
+ unsigned char byte = 0;
+ if (c[0] == '\\' && c[1] == 's') {
+
+  const char* spaces = " \t\n\v\f\r";
+  for (int i=0 ; spaces[i] != '\0' ; i++) {(set)->bytes[((unsigned char)(spaces[i])) >> 3] |= (1 << (((unsigned char)(spaces[i])) & 7));}
+  c += 2;
+ } else if (c[0] == '[' && c[1] != '^' && c[1] != ']') {
+  c++;
+  while (c != NULL && *c != ']') {
+   if (*c == '[' || (c[0] == '\\' && c[1] == 's')) {
+
+    c = NULL;
+   } else if ((c = Token__classByte(c, set, &byte)) != NULL && c[0] == '-' && c[1] != ']') {
+
+    unsigned char start = byte;
+    if ((c = Token__classByte(c + 1, set, &byte)) != NULL && byte >= start) {
+     for (int i=start ; i<=byte ; i++) {(set)->bytes[((unsigned char)(i)) >> 3] |= (1 << (((unsigned char)(i)) & 7));}
+    } else {
+     c = NULL;
+    }
+   }
+  }
+  if (c != NULL) {c++;}
+ } else if (c[0] != '\0' && strchr(".[]()*+?{}|^$", c[0]) == NULL) {
+  c = Token__classByte(c, set, &byte);
+ } else {
+  c = NULL;
+ }
+ return c;
+}
+
+
 
 
 
 
+FirstSet* Token__repeats(const char* expr) {
+ FirstSet* set = (FirstSet*) gc_new(sizeof(FirstSet)); assert (set!=NULL); ;
+ memset(set, 0, sizeof(FirstSet));
+ 
+_Bool 
+            captured = expr[0] == '(' && expr[1] != '?';
+ const char* c = Token__class(captured ? expr + 1 : expr, set);
 
 
+ if (c != NULL && (*c == '+' || *c == '*')) {
+  c += c[1] == '+' ? 2 : 1;
+  if (captured) {c = *c == ')' ? c + 1 : NULL;}
+ } else {
+  c = NULL;
+ }
+ if (c == NULL || *c != '\0') {
+  if (set!=NULL) {; gc_free(set); } ;
+  return NULL;
+ }
+ return set;
+}
 
 ParsingElement* Token_new(const char* expr) {
  TokenConfig* config = (TokenConfig*) gc_new(sizeof(TokenConfig)); assert (config!=NULL); ;
@@ -2162,25 +4049,64 @@ ParsingElement* Token_new(const char* expr) {
 
 
  config->expr = gc_strdup(expr) ; assert (config->expr!=NULL); ;
+ config->prefix = Token__prefix(config->expr, &config->prefixLength, &config->literal);
+ config->repeats = Token__repeats(config->expr);
+
 
+ memset(config->first.bytes, 0xFF, sizeof(config->first.bytes));
+ config->first.nullable = 1;
  const char* pcre_error;
  int pcre_error_offset = -1;
  config->regexp = pcre_compile(config->expr, PCRE_UTF8, &pcre_error, &pcre_error_offset, NULL);
  if (pcre_error != NULL) {
   fprintf(stderr, "ERR ");fprintf(stderr, "Token: cannot compile regular expression `%s` at %d: %s", config->expr, pcre_error_offset, pcre_error);fprintf(stderr, "\n");;
+  if (config->prefix!=NULL) {; gc_free(config->prefix); } ;
+  if (config->repeats!=NULL) {; gc_free(config->repeats); } ;
+  if (config->expr!=NULL) {; gc_free(config->expr); } ;
   if (config!=NULL) {; gc_free(config); } ;
   if (this!=NULL) {; gc_free(this); } ;
   return NULL;
  }
 
- config->extra = pcre_study(config->regexp, PCRE_STUDY_JIT_COMPILE, &pcre_error);
+ config->extra = pcre_study(config->regexp, PCRE_STUDY_JIT_COMPILE | PCRE_STUDY_JIT_PARTIAL_HARD_COMPILE, &pcre_error);
  if (pcre_error != NULL) {
   fprintf(stderr, "ERR ");fprintf(stderr, "Token: cannot optimize regular expression `%s` at %d: %s", config->expr, pcre_error_offset, pcre_error);fprintf(stderr, "\n");;
+  if (config->prefix!=NULL) {; gc_free(config->prefix); } ;
+  if (config->repeats!=NULL) {; gc_free(config->repeats); } ;
+  if (config->expr!=NULL) {; gc_free(config->expr); } ;
   if (config!=NULL) {; gc_free(config); } ;
   if (this!=NULL) {; gc_free(this); } ;
   return NULL;
  }
+ const unsigned char* table = NULL;
+ int minlength = -1;
+ int flags = 0;
+ int first = -1;
+ pcre_fullinfo(config->regexp, config->extra, PCRE_INFO_MINLENGTH, &minlength);
+ if (pcre_fullinfo(config->regexp, config->extra, PCRE_INFO_FIRSTTABLE, &table) == 0 && table != NULL) {
+
+
+  memcpy(config->first.bytes, table, sizeof(config->first.bytes));
+  config->first.nullable = 0;
+ } else if (pcre_fullinfo(config->regexp, config->extra, PCRE_INFO_FIRSTCHARACTERFLAGS, &flags) == 0 && flags == 1
+ && pcre_fullinfo(config->regexp, config->extra, PCRE_INFO_FIRSTCHARACTER, &first) == 0 && first >= 0 && first < 128) {
+
+
+  memset(config->first.bytes, 0, sizeof(config->first.bytes));
+  (&config->first)->bytes[((unsigned char)(first)) >> 3] |= (1 << (((unsigned char)(first)) & 7));
+  if (first >= 'a' && first <= 'z') {(&config->first)->bytes[((unsigned char)(first - 'a' + 'A')) >> 3] |= (1 << (((unsigned char)(first - 'a' + 'A')) & 7));}
+  if (first >= 'A' && first <= 'Z') {(&config->first)->bytes[((unsigned char)(first - 'A' + 'a')) >> 3] |= (1 << (((unsigned char)(first - 'A' + 'a')) & 7));}
+  config->first.nullable = 0;
+ }
+ if (minlength > 0) {config->first.nullable = 0;}
+
 
+
+ if (config->prefix != NULL) {
+  memset(config->first.bytes, 0, sizeof(config->first.bytes));
+  (&config->first)->bytes[((unsigned char)((unsigned char)config->prefix[0])) >> 3] |= (1 << (((unsigned char)((unsigned char)config->prefix[0])) & 7));
+  config->first.nullable = 0;
+ }
  this->config = config;
  assert(strcmp(config->expr, expr) == 0);
  assert(strcmp(Token_expr(this), expr) == 0);
@@ -2193,9 +4119,13 @@ void Token_free(ParsingElement* this) {
  if (config != NULL) {
 
 
+
+
   if (config->regexp != NULL) {pcre_free(config->regexp);}
   if (config->extra != NULL) {pcre_free_study(config->extra);}
 
+  if (config->prefix!=NULL) {; gc_free(config->prefix); } ;
+  if (config->repeats!=NULL) {; gc_free(config->repeats); } ;
   if (config->expr!=NULL) {; gc_free(config->expr); } ;
   if (config!=NULL) {; gc_free(config); } ;
  }
@@ -2207,23 +4137,89 @@ const char* Token_expr(ParsingElement* this) {
  return ((TokenConfig*)this->config)->expr;
 }
 
+
+
+
+
+void TokenMatch__own(Match* match, Arena* arena) {
+ TokenMatch* m = (TokenMatch*)match->data;
+ const char** groups = NULL;
+ if (arena != NULL) {
+  groups = (const char**)Arena_alloc(arena, sizeof(const char*) * m->count);
+ } else {
+  const char** heap_groups = (const char**) gc_calloc(m->count, sizeof(const char*)) ; assert (heap_groups!=NULL); ;
+  groups = heap_groups;
+ }
+ for (int j=0 ; j<m->count ; j++) {
+  size_t length = m->spans[j].length;
+  char* group = NULL;
+  if (arena != NULL) {
+   group = (char*)Arena_alloc(arena, length + 1);
+  } else {
+   char* heap_group = (char*) gc_calloc(length + 1, sizeof(char)) ; assert (heap_group!=NULL); ;
+   group = heap_group;
+  }
+  memcpy(group, m->owned ? m->groups[j] : TokenMatch_groupStart(match, j), length);
+  group[length] = '\0';
+  groups[j] = group;
+ }
+ m->groups = groups;
+ m->owned = 1;
+}
+void Token__reach(TokenConfig* config, ParsingContext* context, size_t offset, 
+                                                                              _Bool 
+                                                                                   hard, 
+                                                                                         _Bool 
+                                                                                              partial) {
+ if (context->memo == NULL) {return;}
+ size_t end = Iterator_bufferOffset(context->iterator) + context->iterator->available;
+ if (partial) {
+  ParsingContext__reach(context, end + 1);
+ } else if (config->literal) {
+  ParsingContext__reach(context, offset + config->prefixLength);
+ } else if (config->repeats == NULL) {
+  ParsingContext__reach(context, hard ? end : end + 1);
+ }
+}
+
+
+
+
+
+
+_Bool 
+    Token__needsPartial(ParsingContext* context) {
+ PushInput* push = Iterator__pushInput(context->iterator);
+ return push != NULL && !push->ended;
+}
+
 Match* Token_recognize(ParsingElement* this, ParsingContext* context) {
  assert(this->config);
  if(this->config == NULL) {return FAILURE;}
- Match* result = NULL;
 
+ if (ParsingContext_rejects(context, this->id)) {return ParsingContext_registerMatch(context, (Element*)this, FAILURE);}
  TokenConfig* config = (TokenConfig*)this->config;
+ size_t offset = context->iterator->offset;
 
+ if (config->prefixLength > 0 && (Iterator_remaining(context->iterator) < config->prefixLength || memcmp(context->iterator->current, config->prefix, config->prefixLength) != 0)) {
+  if (context->memo != NULL) {ParsingContext__reach(context, offset + config->prefixLength);}
+  return ParsingContext_registerMatch(context, (Element*)this, FAILURE);
+ }
+ Match* result = NULL;
  int vector_length = 30;
  int vector[vector_length];
  const char* line = (const char*)context->iterator->current;
+ 
+_Bool 
+            hard = Token__needsPartial(context);
 
  int r = pcre_exec(
   config->regexp, config->extra,
   line,
-  context->iterator->available,
+  Iterator_remaining(context->iterator),
   0,
     PCRE_ANCHORED
+  | (hard ? PCRE_PARTIAL_HARD : 0)
   | PCRE_NO_UTF8_CHECK
   | PCRE_NO_UTF16_CHECK
   | PCRE_NO_UTF32_CHECK,
@@ -2233,6 +4229,7 @@ Match* Token_recognize(ParsingElement* this, ParsingContext* context) {
 
   switch(r) {
    case PCRE_ERROR_NOMATCH : result = FAILURE; break;
+   case PCRE_ERROR_PARTIAL : result = FAILURE; break;
    case PCRE_ERROR_NULL : fprintf(stderr, "ERR ");fprintf(stderr, "Token:%s Something was null", config->expr);fprintf(stderr, "\n");; break;
    case PCRE_ERROR_BADOPTION : fprintf(stderr, "ERR ");fprintf(stderr, "Token:%s A bad option was passed", config->expr);fprintf(stderr, "\n");; break;
    case PCRE_ERROR_BADMAGIC : fprintf(stderr, "ERR ");fprintf(stderr, "Token:%s Magic number bad (compiled re corrupt?)", config->expr);fprintf(stderr, "\n");; break;
@@ -2240,7 +4237,7 @@ Match* Token_recognize(ParsingElement* this, ParsingContext* context) {
    case PCRE_ERROR_NOMEMORY : fprintf(stderr, "ERR ");fprintf(stderr, "Token:%s Ran out of memory", config->expr);fprintf(stderr, "\n");; break;
    default : fprintf(stderr, "ERR ");fprintf(stderr, "Token:%s Unknown error", config->expr);fprintf(stderr, "\n");; break;
   };
-  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "    %s└✘Token " "\033[1m\033[31m" "%s" "\033[0m" "#%d:`" "\033[36m" "%s" "\033[0m" "` failed at %zu:%zu", context->indent, this->name, this->id, config->expr, context->iterator->lines, context->iterator->offset);fprintf(stdout, "\n");;};
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "    %s└✘Token " "\033[1m\033[31m" "%s" "\033[0m" "#%d:`" "\033[36m" "%s" "\033[0m" "` failed at %zu:%zu", context->indent, this->name, this->id, config->expr, Iterator_getLine(context->iterator), context->iterator->offset);fprintf(stdout, "\n");;};
  } else {
   if(r == 0) {
    fprintf(stderr, "ERR ");fprintf(stderr, "Token: %s many substrings matched\n", config->expr);fprintf(stderr, "\n");;
@@ -2253,33 +4250,67 @@ Match* Token_recognize(ParsingElement* this, ParsingContext* context) {
   }
 
   result = Match_Success(vector[1], this, context);
-  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s└ Token " "\033[1m\033[32m" "%s" "\033[0m" "#%d:" "\033[36m" "`%s`" "\033[0m" " matched " "\033[1m\033[32m" "%zu:%zu-%zu" "\033[0m", context->indent, this->name, this->id, config->expr, context->iterator->lines, context->iterator->offset, context->iterator->offset + result->length);fprintf(stdout, "\n");;};
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s└ Token " "\033[1m\033[32m" "%s" "\033[0m" "#%d:" "\033[36m" "`%s`" "\033[0m" " matched " "\033[1m\033[32m" "%zu:%zu-%zu" "\033[0m", context->indent, this->name, this->id, config->expr, Iterator_getLine(context->iterator), context->iterator->offset, context->iterator->offset + result->length);fprintf(stdout, "\n");;};
 
 
-  TokenMatch* data = (TokenMatch*) gc_new(sizeof(TokenMatch)); assert (data!=NULL); ;
-  data->count = r;
-  const char** groups = (const char**) gc_calloc(r, sizeof(const char*)) ; assert (groups!=NULL); ;
-  data->groups = groups;
-
 
 
+  TokenMatch* data = (TokenMatch*)Arena_alloc(context->arena, sizeof(TokenMatch));
+  data->count = r;
+  data->spans = (TokenMatchGroup*)Arena_alloc(context->arena, sizeof(TokenMatchGroup) * r);
+  data->groups = NULL;
+  data->context = context;
+  data->owned = 0;
   for (int j=0 ; j<r ; j++) {
-   const char* substring;
-
 
-   pcre_get_substring(line, vector, r, j, &(substring));
-   data->groups[j] = substring;
+   
+  _Bool 
+       matched = vector[j * 2] >= 0;
+   data->spans[j].offset = context->iterator->offset + (matched ? vector[j * 2] : 0);
+   data->spans[j].length = matched ? vector[j * 2 + 1] - vector[j * 2] : 0;
   }
   result->data = data;
+
+
+
+  if (context->iterator->window > 0) {TokenMatch__own(result, context->arena);}
   context->iterator->move(context->iterator,result->length);
   assert (result->data != NULL);
   assert(Match_isSuccess(result));
  }
+ Token__reach(config, context, offset, hard, r == PCRE_ERROR_PARTIAL);
 
  return ParsingContext_registerMatch(context, (Element*)this, result);
 }
 
-const char* TokenMatch_group(Match* match, int index) {
+const char* TokenMatch_groupStart(Match* match, int index) {
+ assert (match != NULL);
+ assert (match->data != NULL);
+ assert (Match_getElementType(match) == 'T');
+ TokenMatch* m = (TokenMatch*)match->data;
+ assert (index >= 0);
+ assert (index < m->count);
+
+
+ if (m->owned) {return m->groups[index];}
+
+
+ Iterator* iterator = m->context->iterator;
+ size_t base = Iterator_bufferOffset(iterator);
+ assert (m->spans[index].offset >= base);
+ return iterator->buffer + (m->spans[index].offset - base);
+}
+
+int TokenMatch_groupLength(Match* match, int index) {
+ assert (match != NULL);
+ assert (match->data != NULL);
+ TokenMatch* m = (TokenMatch*)match->data;
+ assert (index >= 0);
+ assert (index < m->count);
+ return (int)m->spans[index].length;
+}
+
+const char* TokenMatch_group(Match* match, int index) {
  assert (match != NULL);
  assert (match->data != NULL);
  assert (Match_getElementType(match) == 'T');
@@ -2287,6 +4318,21 @@ const char* TokenMatch_group(Match* match, int index) {
  if (m) {
   assert (index >= 0);
   assert (index < m->count);
+
+
+  ParsingContext* context = m->context;
+  if (context->strings == NULL) {context->strings = Arena_new();}
+  if (m->groups == NULL) {
+   m->groups = (const char**)Arena_alloc(context->strings, sizeof(const char*) * m->count);
+   for (int j=0 ; j<m->count ; j++) {m->groups[j] = NULL;}
+  }
+  if (m->groups[index] == NULL) {
+   size_t length = m->spans[index].length;
+   char* group = (char*)Arena_alloc(context->strings, length + 1);
+   memcpy(group, TokenMatch_groupStart(match, index), length);
+   group[length] = '\0';
+   m->groups[index] = group;
+  }
   return m->groups[index];
  } else {
   return NULL;
@@ -2306,6 +4352,42 @@ int TokenMatch_count(Match* match) {
  }
 }
 
+TokenMatch* TokenMatch_copy(Match* match, Arena* arena) {
+ assert (match != NULL);
+ assert (match->data != NULL);
+ TokenMatch* m = (TokenMatch*)match->data;
+ TokenMatch* data = NULL;
+ TokenMatchGroup* spans = NULL;
+ if (arena != NULL) {
+  data = (TokenMatch*)Arena_alloc(arena, sizeof(TokenMatch));
+  spans = (TokenMatchGroup*)Arena_alloc(arena, sizeof(TokenMatchGroup) * m->count);
+ } else {
+  TokenMatch* heap_data = (TokenMatch*) gc_new(sizeof(TokenMatch)); assert (heap_data!=NULL); ;
+  TokenMatchGroup* heap_spans = (TokenMatchGroup*) gc_calloc(m->count, sizeof(TokenMatchGroup)) ; assert (heap_spans!=NULL); ;
+  data = heap_data;
+  spans = heap_spans;
+ }
+ memcpy(spans, m->spans, sizeof(TokenMatchGroup) * m->count);
+ data->count = m->count;
+ data->spans = spans;
+
+
+ data->groups = m->groups;
+ data->context = m->context;
+ data->owned = m->owned;
+ if (m->owned) {
+  Match copy = *match;
+  copy.data = data;
+  TokenMatch__own(&copy, arena);
+ }
+ return data;
+}
+
+void Token__first(ParsingElement* this, FirstSet* set) {
+
+ *set = ((TokenConfig*)this->config)->first;
+}
+
 void Token_print(ParsingElement* this) {
  TokenConfig* config = (TokenConfig*)this->config;
  printf("Token:%c:%s#%d<%s>\n", this->type, this->name != NULL ? this->name : "unnamed", this->id, config->expr);
@@ -2316,17 +4398,14 @@ void TokenMatch_free(Match* match) {
  assert (match != NULL);
  assert (Match_getElementType(match) == 'T');
 
+
  ;;
  if (match->data != NULL) {
   TokenMatch* m = (TokenMatch*)match->data;
-  if (m != NULL ) {
-   for (int j=0 ; j<m->count ; j++) {
-    pcre_free_substring(m->groups[j]);
-   }
-  }
-  if (m->groups!=NULL) {; gc_free(m->groups); } ;
+  for (int j=0 ; m->owned && j<m->count ; j++) {if ((char*)m->groups[j]!=NULL) {; gc_free((char*)m->groups[j]); } ;}
+  if (m->owned) {if (m->groups!=NULL) {; gc_free(m->groups); } ;}
+  if (m->spans!=NULL) {; gc_free(m->spans); } ;
  }
-
  if (match->data!=NULL) {; gc_free(match->data); } ;
 
 }
@@ -2337,6 +4416,15 @@ void TokenMatch_free(Match* match) {
 
 
 
+WordSet* Group__wordSets(ParsingElement* this, ParsingContext* context) {
+ Grammar* g = context->grammar;
+ if (g == NULL || g->wordSets == NULL || this->id < 0 || this->id >= g->wordSetsCount) {return NULL;}
+
+
+ if (g->skip != NULL && !(context->flags & 0x1) && !ParsingContext_rejects(context, g->skip->id)) {return NULL;}
+ return g->wordSets[this->id];
+}
+
 ParsingElement* Group_new(Reference* children[]) {
  ParsingElement* this = ParsingElement_new(children);
  this->type = 'G';
@@ -2347,20 +4435,40 @@ ParsingElement* Group_new(Reference* children[]) {
 Match* Group_recognize(ParsingElement* this, ParsingContext* context){
 
 
- if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "??? %s┌── Group " "\033[1m\033[33m" "%s" "\033[0m" ":#%d at %zu:%zu[→%d]", context->indent, this->name, this->id, context->iterator->lines, context->iterator->offset, context->depth);fprintf(stdout, "\n");;};
+ if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "??? %s┌── Group " "\033[1m\033[33m" "%s" "\033[0m" ":#%d at %zu:%zu[→%d]", context->indent, this->name, this->id, Iterator_getLine(context->iterator), context->iterator->offset, context->depth);fprintf(stdout, "\n");;};
  Match* result = NULL;
  size_t offset = context->iterator->offset;
- size_t lines = context->iterator->lines;
+ ArenaMark mark = Arena_mark(context->arena);
  int step = 0;
 
 
  size_t iteration_offset = context->iterator->offset;
  Reference* child = this->children;
  Match* match = NULL;
+ WordSet* words = Group__wordSets(this, context);
+ size_t cuts = context->cuts;
  step = 0;
 
  while (child != NULL ) {
   assert (match == NULL);
+
+
+  if (words != NULL && words->start == step) {
+   int i = WordSet_match(words, context->iterator->current, Iterator_remaining(context->iterator));
+   if (context->memo != NULL) {ParsingContext__reach(context, offset + words->longest);}
+   child = i >= 0 ? words->words[i] : words->words[words->count - 1]->next;
+   step += i >= 0 ? i : words->count;
+   words = words->next;
+   if (child == NULL) {break;}
+   if (i < 0) {continue;}
+  }
+
+
+  if (ParsingContext_rejects(context, child->id)) {
+   child = child->next;
+   step += 1;
+   continue;
+  }
   match = Reference_recognize(child, context);
 
   if (Match_isSuccess(match)) {
@@ -2369,31 +4477,124 @@ Match* Group_recognize(ParsingElement* this, ParsingContext* context){
    result = Match_Success(match->length, this, context);
    result->offset = iteration_offset;
    result->children = match;
+   match->parent = result;
    child = NULL;
   } else {
 
+
    match = Match_free(match);
-   child = child->next;
+   Arena_rewind(context->arena, mark);
+   child = context->cuts == cuts ? child->next : NULL;
    step += 1;
   }
  }
 
 
  if (Match_isSuccess(result)) {
-  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s╘═⇒ Group " "\033[1m\033[32m" "%s" "\033[0m" "#%d[%d] matched" "\033[1m\033[32m" "%zu:%zu-%zu" "\033[0m" "[%zu][→%d]", context->indent, this->name, this->id, step, context->iterator->lines, result->offset, context->iterator->offset, result->length, context->depth);fprintf(stdout, "\n");;}
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s╘═⇒ Group " "\033[1m\033[32m" "%s" "\033[0m" "#%d[%d] matched" "\033[1m\033[32m" "%zu:%zu-%zu" "\033[0m" "[%zu][→%d]", context->indent, this->name, this->id, step, Iterator_getLine(context->iterator), result->offset, context->iterator->offset, result->length, context->depth);fprintf(stdout, "\n");;}
   return ParsingContext_registerMatch(context, (Element*)this, result);
  } else {
 
-  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, " !  %s╘═⇒ Group " "\033[1m\033[31m" "%s" "\033[0m" "#%d[%d] failed at %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, step, context->iterator->lines, context->iterator->offset, offset, context->depth);fprintf(stdout, "\n");;}
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, " !  %s╘═⇒ Group " "\033[1m\033[31m" "%s" "\033[0m" "#%d[%d] failed at %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, step, Iterator_getLine(context->iterator), context->iterator->offset, offset, context->depth);fprintf(stdout, "\n");;}
   result = Match_fail(result);
-  if (context->iterator->offset != offset ) {
-   Iterator_backtrack(context->iterator, offset, lines);
-   assert( context->iterator->offset == offset );
-  }
+  Arena_rewind(context->arena, mark);
+  ParsingContext_backtrack(context, offset);
+  assert( context->iterator->offset == (offset > context->cut ? offset : context->cut) || context->iterator->truncated );
   return ParsingContext_registerMatch(context, (Element*)this, FAILURE);
  }
 
 }
+WordSet* WordSet_new(int start) {
+ WordSet* this = (WordSet*) gc_new(sizeof(WordSet)); assert (this!=NULL); ;
+ this->start = start;
+ this->count = 0;
+ this->words = NULL;
+ this->nodes = NULL;
+ this->nodesCount = 0;
+ this->nodesCapacity = 0;
+ this->longest = 0;
+ this->next = NULL;
+ for (int i=0 ; i<256 ; i++) {this->root[i] = -1;}
+ return this;
+}
+
+void WordSet_free(WordSet* this) {
+ while (this != NULL) {
+  WordSet* next = this->next;
+  if (this->words!=NULL) {; gc_free(this->words); } ;
+  if (this->nodes!=NULL) {; gc_free(this->nodes); } ;
+  if (this!=NULL) {; gc_free(this); } ;
+  this = next;
+ }
+}
+
+int WordSet__node(WordSet* this, unsigned char byte) {
+ if (this->nodesCount == this->nodesCapacity) {
+  this->nodesCapacity = this->nodesCapacity == 0 ? 16 : this->nodesCapacity * 2;
+  this->nodes=gc_realloc(this->nodes,this->nodesCapacity * sizeof(WordSetNode)); ;
+ }
+ WordSetNode* node = &this->nodes[this->nodesCount];
+ node->byte = byte;
+ node->word = -1;
+ node->child = -1;
+ node->sibling = -1;
+ return this->nodesCount++;
+}
+
+void WordSet_add(WordSet* this, Reference* word) {
+ const unsigned char* text = (const unsigned char*)((WordConfig*)word->element->config)->word;
+
+ int count = this->count + 1;
+ this->words=gc_realloc(this->words,count * sizeof(Reference*)); ;
+ this->words[this->count] = word;
+ if (this->root[text[0]] < 0) {this->root[text[0]] = WordSet__node(this, text[0]);}
+ int node = this->root[text[0]];
+ for (const unsigned char* c = text + 1 ; *c != '\0' ; c++) {
+  int child = this->nodes[node].child;
+  int last = -1;
+  while (child >= 0 && this->nodes[child].byte != *c) {
+   last = child;
+   child = this->nodes[child].sibling;
+  }
+  if (child < 0) {
+
+   child = WordSet__node(this, *c);
+   if (last < 0) {this->nodes[node].child = child;} else {this->nodes[last].sibling = child;}
+  }
+  node = child;
+ }
+
+ if (this->nodes[node].word < 0) {this->nodes[node].word = this->count;}
+ this->longest = (this->longest > ((WordConfig*)word->element->config)->length ? this->longest : ((WordConfig*)word->element->config)->length);
+ this->count += 1;
+}
+
+int WordSet_match(WordSet* this, const char* text, size_t length) {
+ const unsigned char* c = (const unsigned char*)text;
+ const unsigned char* end = c + length;
+ int node = length > 0 ? this->root[*c] : -1;
+ int result = -1;
+
+
+ while (node >= 0) {
+  WordSetNode* n = &this->nodes[node];
+  if (n->word >= 0 && (result < 0 || n->word < result)) {
+   result = n->word;
+   if (result == 0) {break;}
+  }
+  c += 1;
+  node = c < end ? n->child : -1;
+  while (node >= 0 && this->nodes[node].byte != *c) {node = this->nodes[node].sibling;}
+ }
+ return result;
+}
+
+
+
+
+
+
+
 ParsingElement* Rule_new(Reference* children[]) {
  ParsingElement* this = ParsingElement_new(children);
  this->type = 'R';
@@ -2411,13 +4612,23 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
  int step = 0;
  const char* step_name = NULL;
  size_t offset = context->iterator->offset;
- size_t lines = context->iterator->lines;
+ ArenaMark mark = Arena_mark(context->arena);
  Reference* child = this->children;
 
- if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "??? %s┌── Rule:" "\033[1m\033[33m" "%s" "\033[0m" " at %zu:%zu[→%d]", context->indent, this->name, context->iterator->lines, context->iterator->offset, context->depth);fprintf(stdout, "\n");;};
+ if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "??? %s┌── Rule:" "\033[1m\033[33m" "%s" "\033[0m" " at %zu:%zu[→%d]", context->indent, this->name, Iterator_getLine(context->iterator), context->iterator->offset, context->depth);fprintf(stdout, "\n");;};
+
+
+ if (ParsingContext_rejects(context, this->id)) {
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, " !  %s╘ Rule " "\033[1m\033[31m" "%s" "\033[0m" "#%d rejected at %zu:%zu[→%d]", context->indent, this->name, this->id, Iterator_getLine(context->iterator), offset, context->depth);fprintf(stdout, "\n");;}
+  return ParsingContext_registerMatch(context, (Element*)this, FAILURE);
+ }
 
 
- ParsingContext_push(context);
+
+ 
+_Bool 
+     scoped = (this->flags & 0x04) || (context->flags & 0x2);
+ if (scoped) {ParsingContext_push(context);}
 
 
 
@@ -2431,6 +4642,8 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
 
 
 
+  size_t cuts = context->cuts;
+  if (child == context->commit) {ParsingContext__enclose(context, this, result, offset);}
   Match* match = Reference_recognize(child, context);
 
 
@@ -2439,7 +4652,7 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
 
 
    match = Match_free(match);
-   size_t skipped = ParsingElement_skip(this, context);
+   size_t skipped = context->cuts == cuts ? ParsingElement_skip(this, context) : 0;
 
 
 
@@ -2485,6 +4698,7 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
    assert(last->next == NULL);
    last = last->next = match;
   }
+  match->parent = result;
 
 
   step_name = child->name;
@@ -2495,24 +4709,24 @@ Match* Rule_recognize (ParsingElement* this, ParsingContext* context){
  }
 
 
- ParsingContext_pop(context);
+ if (scoped) {ParsingContext_pop(context);}
 
 
  if (Match_isSuccess(result)) {
-  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s╘═⇒ Rule " "\033[1m\033[32m" "%s" "\033[0m" "#%d[%d] matched " "\033[1m\033[32m" "%zu:%zu-%zu" "\033[0m" "[%zub][→%d]", context->indent, this->name, this->id, step, context->iterator->lines, offset, context->iterator->offset, result->length, context->depth);fprintf(stdout, "\n");;}
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s╘═⇒ Rule " "\033[1m\033[32m" "%s" "\033[0m" "#%d[%d] matched " "\033[1m\033[32m" "%zu:%zu-%zu" "\033[0m" "[%zub][→%d]", context->indent, this->name, this->id, step, Iterator_getLine(context->iterator), offset, context->iterator->offset, result->length, context->depth);fprintf(stdout, "\n");;}
 
 
 
   result->length = last->offset - result->offset + last->length;
  } else {
-  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, " !  %s╘ Rule " "\033[1m\033[31m" "%s" "\033[0m" "#%d failed on step %d=%s at %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, step, step_name == NULL ? "-" : step_name, context->iterator->lines, offset, context->iterator->offset, context->depth);fprintf(stdout, "\n");;}
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, " !  %s╘ Rule " "\033[1m\033[31m" "%s" "\033[0m" "#%d failed on step %d=%s at %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, step, step_name == NULL ? "-" : step_name, Iterator_getLine(context->iterator), offset, context->iterator->offset, context->depth);fprintf(stdout, "\n");;}
 
   result = Match_fail(result);
 
-  if (offset != context->iterator->offset) {
-   Iterator_backtrack(context->iterator, offset, lines);
-   assert( context->iterator->offset == offset );
-  }
+  Arena_rewind(context->arena, mark);
+
+  ParsingContext_backtrack(context, offset);
+  assert( context->iterator->offset == (offset > context->cut ? offset : context->cut) || context->iterator->truncated );
  }
 
  return ParsingContext_registerMatch(context, (Element*)this, result);
@@ -2561,8 +4775,8 @@ Match* Condition_recognize(ParsingElement* this, ParsingContext* context) {
  _Bool 
       value = ((ConditionCallback)this->config)(this, context);
   Match* result = value == 1 ? Match_Success(0, this, context) : FAILURE;
-  if(context->grammar->isVerbose && !(context->flags & 0x1) && Match_isSuccess(result)){fprintf(stdout, "[✓] %s└ Condition " "\033[1m\033[32m" "%s" "\033[0m" "#%d matched %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, context->iterator->lines, context->iterator->offset - result->length, context->iterator->offset, context->depth);fprintf(stdout, "\n");;}
-  if(context->grammar->isVerbose && !(context->flags & 0x1) && !Match_isSuccess(result)){fprintf(stdout, " !  %s└ Condition " "\033[1m\033[31m" "%s" "\033[0m" "#%d failed at %zu:%zu[→%d]", context->indent, this->name, this->id, context->iterator->lines, context->iterator->offset, context->depth);fprintf(stdout, "\n");;}
+  if(context->grammar->isVerbose && !(context->flags & 0x1) && Match_isSuccess(result)){fprintf(stdout, "[✓] %s└ Condition " "\033[1m\033[32m" "%s" "\033[0m" "#%d matched %zu:%zu-%zu[→%d]", context->indent, this->name, this->id, Iterator_getLine(context->iterator), context->iterator->offset - result->length, context->iterator->offset, context->depth);fprintf(stdout, "\n");;}
+  if(context->grammar->isVerbose && !(context->flags & 0x1) && !Match_isSuccess(result)){fprintf(stdout, " !  %s└ Condition " "\033[1m\033[31m" "%s" "\033[0m" "#%d failed at %zu:%zu[→%d]", context->indent, this->name, this->id, Iterator_getLine(context->iterator), context->iterator->offset, context->depth);fprintf(stdout, "\n");;}
   return ParsingContext_registerMatch(context, (Element*)this, result);
  } else {
   if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s└ Condition %s#%d matched by default at %zu", context->indent, this->name, this->id, context->iterator->offset);fprintf(stdout, "\n");;};
@@ -2578,108 +4792,300 @@ Match* Condition_recognize(ParsingElement* this, ParsingContext* context) {
 
 
 
-ParsingVariable* ParsingVariable_new(int depth, const char* key, void* value) {
- ParsingVariable* this = (ParsingVariable*) gc_new(sizeof(ParsingVariable)); assert (this!=NULL); ;
- this->depth = depth;
- this->key = gc_strdup(key) ; assert (this->key!=NULL); ;
- this->value = value;
- this->previous = NULL;
+ParsingElement* Cut_new(void) {
+ ParsingElement* this = ParsingElement_new(NULL);
+ this->type = '!';
+ this->recognize = Cut_recognize;
  return this;
 }
 
-void ParsingVariable_free(ParsingVariable* this) {
- if (this!=NULL) {
-  if (this->key!=NULL) {; gc_free(this->key); } ;
+Match* Cut_recognize(ParsingElement* this, ParsingContext* context) {
+
+
+ if (!(context->flags & 0x1)) {
+  size_t offset = context->iterator->offset;
+
+
+  context->cuts += 1;
+  context->cut = offset;
+  if (context->memo != NULL) {context->memo->floor = offset;}
+  Iterator_commit(context->iterator, offset);
+  if(context->grammar->isVerbose && !(context->flags & 0x1)){fprintf(stdout, "[✓] %s└ Cut " "\033[1m\033[32m" "%s" "\033[0m" "#%d committed at %zu:%zu", context->indent, this->name, this->id, Iterator_getLine(context->iterator), offset);fprintf(stdout, "\n");;}
+ }
+ return ParsingContext_registerMatch(context, (Element*)this, Match_Success(0, this, context));
+}
+
+
+
+
+
+
+
+ParsingVariables* ParsingVariables_new(void) {
+ ParsingVariables* this = (ParsingVariables*) gc_new(sizeof(ParsingVariables)); assert (this!=NULL); ;
+ ParsingVariable* items = (ParsingVariable*) gc_calloc(8, sizeof(ParsingVariable)) ; assert (items!=NULL); ;
+ char** keys = (char**) gc_calloc(8, sizeof(char*)) ; assert (keys!=NULL); ;
+ this->items = items;
+ this->count = 0;
+ this->capacity = 8;
+ this->keys = keys;
+ this->keysCount = 0;
+ this->keysCapacity = 8;
+ this->depth = 0;
+
+ ParsingVariables_key(this, "depth");
+ return this;
+}
+
+void ParsingVariables_free(ParsingVariables* this) {
+ if (this != NULL) {
+  for (int i=0 ; i<this->keysCount ; i++) {if (this->keys[i]!=NULL) {; gc_free(this->keys[i]); } ;}
+  if (this->keys!=NULL) {; gc_free(this->keys); } ;
+  if (this->items!=NULL) {; gc_free(this->items); } ;
   if (this!=NULL) {; gc_free(this); } ;
  }
 }
 
-void ParsingVariable_freeAll(ParsingVariable* this) {
- ParsingVariable* current = this;
- while (current!=NULL) {
-  ParsingVariable* to_free = current;
-  current = current->previous;
-  ParsingVariable_free(to_free);
+int ParsingVariables_key(ParsingVariables* this, const char* name) {
+ assert(name != NULL);
+
+ for (int i=0 ; i<this->keysCount ; i++) {
+  if (strcmp(this->keys[i], name) == 0) {return i;}
  }
+ if (this->keysCount == this->keysCapacity) {
+  this->keysCapacity *= 2;
+  this->keys=gc_realloc(this->keys,sizeof(char*) * this->keysCapacity); ;
+ }
+ this->keys[this->keysCount] = gc_strdup(name) ; assert (this->keys[this->keysCount]!=NULL); ;
+ return this->keysCount++;
+}
+
+const char* ParsingVariables_getName(ParsingVariables* this, int key) {
+ return (key >= 0 && key < this->keysCount) ? this->keys[key] : NULL;
 }
 
-int ParsingVariable_getDepth(ParsingVariable* this) {
- return this == NULL ? -1 : this->depth;
+void ParsingVariables_push(ParsingVariables* this) {
+ this->depth += 1;
 }
 
-const char* ParsingVariable_getName(ParsingVariable* this) {
- return (const char*)this->key;
+void ParsingVariables_pop(ParsingVariables* this) {
+ if (this->depth <= 0) {return;}
+
+ while (this->count > 0 && this->items[this->count - 1].depth >= this->depth) {
+  this->count--;
+ }
+ this->depth -= 1;
 }
 
-void* ParsingVariable_get(ParsingVariable* this, const char* name) {
- ParsingVariable* found = ParsingVariable_find(this, name, 0);
- return found != NULL ? found->value : NULL;
+void* ParsingVariables_get(ParsingVariables* this, int key) {
+ for (int i=this->count - 1 ; i>=0 ; i--) {
+  if (this->items[i].key == key) {return this->items[i].value;}
+ }
+
+ return key == 0 ? (void*)(long)this->depth : NULL;
 }
 
+void ParsingVariables_set(ParsingVariables* this, int key, void* value) {
 
-_Bool 
-    ParsingVariable_is(ParsingVariable* this, const char* key) {
- if (this == NULL || key == NULL) {return 0;}
- return (key == this->key || strcmp(this->key, key)) == 0 ? 1 : 0;
+ for (int i=this->count - 1 ; i>=0 && this->items[i].depth == this->depth ; i--) {
+  if (this->items[i].key == key) {this->items[i].value = value; return;}
+ }
+ if (this->count == this->capacity) {
+  this->capacity *= 2;
+  this->items=gc_realloc(this->items,sizeof(ParsingVariable) * this->capacity); ;
+ }
+ ParsingVariable* v = &(this->items[this->count++]);
+ v->depth = this->depth;
+ v->key = key;
+ v->value = value;
 }
 
-ParsingVariable* ParsingVariable_find(ParsingVariable* this, const char* key, 
-                                                                             _Bool 
-                                                                                  local) {
- ParsingVariable* current=this;
- while (current!=NULL) {
-  if (ParsingVariable_is(current, key)) {
-   return current;
-  }
-  if (current->previous!=NULL) {
+void ParsingVariables_clear(ParsingVariables* this) {
+ this->count = 0;
+ this->depth = 0;
+}
 
-   current = (local && current->previous->depth != current->depth) ? NULL : current->previous;
-  } else {
-   current = NULL;
+int ParsingVariables_count(ParsingVariables* this) {
+ return this->count;
+}
+size_t Memo__slot(Memo* this, int id, size_t offset) {
+
+
+ size_t h = (offset * 2654435761U) ^ ((size_t)id * 40503U);
+ return h & (this->capacity - 1);
+}
+
+void Memo__allocate(Memo* this, size_t capacity) {
+ MemoEntry* entries = (MemoEntry*) gc_calloc(capacity, sizeof(MemoEntry)) ; assert (entries!=NULL); ;
+ for (size_t i=0 ; i<capacity ; i++) {
+  entries[i].id = -10;
+  entries[i].match = NULL;
+ }
+ this->entries = entries;
+ this->capacity = capacity;
+ this->count = 0;
+}
+
+Memo* Memo_new(size_t limit) {
+ Memo* this = (Memo*) gc_new(sizeof(Memo)); assert (this!=NULL); ;
+ this->limit = limit;
+ this->floor = 0;
+ this->evicted = 0;
+ Memo__allocate(this, 1024);
+ this->bytes = sizeof(MemoEntry) * this->capacity;
+ return this;
+}
+
+void Memo_clear(Memo* this) {
+ if (this == NULL) {return;}
+ for (size_t i=0 ; i<this->capacity ; i++) {
+  MemoEntry* entry = &(this->entries[i]);
+  if (entry->id != -10) {
+   if (entry->match != FAILURE) {Match_free(entry->match);}
+   entry->id = -10;
+   entry->match = NULL;
   }
  }
- return current;
+ this->count = 0;
+ this->bytes = sizeof(MemoEntry) * this->capacity;
+ this->floor = 0;
+ this->evicted = 0;
 }
 
-ParsingVariable* ParsingVariable_set(ParsingVariable* this, const char* key, void* value) {
- ParsingVariable* found = ParsingVariable_find(this, key, 1);
- if (found == NULL) {
-  found = ParsingVariable_new( this->depth, key, value );
-  found->previous = this;
-  return found;
- } else {
-  found->value = value;
-  return found;
+void Memo_free(Memo* this) {
+ if (this != NULL) {
+  Memo_clear(this);
+  if (this->entries!=NULL) {; gc_free(this->entries); } ;
+ }
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+MemoEntry* Memo_get(Memo* this, int id, size_t offset) {
+
+
+ size_t mask = this->capacity - 1;
+ size_t i = Memo__slot(this, id, offset);
+ while (this->entries[i].id != -10) {
+  MemoEntry* entry = &(this->entries[i]);
+  if (entry->id == id && entry->offset == offset) {return entry;}
+  i = (i + 1) & mask;
  }
+ return NULL;
 }
 
-ParsingVariable* ParsingVariable_push(ParsingVariable* this) {
- int depth = this == NULL ? 0 : ParsingVariable_getDepth(this) + 1;
- ParsingVariable* res = ParsingVariable_new(depth, "depth", (void*)(long)depth);
- res->previous = this;
- return res;
+void Memo__insert(Memo* this, MemoEntry* entry) {
+ size_t mask = this->capacity - 1;
+ size_t i = Memo__slot(this, entry->id, entry->offset);
+ while (this->entries[i].id != -10) {i = (i + 1) & mask;}
+ this->entries[i] = *entry;
+ this->count += 1;
 }
 
-ParsingVariable* ParsingVariable_pop(ParsingVariable* this) {
- if (this == NULL) {return NULL;}
- ParsingVariable* current = this;
- int depth = this->depth;
- while (current != NULL && current->depth >= depth) {
-  ParsingVariable* to_free = current;
-  current = current->previous;
-  ParsingVariable_free(to_free);
+void Memo__grow(Memo* this) {
+ MemoEntry* entries = this->entries;
+ size_t capacity = this->capacity;
+ Memo__allocate(this, capacity * 2);
+ for (size_t i=0 ; i<capacity ; i++) {
+  if (entries[i].id != -10) {Memo__insert(this, &(entries[i]));}
  }
- return current;
+ this->bytes += sizeof(MemoEntry) * capacity;
+ if (entries!=NULL) {; gc_free(entries); } ;
 }
 
-int ParsingVariable_count(ParsingVariable* this) {
- ParsingVariable* current = this;
- int count = 0;
- while (current!=NULL) {
-  current = current->previous;
-  count++;
+void Memo_evict(Memo* this, size_t offset) {
+
+
+ MemoEntry* entries = this->entries;
+ size_t bytes = this->bytes;
+ Memo__allocate(this, this->capacity);
+ for (size_t i=0 ; i<this->capacity ; i++) {
+  if (entries[i].id == -10) {continue;}
+  if (entries[i].offset >= offset) {
+   Memo__insert(this, &(entries[i]));
+  } else {
+   if (entries[i].match != FAILURE) {Match_free(entries[i].match);}
+   bytes -= entries[i].bytes;
+  }
  }
- return count;
+ this->bytes = bytes;
+ this->evicted = offset;
+ if (entries!=NULL) {; gc_free(entries); } ;
+}
+
+void Memo_set(Memo* this, int id, size_t offset, size_t end, size_t reach, Match* match) {
+ assert(Memo_get(this, id, offset) == NULL);
+ MemoEntry entry;
+ entry.id = id;
+ entry.offset = offset;
+ entry.end = end;
+ entry.reach = reach;
+ entry.shift = 0;
+ entry.lines = 0;
+ entry.bytes = 0;
+ entry.match = Match_copy(match, NULL, &(entry.bytes));
+
+
+ 
+_Bool 
+     full = (this->count + 1) * 4 > this->capacity * 3 || this->bytes + entry.bytes > this->limit;
+ if (full && this->floor > this->evicted) {Memo_evict(this, this->floor);}
+
+
+ if ((this->count + 1) * 4 > this->capacity * 3) {
+  if (this->bytes + entry.bytes + sizeof(MemoEntry) * this->capacity > this->limit) {
+   Memo_clear(this);
+  } else {
+   Memo__grow(this);
+  }
+ }
+ if (this->bytes + entry.bytes > this->limit) {
+  Memo_clear(this);
+
+  if (this->bytes + entry.bytes > this->limit) {
+   if (entry.match != FAILURE) {Match_free(entry.match);}
+   return;
+  }
+ }
+ Memo__insert(this, &entry);
+ this->bytes += entry.bytes;
+}
+
+void Memo_reuse(Memo* this, Memo* from, size_t offset, size_t removed, size_t inserted, int lines) {
+ size_t end = offset + removed;
+ for (size_t i=0 ; i<from->capacity ; i++) {
+  MemoEntry entry = from->entries[i];
+  if (entry.id == -10) {continue;}
+  from->entries[i].id = -10;
+  from->entries[i].match = NULL;
+
+
+  
+ _Bool 
+      reused = entry.reach <= offset || entry.offset >= end;
+  if (reused && (this->count + 1) * 4 > this->capacity * 3) {
+   if (this->bytes + entry.bytes + sizeof(MemoEntry) * this->capacity > this->limit) {
+    reused = 0;
+   } else {
+    Memo__grow(this);
+   }
+  }
+  if (!reused || this->bytes + entry.bytes > this->limit) {
+   if (entry.match != FAILURE) {Match_free(entry.match);}
+   continue;
+  }
+
+  if (entry.offset >= end) {
+   entry.offset = entry.offset - removed + inserted;
+   entry.end = entry.end - removed + inserted;
+   entry.reach = entry.reach - removed + inserted;
+   entry.shift += (long)inserted - (long)removed;
+   entry.lines += lines;
+  }
+  Memo__insert(this, &entry);
+  this->bytes += entry.bytes;
+ }
+ from->count = 0;
+ from->bytes = sizeof(MemoEntry) * from->capacity;
 }
 
 
@@ -2691,29 +5097,89 @@ int ParsingVariable_count(ParsingVariable* this) {
 ParsingContext* ParsingContext_new( Grammar* g, Iterator* iterator ) {
  ParsingContext* this = (ParsingContext*) gc_new(sizeof(ParsingContext)); assert (this!=NULL); ;
  this->grammar = g;
- this->iterator = iterator;
+ this->iterator = NULL;
  this->stats = ParsingStats_new();
  this->freeIterator = 0;
- if (g != NULL) {
-  ParsingStats_setSymbolsCount(this->stats, g->axiomCount + g->skipCount);
+ this->variables = ParsingVariables_new();
+ this->memo = NULL;
+ this->arena = Arena_new();
+ this->strings = NULL;
+ this->next = NULL;
+ this->matchData = NULL;
+ this->engine = NULL;
+ ParsingContext_reset(this, iterator);
+ return this;
+}
+
+void ParsingContext_reset( ParsingContext* this, Iterator* iterator ) {
+ Grammar* g = this->grammar;
+ if (this->freeIterator && this->iterator != iterator) {Iterator_free(this->iterator);}
+ this->iterator = iterator;
+ this->freeIterator = 0;
+
+
+ size_t symbols = g != NULL ? (size_t)(g->axiomCount + g->skipCount + 1) : 0;
+ if (g != NULL && this->stats->symbolsCount != symbols) {
+  ParsingStats_setSymbolsCount(this->stats, symbols);
+ } else {
+  ParsingStats_reset(this->stats);
+ }
+ if (g == NULL || g->memoLimit == 0) {
+  Memo_free(this->memo);
+  this->memo = NULL;
+ } else if (this->memo == NULL) {
+  this->memo = Memo_new(g->memoLimit);
+ } else {
+  if (this->memo->count > 0) {Memo_clear(this->memo);}
+  this->memo->limit = g->memoLimit;
  }
+ ParsingVariables_clear(this->variables);
+ Arena_reset(this->arena);
+ Arena_reset(this->strings);
  this->depth = 0;
- this->variables = ParsingVariable_new(0, "depth", 0);
  this->callback = NULL;
  this->indent = INDENT + (40 * 2);
  this->flags = 0;
  this->lastMatchOffset = 0;
  this->lastMatchLength = 0;
  this->lastMatchElementID = -1;
- return this;
+ this->reach = 0;
+ this->processor = NULL;
+ this->listener = NULL;
+ this->commit = NULL;
+ this->enclosing = NULL;
+ this->opened = 0;
+ this->skipOffset = SIZE_MAX;
+ this->skipEnd = 0;
+ this->skipReach = 0;
+ this->cuts = 0;
+ this->cut = 0;
+ this->budget = g != NULL ? g->budget : 0;
+ this->exceeded = 0;
+ this->profiler = NULL;
+ this->tooDeep = 0;
+
+
+
+ if (g != NULL && (g->isVerbose || (g->skip != NULL && (g->skip->flags & 0x04)))) {
+  this->flags=this->flags|0x2;;
+ }
 }
 
 void ParsingContext_free( ParsingContext* this ) {
 
  if (this!=NULL) {
   if (this->freeIterator) {Iterator_free(this->iterator);}
-  ParsingVariable_freeAll(this->variables);
+  ParsingVariables_free(this->variables);
   ParsingStats_free(this->stats);
+  Memo_free(this->memo);
+  Arena_free(this->arena);
+  Arena_free(this->strings);
+  Engine_free(this->engine);
+
+
+
+  ParsingContext_free(this->next);
   if (this!=NULL) {; gc_free(this); } ;
  }
 }
@@ -2728,7 +5194,7 @@ char ParsingContext_charAt ( ParsingContext* this, size_t offset ) {
 
 
 void ParsingContext_push ( ParsingContext* this ) {
- this->variables = ParsingVariable_push(this->variables);
+ ParsingVariables_push(this->variables);
  if (this->callback != NULL) {this->callback(this, '+');}
  this->depth += 1;
  if (this->depth >= 0) {
@@ -2739,7 +5205,7 @@ void ParsingContext_push ( ParsingContext* this ) {
 
 void ParsingContext_pop ( ParsingContext* this ) {
  if (this->callback != NULL) {this->callback(this, '-');}
- this->variables = ParsingVariable_pop(this->variables);
+ ParsingVariables_pop(this->variables);
  this->depth -= 1;
  if (this->depth <= 0) {
   this->indent = INDENT + 40 * 2;
@@ -2750,37 +5216,85 @@ void ParsingContext_pop ( ParsingContext* this ) {
 }
 
 void* ParsingContext_get(ParsingContext* this, const char* name) {
- return ParsingVariable_get(this->variables, name);
+ return ParsingVariables_get(this->variables, ParsingVariables_key(this->variables, name));
 }
 
 int ParsingContext_getInt(ParsingContext* this, const char* name) {
- return (int)(long)(ParsingVariable_get(this->variables, name));
+ return (int)(long)(ParsingContext_get(this, name));
 }
 
 void ParsingContext_set(ParsingContext* this, const char* name, void* value) {
- this->variables = ParsingVariable_set(this->variables, name, value);
+ ParsingVariables_set(this->variables, ParsingVariables_key(this->variables, name), value);
 }
 
 void ParsingContext_setInt(ParsingContext* this, const char* name, int value) {
- this->variables = ParsingVariable_set(this->variables, name, (void*)(long)value);
+ ParsingContext_set(this, name, (void*)(long)value);
+}
+
+int ParsingContext_key(ParsingContext* this, const char* name) {
+ return ParsingVariables_key(this->variables, name);
+}
+
+void* ParsingContext_getVariable(ParsingContext* this, int key) {
+ return ParsingVariables_get(this->variables, key);
+}
+
+void ParsingContext_setVariable(ParsingContext* this, int key, void* value) {
+ ParsingVariables_set(this->variables, key, value);
 }
 
 void ParsingContext_on(ParsingContext* this, ContextCallback callback) {
  this->callback = callback;
+
+ if (callback != NULL) {this->flags=this->flags|0x2;;}
 }
 
 int ParsingContext_getVariableCount(ParsingContext* this) {
- return ParsingVariable_count(this->variables);
+ return ParsingVariables_count(this->variables);
+}
+
+void ParsingContext_backtrack(ParsingContext* this, size_t offset) {
+ if (offset < this->cut) {offset = this->cut;}
+ if (this->iterator->offset != offset) {Iterator_backtrack(this->iterator, offset);}
 }
 
 size_t ParsingContext_getOffset(ParsingContext* this) {
  return this->iterator->offset;
 }
 
+size_t ParsingContext_account( ParsingContext* this ) {
+ ParsingStats* stats = this->stats;
+ Iterator* iterator = this->iterator;
+ ParsingVariables* variables = this->variables;
+
+ PushInput* push = iterator != NULL ? Iterator__pushInput(iterator) : NULL;
+ stats->bytesMatches = this->arena->allocated + (this->strings != NULL ? this->strings->allocated : 0);
+ stats->bytesInput = iterator == NULL || !iterator->freeBuffer ? 0 : push != NULL ? push->size : iterator->capacity;
+ stats->bytesVariables = sizeof(ParsingVariable) * variables->capacity + sizeof(char*) * variables->keysCapacity;
+ stats->bytesMemo = this->memo != NULL ? this->memo->bytes : 0;
+ return stats->bytesMatches + stats->bytesInput + stats->bytesVariables + stats->bytesMemo;
+}
+
+
+_Bool 
+    ParsingContext_rejects(ParsingContext* this, int id) {
+ Grammar* g = this->grammar;
+
+
+ if (g == NULL || g->first == NULL || id < 0 || id > g->axiomCount + g->skipCount || Iterator_remaining(this->iterator) == 0) {
+  return 0;
+ }
+ FirstSet* set = &(g->first[id]);
+ unsigned char c = (unsigned char)*(this->iterator->current);
+ return !set->nullable && !((set)->bytes[((unsigned char)(c)) >> 3] & (1 << (((unsigned char)(c)) & 7)));
+}
+
 Match* ParsingContext_registerMatch(ParsingContext* this, Element* e, Match* m) {
 
  if ((this->flags & 0x1)) {return m;}
- ParsingStats_registerMatch(this->stats, e, m);
+
+
+
 
 
 
@@ -2793,58 +5307,249 @@ Match* ParsingContext_registerMatch(ParsingContext* this, Element* e, Match* m)
  }
  return m;
 }
+pthread_mutex_t Grammar__lock = PTHREAD_MUTEX_INITIALIZER;
 
 
+void Grammar__ensurePrepared(Grammar* this) {
 
+ pthread_mutex_lock(&Grammar__lock);
 
+ if (this->elements == NULL) {Grammar_prepare(this);}
 
+ pthread_mutex_unlock(&Grammar__lock);
 
-
-ParsingStats* ParsingStats_new(void) {
- ParsingStats* this = (ParsingStats*) gc_new(sizeof(ParsingStats)); assert (this!=NULL); ;
- this->bytesRead = 0;
- this->parseTime = 0;
- this->successBySymbol = NULL;
- this->failureBySymbol = NULL;
- this->failureOffset = 0;
- this->matchOffset = 0;
- this->matchLength = 0;
- this->failureElement = NULL;
- return this;
 }
 
-void ParsingStats_free(ParsingStats* this) {
- if (this != NULL) {
-  if (this->successBySymbol!=NULL) {; gc_free(this->successBySymbol); } ;
-  if (this->failureBySymbol!=NULL) {; gc_free(this->failureBySymbol); } ;
+void Grammar_setPool ( Grammar* this, int size ) {
+ ContextPool* pool = this->pool;
+ if (pool == NULL && size > 0) {
+  ContextPool* p = (ContextPool*) gc_new(sizeof(ContextPool)); assert (p!=NULL); ;
+  p->contexts = NULL;
+  p->count = 0;
+  p->lock = NULL;
+
+  pthread_mutex_t* lock = (pthread_mutex_t*) gc_new(sizeof(pthread_mutex_t)); assert (lock!=NULL); ;
+  pthread_mutex_init(lock, NULL);
+  p->lock = lock;
+
+  this->pool = pool = p;
  }
- if (this!=NULL) {; gc_free(this); } ;
-}
+ if (pool == NULL) {return;}
+ pool->size = (size > 0 ? size : 0);
+
+ while (pool->count > pool->size) {
+  ParsingContext* context = pool->contexts;
+  pool->contexts = context->next;
+  pool->count -= 1;
+  context->next = NULL;
+  ParsingContext_free(context);
+ }
+ if (size <= 0) {
 
-void ParsingStats_setSymbolsCount(ParsingStats* this, size_t t) {
- this->successBySymbol=gc_realloc(this->successBySymbol,t * sizeof(size_t)); ;
- this->failureBySymbol=gc_realloc(this->failureBySymbol,t * sizeof(size_t)); ;
- this->symbolsCount = t;
-}
+  pthread_mutex_destroy((pthread_mutex_t*)pool->lock);
+  if (pool->lock!=NULL) {; gc_free(pool->lock); } ;
 
-Match* ParsingStats_registerMatch(ParsingStats* this, Element* e, Match* m) {
- return m;
+  if (pool!=NULL) {; gc_free(pool); } ;
+  this->pool = NULL;
+ }
 }
 
 
 
+ParsingContext* Grammar__acquireContext(Grammar* this, Iterator* iterator) {
+ ContextPool* pool = this->pool;
+ ParsingContext* context = NULL;
+ if (pool != NULL) {
 
+  pthread_mutex_lock((pthread_mutex_t*)pool->lock);
 
+  context = pool->contexts;
+  if (context != NULL) {
+   pool->contexts = context->next;
+   pool->count -= 1;
+   context->next = NULL;
+  }
 
+  pthread_mutex_unlock((pthread_mutex_t*)pool->lock);
 
-ParsingResult* ParsingResult_new(Match* match, ParsingContext* context) {
- ParsingResult* this = (ParsingResult*) gc_new(sizeof(ParsingResult)); assert (this!=NULL); ;
- assert(match != NULL);
- assert(context != NULL);
- assert(context->iterator != NULL);
- this->match = match;
+ }
+ if (context == NULL) {
+  return ParsingContext_new(this, iterator);
+ } else {
+  ParsingContext_reset(context, iterator);
+  return context;
+ }
+}
+
+
+
+
+_Bool 
+    ParsingContext__isPoolable(ParsingContext* this) {
+ return this->next == NULL
+  && this->arena->allocated <= (4 * 1024 * 1024)
+  && (this->strings == NULL || this->strings->allocated <= (4 * 1024 * 1024))
+  && (this->memo == NULL || this->memo->capacity * sizeof(MemoEntry) <= (4 * 1024 * 1024))
+  && (this->engine == NULL || this->engine->capacity * sizeof(EngineFrame) <= (4 * 1024 * 1024));
+}
+
+
+
+void Grammar__releaseContext(Grammar* this, ParsingContext* context) {
+ ContextPool* pool = this->pool;
+ if (pool == NULL || !ParsingContext__isPoolable(context)) {
+  ParsingContext_free(context);
+  return;
+ }
+
+
+ ParsingContext_reset(context, NULL);
+
+ pthread_mutex_lock((pthread_mutex_t*)pool->lock);
+
+ 
+_Bool 
+     pooled = pool->count < pool->size;
+ if (pooled) {
+  context->next = pool->contexts;
+  pool->contexts = context;
+  pool->count += 1;
+ }
+
+ pthread_mutex_unlock((pthread_mutex_t*)pool->lock);
+
+ if (!pooled) {ParsingContext_free(context);}
+}
+
+
+
+
+
+
+
+ParsingStats* ParsingStats_new(void) {
+ ParsingStats* this = (ParsingStats*) gc_new(sizeof(ParsingStats)); assert (this!=NULL); ;
+ this->bytesRead = 0;
+ this->parseTime = 0;
+ this->symbolsCount = 0;
+ this->successBySymbol = NULL;
+ this->failureBySymbol = NULL;
+ this->bytesBySymbol = NULL;
+ this->timeBySymbol = NULL;
+ this->failureOffset = 0;
+ this->matchOffset = 0;
+ this->matchLength = 0;
+ this->failureElement = NULL;
+ this->memoHits = 0;
+ this->memoMisses = 0;
+ this->bytesMatches = 0;
+ this->bytesInput = 0;
+ this->bytesVariables = 0;
+ this->bytesMemo = 0;
+ return this;
+}
+
+void ParsingStats_free(ParsingStats* this) {
+ if (this != NULL) {
+  if (this->successBySymbol!=NULL) {; gc_free(this->successBySymbol); } ;
+  if (this->failureBySymbol!=NULL) {; gc_free(this->failureBySymbol); } ;
+  if (this->bytesBySymbol!=NULL) {; gc_free(this->bytesBySymbol); } ;
+  if (this->timeBySymbol!=NULL) {; gc_free(this->timeBySymbol); } ;
+ }
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+void ParsingStats_setSymbolsCount(ParsingStats* this, size_t t) {
+ this->successBySymbol=gc_realloc(this->successBySymbol,t * sizeof(size_t)); ;
+ this->failureBySymbol=gc_realloc(this->failureBySymbol,t * sizeof(size_t)); ;
+ this->bytesBySymbol=gc_realloc(this->bytesBySymbol,t * sizeof(size_t)); ;
+ this->timeBySymbol=gc_realloc(this->timeBySymbol,t * sizeof(double)); ;
+ for (size_t i=0 ; i<t ; i++) {
+  this->successBySymbol[i] = 0;
+  this->failureBySymbol[i] = 0;
+  this->bytesBySymbol[i] = 0;
+  this->timeBySymbol[i] = 0;
+ }
+ this->symbolsCount = t;
+}
+
+void ParsingStats_reset(ParsingStats* this) {
+ for (size_t i=0 ; i<this->symbolsCount ; i++) {
+  this->successBySymbol[i] = 0;
+  this->failureBySymbol[i] = 0;
+  this->bytesBySymbol[i] = 0;
+  this->timeBySymbol[i] = 0;
+ }
+ this->bytesRead = 0;
+ this->parseTime = 0;
+ this->failureOffset = 0;
+ this->matchOffset = 0;
+ this->matchLength = 0;
+ this->failureElement = NULL;
+ this->memoHits = 0;
+ this->memoMisses = 0;
+ this->bytesMatches = 0;
+ this->bytesInput = 0;
+ this->bytesVariables = 0;
+ this->bytesMemo = 0;
+}
+
+Match* ParsingStats_registerMatch(ParsingStats* this, Element* e, Match* m) {
+
+
+
+ int id = e->id;
+ if (id < 0 || (size_t)id >= this->symbolsCount) {return m;}
+ if (m != NULL && Match_isSuccess(m)) {
+  this->successBySymbol[id] += 1;
+  this->bytesBySymbol[id] += m->length;
+ } else {
+  this->failureBySymbol[id] += 1;
+ }
+ return m;
+}
+
+size_t ParsingStats_attempts(ParsingStats* this, int id) {
+ if (id < 0 || (size_t)id >= this->symbolsCount) {return 0;}
+ return this->successBySymbol[id] + this->failureBySymbol[id];
+}
+
+double ParsingStats_now(void) {
+ struct timespec t;
+ clock_gettime(CLOCK_MONOTONIC, &t);
+ return (double)t.tv_sec + (double)t.tv_nsec / 1000000000.0;
+}
+
+
+
+
+
+
+
+ParsingResult* ParsingResult_new(Match* match, ParsingContext* context) {
+ ParsingResult* this = (ParsingResult*) gc_new(sizeof(ParsingResult)); assert (this!=NULL); ;
+ assert(match != NULL);
+ assert(context != NULL);
+ assert(context->iterator != NULL);
+ this->match = match;
  this->context = context;
- if (match != FAILURE && context->iterator->offset > 0) {
+ if (context->exceeded) {
+  if(context->grammar->isVerbose){fprintf(stderr, "--- ");fprintf(stderr, "Exceeded the budget of %zu bytes at %zu", context->budget, context->iterator->offset);fprintf(stderr, "\n");;}
+  this->status = 'x';
+ } else if (context->tooDeep) {
+  if(context->grammar->isVerbose){fprintf(stderr, "--- ");fprintf(stderr, "Nested deeper than %zu frames at %zu", context->grammar->maxDepth, context->iterator->offset);fprintf(stderr, "\n");;}
+  this->status = 'd';
+ } else if (context->iterator->truncated) {
+
+
+  if(context->grammar->isVerbose){fprintf(stderr, "--- ");fprintf(stderr, "Failed, backtracked before the iterator's window at %zu", context->iterator->offset);fprintf(stderr, "\n");;}
+  this->status = 'F';
+ } else if (Iterator__pushInput(context->iterator) != NULL && !Iterator__pushInput(context->iterator)->ended && context->reach > Iterator_bufferOffset(context->iterator) + context->iterator->available) {
+
+
+  if(context->grammar->isVerbose){fprintf(stderr, "--- ");fprintf(stderr, "Incomplete, examined the input up to %zu, %zu bytes fed", context->reach, context->iterator->available);fprintf(stderr, "\n");;}
+  this->status = 'i';
+ } else if (match != FAILURE && context->iterator->offset > 0) {
   if (Iterator_hasMore(context->iterator) && Iterator_remaining(context->iterator) > 0) {
    if(context->grammar->isVerbose){fprintf(stderr, "--- ");fprintf(stderr, "Partial success, parsed %zu bytes, %zu remaining", context->iterator->offset, Iterator_remaining(context->iterator));fprintf(stderr, "\n");;};
    this->status = 'p';
@@ -2878,6 +5583,24 @@ _Bool
  return this->status == 'S';
 }
 
+
+_Bool 
+    ParsingResult_isIncomplete(ParsingResult* this) {
+ return this->status == 'i';
+}
+
+
+_Bool 
+    ParsingResult_isExceeded(ParsingResult* this) {
+ return this->status == 'x';
+}
+
+
+_Bool 
+    ParsingResult_isTooDeep(ParsingResult* this) {
+ return this->status == 'd';
+}
+
 char* ParsingResult_text(ParsingResult* this) {
  return this->context->iterator->buffer;
 }
@@ -2887,14 +5610,20 @@ size_t ParsingResult_remaining(ParsingResult* this) {
 }
 
 int ParsingResult_textOffset(ParsingResult* this) {
- int buffer_offset = this->context->iterator->current - this->context->iterator->buffer;
- return this->context->iterator->offset - buffer_offset;
+ return (int)Iterator_bufferOffset(this->context->iterator);
 }
 
 void ParsingResult_free(ParsingResult* this) {
  if (this != NULL) {
+
+
+
   this->match = Match_free(this->match);
-  ParsingContext_free(this->context);
+  if (this->context != NULL && this->context->grammar != NULL && this->context->grammar->pool != NULL) {
+   Grammar__releaseContext(this->context->grammar, this->context);
+  } else {
+   ParsingContext_free(this->context);
+  }
  }
  if (this!=NULL) {; gc_free(this); } ;
 }
@@ -2905,186 +5634,2608 @@ void ParsingResult_free(ParsingResult* this) {
 
 
 
-int Grammar__resetElementIDs(Element* e, int step, void* nothing) {
- if (Reference_Is(e)) {
-  Reference* r = (Reference*)e;
-  if (r->id != -1) {
-   ;
-   r->id = -1;
-   return step;
-  } else {
-   return -1;
-  }
- } else {
-  ParsingElement * r = (ParsingElement*)e;
-  if (r->id != -1) {
-   ;
-   r->id = -1;
-   return step;
-  } else {
-   return -1;
-  }
+int MatchTree__count(Match* match, int step, void* tree) {
+ MatchTree* this = (MatchTree*)tree;
+ this->count += 1;
+ if (match->data != NULL && Match_getElementType(match) == 'T') {
+  this->groupsCount += ((TokenMatch*)match->data)->count;
  }
+ return step;
 }
 
-int Grammar__assignElementIDs(Element* e, int step, void* nothing) {
- if (Reference_Is(e)) {
-  Reference* r = (Reference*)e;
-  if (r->id == -1) {
-   r->id = step;
-   ;;
-   return step;
-  } else {
-   return -1;
-  }
- } else {
-  ParsingElement * r = (ParsingElement*)e;
-  if (r->id == -1) {
-   r->id = step;
-   ;;
-   return step;
-  } else {
-   return -1;
+
+
+int MatchTree__add(MatchTree* this, Match* match, int parent) {
+ int first = this->count;
+ int previous = -1;
+ for ( ; match != NULL ; match = match->next) {
+  int i = this->count++;
+
+  MatchNode* node = &this->nodes[i];
+  node->element = match->element->id;
+  node->parent = parent;
+  node->children = -1;
+  node->next = -1;
+  node->groups = this->groupsCount;
+  node->groupsCount = 0;
+  node->offset = match->offset;
+  node->length = match->length;
+  if (match->data != NULL && Match_getElementType(match) == 'T') {
+   TokenMatch* data = (TokenMatch*)match->data;
+   memcpy(this->groups + this->groupsCount, data->spans, sizeof(TokenMatchGroup) * data->count);
+   node->groupsCount = data->count;
+   this->groupsCount += data->count;
   }
+  if (previous >= 0) {this->nodes[previous].next = i;}
+  if (match->children != NULL) {node->children = MatchTree__add(this, match->children, i);}
+  previous = i;
  }
-}
-
-int Grammar__registerElement(Element* e, int step, void* grammar) {
- Reference* r = (Reference*)e;
- Grammar* g = (Grammar*)grammar;
- r->id = r->id;
- Element* ge = g->elements[r->id];
- if (ge == NULL) {
-  ;;
-  g->elements[r->id] = e;
-  return step;
- } else {
-  return -1;
+ return first;
+}
+
+MatchTree* MatchTree_new(ParsingResult* result) {
+ assert(result != NULL);
+ MatchTree* this = (MatchTree*) gc_new(sizeof(MatchTree)); assert (this!=NULL); ;
+ ParsingContext* context = result->context;
+ this->status = result->status;
+ this->nodes = NULL;
+ this->count = 0;
+ this->groups = NULL;
+ this->groupsCount = 0;
+ this->grammar = context->grammar;
+ this->text = context->iterator->buffer;
+ this->textOffset = Iterator_bufferOffset(context->iterator);
+ this->textLength = context->iterator->available;
+ this->iterator = context->iterator;
+ this->freeIterator = 0;
+ this->mapped = NULL;
+ if (Match_isSuccess(result->match)) {
+  Match__walk(result->match, MatchTree__count, 0, this);
+  MatchNode* nodes = (MatchNode*) gc_calloc((size_t)this->count, sizeof(MatchNode)) ; assert (nodes!=NULL); ;
+  TokenMatchGroup* groups = (TokenMatchGroup*) gc_calloc((size_t)(this->groupsCount > 1 ? this->groupsCount : 1), sizeof(TokenMatchGroup)) ; assert (groups!=NULL); ;
+  this->nodes = nodes;
+  this->groups = groups;
+  this->count = 0;
+  this->groupsCount = 0;
+  MatchTree__add(this, result->match, -1);
  }
+ return this;
 }
 
-void Grammar_prepare ( Grammar* this ) {
- if (this->skip!=NULL) {
-  this->skip->id = 0;
- }
- if (this->axiom!=NULL) {
-
-  if (this->elements) { if (this->elements!=NULL) {; gc_free(this->elements); } ; this->elements = NULL; }
-  assert(this->elements == NULL);
-
-  ;
-  ParsingElement_walk(this->axiom, Grammar__resetElementIDs, NULL);
-  if (this->skip != NULL) {
-   ParsingElement_walk(this->skip, Grammar__resetElementIDs, NULL);
-  }
-
-  ;
-  int count = ParsingElement_walk(this->axiom, Grammar__assignElementIDs, NULL);
-  this->axiomCount = count;
-  if (this->skip != NULL) {
-   this->skipCount = ParsingElement__walk(this->skip, Grammar__assignElementIDs, count + 1, NULL) - count;
-  }
+MatchTree* MatchTree_FromResult(ParsingResult* result) {
+ MatchTree* this = MatchTree_new(result);
 
 
-  Element** elements = (Element**) gc_calloc(this->skipCount + this->axiomCount + 1, sizeof(Element*)) ; assert (elements!=NULL); ;
-  this->elements = elements;
+ this->freeIterator = result->context->freeIterator;
+ result->context->freeIterator = 0;
+ ParsingResult_free(result);
+ return this;
+}
 
-  count = ParsingElement_walk(this->axiom, Grammar__registerElement, this);
-  if (this->skip != NULL) {
-   ParsingElement__walk(this->skip, Grammar__registerElement, count, this);
-  }
+void MatchTree_free(MatchTree* this) {
+ if (this != NULL) {
+  if (this->freeIterator) {Iterator_free(this->iterator);}
+  if (this->mapped != NULL) {MappedInput_free(this->mapped);}
+  if (this->nodes!=NULL) {; gc_free(this->nodes); } ;
+  if (this->groups!=NULL) {; gc_free(this->groups); } ;
  }
+ if (this!=NULL) {; gc_free(this); } ;
 }
 
-ParsingResult* Grammar_parseIterator( Grammar* this, Iterator* iterator ) {
-
- if (this->elements == NULL) {Grammar_prepare(this);}
- assert(this->axiom != NULL);
- ParsingContext* context = ParsingContext_new(this, iterator);
- assert(this->axiom->recognize != NULL);
- clock_t t1 = clock();
- Match* match = this->axiom->recognize(this->axiom, context);
- context->stats->parseTime = ((double)clock() - (double)t1) / CLOCKS_PER_SEC;
- context->stats->bytesRead = iterator->offset;
- return ParsingResult_new(match, context);
+Element* MatchTree_element(MatchTree* this, int node) {
+ assert(node >= 0 && node < this->count);
+ return this->grammar->elements[this->nodes[node].element];
 }
 
-ParsingResult* Grammar_parsePath( Grammar* this, const char* path ) {
- Iterator* iterator = Iterator_Open(path);
- if (iterator != NULL) {
-  ParsingResult* result = Grammar_parseIterator(this, iterator);
-  result->context->freeIterator = 1;
-  return result;
- } else {
-  errno = ENOENT;
+const char* MatchTree_groupStart(MatchTree* this, int node, int index) {
+ assert(node >= 0 && node < this->count);
+ assert(index >= 0 && index < this->nodes[node].groupsCount);
+ TokenMatchGroup* group = &this->groups[this->nodes[node].groups + index];
+ if (this->text == NULL || group->offset < this->textOffset || group->offset + group->length > this->textOffset + this->textLength) {
   return NULL;
  }
+ return this->text + (group->offset - this->textOffset);
 }
 
-ParsingResult* Grammar_parseString( Grammar* this, const char* text ) {
- Iterator* iterator = Iterator_FromString(text);
- if (iterator != NULL) {
-  ParsingResult* result = Grammar_parseIterator(this, iterator);
-  result->context->freeIterator = 1;
-  return result;
- } else {
-  errno = ENOENT;
-  return NULL;
- }
+int MatchTree_groupLength(MatchTree* this, int node, int index) {
+ assert(node >= 0 && node < this->count);
+ assert(index >= 0 && index < this->nodes[node].groupsCount);
+ return (int)this->groups[this->nodes[node].groups + index].length;
 }
 
+int MatchTree_walk(MatchTree* this, MatchTreeWalkingCallback callback, int step, void* context) {
 
 
+ for (int i=0 ; i<this->count ; i++) {
+  if (i > 0) {step += 1;}
+  step = callback(this, i, step, context);
+  if (step < 0) {break;}
+ }
+ return step;
+}
 
+void MatchTree_export(MatchTree* this, int* elements, int* parents, size_t* offsets, size_t* lengths, int* groups, size_t* spans) {
+ for (int i=0 ; i<this->count ; i++) {
+  MatchNode* node = &this->nodes[i];
+  if (elements != NULL) {elements[i] = node->element;}
+  if (parents != NULL) {parents[i] = node->parent;}
+  if (offsets != NULL) {offsets[i] = node->offset;}
+  if (lengths != NULL) {lengths[i] = node->length;}
+  if (groups != NULL) {groups[i] = node->groups;}
+ }
 
 
-
-Processor* Processor_new() {
- Processor* this = (Processor*) gc_new(sizeof(Processor)); assert (this!=NULL); ;
- this->callbacksCount = 100;
- ProcessorCallback* callbacks = (ProcessorCallback*) gc_calloc((size_t)this->callbacksCount, sizeof(ProcessorCallback)) ; assert (callbacks!=NULL); ;
- this->callbacks = callbacks;
- this->fallback = NULL;
- return this;
+ if (groups != NULL) {groups[this->count] = this->groupsCount;}
+ if (spans != NULL) {
+  for (int i=0 ; i<this->groupsCount ; i++) {
+   spans[i * 2] = this->groups[i].offset;
+   spans[i * 2 + 1] = this->groups[i].length;
+  }
+ }
 }
 
-void Processor_free(Processor* this) {
- if (this!=NULL) {; gc_free(this); } ;
+
+
+void MatchTree__writeGroup(MatchTree* this, int node, int index, Output* output, 
+                                                                                _Bool 
+                                                                                     escaped) {
+ const char* start = MatchTree_groupStart(this, node, index);
+ if (start == NULL) {return;}
+ if (escaped) {Output_writeEscaped(output,start,(size_t)(MatchTree_groupLength(this, node, index)));}
+ else {Output_write(output, start, (size_t)MatchTree_groupLength(this, node, index));}
 }
 
-void Processor_register (Processor* this, int symbolID, ProcessorCallback callback ) {
- if (this->callbacksCount < (symbolID + 1)) {
-  int cur_count = this->callbacksCount;
-  int new_count = symbolID + 100;
-  this->callbacks=gc_realloc(this->callbacks,new_count * sizeof(ProcessorCallback)); ;
-  this->callbacksCount = new_count;
 
-  while (cur_count < new_count) {
-   this->callbacks[cur_count] = NULL;
-   cur_count++;
-  }
- }
- this->callbacks[symbolID] = callback;
+_Bool 
+    MatchTree__isWritten(MatchTree* this, int node) {
+ ParsingElement* element = ParsingElement_Ensure(MatchTree_element(this, node));
+ return element->type != 'p' && element->type != 'c' && element->type != '!';
 }
 
-int Processor_process (Processor* this, Match* match, int step) {
- ProcessorCallback handler = this->fallback;
- if (ParsingElement_Is(match->element)) {
-  int element_id = ((ParsingElement*)match->element)->id;
-  if (element_id >= 0 && element_id < this->callbacksCount) {
-   handler = this->callbacks[element_id];
+void MatchTree__childrenWriteJSON(MatchTree* this, int node, Output* output) {
+ int count = 0;
+ for (int child = this->nodes[node].children ; child >= 0 ; child = this->nodes[child].next) {
+  if (MatchTree__isWritten(this, child)) {count += 1;}
+ }
+ int i = 0;
+ for (int child = this->nodes[node].children ; child >= 0 ; child = this->nodes[child].next) {
+  if (MatchTree__isWritten(this, child)) {
+   MatchTree__writeJSON(this, child, output);
+   if ( (i+1) < count ) {
+    Output_writeString(output,",");
+   }
+   i += 1;
+  }
+ }
+}
+
+void MatchTree__writeJSON(MatchTree* this, int node, Output* output) {
+ if (node < 0) {
+  Output_writeString(output,"null");
+  return;
+ }
+ MatchNode* match = &this->nodes[node];
+ ParsingElement* element = (ParsingElement*)MatchTree_element(this, node);
+ if (element->type == '#') {
+  Reference* ref = (Reference*)element;
+  if (ref->cardinality == '1' || ref->cardinality == '=' || ref->cardinality == '?') {
+   MatchTree__writeJSON(this, match->children, output);
+  } else {
+   Output_writeString(output,"[");
+   MatchTree__childrenWriteJSON(this, node, output);
+   Output_writeString(output,"]");
+  }
+  return;
+ }
+ switch(element->type) {
+  case 'W':
+   if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+   Output_writeString(output,",\"value\":\"");Output_writeEscaped(output,Word_word(element),(size_t)(strlen(Word_word(element))));Output_writeString(output,"\"");
+   Output_writeString(output,"}");
+   break;
+  case 'T':
+   if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+   if (match->groupsCount == 1) {
+    Output_writeString(output,",\"value\":\"");MatchTree__writeGroup(this, node, 0, output, 1);Output_writeString(output,"\"");
+   } else if (match->groupsCount > 1) {
+    Output_writeString(output,",\"content\":[");
+    for (int i=0 ; i < match->groupsCount ; i++) {
+     Output_writeString(output,"\"");MatchTree__writeGroup(this, node, i, output, 1);Output_writeString(output,"\"");
+     if (i+1 < match->groupsCount) {Output_writeString(output,",");}
+    }
+    Output_writeString(output,"]");
+   }
+   Output_writeString(output,"}");
+   break;
+  case 'G':
+  case 'R':
+   if (element->name) {Output_writeString(output,"{\"name\":\"");Output_writeString(output,element->name);Output_writeString(output,"\"");} else {Output_writeString(output,"{\"id\":");Output_writef(output,"%d",element->id);};
+   if (match->children >= 0) {
+    Output_writeString(output,",\"content\":[");
+    MatchTree__childrenWriteJSON(this, node, output);
+    Output_writeString(output,"]");
+   }
+   Output_writeString(output,"}");
+   break;
+  case 'p':
+  case 'c':
+  case '!':
+   break;
+  default:
+   Output_writef(output,"\"ERROR:undefined element type=%c\"",element->type);
+ }
+}
+
+void MatchTree_outputJSON(MatchTree* this, Output* output) {
+ MatchTree__writeJSON(this, this->count > 0 ? 0 : -1, output);
+}
+
+void MatchTree_writeJSON(MatchTree* this, int fd) {
+ Output* output = Output_ToFile(fd);
+ MatchTree_outputJSON(this, output);
+ Output_free(output);
+}
+
+void MatchTree__childrenWriteXML(MatchTree* this, int node, Output* output) {
+ for (int child = this->nodes[node].children ; child >= 0 ; child = this->nodes[child].next) {
+  if (MatchTree__isWritten(this, child)) {
+   MatchTree__writeXML(this, child, output);
+  }
+ }
+}
+
+void MatchTree__writeXML(MatchTree* this, int node, Output* output) {
+ if (node < 0) {
+  return;
+ }
+ MatchNode* match = &this->nodes[node];
+ ParsingElement* element = (ParsingElement*)MatchTree_element(this, node);
+ if (element->type == '#') {
+  Reference* ref = (Reference*)element;
+  if (ref->cardinality == '1' || ref->cardinality == '=' || ref->cardinality == '?') {
+   MatchTree__writeXML(this, match->children, output);
+  } else {
+   MatchTree__childrenWriteXML(this, node, output);
+  }
+  return;
+ }
+ switch(element->type) {
+  case 'W':
+   if (element->name != NULL) {
+    Output_writeString(output,"<");
+    if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);};
+    Output_writeString(output,"/>");
+   }
+   break;
+  case 'T':
+   if (match->groupsCount == 0) {
+    if (element->name != NULL) {
+     Output_writeString(output,"<");
+     if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);};
+     Output_writeString(output,"/>");
+    }
+   } else if (match->groupsCount == 1) {
+    if (element->name != NULL) {
+     Output_writeString(output,"<");
+     if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);};
+     Output_writeString(output," t=\"");
+     MatchTree__writeGroup(this, node, 0, output, 0);
+     Output_writeString(output,"\"/>");
+    } else {
+     MatchTree__writeGroup(this, node, 0, output, 0);
+    }
+   } else if (element->name != NULL) {
+    if (element->name != NULL) {Output_writeString(output,"<") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
+    for (int i=0 ; i < match->groupsCount ; i++) {
+     Output_writeString(output,"<g t=\"");
+     MatchTree__writeGroup(this, node, i, output, 0);
+     Output_writeString(output,"\"/>");
+    }
+    if (element->name != NULL) {Output_writeString(output,"</") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
+   }
+   break;
+  case 'G':
+
+   if (match->children >= 0) {
+    if (element->name != NULL) {Output_writeString(output,"<") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
+    MatchTree__writeXML(this, match->children, output);
+    if (element->name != NULL) {Output_writeString(output,"</") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
+   }
+   break;
+  case 'R':
+   if (match->children >= 0) {
+    if (element->name != NULL) {Output_writeString(output,"<") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
+    MatchTree__childrenWriteXML(this, node, output);
+    if (element->name != NULL) {Output_writeString(output,"</") ; if (element->name != NULL) { Output_writeString(output,element->name); } else {Output_writef(output,"E%d",element->id);} ; Output_writeString(output,">");};
+   }
+   break;
+  case 'p':
+  case 'c':
+  case '!':
+   break;
+  default:
+   Output_writef(output,"<error value=\"Undefined element type\" type=\"%c\" />",element->type);
+ }
+}
+
+void MatchTree_outputXML(MatchTree* this, Output* output) {
+ Output_writeString(output,"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n");
+ MatchTree__writeXML(this, this->count > 0 ? 0 : -1, output);
+}
+
+void MatchTree_writeXML(MatchTree* this, int fd) {
+ Output* output = Output_ToFile(fd);
+ MatchTree_outputXML(this, output);
+ Output_free(output);
+}
+void MatchTree__writeVarint(Output* output, uint64_t value) {
+ char bytes[10];
+ int n = 0;
+ do {
+  unsigned char byte = (unsigned char)(value & 0x7F);
+  value >>= 7;
+  bytes[n++] = (char)(value != 0 ? byte | 0x80 : byte);
+ } while (value != 0);
+ Output_write(output, bytes, (size_t)n);
+}
+
+void MatchTree__writeSigned(Output* output, int64_t value) {
+ MatchTree__writeVarint(output, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+
+
+uint64_t MatchTree__readVarint(const unsigned char* data, size_t length, size_t* offset, 
+                                                                                        _Bool
+                                                                                            * valid) {
+ uint64_t value = 0;
+ for (int shift=0 ; shift < 64 ; shift += 7) {
+  if (*offset >= length) {break;}
+  unsigned char byte = data[(*offset)++];
+  value |= (uint64_t)(byte & 0x7F) << shift;
+  if ((byte & 0x80) == 0) {return value;}
+ }
+ *valid = 0;
+ return 0;
+}
+
+int64_t MatchTree__readSigned(const unsigned char* data, size_t length, size_t* offset, 
+                                                                                       _Bool
+                                                                                           * valid) {
+ uint64_t value = MatchTree__readVarint(data, length, offset, valid);
+ return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+
+_Bool 
+    MatchTree_writeBinary(MatchTree* this, Output* output, int flags) {
+ 
+_Bool 
+     withText = (flags & 0x01);
+ if (withText && this->text == NULL) {return 0;}
+ char header[15];
+ uint64_t fingerprint = Grammar_fingerprint(this->grammar);
+ memcpy(header, "LPMT", 4);
+ header[4] = 1;
+ header[5] = (char)(flags & 0x01);
+ for (int i=0 ; i<8 ; i++) {header[6 + i] = (char)((fingerprint >> (8 * i)) & 0xFF);}
+ header[14] = this->status;
+ Output_write(output, header, 15);
+ MatchTree__writeVarint(output, (uint64_t)this->count);
+ MatchTree__writeVarint(output, (uint64_t)this->groupsCount);
+ MatchTree__writeVarint(output, withText ? this->textOffset : 0);
+ MatchTree__writeVarint(output, withText ? this->textLength : 0);
+ if (withText) {Output_write(output, this->text, this->textLength);}
+ for (int i=0 ; i<this->count ; i++) {
+  MatchNode* node = &this->nodes[i];
+  size_t base = node->parent >= 0 ? this->nodes[node->parent].offset : 0;
+  MatchTree__writeVarint(output, (uint64_t)node->element);
+  MatchTree__writeVarint(output, (uint64_t)(node->parent >= 0 ? i - node->parent : 0));
+  MatchTree__writeSigned(output, (int64_t)node->offset - (int64_t)base);
+  MatchTree__writeVarint(output, node->length);
+  MatchTree__writeVarint(output, (uint64_t)node->groupsCount);
+  for (int j=0 ; j<node->groupsCount ; j++) {
+   TokenMatchGroup* group = &this->groups[node->groups + j];
+   MatchTree__writeSigned(output, (int64_t)group->offset - (int64_t)node->offset);
+   MatchTree__writeVarint(output, group->length);
+  }
+ }
+ return !output->failed;
+}
+
+MatchTree* MatchTree_FromBinary(Grammar* grammar, const char* data, size_t length) {
+ const unsigned char* bytes = (const unsigned char*)data;
+ 
+_Bool 
+     valid = data != NULL && length >= 15 && memcmp(data, "LPMT", 4) == 0;
+ valid = valid && bytes[4] == 1 && (bytes[5] & ~0x01) == 0;
+ if (valid) {
+  uint64_t fingerprint = 0;
+  for (int i=0 ; i<8 ; i++) {fingerprint |= (uint64_t)bytes[6 + i] << (8 * i);}
+  valid = fingerprint == Grammar_fingerprint(grammar);
+ }
+ if (!valid) {
+  errno = EINVAL;
+  return NULL;
+ }
+ size_t offset = 15;
+ uint64_t count = MatchTree__readVarint(bytes, length, &offset, &valid);
+ uint64_t spans = MatchTree__readVarint(bytes, length, &offset, &valid);
+ uint64_t textOffset = MatchTree__readVarint(bytes, length, &offset, &valid);
+ uint64_t textLength = MatchTree__readVarint(bytes, length, &offset, &valid);
+
+
+ valid = valid && count <= (length - offset) / 5 && spans <= (length - offset) / 2;
+ valid = valid && textLength <= length - offset;
+ if (!valid) {
+  errno = EINVAL;
+  return NULL;
+ }
+ MatchTree* this = (MatchTree*) gc_new(sizeof(MatchTree)); assert (this!=NULL); ;
+ MatchNode* nodes = (MatchNode*) gc_calloc((size_t)(count > 1 ? count : 1), sizeof(MatchNode)) ; assert (nodes!=NULL); ;
+ TokenMatchGroup* groups = (TokenMatchGroup*) gc_calloc((size_t)(spans > 1 ? spans : 1), sizeof(TokenMatchGroup)) ; assert (groups!=NULL); ;
+ this->status = (char)bytes[14];
+ this->nodes = nodes;
+ this->count = (int)count;
+ this->groups = groups;
+ this->groupsCount = 0;
+ this->grammar = grammar;
+ this->text = (bytes[5] & 0x01) ? data + offset : NULL;
+ this->textOffset = (size_t)textOffset;
+ this->textLength = (size_t)textLength;
+ this->iterator = NULL;
+ this->freeIterator = 0;
+ this->mapped = NULL;
+ if (this->text != NULL) {offset += (size_t)textLength;}
+ int elements = grammar->axiomCount + grammar->skipCount + 1;
+ for (int i=0 ; valid && i<this->count ; i++) {
+  MatchNode* node = &this->nodes[i];
+  uint64_t element = MatchTree__readVarint(bytes, length, &offset, &valid);
+  uint64_t distance = MatchTree__readVarint(bytes, length, &offset, &valid);
+  valid = valid && element < (uint64_t)elements && grammar->elements[element] != NULL;
+  valid = valid && (i == 0 ? distance == 0 : distance >= 1 && distance <= (uint64_t)i);
+  if (!valid) {break;}
+  node->element = (int)element;
+  node->parent = i == 0 ? -1 : i - (int)distance;
+  node->children = -1;
+  node->next = -1;
+
+
+  if (node->parent >= 0) {
+   int previous = -1;
+   int ancestor = i - 1;
+   while (ancestor >= 0 && ancestor != node->parent) {
+    previous = ancestor;
+    ancestor = this->nodes[ancestor].parent;
+   }
+   if (ancestor < 0) {valid = 0; break;}
+   if (previous < 0) {this->nodes[node->parent].children = i;}
+   else {this->nodes[previous].next = i;}
+  }
+  size_t base = node->parent >= 0 ? this->nodes[node->parent].offset : 0;
+  node->offset = (size_t)((int64_t)base + MatchTree__readSigned(bytes, length, &offset, &valid));
+  node->length = (size_t)MatchTree__readVarint(bytes, length, &offset, &valid);
+  uint64_t groupsCount = MatchTree__readVarint(bytes, length, &offset, &valid);
+  valid = valid && groupsCount <= spans - (uint64_t)this->groupsCount;
+  node->groups = this->groupsCount;
+  node->groupsCount = (int)groupsCount;
+  for (uint64_t j=0 ; valid && j<groupsCount ; j++) {
+   TokenMatchGroup* group = &this->groups[this->groupsCount++];
+   group->offset = (size_t)((int64_t)node->offset + MatchTree__readSigned(bytes, length, &offset, &valid));
+   group->length = (size_t)MatchTree__readVarint(bytes, length, &offset, &valid);
+  }
+ }
+ if (!valid || offset != length || (uint64_t)this->groupsCount != spans) {
+  MatchTree_free(this);
+  errno = EINVAL;
+  return NULL;
+ }
+ return this;
+}
+
+MatchTree* MatchTree_readBinary(Grammar* grammar, const char* path) {
+ MappedInput* input = MappedInput_new(path);
+ if (input == NULL) {
+  errno = ENOENT;
+  return NULL;
+ }
+ MatchTree* this = MatchTree_FromBinary(grammar, input->data, input->length);
+ if (this == NULL) {
+  MappedInput_free(input);
+  errno = EINVAL;
+ } else {
+  this->mapped = input;
+ }
+ return this;
+}
+
+
+
+
+
+
+
+int Grammar__resetElementIDs(Element* e, int step, void* nothing) {
+ if (Reference_Is(e)) {
+  Reference* r = (Reference*)e;
+  if (r->id != -1) {
+   ;
+   r->id = -1;
+   return step;
+  } else {
+   return -1;
+  }
+ } else {
+  ParsingElement * r = (ParsingElement*)e;
+  if (r->id != -1) {
+   ;
+   r->id = -1;
+   return step;
+  } else {
+   return -1;
+  }
+ }
+}
+
+int Grammar__assignElementIDs(Element* e, int step, void* nothing) {
+ if (Reference_Is(e)) {
+  Reference* r = (Reference*)e;
+  if (r->id == -1) {
+   r->id = step;
+   ;;
+   return step;
+  } else {
+   return -1;
+  }
+ } else {
+  ParsingElement * r = (ParsingElement*)e;
+  if (r->id == -1) {
+   r->id = step;
+   ;;
+   return step;
+  } else {
+   return -1;
+  }
+ }
+}
+
+int Grammar__registerElement(Element* e, int step, void* grammar) {
+ Reference* r = (Reference*)e;
+ Grammar* g = (Grammar*)grammar;
+ r->id = r->id;
+ Element* ge = g->elements[r->id];
+ if (ge == NULL) {
+  ;;
+  g->elements[r->id] = e;
+  return step;
+ } else {
+  return -1;
+ }
+}
+
+void Grammar__markContextual(Grammar* this) {
+
+
+
+ int count = this->axiomCount + this->skipCount + 1;
+ 
+_Bool 
+     changed = 1;
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e != NULL && ParsingElement_Is(e)) {
+   ParsingElement* pe = (ParsingElement*)e;
+   pe->flags = pe->flags & ~0x04;;
+   if (pe->type == 'p' || pe->type == 'c') {
+    pe->flags=pe->flags|0x04;;
+   }
+  }
+ }
+ while (changed) {
+  changed = 0;
+  for (int i=0 ; i<count ; i++) {
+   Element* e = this->elements[i];
+   if (e == NULL || !ParsingElement_Is(e)) {continue;}
+   ParsingElement* pe = (ParsingElement*)e;
+   if ((pe->flags & 0x04)) {continue;}
+   Reference* child = pe->children;
+   while (child != NULL) {
+    if ((child->element->flags & 0x04)) {
+     pe->flags=pe->flags|0x04;;
+     changed = 1;
+     break;
+    }
+    child = child->next;
+   }
+  }
+ }
+}
+
+
+_Bool 
+    FirstSet__merge(FirstSet* this, FirstSet* other) {
+ 
+_Bool 
+     changed = 0;
+ for (int i=0 ; i<32 ; i++) {
+  unsigned char b = this->bytes[i] | other->bytes[i];
+  if (b != this->bytes[i]) {this->bytes[i] = b; changed = 1;}
+ }
+ return changed;
+}
+
+
+_Bool 
+    Grammar__isWordReference(Reference* r) {
+
+
+ return r->element->type == 'W' && (r->cardinality == '1' || r->cardinality == '+');
+}
+
+void Grammar__compileWordSets(Grammar* this) {
+ Grammar__freeWordSets(this);
+ int count = this->axiomCount + this->skipCount + 1;
+ WordSet** sets = (WordSet**) gc_calloc(count, sizeof(WordSet*)) ; assert (sets!=NULL); ;
+ this->wordSets = sets;
+ this->wordSetsCount = count;
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e == NULL || e->type != 'G') {continue;}
+  WordSet* last = NULL;
+  Reference* child = ((ParsingElement*)e)->children;
+  int index = 0;
+  while (child != NULL) {
+
+   Reference* end = child;
+   int n = 0;
+   while (end != NULL && Grammar__isWordReference(end)) {end = end->next; n++;}
+   if (n >= 4) {
+    WordSet* set = WordSet_new(index);
+    for (Reference* r = child ; r != end ; r = r->next) {WordSet_add(set, r);}
+    if (last == NULL) {sets[i] = set;} else {last->next = set;}
+    last = set;
+   }
+   index += n > 0 ? n : 1;
+   child = n > 0 ? end : child->next;
+  }
+ }
+}
+
+void Grammar__computeFirst(Grammar* this) {
+ int count = this->axiomCount + this->skipCount + 1;
+ if (this->first!=NULL) {; gc_free(this->first); } ;
+ FirstSet* first = (FirstSet*) gc_calloc(count, sizeof(FirstSet)) ; assert (first!=NULL); ;
+ this->first = first;
+
+
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e == NULL || !ParsingElement_Is(e)) {continue;}
+  ParsingElement* pe = (ParsingElement*)e;
+  switch (pe->type) {
+   case 'W':
+    (&first[i])->bytes[((unsigned char)(((WordConfig*)pe->config)->word[0])) >> 3] |= (1 << (((unsigned char)(((WordConfig*)pe->config)->word[0])) & 7));
+    break;
+   case 'T':
+    Token__first(pe, &first[i]);
+    break;
+   case 'p':
+   case 'c':
+   case '!':
+    first[i].nullable = 1;
+    break;
+  }
+ }
+
+
+ FirstSet* skip = this->skip != NULL && this->skip->id >= 0 && this->skip->id < count ? &first[this->skip->id] : NULL;
+
+
+ 
+_Bool 
+     changed = 1;
+ while (changed) {
+  changed = 0;
+  for (int i=0 ; i<count ; i++) {
+   Element* e = this->elements[i];
+   if (e == NULL) {continue;}
+   FirstSet* set = &first[i];
+   
+  _Bool 
+            nullable = set->nullable;
+   if (Reference_Is(e)) {
+    Reference* r = (Reference*)e;
+    FirstSet* f = &first[r->element->id];
+    changed = FirstSet__merge(set, f) || changed;
+    if (skip != NULL) {changed = FirstSet__merge(set, skip) || changed;}
+    nullable = r->cardinality == '?' || r->cardinality == '*' || (f->nullable && r->cardinality != '=');
+   } else if (e->type == 'G') {
+    nullable = 0;
+    Reference* child = ((ParsingElement*)e)->children;
+    while (child != NULL) {
+     changed = FirstSet__merge(set, &first[child->id]) || changed;
+     nullable = nullable || first[child->id].nullable;
+     child = child->next;
+    }
+   } else if (e->type == 'R') {
+    nullable = 1;
+    Reference* child = ((ParsingElement*)e)->children;
+    while (child != NULL && nullable) {
+     changed = FirstSet__merge(set, &first[child->id]) || changed;
+     nullable = first[child->id].nullable;
+     child = child->next;
+    }
+    if (skip != NULL) {changed = FirstSet__merge(set, skip) || changed;}
+   }
+   if (nullable && !set->nullable) {
+    set->nullable = 1;
+    changed = 1;
+   }
+  }
+ }
+
+
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e == NULL) {continue;}
+  ParsingElement* pe = Reference_Is(e) ? ((Reference*)e)->element : (ParsingElement*)e;
+  if ((pe->flags & 0x04)) {first[i].nullable = 1;}
+ }
+}
+typedef struct OptimizerItem {
+ Reference* origin;
+ ParsingElement* element;
+} OptimizerItem;
+
+typedef struct Optimizer {
+ Grammar* grammar;
+ OptimizerItem* items;
+ int count;
+ int capacity;
+} Optimizer;
+
+
+
+
+
+
+
+void Grammar__derive(Grammar* this, Element* element, int id) {
+ int count = this->axiomCount + this->skipCount + 2;
+ this->elements=gc_realloc(this->elements,count * sizeof(Element*)); ;
+ this->elements[count - 1] = element;
+ element->id = id;
+ this->axiomCount += 1;
+ this->derivedCount += 1;
+}
+
+Reference* Grammar__deriveReference(Grammar* this, Reference* origin, ParsingElement* element) {
+ Reference* r = Reference_new();
+ r->cardinality = origin->cardinality;
+ r->element = element;
+ if (origin->name != NULL) {r->name = gc_strdup(origin->name) ; assert (r->name!=NULL); ;}
+ Grammar__derive(this, (Element*)r, origin->id);
+ return r;
+}
+
+void Optimizer__add(Optimizer* this, Reference* origin, ParsingElement* element) {
+ if (this->count == this->capacity) {
+  this->capacity = (16 > this->capacity * 2 ? 16 : this->capacity * 2);
+  this->items=gc_realloc(this->items,this->capacity * sizeof(OptimizerItem)); ;
+ }
+ this->items[this->count].origin = origin;
+ this->items[this->count].element = element;
+ this->count += 1;
+}
+
+
+
+
+
+_Bool 
+    Optimizer__isTrivial(Optimizer* this, ParsingElement* e) {
+ Grammar* g = this->grammar;
+ if (e == g->axiom || e == g->skip || e->name != NULL || (e->type != 'R' && e->type != 'G')) {return 0;}
+ if (e->type == 'R' && (e->flags & 0x04)) {return 0;}
+ Reference* child = e->children;
+ return child != NULL && child->next == NULL && child->cardinality == '1' && child->name == NULL;
+}
+
+
+
+void Optimizer__expand(Optimizer* this, ParsingElement* parent, Reference* child, int depth) {
+ Grammar* g = this->grammar;
+ ParsingElement* element = child->element;
+ if ((g->optimize & 0x01)) {
+
+
+  
+ _Bool 
+      once = child->cardinality == '1' || child->cardinality == '?';
+  int hops = 0;
+  while (Optimizer__isTrivial(this, element) && hops++ < g->axiomCount) {
+   ParsingElement* inlined = element->children->element;
+   if (!once && (inlined->type == 'p' || inlined->type == 'c' || inlined->type == '!')) {break;}
+   element = inlined;
+  }
+ }
+ if ((g->optimize & 0x02) && parent->type == 'G' && element->type == 'G'
+ && element != parent && element != g->axiom && element != g->skip && element->name == NULL
+ && child->cardinality == '1' && child->name == NULL && depth < 16) {
+  for (Reference* r = element->children ; r != NULL ; r = r->next) {
+   Optimizer__expand(this, parent, r, depth + 1);
+  }
+ } else {
+  Optimizer__add(this, child, element);
+ }
+}
+
+
+
+void Optimizer__removeDead(Optimizer* this) {
+ int count = 0;
+ for (int i=0 ; i<this->count ; i++) {
+  OptimizerItem* item = &this->items[i];
+  char c = item->origin->cardinality;
+  
+ _Bool 
+                dead = 0;
+
+  if ((item->element->type == 'R' || item->element->type == 'G') && item->element->children == NULL) {
+   dead = c != '?' && c != '*';
+  }
+
+
+  for (int j=0 ; j<count && !dead ; j++) {
+   OptimizerItem* other = &this->items[j];
+   dead = other->element == item->element && other->origin->cardinality == c && !(item->element->flags & 0x04);
+  }
+  if (!dead) {this->items[count++] = *item;}
+
+
+  if (!dead && (c == '?' || c == '*')) {break;}
+ }
+ this->count = count;
+}
+
+
+void Optimizer__mergeWords(Optimizer* this) {
+ int count = 0;
+ for (int i=0 ; i<this->count ; i++) {
+  OptimizerItem* item = &this->items[i];
+  int end = i;
+  size_t length = 0;
+  while (end < this->count && this->items[end].element->type == 'W' && this->items[end].element->name == NULL
+  && this->items[end].origin->cardinality == '1' && this->items[end].origin->name == NULL) {
+   length += ((WordConfig*)this->items[end].element->config)->length;
+   end += 1;
+  }
+  if (end - i > 1) {
+   char* word = (char*) gc_calloc(length + 1, sizeof(char)) ; assert (word!=NULL); ;
+   char* tail = word;
+   for (int j=i ; j<end ; j++) {
+    WordConfig* config = (WordConfig*)this->items[j].element->config;
+    memcpy(tail, config->word, config->length);
+    tail += config->length;
+   }
+   ParsingElement* merged = Word_new(word);
+   merged->flags = item->element->flags;
+   if (word!=NULL) {; gc_free(word); } ;
+   Grammar__derive(this->grammar, (Element*)merged, item->element->id);
+   this->items[count].origin = item->origin;
+   this->items[count].element = merged;
+   count += 1;
+   i = end - 1;
+  } else {
+   this->items[count++] = *item;
+  }
+ }
+ this->count = count;
+}
+
+
+
+void Optimizer__repeatTokens(Optimizer* this) {
+
+ Grammar* g = this->grammar;
+ int count = g->axiomCount + g->skipCount + 1;
+ for (int i=0 ; i<this->count ; i++) {
+  OptimizerItem* item = &this->items[i];
+  ParsingElement* token = item->element;
+  if (token->type != 'T' || (item->origin->cardinality != '+' && item->origin->cardinality != '*')) {continue;}
+  const char* expr = ((TokenConfig*)token->config)->expr;
+  FirstSet set;
+  memset(&set, 0, sizeof(FirstSet));
+  const char* end = Token__class(expr, &set);
+  if (end == NULL || *end != '\0') {continue;}
+
+  ParsingElement* run = NULL;
+  for (int j=count - g->derivedCount ; j<count && run == NULL ; j++) {
+   Element* e = g->elements[j];
+   if (e->type == 'T' && e->id == token->id) {run = (ParsingElement*)e;}
+  }
+  if (run == NULL) {
+   char* repeated = (char*) gc_calloc(strlen(expr) + 2, sizeof(char)) ; assert (repeated!=NULL); ;
+   strcpy(repeated, expr);
+   strcat(repeated, "+");
+   run = Token_new(repeated);
+   if (repeated!=NULL) {; gc_free(repeated); } ;
+   if (run == NULL) {continue;}
+   if (token->name != NULL) {run->name = gc_strdup(token->name) ; assert (run->name!=NULL); ;}
+   run->flags = token->flags;
+   Grammar__derive(g, (Element*)run, token->id);
+   count += 1;
+  }
+  item->element = run;
+ }
+
+}
+
+
+
+void Optimizer__rewrite(Optimizer* this, ParsingElement* element) {
+ Grammar* g = this->grammar;
+ this->count = 0;
+ for (Reference* child = element->children ; child != NULL ; child = child->next) {
+  Optimizer__expand(this, element, child, 0);
+ }
+ if (element->type == 'G' && (g->optimize & 0x10)) {Optimizer__removeDead(this);}
+
+ if (g->skip == NULL) {
+  if (element->type == 'R' && (g->optimize & 0x04)) {Optimizer__mergeWords(this);}
+  if ((g->optimize & 0x08)) {Optimizer__repeatTokens(this);}
+ }
+ 
+_Bool 
+           changed = 0;
+ Reference* child = element->children;
+ for (int i=0 ; i<this->count ; i++) {
+  OptimizerItem* item = &this->items[i];
+  changed = changed || child != item->origin || child->element != item->element;
+  child = child == NULL ? NULL : child->next;
+ }
+ if (!changed && child == NULL) {return;}
+ Optimization* o = (Optimization*) gc_new(sizeof(Optimization)); assert (o!=NULL); ;
+ o->element = element;
+ o->children = element->children;
+ o->next = g->optimizations;
+ g->optimizations = o;
+ Reference* tail = NULL;
+ element->children = NULL;
+ for (int i=0 ; i<this->count ; i++) {
+  Reference* r = Grammar__deriveReference(g, this->items[i].origin, this->items[i].element);
+  if (tail == NULL) {element->children = r;} else {tail->next = r;}
+  tail = r;
+ }
+}
+
+
+void Grammar__optimize(Grammar* this) {
+ Optimizer optimizer = {.grammar=this, .items=NULL, .count=0, .capacity=0};
+ int count = this->axiomCount + this->skipCount + 1;
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e != NULL && (e->type == 'R' || e->type == 'G')) {
+   Optimizer__rewrite(&optimizer, (ParsingElement*)e);
+  }
+ }
+ if (optimizer.items!=NULL) {; gc_free(optimizer.items); } ;
+}
+
+void Grammar_prepare ( Grammar* this ) {
+ if (this->skip!=NULL) {
+  this->skip->id = 0;
+ }
+ if (this->axiom!=NULL) {
+
+
+  if (this->elements) { Grammar__restore(this) ; if (this->elements!=NULL) {; gc_free(this->elements); } ; this->elements = NULL; }
+  assert(this->elements == NULL);
+
+  ;
+  ParsingElement_walk(this->axiom, Grammar__resetElementIDs, NULL);
+  if (this->skip != NULL) {
+   ParsingElement_walk(this->skip, Grammar__resetElementIDs, NULL);
+  }
+
+  ;
+  int count = ParsingElement_walk(this->axiom, Grammar__assignElementIDs, NULL);
+  this->axiomCount = count;
+  if (this->skip != NULL) {
+   this->skipCount = ParsingElement__walk(this->skip, Grammar__assignElementIDs, count + 1, NULL) - count;
+  }
+
+
+  Element** elements = (Element**) gc_calloc(this->skipCount + this->axiomCount + 1, sizeof(Element*)) ; assert (elements!=NULL); ;
+  this->elements = elements;
+
+  count = ParsingElement_walk(this->axiom, Grammar__registerElement, this);
+  if (this->skip != NULL) {
+   ParsingElement__walk(this->skip, Grammar__registerElement, count, this);
+  }
+
+  Grammar__markContextual(this);
+  if (this->optimize != 0) {Grammar__optimize(this);}
+  Grammar__computeFirst(this);
+  Grammar__compileWordSets(this);
+ }
+}
+
+
+
+uint64_t Grammar__hash(uint64_t hash, const char* data, size_t length) {
+ for (size_t i=0 ; i<length ; i++) {
+  hash ^= (unsigned char)data[i];
+  hash *= 0x100000001b3ULL;
+ }
+ return hash;
+}
+
+uint64_t Grammar__hashInt(uint64_t hash, int value) {
+ char bytes[4];
+ for (int i=0 ; i<4 ; i++) {bytes[i] = (char)(((unsigned int)value >> (8 * i)) & 0xFF);}
+ return Grammar__hash(hash, bytes, 4);
+}
+
+uint64_t Grammar__hashString(uint64_t hash, const char* string) {
+
+ if (string == NULL) {return Grammar__hashInt(hash, -1);}
+ hash = Grammar__hashInt(hash, (int)strlen(string));
+ return Grammar__hash(hash, string, strlen(string));
+}
+
+uint64_t Grammar_fingerprint ( Grammar* this ) {
+ Grammar__ensurePrepared(this);
+ uint64_t hash = 0xcbf29ce484222325ULL;
+ int count = this->elements == NULL ? 0 : this->axiomCount + this->skipCount + 1;
+ hash = Grammar__hashInt(hash, count);
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e == NULL) {
+   hash = Grammar__hashInt(hash, -1);
+   continue;
+  }
+  hash = Grammar__hashInt(hash, e->type);
+  hash = Grammar__hashString(hash, e->name);
+  if (e->type == '#') {
+   Reference* r = (Reference*)e;
+   hash = Grammar__hashInt(hash, r->cardinality);
+   hash = Grammar__hashInt(hash, r->element->id);
+   continue;
+  }
+  ParsingElement* pe = (ParsingElement*)e;
+  if (pe->type == 'W') {hash = Grammar__hashString(hash, Word_word(pe));}
+  if (pe->type == 'T') {hash = Grammar__hashString(hash, Token_expr(pe));}
+  for (Reference* child = pe->children ; child != NULL ; child = child->next) {
+   hash = Grammar__hashInt(hash, child->id);
+  }
+  hash = Grammar__hashInt(hash, -1);
+ }
+ return hash;
+}
+
+
+ParsingResult* Grammar__parse( Grammar* this, ParsingContext* context ) {
+ assert(this->axiom != NULL);
+ assert(this->axiom->recognize != NULL);
+
+
+ PushInput* push = Iterator__pushInput(context->iterator);
+ if (push != NULL) {
+  if (context->memo == NULL) {context->memo = Memo_new((64 * 1024 * 1024));}
+  push->parsed = context->iterator->available;
+ }
+ double t1 = ParsingStats_now();
+ Match* match = NULL;
+ if (this->engine == 'i') {
+  if (context->engine == NULL) {context->engine = Engine_new();}
+  context->engine->maxDepth = this->maxDepth;
+  match = Engine_recognize(context->engine, this->axiom, context);
+ } else {
+  match = this->axiom->recognize(this->axiom, context);
+ }
+ context->stats->parseTime = ParsingStats_now() - t1;
+ context->stats->bytesRead = context->iterator->offset;
+ ParsingContext_account(context);
+ return ParsingResult_new(match, context);
+}
+
+ParsingResult* Grammar_parseIterator( Grammar* this, Iterator* iterator ) {
+
+ Grammar__ensurePrepared(this);
+ return Grammar__parse(this, Grammar__acquireContext(this, iterator));
+}
+
+ParsingResult* Grammar_parsePath( Grammar* this, const char* path ) {
+ Iterator* iterator = Iterator_Open(path);
+ if (iterator != NULL) {
+  ParsingResult* result = Grammar_parseIterator(this, iterator);
+  result->context->freeIterator = 1;
+  return result;
+ } else {
+  errno = ENOENT;
+  return NULL;
+ }
+}
+
+ParsingResult* Grammar_parseStream( Grammar* this, const char* path, size_t window ) {
+ Iterator* iterator = Iterator_Stream(path, window);
+ if (iterator != NULL) {
+  ParsingResult* result = Grammar_parseIterator(this, iterator);
+  result->context->freeIterator = 1;
+  return result;
+ } else {
+  errno = ENOENT;
+  return NULL;
+ }
+}
+
+ParsingResult* Grammar_parseMapped( Grammar* this, const char* path ) {
+ Iterator* iterator = Iterator_Map(path);
+ if (iterator != NULL) {
+  ParsingResult* result = Grammar_parseIterator(this, iterator);
+  result->context->freeIterator = 1;
+  return result;
+ } else {
+  errno = ENOENT;
+  return NULL;
+ }
+}
+
+ParsingResult* Grammar_parseString( Grammar* this, const char* text ) {
+ Iterator* iterator = Iterator_FromString(text);
+ if (iterator != NULL) {
+  ParsingResult* result = Grammar_parseIterator(this, iterator);
+  result->context->freeIterator = 1;
+  return result;
+ } else {
+  errno = ENOENT;
+  return NULL;
+ }
+}
+
+ParsingResult* Grammar_reparse( Grammar* this, ParsingResult* previous, size_t offset, size_t removed, const char* inserted ) {
+
+ Iterator* source = previous != NULL && previous->context != NULL ? previous->context->iterator : NULL;
+ if (source == NULL || source->move != String_move || Iterator_bufferOffset(source) != 0 || offset > source->available || removed > source->available - offset) {
+  errno = EINVAL;
+  return NULL;
+ }
+
+ size_t added = inserted == NULL ? 0 : strlen(inserted);
+ size_t length = source->available - removed + added;
+ char* text = malloc(length + 1);
+ memcpy(text, source->buffer, offset);
+ if (added > 0) {memcpy(text + offset, inserted, added);}
+ memcpy(text + offset + added, source->buffer + offset + removed, source->available - offset - removed);
+ text[length] = '\0';
+ Iterator* iterator = Iterator_FromString(text);
+ iterator->capacity = length;
+ iterator->available = length;
+ iterator->separator = source->separator;
+ iterator->freeBuffer = 1;
+
+ int lines = 0;
+ for (size_t i=0 ; i<added ; i++) {if (inserted[i] == source->separator) {lines++;}}
+ for (size_t i=0 ; i<removed ; i++) {if (source->buffer[offset + i] == source->separator) {lines--;}}
+ Grammar__ensurePrepared(this);
+ ParsingContext* context = Grammar__acquireContext(this, iterator);
+ context->freeIterator = 1;
+ if (context->memo != NULL && previous->context->memo != NULL && previous->context->grammar == this) {
+  Memo_reuse(context->memo, previous->context->memo, offset, removed, added, lines);
+ }
+ return Grammar__parse(this, context);
+}
+
+ParsingResult* Grammar_resume( Grammar* this, ParsingResult* previous ) {
+ Iterator* iterator = previous != NULL && previous->context != NULL ? previous->context->iterator : NULL;
+ PushInput* input = Iterator__pushInput(iterator);
+ if (input == NULL || input->parsed > iterator->available) {
+  errno = EINVAL;
+  return NULL;
+ }
+
+
+
+ size_t added = iterator->available - input->parsed;
+ int lines = 0;
+ for (size_t i=input->parsed ; i<iterator->available ; i++) {if (iterator->buffer[i] == iterator->separator) {lines++;}}
+ Iterator_moveTo(iterator, 0);
+ iterator->truncated = 0;
+ Grammar__ensurePrepared(this);
+ ParsingContext* context = Grammar__acquireContext(this, iterator);
+ context->freeIterator = previous->context->freeIterator;
+ previous->context->freeIterator = 0;
+ if (context->memo == NULL) {context->memo = Memo_new((64 * 1024 * 1024));}
+ if (previous->context->memo != NULL && previous->context->grammar == this) {
+  Memo_reuse(context->memo, previous->context->memo, input->parsed, 0, added, lines);
+ }
+ return Grammar__parse(this, context);
+}
+
+
+
+
+
+
+
+typedef struct ParallelParse {
+ Grammar* grammar;
+ const char* text;
+ size_t* offsets;
+ ParsingResult** results;
+ int count;
+ int next;
+ int failed;
+
+ pthread_mutex_t lock;
+
+} ParallelParse;
+
+typedef struct ParallelBoundary {
+ ParsingContext* context;
+ ParsingElement* element;
+} ParallelBoundary;
+
+typedef struct ParallelBatch {
+ Grammar* grammar;
+ Iterator** inputs;
+ ParsingResult** results;
+ int count;
+ int next;
+
+ pthread_mutex_t lock;
+
+} ParallelBatch;
+
+
+
+int ParallelParse__next(ParallelParse* this) {
+
+ pthread_mutex_lock(&this->lock);
+
+ int result = this->next < this->count && this->next <= this->failed ? this->next++ : -1;
+
+ pthread_mutex_unlock(&this->lock);
+
+ return result;
+}
+
+void ParallelParse__fail(ParallelParse* this, int chunk) {
+
+ pthread_mutex_lock(&this->lock);
+
+ this->failed = (this->failed < chunk ? this->failed : chunk);
+
+ pthread_mutex_unlock(&this->lock);
+
+}
+
+void* ParallelParse__run(void* data) {
+ ParallelParse* this = (ParallelParse*)data;
+ int chunk = 0;
+ while ((chunk = ParallelParse__next(this)) >= 0) {
+  Iterator* iterator = Iterator_FromSlice(this->text, this->offsets[chunk], this->offsets[chunk + 1]);
+  ParsingResult* result = Grammar_parseIterator(this->grammar, iterator);
+  result->context->freeIterator = 1;
+  this->results[chunk] = result;
+  if (!ParsingResult_isSuccess(result)) {ParallelParse__fail(this, chunk);}
+ }
+ return NULL;
+}
+
+
+
+size_t Grammar__splitAfter(const char* text, size_t length, size_t offset, void* data) {
+ ParallelBoundary* boundary = (ParallelBoundary*)data;
+ ParsingContext* context = boundary->context;
+ ParsingElement* element = boundary->element;
+ for (size_t o=offset ; o < length ; o++) {
+  Iterator_moveTo(context->iterator, o);
+  if (ParsingContext_rejects(context, element->id)) {continue;}
+  Match* match = element->recognize(element, context);
+  if (Match_isSuccess(match) && match->length > 0) {
+   return o + match->length;
+  }
+ }
+ return length;
+}
+
+
+
+ParsingResult* ParallelParse__join(ParallelParse* this) {
+ Iterator* iterator = Iterator_FromString(this->text);
+ ParsingContext* context = ParsingContext_new(this->grammar, iterator);
+ context->freeIterator = 1;
+ Match* match = Match_Success(0, this->grammar->axiom, context);
+ Match* last = NULL;
+ size_t end = 0;
+ ParsingContext* owned = context;
+ for (int i=0 ; i < this->count ; i++) {
+  ParsingResult* result = this->results[i];
+  if (result == NULL) {continue;}
+  ParsingContext* c = result->context;
+
+  owned->next = c;
+  owned = c;
+  if (i <= this->failed) {
+   for (size_t j=0 ; j < context->stats->symbolsCount && j < c->stats->symbolsCount ; j++) {
+    context->stats->successBySymbol[j] += c->stats->successBySymbol[j];
+    context->stats->failureBySymbol[j] += c->stats->failureBySymbol[j];
+    context->stats->bytesBySymbol[j] += c->stats->bytesBySymbol[j];
+    context->stats->timeBySymbol[j] += c->stats->timeBySymbol[j];
+   }
+   context->stats->memoHits += c->stats->memoHits;
+   context->stats->memoMisses += c->stats->memoMisses;
+   context->stats->bytesMatches += c->stats->bytesMatches;
+   context->stats->bytesInput += c->stats->bytesInput;
+   context->stats->bytesVariables += c->stats->bytesVariables;
+   context->stats->bytesMemo += c->stats->bytesMemo;
+
+
+   context->exceeded = context->exceeded || c->exceeded;
+   context->tooDeep = context->tooDeep || c->tooDeep;
+   if (c->lastMatchOffset + c->lastMatchLength >= context->lastMatchOffset + context->lastMatchLength) {
+    context->lastMatchOffset = c->lastMatchOffset;
+    context->lastMatchLength = c->lastMatchLength;
+    context->lastMatchElementID = c->lastMatchElementID;
+   }
+
+   if (Match_isSuccess(result->match)) {
+    if (last == NULL) {match->children = result->match;} else {last->next = result->match;}
+    last = result->match;
+    last->parent = match;
+    end = c->iterator->offset;
+   }
+  }
+
+  result->match = NULL;
+  result->context = NULL;
+  ParsingResult_free(result);
+ }
+ Iterator_moveTo(iterator, end);
+ if (last == NULL) {
+  match = FAILURE;
+ } else {
+  match->length = end;
+ }
+ context->stats->bytesRead = end;
+ return ParsingResult_new(match, context);
+}
+
+ParsingResult* Grammar_parseParallelWith( Grammar* this, const char* text, ParsingSplitCallback split, void* data, int jobs ) {
+
+ Grammar__ensurePrepared(this);
+ assert(this->axiom != NULL);
+ if (jobs <= 0) {jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);}
+ if (jobs <= 0) {jobs = 1;}
+ double t1 = ParsingStats_now();
+ size_t length = strlen(text);
+ int count = (int)((size_t)(jobs * 4) < length / (64 * 1024) + 1 ? (size_t)(jobs * 4) : length / (64 * 1024) + 1);
+ ParallelParse parse = {
+  .grammar = this,
+  .text = text,
+  .count = 0,
+  .next = 0,
+ };
+
+
+ size_t* offsets = (size_t*) gc_calloc(count + 1, sizeof(size_t)) ; assert (offsets!=NULL); ;
+ parse.offsets = offsets;
+ offsets[0] = 0;
+ for (int i=1 ; i < count ; i++) {
+  size_t target = (length / count * i > offsets[parse.count] ? length / count * i : offsets[parse.count]);
+  size_t offset = split(text, length, target, data);
+  if (offset > offsets[parse.count] && offset < length) {
+   offsets[++parse.count] = offset;
+  }
+ }
+ offsets[++parse.count] = length;
+ parse.failed = parse.count;
+ ParsingResult** results = (ParsingResult**) gc_calloc(parse.count, sizeof(ParsingResult*)) ; assert (results!=NULL); ;
+ parse.results = results;
+
+ int threads = (jobs < parse.count ? jobs : parse.count) - 1;
+ pthread_mutex_init(&parse.lock, NULL);
+ pthread_t* workers = (pthread_t*) gc_calloc(threads + 1, sizeof(pthread_t)) ; assert (workers!=NULL); ;
+ for (int i=0 ; i < threads ; i++) {
+  if (pthread_create(&workers[i], NULL, ParallelParse__run, &parse) != 0) {threads = i; break;}
+ }
+
+ ParallelParse__run(&parse);
+ for (int i=0 ; i < threads ; i++) {pthread_join(workers[i], NULL);}
+ pthread_mutex_destroy(&parse.lock);
+ if (workers!=NULL) {; gc_free(workers); } ;
+
+
+
+ ParsingResult* result = ParallelParse__join(&parse);
+ result->context->stats->parseTime = ParsingStats_now() - t1;
+ if (results!=NULL) {; gc_free(results); } ;
+ if (offsets!=NULL) {; gc_free(offsets); } ;
+ return result;
+}
+
+ParsingResult* Grammar_parseParallel( Grammar* this, const char* text, ParsingElement* boundary, int jobs ) {
+ Grammar__ensurePrepared(this);
+
+ Iterator* iterator = Iterator_FromString(text);
+ ParsingContext* context = ParsingContext_new(this, iterator);
+ context->freeIterator = 1;
+ ParallelBoundary data = {.context=context, .element=boundary};
+ ParsingResult* result = Grammar_parseParallelWith(this, text, Grammar__splitAfter, &data, jobs);
+ ParsingContext_free(context);
+ return result;
+}
+
+void* ParallelBatch__run(void* data) {
+ ParallelBatch* this = (ParallelBatch*)data;
+ while (1) {
+
+  pthread_mutex_lock(&this->lock);
+
+  int input = this->next < this->count ? this->next++ : -1;
+
+  pthread_mutex_unlock(&this->lock);
+
+  if (input < 0) {break;}
+  this->results[input] = Grammar_parseIterator(this->grammar, this->inputs[input]);
+ }
+ return NULL;
+}
+
+void Grammar_parseMany( Grammar* this, Iterator** inputs, ParsingResult** results, int count, int jobs ) {
+
+ Grammar__ensurePrepared(this);
+ if (jobs <= 0) {jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);}
+ if (jobs <= 0) {jobs = 1;}
+ ParallelBatch batch = {
+  .grammar = this,
+  .inputs = inputs,
+  .results = results,
+  .count = count,
+  .next = 0,
+ };
+
+ int threads = (jobs < count ? jobs : count) - 1;
+ pthread_mutex_init(&batch.lock, NULL);
+ pthread_t* workers = (pthread_t*) gc_calloc((threads > 0 ? threads : 0) + 1, sizeof(pthread_t)) ; assert (workers!=NULL); ;
+ for (int i=0 ; i < threads ; i++) {
+  if (pthread_create(&workers[i], NULL, ParallelBatch__run, &batch) != 0) {threads = i; break;}
+ }
+
+ ParallelBatch__run(&batch);
+ for (int i=0 ; i < threads ; i++) {pthread_join(workers[i], NULL);}
+ pthread_mutex_destroy(&batch.lock);
+ if (workers!=NULL) {; gc_free(workers); } ;
+
+
+
+}
+void Grammar__writeCString(int fd, const char* text, size_t length) {
+ if (text == NULL) {dprintf(fd,"%s","NULL"); return;}
+ dprintf(fd,"%s","\"");
+ for (size_t i=0 ; i<length ; i++) {
+  unsigned char c = (unsigned char)text[i];
+  if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (c != '\0' && strchr(" _-+*/=<>!&|^~%.,:;()[]{}#@$", c) != NULL)) {
+   dprintf(fd,"%c",c);
+  } else {
+   dprintf(fd,"\\%03o",c);
+  }
+ }
+ dprintf(fd,"%s","\"");
+}
+
+
+
+_Bool 
+    Grammar__isGenerated(Grammar* this, int index) {
+ Element* e = this->elements[index];
+ return e != NULL && e->id == index && (e->type == 'W' || e->type == 'R' || e->type == 'G');
+}
+
+
+
+
+void Grammar__writeCRecognize(Grammar* this, int fd, const char* prefix, Reference* reference) {
+ ParsingElement* e = reference->element;
+ if (e->id >= 0 && e->id <= this->axiomCount + this->skipCount && this->elements[e->id] == (Element*)e && Grammar__isGenerated(this, e->id)) {
+  dprintf(fd,"(%s_DIRECT ? %s_e%d(%s_ELEMENT(%d), context) : ParsingElement_recognize(%s_ELEMENT(%d), context))",prefix, prefix, e->id, prefix, e->id, prefix, e->id);
+ } else {
+  dprintf(fd,"ParsingElement_recognize(%s_REFERENCE(%d)->element, context)",prefix, reference->id);
+ }
+}
+
+void Grammar__writeCReference(Grammar* this, int fd, const char* prefix, Reference* r) {
+ char c = r->cardinality;
+ dprintf(fd,"// Reference #%d%s%s, cardinality `%c`\n",r->id, r->name ? " " : "", r->name ? r->name : "", c);
+ dprintf(fd,"static Match* %s_r%d(ParsingContext* context) {\n",prefix, r->id);
+ dprintf(fd,"\tReference* this = %s_REFERENCE(%d);\n",prefix, r->id);
+ if (c != '1' && c != '?' && c != '+' && c != '*' && c != '=') {
+  dprintf(fd,"%s","\treturn Reference_recognize(this, context);\n}\n\n");
+  return;
+ }
+ 
+_Bool 
+     once = c == '1' || c == '?';
+ 
+_Bool 
+     optional = c == '?' || c == '*';
+ if (!once) {
+
+
+  dprintf(fd,"%s","\tif (this == context->commit) {return Reference_recognize(this, context);}\n");
+ }
+ dprintf(fd,"%s","\tMatch*     result = FAILURE;\n");
+ dprintf(fd,"%s","\tMatch*     tail   = NULL;\n");
+ dprintf(fd,"%s","\tsize_t     offset = context->iterator->offset;\n");
+ dprintf(fd,"%s","\tsize_t     end    = offset;\n");
+ if (!optional) {
+  dprintf(fd,"%s","\tArenaMark  mark   = Arena_mark(context->arena);\n");
+ }
+ if (r->element->type == 'p' || r->element->type == 'c' || r->element->type == '!') {
+  dprintf(fd,"%s","\twhile (TRUE) {\n");
+ } else {
+  dprintf(fd,"%s","\twhile (Iterator_hasMore(context->iterator)) {\n");
+ }
+ if (!once) {
+  dprintf(fd,"%s","\t\tsize_t start = context->iterator->offset;\n");
+ }
+ dprintf(fd,"%s","\t\tsize_t cuts  = context->cuts;\n");
+ dprintf(fd,"%s","\t\tMatch* match = ");
+ Grammar__writeCRecognize(this, fd, prefix, r);
+ dprintf(fd,"%s",";\n");
+ dprintf(fd,"\t\tif (%s_SUCCESS(match)) {\n",prefix);
+ dprintf(fd,"%s","\t\t\tend = Match_getEndOffset(match);\n");
+ dprintf(fd,"%s","\t\t\tif (tail == NULL) {result = match;} else {tail->next = match;}\n");
+ dprintf(fd,"%s","\t\t\ttail = match;\n");
+ if (once) {
+  dprintf(fd,"%s","\t\t\tbreak;\n");
+ } else {
+  dprintf(fd,"%s","\t\t\tif (context->iterator->offset == start) {break;}\n");
+ }
+
+
+ dprintf(fd,"%s","\t\t} else if (context->cuts != cuts) {\n");
+ dprintf(fd,"%s","\t\t\tParsingContext_backtrack(context, offset);\n");
+ dprintf(fd,"%s","\t\t\treturn MATCH_STATS(FAILURE);\n");
+ dprintf(fd,"%s","\t\t} else if (ParsingElement_skip((ParsingElement*)this, context) == 0) {\n");
+ dprintf(fd,"%s","\t\t\tbreak;\n");
+ dprintf(fd,"%s","\t\t}\n");
+ dprintf(fd,"%s","\t\tif (context->iterator->offset == offset) {break;}\n");
+ dprintf(fd,"%s","\t}\n");
+ dprintf(fd,"%s","\tif (context->iterator->offset != end) {ParsingContext_backtrack(context, end);}\n");
+ if (c == '1' || c == '+') {
+  dprintf(fd,"\tif (!%s_SUCCESS(result)) {\n",prefix);
+  dprintf(fd,"%s","\t\tArena_rewind(context->arena, mark);\n");
+  dprintf(fd,"%s","\t\treturn MATCH_STATS(FAILURE);\n");
+  dprintf(fd,"%s","\t}\n");
+ } else if (c == '=') {
+  dprintf(fd,"\tif (!%s_SUCCESS(result) || result->length == 0) {\n",prefix);
+  dprintf(fd,"%s","\t\tArena_rewind(context->arena, mark);\n");
+  dprintf(fd,"%s","\t\treturn MATCH_STATS(FAILURE);\n");
+  dprintf(fd,"%s","\t}\n");
+ }
+ dprintf(fd,"%s","\tMatch* m    = Match_SuccessFromReference(context->iterator->offset - offset, this, context);\n");
+ dprintf(fd,"%s","\tm->children = result == FAILURE ? NULL : result;\n");
+ dprintf(fd,"%s","\tm->offset   = offset;\n");
+ dprintf(fd,"%s","\tfor (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}\n");
+ dprintf(fd,"%s","\treturn MATCH_STATS(m);\n");
+ dprintf(fd,"%s","}\n\n");
+}
+
+void Grammar__writeCElement(Grammar* this, int fd, const char* prefix, ParsingElement* e) {
+ dprintf(fd,"// %s #%d %c\n",e->name ? e->name : "-", e->id, e->type);
+ dprintf(fd,"static Match* %s_e%d(ParsingElement* this, ParsingContext* context) {\n",prefix, e->id);
+ if (e->type == 'W') {
+  WordConfig* config = (WordConfig*)e->config;
+  dprintf(fd,"\tif (%s_REMAINING >= %zu && memcmp(context->iterator->current, ",prefix, config->length);
+  Grammar__writeCString(fd, config->word, config->length);
+  dprintf(fd,", %zu) == 0) {\n",config->length);
+  dprintf(fd,"\t\tMatch* match = MATCH_STATS(Match_Success(%zu, this, context));\n",config->length);
+  dprintf(fd,"\t\tcontext->iterator->move(context->iterator, %zu);\n",config->length);
+  dprintf(fd,"%s","\t\treturn match;\n");
+  dprintf(fd,"%s","\t}\n");
+  dprintf(fd,"%s","\treturn MATCH_STATS(FAILURE);\n");
+ } else if (e->children == NULL) {
+
+  dprintf(fd,"%s","\treturn MATCH_STATS(FAILURE);\n");
+ } else if (e->type == 'R') {
+  dprintf(fd,"%s","\tMatch*    result = FAILURE;\n");
+  dprintf(fd,"%s","\tMatch*    last   = NULL;\n");
+  dprintf(fd,"%s","\tMatch*    match  = NULL;\n");
+  dprintf(fd,"%s","\tsize_t    offset = context->iterator->offset;\n");
+  dprintf(fd,"%s","\tsize_t    cuts   = context->cuts;\n");
+  dprintf(fd,"%s","\tArenaMark mark   = Arena_mark(context->arena);\n");
+  dprintf(fd,"\tif (%s_REJECTS(%d)) {return MATCH_STATS(FAILURE);}\n",prefix, e->id);
+  dprintf(fd,"%s","\tbool scoped = HAS_FLAG(this->flags, ELEMENT_CONTEXTUAL) || HAS_FLAG(context->flags, FLAG_SCOPED);\n");
+  dprintf(fd,"%s","\tif (scoped) {ParsingContext_push(context);}\n");
+  for (Reference* r = e->children ; r != NULL ; r = r->next) {
+   dprintf(fd,"%s","\tcuts  = context->cuts;\n");
+   if (r->next == NULL && Reference_IsMany(r)) {
+
+    dprintf(fd,"\tif (%s_REFERENCE(%d) == context->commit) {ParsingContext__enclose(context, this, result, offset);}\n",prefix, r->id);
+   }
+   dprintf(fd,"\tmatch = %s_r%d(context);\n",prefix, r->id);
+   dprintf(fd,"\tif (!%s_SUCCESS(match) && (context->cuts != cuts || ParsingElement_skip(this, context) == 0 || !%s_SUCCESS(match = %s_r%d(context)))) {goto failure;}\n",prefix, prefix, prefix, r->id);
+   dprintf(fd,"%s","\tif (last == NULL) {\n");
+   dprintf(fd,"%s","\t\tresult           = Match_Success(match->length, this, context);\n");
+   dprintf(fd,"%s","\t\tresult->offset   = offset;\n");
+   dprintf(fd,"%s","\t\tresult->children = last = match;\n");
+   dprintf(fd,"%s","\t} else {\n");
+   dprintf(fd,"%s","\t\tlast = last->next = match;\n");
+   dprintf(fd,"%s","\t}\n");
+   dprintf(fd,"%s","\tmatch->parent = result;\n");
+  }
+  dprintf(fd,"%s","\tif (last == NULL) {goto failure;}\n");
+  dprintf(fd,"%s","\tif (scoped) {ParsingContext_pop(context);}\n");
+  dprintf(fd,"%s","\tresult->length = last->offset - result->offset + last->length;\n");
+  dprintf(fd,"%s","\treturn MATCH_STATS(result);\n");
+  dprintf(fd,"%s","failure:\n");
+  dprintf(fd,"%s","\tif (scoped) {ParsingContext_pop(context);}\n");
+  dprintf(fd,"%s","\tArena_rewind(context->arena, mark);\n");
+  dprintf(fd,"%s","\tif (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}\n");
+  dprintf(fd,"%s","\treturn MATCH_STATS(FAILURE);\n");
+ } else if (e->type == 'G') {
+  dprintf(fd,"%s","\tsize_t    offset = context->iterator->offset;\n");
+  dprintf(fd,"%s","\tsize_t    cuts   = context->cuts;\n");
+  dprintf(fd,"%s","\tArenaMark mark   = Arena_mark(context->arena);\n");
+  dprintf(fd,"%s","\tMatch*    match  = NULL;\n");
+  for (Reference* r = e->children ; r != NULL ; r = r->next) {
+   dprintf(fd,"\tif (!%s_REJECTS(%d) && %s_SUCCESS(match = %s_r%d(context))) {goto success;}\n",prefix, r->id, prefix, prefix, r->id);
+   dprintf(fd,"%s","\tArena_rewind(context->arena, mark);\n");
+   dprintf(fd,"%s","\tif (context->cuts != cuts) {goto failure;}\n");
+  }
+  dprintf(fd,"%s","failure:\n");
+  dprintf(fd,"%s","\tif (context->iterator->offset != offset) {ParsingContext_backtrack(context, offset);}\n");
+  dprintf(fd,"%s","\treturn MATCH_STATS(FAILURE);\n");
+  dprintf(fd,"%s","success:;\n");
+  dprintf(fd,"%s","\tMatch* result   = Match_Success(match->length, this, context);\n");
+  dprintf(fd,"%s","\tresult->offset   = offset;\n");
+  dprintf(fd,"%s","\tresult->children = match;\n");
+  dprintf(fd,"%s","\tmatch->parent   = result;\n");
+  dprintf(fd,"%s","\treturn MATCH_STATS(result);\n");
+ }
+ dprintf(fd,"%s","}\n\n");
+}
+
+
+_Bool 
+    Grammar_writeC( Grammar* this, int fd, const char* prefix ) {
+ if (this->elements == NULL) {Grammar_prepare(this);}
+
+
+ if (this->elements == NULL || prefix == NULL || this->optimizations != NULL) {return 0;}
+ int count = this->axiomCount + this->skipCount + 1;
+ dprintf(fd,"// Generated by libparsing %s with `Grammar_writeC`, do not edit.\n","0.9.2");
+ dprintf(fd,"%s","#include \"parsing.h\"\n\n");
+ dprintf(fd,"#define %s_ELEMENT(id)   ((ParsingElement*)context->grammar->elements[id])\n",prefix);
+ dprintf(fd,"#define %s_REFERENCE(id) ((Reference*)context->grammar->elements[id])\n",prefix);
+
+
+
+ dprintf(fd,"#define %s_DIRECT        (context->memo == NULL && !context->grammar->isTimed && context->budget == 0 && context->profiler == NULL)\n",prefix);
+
+
+ dprintf(fd,"#define %s_SUCCESS(m)     %s_isSuccess(m)\n",prefix, prefix);
+ dprintf(fd,"#define %s_REMAINING      ((size_t)(context->iterator->available - (context->iterator->current - context->iterator->buffer)))\n",prefix);
+ dprintf(fd,"#define %s_REJECTS(id)    (context->grammar->first != NULL && %s_REMAINING > 0 && !context->grammar->first[id].nullable && !(context->grammar->first[id].bytes[(unsigned char)*(context->iterator->current) >> 3] & (1 << ((unsigned char)*(context->iterator->current) & 7))))\n",prefix, prefix);
+ dprintf(fd,"%s","#ifndef MATCH_STATS\n");
+ dprintf(fd,"%s","#define MATCH_STATS(m)     ParsingContext_registerMatch(context, (Element*)this, m)\n");
+ dprintf(fd,"%s","#endif\n\n");
+ dprintf(fd,"static inline bool %s_isSuccess(Match* m) {\n",prefix);
+ dprintf(fd,"%s","\treturn m != NULL && m != FAILURE && m->status == STATUS_MATCHED;\n");
+ dprintf(fd,"%s","}\n\n");
+
+
+ dprintf(fd,"static const struct {char type; const char* name;} %s_ELEMENTS[%d] = {\n",prefix, count);
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e == NULL) {
+   dprintf(fd,"%s","\t{0, NULL},\n");
+  } else {
+   dprintf(fd,"\t{'%c', ",e->type);
+   Grammar__writeCString(fd, e->name, e->name != NULL ? strlen(e->name) : 0);
+   dprintf(fd,"%s","},\n");
+  }
+ }
+ dprintf(fd,"%s","};\n\n");
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e != NULL && e->type == '#' && e->id == i) {
+   dprintf(fd,"static Match* %s_r%d(ParsingContext* context);\n",prefix, i);
+  } else if (Grammar__isGenerated(this, i)) {
+   dprintf(fd,"static Match* %s_e%d(ParsingElement* this, ParsingContext* context);\n",prefix, i);
+  }
+ }
+ dprintf(fd,"%s","\n");
+ for (int i=0 ; i<count ; i++) {
+  Element* e = this->elements[i];
+  if (e != NULL && e->type == '#' && e->id == i) {
+   Grammar__writeCReference(this, fd, prefix, (Reference*)e);
+  } else if (Grammar__isGenerated(this, i)) {
+   Grammar__writeCElement(this, fd, prefix, (ParsingElement*)e);
+  }
+ }
+ dprintf(fd,"bool %s_install(Grammar* g) {\n",prefix);
+ dprintf(fd,"%s","\tif (g->elements == NULL) {Grammar_prepare(g);}\n");
+ dprintf(fd,"\tif (g->elements == NULL || g->axiomCount + g->skipCount + 1 != %d) {return FALSE;}\n",count);
+ dprintf(fd,"\tfor (int i=0 ; i<%d ; i++) {\n",count);
+ dprintf(fd,"%s","\t\tElement* e = g->elements[i];\n");
+ dprintf(fd,"\t\tif (e == NULL) {if (%s_ELEMENTS[i].type != 0) {return FALSE;} continue;}\n",prefix);
+ dprintf(fd,"\t\tif (e->id != i || e->type != %s_ELEMENTS[i].type) {return FALSE;}\n",prefix);
+ dprintf(fd,"\t\tif ((e->name == NULL) != (%s_ELEMENTS[i].name == NULL)) {return FALSE;}\n",prefix);
+ dprintf(fd,"\t\tif (e->name != NULL && strcmp(e->name, %s_ELEMENTS[i].name) != 0) {return FALSE;}\n",prefix);
+ dprintf(fd,"%s","\t}\n");
+ for (int i=0 ; i<count ; i++) {
+  if (Grammar__isGenerated(this, i)) {
+   dprintf(fd,"\t((ParsingElement*)g->elements[%d])->recognize = %s_e%d;\n",i, prefix, i);
+  }
+ }
+ dprintf(fd,"%s","\treturn TRUE;\n");
+ dprintf(fd,"%s","}\n\n");
+ dprintf(fd,"%s","// EOF\n");
+ return 1;
+}
+
+
+
+
+
+
+
+Processor* Processor_new() {
+ Processor* this = (Processor*) gc_new(sizeof(Processor)); assert (this!=NULL); ;
+
+ this->callbacks = NULL;
+ this->callbacksCount = 0;
+ this->fallback = NULL;
+ this->nodeCallbacks = NULL;
+ this->nodeCallbacksCount = 0;
+ this->nodeFallback = NULL;
+ this->stack = NULL;
+ this->stackCount = 0;
+ this->stackCapacity = 0;
+ this->context = NULL;
+ return this;
+}
+
+void Processor_free(Processor* this) {
+ if (this != NULL) {
+  if (this->callbacks!=NULL) {; gc_free(this->callbacks); } ;
+  if (this->nodeCallbacks!=NULL) {; gc_free(this->nodeCallbacks); } ;
+  if (this->stack!=NULL) {; gc_free(this->stack); } ;
+ }
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+void Processor_register (Processor* this, int symbolID, ProcessorCallback callback ) {
+ assert(symbolID >= 0);
+ if (this->callbacksCount < (symbolID + 1)) {
+
+
+  int cur_count = this->callbacksCount;
+  int new_count = (symbolID + 1 > cur_count * 2 ? symbolID + 1 : cur_count * 2);
+  this->callbacks=gc_realloc(this->callbacks,new_count * sizeof(ProcessorCallback)); ;
+  this->callbacksCount = new_count;
+
+  while (cur_count < new_count) {
+   this->callbacks[cur_count] = NULL;
+   cur_count++;
+  }
+ }
+ this->callbacks[symbolID] = callback;
+}
+
+void Processor__push(Processor* this, Match* match) {
+ if (this->stackCount == this->stackCapacity) {
+  int capacity = (64 > this->stackCapacity * 2 ? 64 : this->stackCapacity * 2);
+  this->stack=gc_realloc(this->stack,capacity * sizeof(Match*)); ;
+  this->stackCapacity = capacity;
+ }
+ this->stack[this->stackCount++] = match;
+}
+
+int Processor_process (Processor* this, Match* match, int step) {
+
+
+
+ int base = this->stackCount;
+ Match* current = match;
+ while (current != NULL) {
+  assert(current->element != NULL);
+  int id = current->element->id;
+  ProcessorCallback handler = id >= 0 && id < this->callbacksCount ? this->callbacks[id] : NULL;
+  if (handler == NULL) {handler = this->fallback;}
+
+  Match* next = current == match ? NULL : current->next;
+  if (handler != NULL) {
+   handler (this, current);
+  } else if (current->children != NULL) {
+   if (next != NULL) {Processor__push(this, next);}
+   next = current->children;
+  }
+  if (next == NULL && this->stackCount > base) {
+   next = this->stack[--this->stackCount];
+  }
+  current = next;
+ }
+ return step;
+}
+
+void Processor_registerNode (Processor* this, int symbolID, ProcessorNodeCallback callback ) {
+ assert(symbolID >= 0);
+ if (this->nodeCallbacksCount < (symbolID + 1)) {
+  int cur_count = this->nodeCallbacksCount;
+  int new_count = (symbolID + 1 > cur_count * 2 ? symbolID + 1 : cur_count * 2);
+  this->nodeCallbacks=gc_realloc(this->nodeCallbacks,new_count * sizeof(ProcessorNodeCallback)); ;
+  this->nodeCallbacksCount = new_count;
+  while (cur_count < new_count) {
+   this->nodeCallbacks[cur_count] = NULL;
+   cur_count++;
+  }
+ }
+ this->nodeCallbacks[symbolID] = callback;
+}
+
+int Processor_processTree (Processor* this, MatchTree* tree, int node, int step) {
+
+
+ int current = node;
+ while (current >= 0) {
+  int id = tree->nodes[current].element;
+  ProcessorNodeCallback handler = id >= 0 && id < this->nodeCallbacksCount ? this->nodeCallbacks[id] : NULL;
+  if (handler == NULL) {handler = this->nodeFallback;}
+  if (handler != NULL) {
+   handler (this, tree, current);
+  } else if (tree->nodes[current].children >= 0) {
+   current = tree->nodes[current].children;
+   continue;
+  }
+
+
+  while (current != node && tree->nodes[current].next < 0) {
+   current = tree->nodes[current].parent;
+  }
+  current = current == node ? -1 : tree->nodes[current].next;
+ }
+ return step;
+}
+
+
+
+
+_Bool 
+    Element__reaches(Element* this, Element* target, 
+                                                     _Bool
+                                                         * visited, int count) {
+ if (this == target) {return 1;}
+ if (this == NULL || this->id < 0 || this->id >= count || visited[this->id]) {return 0;}
+ visited[this->id] = 1;
+ if (Reference_Is(this)) {
+  return Element__reaches((Element*)((Reference*)this)->element, target, visited, count);
+ }
+ for (Reference* child = ((ParsingElement*)this)->children ; child != NULL ; child = child->next) {
+  if (Element__reaches((Element*)child, target, visited, count)) {return 1;}
+ }
+ return 0;
+}
+
+
+
+Reference* Grammar__lastReference(Grammar* this) {
+ if (this->axiom == NULL || this->axiom->type != 'R') {return NULL;}
+ Reference* last = this->axiom->children;
+ while (last != NULL && last->next != NULL) {last = last->next;}
+ return last != NULL && Reference_IsMany(last) ? last : NULL;
+}
+
+
+
+
+Reference* Grammar__commitReference(Grammar* this) {
+ Reference* last = Grammar__lastReference(this);
+ if (last != NULL) {
+  int count = this->axiomCount + this->skipCount + 1;
+  
+ _Bool
+ * visited = (
+ _Bool
+ *) gc_calloc((size_t)count, sizeof(
+ _Bool
+ )) ; assert (visited!=NULL); ;
+  if (Element__reaches((Element*)last->element, (Element*)this->axiom, visited, count)) {last = NULL;}
+  if (visited!=NULL) {; gc_free(visited); } ;
+ }
+ return last;
+}
+
+
+
+
+_Bool 
+    Processor__handles(Processor* this, Element* element) {
+ return this->fallback != NULL || (element->id >= 0 && element->id < this->callbacksCount && this->callbacks[element->id] != NULL);
+}
+
+ParsingResult* Processor_parseIterator (Processor* this, Grammar* grammar, Iterator* iterator) {
+ Grammar__ensurePrepared(grammar);
+ ParsingContext* context = Grammar__acquireContext(grammar, iterator);
+ Reference* commit = Grammar__commitReference(grammar);
+
+
+
+ if (commit != NULL && !Processor__handles(this, (Element*)grammar->axiom) && !Processor__handles(this, (Element*)commit)) {
+  context->commit = commit;
+  context->processor = this;
+ }
+ ParsingResult* result = Grammar__parse(grammar, context);
+ context->processor = NULL;
+ if (context->commit != NULL) {
+
+
+
+  for (Match* child = Match_isSuccess(result->match) && !context->opened ? result->match->children : NULL ; child != NULL ; child = child->next) {
+   if (child->element != (Element*)context->commit) {Processor_process(this, child, 0);}
   }
+  context->commit = NULL;
+ } else if (Match_isSuccess(result->match)) {
+  Processor_process(this, result->match, 0);
  }
- if (handler != NULL) {
-  handler (this, match);
+ return result;
+}
+
+ParsingResult* Processor_parseString (Processor* this, Grammar* grammar, const char* text) {
+ Iterator* iterator = Iterator_FromString(text);
+ if (iterator != NULL) {
+  ParsingResult* result = Processor_parseIterator(this, grammar, iterator);
+  result->context->freeIterator = 1;
+  return result;
  } else {
-  Match* child = match->children;
-  while (child) {
-   step = Processor_process(this, child, step);
-   child = child->next;
+  errno = ENOENT;
+  return NULL;
+ }
+}
+
+
+
+
+
+
+
+Listener* Listener_new() {
+ Listener* this = (Listener*) gc_new(sizeof(Listener)); assert (this!=NULL); ;
+ this->enter = NULL;
+ this->exit = NULL;
+ this->commit = NULL;
+ this->iterator = NULL;
+ this->context = NULL;
+ return this;
+}
+
+void Listener_free(Listener* this) {
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+void Listener_send (Listener* this, Match* match) {
+
+
+ Match* current = match;
+ while (current != NULL) {
+  if (this->enter != NULL) {this->enter(this, Match_getElementID(current), current->offset, current->length);}
+  if (current->children != NULL) {
+   current = current->children;
+   continue;
+  }
+  while (current != NULL) {
+   if (this->exit != NULL) {this->exit(this, Match_getElementID(current), current->offset, current->length);}
+   if (current == match) {
+    current = NULL;
+   } else if (current->next != NULL) {
+    current = current->next;
+    break;
+   } else {
+    current = current->parent;
+   }
   }
  }
- return step;
+ if (this->commit != NULL) {this->commit(this, Match_getElementID(match), match->offset, match->length);}
+}
+
+ParsingResult* Listener_parseIterator (Listener* this, Grammar* grammar, Iterator* iterator) {
+ Grammar__ensurePrepared(grammar);
+ ParsingContext* context = Grammar__acquireContext(grammar, iterator);
+ context->commit = Grammar__commitReference(grammar);
+ context->listener = this;
+ this->iterator = iterator;
+ ParsingResult* result = Grammar__parse(grammar, context);
+ Reference* commit = context->commit;
+ context->listener = NULL;
+ context->commit = NULL;
+
+
+ if (context->opened) {
+  Match* axiom = result->match;
+  Match* last = Match_isSuccess(axiom) ? axiom->children : NULL;
+  while (last != NULL && last->next != NULL) {last = last->next;}
+  if (this->exit != NULL) {
+
+
+   size_t offset = context->iterator->offset;
+   this->exit(this, commit->id, last == NULL ? offset : last->offset, last == NULL ? 0 : last->length);
+   this->exit(this, grammar->axiom->id, last == NULL ? offset : axiom->offset, last == NULL ? 0 : axiom->length);
+  }
+  if (this->commit != NULL && last != NULL) {this->commit(this, grammar->axiom->id, axiom->offset, axiom->length);}
+ } else if (Match_isSuccess(result->match)) {
+  Listener_send(this, result->match);
+ }
+ this->iterator = NULL;
+ return result;
+}
+
+ParsingResult* Listener_parseString (Listener* this, Grammar* grammar, const char* text) {
+ Iterator* iterator = Iterator_FromString(text);
+ if (iterator != NULL) {
+  ParsingResult* result = Listener_parseIterator(this, grammar, iterator);
+  result->context->freeIterator = 1;
+  return result;
+ } else {
+  errno = ENOENT;
+  return NULL;
+ }
+}
+size_t Profiler__countdown(Profiler* this) {
+
+ this->seed ^= this->seed << 13;
+ this->seed ^= this->seed >> 7;
+ this->seed ^= this->seed << 17;
+ return 1 + (size_t)(this->seed % (2 * this->period - 1));
+}
+
+
+
+int Profiler__child(Profiler* this, int node, ParsingElement* element) {
+ int child = this->nodes[node].child;
+ while (child >= 0 && this->nodes[child].element != element) {child = this->nodes[child].sibling;}
+ if (child >= 0) {return child;}
+ if (this->count == this->nodesCapacity) {
+  this->nodesCapacity *= 2;
+  this->nodes=gc_realloc(this->nodes,sizeof(ProfileNode) * this->nodesCapacity); ;
+ }
+ child = this->count++;
+ ProfileNode* added = &(this->nodes[child]);
+ added->element = element;
+ added->parent = node;
+ added->child = -1;
+ added->sibling = this->nodes[node].child;
+ added->samples = 0;
+ this->nodes[node].child = child;
+ return child;
+}
+
+void Profiler__sample(Profiler* this) {
+ int node = 0;
+ for (int i=0 ; i<this->depth ; i++) {node = Profiler__child(this, node, this->stack[i]);}
+ this->nodes[node].samples += 1;
+ this->samples += 1;
+}
+
+Profiler* Profiler_new(size_t period) {
+ Profiler* this = (Profiler*) gc_new(sizeof(Profiler)); assert (this!=NULL); ;
+ ParsingElement** stack = (ParsingElement**) gc_calloc(64, sizeof(ParsingElement*)) ; assert (stack!=NULL); ;
+ ProfileNode* nodes = (ProfileNode*) gc_calloc(64, sizeof(ProfileNode)) ; assert (nodes!=NULL); ;
+ this->period = period == 0 ? 64 : period;
+ this->seed = 0x9E3779B97F4A7C15ULL;
+ this->samples = 0;
+ this->stack = stack;
+ this->depth = 0;
+ this->capacity = 64;
+ this->nodes = nodes;
+ this->count = 1;
+ this->nodesCapacity = 64;
+
+ nodes[0].element = NULL;
+ nodes[0].parent = -1;
+ nodes[0].child = -1;
+ nodes[0].sibling = -1;
+ nodes[0].samples = 0;
+ this->countdown = Profiler__countdown(this);
+ return this;
+}
+
+void Profiler_free(Profiler* this) {
+ if (this != NULL) {
+  if (this->stack!=NULL) {; gc_free(this->stack); } ;
+  if (this->nodes!=NULL) {; gc_free(this->nodes); } ;
+ }
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+void Profiler_enter(Profiler* this, ParsingElement* element) {
+ if (this->depth == this->capacity) {
+  this->capacity *= 2;
+  this->stack=gc_realloc(this->stack,sizeof(ParsingElement*) * this->capacity); ;
+ }
+ this->stack[this->depth++] = element;
+ if (--this->countdown == 0) {
+  Profiler__sample(this);
+  this->countdown = Profiler__countdown(this);
+ }
+}
+
+void Profiler_exit(Profiler* this) {
+ assert(this->depth > 0);
+ this->depth -= 1;
+}
+
+ParsingResult* Profiler_parseIterator (Profiler* this, Grammar* grammar, Iterator* iterator) {
+ Grammar__ensurePrepared(grammar);
+ ParsingContext* context = Grammar__acquireContext(grammar, iterator);
+ context->profiler = this;
+
+
+ Profiler_enter(this, grammar->axiom);
+ ParsingResult* result = Grammar__parse(grammar, context);
+ Profiler_exit(this);
+ context->profiler = NULL;
+ return result;
+}
+
+ParsingResult* Profiler_parseString (Profiler* this, Grammar* grammar, const char* text) {
+ Iterator* iterator = Iterator_FromString(text);
+ if (iterator != NULL) {
+  ParsingResult* result = Profiler_parseIterator(this, grammar, iterator);
+  result->context->freeIterator = 1;
+  return result;
+ } else {
+  errno = ENOENT;
+  return NULL;
+ }
+}
+
+
+
+void Profiler__writeFrame(Output* output, ParsingElement* element) {
+ if (element->name == NULL) {
+  Output_writef(output, "%c#%d", element->type, element->id);
+  return;
+ }
+ for (const char* c = element->name ; *c != '\0' ; c++) {
+  char frame = (*c == ';' || *c == ' ' || *c == '\n') ? '_' : *c;
+  Output_write(output, &frame, 1);
+ }
+}
+
+void Profiler_output(Profiler* this, Output* output) {
+
+
+ int* path = (int*) gc_calloc(this->count, sizeof(int)) ; assert (path!=NULL); ;
+ for (int i=1 ; i<this->count ; i++) {
+  if (this->nodes[i].samples == 0) {continue;}
+  int length = 0;
+  for (int node = i ; node > 0 ; node = this->nodes[node].parent) {path[length++] = node;}
+  for (int j=length - 1 ; j>=0 ; j--) {
+   Profiler__writeFrame(output, this->nodes[path[j]].element);
+   Output_writeString(output, j > 0 ? ";" : " ");
+  }
+  Output_writef(output, "%zu\n", this->nodes[i].samples);
+ }
+ if (path!=NULL) {; gc_free(path); } ;
+}
+Engine* Engine_new(void) {
+ Engine* this = (Engine*) gc_new(sizeof(Engine)); assert (this!=NULL); ;
+ EngineFrame* frames = (EngineFrame*) gc_calloc(64, sizeof(EngineFrame)) ; assert (frames!=NULL); ;
+ this->frames = frames;
+ this->depth = 0;
+ this->capacity = 64;
+ this->maxDepth = 0;
+ this->match = FAILURE;
+ return this;
+}
+
+void Engine_free(Engine* this) {
+ if (this != NULL) {
+  if (this->frames!=NULL) {; gc_free(this->frames); } ;
+ }
+ if (this!=NULL) {; gc_free(this); } ;
+}
+
+
+
+
+_Bool 
+    Engine__isStacked(ParsingElement* element) {
+ return element->recognize == Rule_recognize || element->recognize == Group_recognize;
+}
+
+
+
+EngineFrame* Engine__push(Engine* this, Element* element, 
+                                                         _Bool 
+                                                              wrapped, ParsingContext* context) {
+ if (this->maxDepth != 0 && this->depth >= this->maxDepth) {
+  if(context->grammar->isVerbose && !context->tooDeep){fprintf(stderr, "--- ");fprintf(stderr, "Aborted, nested deeper than %zu frames at %zu", this->maxDepth, context->iterator->offset);fprintf(stderr, "\n");;}
+  context->tooDeep = 1;
+  return NULL;
+ }
+ if (this->depth == this->capacity) {
+  this->capacity *= 2;
+  this->frames=gc_realloc(this->frames,sizeof(EngineFrame) * this->capacity); ;
+ }
+ EngineFrame* frame = &this->frames[this->depth++];
+ frame->element = element;
+ frame->state = 0;
+ frame->wrapped = wrapped;
+ return frame;
+}
+
+
+
+
+
+
+
+_Bool 
+    Engine__callReference(Engine* this, Reference* reference, ParsingContext* context) {
+ if (!context->tooDeep && Engine__push(this, (Element*)reference, 0, context) != NULL) {return 1;}
+ this->match = FAILURE;
+ return 0;
+}
+
+
+
+
+
+_Bool 
+    Engine__callElement(Engine* this, ParsingElement* element, ParsingContext* context) {
+ if (!context->tooDeep && Engine__isStacked(element) && Engine__push(this, (Element*)element, 1, context) != NULL) {return 1;}
+ this->match = context->tooDeep ? FAILURE : ParsingElement_recognize(element, context);
+ return 0;
+}
+
+
+
+void Engine__return(Engine* this, EngineFrame* frame, Match* match, ParsingContext* context) {
+ if (frame->wrapped) {
+  ParsingElement* element = (ParsingElement*)frame->element;
+  if (frame->memoized) {
+   ParsingElement__memoize(element, context, frame->offset, frame->memoCuts, match);
+   ParsingContext__reach(context, frame->reach);
+  }
+
+
+
+
+
+  if (context->profiler != NULL) {Profiler_exit(context->profiler);}
+ }
+ this->match = match;
+ this->depth -= 1;
+}
+
+
+
+
+
+_Bool 
+    Engine__enter(Engine* this, EngineFrame* frame, ParsingContext* context) {
+ ParsingElement* element = (ParsingElement*)frame->element;
+ frame->offset = context->iterator->offset;
+ frame->memoized = 0;
+ frame->start = -1;
+ if (!frame->wrapped) {return 1;}
+ if (ParsingContext__exceeds(context)) {
+  this->match = FAILURE;
+  this->depth -= 1;
+  return 0;
+ }
+ if (context->profiler != NULL) {Profiler_enter(context->profiler, element);}
+
+
+
+ if (ParsingElement__isMemoized(element, context)) {
+  Match* recalled = ParsingElement__recall(element, context);
+  if (recalled != NULL) {
+   Engine__return(this, frame, recalled, context);
+   return 0;
+  }
+  frame->memoized = 1;
+  frame->memoCuts = context->cuts;
+  frame->reach = context->reach;
+  context->reach = frame->offset + 1;
+ }
+ return 1;
+}
+
+
+void Engine__ruleEnd(Engine* this, EngineFrame* frame, ParsingContext* context) {
+ Match* result = frame->result;
+ if (frame->scoped) {ParsingContext_pop(context);}
+ if (Match_isSuccess(result)) {
+  result->length = frame->last->offset - result->offset + frame->last->length;
+ } else {
+  result = Match_fail(result);
+  Arena_rewind(context->arena, frame->mark);
+  ParsingContext_backtrack(context, frame->offset);
+ }
+ Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, result), context);
+}
+
+
+void Engine__runRule(Engine* this, EngineFrame* frame, ParsingContext* context) {
+ ParsingElement* element = (ParsingElement*)frame->element;
+ while (1) {
+  Match* match = this->match;
+  switch (frame->state) {
+   case 0:
+    if (!Engine__enter(this, frame, context)) {return;}
+    frame->result = FAILURE;
+    frame->last = NULL;
+    frame->mark = Arena_mark(context->arena);
+    frame->child = element->children;
+    frame->scoped = 0;
+    if (ParsingContext_rejects(context, element->id)) {
+     Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, FAILURE), context);
+     return;
+    }
+    frame->scoped = (element->flags & 0x04) || (context->flags & 0x2);
+    if (frame->scoped) {ParsingContext_push(context);}
+    frame->state = 1;
+    break;
+   case 1:
+    if (frame->child == NULL) {
+     Engine__ruleEnd(this, frame, context);
+     return;
+    }
+    frame->cuts = context->cuts;
+    frame->state = 2;
+    if (frame->child == context->commit) {ParsingContext__enclose(context, element, frame->result, frame->offset);}
+    if (Engine__callReference(this, frame->child, context)) {return;}
+    break;
+   case 2:
+   case 3:
+    if (Match_isSuccess(match)) {
+     if (frame->last == NULL) {
+      frame->result = Match_Success(match->length, element, context);
+      frame->result->offset = frame->offset;
+      frame->result->children = frame->last = match;
+     } else {
+      frame->last = frame->last->next = match;
+     }
+     match->parent = frame->result;
+     frame->child = frame->child->next;
+     frame->state = 1;
+     break;
+    }
+    Match_free(match);
+
+
+    if (frame->state == 2 && context->cuts == frame->cuts && ParsingElement_skip(element, context) > 0) {
+     frame->state = 3;
+     if (Engine__callReference(this, frame->child, context)) {return;}
+     break;
+    }
+    frame->result = Match_fail(frame->result);
+    Engine__ruleEnd(this, frame, context);
+    return;
+  }
+ }
+}
+
+
+
+
+_Bool 
+    Engine__groupNext(EngineFrame* frame, ParsingContext* context) {
+ while (frame->child != NULL) {
+  WordSet* words = frame->words;
+  if (words != NULL && words->start == frame->step) {
+   int i = WordSet_match(words, context->iterator->current, Iterator_remaining(context->iterator));
+   if (context->memo != NULL) {ParsingContext__reach(context, frame->offset + words->longest);}
+   frame->child = i >= 0 ? words->words[i] : words->words[words->count - 1]->next;
+   frame->step += i >= 0 ? i : words->count;
+   frame->words = words->next;
+   if (frame->child == NULL) {break;}
+   if (i < 0) {continue;}
+  }
+  if (ParsingContext_rejects(context, frame->child->id)) {
+   frame->child = frame->child->next;
+   frame->step += 1;
+   continue;
+  }
+  return 1;
+ }
+ return 0;
+}
+
+
+
+void Engine__groupEnd(Engine* this, EngineFrame* frame, Match* result, ParsingContext* context) {
+ if (!Match_isSuccess(result)) {
+  Arena_rewind(context->arena, frame->mark);
+  ParsingContext_backtrack(context, frame->offset);
+ }
+ Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, result), context);
+}
+
+
+void Engine__runGroup(Engine* this, EngineFrame* frame, ParsingContext* context) {
+ ParsingElement* element = (ParsingElement*)frame->element;
+ while (1) {
+  Match* match = this->match;
+  switch (frame->state) {
+   case 0:
+    if (!Engine__enter(this, frame, context)) {return;}
+    frame->mark = Arena_mark(context->arena);
+    frame->child = element->children;
+    frame->words = Group__wordSets(element, context);
+    frame->cuts = context->cuts;
+    frame->step = 0;
+    frame->state = 1;
+    break;
+   case 1:
+    if (!Engine__groupNext(frame, context)) {
+     Engine__groupEnd(this, frame, FAILURE, context);
+     return;
+    }
+    frame->state = 2;
+    if (Engine__callReference(this, frame->child, context)) {return;}
+    break;
+   case 2:
+    if (Match_isSuccess(match)) {
+
+     Match* result = Match_Success(match->length, element, context);
+     result->offset = frame->offset;
+     result->children = match;
+     match->parent = result;
+     Engine__groupEnd(this, frame, result, context);
+     return;
+    }
+    Match_free(match);
+    Arena_rewind(context->arena, frame->mark);
+    frame->child = context->cuts == frame->cuts ? frame->child->next : NULL;
+    frame->step += 1;
+    frame->state = 1;
+    break;
+  }
+ }
+}
+
+
+void Engine__referenceEnd(Engine* this, EngineFrame* frame, ParsingContext* context) {
+ Reference* reference = (Reference*)frame->element;
+ Match* result = frame->result;
+
+ if (context->iterator->offset != frame->end) {
+  ParsingContext_backtrack(context, frame->end);
+ }
+ 
+_Bool 
+     is_success = Match_isSuccess(result) || (reference == context->commit && frame->step > 0) ? 1 : 0;
+ switch (reference->cardinality) {
+  case '1':
+  case '+':
+   break;
+  case '?':
+  case '*':
+   is_success = 1;
+   break;
+  case '=':
+   if (is_success && result->length == 0) {
+    Match_fail(result);
+    Arena_rewind(context->arena, frame->mark);
+    Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, FAILURE), context);
+    return;
+   }
+   break;
+  default:
+   fprintf(stderr, "ERR ");fprintf(stderr, "Unsupported cardinality %c", reference->cardinality);fprintf(stderr, "\n");;
+   is_success = 0;
+   break;
+ }
+ if (is_success) {
+  Match* m = Match_SuccessFromReference(context->iterator->offset - frame->offset, reference, context);
+  m->children = result == FAILURE ? NULL : result;
+  m->offset = frame->offset;
+  for (Match* c = m->children ; c != NULL ; c = c->next) {c->parent = m;}
+  result = m;
+ } else {
+  result = Match_fail(result);
+  Arena_rewind(context->arena, frame->mark);
+ }
+ Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, result), context);
+}
+
+
+void Engine__runReference(Engine* this, EngineFrame* frame, ParsingContext* context) {
+ Reference* reference = (Reference*)frame->element;
+ ParsingElement* element = reference->element;
+ while (1) {
+  switch (frame->state) {
+   case 0:
+    frame->result = FAILURE;
+    frame->last = NULL;
+    frame->step = 0;
+    frame->offset = context->iterator->offset;
+    frame->end = frame->offset;
+    frame->mark = Arena_mark(context->arena);
+    frame->state = 1;
+    break;
+   case 1:
+    if (!Iterator_hasMore(context->iterator) && element->type != 'p' && element->type != 'c' && element->type != '!') {
+     Engine__referenceEnd(this, frame, context);
+     return;
+    }
+    frame->iteration = context->iterator->offset;
+    frame->cuts = context->cuts;
+    frame->state = 2;
+    if (Engine__callElement(this, element, context)) {return;}
+    break;
+   case 2: {
+    Match* match = this->match;
+    
+   _Bool 
+          parsed = context->iterator->offset != frame->iteration;
+    
+   _Bool 
+          more = 1;
+    if (Match_isSuccess(match)) {
+     frame->end = Match_getEndOffset(match);
+     if (reference == context->commit) {
+
+      ParsingContext__commit(context, match, frame->offset);
+      Match_free(match);
+      Arena_rewind(context->arena, frame->mark);
+      frame->step += 1;
+      more = parsed;
+     } else if (frame->step == 0) {
+      frame->result = frame->last = match;
+      frame->step += 1;
+      more = parsed && reference->cardinality != '1' && reference->cardinality != '?';
+     } else {
+      frame->last = frame->last->next = match;
+      frame->step += parsed ? 1 : 0;
+      more = parsed;
+     }
+    } else {
+     Match_free(match);
+
+     if (context->cuts != frame->cuts) {
+      Match_fail(frame->result);
+      Arena_rewind(context->arena, frame->mark);
+      ParsingContext_backtrack(context, frame->offset);
+      Engine__return(this, frame, ParsingContext_registerMatch(context, frame->element, FAILURE), context);
+      return;
+     }
+     more = ParsingElement_skip((ParsingElement*)reference, context) > 0;
+    }
+    if (!more || frame->offset == context->iterator->offset) {
+     Engine__referenceEnd(this, frame, context);
+     return;
+    }
+    frame->state = 1;
+    break;
+   }
+  }
+ }
+}
+
+Match* Engine_recognize(Engine* this, ParsingElement* element, ParsingContext* context) {
+ if (!Engine__isStacked(element)) {return element->recognize(element, context);}
+
+ size_t base = this->depth;
+ if (Engine__push(this, (Element*)element, 0, context) == NULL) {return FAILURE;}
+ while (this->depth > base) {
+  EngineFrame* frame = &this->frames[this->depth - 1];
+  if (Reference_Is(frame->element)) {
+   Engine__runReference(this, frame, context);
+  } else if (((ParsingElement*)frame->element)->recognize == Rule_recognize) {
+   Engine__runRule(this, frame, context);
+  } else {
+   Engine__runGroup(this, frame, context);
+  }
+ }
+ return this->match;
 }
 
 
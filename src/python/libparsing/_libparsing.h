@@ -2,6 +2,15 @@
 
 typedef char bool;
 
+/* Memory mapping, see Iterator_Map */
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+
+/* Threads, see Grammar_parseParallel */
+#include <unistd.h>
+#include <pthread.h>
+
 /* PCRE */
 #define PCRE_CASELESS           0x00000001  /* C1       */
 #define PCRE_MULTILINE          0x00000002  /* C1       */
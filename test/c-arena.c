@@ -0,0 +1,65 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the match arena:
+ *
+ * - Allocations are bumped, and rewinding to a mark reuses the memory.
+ * - Allocations larger than a block get a block of their own.
+ * - Parsing allocates matches in the context's arena, including tokens,
+ *   whose groups are spans of the input.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+void test_arena() {
+	Arena* arena   = Arena_new();
+	ArenaMark mark = Arena_mark(arena);
+	char* a = (char*)Arena_alloc(arena, 10);
+	char* b = (char*)Arena_alloc(arena, 10);
+	TEST_TRUE( b > a );
+	TEST_TRUE( ((size_t)b % sizeof(void*)) == 0 );
+	Arena_rewind(arena, mark);
+	TEST_TRUE( (char*)Arena_alloc(arena, 10) == a );
+	// A large allocation spills over a new block, that is kept after a
+	// rewind and reused.
+	char* c = (char*)Arena_alloc(arena, ARENA_BLOCK_SIZE * 2);
+	memset(c, 'c', ARENA_BLOCK_SIZE * 2);
+	TEST_TRUE( arena->allocated == ARENA_BLOCK_SIZE * 3 );
+	Arena_rewind(arena, mark);
+	TEST_TRUE( (char*)Arena_alloc(arena, ARENA_BLOCK_SIZE) != c );
+	TEST_TRUE( (char*)Arena_alloc(arena, ARENA_BLOCK_SIZE) == c );
+	TEST_TRUE( arena->allocated == ARENA_BLOCK_SIZE * 3 );
+	Arena_free(arena);
+}
+
+void test_parsing() {
+	Grammar* g = Grammar_new();
+	SYMBOL (NUMBER, TOKEN("(\\d+)"));
+	SYMBOL (COMMA,  WORD(","));
+	SYMBOL (WithComma, RULE(_S(NUMBER), _S(COMMA)));
+	SYMBOL (Value,  GROUP(_S(WithComma), _S(NUMBER)));
+	SYMBOL (Values, RULE(MANY(_S(Value))));
+	AXIOM(Values);
+	ParsingResult* r = Grammar_parseString(g, "1,22,333");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( HAS_FLAG(r->match->flags, MATCH_ARENA) ? TRUE : FALSE );
+	// The last value is the NUMBER alternative, whose token match is
+	// in the arena as well.
+	Match* values = r->match->children->children;
+	Match* last   = values->next->next->children->children;
+	TEST_TRUE( Match_getElementType(last) == TYPE_TOKEN );
+	TEST_TRUE( strcmp(TokenMatch_group(last, 1), "333") == 0 );
+	// Groups are spans of the input, strings are created on demand
+	TEST_TRUE( TokenMatch_groupLength(last, 1) == 3 );
+	TEST_TRUE( TokenMatch_groupStart(last, 1)  == ParsingResult_text(r) + 5 );
+	TEST_TRUE( TokenMatch_group(last, 1)       == TokenMatch_group(last, 1) );
+	ParsingResult_free(r);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_arena();
+	test_parsing();
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,178 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the binary match trees:
+ *
+ * - Trees read back from their binary form have the same nodes and groups,
+ *   from memory or from a mapped file, with or without their text.
+ * - Grammars built the same way have the same fingerprint, and trees only
+ *   load with a grammar of the same fingerprint.
+ * - Truncated or corrupted data is rejected.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS 1000
+#define STATEMENT  "\nabc = \"d\" + 23;"
+#define BINARY     ".build/c-binary.lpmt"
+
+Grammar* Grammar_create(const char* plus) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,        TOKEN("[ \n]+"));
+	SYMBOL (NAME,      TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,    TOKEN("[0-9]+"));
+	SYMBOL (STRING,    TOKEN("\"([^\"]*)\""));
+	SYMBOL (EQUALS,    WORD("="));
+	SYMBOL (PLUS,      WORD(plus));
+	SYMBOL (SEMICOLON, WORD(";"));
+	SYMBOL (Value,     GROUP(_S(NUMBER), _S(NAME), _S(STRING)));
+	SYMBOL (Suffix,    RULE(_S(PLUS), _S(Value)));
+	SYMBOL (Statement, RULE(_S(NAME), _S(EQUALS), _S(Value), _MO(Suffix), _S(SEMICOLON)));
+	SYMBOL (Statements, RULE(MANY(_S(Statement))));
+	AXIOM(Statements);
+	SKIP(WS);
+	return g;
+}
+
+// Tells if both trees have the same nodes and groups
+bool MatchTree_same(MatchTree* a, MatchTree* b) {
+	if (a->status != b->status || a->count != b->count || a->groupsCount != b->groupsCount) {return FALSE;}
+	if (a->count > 0 && memcmp(a->nodes, b->nodes, sizeof(MatchNode) * a->count) != 0) {return FALSE;}
+	if (a->groupsCount > 0 && memcmp(a->groups, b->groups, sizeof(TokenMatchGroup) * a->groupsCount) != 0) {return FALSE;}
+	return TRUE;
+}
+
+size_t Varint_size(uint64_t value) {
+	size_t size = 1;
+	while (value >= 0x80) {value >>= 7; size++;}
+	return size;
+}
+
+char* MatchTree_toJSON(MatchTree* tree) {
+	Output* output = Output_new();
+	MatchTree_outputJSON(tree, output);
+	char*   json   = strdup(Output_text(output));
+	Output_free(output);
+	return json;
+}
+
+int main (int argc, char** argv) {
+	Grammar* g      = Grammar_create("+");
+	size_t   length = strlen(STATEMENT) * STATEMENTS;
+	char*    text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+	MatchTree* tree = MatchTree_FromResult(Grammar_parseString(g, text));
+	TEST_TRUE( tree->status == STATUS_SUCCESS );
+	char*    json   = MatchTree_toJSON(tree);
+
+	// --- MEMORY -------------------------------------------------------------
+	Output* output = Output_new();
+	TEST_TRUE( MatchTree_writeBinary(tree, output, MATCH_TREE_TEXT) );
+	TEST_TRUE( strncmp(Output_text(output), MATCH_TREE_MAGIC, 4) == 0 );
+	// The nodes take a few bytes each, rather than the size of a node
+	TEST_TRUE( output->length < length + tree->count * sizeof(MatchNode) / 4 );
+	MatchTree* copy = MatchTree_FromBinary(g, Output_text(output), output->length);
+	TEST_TRUE( copy != NULL );
+	TEST_TRUE( MatchTree_same(tree, copy) );
+	// The text isn't copied
+	TEST_TRUE( copy->text > Output_text(output) && copy->text < Output_text(output) + output->length );
+	TEST_TRUE( copy->textLength == length && strncmp(copy->text, text, length) == 0 );
+	char* copied = MatchTree_toJSON(copy);
+	TEST_TRUE( strcmp(copied, json) == 0 );
+	free(copied);
+	MatchTree_free(copy);
+
+	// Without the text, the groups are not available
+	Output* nodes = Output_new();
+	TEST_TRUE( MatchTree_writeBinary(tree, nodes, 0) );
+	// The text length takes more bytes than the empty span, but that's all
+	TEST_TRUE( nodes->length + length + Varint_size(length) - 1 == output->length );
+	copy = MatchTree_FromBinary(g, Output_text(nodes), nodes->length);
+	TEST_TRUE( MatchTree_same(tree, copy) );
+	TEST_TRUE( copy->text == NULL && copy->groupsCount > 0 );
+	int grouped = 0;
+	while (copy->nodes[grouped].groupsCount == 0) {grouped++;}
+	TEST_TRUE( MatchTree_groupStart(tree, grouped, 0) != NULL );
+	TEST_TRUE( MatchTree_groupStart(copy, grouped, 0) == NULL );
+	MatchTree_free(copy);
+
+	// --- FILE ---------------------------------------------------------------
+	FILE* file = fopen(BINARY, "w");
+	TEST_TRUE( file != NULL );
+	Output* written = Output_ToFile(fileno(file));
+	TEST_TRUE( MatchTree_writeBinary(tree, written, MATCH_TREE_TEXT) );
+	Output_free(written);
+	fclose(file);
+	copy = MatchTree_readBinary(g, BINARY);
+	TEST_TRUE( copy != NULL && copy->mapped != NULL );
+	TEST_TRUE( MatchTree_same(tree, copy) );
+	copied = MatchTree_toJSON(copy);
+	TEST_TRUE( strcmp(copied, json) == 0 );
+	free(copied);
+	MatchTree_free(copy);
+	errno = 0;
+	TEST_TRUE( MatchTree_readBinary(g, ".build/c-binary-missing.lpmt") == NULL && errno == ENOENT );
+
+	// --- FINGERPRINTS -------------------------------------------------------
+	// A grammar built the same way loads the tree, but not another one
+	Grammar* same  = Grammar_create("+");
+	Grammar* other = Grammar_create("-");
+	TEST_TRUE( Grammar_fingerprint(same) == Grammar_fingerprint(g) );
+	TEST_TRUE( Grammar_fingerprint(other) != Grammar_fingerprint(g) );
+	copy = MatchTree_FromBinary(same, Output_text(output), output->length);
+	TEST_TRUE( copy != NULL && copy->grammar == same && MatchTree_same(tree, copy) );
+	MatchTree_free(copy);
+	errno = 0;
+	TEST_TRUE( MatchTree_FromBinary(other, Output_text(output), output->length) == NULL && errno == EINVAL );
+	Grammar_free(same);
+	Grammar_free(other);
+
+	// --- CORRUPTIONS --------------------------------------------------------
+	// Every truncation of the data is rejected, as is trailing data
+	char* data = malloc(nodes->length + 1);
+	memcpy(data, Output_text(nodes), nodes->length);
+	data[nodes->length] = 0;
+	int accepted = 0;
+	for (size_t i=0 ; i<nodes->length ; i++) {
+		copy = MatchTree_FromBinary(g, data, i);
+		if (copy != NULL) {accepted += 1; MatchTree_free(copy);}
+	}
+	TEST_TRUE( accepted == 0 );
+	TEST_TRUE( MatchTree_FromBinary(g, data, nodes->length + 1) == NULL );
+	data[4] = MATCH_TREE_FORMAT + 1;
+	TEST_TRUE( MatchTree_FromBinary(g, data, nodes->length) == NULL );
+	data[4] = MATCH_TREE_FORMAT;
+	// The root can't have a parent, which is the distance that follows its
+	// element id (after the counts and the empty text span).
+	size_t root = 15 + Varint_size(tree->count) + Varint_size(tree->groupsCount) + 2;
+	root += Varint_size(tree->nodes[0].element);
+	TEST_TRUE( data[root] == 0 );
+	data[root] = 1;
+	TEST_TRUE( MatchTree_FromBinary(g, data, nodes->length) == NULL );
+	data[root] = 0;
+	copy = MatchTree_FromBinary(g, data, nodes->length);
+	TEST_TRUE( copy != NULL );
+	MatchTree_free(copy);
+	free(data);
+	Output_free(nodes);
+	Output_free(output);
+	MatchTree_free(tree);
+
+	// --- FAILURES -----------------------------------------------------------
+	tree   = MatchTree_FromResult(Grammar_parseString(g, "= 1;"));
+	output = Output_new();
+	TEST_TRUE( MatchTree_writeBinary(tree, output, MATCH_TREE_TEXT) );
+	copy   = MatchTree_FromBinary(g, Output_text(output), output->length);
+	TEST_TRUE( copy != NULL && copy->status == STATUS_FAILED && copy->count == 0 );
+	MatchTree_free(copy);
+	Output_free(output);
+	MatchTree_free(tree);
+
+	free(json);
+	free(text);
+	Grammar_free(g);
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,155 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the memory accounting and budget of parses:
+ *
+ * - The stats hold the bytes of the matches, input, variables and memo
+ *   of the context once the parse is done.
+ * - Parses that exceed their budget are aborted early, with their own
+ *   status, and parses within it are not changed.
+ * - The contexts of aborted parses can be reused, and their memoization
+ *   tables don't keep the failures of the aborted recognitions.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS 100000
+#define STATEMENT  "\nlet abc = 123;"
+#define PATH       ".build/c-budget.txt"
+
+Grammar* Grammar_create(void) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,         TOKEN("[ \n]+"));
+	SYMBOL (NAME,       TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,     TOKEN("[0-9]+"));
+	SYMBOL (LET,        WORD("let"));
+	SYMBOL (EQUALS,     WORD("="));
+	SYMBOL (SEMICOLON,  WORD(";"));
+	SYMBOL (Statement,  RULE(_S(LET), _S(NAME), _S(EQUALS), _S(NUMBER), _S(SEMICOLON)));
+	SYMBOL (Statements, RULE(_M(Statement)));
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_prepare(g);
+	return g;
+}
+
+char* Text_create(void) {
+	size_t length = strlen(STATEMENT) * STATEMENTS;
+	char*  text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+	return text;
+}
+
+size_t ParsingStats_bytes(ParsingStats* stats) {
+	return stats->bytesMatches + stats->bytesInput + stats->bytesVariables + stats->bytesMemo;
+}
+
+void test_account() {
+	Grammar* g    = Grammar_create();
+	char*    text = Text_create();
+
+	// --- STRINGS ------------------------------------------------------------
+	// The text of a string isn't owned by the iterator
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingStats*  stats = r->context->stats;
+	TEST_TRUE( stats->bytesMatches == r->context->arena->allocated + (r->context->strings != NULL ? r->context->strings->allocated : 0) );
+	TEST_TRUE( stats->bytesMatches > strlen(text) );
+	TEST_TRUE( stats->bytesInput == 0 && stats->bytesVariables > 0 && stats->bytesMemo == 0 );
+	TEST_TRUE( ParsingContext_account(r->context) == ParsingStats_bytes(stats) );
+	size_t matches = stats->bytesMatches;
+	ParsingResult_free(r);
+
+	// --- FILES AND MEMO -----------------------------------------------------
+	FILE* file = fopen(PATH, "w");
+	TEST_TRUE( file != NULL );
+	fputs(text, file);
+	fclose(file);
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	r = Grammar_parsePath(g, PATH);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	stats = r->context->stats;
+	TEST_TRUE( stats->bytesInput >= strlen(text) );
+	TEST_TRUE( stats->bytesMemo == r->context->memo->bytes && stats->bytesMemo > 0 );
+	ParsingResult_free(r);
+	// Streams only hold their window
+	Grammar_setMemoize(g, 0);
+	r = Grammar_parseStream(g, PATH, 4096);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context->stats->bytesInput > 0 && r->context->stats->bytesInput < strlen(text) / 10 );
+	ParsingResult_free(r);
+
+	// --- BUDGET -------------------------------------------------------------
+	// A budget that the parse fits in doesn't change it
+	Grammar_setBudget(g, matches * 2);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->context->iterator->offset == strlen(text) );
+	TEST_TRUE( r->context->stats->bytesMatches == matches );
+	ParsingResult_free(r);
+	// A smaller one aborts the parse, as soon as it is exceeded
+	Grammar_setBudget(g, matches / 4);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isExceeded(r) && r->status == STATUS_EXCEEDED );
+	TEST_FALSE( ParsingResult_isSuccess(r) || ParsingResult_isFailure(r) || ParsingResult_isPartial(r) );
+	TEST_TRUE( ParsingStats_bytes(r->context->stats) > matches / 4 );
+	TEST_TRUE( r->context->stats->bytesMatches < matches / 2 );
+	TEST_TRUE( r->context->iterator->offset < strlen(text) / 2 );
+	ParsingResult_free(r);
+	// And so does a file that doesn't fit in it, as it is read
+	Grammar_setBudget(g, matches + strlen(text) / 2);
+	r = Grammar_parsePath(g, PATH);
+	TEST_TRUE( ParsingResult_isExceeded(r) && r->context->iterator->offset < strlen(text) );
+	ParsingResult_free(r);
+
+	free(text);
+	Grammar_free(g);
+}
+
+void test_reuse() {
+	Grammar* g    = Grammar_create();
+	char*    text = Text_create();
+	Grammar_setPool(g, 1);
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+
+	// The aborted recognitions are not memoized as failures, so that the
+	// parse can be given more memory and resumed from the same memo.
+	Grammar_setBudget(g, 1024 * 1024);
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isExceeded(r) );
+	Memo* memo = r->context->memo;
+	size_t failures = 0;
+	for (size_t i=0 ; i<memo->capacity ; i++) {
+		if (memo->entries[i].id != ID_UNBOUND && memo->entries[i].match == FAILURE) {failures++;}
+	}
+	TEST_TRUE( failures == 0 );
+	Grammar_setBudget(g, 0);
+	ParsingResult* s = Grammar_reparse(g, r, 0, 0, NULL);
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	ParsingResult_free(s);
+	ParsingResult_free(r);
+
+	// The pooled contexts take the budget of the grammar again
+	r = Grammar_parseString(g, STATEMENT);
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->context->budget == 0 && !r->context->exceeded );
+	ParsingResult_free(r);
+	Grammar_setBudget(g, 1);
+	r = Grammar_parseString(g, STATEMENT);
+	TEST_TRUE( ParsingResult_isExceeded(r) );
+	ParsingResult_free(r);
+	Grammar_setBudget(g, 0);
+	r = Grammar_parseString(g, STATEMENT);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingResult_free(r);
+
+	free(text);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_account();
+	test_reuse();
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,180 @@
+#include "parsing.h"
+#include "testing.h"
+#include <dlfcn.h>
+
+/**
+ * This test case exercises the C generator:
+ *
+ * - The generated code compiles, and installs on a grammar built by the
+ *   same code, but not on another grammar.
+ * - Parses with the generated recognizers give the same matches as the
+ *   library's, with and without memoization, and fail the same way past
+ *   a cut.
+ * - Parses with the generated recognizers are aborted past their budget,
+ *   and profiled, as with the library's.
+ *
+ * The generated code is compiled with `$CC` (or `cc`) in the build
+ * directory. Run this with `valgrind --leak-check=full`
+*/
+
+#define CODEGEN_C         ".build/c-codegen-expr.c"
+#define CODEGEN_SO        ".build/c-codegen-expr.so"
+#define BUDGET_STATEMENTS 200000
+
+typedef bool (*InstallCallback)(Grammar* g);
+
+bool isNotKeyword(ParsingElement* this, ParsingContext* context) {
+	return ParsingContext_charAt(context, context->iterator->offset) != '!';
+}
+
+Grammar* Grammar_create(void) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,         TOKEN("[ \t\n]+"));
+	SYMBOL (NUMBER,     TOKEN("[0-9]+"));
+	SYMBOL (NAME,       TOKEN("[a-z]+"));
+	SYMBOL (STRING,     TOKEN("\"([^\"]*)\""));
+	SYMBOL (PLUS,       WORD("+"));
+	SYMBOL (MINUS,      WORD("-"));
+	SYMBOL (TIMES,      WORD("*"));
+	SYMBOL (SEMICOLON,  WORD(";"));
+	SYMBOL (LET,        WORD("let"));
+	SYMBOL (EQUALS,     WORD("="));
+	// The words need escaping in the generated code
+	SYMBOL (QUOTED,     WORD("\\\"?\n"));
+	SYMBOL (NotKeyword, CONDITION(isNotKeyword));
+	SYMBOL (Operator,   GROUP(_S(PLUS), _S(MINUS), _S(TIMES)));
+	SYMBOL (Value,      GROUP(_S(NUMBER), _S(NAME), _S(STRING), _S(QUOTED)));
+	SYMBOL (Suffix,     RULE(_S(Operator), _S(Value)));
+	SYMBOL (Expression, RULE(_S(NotKeyword), _S(Value), _MO(Suffix)));
+	SYMBOL (Binding,    RULE(_S(LET), CUT(), _S(NAME), _S(EQUALS), _S(Expression)));
+	SYMBOL (Statement,  RULE(OPTIONAL(GROUP(_S(Binding), _S(Expression))), _S(SEMICOLON)));
+	SYMBOL (Statements, RULE(_MO(Statement)));
+	AXIOM(Statements);
+	SKIP(WS);
+	return g;
+}
+
+char* ParsingResult_toJSON(ParsingResult* r) {
+	FILE* file = tmpfile();
+	Match_writeJSON(r->match, fileno(file));
+	long  length = ftell(file);
+	char* json   = calloc(length + 1, 1);
+	rewind(file);
+	TEST_TRUE( fread(json, 1, length, file) == (size_t)length );
+	fclose(file);
+	return json;
+}
+
+const char* TEXT = "let a = 1 + b * \"c\";\n 2 - 3;; 4 + \\\"?\n - x ;";
+
+int main (int argc, char** argv) {
+	Grammar* g = Grammar_create();
+
+	// We generate the code and compile it
+	FILE* file = fopen(CODEGEN_C, "w");
+	TEST_TRUE( file != NULL );
+	TEST_TRUE( Grammar_writeC(g, fileno(file), "expr") );
+	fclose(file);
+	char command[1024];
+	snprintf(command, 1024, "%s -Wall -Werror -shared -fPIC -Isrc/h -o %s %s", getenv("CC") ? getenv("CC") : "cc", CODEGEN_SO, CODEGEN_C);
+	TEST_TRUE( system(command) == 0 );
+	void* library = dlopen("./" CODEGEN_SO, RTLD_NOW);
+	TEST_TRUE( library != NULL );
+	if (library == NULL) {printf("%s\n", dlerror()); return 1;}
+	InstallCallback install = (InstallCallback)dlsym(library, "expr_install");
+	TEST_TRUE( install != NULL );
+
+	// The reference parse, by the library
+	ParsingResult* r = Grammar_parseString(g, TEXT);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	char* expected = ParsingResult_toJSON(r);
+	int   count    = Match_countAll(r->match);
+	ParsingResult_free(r);
+	r = Grammar_parseString(g, "let a = ;");
+	char  status   = r->status;
+	ParsingResult_free(r);
+	// The binding fails past its cut, which fails the parse
+	r = Grammar_parseString(g, "1; let a = ;");
+	TEST_TRUE( ParsingResult_isFailure(r) );
+	size_t offset  = r->context->iterator->offset;
+	ParsingResult_free(r);
+	// The profile samples every recognition
+	Output*   output   = Output_new();
+	Profiler* profiler = Profiler_new(1);
+	ParsingResult_free(Profiler_parseString(profiler, g, TEXT));
+	Profiler_output(profiler, output);
+	char* profile  = strdup(Output_text(output));
+	Profiler_free(profiler);
+	Output_free(output);
+	Grammar_free(g);
+
+	// The code installs on a grammar built the same way
+	g = Grammar_create();
+	TEST_TRUE( install(g) );
+	TEST_TRUE( g->axiom->recognize != Rule_recognize );
+	r = Grammar_parseString(g, TEXT);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	char* json = ParsingResult_toJSON(r);
+	TEST_TRUE( strcmp(json, expected) == 0 );
+	TEST_TRUE( Match_countAll(r->match) == count );
+	free(json);
+	ParsingResult_free(r);
+
+	// Memoized parses go through the library, but use the generated
+	// recognizers as well.
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	r = Grammar_parseString(g, TEXT);
+	json = ParsingResult_toJSON(r);
+	TEST_TRUE( strcmp(json, expected) == 0 );
+	TEST_TRUE( r->context->stats->memoMisses > 0 );
+	free(json);
+	ParsingResult_free(r);
+
+	// Failures are the same
+	r = Grammar_parseString(g, "let a = ;");
+	TEST_TRUE( r->status == status );
+	ParsingResult_free(r);
+	r = Grammar_parseString(g, "1; let a = ;");
+	TEST_TRUE( ParsingResult_isFailure(r) && r->context->iterator->offset == offset );
+	ParsingResult_free(r);
+	Grammar_setMemoize(g, 0);
+
+	// The budget is checked even when only generated recognizers run, as
+	// the empty statements are only words.
+	char* text = malloc(BUDGET_STATEMENTS + 1);
+	memset(text, ';', BUDGET_STATEMENTS);
+	text[BUDGET_STATEMENTS] = '\0';
+	Grammar_setBudget(g, 4096);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isExceeded(r) && r->context->iterator->offset < strlen(text) );
+	ParsingResult_free(r);
+	Grammar_setBudget(g, 0);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingResult_free(r);
+	free(text);
+
+	// The profiles have the same stacks
+	output   = Output_new();
+	profiler = Profiler_new(1);
+	ParsingResult_free(Profiler_parseString(profiler, g, TEXT));
+	Profiler_output(profiler, output);
+	TEST_TRUE( strcmp(Output_text(output), profile) == 0 );
+	Profiler_free(profiler);
+	Output_free(output);
+	free(profile);
+	Grammar_free(g);
+
+	// But the code doesn't install on another grammar
+	g = Grammar_new();
+	SYMBOL (A, WORD("a"));
+	AXIOM(A);
+	TEST_FALSE( install(g) );
+	TEST_TRUE( g->axiom->recognize == Word_recognize );
+	Grammar_free(g);
+
+	free(expected);
+	dlclose(library);
+	TEST_SUCCEED;
+	return 0;
+}
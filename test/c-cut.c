@@ -0,0 +1,178 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the cuts:
+ *
+ * - Once a cut is passed, the groups don't try their other alternatives,
+ *   and the failure fails the parse, rather than giving a partial match.
+ * - Failures don't backtrack before the last cut.
+ * - The memoized recognitions before the cut are evicted first, and the
+ *   recognitions that pass a cut are not memoized.
+ * - Streams discard the input before the cut, even if it is in their
+ *   window.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS 100000
+#define STATEMENT  "\nlet abc = 123;"
+#define STREAM     ".build/c-cut.txt"
+
+Grammar* Grammar_create(bool cut) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,         TOKEN("[ \n]+"));
+	SYMBOL (NAME,       TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,     TOKEN("[0-9]+"));
+	SYMBOL (LET,        WORD("let"));
+	SYMBOL (EQUALS,     WORD("="));
+	SYMBOL (SEMICOLON,  WORD(";"));
+	SYMBOL (Assignment, RULE(_S(NAME), _S(EQUALS), _S(NUMBER)));
+	// The keyword is unambiguous, but expressions could start with it
+	SYMBOL (Binding,    cut
+		? RULE(_S(LET), CUT(), _S(Assignment), _S(SEMICOLON))
+		: RULE(_S(LET),        _S(Assignment), _S(SEMICOLON)));
+	SYMBOL (Expression, RULE(_S(NAME), _S(SEMICOLON)));
+	SYMBOL (Statement,  GROUP(_S(Binding), _S(Expression)));
+	SYMBOL (Statements, RULE(_M(Statement)));
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_prepare(g);
+	return g;
+}
+
+ParsingElement* Grammar_symbol(Grammar* g, const char* name) {
+	for (int i=0 ; i<g->axiomCount + g->skipCount + 1 ; i++) {
+		Element* e = g->elements[i];
+		if (e != NULL && ParsingElement_Is(e) && e->name != NULL && strcmp(e->name, name) == 0) {return (ParsingElement*)e;}
+	}
+	return NULL;
+}
+
+char ParsingResult_parse(Grammar* g, const char* text, size_t* offset) {
+	ParsingResult* r      = Grammar_parseString(g, text);
+	char           status = r->status;
+	if (offset != NULL) {*offset = r->context->iterator->offset;}
+	ParsingResult_free(r);
+	return status;
+}
+
+void test_cut() {
+	Grammar* g    = Grammar_create(TRUE);
+	Grammar* none = Grammar_create(FALSE);
+	size_t   offset = 0;
+
+	// --- ALTERNATIVES -------------------------------------------------------
+	TEST_TRUE( ParsingResult_parse(g,    "let a = 1; b;", NULL) == STATUS_SUCCESS );
+	// The expression matches `let;`, but isn't tried past the cut
+	TEST_TRUE( ParsingResult_parse(none, "let;", NULL) == STATUS_SUCCESS );
+	TEST_TRUE( ParsingResult_parse(g,    "let;", &offset) == STATUS_FAILED );
+	TEST_TRUE( offset == 3 );
+	// A statement that fails before the cut stops the statements
+	TEST_TRUE( ParsingResult_parse(g,    "a; 1", NULL) == STATUS_PARTIAL );
+
+	// --- FAILURES -----------------------------------------------------------
+	// Failures past the cut fail the parse, leaving the iterator at the
+	// cut rather than at the start.
+	TEST_TRUE( ParsingResult_parse(none, "a; let b = ;", NULL)    == STATUS_PARTIAL );
+	TEST_TRUE( ParsingResult_parse(g,    "a; let b = ;", &offset) == STATUS_FAILED );
+	TEST_TRUE( offset == 6 );
+	ParsingResult* r = Grammar_parseString(g, "let a = 1;\nlet b = 2;");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context->cuts == 2 && r->context->cut == 14 );
+	// The cuts are not part of the output
+	Output* output = Output_new();
+	Match_outputJSON(r->match, output);
+	TEST_TRUE( strstr(Output_text(output), "{\"name\":\"LET\",\"value\":\"let\"},{\"name\":\"Assignment\"") != NULL );
+	Output_free(output);
+	ParsingResult_free(r);
+
+	Grammar_free(none);
+	Grammar_free(g);
+}
+
+char* Text_create(void) {
+	size_t length = strlen(STATEMENT) * STATEMENTS;
+	char*  text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+	return text;
+}
+
+void test_memo() {
+	Grammar* g    = Grammar_create(TRUE);
+	Grammar* none = Grammar_create(FALSE);
+	char*    text = Text_create();
+	Grammar_setMemoize(g,    MEMO_LIMIT_DEFAULT);
+	Grammar_setMemoize(none, MEMO_LIMIT_DEFAULT);
+	ParsingResult* r = Grammar_parseString(none, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	size_t capacity  = r->context->memo->capacity;
+	ParsingResult_free(r);
+
+	// The memo holds the assignments after the last cut, and the ones
+	// before until it is full.
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	Memo* memo = r->context->memo;
+	TEST_TRUE( memo->floor == r->context->cut && memo->evicted > 0 );
+	TEST_TRUE( memo->capacity < capacity / 100 );
+	size_t below = 0;
+	for (size_t i=0 ; i<memo->capacity ; i++) {
+		if (memo->entries[i].id != ID_UNBOUND && memo->entries[i].offset < memo->evicted) {below++;}
+	}
+	TEST_TRUE( below == 0 );
+	// The last assignment was memoized, but not its statement, which
+	// passed the cut.
+	size_t cut = r->context->cut;
+	TEST_TRUE( Memo_get(memo, Grammar_symbol(g, "Assignment")->id, cut) != NULL );
+	TEST_TRUE( Memo_get(memo, Grammar_symbol(g, "Statement")->id,  cut - 4) == NULL );
+	ParsingResult_free(r);
+
+	// Memoized parses fail in the same way
+	size_t offset = 0;
+	TEST_TRUE( ParsingResult_parse(g, "let;", NULL) == STATUS_FAILED );
+	TEST_TRUE( ParsingResult_parse(g, "a; let b = ;", &offset) == STATUS_FAILED );
+	TEST_TRUE( offset == 6 );
+
+	free(text);
+	Grammar_free(none);
+	Grammar_free(g);
+}
+
+void test_stream() {
+	Grammar* g    = Grammar_create(TRUE);
+	char*    text = Text_create();
+	FILE*    file = fopen(STREAM, "w");
+	TEST_TRUE( file != NULL );
+	fputs(text, file);
+	fclose(file);
+
+	// The window could hold the whole input, but the input before the
+	// cuts is discarded.
+	ParsingResult* r = Grammar_parseStream(g, STREAM, strlen(text) * 2);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context->iterator->capacity < strlen(text) / 4 );
+	TEST_TRUE( Iterator_lineAt(r->context->iterator, r->context->cut) == STATEMENTS );
+	ParsingResult_free(r);
+
+	// A failure past the last cut doesn't need the discarded input
+	file = fopen(STREAM, "a");
+	fputs("\nlet x = ;", file);
+	fclose(file);
+	r = Grammar_parseStream(g, STREAM, strlen(text) * 2);
+	TEST_TRUE( ParsingResult_isFailure(r) && !r->context->iterator->truncated );
+	TEST_TRUE( r->context->iterator->offset == strlen(text) + 4 );
+	ParsingResult_free(r);
+
+	free(text);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_cut();
+	test_memo();
+	test_stream();
+	TEST_SUCCEED;
+	return 0;
+}
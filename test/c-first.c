@@ -0,0 +1,72 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the FIRST sets computed by `Grammar_prepare`:
+ *
+ * - Words start with their first character, tokens with what the regexp
+ *   tells us.
+ * - Groups are the union of their children, rules stop at the first child
+ *   that is not nullable.
+ * - Optional references are nullable, and skipped input extends the set.
+ * - Parsing still succeeds, and the rejected alternatives are not tried.
+*/
+
+#define HAS(s,c) (((s)->bytes[((unsigned char)(c)) >> 3] & (1 << (((unsigned char)(c)) & 7))) ? TRUE : FALSE)
+
+int main (int argc, char** argv) {
+	Grammar* g = Grammar_new();
+	SYMBOL (NUMBER,   TOKEN("[0-9]+"));
+	SYMBOL (VARIABLE, WORD("x"));
+	SYMBOL (PLUS,     WORD("+"));
+	SYMBOL (MINUS,    WORD("-"));
+	SYMBOL (SPACES,   TOKEN("[ ]+"));
+	SYMBOL (Value,    GROUP(_S(NUMBER), _S(VARIABLE)));
+	SYMBOL (Operator, GROUP(_S(PLUS), _S(MINUS)));
+	SYMBOL (Sign,     RULE(OPTIONAL(_S(MINUS)), _S(Value)));
+	SYMBOL (Suffix,   RULE(_S(Operator), _S(Sign)));
+	SYMBOL (Expr,     RULE(_S(Sign), MANY_OPTIONAL(_S(Suffix))));
+	AXIOM(Expr);
+	Grammar_prepare(g);
+
+	FirstSet* first = g->first;
+	TEST_TRUE( HAS(&first[s_VARIABLE->id], 'x') );
+	TEST_FALSE( HAS(&first[s_VARIABLE->id], 'y') );
+	TEST_FALSE( first[s_VARIABLE->id].nullable );
+	TEST_TRUE( HAS(&first[s_NUMBER->id], '7') );
+	TEST_FALSE( HAS(&first[s_NUMBER->id], 'x') );
+	TEST_TRUE( HAS(&first[s_Value->id], '7') );
+	TEST_TRUE( HAS(&first[s_Value->id], 'x') );
+	TEST_FALSE( HAS(&first[s_Value->id], '+') );
+	TEST_TRUE( HAS(&first[s_Operator->id], '+') );
+	TEST_TRUE( HAS(&first[s_Operator->id], '-') );
+	// The optional MINUS is nullable, so the rule starts with either
+	// a minus or a value.
+	TEST_TRUE( first[s_Sign->children->id].nullable );
+	TEST_TRUE( HAS(&first[s_Sign->id], '-') );
+	TEST_TRUE( HAS(&first[s_Sign->id], 'x') );
+	TEST_FALSE( HAS(&first[s_Sign->id], '+') );
+	TEST_FALSE( first[s_Sign->id].nullable );
+	TEST_TRUE( HAS(&first[s_Expr->id], 'x') );
+	TEST_FALSE( HAS(&first[s_Expr->id], ' ') );
+
+	ParsingResult* r = Grammar_parseString(g, "-1+x-20");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->match->length == 7 );
+	ParsingResult_free(r);
+
+	// Once we skip spaces, rules and references can start with a space
+	SKIP(SPACES);
+	Grammar_prepare(g);
+	first = g->first;
+	TEST_TRUE( HAS(&first[s_Expr->id], ' ') );
+	TEST_TRUE( HAS(&first[s_Sign->id], ' ') );
+	TEST_FALSE( HAS(&first[s_VARIABLE->id], ' ') );
+	r = Grammar_parseString(g, "-1 + x - 20");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingResult_free(r);
+
+	Grammar_free(g);
+	TEST_SUCCEED;
+	return 0;
+}
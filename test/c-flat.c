@@ -0,0 +1,219 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the match trees:
+ *
+ * - The nodes of the tree are the matches of the result in preorder,
+ *   linked to their parent, first child and next sibling.
+ * - The tree is written as JSON and XML the same way as the matches, and
+ *   keeps the groups of the tokens once the result is freed.
+ * - Processors dispatch the nodes of the tree to their callbacks.
+ * - Trees can be created without freeing the result, and exported to flat
+ *   arrays.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+int ValueID = -1;
+
+typedef struct Walk {
+	Match** matches;
+	int     count;
+} Walk;
+
+int Match_collect(Match* match, int step, void* walk) {
+	Walk* w = (Walk*)walk;
+	w->matches[w->count++] = match;
+	return step;
+}
+
+int MatchTree_countValues(MatchTree* tree, int node, int step, void* count) {
+	if (tree->nodes[node].element == ValueID) {*((int*)count) += 1;}
+	return step;
+}
+
+int MatchTree_stop(MatchTree* tree, int node, int step, void* count) {
+	*((int*)count) += 1;
+	return node == 3 ? -1 : step;
+}
+
+int Processed = 0;
+
+void Value_process(Processor* processor, MatchTree* tree, int node) {
+	// The value's child is the reference to one of the tokens
+	int reference = tree->nodes[node].children;
+	TEST_TRUE( reference == node + 1 );
+	TEST_TRUE( tree->nodes[reference].parent == node );
+	TEST_TRUE( tree->nodes[reference + 1].groupsCount > 0 );
+	Processed += 1;
+}
+
+Grammar* Grammar_create(void) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,        TOKEN("[ \n]+"));
+	SYMBOL (NAME,      TOKEN("([a-z]+)"));
+	SYMBOL (NUMBER,    TOKEN("[0-9]+"));
+	SYMBOL (STRING,    TOKEN("\"([^\"]*)\"(!?)"));
+	SYMBOL (EQUALS,    WORD("="));
+	SYMBOL (PLUS,      WORD("+"));
+	SYMBOL (SEMICOLON, WORD(";"));
+	SYMBOL (Value,     GROUP(_S(NUMBER), _S(NAME), _S(STRING)));
+	SYMBOL (Suffix,    RULE(_S(PLUS), _S(Value)));
+	SYMBOL (Statement, RULE(_S(NAME), _S(EQUALS), _S(Value), _MO(Suffix), _S(SEMICOLON)));
+	SYMBOL (Statements, RULE(MANY(_S(Statement))));
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_prepare(g);
+	ValueID = s_Value->id;
+	return g;
+}
+
+// Returns what the writer wrote, to be freed by the caller
+char* Output_read(FILE* file) {
+	long  length = ftell(file);
+	char* output = calloc(length + 1, 1);
+	rewind(file);
+	TEST_TRUE( fread(output, 1, length, file) == (size_t)length );
+	fclose(file);
+	return output;
+}
+
+const char* TEXT = "a = 1 + b;\nc = \"d\\te\"! + 23 + f;\n g = \"\";";
+
+int main (int argc, char** argv) {
+	Grammar* g = Grammar_create();
+	// The string iterator doesn't copy the text, which has to outlive the tree
+	char* text = strdup(TEXT);
+
+	// We keep the matches of a first result, to compare with the tree
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	int    count   = Match_countAll(r->match) + 1;
+	Walk   walk    = {calloc(count, sizeof(Match*)), 0};
+	Match__walk(r->match, Match_collect, 0, &walk);
+	FILE*  file    = tmpfile();
+	Match_writeJSON(r->match, fileno(file));
+	char*  json    = Output_read(file);
+	file           = tmpfile();
+	Match_writeXML(r->match, fileno(file));
+	char*  xml     = Output_read(file);
+
+	MatchTree* tree = MatchTree_FromResult(Grammar_parseString(g, text));
+	TEST_TRUE( tree->status == STATUS_SUCCESS );
+	TEST_TRUE( tree->count  == count );
+
+	// --- NODES --------------------------------------------------------------
+	for (int i=0 ; i<count ; i++) {
+		Match*     m    = walk.matches[i];
+		MatchNode* node = &tree->nodes[i];
+		TEST_TRUE( MatchTree_element(tree, i) == m->element );
+		TEST_TRUE( node->element == m->element->id );
+		TEST_TRUE( node->offset  == m->offset && node->length == m->length );
+		// Links are indexes of the walk
+		TEST_TRUE( node->children == (m->children == NULL ? -1 : i + 1) );
+		if (m->next != NULL) {
+			TEST_TRUE( node->next > i && walk.matches[node->next] == m->next );
+		} else {
+			TEST_TRUE( node->next == -1 );
+		}
+		if (m->parent != NULL) {
+			TEST_TRUE( node->parent >= 0 && walk.matches[node->parent] == m->parent );
+		} else {
+			TEST_TRUE( node->parent == -1 );
+		}
+		if (m->element->type == TYPE_TOKEN) {
+			TEST_TRUE( node->groupsCount == TokenMatch_count(m) );
+			for (int j=0 ; j<node->groupsCount ; j++) {
+				TEST_TRUE( MatchTree_groupLength(tree, i, j) == TokenMatch_groupLength(m, j) );
+				TEST_TRUE( strncmp(MatchTree_groupStart(tree, i, j), TokenMatch_group(m, j), TokenMatch_groupLength(m, j)) == 0 );
+			}
+		} else {
+			TEST_TRUE( node->groupsCount == 0 );
+		}
+	}
+	free(walk.matches);
+
+	// --- EXPORTING ----------------------------------------------------------
+	// The result is left as it is, and gives the same tree
+	MatchTree* borrowed = MatchTree_new(r);
+	TEST_TRUE( borrowed->count == count && borrowed->groupsCount == tree->groupsCount );
+	TEST_TRUE( memcmp(borrowed->nodes, tree->nodes, sizeof(MatchNode) * count) == 0 );
+	TEST_TRUE( ParsingResult_isSuccess(r) && Match_countAll(r->match) + 1 == count );
+	int*    elements = calloc(count,     sizeof(int));
+	int*    parents  = calloc(count,     sizeof(int));
+	size_t* offsets  = calloc(count,     sizeof(size_t));
+	size_t* lengths  = calloc(count,     sizeof(size_t));
+	int*    groups   = calloc(count + 1, sizeof(int));
+	size_t* spans    = calloc(borrowed->groupsCount * 2, sizeof(size_t));
+	MatchTree_export(borrowed, elements, parents, offsets, lengths, groups, spans);
+	for (int i=0 ; i<count ; i++) {
+		MatchNode* node = &tree->nodes[i];
+		TEST_TRUE( elements[i] == node->element && parents[i] == node->parent );
+		TEST_TRUE( offsets[i]  == node->offset  && lengths[i] == node->length );
+		TEST_TRUE( groups[i + 1] - groups[i] == node->groupsCount );
+		for (int j=0 ; j<node->groupsCount ; j++) {
+			size_t* span = &spans[(groups[i] + j) * 2];
+			TEST_TRUE( span[1] == (size_t)MatchTree_groupLength(tree, i, j) );
+			TEST_TRUE( text + span[0] == MatchTree_groupStart(borrowed, i, j) );
+		}
+	}
+	TEST_TRUE( groups[count] == tree->groupsCount );
+	// Arrays that are not needed are skipped
+	memset(parents, 0, sizeof(int) * count);
+	MatchTree_export(borrowed, NULL, parents, NULL, NULL, NULL, NULL);
+	TEST_TRUE( parents[0] == -1 && parents[count - 1] == tree->nodes[count - 1].parent );
+	free(elements);
+	free(parents);
+	free(offsets);
+	free(lengths);
+	free(groups);
+	free(spans);
+	MatchTree_free(borrowed);
+	ParsingResult_free(r);
+
+	// --- WALKING ------------------------------------------------------------
+	int values = 0;
+	TEST_TRUE( MatchTree_walk(tree, MatchTree_countValues, 0, &values) == count - 1 );
+	TEST_TRUE( values == 6 );
+	values = 0;
+	TEST_TRUE( MatchTree_walk(tree, MatchTree_stop, 0, &values) == -1 );
+	TEST_TRUE( values == 4 );
+
+	// --- WRITING ------------------------------------------------------------
+	file = tmpfile();
+	MatchTree_writeJSON(tree, fileno(file));
+	char* output = Output_read(file);
+	TEST_TRUE( strcmp(output, json) == 0 );
+	free(output);
+	file = tmpfile();
+	MatchTree_writeXML(tree, fileno(file));
+	output = Output_read(file);
+	TEST_TRUE( strcmp(output, xml) == 0 );
+	free(output);
+
+	// --- PROCESSING ---------------------------------------------------------
+	Processor* processor = Processor_new();
+	Processor_registerNode(processor, ValueID, Value_process);
+	TEST_TRUE( Processor_processTree(processor, tree, 0, 0) == 0 );
+	TEST_TRUE( Processed == 6 );
+	Processor_free(processor);
+	MatchTree_free(tree);
+
+	// --- FAILURES -----------------------------------------------------------
+	tree = MatchTree_FromResult(Grammar_parseString(g, "= 1;"));
+	TEST_TRUE( tree->status == STATUS_FAILED && tree->count == 0 );
+	file = tmpfile();
+	MatchTree_writeJSON(tree, fileno(file));
+	output = Output_read(file);
+	TEST_TRUE( strcmp(output, "null") == 0 );
+	free(output);
+	MatchTree_free(tree);
+
+	free(json);
+	free(xml);
+	free(text);
+	Grammar_free(g);
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,183 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the incremental parsing:
+ *
+ * - Reparsing an edited text gives the same matches as parsing it from
+ *   scratch, with the offsets, lines and token groups of the edited text.
+ * - The recognitions outside of the edit are served from the previous
+ *   memoization table, including the ones after the edit.
+ * - Matches that looked at the edited bytes are recognized again, including
+ *   the failures of tokens whose expressions examined them.
+ * - The parents of the matches are set.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS 200
+#define STATEMENT  "\nabc = 1 + 23;"
+
+Grammar* Grammar_create(void) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,         TOKEN("[ \n]+"));
+	SYMBOL (NAME,       TOKEN("([a-z]+)"));
+	SYMBOL (NUMBER,     TOKEN("([0-9]+)"));
+	SYMBOL (EQUALS,     WORD("="));
+	SYMBOL (PLUS,       WORD("+"));
+	SYMBOL (SEMICOLON,  WORD(";"));
+	SYMBOL (Value,      GROUP(_S(NUMBER), _S(NAME)));
+	SYMBOL (Suffix,     RULE(_S(PLUS), _S(Value)));
+	SYMBOL (Statement,  RULE(_S(NAME), _S(EQUALS), _S(Value), _MO(Suffix), _S(SEMICOLON)));
+	SYMBOL (Statements, RULE(MANY(_S(Statement))));
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	return g;
+}
+
+// Tells if both match trees are the same, with the lines looked up in
+// their iterators, and that their parents are set
+bool Match_same(Match* a, Match* b, Match* parent, Iterator* ia, Iterator* ib) {
+	for ( ; a != NULL && b != NULL ; a = a->next, b = b->next) {
+		if (a->element != b->element || a->offset != b->offset || a->length != b->length || Match_getLine(a, ia) != Match_getLine(b, ib)) {return FALSE;}
+		if (a->parent != parent) {return FALSE;}
+		if (a->element->type == TYPE_TOKEN && ((TokenMatch*)a->data)->count > 1 && strcmp(TokenMatch_group(a, 1), TokenMatch_group(b, 1)) != 0) {return FALSE;}
+		if (!Match_same(a->children, b->children, a, ia, ib)) {return FALSE;}
+	}
+	return a == NULL && b == NULL;
+}
+
+// Returns the offset of the nth occurence of the character in the text
+size_t String_nth(const char* text, char c, int n) {
+	const char* p = text;
+	for (int i=0 ; i<n ; i++) {p = strchr(p, c) + 1;}
+	return (size_t)(p - text) - 1;
+}
+
+// Reparses the result with the given edit, and checks it against a parse
+// of the edited text from scratch.
+ParsingResult* ParsingResult_edit(Grammar* g, ParsingResult* r, size_t offset, size_t removed, const char* inserted) {
+	ParsingResult* s = Grammar_reparse(g, r, offset, removed, inserted);
+	TEST_TRUE( s != NULL );
+	const char* text = ParsingResult_text(s);
+	TEST_TRUE( strlen(text) == strlen(ParsingResult_text(r)) - removed + strlen(inserted) );
+	TEST_TRUE( strncmp(text + offset, inserted, strlen(inserted)) == 0 );
+	ParsingResult* e = Grammar_parseString(g, text);
+	TEST_TRUE( s->status == e->status );
+	TEST_TRUE( Match_same(s->match, e->match, NULL, s->context->iterator, e->context->iterator) );
+	TEST_TRUE( s->context->iterator->offset == e->context->iterator->offset );
+	TEST_TRUE( s->context->stats->memoMisses < e->context->stats->memoMisses );
+	ParsingResult_free(e);
+	return s;
+}
+
+int main (int argc, char** argv) {
+	Grammar* g      = Grammar_create();
+	size_t   length = strlen(STATEMENT) * STATEMENTS;
+	char*    text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+	// The text is only read by the first reparse
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->match->parent == NULL && r->match->children->parent == r->match );
+	size_t misses = r->context->stats->memoMisses;
+
+	// --- REPLACING ----------------------------------------------------------
+	// A number in the middle is replaced, so that only the rules that
+	// enclose it are recognized again.
+	size_t middle = strlen(STATEMENT) * (STATEMENTS / 2) + 11;
+	ParsingResult* s = ParsingResult_edit(g, r, middle, 2, "456");
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	TEST_TRUE( s->context->stats->memoHits > 0 );
+	TEST_TRUE( s->context->stats->memoMisses < misses / 10 );
+	// The previous result still holds its matches, but not its table
+	TEST_TRUE( r->context->memo->count == 0 );
+	TEST_TRUE( r->match->length == length );
+	ParsingResult_free(r);
+	free(text);
+	r = s;
+
+	// --- INSERTING LINES ----------------------------------------------------
+	// The lines (and offsets) of the matches after the edit are shifted
+	s = ParsingResult_edit(g, r, middle - 11, 0, "\nx = y;\n\nz = 0;");
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	ParsingResult_free(r);
+	r = s;
+
+	// --- REMOVING -----------------------------------------------------------
+	s = ParsingResult_edit(g, r, 0, strlen(STATEMENT) * 2, "");
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	ParsingResult_free(r);
+	r = s;
+
+	// --- LOOKAHEAD ----------------------------------------------------------
+	// The tokens that end just before the edit are extended, so that the
+	// memoized values (and statements) that end there can't be reused.
+	s = ParsingResult_edit(g, r, 4, 0, "d");
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	Match* name = s->match;
+	while (name->children != NULL) {name = name->children;}
+	TEST_TRUE( name->offset == 1 && name->length == 4 );
+	ParsingResult_free(r);
+	r = s;
+	s = ParsingResult_edit(g, r, String_nth(ParsingResult_text(r), ';', 5), 0, "4");
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	ParsingResult_free(r);
+	r = s;
+
+	// --- BREAKING -----------------------------------------------------------
+	// A statement that doesn't parse anymore stops the parse, and fixing it
+	// gives a complete parse again.
+	size_t end       = strlen(ParsingResult_text(r));
+	size_t semicolon = String_nth(ParsingResult_text(r), ';', 10);
+	s = ParsingResult_edit(g, r, semicolon, 1, "");
+	TEST_TRUE( ParsingResult_isPartial(s) );
+	ParsingResult_free(r);
+	r = s;
+	s = ParsingResult_edit(g, r, semicolon, 0, ";");
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	TEST_TRUE( s->context->iterator->offset == end );
+	ParsingResult_free(r);
+	r = s;
+
+	// --- ERRORS -------------------------------------------------------------
+	errno = 0;
+	TEST_TRUE( Grammar_reparse(g, r, end + 1, 0, "") == NULL && errno == EINVAL );
+	TEST_TRUE( Grammar_reparse(g, r, end - 1, 2, "") == NULL && errno == EINVAL );
+	TEST_TRUE( Grammar_reparse(g, NULL, 0, 0, "")    == NULL && errno == EINVAL );
+
+	// Without memoization, the edited text is parsed as a whole
+	Grammar_setMemoize(g, 0);
+	s = Grammar_reparse(g, r, 0, 0, "a = b;");
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	TEST_TRUE( s->context->memo == NULL );
+	TEST_TRUE( s->match->length == end + 6 );
+	ParsingResult_free(s);
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	// --- TOKENS -------------------------------------------------------------
+	// The token failed on the edited byte, after its first bytes, and so
+	// does the rule that starts with it.
+	g = Grammar_new();
+	SYMBOL (AB,     TOKEN("a+b"));
+	SYMBOL (ABR,    RULE(_S(AB)));
+	SYMBOL (REST,   TOKEN("[a-zY]*;"));
+	SYMBOL (Values, RULE(_O(ABR), _S(REST)));
+	AXIOM(Values);
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	r = Grammar_parseString(g, "aaaY;");
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->match->children->children == NULL );
+	s = Grammar_reparse(g, r, 3, 1, "b");
+	ParsingResult* e = Grammar_parseString(g, "aaab;");
+	TEST_TRUE( ParsingResult_isSuccess(s) && s->match->children->children != NULL );
+	TEST_TRUE( Match_same(s->match, e->match, NULL, s->context->iterator, e->context->iterator) );
+	ParsingResult_free(e);
+	ParsingResult_free(s);
+	ParsingResult_free(r);
+	Grammar_free(g);
+	TEST_SUCCEED;
+	return 0;
+}
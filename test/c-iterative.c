@@ -0,0 +1,199 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the iterative engine:
+ *
+ * - The parses give the same matches, statuses and offsets as with the
+ *   recursive engine, with skipped input, word sets, cuts, memoization
+ *   and profiles.
+ * - Inputs nested deeper than the native stack allows are parsed.
+ * - Parses that nest deeper than the maximum depth are aborted, with their
+ *   own status, and the contexts and memoization tables of aborted parses
+ *   can be reused.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define NESTING 50000
+#define NESTED  500
+
+Grammar* Grammar_create(void) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,         TOKEN("[ \n]+"));
+	SYMBOL (NAME,       TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,     TOKEN("[0-9]+"));
+	SYMBOL (LET,        WORD("let"));
+	SYMBOL (EQUALS,     WORD("="));
+	SYMBOL (SEMICOLON,  WORD(";"));
+	SYMBOL (LP,         WORD("("));
+	SYMBOL (RP,         WORD(")"));
+	// The operators are resolved as a word set
+	SYMBOL (Operator,   GROUP(ONE(WORD("+")), ONE(WORD("-")), ONE(WORD("*")), ONE(WORD("/"))));
+	SYMBOL (Value,      GROUP(_S(NUMBER), _S(NAME)));
+	SYMBOL (Expression, RULE(_S(Value), MANY_OPTIONAL(RULE(_S(Operator), _S(Value)))));
+	// The parentheses nest the expressions
+	ParsingElement_add(s_Value, ONE(RULE(_S(LP), _S(Expression), _S(RP))));
+	SYMBOL (Binding,    RULE(_S(LET), CUT(), _S(NAME), _S(EQUALS), _S(Expression), _S(SEMICOLON)));
+	SYMBOL (Statement,  GROUP(_S(Binding), ONE(RULE(_S(Expression), _S(SEMICOLON)))));
+	SYMBOL (Statements, RULE(_M(Statement)));
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_prepare(g);
+	return g;
+}
+
+// Returns the text of an expression nested in `depth` parentheses
+char* Text_create(int depth) {
+	char* text = malloc(depth * 2 + 3);
+	for (int i=0 ; i<depth ; i++) {
+		text[i]             = '(';
+		text[depth + 1 + i] = ')';
+	}
+	text[depth]         = '1';
+	text[depth * 2 + 1] = ';';
+	text[depth * 2 + 2] = '\0';
+	return text;
+}
+
+// Returns the JSON of the match, which the caller frees
+char* Match_json(Match* match) {
+	Output* output = Output_new();
+	Match_outputJSON(match, output);
+	char*   json   = strdup(Output_text(output));
+	Output_free(output);
+	return json;
+}
+
+// Parses the text with both engines, checking that they give the same
+// results.
+void Grammar_compare(Grammar* g, const char* text) {
+	Grammar_setEngine(g, ENGINE_RECURSIVE, 0);
+	ParsingResult* r = Grammar_parseString(g, text);
+	Grammar_setEngine(g, ENGINE_ITERATIVE, 0);
+	ParsingResult* s = Grammar_parseString(g, text);
+	TEST_TRUE( r->status == s->status );
+	TEST_TRUE( r->context->iterator->offset == s->context->iterator->offset );
+	TEST_TRUE( r->context->lastMatchOffset    == s->context->lastMatchOffset );
+	TEST_TRUE( r->context->lastMatchLength    == s->context->lastMatchLength );
+	TEST_TRUE( r->context->lastMatchElementID == s->context->lastMatchElementID );
+	TEST_TRUE( r->context->stats->memoHits   == s->context->stats->memoHits );
+	TEST_TRUE( r->context->stats->memoMisses == s->context->stats->memoMisses );
+	TEST_TRUE( (r->match == FAILURE) == (s->match == FAILURE) );
+	if (r->match != FAILURE && s->match != FAILURE) {
+		char* a = Match_json(r->match);
+		char* b = Match_json(s->match);
+		TEST_TRUE( strcmp(a, b) == 0 );
+		free(a);
+		free(b);
+	}
+	ParsingResult_free(s);
+	ParsingResult_free(r);
+}
+
+// Returns the depth of the match, following its longest children
+int Match_depth(Match* match) {
+	int depth = 0;
+	while (match != NULL) {
+		Match* longest = match->children;
+		for (Match* c = match->children ; c != NULL ; c = c->next) {
+			if (c->length > longest->length) {longest = c;}
+		}
+		match  = longest;
+		depth += 1;
+	}
+	return depth;
+}
+
+void test_compare() {
+	Grammar* g = Grammar_create();
+	const char* texts[] = {
+		"let a = 1 + (2 * b);\nc - 3;", "x;let y = (((4)));z * (1 - 2);",
+		"a + (b;", "1;let = 1;", "let;", "((1))", "a; 1 +", "", NULL
+	};
+	char* nested = Text_create(100);
+
+	// --- MATCHES ------------------------------------------------------------
+	for (int i=0 ; texts[i] != NULL ; i++) {Grammar_compare(g, texts[i]);}
+	Grammar_compare(g, nested);
+	// And so with memoization, which gives the same hits
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	for (int i=0 ; texts[i] != NULL ; i++) {Grammar_compare(g, texts[i]);}
+	Grammar_compare(g, nested);
+	Grammar_setMemoize(g, 0);
+
+	// --- PROFILES -----------------------------------------------------------
+	// The same elements are recognized, in the same order
+	Profiler* p = Profiler_new(1);
+	Profiler* q = Profiler_new(1);
+	Grammar_setEngine(g, ENGINE_RECURSIVE, 0);
+	ParsingResult_free(Profiler_parseString(p, g, texts[0]));
+	Grammar_setEngine(g, ENGINE_ITERATIVE, 0);
+	ParsingResult_free(Profiler_parseString(q, g, texts[0]));
+	TEST_TRUE( p->samples == q->samples && p->samples > 0 && q->depth == 0 );
+	Output* a = Output_new();
+	Output* b = Output_new();
+	Profiler_output(p, a);
+	Profiler_output(q, b);
+	TEST_TRUE( strcmp(Output_text(a), Output_text(b)) == 0 );
+	Output_free(a);
+	Output_free(b);
+	Profiler_free(q);
+	Profiler_free(p);
+
+	free(nested);
+	Grammar_free(g);
+}
+
+void test_depth() {
+	Grammar* g    = Grammar_create();
+	char*    text = Text_create(NESTING);
+
+	// --- NESTING ------------------------------------------------------------
+	// The recursive engine would run out of stack here
+	Grammar_setEngine(g, ENGINE_ITERATIVE, 0);
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->context->iterator->offset == strlen(text) );
+	TEST_TRUE( r->context->engine->depth == 0 && r->context->engine->capacity > NESTING );
+	TEST_TRUE( Match_depth(r->match) > NESTING * 4 );
+	ParsingResult_free(r);
+
+	// --- MAXIMUM DEPTH ------------------------------------------------------
+	// A parse that nests deeper is aborted, and the ones within it are not
+	// changed. Memoizing the nested expressions copies them at each level,
+	// so they are not nested as deep here.
+	free(text);
+	text = Text_create(NESTED);
+	Grammar_setPool(g, 1);
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	Grammar_setEngine(g, ENGINE_ITERATIVE, 1000);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isTooDeep(r) && r->status == STATUS_TOO_DEEP );
+	TEST_FALSE( ParsingResult_isSuccess(r) || ParsingResult_isFailure(r) || ParsingResult_isPartial(r) );
+	TEST_TRUE( r->context->engine->depth == 0 );
+	// The aborted recognitions are not memoized as failures, so that the
+	// parse can be resumed from the same memo.
+	Grammar_setEngine(g, ENGINE_ITERATIVE, 0);
+	ParsingResult* s = Grammar_reparse(g, r, 0, 0, NULL);
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	ParsingResult_free(s);
+	ParsingResult_free(r);
+	// The pooled contexts are not aborted anymore
+	Grammar_setEngine(g, ENGINE_ITERATIVE, 1000);
+	r = Grammar_parseString(g, "let a = ((1));");
+	TEST_TRUE( ParsingResult_isSuccess(r) && !r->context->tooDeep );
+	ParsingResult_free(r);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isTooDeep(r) );
+	ParsingResult_free(r);
+
+	free(text);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_compare();
+	test_depth();
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the line index:
+ *
+ * - The line of an offset is the number of separators before it.
+ * - Lookups work in any order, and after backtracking.
+ * - Matches get the line of their first character, looked up when it is
+ *   first requested.
+ * - The offsets of the lines in the input that the window discarded are
+ *   not kept, but they still count in the lines after them.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define LINES  100000
+#define WINDOW 1024
+#define PATH   "c-lines.txt"
+
+int main (int argc, char** argv) {
+	const char* text = "a\nbb\n\nccc\n";
+	Iterator* iterator = Iterator_FromString(text);
+	TEST_TRUE( Iterator_getLine(iterator) == 0 );
+	TEST_TRUE( Iterator_lineAt(iterator, 1)  == 0 );
+	TEST_TRUE( Iterator_lineAt(iterator, 2)  == 1 );
+	TEST_TRUE( Iterator_lineAt(iterator, 6)  == 3 );
+	TEST_TRUE( Iterator_lineAt(iterator, 10) == 4 );
+	TEST_TRUE( Iterator_lineAt(iterator, 3)  == 1 );
+	TEST_TRUE( Iterator_lineAt(iterator, 5)  == 2 );
+	Iterator_moveTo(iterator, 7);
+	TEST_TRUE( Iterator_getLine(iterator) == 3 );
+	Iterator_backtrack(iterator, 2);
+	TEST_TRUE( Iterator_getLine(iterator) == 1 );
+	Iterator_free(iterator);
+
+	Grammar* g = Grammar_new();
+	SYMBOL (NAME,  TOKEN("[a-z]+"));
+	SYMBOL (EOLS,  TOKEN("\n+"));
+	SYMBOL (Line,  RULE(_S(NAME), _S(EOLS)));
+	SYMBOL (Lines, RULE(MANY(_S(Line))));
+	AXIOM(Lines);
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	Match* line = r->match->children->children;
+	TEST_TRUE( line->line == SIZE_MAX );
+	TEST_TRUE( Match_getLine(line, r->context->iterator) == 0 );
+	TEST_TRUE( Match_getLine(line->next, r->context->iterator) == 1 );
+	TEST_TRUE( Match_getLine(line->next->next, r->context->iterator) == 3 );
+	TEST_TRUE( line->line == 0 );
+	TEST_TRUE( Iterator_getLine(r->context->iterator) == 4 );
+	ParsingResult_free(r);
+
+	// --- WINDOW -------------------------------------------------------------
+	FILE* f = fopen(PATH, "w");
+	for (int i=0 ; i<LINES ; i++) {fprintf(f, "line\n");}
+	fclose(f);
+	r = Grammar_parseStream(g, PATH, WINDOW);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	// Only the separators in the buffered input are kept
+	TEST_TRUE( r->context->iterator->lineIndex->count <= r->context->iterator->available );
+	TEST_TRUE( r->context->iterator->lineIndex->base  >  0 );
+	TEST_TRUE( Iterator_getLine(r->context->iterator) == LINES );
+	size_t count = 0;
+	// The lines of the matches were set as the window discards the input
+	line = r->match->children->children;
+	for ( ; line != NULL && Match_getLine(line, NULL) == count ; line = line->next) {count++;}
+	TEST_TRUE( count == LINES );
+	ParsingResult_free(r);
+	remove(PATH);
+	Grammar_free(g);
+
+	TEST_SUCCEED;
+	return 0;
+}
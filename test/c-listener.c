@@ -0,0 +1,280 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the listeners:
+ *
+ * - The enter and exit events are sent in the order of the match tree's
+ *   nodes, with the same elements and offsets.
+ * - The statements are sent and committed as soon as they are recognized,
+ *   and released, so that the memory of the parse stays flat.
+ * - The events sent during the parse nest as those of the whole tree, the
+ *   axiom and its children before the statements being sent first.
+ * - Failed parses send nothing, and grammars whose statements could contain
+ *   the axiom again are sent once the parse is done.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS 10000
+#define STATEMENT  "\nabc = 1 + 23;"
+#define STREAM     ".build/c-listener.txt"
+
+typedef struct Events {
+	int    enters;
+	int    exits;
+	int    commits;
+	int    depth;       // The current depth, which exits must not leave negative
+	int    maximum;     // The deepest depth reached
+	bool   balanced;
+	size_t numbers;     // The bytes of the numbers, as read from the input
+	int    number;      // The id of the NUMBER element
+	int*   elements;    // The elements of the enter events, when recording
+	size_t* offsets;
+	int*   parents;     // The elements of the parents of the enter events, -1 for the root
+	int    recorded;
+	int    capacity;    // The number of events that can be recorded
+	int    stack[32];   // The elements that were entered and not exited yet
+	int    exited;      // The element of the last exit event
+} Events;
+
+void Events_enter(Listener* listener, int element, size_t offset, size_t length) {
+	Events* events = (Events*)listener->context;
+	if (events->elements != NULL && events->recorded < events->capacity) {
+		events->elements[events->recorded] = element;
+		events->offsets[events->recorded]  = offset;
+		if (events->parents != NULL) {events->parents[events->recorded] = events->depth > 0 ? events->stack[events->depth - 1] : -1;}
+		events->recorded += 1;
+	}
+	if (events->depth < 32) {events->stack[events->depth] = element;}
+	if (element == events->number) {
+		// The input of the match can be read while it is sent
+		for (size_t i=0 ; i<length ; i++) {
+			char c = Iterator_charAt(listener->iterator, offset + i);
+			if (c >= '0' && c <= '9') {events->numbers++;}
+		}
+	}
+	events->enters += 1;
+	events->depth  += 1;
+	events->maximum = MAX(events->maximum, events->depth);
+}
+
+void Events_exit(Listener* listener, int element, size_t offset, size_t length) {
+	Events* events = (Events*)listener->context;
+	events->exits += 1;
+	events->depth -= 1;
+	// The exit event is the one of the last match entered
+	if (events->depth < 0 || (events->depth < 32 && events->stack[events->depth] != element)) {events->balanced = FALSE;}
+	events->exited = element;
+}
+
+void Events_commit(Listener* listener, int element, size_t offset, size_t length) {
+	Events* events = (Events*)listener->context;
+	events->commits += 1;
+	if (element != events->exited) {events->balanced = FALSE;}
+}
+
+void Events_record(Events* events, int capacity) {
+	events->elements = calloc(capacity, sizeof(int));
+	events->offsets  = calloc(capacity, sizeof(size_t));
+	events->parents  = calloc(capacity, sizeof(int));
+	events->capacity = capacity;
+}
+
+void Events_free(Events* events) {
+	free(events->elements);
+	free(events->offsets);
+	free(events->parents);
+}
+
+Grammar* Grammar_create(bool recursive, bool header) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,        TOKEN("[ \n]+"));
+	SYMBOL (NAME,      TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,    TOKEN("[0-9]+"));
+	SYMBOL (EQUALS,    WORD("="));
+	SYMBOL (PLUS,      WORD("+"));
+	SYMBOL (SEMICOLON, WORD(";"));
+	SYMBOL (Value,     GROUP(_S(NUMBER), _S(NAME)));
+	SYMBOL (Statement, RULE(_S(NAME), _S(EQUALS), _S(Value), _S(PLUS), _S(Value), _S(SEMICOLON)));
+	// The header is a name before the statements, as in `main;`
+	SYMBOL (Statements, header ? RULE(_S(NAME), _S(SEMICOLON), MANY(_S(Statement))) : RULE(MANY(_S(Statement))));
+	if (recursive) {
+		SYMBOL (LB,    WORD("{"));
+		SYMBOL (RB,    WORD("}"));
+		SYMBOL (Block, RULE(_S(LB), _S(Statements), _S(RB)));
+		ParsingElement_add(s_Value, Reference_Ensure(s_Block));
+	}
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_prepare(g);
+	return g;
+}
+
+char* Text_create(void) {
+	size_t length = strlen(STATEMENT) * STATEMENTS;
+	char*  text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+	return text;
+}
+
+int Grammar_symbol(Grammar* g, const char* name) {
+	for (int i=0 ; i<g->axiomCount + g->skipCount + 1 ; i++) {
+		Element* e = g->elements[i];
+		if (e != NULL && ParsingElement_Is(e) && e->name != NULL && strcmp(e->name, name) == 0) {return e->id;}
+	}
+	return -1;
+}
+
+void Events_reset(Events* events, Grammar* g) {
+	memset(events, 0, sizeof(Events));
+	events->balanced = TRUE;
+	events->number   = Grammar_symbol(g, "NUMBER");
+}
+
+Listener* Listener_create(Grammar* g, Events* events) {
+	Listener* l = Listener_new();
+	Events_reset(events, g);
+	l->enter    = Events_enter;
+	l->exit     = Events_exit;
+	l->commit   = Events_commit;
+	l->context  = events;
+	return l;
+}
+
+void test_events() {
+	// The events of a match are those of the nodes of its tree
+	Grammar*  g = Grammar_create(FALSE, FALSE);
+	Events    events;
+	Listener* l = Listener_create(g, &events);
+	const char* text = "a = 1 + 2;\nb = c + 34;";
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	MatchTree* tree  = MatchTree_new(r);
+	Events_record(&events, tree->count);
+	l->iterator      = r->context->iterator;
+	Listener_send(l, r->match);
+	TEST_TRUE( events.enters == tree->count && events.exits == tree->count );
+	TEST_TRUE( events.commits == 1 && events.balanced && events.depth == 0 );
+	bool same = TRUE;
+	for (int i=0 ; i<tree->count ; i++) {
+		same = same && events.elements[i] == tree->nodes[i].element && events.offsets[i] == tree->nodes[i].offset;
+	}
+	TEST_TRUE( same );
+	TEST_TRUE( events.numbers == 4 );
+	Events_free(&events);
+	MatchTree_free(tree);
+	ParsingResult_free(r);
+
+	// Failed parses don't send anything
+	Events_reset(&events, g);
+	r = Listener_parseString(l, g, "a = ;");
+	TEST_TRUE( ParsingResult_isFailure(r) && events.enters == 0 && events.commits == 0 );
+	ParsingResult_free(r);
+	Listener_free(l);
+	Grammar_free(g);
+}
+
+void test_stream() {
+	Grammar* g    = Grammar_create(FALSE, FALSE);
+	char*    text = Text_create();
+	Events   parsed;
+	Listener* l   = Listener_create(g, &parsed);
+
+	// The events are the same as sending the result once parsed
+	ParsingResult* r = Grammar_parseString(g, text);
+	l->iterator      = r->context->iterator;
+	Listener_send(l, r->match);
+	size_t allocated = r->context->arena->allocated;
+	ParsingResult_free(r);
+	Events during;
+	Events_reset(&during, g);
+	l->context = &during;
+	r = Listener_parseString(l, g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( during.enters == parsed.enters && during.exits == parsed.exits && during.numbers == parsed.numbers );
+	TEST_TRUE( during.maximum == parsed.maximum && during.balanced && during.depth == 0 );
+	// Each statement is committed, and then the axiom
+	TEST_TRUE( during.commits == STATEMENTS + 1 && l->iterator == NULL );
+	TEST_TRUE( r->match->children->children == NULL );
+	TEST_TRUE( r->context->arena->allocated < allocated / 10 );
+	ParsingResult_free(r);
+
+	// Streams discard the input as the statements are sent
+	FILE* file = fopen(STREAM, "w");
+	TEST_TRUE( file != NULL );
+	for (int i=0 ; i<10 ; i++) {fputs(text, file);}
+	fclose(file);
+	Events_reset(&during, g);
+	Iterator* iterator = Iterator_Stream(STREAM, 256);
+	r = Listener_parseIterator(l, g, iterator);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( during.commits == STATEMENTS * 10 + 1 && during.numbers == parsed.numbers * 10 );
+	TEST_TRUE( iterator->capacity < strlen(text) );
+	ParsingResult_free(r);
+	Iterator_free(iterator);
+
+	Listener_free(l);
+	free(text);
+	Grammar_free(g);
+}
+
+void test_nesting() {
+	// The events sent during the parse are those of the whole tree, each
+	// with the parent it has in the tree, with or without children of the
+	// axiom before the statements, and with either engine.
+	const char* texts[] = {"a = 1 + 2;\nb = c + 34;", "main;\na = 1 + 2;\nb = c + 34;"};
+	for (int k=0 ; k<4 ; k++) {
+		int            i    = k % 2;
+		Grammar*       g    = Grammar_create(FALSE, i == 1);
+		Grammar_setEngine(g, k < 2 ? ENGINE_RECURSIVE : ENGINE_ITERATIVE, 0);
+		ParsingResult* r    = Grammar_parseString(g, texts[i]);
+		MatchTree*     tree = MatchTree_new(r);
+		Events         events;
+		Listener*      l    = Listener_create(g, &events);
+		Events_record(&events, tree->count);
+		ParsingResult* s = Listener_parseString(l, g, texts[i]);
+		TEST_TRUE( ParsingResult_isSuccess(s) );
+		TEST_TRUE( s->match->children->next == NULL || s->match->children->next->next->children == NULL );
+		TEST_TRUE( events.recorded == tree->count && events.enters == tree->count && events.exits == tree->count );
+		TEST_TRUE( events.balanced && events.depth == 0 && events.parents[0] == -1 );
+		TEST_TRUE( events.commits == (i == 0 ? 3 : 5) );
+		bool same = TRUE;
+		for (int j=0 ; j<tree->count ; j++) {
+			MatchNode* node = &tree->nodes[j];
+			same = same && events.elements[j] == node->element && events.offsets[j] == node->offset;
+			same = same && events.parents[j] == (node->parent < 0 ? -1 : tree->nodes[node->parent].element);
+		}
+		TEST_TRUE( same );
+		Events_free(&events);
+		ParsingResult_free(s);
+		Listener_free(l);
+		MatchTree_free(tree);
+		ParsingResult_free(r);
+		Grammar_free(g);
+	}
+}
+
+void test_recursive() {
+	// Statements that could contain the axiom again are sent once the
+	// parse is done, in one go.
+	Grammar*  g = Grammar_create(TRUE, FALSE);
+	Events    events;
+	Listener* l = Listener_create(g, &events);
+	ParsingResult* r = Listener_parseString(l, g, "a = 1 + 2; b = {c = 3 + 4;} + 5;");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( events.commits == 1 && events.balanced && events.numbers == 5 );
+	ParsingResult_free(r);
+	Listener_free(l);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_events();
+	test_stream();
+	test_nesting();
+	test_recursive();
+	TEST_SUCCEED;
+	return 0;
+}
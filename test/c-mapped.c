@@ -0,0 +1,69 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the memory-mapped iterator:
+ *
+ * - A file that spans exactly a page is parsed, the mapped data being
+ *   followed by a `\0`.
+ * - The result is the same as with the default file input.
+ * - Empty and missing files are supported.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define PATH  "c-mapped.txt"
+#define EMPTY "c-mapped-empty.txt"
+
+size_t writeInput(const char* path, size_t items) {
+	FILE* f = fopen(path, "w");
+	for (size_t i=0 ; i<items ; i++) {fputs("abc,", f);}
+	fclose(f);
+	return items * 4;
+}
+
+int main (int argc, char** argv) {
+	size_t length = writeInput(PATH, sysconf(_SC_PAGESIZE) / 4);
+	writeInput(EMPTY, 0);
+
+	Grammar* g = Grammar_new();
+	SYMBOL (NAME,  TOKEN("[a-z]+"));
+	SYMBOL (COMMA, WORD(","));
+	SYMBOL (Item,  RULE(_S(NAME), _S(COMMA)));
+	SYMBOL (Items, RULE(MANY(_S(Item))));
+	AXIOM(Items);
+
+	// The mapped data ends with a `\0`, even if the file fills its pages
+	Iterator* iterator = Iterator_Map(PATH);
+	TEST_TRUE( iterator != NULL );
+	TEST_TRUE( Iterator_remaining(iterator) == length );
+	TEST_TRUE( iterator->buffer[length] == '\0' );
+	Iterator_free(iterator);
+
+	ParsingResult* r = Grammar_parseMapped(g, PATH);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->match->length == length );
+	TEST_TRUE( ParsingResult_remaining(r) == 0 );
+	int count = Match_countAll(r->match);
+	ParsingResult_free(r);
+
+	// We get the same result with the default file input
+	r = Grammar_parsePath(g, PATH);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->match->length == length );
+	TEST_TRUE( Match_countAll(r->match) == count );
+	ParsingResult_free(r);
+
+	// Empty files can be mapped, but missing files can't
+	iterator = Iterator_Map(EMPTY);
+	TEST_TRUE( iterator != NULL );
+	TEST_TRUE( Iterator_remaining(iterator) == 0 );
+	Iterator_free(iterator);
+	TEST_TRUE( Iterator_Map("c-mapped-missing.txt") == NULL );
+
+	Grammar_free(g);
+	remove(PATH);
+	remove(EMPTY);
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the memoization table:
+ *
+ * - A grammar that backtracks over the same rule yields the same match
+ *   tree with and without memoization.
+ * - Memoized recognitions are registered as hits in the stats.
+ * - A table that cannot hold any entry does not change the result.
+ * - Elements with memoization disabled are never served from the table.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+Grammar* createGrammar(ParsingElement** items) {
+	Grammar* g = Grammar_new();
+	SYMBOL (A,     WORD("a"));
+	SYMBOL (B,     WORD("b"));
+	SYMBOL (X,     WORD("x"));
+	SYMBOL (Y,     WORD("y"));
+	SYMBOL (Item,  GROUP(_S(A), _S(B)));
+	SYMBOL (Items, RULE(MANY(_S(Item))));
+	SYMBOL (WithX, RULE(_S(Items), _S(X)));
+	SYMBOL (WithY, RULE(_S(Items), _S(Y)));
+	SYMBOL (Axiom, GROUP(_S(WithX), _S(WithY)));
+	AXIOM(Axiom);
+	if (items != NULL) {*items = s_Items;}
+	return g;
+}
+
+int countMatches(Match* match) {
+	// Match_countAll returns the last step, so we offset it by one
+	return Match_countAll(match) + 1;
+}
+
+int main (int argc, char** argv) {
+	const char* text = "abbaabbaby";
+
+	// We parse without memoization first, as a reference
+	Grammar*       g = createGrammar(NULL);
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context->memo            == NULL );
+	TEST_TRUE( r->context->stats->memoHits == 0 );
+	int    expected_count  = countMatches(r->match);
+	size_t expected_length = r->match->length;
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	// Then with memoization, where `Items` is memoized after the failure
+	// of `WithX`, and reused by `WithY`.
+	g = createGrammar(NULL);
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context->memo != NULL );
+	TEST_TRUE( r->context->stats->memoHits > 0 );
+	TEST_TRUE( countMatches(r->match) == expected_count );
+	TEST_TRUE( r->match->length       == expected_length );
+	ParsingResult_free(r);
+
+	// A limit that cannot even hold the table yields the same result
+	Grammar_setMemoize(g, 1);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context->stats->memoHits == 0 );
+	TEST_TRUE( countMatches(r->match) == expected_count );
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	// Disabling memoization for `Items` prevents it from being reused
+	ParsingElement* items = NULL;
+	g = createGrammar(&items);
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	ParsingElement_memoize(items, FALSE, FALSE);
+	r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( Memo_get(r->context->memo, items->id, 0) == NULL );
+	TEST_TRUE( countMatches(r->match) == expected_count );
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	TEST_SUCCEED;
+	return 0;
+}
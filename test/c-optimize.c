@@ -0,0 +1,198 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the optimizer passes:
+ *
+ * - Optimized grammars recognize the same inputs as the grammars they were
+ *   built as, with fewer matches.
+ * - The named symbols keep their ids, and the matches of the elements the
+ *   passes created report the symbols they stand for, to processors too.
+ * - The grammar is restored as it was built when prepared again, and
+ *   grammars that skip input don't merge words or repetitions.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+Grammar* Grammar_create(int optimize, bool skip) {
+	Grammar* g = Grammar_new();
+	SYMBOL (DIGIT,      TOKEN("[0-9]"));
+	SYMBOL (NAME,       TOKEN("[a-z]+"));
+	SYMBOL (Number,     RULE(_M(DIGIT)));
+	// The anonymous rules only wrap their child, and the second number
+	// is never tried.
+	SYMBOL (Value,      GROUP(ONE(RULE(_S(Number))), ONE(RULE(_S(NAME))), _S(Number)));
+	// The anonymous groups are alternatives of the operator
+	SYMBOL (Operator,   GROUP(ONE(GROUP(ONE(WORD("+")), ONE(WORD("-")))), ONE(GROUP(ONE(WORD("*")), ONE(WORD("/"))))));
+	SYMBOL (Let,        RULE(ONE(WORD("l")), ONE(WORD("e")), ONE(WORD("t")), ONE(WORD(" ")), _S(NAME), ONE(WORD("=")), _S(Value)));
+	SYMBOL (Operation,  RULE(_S(Value), _S(Operator), _S(Value)));
+	// The empty group can't match, and nothing is tried after the optional
+	// statement.
+	SYMBOL (Statement,  GROUP(ONE(GROUP(NULL)), _S(Let), _S(Operation), _S(Value), OPTIONAL(RULE(_S(NAME))), _S(Number)));
+	SYMBOL (Statements, RULE(MANY(RULE(_S(Statement), ONE(WORD(";"))))));
+	AXIOM(Statements);
+	if (skip) {
+		SYMBOL (WS, TOKEN("[ ]+"));
+		SKIP(WS);
+	}
+	Grammar_setOptimize(g, optimize);
+	Grammar_prepare(g);
+	return g;
+}
+
+ParsingElement* Grammar_symbol(Grammar* g, const char* name) {
+	for (int i=0 ; i<g->axiomCount + g->skipCount + 1 ; i++) {
+		Element* e = g->elements[i];
+		if (e != NULL && ParsingElement_Is(e) && e->name != NULL && strcmp(e->name, name) == 0) {return (ParsingElement*)e;}
+	}
+	return NULL;
+}
+
+Match* Match_find(Match* m, int id) {
+	for ( ; m != NULL ; m = m->next) {
+		if (Match_getElementID(m) == id) {return m;}
+		Match* found = Match_find(m->children, id);
+		if (found != NULL) {return found;}
+	}
+	return NULL;
+}
+
+int Reference_count(Reference* r) {
+	int count = 0;
+	for ( ; r != NULL ; r = r->next) {count++;}
+	return count;
+}
+
+// Parses the text, returning the status and setting the count of nodes
+// of the match tree.
+char Grammar_parse(Grammar* g, const char* text, int* nodes) {
+	ParsingResult* r      = Grammar_parseString(g, text);
+	char           status = r->status;
+	if (nodes != NULL) {
+		MatchTree* tree = MatchTree_new(r);
+		*nodes          = tree->count;
+		MatchTree_free(tree);
+	}
+	ParsingResult_free(r);
+	return status;
+}
+
+int numbers = 0;
+int digits  = 0;
+
+void Numbers_count(Processor* processor, Match* match) {
+	numbers += 1;
+	Processor_process(processor, match->children, 0);
+}
+
+void Digits_count(Processor* processor, Match* match) {
+	digits += 1;
+	TEST_TRUE( strcmp(Match_getElementName(match), "DIGIT") == 0 );
+}
+
+void test_optimize() {
+	Grammar* g    = Grammar_create(0,            FALSE);
+	Grammar* o    = Grammar_create(OPTIMIZE_ALL, FALSE);
+	const char* texts[] = {"let a=12;b*3;", "c;", "12-x;", "let=1;", "1+;", "a;1+2;let b=c;", "", NULL};
+
+	// --- RECOGNITION --------------------------------------------------------
+	// The same inputs are recognized, with fewer matches
+	for (int i=0 ; texts[i] != NULL ; i++) {
+		int  nodes     = 0;
+		int  optimized = 0;
+		char status    = Grammar_parse(g, texts[i], &nodes);
+		TEST_TRUE( Grammar_parse(o, texts[i], &optimized) == status );
+		TEST_TRUE( status != STATUS_SUCCESS || optimized < nodes );
+	}
+	TEST_TRUE( Grammar_parse(o, "let a=12;b*3;", NULL) == STATUS_SUCCESS );
+
+	// --- PASSES -------------------------------------------------------------
+	// The elements are rewritten, and the new ones follow the others
+	TEST_TRUE( o->derivedCount > 0 && o->axiomCount == g->axiomCount + o->derivedCount );
+	TEST_TRUE( Reference_count(Grammar_symbol(o, "Operator")->children)  == 4 );
+	TEST_TRUE( Reference_count(Grammar_symbol(o, "Value")->children)     == 2 );
+	TEST_TRUE( Reference_count(Grammar_symbol(o, "Statement")->children) == 4 );
+	TEST_TRUE( Grammar_symbol(o, "Value")->children->element == Grammar_symbol(o, "Number") );
+	Reference* let = Grammar_symbol(o, "Let")->children;
+	TEST_TRUE( Reference_count(let) == 4 );
+	TEST_TRUE( strcmp(((WordConfig*)let->element->config)->word, "let ") == 0 );
+	TEST_TRUE( strcmp(Token_expr(Grammar_symbol(o, "Number")->children->element), "[0-9]+") == 0 );
+
+	// --- SYMBOLS ------------------------------------------------------------
+	// The symbols have the same ids, which the run of digits reports
+	for (int i=0 ; i<g->axiomCount + g->skipCount + 1 ; i++) {
+		Element* e = g->elements[i];
+		Element* f = o->elements[i];
+		TEST_TRUE( (e == NULL) == (f == NULL) );
+		if (e != NULL && f != NULL) {
+			TEST_TRUE( e->id == f->id && e->type == f->type );
+			TEST_TRUE( (e->name == NULL && f->name == NULL) || (e->name != NULL && f->name != NULL && strcmp(e->name, f->name) == 0) );
+		}
+	}
+	ParsingResult* r = Grammar_parseString(o, "123;");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	Match* m = Match_find(r->match, Grammar_symbol(g, "DIGIT")->id);
+	TEST_TRUE( m != NULL && m->length == 3 && strcmp(Match_getElementName(m), "DIGIT") == 0 );
+	ParsingResult_free(r);
+
+	// The processors are registered with the ids of the grammar as built
+	Processor* p = Processor_new();
+	Processor_register(p, Grammar_symbol(g, "Number")->id, Numbers_count);
+	Processor_register(p, Grammar_symbol(g, "DIGIT")->id,  Digits_count);
+	r = Processor_parseString(p, g, "12;345;");
+	ParsingResult_free(r);
+	TEST_TRUE( numbers == 2 && digits == 5 );
+	numbers = digits = 0;
+	r = Processor_parseString(p, o, "12;345;");
+	ParsingResult_free(r);
+	TEST_TRUE( numbers == 2 && digits == 2 );
+	Processor_free(p);
+
+	// The generated recognizers would replace the optimized ones
+	TEST_FALSE( Grammar_writeC(o, 1, "optimized") );
+
+	// --- RESTORE ------------------------------------------------------------
+	// Preparing again without the passes restores the grammar as built
+	Grammar_setOptimize(o, 0);
+	Grammar_prepare(o);
+	TEST_TRUE( o->derivedCount == 0 && o->optimizations == NULL && o->axiomCount == g->axiomCount );
+	TEST_TRUE( Reference_count(Grammar_symbol(o, "Let")->children) == 7 );
+	for (int i=0 ; texts[i] != NULL ; i++) {
+		int nodes = 0;
+		int other = 0;
+		TEST_TRUE( Grammar_parse(g, texts[i], &nodes) == Grammar_parse(o, texts[i], &other) && nodes == other );
+	}
+	TEST_TRUE( Grammar_fingerprint(o) == Grammar_fingerprint(g) );
+	// And the passes can run again, from the grammar as built
+	Grammar_setOptimize(o, OPTIMIZE_ALL);
+	Grammar_prepare(o);
+	TEST_TRUE( Reference_count(Grammar_symbol(o, "Let")->children) == 4 );
+	Grammar_free(o);
+	Grammar_free(g);
+}
+
+void test_skip() {
+	// Skipped input can separate words and repetitions, which are left
+	// as they are.
+	Grammar* g = Grammar_create(0,            TRUE);
+	Grammar* o = Grammar_create(OPTIMIZE_ALL, TRUE);
+	TEST_TRUE( Reference_count(Grammar_symbol(o, "Let")->children) == 7 );
+	TEST_TRUE( Grammar_symbol(o, "Number")->children->element == Grammar_symbol(o, "DIGIT") );
+	const char* texts[] = {"l e t a = 1 2 ;", "let a=1 2;b * 3;", "1 + x;", NULL};
+	for (int i=0 ; texts[i] != NULL ; i++) {
+		int  nodes     = 0;
+		int  optimized = 0;
+		char status    = Grammar_parse(g, texts[i], &nodes);
+		TEST_TRUE( status == STATUS_SUCCESS );
+		TEST_TRUE( Grammar_parse(o, texts[i], &optimized) == status && optimized < nodes );
+	}
+	Grammar_free(o);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_optimize();
+	test_skip();
+	TEST_SUCCEED;
+	return 0;
+}
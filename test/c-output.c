@@ -0,0 +1,158 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the outputs:
+ *
+ * - Outputs kept in memory grow to hold the whole document.
+ * - Outputs to a sink or file descriptor are flushed in blocks, and large
+ *   writes are sent as they are.
+ * - Escaped data is written as JSON strings expect it.
+ * - The JSON and XML written to an output are the same as the ones written
+ *   to a file descriptor.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS 5000
+#define STATEMENT  "\nabc = \"d\\te\";"
+
+typedef struct Sink {
+	char*  data;
+	size_t length;
+	int    calls;
+	size_t largest;
+	int    failAfter;
+} Sink;
+
+bool Sink_write(const char* data, size_t length, void* context) {
+	Sink* sink = (Sink*)context;
+	if (sink->failAfter >= 0 && sink->calls >= sink->failAfter) {return FALSE;}
+	sink->data = realloc(sink->data, sink->length + length + 1);
+	memcpy(sink->data + sink->length, data, length);
+	sink->length += length;
+	sink->data[sink->length] = '\0';
+	sink->calls  += 1;
+	if (length > sink->largest) {sink->largest = length;}
+	return TRUE;
+}
+
+// Returns what was written to the file, to be freed by the caller
+char* File_read(FILE* file) {
+	long  length = ftell(file);
+	char* text   = calloc(length + 1, 1);
+	rewind(file);
+	TEST_TRUE( fread(text, 1, length, file) == (size_t)length );
+	fclose(file);
+	return text;
+}
+
+void test_output() {
+	// --- MEMORY -------------------------------------------------------------
+	Output* output = Output_new();
+	TEST_TRUE( strcmp(Output_text(output), "") == 0 );
+	Output_writeString(output, "a");
+	Output_writef(output, "%d:%s", 12, "b");
+	Output_writeEscaped(output, "\"c\"\n\td\r\\", 8);
+	TEST_TRUE( strcmp(Output_text(output), "a12:b\\\"c\\\"\\n\\td\\r\\\\") == 0 );
+	// The output grows past its block size
+	size_t length = output->length;
+	char*  block  = malloc(OUTPUT_BLOCK_SIZE * 3);
+	memset(block, '"', OUTPUT_BLOCK_SIZE * 3);
+	Output_write(output, block, OUTPUT_BLOCK_SIZE * 3);
+	Output_writeEscaped(output, block, OUTPUT_BLOCK_SIZE * 3);
+	Output_writef(output, "%*d", OUTPUT_BLOCK_SIZE * 2, 1);
+	TEST_TRUE( output->length == length + OUTPUT_BLOCK_SIZE * 11 );
+	TEST_TRUE( strlen(Output_text(output)) == output->length );
+	TEST_TRUE( Output_text(output)[output->length - 1] == '1' );
+	TEST_TRUE( Output_flush(output) && output->written == 0 );
+	Output_free(output);
+
+	// --- SINK ---------------------------------------------------------------
+	Sink sink = {NULL, 0, 0, 0, -1};
+	output = Output_ToSink(Sink_write, &sink);
+	for (int i=0 ; i<OUTPUT_BLOCK_SIZE ; i++) {Output_writeString(output, "ab");}
+	TEST_TRUE( sink.calls == 1 && sink.largest <= OUTPUT_BLOCK_SIZE );
+	Output_write(output, block, OUTPUT_BLOCK_SIZE * 3);
+	TEST_TRUE( sink.calls == 3 && sink.largest == OUTPUT_BLOCK_SIZE * 3 );
+	Output_writeEscaped(output, block, OUTPUT_BLOCK_SIZE);
+	TEST_TRUE( Output_flush(output) );
+	TEST_TRUE( output->written == OUTPUT_BLOCK_SIZE * 7 );
+	Output_free(output);
+	TEST_TRUE( sink.length == OUTPUT_BLOCK_SIZE * 7 );
+	TEST_TRUE( strncmp(sink.data, "abab", 4) == 0 );
+	TEST_TRUE( sink.data[OUTPUT_BLOCK_SIZE * 5] == '\\' && sink.data[OUTPUT_BLOCK_SIZE * 5 + 1] == '"' );
+	free(sink.data);
+
+	// A failed flush drops what follows
+	sink = (Sink){NULL, 0, 0, 0, 1};
+	output = Output_ToSink(Sink_write, &sink);
+	Output_write(output, block, OUTPUT_BLOCK_SIZE * 2);
+	Output_write(output, block, OUTPUT_BLOCK_SIZE * 2);
+	Output_writeString(output, "a");
+	TEST_FALSE( Output_flush(output) );
+	TEST_TRUE( output->written == OUTPUT_BLOCK_SIZE * 2 );
+	Output_free(output);
+	free(sink.data);
+	free(block);
+}
+
+void test_match() {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,        TOKEN("[ \n]+"));
+	SYMBOL (NAME,      TOKEN("[a-z]+"));
+	SYMBOL (STRING,    TOKEN("\"([^\"]*)\""));
+	SYMBOL (EQUALS,    WORD("="));
+	SYMBOL (SEMICOLON, WORD(";"));
+	SYMBOL (Statement, RULE(_S(NAME), _S(EQUALS), _S(STRING), _S(SEMICOLON)));
+	SYMBOL (Statements, RULE(MANY(_S(Statement))));
+	AXIOM(Statements);
+	SKIP(WS);
+	size_t length = strlen(STATEMENT) * STATEMENTS;
+	char*  text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+
+	// The documents are larger than a block, so that the file descriptor
+	// gets several writes.
+	Output* json = Output_new();
+	Match_outputJSON(r->match, json);
+	TEST_TRUE( json->length > OUTPUT_BLOCK_SIZE * 2 );
+	TEST_TRUE( strstr(Output_text(json), "{\"name\":\"STRING\",\"content\":[\"\\\"d\\\\te\\\"\",\"d\\\\te\"]}") != NULL );
+	FILE* file = tmpfile();
+	Match_writeJSON(r->match, fileno(file));
+	char* written = File_read(file);
+	TEST_TRUE( strcmp(written, Output_text(json)) == 0 );
+	free(written);
+	Output_free(json);
+
+	Output* xml = Output_new();
+	Match_outputXML(r->match, xml);
+	TEST_TRUE( strstr(Output_text(xml), "<g t=\"d\\te\"/></STRING>") != NULL );
+	file = tmpfile();
+	Match_writeXML(r->match, fileno(file));
+	written = File_read(file);
+	TEST_TRUE( strcmp(written, Output_text(xml)) == 0 );
+	Output_free(xml);
+
+	// Match trees write to outputs as well
+	MatchTree* tree = MatchTree_FromResult(r);
+	xml = Output_new();
+	MatchTree_outputXML(tree, xml);
+	TEST_TRUE( strcmp(written, Output_text(xml)) == 0 );
+	free(written);
+	Output_free(xml);
+	MatchTree_free(tree);
+
+	free(text);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_output();
+	test_match();
+	TEST_SUCCEED;
+	return 0;
+}
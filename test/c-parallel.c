@@ -0,0 +1,164 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the parallel parsing:
+ *
+ * - Chunks are split after a boundary element, or where a callback says,
+ *   and give the same matches as a sequential parse.
+ * - The matches of the chunks are joined in order, with the offsets of
+ *   the whole text.
+ * - The join stops at the first chunk that does not parse entirely.
+ * - Batches of inputs give each input the result of parsing it alone.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS 100000
+#define STATEMENT  "abc=123;\n"
+
+ParsingElement* s_Statement = NULL;
+
+int countStatements(Match* match, int step, void* count) {
+	if (match->element == (Element*)s_Statement) {*((int*)count) += 1;}
+	return step;
+}
+
+int Statements_count(Match* match) {
+	int count = 0;
+	Match__walk(match, countStatements, 0, &count);
+	return count;
+}
+
+size_t splitLines(const char* text, size_t length, size_t offset, void* data) {
+	*((int*)data) += 1;
+	const char* eol = memchr(text + offset, '\n', length - offset);
+	return eol == NULL ? length : (size_t)(eol - text) + 1;
+}
+
+// Checks that the chunks of the result are ordered and contiguous
+void ParsingResult_checkChunks(ParsingResult* r) {
+	size_t offset = 0;
+	int    count  = 0;
+	for (Match* chunk = r->match->children ; chunk != NULL ; chunk = chunk->next) {
+		// The first token of the chunk has the line of the whole text
+		Match* token = chunk;
+		while (token->children != NULL) {token = token->children;}
+		TEST_TRUE( chunk->offset == offset );
+		TEST_TRUE( token->offset == offset );
+		TEST_TRUE( Match_getLine(token, r->context->iterator) == offset / strlen(STATEMENT) );
+		offset += chunk->length;
+		count  += 1;
+	}
+	TEST_TRUE( count > 1 );
+	TEST_TRUE( offset == r->match->length );
+	TEST_TRUE( offset == r->context->iterator->offset );
+}
+
+int main (int argc, char** argv) {
+	Grammar* g = Grammar_new();
+	SYMBOL (NAME,       TOKEN("[a-z]+"));
+	SYMBOL (EQUALS,     WORD("="));
+	SYMBOL (NUMBER,     TOKEN("[0-9]+"));
+	SYMBOL (SEMICOLON,  WORD(";"));
+	SYMBOL (EOL,        WORD("\n"));
+	s_Statement = RULE(_S(NAME), _S(EQUALS), _S(NUMBER), _S(SEMICOLON), _S(EOL));
+	ParsingElement_name(s_Statement, "Statement");
+	SYMBOL (Statements, RULE(MANY(_S(Statement))));
+	AXIOM(Statements);
+
+	size_t length = strlen(STATEMENT) * STATEMENTS;
+	char*  text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+
+	ParsingResult* s = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(s) );
+	TEST_TRUE( Statements_count(s->match) == STATEMENTS );
+
+	// --- BOUNDARY -----------------------------------------------------------
+	ParsingResult* r = Grammar_parseParallel(g, text, s_EOL, 2);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->match->element == (Element*)s_Statements );
+	TEST_TRUE( Statements_count(r->match) == STATEMENTS );
+	ParsingResult_checkChunks(r);
+#ifdef WITH_STATS
+	TEST_TRUE( r->context->stats->successBySymbol[s_Statement->id] == s->context->stats->successBySymbol[s_Statement->id] );
+#endif
+	ParsingResult_free(r);
+
+	// --- CALLBACK -----------------------------------------------------------
+	int splits = 0;
+	r = Grammar_parseParallelWith(g, text, splitLines, &splits, 3);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( splits == 3 * PARALLEL_CHUNKS - 1 );
+	TEST_TRUE( Statements_count(r->match) == STATEMENTS );
+	ParsingResult_checkChunks(r);
+	ParsingResult_free(r);
+	ParsingResult_free(s);
+
+	// --- FAILURE ------------------------------------------------------------
+	// A statement in the second half doesn't parse, so the parse stops
+	// before it, as the sequential parse does.
+	size_t error = strlen(STATEMENT) * (STATEMENTS * 3 / 4) + 6;
+	text[error]  = 'x';
+	s = Grammar_parseString(g, text);
+	r = Grammar_parseParallel(g, text, s_EOL, 0);
+	TEST_TRUE( ParsingResult_isPartial(s) );
+	TEST_TRUE( ParsingResult_isPartial(r) );
+	TEST_TRUE( r->context->iterator->offset == s->context->iterator->offset );
+	TEST_TRUE( r->match->length == r->context->iterator->offset );
+	TEST_TRUE( Statements_count(r->match) == Statements_count(s->match) );
+	TEST_TRUE( r->context->lastMatchOffset + r->context->lastMatchLength == s->context->lastMatchOffset + s->context->lastMatchLength );
+	ParsingResult_free(r);
+	ParsingResult_free(s);
+
+	// The first chunk fails, so the whole parse fails
+	text[0] = '0';
+	r = Grammar_parseParallel(g, text, s_EOL, 2);
+	TEST_TRUE( ParsingResult_isFailure(r) );
+	ParsingResult_free(r);
+
+	// --- SMALL INPUTS -------------------------------------------------------
+	r = Grammar_parseParallel(g, STATEMENT STATEMENT, s_EOL, 4);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( Statements_count(r->match) == 2 );
+	ParsingResult_free(r);
+	r = Grammar_parseParallel(g, "", s_EOL, 4);
+	TEST_TRUE( ParsingResult_isFailure(r) );
+	ParsingResult_free(r);
+
+	// --- BATCH --------------------------------------------------------------
+	// Each input has its own result, whether the others parse or not
+	#define BATCH 16
+	Iterator*      inputs[BATCH];
+	ParsingResult* results[BATCH];
+	for (int i=0 ; i<BATCH ; i++) {
+		size_t end = strlen(STATEMENT) * (i * 1000 + 1);
+		inputs[i]  = i == 3 ? Iterator_FromString("abc=;\n") : Iterator_FromSlice(text + strlen(STATEMENT), 0, end);
+	}
+	Grammar_parseMany(g, inputs, results, BATCH, 4);
+	for (int i=0 ; i<BATCH ; i++) {
+		TEST_TRUE( results[i] != NULL && results[i]->context->iterator == inputs[i] );
+		if (i == 3) {
+			TEST_TRUE( ParsingResult_isFailure(results[i]) );
+		} else {
+			TEST_TRUE( ParsingResult_isSuccess(results[i]) );
+			TEST_TRUE( Statements_count(results[i]->match) == i * 1000 + 1 );
+		}
+		ParsingResult_free(results[i]);
+		Iterator_free(inputs[i]);
+	}
+	// Batches can be smaller than the jobs, or empty
+	inputs[0] = Iterator_FromString(STATEMENT);
+	Grammar_parseMany(g, inputs, results, 1, 0);
+	TEST_TRUE( ParsingResult_isSuccess(results[0]) );
+	ParsingResult_free(results[0]);
+	Iterator_free(inputs[0]);
+	Grammar_parseMany(g, inputs, results, 0, 4);
+
+	free(text);
+	Grammar_free(g);
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the pool of parsing contexts:
+ *
+ * - The contexts of freed results are reused by the following parses,
+ *   along with their arenas, and are reset as new contexts would be.
+ * - The pool keeps at most the given number of contexts.
+ * - Built `WITH_THREADS`, a grammar (prepared by the first parse) can be
+ *   shared by several threads.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define THREADS 4
+#define PARSES  200
+
+Grammar* Grammar_create(void) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,     TOKEN("[ ]+"));
+	SYMBOL (NAME,   TOKEN("[a-z]+"));
+	SYMBOL (NUMBER, TOKEN("[0-9]+"));
+	SYMBOL (Value,  GROUP(_S(NUMBER), _S(NAME)));
+	SYMBOL (Values, RULE(MANY(_S(Value))));
+	AXIOM(Values);
+	SKIP(WS);
+	return g;
+}
+
+void test_reuse() {
+	Grammar* g = Grammar_create();
+	Grammar_setPool(g, 2);
+	ParsingResult* r = Grammar_parseString(g, "a 1 b 2");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingContext* context = r->context;
+	Arena*          arena   = context->arena;
+	size_t          allocated = arena->allocated;
+	ParsingContext_setInt(context, "x", 1);
+	ParsingResult_free(r);
+	TEST_TRUE( g->pool != NULL );
+
+	// The context is reset, and keeps its arena
+	r = Grammar_parseString(g, "c 3");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context == context );
+	TEST_TRUE( r->context->arena == arena && arena->allocated == allocated );
+	TEST_TRUE( r->context->iterator->offset == 3 );
+	TEST_TRUE( r->context->lastMatchOffset + r->context->lastMatchLength == 3 );
+	TEST_TRUE( ParsingContext_getVariableCount(r->context) == 0 );
+	TEST_TRUE( ParsingContext_get(r->context, "x") == NULL );
+	TEST_TRUE( r->context->stats->bytesRead == 3 );
+	TEST_TRUE( r->context->memo == NULL );
+	ParsingResult_free(r);
+
+	// The context follows the changes of the grammar
+	Grammar_setMemoize(g, MEMO_LIMIT_DEFAULT);
+	r = Grammar_parseString(g, "d");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context == context && r->context->memo != NULL );
+	ParsingResult_free(r);
+
+	// The pool keeps no more than 2 contexts
+	ParsingResult* results[4];
+	for (int i=0 ; i<4 ; i++) {results[i] = Grammar_parseString(g, "e 4");}
+	for (int i=0 ; i<4 ; i++) {
+		TEST_TRUE( ParsingResult_isSuccess(results[i]) );
+		ParsingResult_free(results[i]);
+	}
+	TEST_TRUE( g->pool->count == 2 );
+
+	// Failures and files go through the pool as well
+	r = Grammar_parseString(g, "+");
+	TEST_TRUE( ParsingResult_isFailure(r) );
+	ParsingResult_free(r);
+	TEST_TRUE( g->pool->count == 2 );
+
+	Grammar_setPool(g, 0);
+	TEST_TRUE( g->pool == NULL );
+	Grammar_setPool(g, 1);
+	Grammar_free(g);
+}
+
+#ifdef WITH_THREADS
+void* test_thread(void* grammar) {
+	long failures = 0;
+	for (int i=0 ; i<PARSES ; i++) {
+		ParsingResult* r = Grammar_parseString((Grammar*)grammar, "a 1 b 2 c 3 d 4");
+		if (!ParsingResult_isSuccess(r) || Match_countChildren(r->match->children) != 8) {failures++;}
+		ParsingResult_free(r);
+	}
+	return (void*)failures;
+}
+
+void test_threads() {
+	Grammar* g = Grammar_create();
+	Grammar_setPool(g, THREADS);
+	pthread_t threads[THREADS];
+	for (int i=0 ; i<THREADS ; i++) {pthread_create(&threads[i], NULL, test_thread, g);}
+	for (int i=0 ; i<THREADS ; i++) {
+		void* failures = NULL;
+		pthread_join(threads[i], &failures);
+		TEST_TRUE( failures == NULL );
+	}
+	TEST_TRUE( g->pool->count > 0 && g->pool->count <= THREADS );
+	Grammar_free(g);
+}
+#endif
+
+int main (int argc, char** argv) {
+	test_reuse();
+#ifdef WITH_THREADS
+	test_threads();
+#endif
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,314 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the processors:
+ *
+ * - Matches and match trees are processed without recursing, so that deep
+ *   trees don't overflow the stack.
+ * - Callbacks can be registered for references, and the fallback gets the
+ *   matches that have none.
+ * - Parsing and processing at the same time gives the same values as
+ *   processing the result, while releasing the matches as they're
+ *   processed, from a string or from a stream.
+ * - The other children of the axiom, and the axiom itself when it has a
+ *   callback, are processed as well.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define DEPTH      1000000
+#define STATEMENTS 10000
+#define STATEMENT  "\nabc = 1 + 23;"
+#define STREAM     ".build/c-process.txt"
+
+typedef struct Values {
+	int    statements;
+	int    values;
+	int    named;
+	int    fallbacks;
+	size_t sum;
+} Values;
+
+// Counts the statements, and sums the numbers of their values
+void Statement_process(Processor* processor, Match* match) {
+	Values* values = (Values*)processor->context;
+	values->statements += 1;
+	// The callback processes the children in turn
+	Match* child = match->children;
+	while (child != NULL) {
+		Processor_process(processor, child, 0);
+		child = child->next;
+	}
+}
+
+void Value_process(Processor* processor, Match* match) {
+	Values* values = (Values*)processor->context;
+	values->values += 1;
+	values->sum    += match->length;
+	Processor_process(processor, match->children, 0);
+}
+
+void Named_process(Processor* processor, Match* match) {
+	Values* values = (Values*)processor->context;
+	values->named += 1;
+	Processor_process(processor, match->children, 0);
+}
+
+void Fallback_process(Processor* processor, Match* match) {
+	((Values*)processor->context)->fallbacks += 1;
+}
+
+void Leaf_process(Processor* processor, Match* match) {
+	((Values*)processor->context)->values += 1;
+}
+
+void Node_process(Processor* processor, MatchTree* tree, int node) {
+	((Values*)processor->context)->values += node;
+}
+
+Reference* Suffix = NULL;
+
+Grammar* Grammar_create(bool recursive) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,        TOKEN("[ \n]+"));
+	SYMBOL (NAME,      TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,    TOKEN("[0-9]+"));
+	SYMBOL (EQUALS,    WORD("="));
+	SYMBOL (PLUS,      WORD("+"));
+	SYMBOL (SEMICOLON, WORD(";"));
+	SYMBOL (Value,     GROUP(_S(NUMBER), _S(NAME)));
+	Suffix = _AS(_S(Value), "suffix");
+	SYMBOL (Statement, RULE(_S(NAME), _S(EQUALS), _S(Value), _S(PLUS), Suffix, _S(SEMICOLON)));
+	SYMBOL (Statements, RULE(MANY(_S(Statement))));
+	if (recursive) {
+		// Values can be blocks of statements, which can't be processed
+		// before the parse is done.
+		SYMBOL (LB,    WORD("{"));
+		SYMBOL (RB,    WORD("}"));
+		SYMBOL (Block, RULE(_S(LB), _S(Statements), _S(RB)));
+		ParsingElement_add(s_Value, Reference_Ensure(s_Block));
+	}
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_prepare(g);
+	return g;
+}
+
+char* Text_create(void) {
+	size_t length = strlen(STATEMENT) * STATEMENTS;
+	char*  text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+	return text;
+}
+
+Processor* Processor_create(Grammar* g, Values* values) {
+	Processor* p = Processor_new();
+	p->context   = values;
+	// Both values of a statement get the value callback, but only the
+	// suffix goes through the named reference first.
+	Processor_register(p, g->axiom->children->element->id, Statement_process);
+	Processor_register(p, Suffix->element->id, Value_process);
+	Processor_register(p, Suffix->id, Named_process);
+	return p;
+}
+
+void test_deep() {
+	// We chain matches deeper than the C stack could recurse
+	Grammar* g       = Grammar_create(FALSE);
+	Match*   matches = calloc(DEPTH, sizeof(Match));
+	Element* element = (Element*)g->axiom;
+	for (int i=0 ; i<DEPTH ; i++) {
+		matches[i].element  = i == DEPTH - 1 ? (Element*)g->skip : element;
+		matches[i].children = i == DEPTH - 1 ? NULL : &matches[i + 1];
+	}
+	// A sibling of the processed match is not processed
+	Match sibling = matches[DEPTH - 1];
+	matches[0].next = &sibling;
+	Values     values = {0};
+	Processor* p      = Processor_new();
+	p->context        = &values;
+	Processor_register(p, g->skip->id, Leaf_process);
+	TEST_TRUE( Processor_process(p, matches, 7) == 7 );
+	TEST_TRUE( values.values == 1 && p->stackCount == 0 );
+
+	// And the same for trees
+	MatchTree tree  = {STATUS_SUCCESS, calloc(DEPTH, sizeof(MatchNode)), DEPTH, NULL, 0, g};
+	for (int i=0 ; i<DEPTH ; i++) {
+		tree.nodes[i].element  = i == DEPTH - 1 ? g->skip->id : g->axiom->id;
+		tree.nodes[i].parent   = i - 1;
+		tree.nodes[i].children = i == DEPTH - 1 ? -1 : i + 1;
+		tree.nodes[i].next     = -1;
+	}
+	values.values = 0;
+	Processor_registerNode(p, g->skip->id, Node_process);
+	TEST_TRUE( Processor_processTree(p, &tree, 0, 0) == 0 );
+	TEST_TRUE( values.values == DEPTH - 1 );
+	// Processing a node doesn't go past its subtree
+	values.values = 0;
+	Processor_processTree(p, &tree, DEPTH - 1, 0);
+	TEST_TRUE( values.values == DEPTH - 1 );
+	Processor_free(p);
+	free(tree.nodes);
+	free(matches);
+	Grammar_free(g);
+}
+
+void test_process() {
+	Grammar* g    = Grammar_create(FALSE);
+	char*    text = Text_create();
+
+	// --- AFTER THE PARSE ----------------------------------------------------
+	Values     after = {0};
+	Processor* p     = Processor_create(g, &after);
+	ParsingResult* r = Grammar_parseString(g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	Processor_process(p, r->match, 0);
+	TEST_TRUE( after.statements == STATEMENTS );
+	TEST_TRUE( after.named == STATEMENTS && after.values == STATEMENTS * 2 );
+	// The values include the space skipped before them
+	TEST_TRUE( after.sum   == STATEMENTS * 5 );
+	size_t allocated = r->context->arena->allocated;
+	ParsingResult_free(r);
+
+	// The fallback gets the matches without a callback
+	Values fallbacks = {0};
+	p->context  = &fallbacks;
+	p->fallback = Fallback_process;
+	r = Grammar_parseString(g, text);
+	Processor_process(p, r->match, 0);
+	TEST_TRUE( fallbacks.fallbacks == 1 && fallbacks.statements == 0 );
+	ParsingResult_free(r);
+	p->fallback = NULL;
+
+	// --- DURING THE PARSE ---------------------------------------------------
+	Values during = {0};
+	p->context    = &during;
+	r = Processor_parseString(p, g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( memcmp(&during, &after, sizeof(Values)) == 0 );
+	// The statements were released as they were processed
+	TEST_TRUE( r->match->children->children == NULL );
+	TEST_TRUE( r->context->arena->allocated < allocated / 10 );
+	ParsingResult_free(r);
+
+	// Failed parses don't process anything, and partial ones process what
+	// was recognized.
+	memset(&during, 0, sizeof(Values));
+	r = Processor_parseString(p, g, "a = ;");
+	TEST_TRUE( !ParsingResult_isSuccess(r) && during.statements == 0 );
+	ParsingResult_free(r);
+	r = Processor_parseString(p, g, "a = 1 + 2; b = ;");
+	TEST_TRUE( ParsingResult_isPartial(r) && during.statements == 1 );
+	ParsingResult_free(r);
+
+	// --- STREAMS ------------------------------------------------------------
+	// The input is discarded as the statements are processed, so that the
+	// stream doesn't need to keep it.
+	FILE* file = fopen(STREAM, "w");
+	TEST_TRUE( file != NULL );
+	for (int i=0 ; i<10 ; i++) {fputs(text, file);}
+	fclose(file);
+	memset(&during, 0, sizeof(Values));
+	Iterator* iterator = Iterator_Stream(STREAM, 256);
+	r = Processor_parseIterator(p, g, iterator);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( during.statements == STATEMENTS * 10 && during.sum == STATEMENTS * 50 );
+	TEST_TRUE( iterator->capacity < strlen(text) );
+	ParsingResult_free(r);
+	Iterator_free(iterator);
+
+	Processor_free(p);
+	free(text);
+	Grammar_free(g);
+}
+
+void test_recursive() {
+	// Statements that could contain the axiom again are processed once the
+	// parse is done.
+	Grammar*   g      = Grammar_create(TRUE);
+	Values     values = {0};
+	Processor* p      = Processor_create(g, &values);
+	const char* text  = "a = 1 + 2; b = {c = 3 + 4; d = 5 + 6;} + 7;";
+	ParsingResult* r  = Processor_parseString(p, g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( values.statements == 4 && values.named == 4 && values.values == 8 );
+	TEST_TRUE( r->match->children->children != NULL );
+	ParsingResult_free(r);
+	Processor_free(p);
+	Grammar_free(g);
+}
+
+typedef struct Counts {
+	int  docs;
+	int  headers;
+	int  items;
+	char order[8];  // The first letters of the processed matches, in order
+	int  processed;
+} Counts;
+
+void Counts_add(Counts* counts, char letter) {
+	if (counts->processed < 7) {counts->order[counts->processed++] = letter;}
+}
+
+void Doc_process(Processor* this, Match* match)    {((Counts*)this->context)->docs    += 1; Counts_add(this->context, 'd');}
+void Header_process(Processor* this, Match* match) {((Counts*)this->context)->headers += 1; Counts_add(this->context, 'h');}
+void Item_process(Processor* this, Match* match)   {((Counts*)this->context)->items   += 1; Counts_add(this->context, 'i');}
+
+void test_children() {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,     TOKEN("[ \n]+"));
+	SYMBOL (Header, WORD("header"));
+	SYMBOL (Item,   WORD("item"));
+	SYMBOL (Doc,    RULE(_S(Header), _M(Item)));
+	AXIOM(Doc);
+	SKIP(WS);
+	Grammar_prepare(g);
+	const char* text   = "header item item item";
+	Counts      after  = {0};
+	Counts      during = {0};
+	Processor*  p      = Processor_new();
+	Processor_register(p, s_Header->id, Header_process);
+	Processor_register(p, s_Item->id,   Item_process);
+
+	// The header is processed before the streamed items, as it is when
+	// the whole match is processed
+	p->context = &after;
+	ParsingResult* r = Grammar_parseString(g, text);
+	Processor_process(p, r->match, 0);
+	ParsingResult_free(r);
+	TEST_TRUE( after.headers == 1 && after.items == 3 && strcmp(after.order, "hiii") == 0 );
+	p->context = &during;
+	r = Processor_parseString(p, g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->match->children->next->children == NULL );
+	TEST_TRUE( strcmp(during.order, "hiii") == 0 );
+	TEST_TRUE( memcmp(&during, &after, sizeof(Counts)) == 0 );
+	ParsingResult_free(r);
+
+	// Without any item the parse fails, and nothing is processed
+	memset(&during, 0, sizeof(Counts));
+	r = Processor_parseString(p, g, "header");
+	TEST_TRUE( ParsingResult_isFailure(r) && during.processed == 0 );
+	ParsingResult_free(r);
+
+	// The axiom's callback gets the whole match
+	memset(&during, 0, sizeof(Counts));
+	Processor_register(p, s_Doc->id, Doc_process);
+	r = Processor_parseString(p, g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->match->children->next->children != NULL );
+	TEST_TRUE( during.docs == 1 && during.headers == 0 && during.items == 0 );
+	ParsingResult_free(r);
+
+	Processor_free(p);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_deep();
+	test_process();
+	test_recursive();
+	test_children();
+	TEST_SUCCEED;
+	return 0;
+}
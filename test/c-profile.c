@@ -0,0 +1,162 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the profiler:
+ *
+ * - The stacks start with the axiom and follow the references of the
+ *   grammar, anonymous elements being named after their type and id.
+ * - Sampling every recognition counts each stack as many times as it is
+ *   recognized, and longer periods take proportionally fewer samples.
+ * - The output is in the collapsed stacks format, and the parse is the
+ *   same with or without the profiler.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS 10000
+#define STATEMENT  "\nlet abc = 123;\nabc;"
+
+Grammar* Grammar_create(void) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,         TOKEN("[ \n]+"));
+	SYMBOL (NAME,       TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,     TOKEN("[0-9]+"));
+	SYMBOL (LET,        WORD("let"));
+	SYMBOL (EQUALS,     WORD("="));
+	SYMBOL (SEMICOLON,  WORD(";"));
+	// Expressions are tried after the assignments, which start with a
+	// name as well.
+	SYMBOL (Assignment, RULE(_S(NAME), _S(EQUALS), _S(NUMBER)));
+	SYMBOL (Binding,    RULE(_S(LET), _S(Assignment), _S(SEMICOLON)));
+	SYMBOL (Expression, RULE(_S(NAME), _S(SEMICOLON)));
+	SYMBOL (Statement,  GROUP(_S(Binding), ONE(RULE(_S(Expression)))));
+	SYMBOL (Statements, RULE(_M(Statement)));
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_prepare(g);
+	return g;
+}
+
+ParsingElement* Grammar_symbol(Grammar* g, const char* name) {
+	for (int i=0 ; i<g->axiomCount + g->skipCount + 1 ; i++) {
+		Element* e = g->elements[i];
+		if (e != NULL && ParsingElement_Is(e) && e->name != NULL && strcmp(e->name, name) == 0) {return (ParsingElement*)e;}
+	}
+	return NULL;
+}
+
+char* Text_create(void) {
+	size_t length = strlen(STATEMENT) * STATEMENTS;
+	char*  text   = malloc(length + 1);
+	for (int i=0 ; i<STATEMENTS ; i++) {memcpy(text + i * strlen(STATEMENT), STATEMENT, strlen(STATEMENT));}
+	text[length] = '\0';
+	return text;
+}
+
+// Returns the samples of the given stack in the collapsed output, or 0
+size_t Output_samples(const char* text, const char* stack) {
+	size_t length = strlen(stack);
+	for (const char* line = text ; *line != '\0' ; line = strchr(line, '\n') + 1) {
+		if (strncmp(line, stack, length) == 0 && line[length] == ' ') {return (size_t)atol(line + length + 1);}
+	}
+	return 0;
+}
+
+// Checks that each line is a stack starting with the axiom, followed by
+// its count, and returns the sum of the counts.
+size_t Output_check(const char* text) {
+	size_t total = 0;
+	for (const char* line = text ; *line != '\0' ; line = strchr(line, '\n') + 1) {
+		TEST_TRUE( strncmp(line, "Statements", 10) == 0 );
+		const char* count = strchr(line, ' ');
+		TEST_TRUE( count != NULL && count < strchr(line, '\n') && atol(count + 1) > 0 );
+		total += (size_t)atol(count + 1);
+	}
+	return total;
+}
+
+void test_stacks() {
+	Grammar*  g = Grammar_create();
+	Profiler* p = Profiler_new(1);
+
+	// Every recognition is sampled, each statement recognizing its
+	// binding, and then the expression when the binding failed.
+	ParsingResult* r = Profiler_parseString(p, g, "let a = 1; b; c;");
+	TEST_TRUE( ParsingResult_isSuccess(r) && p->depth == 0 );
+	ParsingResult_free(r);
+	Output* output = Output_new();
+	Profiler_output(p, output);
+	const char* text = Output_text(output);
+	TEST_TRUE( Output_check(text) == p->samples );
+	TEST_TRUE( Output_samples(text, "Statements") == 1 );
+	TEST_TRUE( Output_samples(text, "Statements;Statement") == 3 );
+	TEST_TRUE( Output_samples(text, "Statements;Statement;Binding;Assignment") == 1 );
+	// The references try again after skipping, which shows as well
+	TEST_TRUE( Output_samples(text, "Statements;Statement;Binding") > 3 );
+	TEST_TRUE( Output_samples(text, "Statements;Statement;Binding;WS") > 0 );
+	// The anonymous rule is named after its type and id
+	char stack[256];
+	ParsingElement* anonymous = Grammar_symbol(g, "Statement")->children->next->element;
+	snprintf(stack, sizeof(stack), "Statements;Statement;R#%d;Expression;SEMICOLON", anonymous->id);
+	TEST_TRUE( Output_samples(text, stack) == 2 );
+	Output_free(output);
+
+	// The samples add up over the parses, and failed parses leave the
+	// stack empty.
+	size_t samples = p->samples;
+	r = Profiler_parseString(p, g, "let a = ;");
+	TEST_TRUE( !ParsingResult_isSuccess(r) && p->depth == 0 && p->samples > samples );
+	ParsingResult_free(r);
+	Profiler_free(p);
+	Grammar_free(g);
+}
+
+void test_sampling() {
+	Grammar*  g    = Grammar_create();
+	char*     text = Text_create();
+	Profiler* all  = Profiler_new(1);
+	Profiler* some = Profiler_new(0);
+
+	// The parse is the same with the profiler
+	ParsingResult* s = Grammar_parseString(g, text);
+	ParsingResult* r = Profiler_parseString(all, g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->context->iterator->offset == s->context->iterator->offset );
+	TEST_TRUE( r->context->profiler == NULL );
+	ParsingResult_free(r);
+	ParsingResult_free(s);
+
+	// The sampled stacks are in the same proportions as the recognized
+	// ones, with fewer samples.
+	r = Profiler_parseString(some, g, text);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingResult_free(r);
+	double expected = (double)all->samples / PROFILER_PERIOD;
+	TEST_TRUE( some->samples > expected * 0.9 && some->samples < expected * 1.1 );
+	Output* a = Output_new();
+	Output* b = Output_new();
+	Profiler_output(all,  a);
+	Profiler_output(some, b);
+	TEST_TRUE( Output_check(Output_text(a)) == all->samples );
+	TEST_TRUE( Output_check(Output_text(b)) == some->samples );
+	const char* stacks[] = {"Statements;Statement;Binding;Assignment;NAME", "Statements;Statement;Binding;WS", NULL};
+	for (int i=0 ; stacks[i] != NULL ; i++) {
+		double share = (double)Output_samples(Output_text(a), stacks[i]) / all->samples;
+		double other = (double)Output_samples(Output_text(b), stacks[i]) / some->samples;
+		TEST_TRUE( share > 0 && other > share * 0.8 && other < share * 1.2 );
+	}
+	Output_free(a);
+	Output_free(b);
+
+	Profiler_free(some);
+	Profiler_free(all);
+	free(text);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_stacks();
+	test_sampling();
+	TEST_SUCCEED;
+	return 0;
+}
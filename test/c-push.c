@@ -0,0 +1,190 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the push iterators:
+ *
+ * - Data fed in chunks is appended to the input, which is kept as a whole,
+ *   and nothing can be fed once the input is ended.
+ * - Parses are incomplete as long as they examined the end of the fed
+ *   data, including tokens truncated by it, and succeed once the input is
+ *   ended.
+ * - Errors in the fed data are reported without waiting for the end.
+ * - Resumed parses reuse the recognitions that didn't examine the end
+ *   of the previously fed data, and give the same matches as strings.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define STATEMENTS "a = 1;\nb = 22;\ncc = 3;"
+#define CHUNKS     1000
+
+Grammar* Grammar_create(void) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,         TOKEN("[ \n]+"));
+	SYMBOL (NAME,       TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,     TOKEN("[0-9]+"));
+	SYMBOL (EQUALS,     WORD("="));
+	SYMBOL (SEMICOLON,  WORD(";"));
+	SYMBOL (Statement,  RULE(_S(NAME), _S(EQUALS), _S(NUMBER), _S(SEMICOLON)));
+	SYMBOL (Statements, RULE(_M(Statement)));
+	AXIOM(Statements);
+	SKIP(WS);
+	Grammar_prepare(g);
+	return g;
+}
+
+// Feeds the given data, or ends the input when it is NULL, and parses
+// the input again.
+ParsingResult* ParsingResult_resume(Grammar* g, ParsingResult* r, const char* data) {
+	Iterator* iterator = r->context->iterator;
+	if (data == NULL) {Iterator_end(iterator);}
+	else              {TEST_TRUE( Iterator_feed(iterator, data, strlen(data)) );}
+	ParsingResult* s = Grammar_resume(g, r);
+	ParsingResult_free(r);
+	return s;
+}
+
+char* Match_toJSON(Match* match) {
+	Output* output = Output_new();
+	Match_outputJSON(match, output);
+	char*   json   = strdup(Output_text(output));
+	Output_free(output);
+	return json;
+}
+
+void test_feed() {
+	Iterator* iterator = Iterator_Push();
+	TEST_TRUE( iterator->available == 0 && iterator->buffer[0] == '\0' );
+	TEST_TRUE( Iterator_feed(iterator, "abc", 3) );
+	TEST_TRUE( Iterator_feed(iterator, "", 0) );
+	TEST_TRUE( Iterator_feed(iterator, "\ndef", 4) );
+	TEST_TRUE( iterator->available == 7 && iterator->capacity == 7 );
+	TEST_TRUE( strcmp(iterator->buffer, "abc\ndef") == 0 );
+	// The iterator keeps its offset when the buffer grows
+	Iterator_moveTo(iterator, 5);
+	for (int i=0 ; i<CHUNKS ; i++) {Iterator_feed(iterator, "ghi", 3);}
+	TEST_TRUE( iterator->offset == 5 && *iterator->current == 'e' );
+	TEST_TRUE( Iterator_remaining(iterator) == 2 + CHUNKS * 3 );
+	TEST_TRUE( Iterator_lineAt(iterator, 5) == 1 );
+	Iterator_end(iterator);
+	TEST_FALSE( Iterator_feed(iterator, "jkl", 3) );
+	Iterator_free(iterator);
+	// Other iterators can't be fed
+	iterator = Iterator_FromString("abc");
+	TEST_FALSE( Iterator_feed(iterator, "def", 3) );
+	Iterator_free(iterator);
+}
+
+void test_parse() {
+	Grammar*       g = Grammar_create();
+	Iterator*      iterator = Iterator_Push();
+	ParsingResult* r = Grammar_parseIterator(g, iterator);
+	r->context->freeIterator = TRUE;
+	// Nothing was fed, and every prefix of the statements could be followed
+	// by another statement.
+	TEST_TRUE( ParsingResult_isIncomplete(r) );
+	const char* text = STATEMENTS;
+	for (size_t i=0 ; i<strlen(text) ; i++) {
+		char chunk[2] = {text[i], '\0'};
+		r = ParsingResult_resume(g, r, chunk);
+		TEST_TRUE( ParsingResult_isIncomplete(r) );
+	}
+	// The first statements didn't examine the end of the input
+	TEST_TRUE( r->context->stats->memoHits > 0 );
+	r = ParsingResult_resume(g, r, NULL);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->match->length == strlen(text) );
+	// The matches are the same as the ones of the whole string
+	ParsingResult* s     = Grammar_parseString(g, text);
+	char*          json  = Match_toJSON(r->match);
+	char*          whole = Match_toJSON(s->match);
+	TEST_TRUE( strcmp(json, whole) == 0 );
+	free(json);
+	free(whole);
+	TEST_TRUE( Grammar_resume(g, s) == NULL );
+	ParsingResult_free(s);
+	ParsingResult_free(r);
+	Grammar_free(g);
+}
+
+void test_errors() {
+	Grammar*  g        = Grammar_create();
+	Iterator* iterator = Iterator_Push();
+	// The error is reported before the input is ended, as the parse
+	// didn't examine the end of the fed data.
+	Iterator_feed(iterator, "a = 1;\nb = ;", 12);
+	ParsingResult* r = Grammar_parseIterator(g, iterator);
+	TEST_TRUE( ParsingResult_isPartial(r) );
+	TEST_TRUE( r->match->length == 6 );
+	ParsingResult_free(r);
+	// The input is owned by the caller here
+	Iterator_moveTo(iterator, 0);
+	Iterator_feed(iterator, " c", 2);
+	r = Grammar_parseIterator(g, iterator);
+	TEST_TRUE( ParsingResult_isPartial(r) );
+	ParsingResult_free(r);
+	Iterator_free(iterator);
+
+	iterator = Iterator_Push();
+	Iterator_feed(iterator, "= 1;", 4);
+	r = Grammar_parseIterator(g, iterator);
+	TEST_TRUE( ParsingResult_isFailure(r) );
+	ParsingResult_free(r);
+	Iterator_free(iterator);
+
+	// An incomplete statement fails once the input is ended
+	iterator = Iterator_Push();
+	Iterator_feed(iterator, "a = 1", 5);
+	r = Grammar_parseIterator(g, iterator);
+	TEST_TRUE( ParsingResult_isIncomplete(r) );
+	r = ParsingResult_resume(g, r, NULL);
+	TEST_TRUE( ParsingResult_isFailure(r) );
+	ParsingResult_free(r);
+	Iterator_free(iterator);
+	Grammar_free(g);
+}
+
+void test_tokens() {
+	Grammar* g = Grammar_new();
+	SYMBOL (STRING, TOKEN("\"[^\"]*\""));
+	SYMBOL (Item,   RULE(_S(STRING)));
+	SYMBOL (Values, RULE(_M(Item)));
+	AXIOM(Values);
+	Grammar_prepare(g);
+	// The second string is truncated by the end of the fed data, which
+	// completes it later on.
+	Iterator* iterator = Iterator_Push();
+	Iterator_feed(iterator, "\"ab\"\"abc", 8);
+	ParsingResult* r = Grammar_parseIterator(g, iterator);
+	r->context->freeIterator = TRUE;
+	TEST_TRUE( ParsingResult_isIncomplete(r) );
+	r = ParsingResult_resume(g, r, "d\"");
+	r = ParsingResult_resume(g, r, NULL);
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->match->length == 10 );
+	ParsingResult* s     = Grammar_parseString(g, "\"ab\"\"abcd\"");
+	char*          json  = Match_toJSON(r->match);
+	char*          whole = Match_toJSON(s->match);
+	TEST_TRUE( strcmp(json, whole) == 0 );
+	free(json);
+	free(whole);
+	ParsingResult_free(s);
+	ParsingResult_free(r);
+	// A string that fails before the end of the fed data is an error
+	iterator = Iterator_Push();
+	Iterator_feed(iterator, "\"ab\"x\"", 6);
+	r = Grammar_parseIterator(g, iterator);
+	r->context->freeIterator = TRUE;
+	TEST_TRUE( ParsingResult_isPartial(r) && r->match->length == 4 );
+	ParsingResult_free(r);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_feed();
+	test_parse();
+	test_errors();
+	test_tokens();
+	TEST_SUCCEED;
+	return 0;
+}
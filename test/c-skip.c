@@ -0,0 +1,162 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the skipping of input:
+ *
+ * - Tokens that only repeat a character class have the set of its bytes,
+ *   and the others don't.
+ * - Skipping with such a token scans the input without allocating, and
+ *   skipping again at the same offset reuses the previous skip.
+ * - Parses give the same matches with the scan than with the expression,
+ *   including with skip elements that are not tokens.
+ * - The scan continues past the buffered input of a file.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define HAS(s,c) (((s)->bytes[((unsigned char)(c)) >> 3] & (1 << (((unsigned char)(c)) & 7))) ? TRUE : FALSE)
+#define TEXT     "\n\tabc def // ghi\n  jkl"
+#define SPACES   200000
+#define PATH     ".build/c-skip.txt"
+
+FirstSet* Token_copyRepeats(const char* expr) {
+	ParsingElement* token   = Token_new(expr);
+	FirstSet*       repeats = ((TokenConfig*)token->config)->repeats;
+	FirstSet*       copy    = NULL;
+	if (repeats != NULL) {
+		copy  = malloc(sizeof(FirstSet));
+		*copy = *repeats;
+	}
+	Token_free(token);
+	return copy;
+}
+
+bool Token_repeats(const char* expr, const char* bytes) {
+	FirstSet* set    = Token_copyRepeats(expr);
+	bool      result = set != NULL;
+	for (int i=1 ; i<256 && result ; i++) {
+		if (HAS(set, i) != (strchr(bytes, i) != NULL)) {result = FALSE;}
+	}
+	if (!result) {printf("Token `%s` does not repeat `%s`\n", expr, bytes);}
+	free(set);
+	return result;
+}
+
+bool Token_repeatsNothing(const char* expr) {
+	FirstSet* set = Token_copyRepeats(expr);
+	free(set);
+	return set == NULL;
+}
+
+Grammar* Grammar_create(const char* spaces, bool comments) {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,       TOKEN(spaces));
+	SYMBOL (COMMENT,  TOKEN("//[^\n]*"));
+	SYMBOL (NAME,     TOKEN("[a-z]+"));
+	if (comments) {
+		// The skip element is then a group, which can't be scanned
+		SYMBOL (Names,   RULE(MANY(_S(NAME))));
+		SYMBOL (Skipped, GROUP(_S(WS), _S(COMMENT)));
+		AXIOM(Names);
+		SKIP(Skipped);
+	} else {
+		SYMBOL (Value,   GROUP(_S(NAME), _S(COMMENT)));
+		SYMBOL (Names,   RULE(MANY(_S(Value))));
+		AXIOM(Names);
+		SKIP(WS);
+	}
+	Grammar_prepare(g);
+	return g;
+}
+
+char* Grammar_toJSON(Grammar* g, const char* text) {
+	ParsingResult* r      = Grammar_parseString(g, text);
+	Output*        output = Output_new();
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	Match_outputJSON(r->match, output);
+	char*          json   = strdup(Output_text(output));
+	Output_free(output);
+	ParsingResult_free(r);
+	return json;
+}
+
+int main (int argc, char** argv) {
+
+	// --- CLASSES ------------------------------------------------------------
+	TEST_TRUE( Token_repeats("[ \t\n]+",    " \t\n") );
+	TEST_TRUE( Token_repeats("[ \\t\\n]*",  " \t\n") );
+	TEST_TRUE( Token_repeats("\\s+",        " \t\n\v\f\r") );
+	TEST_TRUE( Token_repeats(" +",          " ") );
+	TEST_TRUE( Token_repeats("[ ]++",       " ") );
+	TEST_TRUE( Token_repeats("[a-c_\\-]+",  "abc_-") );
+	TEST_TRUE( Token_repeatsNothing("[^ ]+") );
+	TEST_TRUE( Token_repeatsNothing("[ ]") );
+	TEST_TRUE( Token_repeatsNothing("[ ]+x") );
+	TEST_TRUE( Token_repeatsNothing("[ ]+?") );
+	TEST_TRUE( Token_repeatsNothing("\\s+|#") );
+	TEST_TRUE( Token_repeatsNothing("(?:\\s)+") );
+	TEST_TRUE( Token_repeatsNothing("[[:space:]]+") );
+	TEST_TRUE( Token_repeatsNothing("[\\s#]+") );
+	TEST_TRUE( Token_repeatsNothing("\\d+") );
+	TEST_TRUE( Token_repeatsNothing("é+") );
+
+	// --- SKIPPING -----------------------------------------------------------
+	Grammar*        g       = Grammar_create("[ \t\n]+", FALSE);
+	ParsingContext* context = ParsingContext_new(g, Iterator_FromString("   abc"));
+	context->freeIterator   = TRUE;
+	ArenaMark       mark    = Arena_mark(context->arena);
+	TEST_TRUE( ParsingElement_skip(g->axiom, context) == 3 );
+	TEST_TRUE( context->iterator->offset == 3 );
+	TEST_TRUE( ParsingElement_skip(g->axiom, context) == 0 );
+	TEST_TRUE( context->iterator->offset == 3 );
+	// Both skips were remembered in turn, the last one being reused
+	TEST_TRUE( context->skipOffset == 3 && context->skipEnd == 3 );
+	Iterator_backtrack(context->iterator, 0);
+	TEST_TRUE( ParsingElement_skip(g->axiom, context) == 3 );
+	TEST_TRUE( context->skipOffset == 0 && context->skipEnd == 3 );
+	context->skipEnd = 2;
+	Iterator_backtrack(context->iterator, 0);
+	TEST_TRUE( ParsingElement_skip(g->axiom, context) == 2 );
+	// Nothing was allocated
+	ArenaMark end = Arena_mark(context->arena);
+	TEST_TRUE( end.block == mark.block && end.offset == mark.offset );
+	ParsingContext_free(context);
+
+	// --- PARSING ------------------------------------------------------------
+	// The expression gives the same matches as the scan, with or without
+	// comments.
+	Grammar* expression = Grammar_create("(?:[ \t\n])+", FALSE);
+	Grammar* comments   = Grammar_create("[ \t\n]+", TRUE);
+	TEST_TRUE( ((TokenConfig*)g->skip->config)->repeats != NULL );
+	TEST_TRUE( ((TokenConfig*)expression->skip->config)->repeats == NULL );
+	char* scanned = Grammar_toJSON(g, TEXT);
+	char* matched = Grammar_toJSON(expression, TEXT);
+	TEST_TRUE( strcmp(scanned, matched) == 0 );
+	free(scanned);
+	free(matched);
+	ParsingResult* r = Grammar_parseString(comments, TEXT);
+	TEST_TRUE( ParsingResult_isSuccess(r) && r->match->length == strlen(TEXT) );
+	// The last skip is the one before the last name
+	TEST_TRUE( r->context->skipOffset == 16 && r->context->skipEnd == 19 );
+	ParsingResult_free(r);
+	Grammar_free(expression);
+	Grammar_free(comments);
+
+	// --- FILES --------------------------------------------------------------
+	// The spaces are longer than the input that is first buffered
+	FILE* file = fopen(PATH, "w");
+	TEST_TRUE( file != NULL );
+	fputs("abc", file);
+	for (int i=0 ; i<SPACES ; i++) {fputc(' ', file);}
+	fputs("def", file);
+	fclose(file);
+	r = Grammar_parsePath(g, PATH);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->match->length == SPACES + 6 );
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the parsing stats by symbol:
+ *
+ * - Built `WITH_STATS`, successes, failures and bytes are counted by symbol,
+ *   and the time is measured when the grammar is timed.
+ * - Otherwise, the counters stay at zero.
+ *
+ * Run this with `valgrind --leak-check=full`, and once with
+ * `make FEATURES="pcre fortify gc stats"`.
+*/
+
+int main (int argc, char** argv) {
+	Grammar* g = Grammar_new();
+	SYMBOL (NAME,   TOKEN("[a-z]+"));
+	SYMBOL (NUMBER, TOKEN("[0-9]+"));
+	SYMBOL (COMMA,  WORD(","));
+	SYMBOL (Value,  GROUP(_S(NUMBER), _S(NAME)));
+	SYMBOL (Item,   RULE(_S(Value), _S(COMMA)));
+	SYMBOL (Items,  RULE(MANY(_S(Item))));
+	AXIOM(Items);
+	Grammar_setTimed(g, TRUE);
+	// The last item has no comma, so the parse is partial
+	ParsingResult* r = Grammar_parseString(g, "ab,12,cd,x");
+	TEST_TRUE( ParsingResult_isPartial(r) );
+	ParsingStats* stats = r->context->stats;
+	TEST_TRUE( stats->symbolsCount == (size_t)(g->axiomCount + g->skipCount + 1) );
+	TEST_TRUE( stats->parseTime >= 0 );
+	TEST_TRUE( ParsingStats_attempts(stats, -1) == 0 );
+	TEST_TRUE( ParsingStats_attempts(stats, stats->symbolsCount) == 0 );
+#ifdef WITH_STATS
+	// The FIRST sets keep `NUMBER` from being tried on names
+	TEST_TRUE( stats->successBySymbol[s_NAME->id]   == 3 );
+	TEST_TRUE( stats->bytesBySymbol[s_NAME->id]     == 5 );
+	TEST_TRUE( ParsingStats_attempts(stats, s_NUMBER->id) == 1 );
+	TEST_TRUE( stats->bytesBySymbol[s_NUMBER->id]   == 2 );
+	TEST_TRUE( stats->successBySymbol[s_Item->id]   == 3 );
+	TEST_TRUE( stats->failureBySymbol[s_Item->id]   == 1 );
+	TEST_TRUE( stats->bytesBySymbol[s_Items->id]    == 9 );
+	TEST_TRUE( stats->timeBySymbol[s_Item->id] >= stats->timeBySymbol[s_Value->id] );
+	TEST_TRUE( stats->timeBySymbol[s_Value->id] > 0 );
+#else
+	for (size_t i=0 ; i<stats->symbolsCount ; i++) {
+		TEST_TRUE( stats->successBySymbol[i] == 0 );
+		TEST_TRUE( stats->failureBySymbol[i] == 0 );
+		TEST_TRUE( stats->bytesBySymbol[i]   == 0 );
+		TEST_TRUE( stats->timeBySymbol[i]    == 0 );
+	}
+#endif
+	ParsingResult_free(r);
+	Grammar_free(g);
+	TEST_SUCCEED;
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the sliding-window iterator:
+ *
+ * - A file much bigger than the window is parsed with a buffer that is
+ *   bounded by the window.
+ * - Committed input is discarded even when the window would keep it.
+ * - Token groups are still available once the input has been discarded,
+ *   and so are the matches written as XML and JSON.
+ * - The groups of the matches that are processed as they are recognized
+ *   are released along with them.
+ * - Backtracking further than the window fails the parse.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define ITEMS  100000
+#define WINDOW 1024
+#define PATH   "c-stream.txt"
+
+void writeInput() {
+	FILE* f = fopen(PATH, "w");
+	for (int i=0 ; i<ITEMS ; i++) {fprintf(f, "item%d,", i);}
+	fclose(f);
+}
+
+void commit(ParsingElement* this, ParsingContext* context) {
+	Iterator_commit(context->iterator, context->iterator->offset);
+}
+
+Grammar* createGrammar( bool backtrack, bool commits ) {
+	Grammar* g = Grammar_new();
+	SYMBOL (NAME,   TOKEN("[a-z]+(\\d+)"));
+	SYMBOL (COMMA,  WORD(","));
+	SYMBOL (Item,   RULE(_S(NAME), _S(COMMA)));
+	SYMBOL (Items,  RULE(MANY(_S(Item))));
+	AXIOM(Items);
+	if (commits) {
+		ParsingElement_add(s_Item, Reference_Ensure(PROCEDURE(commit)));
+	}
+	if (backtrack) {
+		// The `Ended` alternative only fails at the end of the input, so
+		// parsing `Items` again means backtracking to the start.
+		SYMBOL (END,   WORD("!"));
+		SYMBOL (Ended, RULE(_S(Items), _S(END)));
+		SYMBOL (Axiom, GROUP(_S(Ended), _S(Items)));
+		AXIOM(Axiom);
+	}
+	return g;
+}
+
+int main (int argc, char** argv) {
+	writeInput();
+
+	// The window bounds the buffer, and the last group is still there
+	Grammar*       g = createGrammar(FALSE, FALSE);
+	ParsingResult* r = Grammar_parseStream(g, PATH, WINDOW);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context->iterator->capacity <= WINDOW + ITERATOR_BUFFER_AHEAD * 3 );
+	TEST_TRUE( ParsingResult_textOffset(r) > 0 );
+	Match* first = r->match->children->children->children->children;
+	TEST_TRUE( strcmp(TokenMatch_group(first, 1), "0") == 0 );
+	TEST_TRUE( strncmp(TokenMatch_groupStart(first, 0), "item0", TokenMatch_groupLength(first, 0)) == 0 );
+	// The writers read the groups of the discarded input
+	Output* output = Output_new();
+	Match_outputXML(r->match, output);
+	TEST_TRUE( strstr(Output_text(output), "item0") != NULL && strstr(Output_text(output), "item99999") != NULL );
+	Output_free(output);
+	output = Output_new();
+	Match_outputJSON(r->match, output);
+	TEST_TRUE( strstr(Output_text(output), "\"item0\"") != NULL && strstr(Output_text(output), "\"item99999\"") != NULL );
+	Output_free(output);
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	// Committing bounds the buffer even with a window larger than the input
+	g = createGrammar(FALSE, TRUE);
+	r = Grammar_parseStream(g, PATH, ITEMS * 16);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( r->context->iterator->capacity <= ITERATOR_BUFFER_AHEAD * 3 );
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	// The processed items are released with their groups, so that the
+	// matches don't grow with the input either.
+	g = createGrammar(FALSE, FALSE);
+	Processor* p        = Processor_new();
+	Iterator*  iterator = Iterator_Stream(PATH, WINDOW);
+	r = Processor_parseIterator(p, g, iterator);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingContext_account(r->context);
+	TEST_TRUE( r->context->stats->bytesMatches < ITEMS );
+	ParsingResult_free(r);
+	Iterator_free(iterator);
+	Processor_free(p);
+	Grammar_free(g);
+
+	// Backtracking to the start fails with a window, but not without
+	g = createGrammar(TRUE, FALSE);
+	r = Grammar_parseStream(g, PATH, WINDOW);
+	TEST_TRUE( r->context->iterator->truncated );
+	TEST_TRUE( ParsingResult_isFailure(r) );
+	ParsingResult_free(r);
+	r = Grammar_parseStream(g, PATH, 0);
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	remove(PATH);
+	TEST_SUCCEED;
+	return 0;
+}
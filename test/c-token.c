@@ -0,0 +1,111 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the tokens:
+ *
+ * - The literal prefix of the expression is extracted when the token is
+ *   created, and is empty when anything could change it.
+ * - The first set of a token with a prefix is its first byte.
+ * - Tokens are rejected when the prefix is not there, including when the
+ *   input is shorter than the prefix, and match otherwise.
+ * - Tokens with many groups get all their groups with PCRE2.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+#define HAS(s,c) (((s)->bytes[((unsigned char)(c)) >> 3] & (1 << (((unsigned char)(c)) & 7))) ? TRUE : FALSE)
+
+// Tells if the token created from the given expression has the given
+// prefix, NULL meaning none.
+bool Token_hasPrefix(const char* expr, const char* prefix) {
+	ParsingElement* token  = Token_new(expr);
+	TokenConfig*    config = (TokenConfig*)token->config;
+	bool            result = prefix == NULL
+		? config->prefix == NULL && config->prefixLength == 0
+		: config->prefix != NULL && config->prefixLength == strlen(prefix) && strcmp(config->prefix, prefix) == 0;
+	if (!result) {printf("Token `%s`: prefix `%s` instead of `%s`\n", expr, config->prefix, prefix);}
+	Token_free(token);
+	return result;
+}
+
+int main (int argc, char** argv) {
+
+	// --- PREFIXES -----------------------------------------------------------
+	TEST_TRUE( Token_hasPrefix("//[^\n]*",        "//") );
+	TEST_TRUE( Token_hasPrefix("\"([^\"]*)\"",    "\"") );
+	TEST_TRUE( Token_hasPrefix("import\\b",       "import") );
+	TEST_TRUE( Token_hasPrefix("a\\.b\\|c",       "a.b|c") );
+	TEST_TRUE( Token_hasPrefix("a[|]",            "a") );
+	TEST_TRUE( Token_hasPrefix("éa",              "éa") );
+	// Quantifiers keep repeated characters only
+	TEST_TRUE( Token_hasPrefix("ab*c",            "a") );
+	TEST_TRUE( Token_hasPrefix("ab+c",            "ab") );
+	TEST_TRUE( Token_hasPrefix("ab{2}",           "a") );
+	TEST_TRUE( Token_hasPrefix("aé?",             "a") );
+	// Anything else doesn't have a prefix
+	TEST_TRUE( Token_hasPrefix("[0-9]+",          NULL) );
+	TEST_TRUE( Token_hasPrefix("a?b",             NULL) );
+	TEST_TRUE( Token_hasPrefix("\\d+",            NULL) );
+	TEST_TRUE( Token_hasPrefix("abc|abd",         NULL) );
+	TEST_TRUE( Token_hasPrefix("(a|b)c",          NULL) );
+	TEST_TRUE( Token_hasPrefix("(?i)abc",         NULL) );
+	TEST_TRUE( Token_hasPrefix("\\Qa|b\\E",       NULL) );
+	TEST_TRUE( Token_hasPrefix("",                NULL) );
+
+	// --- PARSING ------------------------------------------------------------
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,       TOKEN("[ \n]+"));
+	SYMBOL (COMMENT,  TOKEN("//([^\n]*)"));
+	SYMBOL (IMPORT,   TOKEN("import\\b"));
+	SYMBOL (NAME,     TOKEN("[a-z]+"));
+	SYMBOL (Value,    GROUP(_S(COMMENT), _S(IMPORT), _S(NAME)));
+	SYMBOL (Values,   RULE(MANY(_S(Value))));
+	AXIOM(Values);
+	SKIP(WS);
+	Grammar_prepare(g);
+	FirstSet* first = &g->first[s_COMMENT->id];
+	TEST_TRUE( HAS(first, '/') && !HAS(first, 'a') && !first->nullable );
+	first = &g->first[s_IMPORT->id];
+	TEST_TRUE( HAS(first, 'i') && !HAS(first, 'I') && !first->nullable );
+
+	ParsingResult* r = Grammar_parseString(g, "imports import // a comment\nx");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	// The values are groups, whose child is the reference to the token
+	Match* values = r->match->children->children;
+	TEST_TRUE( values->children->children->element == (Element*)s_NAME );
+	TEST_TRUE( values->next->children->children->element == (Element*)s_IMPORT );
+	Match* comment = values->next->next->children->children;
+	TEST_TRUE( comment->element == (Element*)s_COMMENT );
+	TEST_TRUE( TokenMatch_count(comment) == 2 );
+	TEST_TRUE( strcmp(TokenMatch_group(comment, 1), " a comment") == 0 );
+	ParsingResult_free(r);
+
+	// The input can be shorter than the prefix
+	r = Grammar_parseString(g, "/");
+	TEST_FALSE( ParsingResult_isSuccess(r) );
+	ParsingResult_free(r);
+	r = Grammar_parseString(g, "x //");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingResult_free(r);
+	Grammar_free(g);
+
+	// --- GROUPS -------------------------------------------------------------
+#ifdef WITH_PCRE2
+	// The legacy PCRE only gives the first 10 groups, while the match data
+	// grows to fit all the groups.
+	g = Grammar_new();
+	SYMBOL (LETTERS, TOKEN("(a)(b)(c)(d)(e)(f)(g)(h)(i)(j)(k)(l)(m)(n)(o)(p)(q)(r)(s)(t)"));
+	AXIOM(LETTERS);
+	r = Grammar_parseString(g, "abcdefghijklmnopqrst");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( TokenMatch_count(r->match) == 21 );
+	TEST_TRUE( strcmp(TokenMatch_group(r->match, 20), "t") == 0 );
+	TEST_TRUE( r->context->matchData != NULL );
+	ParsingResult_free(r);
+	Grammar_free(g);
+#endif
+
+	TEST_SUCCEED;
+	return 0;
+}
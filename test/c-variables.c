@@ -0,0 +1,83 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the parsing variables:
+ *
+ * - Names are interned, `depth` being the key 0.
+ * - Variables are set in the current scope, and dropped when it is popped.
+ * - Procedures and conditions see the variables of the enclosing rules.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+void test_variables() {
+	ParsingVariables* v = ParsingVariables_new();
+	int x = ParsingVariables_key(v, "x");
+	TEST_TRUE( ParsingVariables_key(v, "depth") == 0 );
+	TEST_TRUE( ParsingVariables_key(v, "x") == x );
+	TEST_TRUE( strcmp(ParsingVariables_getName(v, x), "x") == 0 );
+	TEST_TRUE( ParsingVariables_get(v, x) == NULL );
+	ParsingVariables_set(v, x, (void*)1);
+	ParsingVariables_push(v);
+	TEST_TRUE( ParsingVariables_get(v, 0) == (void*)1 );
+	TEST_TRUE( ParsingVariables_get(v, x) == (void*)1 );
+	// Setting a variable shadows the one of the parent scope
+	ParsingVariables_set(v, x, (void*)2);
+	ParsingVariables_set(v, x, (void*)3);
+	TEST_TRUE( ParsingVariables_count(v) == 2 );
+	TEST_TRUE( ParsingVariables_get(v, x) == (void*)3 );
+	// Scopes can be nested deeper than the initial capacity
+	for (int i=0 ; i<PARSING_VARIABLES_CAPACITY * 2 ; i++) {
+		ParsingVariables_push(v);
+		ParsingVariables_set(v, ParsingVariables_key(v, "y"), (void*)(long)i);
+	}
+	for (int i=0 ; i<PARSING_VARIABLES_CAPACITY * 2 ; i++) {ParsingVariables_pop(v);}
+	TEST_TRUE( ParsingVariables_count(v) == 2 );
+	ParsingVariables_pop(v);
+	TEST_TRUE( ParsingVariables_get(v, x) == (void*)1 );
+	TEST_TRUE( ParsingVariables_get(v, 0) == (void*)0 );
+	ParsingVariables_free(v);
+}
+
+void setIndent(ParsingElement* this, ParsingContext* context) {
+	ParsingContext_setInt(context, "indent", ParsingContext_getInt(context, "depth"));
+}
+
+bool hasIndent(ParsingElement* this, ParsingContext* context) {
+	return ParsingContext_getInt(context, "indent") > 0;
+}
+
+bool hasNoIndent(ParsingElement* this, ParsingContext* context) {
+	return ParsingContext_get(context, "indent") == NULL;
+}
+
+void test_parsing() {
+	Grammar* g = Grammar_new();
+	SYMBOL (A,      WORD("a"));
+	SYMBOL (B,      WORD("b"));
+	SYMBOL (SetIndent,   PROCEDURE(setIndent));
+	SYMBOL (HasIndent,   CONDITION(hasIndent));
+	SYMBOL (HasNoIndent, CONDITION(hasNoIndent));
+	SYMBOL (Plain,  RULE(_S(A), _S(B)));
+	// The variable set in `Scoped` is visible to its condition, but not
+	// once its scope is popped.
+	SYMBOL (Scoped, RULE(_S(Plain), _S(SetIndent), _S(HasIndent)));
+	SYMBOL (Axiom,  RULE(_S(Scoped), _S(HasNoIndent), _S(Plain)));
+	AXIOM(Axiom);
+	ParsingResult* r = Grammar_parseString(g, "abab");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	TEST_TRUE( ParsingContext_getVariableCount(r->context) == 0 );
+	// Rules that don't reach a procedure or condition don't push a scope
+	TEST_FALSE( HAS_FLAG(s_Plain->flags, ELEMENT_CONTEXTUAL) ? TRUE : FALSE );
+	TEST_TRUE( HAS_FLAG(s_Scoped->flags, ELEMENT_CONTEXTUAL) ? TRUE : FALSE );
+	ParsingResult_free(r);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_variables();
+	test_parsing();
+	TEST_SUCCEED;
+	return 0;
+}
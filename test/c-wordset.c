@@ -0,0 +1,86 @@
+#include "parsing.h"
+#include "testing.h"
+
+/**
+ * This test case exercises the word sets:
+ *
+ * - The first word of the run (and not the longest) that prefixes the input
+ *   is found, as with the ordered choice of groups.
+ * - Runs of words are compiled, and matches point to the original words.
+ * - Children that are not words, and words after skipping, are still tried
+ *   in order.
+ *
+ * Run this with `valgrind --leak-check=full`
+*/
+
+void test_match() {
+	Grammar* g = Grammar_new();
+	SYMBOL (FOR,     WORD("for"));
+	SYMBOL (FOREACH, WORD("foreach"));
+	SYMBOL (FORK,    WORD("fork"));
+	SYMBOL (F,       WORD("f"));
+	SYMBOL (Keyword, GROUP(_S(FORK), _S(FOR), _S(FOREACH), _S(F)));
+	AXIOM(Keyword);
+	Grammar_prepare(g);
+	WordSet* set = g->wordSets[s_Keyword->id];
+	TEST_TRUE( set != NULL );
+	TEST_TRUE( set->start == 0 && set->count == 4 && set->next == NULL );
+	TEST_TRUE( WordSet_match(set, "foreach", 7) == 1 );
+	TEST_TRUE( WordSet_match(set, "fork", 4)    == 0 );
+	TEST_TRUE( WordSet_match(set, "fo", 2)      == 3 );
+	TEST_TRUE( WordSet_match(set, "x", 1)       == -1 );
+	TEST_TRUE( WordSet_match(set, "", 0)        == -1 );
+	// Only the given length of the text is matched
+	TEST_TRUE( WordSet_match(set, "foreach", 3) == 1 );
+	Grammar_free(g);
+}
+
+void test_parsing() {
+	Grammar* g = Grammar_new();
+	SYMBOL (WS,      TOKEN("[ ]+"));
+	SYMBOL (IF,      WORD("if"));
+	SYMBOL (IN,      WORD("in"));
+	SYMBOL (INT,     WORD("int"));
+	SYMBOL (ELSE,    WORD("else"));
+	SYMBOL (NAME,    TOKEN("[a-z]+"));
+	SYMBOL (NUMBER,  TOKEN("[0-9]+"));
+	SYMBOL (PLUS,    WORD("+"));
+	SYMBOL (MINUS,   WORD("-"));
+	SYMBOL (TIMES,   WORD("*"));
+	SYMBOL (DIVIDE,  WORD("/"));
+	// The group has two runs of words, separated by tokens
+	SYMBOL (Value,   GROUP(_S(IF), _S(IN), _S(INT), _S(ELSE), _S(NAME), _S(NUMBER), _S(PLUS), _S(MINUS), _S(TIMES), _S(DIVIDE)));
+	SYMBOL (Values,  RULE(MANY(_S(Value))));
+	AXIOM(Values);
+	SKIP(WS);
+	ParsingResult* r = Grammar_parseString(g, "int if x in 10 + else*");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	WordSet* set = g->wordSets[s_Value->id];
+	TEST_TRUE( set != NULL && set->start == 0 && set->count == 4 );
+	TEST_TRUE( set->next != NULL && set->next->start == 6 && set->next->count == 4 );
+	// `in` comes before `int` in the group, so `int` is never matched
+	ParsingElement* expected[] = {s_IN, s_NAME, s_IF, s_NAME, s_IN, s_NUMBER, s_PLUS, s_ELSE, s_TIMES};
+	Match* value = r->match->children->children;
+	for (int i=0 ; i<9 ; i++) {
+		TEST_TRUE( value != NULL );
+		if (value == NULL) {break;}
+		Match* word = value->children->children;
+		TEST_TRUE( word->element == (Element*)expected[i] );
+		value = value->next;
+	}
+	TEST_TRUE( value == NULL );
+	ParsingResult_free(r);
+
+	// Words that follow skipped input are still matched
+	r = Grammar_parseString(g, "else  +");
+	TEST_TRUE( ParsingResult_isSuccess(r) );
+	ParsingResult_free(r);
+	Grammar_free(g);
+}
+
+int main (int argc, char** argv) {
+	test_match();
+	test_parsing();
+	TEST_SUCCEED;
+	return 0;
+}
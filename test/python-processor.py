@@ -5,8 +5,8 @@ from libparsing import *
 import unittest
 
 __doc__ = """
-Exercises how the processor predicably creates values, comparing both
-processsing stategies (eager or lazy).
+Exercises how the processor predicably creates values, comparing the
+processsing stategies (eager, lazy or flat).
 
 The grammar defined here defines a Lisp-ish language with either parens
 or square-brackets enclosed expressions. The parens/brackets are prefixed
@@ -169,7 +169,7 @@ class TestProcessor(unittest.TestCase):
 
 	def testAll( self ):
 		"""Parses the EXAMPLES, making sure that each line parse AND
-		that both the *lazy* and *eager* strategies return the same
+		that the *lazy*, *eager* and *flat* strategies return the same
 		results."""
 		g = grammar() ; s = g.symbols
 		n = len(EXAMPLES) / 2
@@ -180,10 +180,13 @@ class TestProcessor(unittest.TestCase):
 			self.assertTrue(r.isSuccess(), "Failed parsing: {0}".format(source))
 			pe = P1(g).asEager()
 			pl = P1(g).asLazy()
+			pf = P1(g).asFlat()
 			re = pe.process(r)
 			rl = pl.process(r)
+			rf = pf.process(r)
 			self.assertEqual(re, result)
 			self.assertEqual(rl, result)
+			self.assertEqual(rf, result)
 
 	def testToken( self ):
 		"""Ensures that tokens are properly processed as a list, even
@@ -197,6 +200,8 @@ class TestProcessor(unittest.TestCase):
 		self.assertEqual(p.process(g.parseString("-1"  )), ["-1"])
 		self.assertEqual(p.process(g.parseString("1.2" )), ["1.2", "", ".2"])
 		self.assertEqual(p.process(g.parseString("-1.2")), ["-1.2", "", ".2"])
+		p = Processor(g).asFlat()
+		self.assertEqual(p.process(g.parseString("1.2" )), ["1.2", "", ".2"])
 
 	def testGroup( self ):
 		g = Grammar()
@@ -210,6 +215,22 @@ class TestProcessor(unittest.TestCase):
 		p = Processor(g)
 		self.assertEqual(p.process(g.parseString("hello"   )), [["hello"]])
 		self.assertEqual(p.process(g.parseString("1"  )),      [["1"]])
+		p = Processor(g).asFlat()
+		self.assertEqual(p.process(g.parseString("hello"   )), [["hello"]])
+
+	def testTree( self ):
+		"""Ensures that match trees have the nodes of the matches, in
+		preorder."""
+		g = grammar()
+		r = g.parseString("0..*(hello #t)")
+		t = r.toTree()
+		count = lambda m: 1 + sum(count(_) for _ in m)
+		self.assertEqual(len(t), count(r.match))
+		self.assertEqual(t.parents[0], -1)
+		self.assertEqual(t[0].name, "Value")
+		self.assertEqual(t[0].range, r.match.range)
+		self.assertEqual(list(_.range for _ in t[0][0]), list(_.range for _ in r.match[0]))
+		self.assertFalse(g.parseString("0..*(").toTree().count)
 
 if __name__ == "__main__":
 	unittest.main()